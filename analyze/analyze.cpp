@@ -3,55 +3,106 @@
 /**
  * @description: 分析器，进行语义分析和查询重写，需要检查不符合语义规定的部分
  * @param {shared_ptr<ast::TreeNode>} parse parser生成的结果集
+ * @param {bool} prepare 是否为PREPARE的语句，只有PREPARE的语句中可以使用参数$n
  * @return {shared_ptr<Query>} Query 
  */
-std::shared_ptr<Query> Analyze::do_analyze(std::shared_ptr<ast::TreeNode> parse)
+std::shared_ptr<Query> Analyze::do_analyze(std::shared_ptr<ast::TreeNode> parse, bool prepare)
 {
     std::shared_ptr<Query> query = std::make_shared<Query>();
     if (auto x = std::dynamic_pointer_cast<ast::SelectStmt>(parse))
     {
-        // 处理表名
-        query->tables = std::move(x->tabs);
+        // 处理表名，不移动语法树中的表名，缓存的计划失效后需要重新分析同一棵语法树
+        query->tables = x->tabs;
         /** TODO: 检查表是否存在 */
 
-        // 处理target list，再target list中添加上表名，例如 a.id
+        std::vector<ColMeta> all_cols;
+        get_all_cols(query->tables, all_cols);
+        // 处理target list，再target list中添加上表名，例如 a.id；聚合函数的结果按显示名称投影
+        std::vector<bool> is_agg;
         for (auto &sv_sel_col : x->cols) {
+            if (auto sv_agg = std::dynamic_pointer_cast<ast::AggCol>(sv_sel_col)) {
+                query->aggs.push_back(convert_sv_agg(all_cols, sv_agg));
+                query->cols.push_back(query->aggs.back().output);
+                is_agg.push_back(true);
+                continue;
+            }
             TabCol sel_col = {.tab_name = sv_sel_col->tab_name, .col_name = sv_sel_col->col_name};
-            query->cols.push_back(sel_col);
+            query->cols.push_back(check_column(all_cols, sel_col));  // 列元数据校验
+            is_agg.push_back(false);
         }
-        
-        std::vector<ColMeta> all_cols;
-        get_all_cols(query->tables, all_cols);
         if (query->cols.empty()) {
             // select all columns
             for (auto &col : all_cols) {
                 TabCol sel_col = {.tab_name = col.tab_name, .col_name = col.name};
                 query->cols.push_back(sel_col);
+                is_agg.push_back(false);
             }
-        } else {
-            // infer table name from column name
-            for (auto &sel_col : query->cols) {
-                sel_col = check_column(all_cols, sel_col);  // 列元数据校验
+        }
+        // 处理group by，有分组或聚合函数时，select列表中不是聚合函数的字段必须是分组字段
+        for (auto &sv_group_col : x->group_by) {
+            TabCol group_col = {.tab_name = sv_group_col->tab_name, .col_name = sv_group_col->col_name};
+            query->group_cols.push_back(check_column(all_cols, group_col));
+        }
+        if (!query->aggs.empty() || !query->group_cols.empty()) {
+            for (size_t i = 0; i < query->cols.size(); i++) {
+                auto &sel_col = query->cols[i];
+                if (!is_agg[i] && std::none_of(query->group_cols.begin(), query->group_cols.end(), [&](const TabCol &col) {
+                        return col.tab_name == sel_col.tab_name && col.col_name == sel_col.col_name;
+                    })) {
+                    throw ColumnNotGroupedError(sel_col.col_name);
+                }
             }
         }
         //处理where条件
         get_clause(x->conds, query->conds);
         check_clause(query->tables, query->conds);
+        query->limit = x->limit;
     } else if (auto x = std::dynamic_pointer_cast<ast::UpdateStmt>(parse)) {
-        /** TODO: */
+        // 处理set子句，字段必须属于被更新的表，不能是分区字段
+        TabMeta &tab = sm_manager_->db_.get_table(x->tab_name);
+        for (auto &sv_set_clause : x->set_clauses) {
+            SetClause set_clause;
+            set_clause.lhs = {.tab_name = x->tab_name, .col_name = tab.get_col(sv_set_clause->col_name)->name};
+            // 修改分区字段可能需要把记录移动到另一个分区，不支持
+            if (tab.is_partitioned() && set_clause.lhs.col_name == tab.partition.col_name) {
+                throw InvalidPartitionError("cannot update partition column " + set_clause.lhs.col_name);
+            }
+            set_clause.rhs = convert_sv_value(sv_set_clause->val);
+            query->set_clauses.push_back(set_clause);
+        }
+        //处理where条件
+        get_clause(x->conds, query->conds);
+        check_clause({x->tab_name}, query->conds);
 
     } else if (auto x = std::dynamic_pointer_cast<ast::DeleteStmt>(parse)) {
         //处理where条件
         get_clause(x->conds, query->conds);
         check_clause({x->tab_name}, query->conds);        
     } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(parse)) {
-        // 处理insert 的values值
+        // 处理insert 的values值，多行的值依次展开，每行的值的个数必须与表的字段数相同
+        size_t num_cols = sm_manager_->db_.get_table(x->tab_name).cols.size();
+        for (auto &sv_row : x->rows) {
+            if (sv_row.size() != num_cols) {
+                throw InvalidValueCountError();
+            }
+            for (auto &sv_val : sv_row) {
+                query->values.push_back(convert_sv_value(sv_val));
+            }
+        }
+    } else if (auto x = std::dynamic_pointer_cast<ast::ExplainStmt>(parse)) {
+        // 分析被解释的语句，query->parse指向explain语句本身
+        query = do_analyze(x->stmt, prepare);
+    } else if (auto x = std::dynamic_pointer_cast<ast::ExecuteStmt>(parse)) {
+        // 处理execute 的参数值
         for (auto &sv_val : x->vals) {
             query->values.push_back(convert_sv_value(sv_val));
         }
     } else {
         // do nothing
     }
+    if (!prepare && query->num_params() > 0) {
+        throw InvalidParamError("parameters are only allowed in PREPARE");
+    }
     query->parse = std::move(parse);
     return query;
 }
@@ -121,6 +172,10 @@ void Analyze::check_clause(const std::vector<std::string> &tab_names, std::vecto
         ColType lhs_type = lhs_col->type;
         ColType rhs_type;
         if (cond.is_rhs_val) {
+            if (cond.rhs_val.param >= 0) {
+                // 参数的类型与左侧字段相同，执行时再绑定实际的值
+                cond.rhs_val.type = lhs_type;
+            }
             cond.rhs_val.init_raw(lhs_col->len);
             rhs_type = cond.rhs_val.type;
         } else {
@@ -143,12 +198,46 @@ Value Analyze::convert_sv_value(const std::shared_ptr<ast::Value> &sv_val) {
         val.set_float(float_lit->val);
     } else if (auto str_lit = std::dynamic_pointer_cast<ast::StringLit>(sv_val)) {
         val.set_str(str_lit->val);
+    } else if (auto param = std::dynamic_pointer_cast<ast::Param>(sv_val)) {
+        // 参数的类型由所在的上下文决定，值在执行时绑定
+        val.set_int(0);
+        val.param = param->idx;
     } else {
         throw InternalError("Unexpected sv value type");
     }
     return val;
 }
 
+/**
+ * @description: 解析select列表中的聚合函数，SUM/AVG只能用于数值字段
+ * @return {AggExpr} 聚合函数，output为聚合结果的显示名称，例如SUM(t.x)
+ * @param {vector<ColMeta>&} all_cols 查询涉及的所有表的字段
+ * @param {shared_ptr<ast::AggCol>&} sv_agg 聚合函数
+ */
+AggExpr Analyze::convert_sv_agg(const std::vector<ColMeta> &all_cols, const std::shared_ptr<ast::AggCol> &sv_agg) {
+    std::map<ast::SvAggFunc, std::pair<AggType, std::string>> m = {
+        {ast::SV_AGG_COUNT, {AGG_COUNT, "COUNT"}}, {ast::SV_AGG_SUM, {AGG_SUM, "SUM"}},
+        {ast::SV_AGG_MIN, {AGG_MIN, "MIN"}}, {ast::SV_AGG_MAX, {AGG_MAX, "MAX"}},
+        {ast::SV_AGG_AVG, {AGG_AVG, "AVG"}},
+    };
+    AggExpr agg;
+    agg.type = m.at(sv_agg->func).first;
+    std::string arg = sv_agg->tab_name.empty() ? sv_agg->col_name : sv_agg->tab_name + '.' + sv_agg->col_name;
+    agg.output = {.tab_name = "", .col_name = m.at(sv_agg->func).second + '(' + arg + ')'};
+    agg.col = {.tab_name = sv_agg->tab_name, .col_name = sv_agg->col_name};
+    if (agg.col.col_name == "*") {
+        return agg;
+    }
+    agg.col = check_column(all_cols, agg.col);
+    if (agg.type == AGG_SUM || agg.type == AGG_AVG) {
+        auto col = sm_manager_->db_.get_table(agg.col.tab_name).get_col(agg.col.col_name);
+        if (col->type == TYPE_STRING) {
+            throw IncompatibleTypeError(m.at(sv_agg->func).second, coltype2str(col->type));
+        }
+    }
+    return agg;
+}
+
 CompOp Analyze::convert_sv_comp_op(ast::SvCompOp op) {
     std::map<ast::SvCompOp, CompOp> m = {
         {ast::SV_OP_EQ, OP_EQ}, {ast::SV_OP_NE, OP_NE}, {ast::SV_OP_LT, OP_LT},
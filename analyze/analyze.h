@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <memory>
@@ -22,11 +23,32 @@ class Query{
     std::vector<std::string> tables;
     // update 的set 值
     std::vector<SetClause> set_clauses;
-    //insert 的values值
+    //insert 的values值，多行insert时各行的值依次存放
     std::vector<Value> values;
+    // select 的LIMIT行数，-1表示没有LIMIT
+    int limit = -1;
+    // select 的GROUP BY字段
+    std::vector<TabCol> group_cols;
+    // select 列表中的聚合函数
+    std::vector<AggExpr> aggs;
 
     Query(){}
 
+    // 语句中参数$n的个数，即最大的n
+    int num_params() const {
+        int n = 0;
+        for (auto &cond : conds) {
+            n = std::max(n, cond.is_rhs_val ? cond.rhs_val.param + 1 : 0);
+        }
+        for (auto &val : values) {
+            n = std::max(n, val.param + 1);
+        }
+        for (auto &set_clause : set_clauses) {
+            n = std::max(n, set_clause.rhs.param + 1);
+        }
+        return n;
+    }
+
 };
 
 class Analyze
@@ -37,7 +59,8 @@ public:
     Analyze(SmManager *sm_manager) : sm_manager_(sm_manager){}
     ~Analyze(){}
 
-    std::shared_ptr<Query> do_analyze(std::shared_ptr<ast::TreeNode> root);
+    // prepare为true时分析的是PREPARE的语句，允许其中出现参数$n
+    std::shared_ptr<Query> do_analyze(std::shared_ptr<ast::TreeNode> root, bool prepare = false);
 
 private:
     TabCol check_column(const std::vector<ColMeta> &all_cols, TabCol target);
@@ -46,5 +69,6 @@ private:
     void check_clause(const std::vector<std::string> &tab_names, std::vector<Condition> &conds);
     Value convert_sv_value(const std::shared_ptr<ast::Value> &sv_val);
     CompOp convert_sv_comp_op(ast::SvCompOp op);
+    AggExpr convert_sv_agg(const std::vector<ColMeta> &all_cols, const std::shared_ptr<ast::AggCol> &sv_agg);
 };
 
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "bench_util.h"
+#include "benchmark/benchmark.h"
+#include "index/ix.h"
+#include "transaction/transaction.h"
+
+namespace {
+
+const std::string TAB_NAME = "bench";
+constexpr size_t BENCH_BUFFER_POOL_SIZE = 16384;
+constexpr int SCAN_LENGTH = 100;
+
+// 键的类型和长度，由benchmark的第一个参数选择
+const std::vector<ColMeta> KEY_COLS = {
+    {.tab_name = TAB_NAME, .name = "k", .type = TYPE_INT, .len = 4, .offset = 0},
+    {.tab_name = TAB_NAME, .name = "k", .type = TYPE_FLOAT, .len = 4, .offset = 0},
+    {.tab_name = TAB_NAME, .name = "k", .type = TYPE_STRING, .len = 16, .offset = 0},
+    {.tab_name = TAB_NAME, .name = "k", .type = TYPE_STRING, .len = 64, .offset = 0},
+};
+
+// 把第i个键编码到key中，编码保持i的顺序
+void encode_key(const ColMeta &col, int i, char *key) {
+    memset(key, 0, col.len);
+    if (col.type == TYPE_INT) {
+        memcpy(key, &i, sizeof(i));
+    } else if (col.type == TYPE_FLOAT) {
+        float f = static_cast<float>(i);
+        memcpy(key, &f, sizeof(f));
+    } else {
+        snprintf(key, col.len, "%010d", i);
+    }
+}
+
+/**
+ * 一个B+树索引及其缓冲池，键为0..num_keys-1按类型编码
+ */
+class IndexEnv {
+   public:
+    IndexEnv(const ColMeta &col, int num_keys) : col_(col), num_keys_(num_keys), txn_(0) {
+        disk_manager_ = std::make_unique<DiskManager>();
+        dir_ = std::make_unique<BenchDir>(disk_manager_.get(), "b_plus_tree_bench_db");
+        bpm_ = std::make_unique<BufferPoolManager>(BENCH_BUFFER_POOL_SIZE, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), bpm_.get());
+        ix_manager_->create_index(TAB_NAME, {col_});
+        ih_ = ix_manager_->open_index(TAB_NAME, std::vector<ColMeta>{col_});
+        keys_.resize(static_cast<size_t>(num_keys_) * col_.len);
+        for (int i = 0; i < num_keys_; i++) {
+            encode_key(col_, i, key(i));
+        }
+    }
+
+    ~IndexEnv() {
+        ix_manager_->close_index(ih_.get());
+        ih_.reset();
+        bpm_.reset();
+        dir_.reset();
+    }
+
+    // 按order中的顺序插入所有键，rid的slot_no为键的序号
+    void insert_all(const std::vector<int> &order) {
+        for (int i : order) {
+            ih_->insert_entry(key(i), Rid{0, i}, &txn_);
+        }
+    }
+
+    char *key(int i) { return keys_.data() + static_cast<size_t>(i) * col_.len; }
+
+    IxIndexHandle *ih() { return ih_.get(); }
+    BufferPoolManager *bpm() { return bpm_.get(); }
+    Transaction *txn() { return &txn_; }
+
+   private:
+    ColMeta col_;
+    int num_keys_;
+    Transaction txn_;
+    std::vector<char> keys_;
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BenchDir> dir_;
+    std::unique_ptr<BufferPoolManager> bpm_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<IxIndexHandle> ih_;
+};
+
+std::vector<int> shuffled(int n) {
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    return order;
+}
+
+/**
+ * 向空索引中按随机顺序插入num_keys个键。args: {键类型, 键数}
+ */
+void BM_BPlusTreeInsert(benchmark::State &state) {
+    const ColMeta &col = KEY_COLS[state.range(0)];
+    int num_keys = static_cast<int>(state.range(1));
+    auto order = shuffled(num_keys);
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto env = std::make_unique<IndexEnv>(col, num_keys);
+        state.ResumeTiming();
+        env->insert_all(order);
+        state.PauseTiming();
+        env.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * num_keys);
+}
+
+/**
+ * 在num_keys个键的索引中随机点查。args: {键类型, 键数}
+ */
+void BM_BPlusTreeGetValue(benchmark::State &state) {
+    const ColMeta &col = KEY_COLS[state.range(0)];
+    int num_keys = static_cast<int>(state.range(1));
+    IndexEnv env(col, num_keys);
+    auto order = shuffled(num_keys);
+    env.insert_all(order);
+    std::vector<Rid> rids;
+    size_t i = 0;
+    for (auto _ : state) {
+        rids.clear();
+        env.ih()->get_value(env.key(order[i++ % order.size()]), &rids, env.txn());
+        benchmark::DoNotOptimize(rids.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 从随机的键开始顺序扫描SCAN_LENGTH个索引项。args: {键类型, 键数}
+ */
+void BM_BPlusTreeRangeScan(benchmark::State &state) {
+    const ColMeta &col = KEY_COLS[state.range(0)];
+    int num_keys = static_cast<int>(state.range(1));
+    IndexEnv env(col, num_keys);
+    auto order = shuffled(num_keys);
+    env.insert_all(order);
+    size_t i = 0;
+    int64_t scanned = 0;
+    for (auto _ : state) {
+        Iid lower = env.ih()->lower_bound(env.key(order[i++ % order.size()]));
+        IxScan scan(env.ih(), lower, env.ih()->leaf_end(), env.bpm(), false, SCAN_LENGTH);
+        for (; !scan.is_end(); scan.next()) {
+            benchmark::DoNotOptimize(scan.rid());
+            scanned++;
+        }
+    }
+    state.SetItemsProcessed(scanned);
+}
+
+// 键类型：0 INT，1 FLOAT，2 CHAR(16)，3 CHAR(64)
+void key_args(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"key_type", "keys"});
+    for (int64_t key_type = 0; key_type < static_cast<int64_t>(KEY_COLS.size()); key_type++) {
+        for (int64_t num_keys : {10000, 100000}) {
+            b->Args({key_type, num_keys});
+        }
+    }
+}
+
+BENCHMARK(BM_BPlusTreeInsert)->Apply(key_args)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_BPlusTreeGetValue)->Apply(key_args);
+BENCHMARK(BM_BPlusTreeRangeScan)->Apply(key_args);
+
+}  // namespace
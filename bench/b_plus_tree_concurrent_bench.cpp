@@ -0,0 +1,176 @@
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "bench_util.h"
+#include "benchmark/benchmark.h"
+#include "common/metrics.h"
+#include "index/ix.h"
+#include "zipfian.h"
+
+namespace {
+
+const std::string TAB_NAME = "bench";
+constexpr size_t BENCH_BUFFER_POOL_SIZE = 16384;
+constexpr int NUM_PRELOAD_KEYS = 200000;
+constexpr int RANDOM_KEY_SPACE = 1 << 29;
+const ColMeta KEY_COL = {.tab_name = TAB_NAME, .name = "k", .type = TYPE_INT, .len = 4, .offset = 0};
+
+// 负载：查找的百分比，其余为插入
+enum Workload { LOOKUP_HEAVY, MIXED, INSERT_HEAVY };
+constexpr int LOOKUP_PERCENT[] = {95, 50, 10};
+
+// 键的分布
+enum Distribution { SEQUENTIAL, RANDOM, ZIPFIAN };
+
+// 报告的锁竞争计数器，取计时循环前后的差值
+struct ContentionCounter {
+    const char *name;
+    Counter EngineMetrics::*counter;
+};
+const ContentionCounter CONTENTION_COUNTERS[] = {
+    {"latch_waits", &EngineMetrics::index_latch_waits},
+    {"optimistic_retries", &EngineMetrics::index_optimistic_retries},
+    {"optimistic_fallbacks", &EngineMetrics::index_optimistic_fallbacks},
+    {"pessimistic_descents", &EngineMetrics::index_pessimistic_descents},
+};
+
+/**
+ * 所有线程共享的B+树索引，预先插入偶数键0, 2, ..., 2 * (NUM_PRELOAD_KEYS - 1)，由0号线程在计时循环之前创建、之后销毁。
+ * 查找只访问预先插入的键；插入使用奇数键或者预先插入范围之后的键，不与查找的键重复
+ */
+struct IndexEnv {
+    std::unique_ptr<DiskManager> disk_manager;
+    std::unique_ptr<BenchDir> dir;
+    std::unique_ptr<BufferPoolManager> bpm;
+    std::unique_ptr<IxManager> ix_manager;
+    std::unique_ptr<IxIndexHandle> ih;
+    ScrambledZipfian zipf{NUM_PRELOAD_KEYS, 0.99};
+    std::atomic<int> next_append{2 * NUM_PRELOAD_KEYS};  // 顺序插入的下一个键，所有线程都在最右边的叶子上插入
+    uint64_t counters_before[std::size(CONTENTION_COUNTERS)] = {};
+
+    explicit IndexEnv(bool optimistic) {
+        disk_manager = std::make_unique<DiskManager>();
+        dir = std::make_unique<BenchDir>(disk_manager.get(), "b_plus_tree_concurrent_bench_db");
+        bpm = std::make_unique<BufferPoolManager>(BENCH_BUFFER_POOL_SIZE, disk_manager.get());
+        ix_manager = std::make_unique<IxManager>(disk_manager.get(), bpm.get());
+        ix_manager->create_index(TAB_NAME, {KEY_COL});
+        ih = ix_manager->open_index(TAB_NAME, std::vector<ColMeta>{KEY_COL});
+        ih->set_optimistic_read(optimistic);
+        for (int i = 0; i < NUM_PRELOAD_KEYS; i++) {
+            int key = 2 * i;
+            ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{0, i}, nullptr);
+        }
+        auto &metrics = EngineMetrics::get();
+        for (size_t i = 0; i < std::size(CONTENTION_COUNTERS); i++) {
+            counters_before[i] = (metrics.*CONTENTION_COUNTERS[i].counter).value();
+        }
+    }
+
+    ~IndexEnv() {
+        ix_manager->close_index(ih.get());
+        ih.reset();
+        bpm.reset();
+        dir.reset();
+    }
+};
+
+IndexEnv *env = nullptr;
+
+/**
+ * 每个线程产生的键。顺序分布下各线程从预先插入的键中不同的位置开始依次查找，插入时共用一个递增的键
+ */
+class KeyGenerator {
+   public:
+    KeyGenerator(Distribution dist, int thread_index, int num_threads)
+        : dist_(dist), rng_(static_cast<uint64_t>(thread_index) + 1),
+          cursor_(static_cast<int64_t>(NUM_PRELOAD_KEYS) / num_threads * thread_index) {}
+
+    int lookup_key() { return 2 * static_cast<int>(next_rank()); }
+
+    int insert_key() {
+        switch (dist_) {
+            case SEQUENTIAL:
+                return env->next_append.fetch_add(1, std::memory_order_relaxed);
+            case RANDOM:
+                return 2 * std::uniform_int_distribution<int>(0, RANDOM_KEY_SPACE - 1)(rng_) + 1;
+            default:
+                // 插入在热点键的旁边，与查找竞争同一批叶子
+                return 2 * static_cast<int>(env->zipf.next(rng_)) + 1;
+        }
+    }
+
+    bool is_lookup(int lookup_percent) { return std::uniform_int_distribution<int>(0, 99)(rng_) < lookup_percent; }
+
+   private:
+    int64_t next_rank() {
+        switch (dist_) {
+            case SEQUENTIAL:
+                return cursor_++ % NUM_PRELOAD_KEYS;
+            case RANDOM:
+                return std::uniform_int_distribution<int64_t>(0, NUM_PRELOAD_KEYS - 1)(rng_);
+            default:
+                return env->zipf.next(rng_);
+        }
+    }
+
+    Distribution dist_;
+    std::mt19937_64 rng_;
+    int64_t cursor_;
+};
+
+/**
+ * 多线程在同一个索引上查找和插入，报告总吞吐量(items_per_second)以及锁等待、乐观读重试和回退、悲观下降的次数。
+ * args: {负载, 键的分布, 是否乐观读}，线程数为1到32
+ */
+void BM_BPlusTreeConcurrent(benchmark::State &state) {
+    auto workload = static_cast<Workload>(state.range(0));
+    auto dist = static_cast<Distribution>(state.range(1));
+    if (state.thread_index() == 0) {
+        env = new IndexEnv(state.range(2) != 0);
+    }
+    KeyGenerator keys(dist, state.thread_index(), state.threads());
+    std::vector<Rid> rids;
+    int lookup_percent = LOOKUP_PERCENT[workload];
+    for (auto _ : state) {
+        if (keys.is_lookup(lookup_percent)) {
+            int key = keys.lookup_key();
+            rids.clear();
+            env->ih->get_value(reinterpret_cast<const char *>(&key), &rids, nullptr);
+            benchmark::DoNotOptimize(rids.data());
+        } else {
+            int key = keys.insert_key();
+            env->ih->insert_entry(reinterpret_cast<const char *>(&key), Rid{1, key}, nullptr);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        auto &metrics = EngineMetrics::get();
+        for (size_t i = 0; i < std::size(CONTENTION_COUNTERS); i++) {
+            uint64_t delta = (metrics.*CONTENTION_COUNTERS[i].counter).value() - env->counters_before[i];
+            state.counters[CONTENTION_COUNTERS[i].name] = static_cast<double>(delta);
+        }
+        delete env;
+        env = nullptr;
+    }
+}
+
+void concurrent_args(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"workload", "dist", "optimistic"});
+    for (int64_t workload : {LOOKUP_HEAVY, MIXED, INSERT_HEAVY}) {
+        for (int64_t dist : {SEQUENTIAL, RANDOM, ZIPFIAN}) {
+            for (int64_t optimistic : {1, 0}) {
+                b->Args({workload, dist, optimistic});
+            }
+        }
+    }
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        b->Threads(threads);
+    }
+}
+
+// 负载：0 查找95%，1 查找50%，2 插入90%；分布：0 顺序，1 均匀随机，2 zipfian(theta = 0.99)
+BENCHMARK(BM_BPlusTreeConcurrent)->Apply(concurrent_args)->UseRealTime()->MinTime(0.5);
+
+}  // namespace
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <string>
+
+#include "errors.h"
+#include "storage/disk_manager.h"
+
+/**
+ * 基准测试的工作目录：构造时创建(已存在则先删除)并进入，析构时返回上一层并删除
+ */
+class BenchDir {
+   public:
+    BenchDir(DiskManager *disk_manager, std::string name) : disk_manager_(disk_manager), name_(std::move(name)) {
+        if (disk_manager_->is_dir(name_)) {
+            disk_manager_->destroy_dir(name_);
+        }
+        disk_manager_->create_dir(name_);
+        if (chdir(name_.c_str()) < 0) {
+            throw UnixError();
+        }
+    }
+
+    ~BenchDir() {
+        if (chdir("..") == 0) {
+            disk_manager_->destroy_dir(name_);
+        }
+    }
+
+   private:
+    DiskManager *disk_manager_;
+    std::string name_;
+};
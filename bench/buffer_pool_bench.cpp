@@ -0,0 +1,106 @@
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "bench_util.h"
+#include "benchmark/benchmark.h"
+#include "storage/buffer_pool_manager.h"
+
+namespace {
+
+/**
+ * 所有线程共享的缓冲池和数据文件，由0号线程在计时循环之前创建、之后销毁
+ */
+struct PoolEnv {
+    std::unique_ptr<DiskManager> disk_manager;
+    std::unique_ptr<BenchDir> dir;
+    std::unique_ptr<BufferPoolManager> bpm;
+    int fd = -1;
+    int num_pages = 0;
+
+    PoolEnv(size_t pool_size, int num_pages_) : num_pages(num_pages_) {
+        disk_manager = std::make_unique<DiskManager>();
+        dir = std::make_unique<BenchDir>(disk_manager.get(), "buffer_pool_bench_db");
+        disk_manager->create_file("data");
+        fd = disk_manager->open_file("data");
+        char buf[PAGE_SIZE];
+        for (int page_no = 0; page_no < num_pages; page_no++) {
+            memset(buf, 0, PAGE_SIZE);
+            memcpy(buf, &page_no, sizeof(page_no));
+            disk_manager->write_page(fd, page_no, buf, PAGE_SIZE);
+        }
+        disk_manager->set_fd2pageno(fd, num_pages);
+        bpm = std::make_unique<BufferPoolManager>(pool_size, disk_manager.get());
+    }
+
+    ~PoolEnv() {
+        bpm->flush_all_pages(fd);
+        bpm.reset();
+        disk_manager->close_file(fd);
+        dir.reset();
+    }
+};
+
+PoolEnv *env = nullptr;
+
+/**
+ * 每个线程随机fetch并unpin页面。args: {缓冲池帧数, 文件页面数}，
+ * 页面数不超过帧数时预热后全部命中，远大于帧数时大部分访问需要换出页面并读盘
+ */
+void BM_BufferPoolFetch(benchmark::State &state) {
+    size_t pool_size = static_cast<size_t>(state.range(0));
+    int num_pages = static_cast<int>(state.range(1));
+    if (state.thread_index() == 0) {
+        env = new PoolEnv(pool_size, num_pages);
+        // 预热：命中场景中所有页面都在缓冲池中
+        for (int page_no = 0; page_no < std::min<int>(num_pages, pool_size); page_no++) {
+            Page *page = env->bpm->fetch_page(PageId{env->fd, page_no});
+            env->bpm->unpin_page(page->get_page_id(), false);
+        }
+    }
+    std::mt19937 rng(static_cast<unsigned>(state.thread_index()) + 1);
+    std::uniform_int_distribution<int> dist(0, num_pages - 1);
+    for (auto _ : state) {
+        PageId page_id{env->fd, dist(rng)};
+        Page *page = env->bpm->fetch_page(page_id);
+        if (page == nullptr) {
+            state.SkipWithError("buffer pool is full");
+            break;
+        }
+        benchmark::DoNotOptimize(page->get_data()[0]);
+        env->bpm->unpin_page(page_id, false);
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) {
+        delete env;
+        env = nullptr;
+    }
+}
+
+BENCHMARK(BM_BufferPoolFetch)
+    ->ArgNames({"frames", "pages"})
+    ->Args({1024, 512})      // 全部命中
+    ->Args({256, 4096})      // 大部分缺页
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+/**
+ * 单线程分配新页面再unpin，测量new_page在缓冲池满时换出脏页的开销。args: {缓冲池帧数}
+ */
+void BM_BufferPoolNewPage(benchmark::State &state) {
+    PoolEnv pool(static_cast<size_t>(state.range(0)), 0);
+    for (auto _ : state) {
+        PageId page_id{pool.fd, INVALID_PAGE_ID};
+        Page *page = pool.bpm->new_page(&page_id);
+        if (page == nullptr) {
+            state.SkipWithError("buffer pool is full");
+            break;
+        }
+        pool.bpm->unpin_page(page_id, true);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_BufferPoolNewPage)->ArgName("frames")->Arg(256)->Arg(4096);
+
+}  // namespace
@@ -0,0 +1,64 @@
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "replacer/clock_replacer.h"
+#include "replacer/lru_replacer.h"
+#include "replacer/two_queue_replacer.h"
+
+namespace {
+
+/**
+ * 所有帧都可换出时，反复换出一个帧再把它放回，即缓冲池缺页时victim + unpin的路径。args: {帧数}
+ */
+template <typename ReplacerType>
+void BM_ReplacerVictim(benchmark::State &state) {
+    size_t num_frames = static_cast<size_t>(state.range(0));
+    ReplacerType replacer(num_frames);
+    for (size_t i = 0; i < num_frames; i++) {
+        replacer.unpin(static_cast<frame_id_t>(i));
+    }
+    frame_id_t frame_id;
+    for (auto _ : state) {
+        replacer.victim(&frame_id);
+        replacer.unpin(frame_id);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * 随机访问已经在replacer中的帧：record_access + pin + unpin，即缓冲池命中时的路径。args: {帧数}
+ */
+template <typename ReplacerType>
+void BM_ReplacerPinUnpin(benchmark::State &state) {
+    size_t num_frames = static_cast<size_t>(state.range(0));
+    ReplacerType replacer(num_frames);
+    for (size_t i = 0; i < num_frames; i++) {
+        replacer.unpin(static_cast<frame_id_t>(i));
+    }
+    // 预先生成访问序列，不把随机数的开销计入
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<frame_id_t> dist(0, static_cast<frame_id_t>(num_frames) - 1);
+    std::vector<frame_id_t> frames(4096);
+    for (auto &frame_id : frames) {
+        frame_id = dist(rng);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        frame_id_t frame_id = frames[i++ % frames.size()];
+        replacer.record_access(frame_id, AccessType::Normal);
+        replacer.pin(frame_id);
+        replacer.unpin(frame_id);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+#define REPLACER_BENCHMARKS(ReplacerType)                                                            \
+    BENCHMARK_TEMPLATE(BM_ReplacerVictim, ReplacerType)->ArgName("frames")->Range(64, 64 << 10);   \
+    BENCHMARK_TEMPLATE(BM_ReplacerPinUnpin, ReplacerType)->ArgName("frames")->Range(64, 64 << 10);
+
+REPLACER_BENCHMARKS(LRUReplacer)
+REPLACER_BENCHMARKS(ClockReplacer)
+REPLACER_BENCHMARKS(TwoQueueReplacer)
+
+}  // namespace
@@ -0,0 +1,90 @@
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "bench_util.h"
+#include "benchmark/benchmark.h"
+#include "record/rm.h"
+
+namespace {
+
+constexpr size_t BENCH_BUFFER_POOL_SIZE = 4096;
+
+/**
+ * 一个记录文件及其缓冲池
+ */
+class RecordEnv {
+   public:
+    explicit RecordEnv(int record_size) : record_size_(record_size) {
+        disk_manager_ = std::make_unique<DiskManager>();
+        dir_ = std::make_unique<BenchDir>(disk_manager_.get(), "rm_file_bench_db");
+        bpm_ = std::make_unique<BufferPoolManager>(BENCH_BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), bpm_.get());
+        rm_manager_->create_file("table", record_size_);
+        fh_ = rm_manager_->open_file("table");
+    }
+
+    ~RecordEnv() {
+        rm_manager_->close_file(fh_.get());
+        fh_.reset();
+        bpm_.reset();
+        dir_.reset();
+    }
+
+    RmFileHandle *fh() { return fh_.get(); }
+
+   private:
+    int record_size_;
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BenchDir> dir_;
+    std::unique_ptr<BufferPoolManager> bpm_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<RmFileHandle> fh_;
+};
+
+/**
+ * 逐条插入记录，文件随迭代增长。args: {记录长度}
+ */
+void BM_RmInsert(benchmark::State &state) {
+    int record_size = static_cast<int>(state.range(0));
+    RecordEnv env(record_size);
+    std::vector<char> buf(record_size, 'x');
+    int64_t i = 0;
+    for (auto _ : state) {
+        memcpy(buf.data(), &i, sizeof(i));
+        benchmark::DoNotOptimize(env.fh()->insert_record(buf.data(), nullptr));
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * record_size);
+}
+
+/**
+ * 顺序扫描num_records条记录的文件，读取每条记录的数据。args: {记录长度, 记录数}
+ */
+void BM_RmScan(benchmark::State &state) {
+    int record_size = static_cast<int>(state.range(0));
+    int64_t num_records = state.range(1);
+    RecordEnv env(record_size);
+    std::vector<char> buf(record_size, 'x');
+    for (int64_t i = 0; i < num_records; i++) {
+        memcpy(buf.data(), &i, sizeof(i));
+        env.fh()->insert_record(buf.data(), nullptr);
+    }
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (RmScan scan(env.fh()); !scan.is_end(); scan.next()) {
+            int64_t v;
+            memcpy(&v, scan.record(), sizeof(v));
+            sum += v;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * num_records);
+    state.SetBytesProcessed(state.iterations() * num_records * record_size);
+}
+
+BENCHMARK(BM_RmInsert)->ArgName("record_size")->Arg(16)->Arg(64)->Arg(256);
+BENCHMARK(BM_RmScan)->ArgNames({"record_size", "records"})->ArgsProduct({{16, 64, 256}, {100000}});
+
+}  // namespace
@@ -0,0 +1,603 @@
+/**
+ * 端到端负载生成器：通过unibase的socket协议(默认端口8765)发送SQL，用多个并发连接运行
+ * YCSB(读/更新混合，zipfian分布的key)或简化的TPC-C(NewOrder/Payment)，报告吞吐量和p50/p99/p999延迟。
+ *
+ * 用法：workload_driver [选项]
+ *   --host=127.0.0.1 --port=8765    服务器地址
+ *   --workload=ycsb|tpcc            负载类型，默认ycsb
+ *   --load                          先建表并导入初始数据
+ *   --connections=8                 并发连接数
+ *   --duration=30 --warmup=5        测量时长和预热时长(秒)，预热期间的事务不计入结果
+ *   --seed=1                        随机数种子
+ *   YCSB:  --records=100000 --read-ratio=0.5 --zipf-theta=0.99 --field-len=100
+ *   TPC-C: --warehouses=1 --customers=300 --items=10000 --new-order-ratio=0.5
+ */
+#include <arpa/inet.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "zipfian.h"
+
+namespace {
+
+constexpr int DEFAULT_PORT = 8765;          // 与unibase.cpp中的SOCK_PORT一致
+constexpr size_t MAX_STMT_LENGTH = BUFFER_LENGTH / 2;   // 批量插入的一条语句不超过服务器接收缓冲区的一半
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = DEFAULT_PORT;
+    std::string workload = "ycsb";
+    bool load = false;
+    int connections = 8;
+    int duration = 30;
+    int warmup = 5;
+    uint64_t seed = 1;
+    // YCSB
+    int64_t records = 100000;
+    double read_ratio = 0.5;
+    double zipf_theta = 0.99;
+    int field_len = 100;
+    // TPC-C
+    int warehouses = 1;
+    int customers = 300;    // 每个district的customer数
+    int items = 10000;
+    double new_order_ratio = 0.5;
+};
+
+/**
+ * 语句执行的结果：服务器回滚了事务时返回"abort"，出错时返回以"Error"开头的信息
+ */
+enum class Status { OK, ABORT, ERROR };
+
+/**
+ * 一个到服务器的连接。每条语句的结果由若干帧组成：4字节网络字节序的长度，后接长度个字节，以长度为0的帧结束
+ */
+class Client {
+   public:
+    Client(const std::string &host, int port) {
+        struct addrinfo hints {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo *res = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+            throw std::runtime_error("cannot resolve " + host);
+        }
+        fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd_ == -1 || connect(fd_, res->ai_addr, res->ai_addrlen) == -1) {
+            freeaddrinfo(res);
+            throw std::runtime_error("cannot connect to " + host + ":" + std::to_string(port));
+        }
+        freeaddrinfo(res);
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    ~Client() {
+        if (fd_ != -1) {
+            // 通知服务器关闭会话，失败时直接关闭连接
+            ssize_t n = write(fd_, "exit;", 5);
+            (void)n;
+            close(fd_);
+        }
+    }
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    // 执行一条语句(不含末尾的分号)，结果文本写入result
+    Status execute(const std::string &sql, std::string *result = nullptr) {
+        std::string request = sql + ";";
+        write_all(request.data(), request.size());
+        std::string text;
+        while (true) {
+            uint32_t header;
+            read_all(reinterpret_cast<char *>(&header), sizeof(header));
+            uint32_t len = ntohl(header);
+            if (len == 0) {
+                break;
+            }
+            size_t pos = text.size();
+            text.resize(pos + len);
+            read_all(text.data() + pos, len);
+        }
+        Status status = Status::OK;
+        if (text.compare(0, 5, "abort") == 0) {
+            status = Status::ABORT;
+        } else if (text.compare(0, 5, "Error") == 0) {
+            status = Status::ERROR;
+        }
+        if (result != nullptr) {
+            *result = std::move(text);
+        }
+        return status;
+    }
+
+   private:
+    void write_all(const char *data, size_t len) {
+        while (len > 0) {
+            ssize_t n = write(fd_, data, len);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("write to server failed");
+            }
+            data += n;
+            len -= n;
+        }
+    }
+
+    void read_all(char *data, size_t len) {
+        while (len > 0) {
+            ssize_t n = read(fd_, data, len);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("connection closed by server");
+            }
+            data += n;
+            len -= n;
+        }
+    }
+
+    int fd_ = -1;
+};
+
+/**
+ * 从文本格式的select结果中取出第一行记录的各个字段。结果依次为分隔线、表头、分隔线和记录行，
+ * 记录行形如"| v1 | v2 |"
+ */
+bool first_row(const std::string &text, std::vector<std::string> *values) {
+    int row = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        if (text[pos] == '|' && ++row == 2) {
+            values->clear();
+            size_t cell = pos + 1;
+            while (cell < end) {
+                size_t next = text.find('|', cell);
+                if (next == std::string::npos || next > end) {
+                    break;
+                }
+                std::string value = text.substr(cell, next - cell);
+                size_t b = value.find_first_not_of(' ');
+                size_t e = value.find_last_not_of(' ');
+                values->push_back(b == std::string::npos ? "" : value.substr(b, e - b + 1));
+                cell = next + 1;
+            }
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+/**
+ * 把多行VALUES合并为不超过MAX_STMT_LENGTH的INSERT语句执行，最后需要调用flush()执行剩余的行
+ */
+class BatchInserter {
+   public:
+    BatchInserter(Client *client, std::string table) : client_(client), prefix_("insert into " + table + " values ") {}
+
+    void add(const std::string &row) {
+        if (!sql_.empty() && sql_.size() + row.size() + 1 > MAX_STMT_LENGTH) {
+            flush();
+        }
+        sql_ += sql_.empty() ? prefix_ : ", ";
+        sql_ += row;
+    }
+
+    void flush() {
+        if (sql_.empty()) {
+            return;
+        }
+        std::string result;
+        if (client_->execute(sql_, &result) != Status::OK) {
+            throw std::runtime_error("load failed: " + result);
+        }
+        sql_.clear();
+    }
+
+   private:
+    Client *client_;
+    std::string prefix_;
+    std::string sql_;
+};
+
+void execute_ddl(Client *client, const std::string &sql) {
+    std::string result;
+    if (client->execute(sql, &result) != Status::OK) {
+        throw std::runtime_error(sql + ": " + result);
+    }
+}
+
+/**
+ * 一种负载：load()建表并导入数据，run_txn()在一个连接上执行一个事务
+ */
+class Workload {
+   public:
+    virtual ~Workload() = default;
+
+    virtual void load(Client *client) = 0;
+
+    virtual Status run_txn(Client *client, std::mt19937_64 &rng) = 0;
+};
+
+/**
+ * YCSB：usertable(ycsb_key, field0)，每个事务是一次按key的读或更新
+ */
+class YcsbWorkload : public Workload {
+   public:
+    explicit YcsbWorkload(const Options &opts)
+        : opts_(opts), zipf_(opts.records, opts.zipf_theta), value_(opts.field_len, 'x') {}
+
+    void load(Client *client) override {
+        execute_ddl(client, "create table usertable (ycsb_key int, field0 char(" + std::to_string(opts_.field_len) + "))");
+        execute_ddl(client, "create index usertable (ycsb_key)");
+        BatchInserter inserter(client, "usertable");
+        for (int64_t key = 0; key < opts_.records; key++) {
+            inserter.add("(" + std::to_string(key) + ", '" + value_ + "')");
+        }
+        inserter.flush();
+    }
+
+    Status run_txn(Client *client, std::mt19937_64 &rng) override {
+        int64_t key = zipf_.next(rng);
+        if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < opts_.read_ratio) {
+            return client->execute("select * from usertable where ycsb_key = " + std::to_string(key));
+        }
+        char c = static_cast<char>('a' + rng() % 26);
+        return client->execute("update usertable set field0 = '" + std::string(opts_.field_len, c) +
+                               "' where ycsb_key = " + std::to_string(key));
+    }
+
+   private:
+    const Options &opts_;
+    ScrambledZipfian zipf_;
+    std::string value_;
+};
+
+/**
+ * 简化的TPC-C：只保留NewOrder和Payment两种事务及它们访问的字段，
+ * 每个warehouse有10个district，计算列在客户端完成(UPDATE只支持常量)
+ */
+class TpccWorkload : public Workload {
+   public:
+    static constexpr int DISTRICTS = 10;
+
+    explicit TpccWorkload(const Options &opts) : opts_(opts) {}
+
+    void load(Client *client) override {
+        execute_ddl(client, "create table warehouse (w_id int, w_tax float, w_ytd float)");
+        execute_ddl(client, "create table district (d_w_id int, d_id int, d_tax float, d_ytd float, d_next_o_id int)");
+        execute_ddl(client, "create table customer (c_w_id int, c_d_id int, c_id int, c_discount float, "
+                            "c_balance float, c_payment_cnt int)");
+        execute_ddl(client, "create table item (i_id int, i_price float)");
+        execute_ddl(client, "create table stock (s_w_id int, s_i_id int, s_quantity int)");
+        execute_ddl(client, "create table orders (o_w_id int, o_d_id int, o_id int, o_c_id int, o_ol_cnt int)");
+        execute_ddl(client, "create table order_line (ol_w_id int, ol_d_id int, ol_o_id int, ol_number int, "
+                            "ol_i_id int, ol_quantity int, ol_amount float)");
+        execute_ddl(client, "create index warehouse (w_id)");
+        execute_ddl(client, "create index district (d_w_id, d_id)");
+        execute_ddl(client, "create index customer (c_w_id, c_d_id, c_id)");
+        execute_ddl(client, "create index item (i_id)");
+        execute_ddl(client, "create index stock (s_w_id, s_i_id)");
+
+        std::mt19937_64 rng(opts_.seed);
+        {
+            BatchInserter items(client, "item");
+            for (int i = 1; i <= opts_.items; i++) {
+                items.add("(" + std::to_string(i) + ", " + std::to_string(1 + rng() % 100) + ".0)");
+            }
+            items.flush();
+        }
+        for (int w = 1; w <= opts_.warehouses; w++) {
+            execute_ddl(client, "insert into warehouse values (" + std::to_string(w) + ", 0.1, 300000.0)");
+            BatchInserter districts(client, "district");
+            BatchInserter customers(client, "customer");
+            BatchInserter stock(client, "stock");
+            for (int d = 1; d <= DISTRICTS; d++) {
+                districts.add("(" + std::to_string(w) + ", " + std::to_string(d) + ", 0.1, 30000.0, 1)");
+                for (int c = 1; c <= opts_.customers; c++) {
+                    customers.add("(" + std::to_string(w) + ", " + std::to_string(d) + ", " + std::to_string(c) +
+                                  ", 0.05, -10.0, 1)");
+                }
+            }
+            for (int i = 1; i <= opts_.items; i++) {
+                stock.add("(" + std::to_string(w) + ", " + std::to_string(i) + ", " +
+                          std::to_string(10 + rng() % 91) + ")");
+            }
+            districts.flush();
+            customers.flush();
+            stock.flush();
+        }
+    }
+
+    Status run_txn(Client *client, std::mt19937_64 &rng) override {
+        int w = 1 + static_cast<int>(rng() % opts_.warehouses);
+        int d = 1 + static_cast<int>(rng() % DISTRICTS);
+        int c = 1 + static_cast<int>(rng() % opts_.customers);
+        Status status = client->execute("begin");
+        if (status == Status::OK) {
+            if (std::uniform_real_distribution<double>(0.0, 1.0)(rng) < opts_.new_order_ratio) {
+                status = new_order(client, rng, w, d, c);
+            } else {
+                status = payment(client, rng, w, d, c);
+            }
+        }
+        if (status == Status::OK) {
+            status = client->execute("commit");
+        }
+        // 服务器在返回abort时已经回滚了事务，其他错误需要客户端回滚
+        if (status == Status::ERROR) {
+            client->execute("abort");
+        }
+        return status;
+    }
+
+   private:
+    // 执行select并取出第一行记录，没有记录时视为错误
+    static Status select_row(Client *client, const std::string &sql, std::vector<std::string> *row) {
+        std::string result;
+        Status status = client->execute(sql, &result);
+        if (status == Status::OK && !first_row(result, row)) {
+            status = Status::ERROR;
+        }
+        return status;
+    }
+
+#define TPCC_CHECK(expr)             \
+    do {                             \
+        Status s_ = (expr);          \
+        if (s_ != Status::OK) {      \
+            return s_;               \
+        }                            \
+    } while (0)
+
+    Status new_order(Client *client, std::mt19937_64 &rng, int w, int d, int c) {
+        std::string wd = std::to_string(w) + " and d_id = " + std::to_string(d);
+        std::vector<std::string> row;
+        TPCC_CHECK(select_row(client, "select w_tax from warehouse where w_id = " + std::to_string(w), &row));
+        TPCC_CHECK(select_row(client, "select d_tax, d_next_o_id from district where d_w_id = " + wd, &row));
+        int o_id = std::stoi(row[1]);
+        TPCC_CHECK(client->execute("update district set d_next_o_id = " + std::to_string(o_id + 1) +
+                                   " where d_w_id = " + wd));
+        TPCC_CHECK(select_row(client, "select c_discount from customer where c_w_id = " + std::to_string(w) +
+                                          " and c_d_id = " + std::to_string(d) + " and c_id = " + std::to_string(c),
+                              &row));
+        int ol_cnt = 5 + static_cast<int>(rng() % 11);
+        std::string key = std::to_string(w) + ", " + std::to_string(d) + ", " + std::to_string(o_id);
+        TPCC_CHECK(client->execute("insert into orders values (" + key + ", " + std::to_string(c) + ", " +
+                                   std::to_string(ol_cnt) + ")"));
+        for (int ol = 1; ol <= ol_cnt; ol++) {
+            int i = 1 + static_cast<int>(rng() % opts_.items);
+            int quantity = 1 + static_cast<int>(rng() % 10);
+            TPCC_CHECK(select_row(client, "select i_price from item where i_id = " + std::to_string(i), &row));
+            double amount = std::stod(row[0]) * quantity;
+            std::string stock_key = std::to_string(w) + " and s_i_id = " + std::to_string(i);
+            TPCC_CHECK(select_row(client, "select s_quantity from stock where s_w_id = " + stock_key, &row));
+            int s_quantity = std::stoi(row[0]);
+            s_quantity = s_quantity >= quantity + 10 ? s_quantity - quantity : s_quantity - quantity + 91;
+            TPCC_CHECK(client->execute("update stock set s_quantity = " + std::to_string(s_quantity) +
+                                       " where s_w_id = " + stock_key));
+            TPCC_CHECK(client->execute("insert into order_line values (" + key + ", " + std::to_string(ol) + ", " +
+                                       std::to_string(i) + ", " + std::to_string(quantity) + ", " +
+                                       std::to_string(amount) + ")"));
+        }
+        return Status::OK;
+    }
+
+    Status payment(Client *client, std::mt19937_64 &rng, int w, int d, int c) {
+        double amount = 1 + static_cast<double>(rng() % 500000) / 100;
+        std::vector<std::string> row;
+        std::string w_key = std::to_string(w);
+        TPCC_CHECK(select_row(client, "select w_ytd from warehouse where w_id = " + w_key, &row));
+        TPCC_CHECK(client->execute("update warehouse set w_ytd = " + std::to_string(std::stod(row[0]) + amount) +
+                                   " where w_id = " + w_key));
+        std::string d_key = w_key + " and d_id = " + std::to_string(d);
+        TPCC_CHECK(select_row(client, "select d_ytd from district where d_w_id = " + d_key, &row));
+        TPCC_CHECK(client->execute("update district set d_ytd = " + std::to_string(std::stod(row[0]) + amount) +
+                                   " where d_w_id = " + d_key));
+        std::string c_key = w_key + " and c_d_id = " + std::to_string(d) + " and c_id = " + std::to_string(c);
+        TPCC_CHECK(select_row(client, "select c_balance, c_payment_cnt from customer where c_w_id = " + c_key, &row));
+        TPCC_CHECK(client->execute("update customer set c_balance = " + std::to_string(std::stod(row[0]) - amount) +
+                                   ", c_payment_cnt = " + std::to_string(std::stoi(row[1]) + 1) +
+                                   " where c_w_id = " + c_key));
+        return Status::OK;
+    }
+
+#undef TPCC_CHECK
+
+    const Options &opts_;
+};
+
+// 每个连接的统计，预热结束后才开始记录
+struct ThreadStats {
+    std::vector<int64_t> latencies_ns;  // 提交的事务的延迟
+    int64_t aborts = 0;
+    int64_t errors = 0;
+};
+
+int64_t percentile(const std::vector<int64_t> &sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t idx = static_cast<size_t>(std::ceil(p * sorted.size())) - 1;
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void usage(const char *prog) {
+    std::cerr << "Usage: " << prog
+              << " [--host=H] [--port=P] [--workload=ycsb|tpcc] [--load] [--connections=N]"
+                 " [--duration=S] [--warmup=S] [--seed=N]\n"
+                 "  ycsb: [--records=N] [--read-ratio=R] [--zipf-theta=T] [--field-len=N]\n"
+                 "  tpcc: [--warehouses=N] [--customers=N] [--items=N] [--new-order-ratio=R]\n";
+}
+
+bool parse_options(int argc, char **argv, Options *opts) {
+    static const struct option long_options[] = {
+        {"host", required_argument, nullptr, 'h'},
+        {"port", required_argument, nullptr, 'p'},
+        {"workload", required_argument, nullptr, 'w'},
+        {"load", no_argument, nullptr, 'l'},
+        {"connections", required_argument, nullptr, 'c'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"warmup", required_argument, nullptr, 'W'},
+        {"seed", required_argument, nullptr, 's'},
+        {"records", required_argument, nullptr, 'r'},
+        {"read-ratio", required_argument, nullptr, 'R'},
+        {"zipf-theta", required_argument, nullptr, 'z'},
+        {"field-len", required_argument, nullptr, 'f'},
+        {"warehouses", required_argument, nullptr, 'H'},
+        {"customers", required_argument, nullptr, 'C'},
+        {"items", required_argument, nullptr, 'i'},
+        {"new-order-ratio", required_argument, nullptr, 'n'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'h': opts->host = optarg; break;
+            case 'p': opts->port = std::atoi(optarg); break;
+            case 'w': opts->workload = optarg; break;
+            case 'l': opts->load = true; break;
+            case 'c': opts->connections = std::atoi(optarg); break;
+            case 'd': opts->duration = std::atoi(optarg); break;
+            case 'W': opts->warmup = std::atoi(optarg); break;
+            case 's': opts->seed = std::strtoull(optarg, nullptr, 10); break;
+            case 'r': opts->records = std::atoll(optarg); break;
+            case 'R': opts->read_ratio = std::atof(optarg); break;
+            case 'z': opts->zipf_theta = std::atof(optarg); break;
+            case 'f': opts->field_len = std::atoi(optarg); break;
+            case 'H': opts->warehouses = std::atoi(optarg); break;
+            case 'C': opts->customers = std::atoi(optarg); break;
+            case 'i': opts->items = std::atoi(optarg); break;
+            case 'n': opts->new_order_ratio = std::atof(optarg); break;
+            default: return false;
+        }
+    }
+    return (opts->workload == "ycsb" || opts->workload == "tpcc") && opts->connections > 0 && opts->duration > 0 &&
+           opts->records > 0 && opts->warehouses > 0 && opts->customers > 0 && opts->items > 0 &&
+           opts->zipf_theta > 0 && opts->zipf_theta < 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parse_options(argc, argv, &opts)) {
+        usage(argv[0]);
+        return 1;
+    }
+    std::unique_ptr<Workload> workload;
+    if (opts.workload == "ycsb") {
+        workload = std::make_unique<YcsbWorkload>(opts);
+    } else {
+        workload = std::make_unique<TpccWorkload>(opts);
+    }
+
+    try {
+        if (opts.load) {
+            auto start = std::chrono::steady_clock::now();
+            Client client(opts.host, opts.port);
+            workload->load(&client);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "Loaded " << opts.workload << " in " << elapsed.count() << "s" << std::endl;
+        }
+
+        // 所有连接建立后同时开始，预热结束时开始记录，测量结束时停止
+        std::vector<std::unique_ptr<Client>> clients;
+        for (int i = 0; i < opts.connections; i++) {
+            clients.push_back(std::make_unique<Client>(opts.host, opts.port));
+        }
+        std::vector<ThreadStats> stats(opts.connections);
+        std::atomic<bool> measuring{false};
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < opts.connections; i++) {
+            threads.emplace_back([&, i] {
+                std::mt19937_64 rng(opts.seed * 1000003 + i);
+                ThreadStats &s = stats[i];
+                try {
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        auto begin = std::chrono::steady_clock::now();
+                        Status status = workload->run_txn(clients[i].get(), rng);
+                        auto end = std::chrono::steady_clock::now();
+                        if (!measuring.load(std::memory_order_relaxed)) {
+                            continue;
+                        }
+                        if (status == Status::OK) {
+                            s.latencies_ns.push_back(
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+                        } else if (status == Status::ABORT) {
+                            s.aborts++;
+                        } else {
+                            s.errors++;
+                        }
+                    }
+                } catch (std::exception &e) {
+                    std::cerr << "connection " << i << ": " << e.what() << std::endl;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(opts.warmup));
+        measuring = true;
+        auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(opts.duration));
+        measuring = false;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        stop = true;
+        for (auto &t : threads) {
+            t.join();
+        }
+
+        std::vector<int64_t> latencies;
+        int64_t aborts = 0;
+        int64_t errors = 0;
+        for (auto &s : stats) {
+            latencies.insert(latencies.end(), s.latencies_ns.begin(), s.latencies_ns.end());
+            aborts += s.aborts;
+            errors += s.errors;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto us = [](int64_t ns) { return ns / 1000.0; };
+        printf("workload:    %s, %d connections, %ds\n", opts.workload.c_str(), opts.connections, opts.duration);
+        printf("committed:   %zu (%.1f txn/s)\n", latencies.size(), latencies.size() / elapsed.count());
+        printf("aborted:     %ld\n", static_cast<long>(aborts));
+        printf("errors:      %ld\n", static_cast<long>(errors));
+        printf("latency(us): p50 %.1f  p99 %.1f  p999 %.1f  max %.1f\n", us(percentile(latencies, 0.5)),
+               us(percentile(latencies, 0.99)), us(percentile(latencies, 0.999)),
+               us(latencies.empty() ? 0 : latencies.back()));
+    } catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
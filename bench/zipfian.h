@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+/**
+ * YCSB的zipfian分布(Gray等，"Quickly Generating Billion-Record Synthetic Databases")，
+ * 生成的序号再经过FNV哈希打散，热点key不集中在表的开头
+ */
+class ScrambledZipfian {
+   public:
+    ScrambledZipfian(int64_t n, double theta) : n_(n), theta_(theta) {
+        for (int64_t i = 1; i <= n_; i++) {
+            zetan_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+        }
+        double zeta2 = 1.0 + 1.0 / std::pow(2.0, theta_);
+        alpha_ = 1.0 / (1.0 - theta_);
+        eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta2 / zetan_);
+    }
+
+    int64_t next(std::mt19937_64 &rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan_;
+        int64_t rank;
+        if (uz < 1.0) {
+            rank = 0;
+        } else if (uz < 1.0 + std::pow(0.5, theta_)) {
+            rank = 1;
+        } else {
+            rank = static_cast<int64_t>(n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+        }
+        return static_cast<int64_t>(fnv_hash(static_cast<uint64_t>(std::min(rank, n_ - 1))) % n_);
+    }
+
+   private:
+    static uint64_t fnv_hash(uint64_t v) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (int i = 0; i < 8; i++) {
+            hash ^= v & 0xFF;
+            hash *= 0x100000001B3ULL;
+            v >>= 8;
+        }
+        return hash;
+    }
+
+    int64_t n_;
+    double theta_;
+    double zetan_ = 0;
+    double alpha_;
+    double eta_;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/memory_tracker.h"
+
+/*
+Arena是语句级的内存池，用于执行过程中生成的索引key等短生命周期的小块内存
+allocate()从当前块中顺序分配，块用完后再申请新块，分配出去的内存不单独释放，
+语句结束时随Arena析构或reset()统一回收，避免逐个new/delete以及忘记释放造成的泄漏
+申请的块记在tracker上，超过语句的内存上限时allocate()抛出QueryMemoryLimitError
+*/
+class Arena {
+   public:
+    explicit Arena(size_t block_size = ARENA_BLOCK_SIZE, MemoryTracker *tracker = nullptr)
+        : block_size_(block_size), tracker_(tracker) {}
+
+    ~Arena() { reset(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @description: 分配size字节的内存，按8字节对齐
+     * @return {char*} 分配的内存，有效期直到Arena析构或reset()
+     * @param {size_t} size 字节数
+     */
+    char *allocate(size_t size) {
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (size > remaining_) {
+            // 超过块大小的请求单独分配一块，不浪费当前块的剩余空间
+            if (size > block_size_ / 4) {
+                charge(size);
+                blocks_.push_back(std::make_unique<char[]>(size));
+                allocated_ += size;
+                return blocks_.back().get();
+            }
+            charge(block_size_);
+            blocks_.push_back(std::make_unique<char[]>(block_size_));
+            allocated_ += block_size_;
+            ptr_ = blocks_.back().get();
+            remaining_ = block_size_;
+        }
+        char *result = ptr_;
+        ptr_ += size;
+        remaining_ -= size;
+        return result;
+    }
+
+    /**
+     * @description: 释放所有已分配的内存
+     */
+    void reset() {
+        if (tracker_ != nullptr) {
+            tracker_->release(allocated_);
+        }
+        blocks_.clear();
+        ptr_ = nullptr;
+        remaining_ = 0;
+        allocated_ = 0;
+    }
+
+    /**
+     * @description: 当前向系统申请的内存总量
+     */
+    size_t memory_usage() const { return allocated_; }
+
+   private:
+    static constexpr size_t ALIGNMENT = 8;
+
+    void charge(size_t size) {
+        if (tracker_ != nullptr) {
+            tracker_->consume(size);
+        }
+    }
+
+    size_t block_size_;
+    MemoryTracker *tracker_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *ptr_ = nullptr;
+    size_t remaining_ = 0;
+    size_t allocated_ = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+BloomFilter是按缓存行分块的bloom filter(blocked bloom filter)，用于LSM表的sorted run和hash连接的运行时过滤器
+1. 位数组分为若干个64字节的块，每个块是8个64位的字。一个key的hash值的高32位选择一个块，
+   低32位分别乘以8个奇数常量后取高6位，在块的8个字中各置一位
+2. 一次查找只访问一个缓存行，没有数据依赖的8次位测试可以并行执行；代价是相同位数下误判率比普通bloom filter略高，
+   每个key 10位时约为1%
+3. 调用者负责计算64位的hash值，整数key可以用hash_u64()
+*/
+class BloomFilter {
+   public:
+    static constexpr size_t BLOCK_WORDS = 8;
+    static constexpr size_t BLOCK_BYTES = BLOCK_WORDS * sizeof(uint64_t);
+
+    BloomFilter() = default;
+
+    /**
+     * @description: 创建空的bloom filter
+     * @param {size_t} expected_keys 预计加入的key数
+     * @param {int} bits_per_key 每个key占用的位数
+     */
+    BloomFilter(size_t expected_keys, int bits_per_key)
+        : words_(num_blocks_for(expected_keys, bits_per_key) * BLOCK_WORDS, 0) {}
+
+    // 从serialize()的结果恢复，bytes必须是BLOCK_BYTES的整数倍
+    BloomFilter(const char *data, size_t bytes) : words_(bytes / sizeof(uint64_t)) {
+        memcpy(words_.data(), data, bytes);
+    }
+
+    static size_t num_blocks_for(size_t expected_keys, int bits_per_key) {
+        size_t bits = expected_keys * static_cast<size_t>(bits_per_key);
+        return bits / (BLOCK_BYTES * 8) + 1;
+    }
+
+    void add_hash(uint64_t hash) {
+        uint64_t *block = block_of(hash);
+        for (size_t i = 0; i < BLOCK_WORDS; i++) {
+            block[i] |= bit_of(hash, i);
+        }
+    }
+
+    bool may_contain_hash(uint64_t hash) const {
+        const uint64_t *block = block_of(hash);
+        bool found = true;
+        for (size_t i = 0; i < BLOCK_WORDS; i++) {
+            found &= (block[i] & bit_of(hash, i)) != 0;
+        }
+        return found;
+    }
+
+    void add(uint64_t key) { add_hash(hash_u64(key)); }
+
+    bool may_contain(uint64_t key) const { return may_contain_hash(hash_u64(key)); }
+
+    // 位数组，用于写入文件
+    const char *data() const { return reinterpret_cast<const char *>(words_.data()); }
+
+    size_t size_bytes() const { return words_.size() * sizeof(uint64_t); }
+
+    bool empty() const { return words_.empty(); }
+
+    // 整数key的hash值(splitmix64的最后一步)
+    static uint64_t hash_u64(uint64_t key) {
+        key += 0x9e3779b97f4a7c15ULL;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        return key ^ (key >> 31);
+    }
+
+   private:
+    // 高32位乘以块数取高32位，得到[0, 块数)中均匀分布的块号，不需要取模
+    uint64_t *block_of(uint64_t hash) {
+        size_t blocks = words_.size() / BLOCK_WORDS;
+        return words_.data() + ((hash >> 32) * blocks >> 32) * BLOCK_WORDS;
+    }
+
+    const uint64_t *block_of(uint64_t hash) const { return const_cast<BloomFilter *>(this)->block_of(hash); }
+
+    static uint64_t bit_of(uint64_t hash, size_t i) {
+        static constexpr uint32_t SALT[BLOCK_WORDS] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                       0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+        return uint64_t{1} << ((static_cast<uint32_t>(hash) * SALT[i]) >> 26);
+    }
+
+    std::vector<uint64_t> words_;
+};
@@ -28,6 +28,8 @@ struct Value {
 
     std::shared_ptr<RmRecord> raw;  // raw record buffer
 
+    int param = -1;  // 预编译语句中参数$n的下标n-1，执行时绑定为实际的值；-1表示不是参数
+
     void set_int(int int_val_) {
         type = TYPE_INT;
         int_val = int_val_;
@@ -43,9 +45,10 @@ struct Value {
         str_val = std::move(str_val_);
     }
 
-    void init_raw(int len) {
+    // arena不为空时raw的数据从语句的内存池中分配
+    void init_raw(int len, Arena *arena = nullptr) {
         assert(raw == nullptr);
-        raw = std::make_shared<RmRecord>(len);
+        raw = arena != nullptr ? std::make_shared<RmRecord>(len, arena) : std::make_shared<RmRecord>(len);
         if (type == TYPE_INT) {
             assert(len == sizeof(int));
             *(int *)(raw->data) = int_val;
@@ -75,4 +78,12 @@ struct Condition {
 struct SetClause {
     TabCol lhs;
     Value rhs;
+};
+
+enum AggType { AGG_COUNT, AGG_SUM, AGG_MIN, AGG_MAX, AGG_AVG };
+
+struct AggExpr {
+    AggType type;
+    TabCol col;       // 聚合的字段，COUNT(*)的col_name为"*"
+    TabCol output;    // 聚合结果在输出记录中的字段，tab_name为空，col_name为"SUM(x)"形式的显示名称
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <string>
 
 #define BUFFER_LENGTH 8192
 
@@ -24,8 +25,57 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte  4KB
 static constexpr int BUFFER_POOL_SIZE = 65536;                                // size of buffer pool 256MB
 // static constexpr int BUFFER_POOL_SIZE = 262144;                                // size of buffer pool 1GB
+static constexpr size_t COMPRESSED_CACHE_SIZE = 64 * 1024 * 1024;            // bytes of encoded pages kept after eviction from the buffer pool
+static constexpr size_t BUFFER_POOL_INSTANCES = 16;                           // max number of buffer pool shards
+static constexpr size_t BUFFER_POOL_MIN_INSTANCE_SIZE = 1024;                 // min frames per buffer pool shard
+static constexpr bool BUFFER_POOL_HUGE_PAGES = true;                          // back frame data with huge pages when available
+static constexpr bool BUFFER_POOL_NUMA = true;                                // spread buffer pool shards and worker threads over NUMA nodes
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;                     // size of a huge page (x86-64)
+static constexpr int BG_FLUSH_INTERVAL_MS = 100;                             // background flusher wakes up every 100ms
+static constexpr double BG_FLUSH_DIRTY_RATIO = 0.1;                           // target ratio of dirty frames per shard
+static constexpr size_t BG_FLUSH_BATCH_SIZE = 512;                            // max pages written per flusher round
+static constexpr int CHECKPOINT_INTERVAL_MS = 30000;                          // checkpoint every 30s
 static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
+static constexpr size_t RECOVERY_REDO_THREADS = 0;                            // threads replaying the log at restart, 0 means one per core
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr size_t ARENA_BLOCK_SIZE = 64 * 1024;                        // size of a statement arena block in byte
+static constexpr size_t QUERY_MEMORY_LIMIT = 1024UL * 1024 * 1024;           // bytes one statement's arena and operator buffers may hold, 0 means unlimited
+static constexpr size_t ROW_BATCH_SIZE = 1024;                                // max rows an executor returns per NextBatch()
+static constexpr size_t NESTED_LOOP_JOIN_BLOCK_PAGES = 1024;                  // outer pages a nested loop join buffers per inner pass
+static constexpr size_t HASH_JOIN_MEMORY_BUDGET = 64 * 1024 * 1024;           // bytes a hash join buffers before spilling to partitions
+static constexpr size_t HASH_JOIN_PARTITIONS = 32;                            // number of partitions of a spilled hash join
+static constexpr int JOIN_FILTER_BITS_PER_KEY = 10;                           // bloom filter bits per build row of a hash join runtime filter, 0 disables it
+static constexpr size_t SORT_MEMORY_BUDGET = 64 * 1024 * 1024;                // bytes a sort buffers before writing a sorted run
+static constexpr size_t SORT_RADIX_MAX_KEY_BYTES = 16;                        // longest normalized sort key sorted by radix sort
+static constexpr size_t HASH_AGG_MEMORY_BUDGET = 64 * 1024 * 1024;            // bytes of groups a hash aggregate keeps before spilling
+static constexpr size_t HASH_AGG_PARTITIONS = 32;                             // number of partitions of a spilled hash aggregate
+static constexpr size_t PARALLEL_SCAN_THREADS = 0;                            // threads of the shared parallel scan pool, 0 means one per core
+static constexpr int PARALLEL_SCAN_MORSEL_PAGES = 16;                         // pages a scan worker claims at a time
+static constexpr int PARALLEL_SCAN_MIN_PAGES = 64;                            // smaller tables are scanned by the querying thread alone
+static constexpr size_t JOIN_DP_MAX_TABLES = 8;                               // max tables whose join order is searched exhaustively
+static constexpr int CARDINALITY_SAMPLE_PAGES = 32;                           // page headers sampled to estimate a table's row count
+static constexpr int STATS_SAMPLE_PAGES = 64;                                 // pages ANALYZE samples to build column statistics
+static constexpr size_t STATS_HISTOGRAM_BUCKETS = 32;                         // max buckets of an equi-depth column histogram
+static constexpr int STATS_HLL_PRECISION = 10;                                // log2 of HyperLogLog registers per column
+static constexpr size_t LOCK_TABLE_BUCKETS = 64;                              // independently latched partitions of the lock table
+static constexpr size_t TXN_TABLE_SHARDS = 16;                                // independently latched partitions of the transaction table
+static constexpr size_t TXN_POOL_SHARD_CAPACITY = 64;                         // finished transactions each partition keeps for reuse
+static constexpr size_t UNDO_LOG_CHUNK_SIZE = 4 * 1024;                       // size of a transaction undo log block in byte
+static constexpr size_t LOCK_ESCALATION_THRESHOLD = 5000;                      // row locks one transaction holds on a table before locking the whole table
+static constexpr size_t SERVER_WORKER_THREADS = 0;                            // threads executing client requests, 0 means one per core
+static constexpr size_t PLAN_CACHE_SIZE = 1024;                               // max prepared statement plans kept in the plan cache
+static constexpr size_t RESULT_CACHE_BYTES = 64 << 20;                        // total size of the results kept in the result cache
+static constexpr size_t RESULT_CACHE_MAX_ENTRY_BYTES = 1 << 20;               // results larger than this are not cached
+static constexpr int RESULT_LOG_FLUSH_INTERVAL_MS = 50;                       // result log writer appends queued output every 50ms
+static constexpr size_t MAX_PARTITIONS = 1024;                               // max partitions of one table, each has its own files
+static constexpr size_t LSM_MEMTABLE_SIZE = 4 * 1024 * 1024;                  // bytes an LSM table's memtable holds before it is written as a sorted run
+static constexpr size_t LSM_MAX_RUNS = 4;                                     // sorted runs of an LSM table before they are compacted into one
+static constexpr int LSM_BLOOM_BITS_PER_KEY = 10;                             // bloom filter bits per row in a sorted run
+static constexpr size_t LOAD_PARSE_THREADS = 0;                               // threads parsing a COPY input file, 0 means one per core
+static constexpr size_t LOAD_MIN_CHUNK_SIZE = 1 << 20;                        // min bytes of the COPY input parsed by one thread
+static constexpr size_t METRICS_SHARDS = 16;                                  // per-thread shards of each engine counter and histogram
+static constexpr int METRICS_PORT = 8766;                                     // port serving Prometheus text metrics over HTTP, 0 disables it
+static constexpr size_t TRACE_RING_SIZE = 16384;                              // trace spans each thread keeps, older ones are overwritten
 
 using frame_id_t = int32_t;  // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
 using page_id_t = int32_t;   // page id type , 页ID
@@ -37,8 +87,51 @@ using timestamp_t = int32_t;  // timestamp type, used for transaction concurrenc
 
 // log file
 static const std::string LOG_FILE_NAME = "db.log";
+// master record: lsn of the last complete checkpoint, replaced atomically after each checkpoint
+static const std::string MASTER_RECORD_NAME = "db.master";
 
-// replacer
-static const std::string REPLACER_TYPE = "LRU";
+// async page I/O backend: "io_uring" (falls back to "sync" if the kernel refuses it) or "sync"
+static const std::string IO_BACKEND = "io_uring";
+static constexpr unsigned IO_URING_ENTRIES = 256;                             // submission queue depth
+static constexpr size_t IO_BATCH_SIZE = 64;                                   // max pages per batched async write
+static constexpr int READ_AHEAD_PAGES = 32;                                   // pages a sequential scan prefetches ahead of itself
+static constexpr size_t WARMUP_BATCH_PAGES = 1024;                            // pages of the dumped hot set read per buffer pool warm-up round
+
+// open page files with O_DIRECT so pages are cached only in the buffer pool, not also in the kernel page cache
+static constexpr bool ENABLE_DIRECT_IO = false;
+
+// dump the resident page list to buffer_pool.dump at checkpoints and on close, and prefetch it in the background on startup
+static constexpr bool ENABLE_BUFFER_POOL_WARMUP = true;
+static const std::string BUFFER_POOL_DUMP_NAME = "buffer_pool.dump";
+
+// replacer: "LRU", "CLOCK" or "2Q"
+static const std::string REPLACER_TYPE = "2Q";
 
 static const std::string DB_META_NAME = "db.meta";
+
+// copy every statement's output into output.txt for the test harness; disable in production mode
+static constexpr bool ENABLE_RESULT_LOG = true;
+static const std::string RESULT_LOG_NAME = "output.txt";
+
+// record statements slower than SLOW_QUERY_THRESHOLD_MS in slow_query.log with their plan, rows examined and pages touched;
+// every SLOW_QUERY_SAMPLE_EVERY-th statement is recorded regardless of its latency, 0 disables sampling
+static constexpr bool ENABLE_SLOW_QUERY_LOG = true;
+static const std::string SLOW_QUERY_LOG_NAME = "slow_query.log";
+static constexpr int SLOW_QUERY_THRESHOLD_MS = 100;
+static constexpr size_t SLOW_QUERY_SAMPLE_EVERY = 0;
+
+// serve repeated auto-commit SELECTs from a cache of their serialized results, keyed by the normalized statement text
+// (or prepared statement and parameter values); writes to a table and DDL invalidate the cached results
+static constexpr bool ENABLE_RESULT_CACHE = false;
+
+// defer inserts and deletes of B+tree index entries whose leaf is not in the buffer pool, merging them into the index
+// when the key is looked up, before an index range scan, when the buffer fills up or from the background flusher;
+// buffered changes are not persisted because crash recovery rebuilds the indexes of the tables it touches
+static constexpr bool ENABLE_INDEX_CHANGE_BUFFER = true;
+
+// print every received request and client connection event to stdout, for debugging only
+static constexpr bool ENABLE_REQUEST_TRACE = false;
+
+// record trace spans around buffer pool misses, disk I/O, B+tree splits and merges, lock waits and WAL flushes
+// into per-thread ring buffers, exported as Chrome trace JSON at /trace on METRICS_PORT; compiled out when false
+static constexpr bool ENABLE_TRACING = false;
@@ -1,10 +1,17 @@
 #pragma once
 
+#include <functional>
+#include <string>
+
+#include "common/arena.h"
+#include "common/result_log.h"
 #include "transaction/transaction.h"
 #include "transaction/concurrency/lock_manager.h"
+#include "transaction/version_store.h"
 #include "recovery/log_manager.h"
 
 // class TransactionManager;
+class ExplainStats;
 
 // used for data_send
 static int const_offset = -1;
@@ -25,4 +32,43 @@ public:
     char *data_send_;
     int *offset_;
     bool ellipsis_;
+    MemoryTracker memory_;  // 语句占用的内存，上限由连接通过SET query_memory_limit设置
+    Arena arena_{ARENA_BLOCK_SIZE, &memory_};   // 语句级内存池，Context随每条语句创建，语句结束后统一释放
+    // 流式发送结果的回调，把data_send_中已经写入的结果发送给客户端；为空时结果只保存在data_send_中，写满后被截断
+    std::function<void(const char *data, size_t len)> send_result_;
+    ResultLog *result_log_ = nullptr;  // 语句的输出同时写入的结果日志，为空时不记录，也不需要生成日志文本
+    std::string *captured_log_ = nullptr;  // 结果缓存保存select写入结果日志的文本，为空时不保存
+    bool binary_result_ = false;    // select的结果以二进制格式返回，由连接通过SET result_format选择
+    VersionStore *version_store_ = nullptr;    // 写入者在这里登记旧版本，为空时不维护版本
+    bool snapshot_read_ = false;    // 扫描读取txn_的快照而不是堆表中最新的记录，只用于SELECT
+    ExplainStats *explain_stats_ = nullptr;    // EXPLAIN ANALYZE时不为空，生成的每个算子都包装上执行统计
+
+    // 语句的修改需要写入日志
+    bool logging() const { return log_mgr_ != nullptr && txn_ != nullptr && enable_logging; }
+
+    /**
+     * @description: 修改表之前在表上加意向写锁，在要修改的记录上加排他锁，没有锁管理器或事务时不加锁。
+     *               事务在表上的行级锁过多时由LockManager升级为表级锁，冲突时等待或抛出TransactionAbortException
+     */
+    void lock_for_write(int tab_fd, const std::vector<Rid> &rids) {
+        if (lock_mgr_ == nullptr || txn_ == nullptr) {
+            return;
+        }
+        lock_mgr_->lock_IX_on_table(txn_, tab_fd);
+        for (auto &rid : rids) {
+            lock_mgr_->lock_exclusive_on_record(txn_, rid, tab_fd);
+        }
+    }
+
+    // 发送data_send_中已经写入的结果并清空缓冲区，返回false表示不支持流式发送
+    bool flush_result() {
+        if (!send_result_) {
+            return false;
+        }
+        if (*offset_ > 0) {
+            send_result_(data_send_, *offset_);
+            *offset_ = 0;
+        }
+        return true;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "common/config.h"
+#include "common/metrics.h"
+#include "errors.h"
+
+/*
+MemoryTracker统计一条语句占用的内存，语句的Arena和排序、哈希连接、哈希聚合缓存的行都记在同一个MemoryTracker上
+1. 能够落盘的算子用try_consume()申请，超过上限时返回false，算子随即把缓存的数据写到临时文件
+2. 不能落盘的内存用consume()申请，超过上限时抛出QueryMemoryLimitError，语句失败并释放已经申请的全部内存
+3. 并行算子的多个线程可以同时申请和释放
+*/
+class MemoryTracker {
+   public:
+    explicit MemoryTracker(size_t limit = QUERY_MEMORY_LIMIT) : limit_(limit) {}
+
+    MemoryTracker(const MemoryTracker &) = delete;
+    MemoryTracker &operator=(const MemoryTracker &) = delete;
+
+    // 上限为0表示不限制
+    void set_limit(size_t limit) { limit_.store(limit, std::memory_order_relaxed); }
+
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+
+    // 语句执行过程中占用内存的最大值
+    size_t peak() const { return peak_.load(std::memory_order_relaxed); }
+
+    // 还能申请的字节数，不限制时为SIZE_MAX
+    size_t available() const {
+        size_t limit = this->limit();
+        if (limit == 0) {
+            return SIZE_MAX;
+        }
+        size_t used = this->used();
+        return used >= limit ? 0 : limit - used;
+    }
+
+    /**
+     * @description: 申请bytes字节，超过上限时不申请
+     * @return {bool} 是否申请成功
+     * @param {size_t} bytes 字节数
+     */
+    bool try_consume(size_t bytes) {
+        size_t limit = this->limit();
+        size_t used = used_.load(std::memory_order_relaxed);
+        do {
+            if (limit != 0 && (used > limit || bytes > limit - used)) {
+                return false;
+            }
+        } while (!used_.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+        size_t peak = peak_.load(std::memory_order_relaxed);
+        while (used + bytes > peak && !peak_.compare_exchange_weak(peak, used + bytes, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    /**
+     * @description: 申请bytes字节，超过上限时抛出QueryMemoryLimitError
+     * @param {size_t} bytes 字节数
+     */
+    void consume(size_t bytes) {
+        if (!try_consume(bytes)) {
+            EngineMetrics::get().query_memory_limit_errors.add();
+            throw QueryMemoryLimitError(used() + bytes, limit());
+        }
+    }
+
+    void release(size_t bytes) { used_.fetch_sub(bytes, std::memory_order_relaxed); }
+
+   private:
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> used_{0};
+    std::atomic<size_t> peak_{0};
+};
+
+/*
+MemoryReservation是算子在MemoryTracker上占用的一段内存，大小随算子缓存的数据调整，析构时全部归还。
+tracker为空时不做统计，任何调整都成功
+*/
+class MemoryReservation {
+   public:
+    explicit MemoryReservation(MemoryTracker *tracker = nullptr) : tracker_(tracker) {}
+
+    ~MemoryReservation() { shrink(0); }
+
+    MemoryReservation(const MemoryReservation &) = delete;
+    MemoryReservation &operator=(const MemoryReservation &) = delete;
+
+    size_t bytes() const { return bytes_; }
+
+    // 在当前占用之外还能申请的字节数
+    size_t available() const { return tracker_ == nullptr ? SIZE_MAX : tracker_->available(); }
+
+    /**
+     * @description: 把占用调整为bytes字节，缩小总是成功
+     * @return {bool} 是否调整成功，失败时占用不变
+     * @param {size_t} bytes 调整后的字节数
+     */
+    bool try_resize(size_t bytes) {
+        if (bytes <= bytes_) {
+            shrink(bytes);
+            return true;
+        }
+        if (tracker_ != nullptr && !tracker_->try_consume(bytes - bytes_)) {
+            return false;
+        }
+        bytes_ = bytes;
+        return true;
+    }
+
+    /**
+     * @description: 把占用调整为bytes字节，超过上限时抛出QueryMemoryLimitError
+     * @param {size_t} bytes 调整后的字节数
+     */
+    void resize(size_t bytes) {
+        if (bytes <= bytes_) {
+            shrink(bytes);
+            return;
+        }
+        if (tracker_ != nullptr) {
+            tracker_->consume(bytes - bytes_);
+        }
+        bytes_ = bytes;
+    }
+
+   private:
+    void shrink(size_t bytes) {
+        if (tracker_ != nullptr) {
+            tracker_->release(bytes_ - bytes);
+        }
+        bytes_ = bytes;
+    }
+
+    MemoryTracker *tracker_;
+    size_t bytes_ = 0;
+};
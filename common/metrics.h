@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * @description: 当前线程写入的分片。线程第一次写入指标时轮流分配，之后固定不变，
+ *               不同线程大多落在不同的缓存行上，写入时不互相争用
+ */
+inline size_t metrics_shard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRICS_SHARDS;
+    return shard;
+}
+
+/**
+ * @description: 单调递增的计数器，按线程分片。写入只是本分片上relaxed的fetch_add，读取时把所有分片相加，
+ *               读到的值不是某一时刻的快照，但不会丢失写入
+ */
+class Counter {
+   public:
+    Counter(const char *name, const char *help) : name_(name), help_(help) {}
+
+    void add(uint64_t n = 1) { shards_[metrics_shard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    uint64_t value() const {
+        uint64_t sum = 0;
+        for (auto &shard : shards_) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    const char *name() const { return name_; }
+    const char *help() const { return help_; }
+
+   private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};
+    };
+
+    const char *name_;
+    const char *help_;
+    std::array<Shard, METRICS_SHARDS> shards_;
+};
+
+/**
+ * @description: 延迟直方图，按线程分片。第i个桶统计(2^(i-1), 2^i]微秒的观测值，第0个桶统计不超过1微秒的，
+ *               最后一个桶统计超过2^(HISTOGRAM_BUCKETS-2)微秒的所有观测值
+ */
+class Histogram {
+   public:
+    static constexpr size_t HISTOGRAM_BUCKETS = 28;     // 最后一个有上界的桶到2^26微秒，约67秒
+
+    // 所有分片合并后的结果
+    struct Snapshot {
+        std::array<uint64_t, HISTOGRAM_BUCKETS> buckets{};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+
+        /**
+         * @description: 估计分位数，返回第一个累计数量达到q的桶的上界，单位为微秒。没有观测值时返回0
+         * @param {double} q 分位数，取值(0, 1]
+         */
+        uint64_t quantile_us(double q) const {
+            if (count == 0) {
+                return 0;
+            }
+            uint64_t rank = static_cast<uint64_t>(q * count + 0.5);
+            rank = rank == 0 ? 1 : rank;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    return bucket_upper_us(i);
+                }
+            }
+            return bucket_upper_us(HISTOGRAM_BUCKETS - 1);
+        }
+    };
+
+    Histogram(const char *name, const char *help) : name_(name), help_(help) {}
+
+    void observe_ns(uint64_t ns) {
+        Shard &shard = shards_[metrics_shard()];
+        shard.buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum_ns.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void observe(std::chrono::steady_clock::duration elapsed) {
+        observe_ns(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    Snapshot snapshot() const {
+        Snapshot snapshot;
+        for (auto &shard : shards_) {
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+                uint64_t n = shard.buckets[i].load(std::memory_order_relaxed);
+                snapshot.buckets[i] += n;
+                snapshot.count += n;
+            }
+            snapshot.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+        }
+        return snapshot;
+    }
+
+    // 第i个桶的上界，单位为微秒；最后一个桶没有上界，返回它的下界
+    static uint64_t bucket_upper_us(size_t i) {
+        return i + 1 < HISTOGRAM_BUCKETS ? uint64_t{1} << i : uint64_t{1} << (HISTOGRAM_BUCKETS - 2);
+    }
+
+    static size_t bucket_of(uint64_t ns) {
+        uint64_t us = (ns + 999) / 1000;
+        // us - 1的有效位数，即不小于us的最小2的幂的指数
+        size_t i = us <= 1 ? 0 : 64 - __builtin_clzll(us - 1);
+        return std::min(i, HISTOGRAM_BUCKETS - 1);
+    }
+
+    const char *name() const { return name_; }
+    const char *help() const { return help_; }
+
+   private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+
+    const char *name_;
+    const char *help_;
+    std::array<Shard, METRICS_SHARDS> shards_;
+};
+
+/**
+ * @description: 在作用域结束时把经过的时间记入直方图
+ */
+class ScopedLatency {
+   public:
+    explicit ScopedLatency(Histogram &histogram) : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+
+    ~ScopedLatency() { histogram_.observe(std::chrono::steady_clock::now() - start_); }
+
+   private:
+    Histogram &histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * @description: 引擎的全部指标，进程内唯一，始终开启。通过SHOW STATS和Prometheus文本格式的HTTP端口读取
+ */
+class EngineMetrics {
+   public:
+    // 缓冲池
+    Counter buffer_pool_hits{"buffer_pool_hits", "Page fetches served from the buffer pool"};
+    Counter buffer_pool_misses{"buffer_pool_misses", "Page fetches that had to read the page"};
+    Counter buffer_pool_evictions{"buffer_pool_evictions", "Pages evicted to make room for another page"};
+    Counter buffer_pool_dirty_writebacks{"buffer_pool_dirty_writebacks", "Dirty pages written back on eviction"};
+    // 磁盘，只统计数据文件的页面读写，异步I/O只统计字节数
+    Counter disk_read_bytes{"disk_read_bytes", "Bytes read from data files"};
+    Counter disk_write_bytes{"disk_write_bytes", "Bytes written to data files"};
+    Histogram disk_read_latency{"disk_read_latency", "Latency of synchronous page reads"};
+    Histogram disk_write_latency{"disk_write_latency", "Latency of synchronous page writes"};
+    // 索引
+    Counter index_changes_buffered{"index_changes_buffered", "B+tree index changes deferred to the change buffer"};
+    Counter index_changes_merged{"index_changes_merged", "Buffered B+tree index changes written into the index"};
+    Counter index_latch_waits{"index_latch_waits", "B+tree node latches that blocked on another thread"};
+    Counter index_optimistic_retries{"index_optimistic_retries", "Optimistic B+tree reads invalidated by a writer"};
+    Counter index_optimistic_fallbacks{"index_optimistic_fallbacks",
+                                       "B+tree reads that gave up optimistic reading and took latches"};
+    Counter index_pessimistic_descents{"index_pessimistic_descents",
+                                       "B+tree writes restarted from the root with exclusive latches"};
+    // LSM表
+    Counter lsm_memtable_flushes{"lsm_memtable_flushes", "LSM memtables written out as sorted runs"};
+    Counter lsm_compactions{"lsm_compactions", "Compactions merging the sorted runs of an LSM table"};
+    Counter lsm_bloom_skips{"lsm_bloom_skips", "Sorted run lookups skipped by the bloom filter"};
+    // 锁
+    Counter lock_waits{"lock_waits", "Lock requests that had to wait"};
+    Counter lock_aborts{"lock_aborts", "Transactions aborted by the lock manager"};
+    Histogram lock_wait_latency{"lock_wait_latency", "Time lock requests spent waiting"};
+    // 日志
+    Counter wal_bytes{"wal_bytes", "Bytes written to the write-ahead log"};
+    Histogram wal_fsync_latency{"wal_fsync_latency", "Latency of write-ahead log fsyncs"};
+    // 语句
+    Counter statements{"statements", "Statements executed"};
+    Counter result_cache_hits{"result_cache_hits", "SELECTs answered from the result cache"};
+    Counter join_filter_drops{"join_filter_drops", "Probe-side rows dropped by hash join runtime filters"};
+    Counter query_memory_spills{"query_memory_spills", "Operator spills forced by the statement memory limit"};
+    Counter query_memory_limit_errors{"query_memory_limit_errors", "Statements aborted by the statement memory limit"};
+    Histogram stmt_parse_latency{"stmt_parse_latency", "Time spent parsing statements"};
+    Histogram stmt_plan_latency{"stmt_plan_latency", "Time spent analyzing and planning statements"};
+    Histogram stmt_execute_latency{"stmt_execute_latency", "Time spent executing statements"};
+
+    static EngineMetrics &get() {
+        static EngineMetrics metrics;
+        return metrics;
+    }
+
+    /**
+     * @description: SHOW STATS的输出，每个指标一行，直方图输出次数、平均值和分位数
+     */
+    std::vector<std::string> format_text() const {
+        std::vector<std::string> lines;
+        char buf[256];
+        for (auto *counter : counters()) {
+            snprintf(buf, sizeof(buf), "%-30s %llu", counter->name(), static_cast<unsigned long long>(counter->value()));
+            lines.push_back(buf);
+        }
+        for (auto *histogram : histograms()) {
+            auto s = histogram->snapshot();
+            double avg_us = s.count == 0 ? 0 : s.sum_ns / 1e3 / s.count;
+            snprintf(buf, sizeof(buf), "%-30s count=%llu avg=%.1fus p50<=%lluus p99<=%lluus p999<=%lluus",
+                     histogram->name(), static_cast<unsigned long long>(s.count), avg_us,
+                     static_cast<unsigned long long>(s.quantile_us(0.5)),
+                     static_cast<unsigned long long>(s.quantile_us(0.99)),
+                     static_cast<unsigned long long>(s.quantile_us(0.999)));
+            lines.push_back(buf);
+        }
+        return lines;
+    }
+
+    /**
+     * @description: Prometheus文本格式(version 0.0.4)，指标名加上unibase_前缀，直方图以秒为单位
+     */
+    std::string format_prometheus() const {
+        std::string text;
+        for (auto *counter : counters()) {
+            std::string name = std::string("unibase_") + counter->name() + "_total";
+            text += "# HELP " + name + " " + counter->help() + "\n";
+            text += "# TYPE " + name + " counter\n";
+            text += name + " " + std::to_string(counter->value()) + "\n";
+        }
+        for (auto *histogram : histograms()) {
+            std::string name = std::string("unibase_") + histogram->name() + "_seconds";
+            text += "# HELP " + name + " " + histogram->help() + "\n";
+            text += "# TYPE " + name + " histogram\n";
+            auto s = histogram->snapshot();
+            uint64_t cumulative = 0;
+            char le[32];
+            for (size_t i = 0; i + 1 < Histogram::HISTOGRAM_BUCKETS; i++) {
+                cumulative += s.buckets[i];
+                snprintf(le, sizeof(le), "%g", Histogram::bucket_upper_us(i) / 1e6);
+                text += name + "_bucket{le=\"" + le + "\"} " + std::to_string(cumulative) + "\n";
+            }
+            text += name + "_bucket{le=\"+Inf\"} " + std::to_string(s.count) + "\n";
+            snprintf(le, sizeof(le), "%.9f", s.sum_ns / 1e9);
+            text += name + "_sum " + le + "\n";
+            text += name + "_count " + std::to_string(s.count) + "\n";
+        }
+        return text;
+    }
+
+   private:
+    std::vector<const Counter *> counters() const {
+        return {&buffer_pool_hits,       &buffer_pool_misses,   &buffer_pool_evictions,  &buffer_pool_dirty_writebacks,
+                &disk_read_bytes,        &disk_write_bytes,     &index_changes_buffered, &index_changes_merged,
+                &index_latch_waits,      &index_optimistic_retries, &index_optimistic_fallbacks,
+                &index_pessimistic_descents, &lsm_memtable_flushes, &lsm_compactions, &lsm_bloom_skips,
+                &lock_waits,             &lock_aborts,          &wal_bytes,              &statements,
+                &result_cache_hits,      &join_filter_drops,    &query_memory_spills,    &query_memory_limit_errors};
+    }
+
+    std::vector<const Histogram *> histograms() const {
+        return {&disk_read_latency,  &disk_write_latency, &lock_wait_latency,   &wal_fsync_latency,
+                &stmt_parse_latency, &stmt_plan_latency,  &stmt_execute_latency};
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/*
+NumaTopology读取/sys/devices/system/node中的NUMA结点及其CPU，不依赖libnuma。
+系统只有一个结点或者读取失败时视为单结点，绑定内存和线程的函数都不做任何事
+*/
+class NumaTopology {
+   public:
+    static const NumaTopology &get() {
+        static NumaTopology topology;
+        return topology;
+    }
+
+    size_t num_nodes() const { return node_cpus_.size(); }
+
+    const std::vector<int> &cpus(size_t node) const { return node_cpus_[node]; }
+
+    /**
+     * @description: 把[addr, addr + len)的物理内存优先分配在node结点上，需在第一次写入之前调用
+     * @return {bool} 是否设置成功，单结点的系统上总是返回false
+     */
+    bool bind_memory(void *addr, size_t len, size_t node) const {
+        if (num_nodes() <= 1 || node >= 64) {
+            return false;
+        }
+        // MPOL_PREFERRED：结点内存不足时仍可以分配在其他结点上。maxnode按内核的约定为位数加1
+        constexpr int MPOL_PREFERRED_MODE = 1;
+        unsigned long node_mask = 1UL << node_ids_[node];
+        return syscall(SYS_mbind, addr, len, MPOL_PREFERRED_MODE, &node_mask, 65, 0) == 0;
+    }
+
+    /**
+     * @description: 把调用线程限制在node结点的CPU上运行
+     * @return {bool} 是否设置成功，单结点的系统上总是返回false
+     */
+    bool pin_thread(size_t node) const {
+        if (num_nodes() <= 1) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : node_cpus_[node % num_nodes()]) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+
+   private:
+    NumaTopology() {
+        std::vector<int> online = parse_list(read_file("/sys/devices/system/node/online"));
+        for (int id : online) {
+            std::vector<int> cpus =
+                parse_list(read_file("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"));
+            // 没有CPU的结点(只有内存)不参与线程和分片的分配
+            if (!cpus.empty() && id < 64) {
+                node_ids_.push_back(id);
+                node_cpus_.push_back(std::move(cpus));
+            }
+        }
+        if (node_cpus_.empty()) {
+            node_ids_ = {0};
+            node_cpus_.emplace_back();
+        }
+    }
+
+    // 读取文件的第一行，头文件中不使用iostream，避免引入<sstream>
+    static std::string read_file(const std::string &path) {
+        char line[4096] = {};
+        std::FILE *file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return "";
+        }
+        if (std::fgets(line, sizeof(line), file) == nullptr) {
+            line[0] = '\0';
+        }
+        std::fclose(file);
+        return line;
+    }
+
+    // 解析"0-3,8-11"格式的列表，格式错误时返回空列表
+    static std::vector<int> parse_list(const std::string &text) {
+        std::vector<int> ids;
+        const char *p = text.c_str();
+        while (*p != '\0' && *p != '\n') {
+            char *end;
+            long lo = std::strtol(p, &end, 10);
+            if (end == p) {
+                return {};
+            }
+            long hi = lo;
+            p = end;
+            if (*p == '-') {
+                hi = std::strtol(p + 1, &end, 10);
+                if (end == p + 1) {
+                    return {};
+                }
+                p = end;
+            }
+            for (long id = lo; id <= hi; id++) {
+                ids.push_back(static_cast<int>(id));
+            }
+            if (*p == ',') {
+                p++;
+            } else if (*p != '\0' && *p != '\n') {
+                return {};
+            }
+        }
+        return ids;
+    }
+
+    std::vector<int> node_ids_;                 // 有CPU的结点的编号
+    std::vector<std::vector<int>> node_cpus_;   // 每个结点上的CPU
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common/config.h"
+
+/**
+ * @description: 异步写入的日志文件，用于output.txt的结果日志和慢查询日志。执行语句的线程只把整条语句的输出文本无锁地压入队列，
+ *               由后台线程定期取出全部文本，按提交的先后顺序追加到一直打开的文件中。
+ *               文件在第一次写入时才打开，因此需要在进入数据库目录之后写入
+ */
+class ResultLog {
+   public:
+    explicit ResultLog(std::string file_name,
+                       std::chrono::milliseconds flush_interval = std::chrono::milliseconds(RESULT_LOG_FLUSH_INTERVAL_MS))
+        : file_name_(std::move(file_name)), flush_interval_(flush_interval) {}
+
+    ~ResultLog() { stop(); }
+
+    /**
+     * @description: 启动后台写线程，重复调用无效
+     */
+    void start() {
+        std::scoped_lock lock{latch_};
+        if (thread_.joinable()) {
+            return;
+        }
+        stop_ = false;
+        thread_ = std::thread(&ResultLog::run, this);
+    }
+
+    /**
+     * @description: 停止后台写线程，并把队列中剩余的文本写入文件
+     */
+    void stop() {
+        {
+            std::scoped_lock lock{latch_};
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        flush();
+    }
+
+    /**
+     * @description: 提交一段输出文本，不加锁也不等待写文件，可以被多个线程同时调用
+     * @param {string} text 一条语句的完整输出
+     */
+    void append(std::string text) {
+        if (text.empty()) {
+            return;
+        }
+        Node *node = new Node{std::move(text), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+     * @description: 把目前已经提交的文本写入文件
+     * @return {size_t} 本次写入的文本段数
+     */
+    size_t flush() {
+        std::scoped_lock lock{write_latch_};
+        // 取出整个栈，反转后即为提交的顺序
+        Node *node = head_.exchange(nullptr, std::memory_order_acquire);
+        Node *batch = nullptr;
+        while (node != nullptr) {
+            Node *next = node->next;
+            node->next = batch;
+            batch = node;
+            node = next;
+        }
+        if (batch == nullptr) {
+            return 0;
+        }
+        if (!out_.is_open()) {
+            out_.open(file_name_, std::ios::out | std::ios::app);
+        }
+        size_t num_written = 0;
+        for (Node *cur = batch; cur != nullptr; cur = cur->next) {
+            out_ << cur->text;
+            num_written++;
+        }
+        out_.flush();
+        drop(batch);
+        num_written_ += num_written;
+        return num_written;
+    }
+
+    size_t num_written() const { return num_written_; }
+
+   private:
+    struct Node {
+        std::string text;
+        Node *next;
+    };
+
+    static void drop(Node *node) {
+        while (node != nullptr) {
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock{latch_};
+        while (!stop_) {
+            cv_.wait_for(lock, flush_interval_, [this] { return stop_; });
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    }
+
+    std::string file_name_;
+    std::chrono::milliseconds flush_interval_;  // 后台线程写文件的间隔
+    std::atomic<Node *> head_{nullptr};         // 待写入的文本，后提交的在栈顶
+    std::mutex write_latch_;                    // 保护out_，保证各批文本按顺序写入
+    std::ofstream out_;
+    std::atomic<size_t> num_written_{0};        // 累计写入的文本段数
+
+    std::thread thread_;
+    std::mutex latch_;                          // 用于stop_和cv_
+    std::condition_variable cv_;
+    bool stop_ = false;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "numa.h"
+
+/**
+ * @description: 固定大小的线程池，提交的任务按先后顺序由空闲的线程执行。
+ *               线程在构造时创建，继承创建者的信号屏蔽字
+ */
+class ThreadPool {
+   public:
+    /**
+     * @param {size_t} num_threads 线程数
+     * @param {bool} numa_spread 多个NUMA结点时把线程轮流限制在各结点的CPU上，每个线程访问的内存相对固定，
+     *        不会被调度器在结点之间来回迁移
+     */
+    explicit ThreadPool(size_t num_threads, bool numa_spread = false) {
+        for (size_t i = 0; i < num_threads; i++) {
+            threads_.emplace_back([this, i, numa_spread] {
+                if (numa_spread) {
+                    NumaTopology::get().pin_thread(i);
+                }
+                run();
+            });
+        }
+    }
+
+    ~ThreadPool() { stop(); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    /**
+     * @description: 执行完已经提交的任务后退出所有线程，之后不能再提交任务
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(latch_);
+            if (stop_) {
+                return;
+            }
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto &thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+
+    size_t size() const { return threads_.size(); }
+
+   private:
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(latch_);
+                cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+    std::mutex latch_;                          // 保护tasks_和stop_
+    std::condition_variable cv_;                // 有新任务或线程池停止时唤醒线程
+    std::queue<std::function<void()>> tasks_;   // 等待执行的任务
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
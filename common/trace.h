@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+/**
+ * @description: 一个线程的trace环形缓冲区，只由所属线程写入，新的span覆盖最旧的span。
+ *               字段都是relaxed的原子变量，导出时可以与写入并发读取；写入位置以release发布，
+ *               导出时丢弃读取期间可能被覆盖的位置，因此不会输出被撕裂的span
+ */
+class TraceRing {
+   public:
+    struct Span {
+        const char *name;       // span的名称，指向字符串常量
+        const char *arg_name;   // 附带参数的名称，为空时没有参数
+        uint64_t arg;
+        uint64_t start_ns;      // 相对于trace起点的开始时间
+        uint64_t dur_ns;
+    };
+
+    explicit TraceRing(uint32_t tid) : tid_(tid) {}
+
+    void record(const Span &span) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        // 导出的线程读到本次写入的任何字段时，一定也能读到之前发布的写入位置
+        std::atomic_thread_fence(std::memory_order_release);
+        Slot &slot = slots_[head % TRACE_RING_SIZE];
+        slot.name.store(span.name, std::memory_order_relaxed);
+        slot.arg_name.store(span.arg_name, std::memory_order_relaxed);
+        slot.arg.store(span.arg, std::memory_order_relaxed);
+        slot.start_ns.store(span.start_ns, std::memory_order_relaxed);
+        slot.dur_ns.store(span.dur_ns, std::memory_order_relaxed);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * @description: 复制缓冲区中的span，按记录的先后顺序输出
+     */
+    std::vector<Span> snapshot() const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t begin = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+        std::vector<Span> spans;
+        spans.reserve(head - begin);
+        for (uint64_t i = begin; i < head; i++) {
+            const Slot &slot = slots_[i % TRACE_RING_SIZE];
+            spans.push_back({slot.name.load(std::memory_order_relaxed), slot.arg_name.load(std::memory_order_relaxed),
+                             slot.arg.load(std::memory_order_relaxed), slot.start_ns.load(std::memory_order_relaxed),
+                             slot.dur_ns.load(std::memory_order_relaxed)});
+        }
+        // 复制期间写入的span覆盖了最旧的位置，这些位置以及正在写入的下一个位置上读到的内容可能不完整
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t new_head = head_.load(std::memory_order_relaxed) + 1;
+        uint64_t overwritten = new_head > begin + TRACE_RING_SIZE ? new_head - begin - TRACE_RING_SIZE : 0;
+        spans.erase(spans.begin(), spans.begin() + std::min<uint64_t>(overwritten, spans.size()));
+        return spans;
+    }
+
+    uint32_t tid() const { return tid_; }
+
+   private:
+    struct Slot {
+        std::atomic<const char *> name{nullptr};
+        std::atomic<const char *> arg_name{nullptr};
+        std::atomic<uint64_t> arg{0};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> dur_ns{0};
+    };
+
+    uint32_t tid_;
+    std::atomic<uint64_t> head_{0};     // 已经写入的span数
+    std::array<Slot, TRACE_RING_SIZE> slots_;
+};
+
+/**
+ * @description: 所有线程的trace缓冲区，进程内唯一。线程第一次记录span时注册自己的缓冲区，
+ *               线程退出后缓冲区仍然保留，导出时包含已退出线程最后的span
+ */
+class TraceLog {
+   public:
+    static TraceLog &get() {
+        static TraceLog log;
+        return log;
+    }
+
+    // 当前线程的缓冲区
+    TraceRing &local() {
+        thread_local TraceRing *ring = register_thread();
+        return *ring;
+    }
+
+    // 相对于trace起点的当前时间
+    uint64_t now_ns() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+    }
+
+    /**
+     * @description: 以Chrome trace JSON格式导出所有线程缓冲区中的span，可以由chrome://tracing或Perfetto打开。
+     *               每个span是一个"X"事件，时间单位为微秒
+     */
+    std::string format_chrome_json() {
+        std::vector<std::shared_ptr<TraceRing>> rings;
+        {
+            std::scoped_lock lock{latch_};
+            rings = rings_;
+        }
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char buf[256];
+        for (auto &ring : rings) {
+            for (auto &span : ring->snapshot()) {
+                int n = snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"cat\":\"unibase\",\"ph\":\"X\",\"pid\":1,"
+                                 "\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                                 first ? "" : ",", span.name, ring->tid(), span.start_ns / 1e3, span.dur_ns / 1e3);
+                json.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+                if (span.arg_name != nullptr) {
+                    n = snprintf(buf, sizeof(buf), ",\"args\":{\"%s\":%llu}", span.arg_name,
+                                 static_cast<unsigned long long>(span.arg));
+                    json.append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+                }
+                json += "}";
+                first = false;
+            }
+        }
+        json += "]}";
+        return json;
+    }
+
+   private:
+    TraceLog() : epoch_(std::chrono::steady_clock::now()) {}
+
+    TraceRing *register_thread() {
+        std::scoped_lock lock{latch_};
+        rings_.push_back(std::make_shared<TraceRing>(static_cast<uint32_t>(rings_.size() + 1)));
+        return rings_.back().get();
+    }
+
+    std::chrono::steady_clock::time_point epoch_;
+    std::mutex latch_;                                  // 保护rings_
+    std::vector<std::shared_ptr<TraceRing>> rings_;     // 按线程注册的顺序，下标加1为线程在trace中的编号
+};
+
+/**
+ * @description: 在作用域结束时把经过的时间作为一个span记入当前线程的trace缓冲区。
+ *               ENABLE_TRACING为false时构造和析构都是空的，编译后不留下任何代码
+ */
+class TraceSpan {
+   public:
+    /**
+     * @param {char*} name span的名称，必须是字符串常量
+     * @param {char*} arg_name 附带参数的名称，必须是字符串常量，为空时没有参数
+     * @param {uint64_t} arg 附带参数的值，如页号、字节数
+     */
+    explicit TraceSpan(const char *name, const char *arg_name = nullptr, uint64_t arg = 0) {
+        if constexpr (ENABLE_TRACING) {
+            span_ = {name, arg_name, arg, TraceLog::get().now_ns(), 0};
+        }
+    }
+
+    ~TraceSpan() {
+        if constexpr (ENABLE_TRACING) {
+            TraceLog &log = TraceLog::get();
+            span_.dur_ns = log.now_ns() - span_.start_ns;
+            log.local().record(span_);
+        }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+   private:
+    TraceRing::Span span_;  // 关闭时不初始化也不读取，编译器会去掉它
+};
@@ -93,6 +93,12 @@ class TableExistsError : public UniBaseError {
     TableExistsError(const std::string &tab_name) : UniBaseError("Table already exists: " + tab_name) {}
 };
 
+class TableInUseError : public UniBaseError {
+   public:
+    TableInUseError(const std::string &tab_name)
+        : UniBaseError("Table is in use by other transactions: " + tab_name) {}
+};
+
 class ColumnNotFoundError : public UniBaseError {
    public:
     ColumnNotFoundError(const std::string &col_name) : UniBaseError("Column not found: " + col_name) {}
@@ -122,6 +128,13 @@ class IndexExistsError : public UniBaseError {
     }
 };
 
+class IndexFormatError : public UniBaseError {
+   public:
+    IndexFormatError(const std::string &ix_name, int version, int expected)
+        : UniBaseError("Index file " + ix_name + " has format version " + std::to_string(version) + ", expected " +
+                       std::to_string(expected) + ": drop and recreate the index") {}
+};
+
 // QL errors
 class InvalidValueCountError : public UniBaseError {
    public:
@@ -144,6 +157,62 @@ class AmbiguousColumnError : public UniBaseError {
     AmbiguousColumnError(const std::string &col_name) : UniBaseError("Ambiguous column: " + col_name) {}
 };
 
+class ColumnNotGroupedError : public UniBaseError {
+   public:
+    ColumnNotGroupedError(const std::string &col_name)
+        : UniBaseError("Column must appear in GROUP BY or be used in an aggregate function: " + col_name) {}
+};
+
+class PreparedStmtNotFoundError : public UniBaseError {
+   public:
+    PreparedStmtNotFoundError(const std::string &name) : UniBaseError("Prepared statement not found: " + name) {}
+};
+
+class PreparedStmtExistsError : public UniBaseError {
+   public:
+    PreparedStmtExistsError(const std::string &name) : UniBaseError("Prepared statement already exists: " + name) {}
+};
+
+class InvalidParamError : public UniBaseError {
+   public:
+    InvalidParamError(const std::string &msg) : UniBaseError("Invalid parameter: " + msg) {}
+};
+
+class LoadDataError : public UniBaseError {
+   public:
+    LoadDataError(const std::string &file_name, size_t line, const std::string &msg)
+        : UniBaseError("Load data error: " + file_name + ":" + std::to_string(line) + ": " + msg) {}
+};
+
+class InvalidSettingError : public UniBaseError {
+   public:
+    InvalidSettingError(const std::string &name, const std::string &value)
+        : UniBaseError("Invalid setting: " + name + " = " + value) {}
+};
+
+class InvalidPartitionError : public UniBaseError {
+   public:
+    InvalidPartitionError(const std::string &msg) : UniBaseError("Invalid partition: " + msg) {}
+};
+
+class ReadOnlyError : public UniBaseError {
+   public:
+    ReadOnlyError(const std::string &stmt) : UniBaseError("Database is opened read-only: " + stmt + " is not allowed") {}
+};
+
+class QueryMemoryLimitError : public UniBaseError {
+   public:
+    QueryMemoryLimitError(size_t requested, size_t limit)
+        : UniBaseError("Query memory limit exceeded: " + std::to_string(requested) + " bytes requested, limit is " +
+                       std::to_string(limit) + " bytes") {}
+};
+
+class StatementTooLongError : public UniBaseError {
+   public:
+    StatementTooLongError(size_t limit)
+        : UniBaseError("Statement is too long: limit is " + std::to_string(limit) + " bytes") {}
+};
+
 class PageNotExistError : public UniBaseError {
    public:
     PageNotExistError(const std::string &table_name, int page_no)
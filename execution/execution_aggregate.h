@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/common.h"
+#include "execution_sort_key.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+
+/*
+聚合算子共用的分组状态：每个分组的状态定长，依次为分组字段的规范化key(见execution_sort_key.h)、分组字段的原值、
+各个聚合函数的中间状态。key相同当且仅当各分组字段都相等，比较分组只需memcmp
+中间状态：COUNT为int64，SUM(int)为int64、SUM(float)为double，AVG为double的和与int64的个数，MIN/MAX为字段值
+输出记录为分组字段后接各个聚合结果：SUM(int)的结果为INT，SUM(float)为FLOAT，AVG为FLOAT，MIN/MAX与字段类型相同
+全部为0的状态表示空分组，输出COUNT为0，其余聚合结果为0
+*/
+class AggregateFunctions {
+   private:
+    // 一个聚合函数的输入字段、中间状态和输出字段
+    struct AggState {
+        AggType type;
+        ColMeta in;                             // 输入字段，COUNT(*)时不使用
+        size_t state_offset;                    // 中间状态在分组状态中的偏移
+        ColMeta out;                            // 输出字段
+    };
+
+    std::vector<ColMeta> cols_;                 // 输出记录的字段
+    size_t len_ = 0;                            // 输出记录的长度
+    std::vector<ColMeta> group_in_;             // 分组字段在输入记录中的位置
+    std::vector<SortKeyPart> key_parts_;        // 分组字段的规范化编码
+    size_t key_len_ = 0;                        // 规范化的key的长度
+    size_t values_len_ = 0;                     // 分组字段原值的总长度
+    std::vector<AggState> aggs_;
+    size_t state_len_ = 0;                      // 每个分组状态的长度
+
+   public:
+    AggregateFunctions() = default;
+
+    /**
+     * @param {AbstractExecutor*} prev 聚合算子的儿子节点
+     * @param {vector<TabCol>} group_cols 分组字段
+     * @param {vector<AggExpr>} aggs 聚合函数
+     */
+    AggregateFunctions(AbstractExecutor *prev, const std::vector<TabCol> &group_cols,
+                       const std::vector<AggExpr> &aggs) {
+        int offset = 0;
+        for (auto &group_col : group_cols) {
+            ColMeta col = prev->get_col_offset(group_col);
+            group_in_.push_back(col);
+            key_parts_.push_back({col.offset, col.type, col.len, false});
+            key_len_ += col.len;
+            values_len_ += col.len;
+            col.offset = offset;
+            offset += col.len;
+            cols_.push_back(col);
+        }
+        size_t state_offset = align8(key_len_ + values_len_);
+        for (auto &agg : aggs) {
+            AggState state;
+            state.type = agg.type;
+            if (agg.col.col_name != "*") {
+                state.in = prev->get_col_offset(agg.col);
+            } else if (agg.type != AGG_COUNT) {
+                throw InternalError("Unexpected aggregate function on *");
+            }
+            state.state_offset = state_offset;
+            state.out = {agg.output.tab_name, agg.output.col_name, TYPE_INT, sizeof(int), offset, false};
+            switch (agg.type) {
+                case AGG_COUNT: state_offset += sizeof(int64_t); break;
+                case AGG_SUM:
+                    state.out.type = state.in.type;
+                    state_offset += sizeof(int64_t);
+                    break;
+                case AGG_AVG:
+                    state.out.type = TYPE_FLOAT;
+                    state_offset += sizeof(double) + sizeof(int64_t);
+                    break;
+                default:  // AGG_MIN, AGG_MAX
+                    state.out.type = state.in.type;
+                    state.out.len = state.in.len;
+                    state_offset += align8(state.in.len);
+                    break;
+            }
+            if ((agg.type == AGG_SUM || agg.type == AGG_AVG) && state.in.type == TYPE_STRING) {
+                throw IncompatibleTypeError(agg.output.col_name, coltype2str(state.in.type));
+            }
+            offset += state.out.len;
+            cols_.push_back(state.out);
+            aggs_.push_back(state);
+        }
+        state_len_ = std::max<size_t>(state_offset, 8);
+        len_ = offset;
+    }
+
+    const std::vector<ColMeta> &cols() const { return cols_; }
+
+    size_t len() const { return len_; }
+
+    size_t key_len() const { return key_len_; }
+
+    size_t state_len() const { return state_len_; }
+
+    bool has_group_cols() const { return !group_in_.empty(); }
+
+    // 把输入记录的分组字段编码为规范化的key
+    void encode_key(const char *row, char *key) const { encode_sort_key(row, key_parts_, key); }
+
+    // 用分组的第一条记录初始化分组状态，key为该记录的规范化的key
+    void init(char *state, const char *key, const char *row) const {
+        memcpy(state, key, key_len_);
+        char *values = state + key_len_;
+        for (auto &col : group_in_) {
+            memcpy(values, row + col.offset, col.len);
+            values += col.len;
+        }
+        for (auto &agg : aggs_) {
+            char *s = state + agg.state_offset;
+            if (agg.type == AGG_MIN || agg.type == AGG_MAX) {
+                memcpy(s, row + agg.in.offset, agg.in.len);
+                continue;
+            }
+            memset(s, 0, agg.type == AGG_AVG ? sizeof(double) + sizeof(int64_t) : sizeof(int64_t));
+        }
+        update_accumulators(state, row);
+    }
+
+    // 把同一分组的一条记录聚合到分组状态中
+    void update(char *state, const char *row) const {
+        for (auto &agg : aggs_) {
+            char *s = state + agg.state_offset;
+            if (agg.type != AGG_MIN && agg.type != AGG_MAX) {
+                continue;
+            }
+            int cmp = ix_compare(row + agg.in.offset, s, agg.in.type, agg.in.len);
+            if (agg.type == AGG_MIN ? cmp < 0 : cmp > 0) {
+                memcpy(s, row + agg.in.offset, agg.in.len);
+            }
+        }
+        update_accumulators(state, row);
+    }
+
+    // 把同一分组在另一部分输入上的状态合并到state中，用于合并各worker分别聚合的结果
+    void merge(char *state, const char *other) const {
+        for (auto &agg : aggs_) {
+            char *s = state + agg.state_offset;
+            const char *o = other + agg.state_offset;
+            switch (agg.type) {
+                case AGG_COUNT: add<int64_t>(s, o); break;
+                case AGG_SUM:
+                    if (agg.in.type == TYPE_INT) {
+                        add<int64_t>(s, o);
+                    } else {
+                        add<double>(s, o);
+                    }
+                    break;
+                case AGG_AVG:
+                    add<double>(s, o);
+                    add<int64_t>(s + sizeof(double), o + sizeof(double));
+                    break;
+                default: {  // AGG_MIN, AGG_MAX
+                    int cmp = ix_compare(o, s, agg.in.type, agg.in.len);
+                    if (agg.type == AGG_MIN ? cmp < 0 : cmp > 0) {
+                        memcpy(s, o, agg.in.len);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // 由分组状态生成输出记录
+    void finalize(const char *state, char *out) const {
+        memcpy(out, state + key_len_, values_len_);
+        for (auto &agg : aggs_) {
+            const char *s = state + agg.state_offset;
+            char *dst = out + agg.out.offset;
+            switch (agg.type) {
+                case AGG_COUNT: {
+                    int64_t count;
+                    memcpy(&count, s, sizeof(count));
+                    int v = static_cast<int>(count);
+                    memcpy(dst, &v, sizeof(v));
+                    break;
+                }
+                case AGG_SUM:
+                    if (agg.in.type == TYPE_INT) {
+                        int64_t sum;
+                        memcpy(&sum, s, sizeof(sum));
+                        int v = static_cast<int>(sum);
+                        memcpy(dst, &v, sizeof(v));
+                    } else {
+                        double sum;
+                        memcpy(&sum, s, sizeof(sum));
+                        float v = static_cast<float>(sum);
+                        memcpy(dst, &v, sizeof(v));
+                    }
+                    break;
+                case AGG_AVG: {
+                    double sum;
+                    int64_t count;
+                    memcpy(&sum, s, sizeof(sum));
+                    memcpy(&count, s + sizeof(double), sizeof(count));
+                    float v = count == 0 ? 0.0f : static_cast<float>(sum / count);
+                    memcpy(dst, &v, sizeof(v));
+                    break;
+                }
+                default:  // AGG_MIN, AGG_MAX
+                    memcpy(dst, s, agg.in.len);
+                    break;
+            }
+        }
+    }
+
+   private:
+    static size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+    template <typename T>
+    static void add(char *dst, const char *src) {
+        T a, b;
+        memcpy(&a, dst, sizeof(T));
+        memcpy(&b, src, sizeof(T));
+        a += b;
+        memcpy(dst, &a, sizeof(T));
+    }
+
+    // 累加COUNT/SUM/AVG的中间状态
+    void update_accumulators(char *state, const char *row) const {
+        for (auto &agg : aggs_) {
+            char *s = state + agg.state_offset;
+            switch (agg.type) {
+                case AGG_COUNT: {
+                    int64_t count;
+                    memcpy(&count, s, sizeof(count));
+                    count++;
+                    memcpy(s, &count, sizeof(count));
+                    break;
+                }
+                case AGG_SUM:
+                    if (agg.in.type == TYPE_INT) {
+                        int64_t sum;
+                        memcpy(&sum, s, sizeof(sum));
+                        sum += input_int(row, agg);
+                        memcpy(s, &sum, sizeof(sum));
+                    } else {
+                        double sum;
+                        memcpy(&sum, s, sizeof(sum));
+                        sum += input_float(row, agg);
+                        memcpy(s, &sum, sizeof(sum));
+                    }
+                    break;
+                case AGG_AVG: {
+                    double sum;
+                    int64_t count;
+                    memcpy(&sum, s, sizeof(sum));
+                    memcpy(&count, s + sizeof(double), sizeof(count));
+                    sum += agg.in.type == TYPE_INT ? input_int(row, agg) : input_float(row, agg);
+                    count++;
+                    memcpy(s, &sum, sizeof(sum));
+                    memcpy(s + sizeof(double), &count, sizeof(count));
+                    break;
+                }
+                default: break;
+            }
+        }
+    }
+
+    static int input_int(const char *row, const AggState &agg) {
+        int v;
+        memcpy(&v, row + agg.in.offset, sizeof(v));
+        return v;
+    }
+
+    static double input_float(const char *row, const AggState &agg) {
+        float v;
+        memcpy(&v, row + agg.in.offset, sizeof(v));
+        return v;
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "common/common.h"
+#include "execution_filter_kernels.h"
+#include "index/ix_compare.h"
+#include "record/rm_zone_map.h"
+#include "row_batch.h"
+#include "system/sm_meta.h"
+
+/*
+ConditionFilter对记录求值一组AND连接的条件谓词
+构造时根据记录的字段元数据把条件中的字段解析为偏移，求值时不再按字段名查找
+条件的两侧可以是同一条记录中的任意两个字段，或者字段与常量(常量需已调用init_raw)
+批量求值时`字段 op 常量`的条件使用execution_filter_kernels.h中预先选定的过滤内核生成选择位图，
+内核按已观察到的通过率从低到高的顺序执行，过滤掉最多行的条件最先执行；字段与字段比较的条件逐行求值
+*/
+class ConditionFilter {
+   public:
+    ConditionFilter() = default;
+
+    /**
+     * @description: 解析条件
+     * @param {vector<ColMeta>&} cols 被求值记录的字段
+     * @param {vector<Condition>&} conds 条件，字段必须都在cols中
+     */
+    ConditionFilter(const std::vector<ColMeta> &cols, const std::vector<Condition> &conds) {
+        bool avx2 = ix_cpu_has_avx2();
+        for (auto &cond : conds) {
+            const ColMeta &lhs = find_col(cols, cond.lhs_col);
+            BoundCondition bound;
+            bound.op = cond.op;
+            bound.type = lhs.type;
+            bound.len = lhs.len;
+            bound.lhs_offset = lhs.offset;
+            if (cond.is_rhs_val) {
+                assert(cond.rhs_val.raw != nullptr);
+                bound.rhs_val = cond.rhs_val.raw;
+                kernels_.push_back({filter_kernel(bound.type, bound.op, avx2), conds_.size()});
+            } else {
+                bound.rhs_offset = find_col(cols, cond.rhs_col).offset;
+                residual_.push_back(conds_.size());
+            }
+            conds_.push_back(std::move(bound));
+        }
+    }
+
+    bool empty() const { return conds_.empty(); }
+
+    // 记录是否满足所有条件
+    bool eval(const char *rec) const {
+        for (auto &cond : conds_) {
+            const char *rhs = cond.rhs_val != nullptr ? cond.rhs_val->data : rec + cond.rhs_offset;
+            if (!eval_op(ix_compare(rec + cond.lhs_offset, rhs, cond.type, cond.len), cond.op)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @description: 从批次的选择向量中去掉不满足条件的行
+     * 先用过滤内核在选择位图上依次求值常量条件，位图全为0时提前结束，再按位图重建选择向量并求值其余条件
+     */
+    void filter(RowBatch &batch) {
+        if (conds_.empty() || batch.empty()) {
+            return;
+        }
+        size_t n = batch.num_rows();
+        bits_.assign((n + 63) / 64, 0);
+        for (auto r : batch.selection()) {
+            bits_[r / 64] |= 1ULL << (r % 64);
+        }
+        const char *data = batch.data();
+        size_t tuple_len = batch.tuple_len();
+        filter_columns(n, bits_, [data, tuple_len](int offset, size_t *stride) {
+            *stride = tuple_len;
+            return data + offset;
+        });
+
+        auto &sel = batch.selection();
+        sel.clear();
+        for (size_t w = 0; w < bits_.size(); w++) {
+            for (uint64_t rest = bits_[w]; rest != 0; rest &= rest - 1) {
+                uint32_t r = static_cast<uint32_t>(w * 64 + __builtin_ctzll(rest));
+                if (eval_residual(batch.data() + r * batch.tuple_len())) {
+                    sel.push_back(r);
+                }
+            }
+        }
+    }
+
+    /**
+     * @description: 用过滤内核在按列访问的n条记录上求值常量条件，把不满足条件的记录从选择位图中去掉。
+     *               PAX页面中同一字段的值存放在minipage中，内核可以直接读取它们而不需要先拼出完整的记录
+     * @param {vector<uint64_t>&} bits 选择位图，至少有(n + 63) / 64个字
+     * @param {Column} column 调用形式为column(offset, &stride)，返回第0条记录中偏移为offset的字段的地址，
+     *        第i条记录的该字段位于返回值 + i * stride
+     * 字段与字段比较的条件不在这里求值，调用者对剩下的记录调用eval_residual()
+     */
+    template <typename Column>
+    void filter_columns(size_t n, std::vector<uint64_t> &bits, Column column) {
+        filter_conditions(bits, [n, &column](const ConstCondition &cond, uint64_t *bits) {
+            size_t stride;
+            const char *col = column(cond.offset, &stride);
+            cond.kernel(col, stride, n, cond.value, cond.len, bits);
+        });
+    }
+
+    // 一个`字段 op 常量`的条件，以及为它选定的过滤内核
+    struct ConstCondition {
+        int offset;             // 字段在记录中的偏移
+        ColType type;
+        int len;
+        CompOp op;
+        const char *value;      // 常量的raw数据
+        FilterKernel kernel;
+    };
+
+    /**
+     * @description: 与filter_columns()相同，但每个常量条件由调用者求值，用于数据不能直接交给内核的情况，
+     *               例如压缩的PAX页面在编码后的数据上比较，不能比较时再解码出该列交给cond.kernel
+     * @param {Eval} eval 调用形式为eval(cond, bits)，把不满足cond的记录从选择位图bits中去掉
+     */
+    template <typename Eval>
+    void filter_conditions(std::vector<uint64_t> &bits, Eval eval) {
+        size_t live = count_bits(bits);
+        for (auto &kernel : kernels_) {
+            const BoundCondition &cond = conds_[kernel.cond];
+            eval(ConstCondition{cond.lhs_offset, cond.type, cond.len, cond.op, cond.rhs_val->data, kernel.fn},
+                 bits.data());
+            size_t passed = count_bits(bits);
+            kernel.evaluated += live;
+            kernel.passed += passed;
+            live = passed;
+            if (live == 0) {
+                break;
+            }
+        }
+        // 通过率低的条件排在前面，通过率相同时保持原有顺序
+        std::stable_sort(kernels_.begin(), kernels_.end(), [](const KernelCondition &a, const KernelCondition &b) {
+            return a.pass_rate() < b.pass_rate();
+        });
+    }
+
+    /**
+     * @description: 字段在zone map中有范围的`字段 op 常量`条件，顺序扫描用它们跳过不可能有满足条件的记录的页面
+     * @param {RmZoneMap&} zone_map 被扫描的表的zone map
+     */
+    std::vector<RmZoneCondition> zone_conditions(const RmZoneMap &zone_map) const {
+        std::vector<RmZoneCondition> zone_conds;
+        for (auto &kernel : kernels_) {
+            const BoundCondition &cond = conds_[kernel.cond];
+            int column = zone_map.find_column(cond.lhs_offset, cond.type);
+            if (column < 0 || cond.len != sizeof(int32_t)) {
+                continue;
+            }
+            double value = RmZoneMap::column_value(cond.type, cond.rhs_val->data);
+            if (value == value) {
+                zone_conds.push_back(RmZoneCondition{column, cond.op, value});
+            }
+        }
+        return zone_conds;
+    }
+
+    // 是否有需要完整记录才能求值的字段与字段比较的条件
+    bool has_residual() const { return !residual_.empty(); }
+
+    // 记录是否满足所有字段与字段比较的条件
+    bool eval_residual(const char *rec) const {
+        for (auto i : residual_) {
+            auto &cond = conds_[i];
+            if (!eval_op(ix_compare(rec + cond.lhs_offset, rec + cond.rhs_offset, cond.type, cond.len), cond.op)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool eval_op(int cmp, CompOp op) {
+        switch (op) {
+            case OP_EQ: return cmp == 0;
+            case OP_NE: return cmp != 0;
+            case OP_LT: return cmp < 0;
+            case OP_GT: return cmp > 0;
+            case OP_LE: return cmp <= 0;
+            case OP_GE: return cmp >= 0;
+            default: throw InternalError("Unexpected comparison operator");
+        }
+    }
+
+    static const ColMeta &find_col(const std::vector<ColMeta> &cols, const TabCol &target) {
+        for (auto &col : cols) {
+            if (col.tab_name == target.tab_name && col.name == target.col_name) {
+                return col;
+            }
+        }
+        throw ColumnNotFoundError(target.tab_name + '.' + target.col_name);
+    }
+
+   private:
+    struct BoundCondition {
+        CompOp op;
+        ColType type;
+        int len;
+        int lhs_offset;
+        int rhs_offset = 0;
+        std::shared_ptr<RmRecord> rhs_val;  // 右侧为常量时指向常量的raw
+    };
+
+    // 使用过滤内核求值的常量条件，以及它的通过率统计
+    struct KernelCondition {
+        FilterKernel fn;
+        size_t cond;                // 在conds_中的下标
+        size_t evaluated = 0;       // 执行内核时仍然有效的行数
+        size_t passed = 0;          // 其中满足条件的行数
+
+        double pass_rate() const { return evaluated == 0 ? 1.0 : static_cast<double>(passed) / evaluated; }
+    };
+
+    static size_t count_bits(const std::vector<uint64_t> &bits) {
+        size_t count = 0;
+        for (auto word : bits) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+    std::vector<BoundCondition> conds_;
+    std::vector<KernelCondition> kernels_;
+    std::vector<size_t> residual_;      // 字段与字段比较的条件在conds_中的下标
+    std::vector<uint64_t> bits_;        // filter()使用的选择位图
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "common/common.h"
+#include "index/ix_search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_KERNEL_X86
+#endif
+
+/*
+`col op 常量`形式条件的过滤内核，用于在RowBatch上批量求值条件
+批次中的记录按行存放，同一字段在相邻记录之间相隔stride(即记录长度)字节
+内核的结果是选择位图：第i行对应bits[i / 64]的第i % 64位，内核把满足条件的结果与bits按位与，
+因此多个条件依次作用于同一位图即为它们的AND；整个字已经为0的64行会被直接跳过
+比较语义与ix_compare一致：先求lt = a < b和gt = a > b，EQ为!lt && !gt，其余运算符由lt/gt组合得到
+TYPE_INT/TYPE_FLOAT的AVX2内核用gather一次读取8行的字段，通过target属性单独编译，调用前需由ix_cpu_has_avx2()确认CPU支持；
+PAX页面的minipage中同一字段的值紧密排列(stride等于字段长度)，此时AVX2内核改用连续的向量读取
+*/
+
+// 过滤内核，col指向批次第0行的字段，value指向常量，len为字段长度
+using FilterKernel = void (*)(const char *col, size_t stride, size_t n, const char *value, int len, uint64_t *bits);
+
+template <CompOp op>
+inline bool filter_pred(bool lt, bool gt) {
+    switch (op) {
+        case OP_EQ: return !lt && !gt;
+        case OP_NE: return lt || gt;
+        case OP_LT: return lt;
+        case OP_GT: return gt;
+        case OP_LE: return !gt;
+        default: return !lt;  // OP_GE
+    }
+}
+
+template <typename T, CompOp op>
+inline void filter_kernel_scalar(const char *col, size_t stride, size_t n, const char *value, int len, uint64_t *bits) {
+    T v;
+    memcpy(&v, value, sizeof(T));
+    for (size_t w = 0; w * 64 < n; w++) {
+        if (bits[w] == 0) {
+            continue;
+        }
+        size_t begin = w * 64;
+        size_t end = std::min(n, begin + 64);
+        uint64_t mask = 0;
+        for (size_t i = begin; i < end; i++) {
+            T a;
+            memcpy(&a, col + i * stride, sizeof(T));
+            mask |= static_cast<uint64_t>(filter_pred<op>(a < v, a > v)) << (i - begin);
+        }
+        bits[w] &= mask;
+    }
+}
+
+// 定长字符串只对位图中仍然置1的行调用memcmp
+template <CompOp op>
+inline void filter_kernel_string(const char *col, size_t stride, size_t n, const char *value, int len, uint64_t *bits) {
+    for (size_t w = 0; w * 64 < n; w++) {
+        for (uint64_t rest = bits[w]; rest != 0; rest &= rest - 1) {
+            int b = __builtin_ctzll(rest);
+            int cmp = memcmp(col + (w * 64 + b) * stride, value, len);
+            if (!filter_pred<op>(cmp < 0, cmp > 0)) {
+                bits[w] &= ~(1ULL << b);
+            }
+        }
+    }
+}
+
+#ifdef FILTER_KERNEL_X86
+
+// lt/gt为8行的比较结果掩码，返回满足条件的8位
+template <CompOp op>
+inline int filter_pred_mask8(int lt, int gt) {
+    switch (op) {
+        case OP_EQ: return ~(lt | gt) & 0xff;
+        case OP_NE: return lt | gt;
+        case OP_LT: return lt;
+        case OP_GT: return gt;
+        case OP_LE: return ~gt & 0xff;
+        default: return ~lt & 0xff;  // OP_GE
+    }
+}
+
+template <typename T, CompOp op, bool contiguous>
+__attribute__((target("avx2"))) inline int filter_mask8_avx2(const char *col, __m256i vindex, T v) {
+    if constexpr (std::is_same_v<T, float>) {
+        __m256 a = contiguous ? _mm256_loadu_ps(reinterpret_cast<const float *>(col))
+                              : _mm256_i32gather_ps(reinterpret_cast<const float *>(col), vindex, 1);
+        __m256 t = _mm256_set1_ps(v);
+        int lt = _mm256_movemask_ps(_mm256_cmp_ps(a, t, _CMP_LT_OQ));
+        int gt = _mm256_movemask_ps(_mm256_cmp_ps(a, t, _CMP_GT_OQ));
+        return filter_pred_mask8<op>(lt, gt);
+    } else {
+        __m256i a = contiguous ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(col))
+                               : _mm256_i32gather_epi32(reinterpret_cast<const int *>(col), vindex, 1);
+        __m256i t = _mm256_set1_epi32(v);
+        int lt = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(t, a)));
+        int gt = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(a, t)));
+        return filter_pred_mask8<op>(lt, gt);
+    }
+}
+
+// contiguous为true时字段紧密排列，8行的字段用一次向量读取代替gather
+template <typename T, CompOp op, bool contiguous>
+__attribute__((target("avx2"))) inline void filter_kernel_avx2_impl(const char *col, size_t stride, size_t n, T v,
+                                                                    uint64_t *bits) {
+    // 8行中各行字段相对第0行的字节偏移
+    __m256i vindex = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                        _mm256_set1_epi32(static_cast<int>(stride)));
+    for (size_t w = 0; w * 64 < n; w++) {
+        if (bits[w] == 0) {
+            continue;
+        }
+        size_t begin = w * 64;
+        size_t end = std::min(n, begin + 64);
+        uint64_t mask = 0;
+        size_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            mask |= static_cast<uint64_t>(filter_mask8_avx2<T, op, contiguous>(col + i * stride, vindex, v))
+                    << (i - begin);
+        }
+        for (; i < end; i++) {
+            T a;
+            memcpy(&a, col + i * stride, sizeof(T));
+            mask |= static_cast<uint64_t>(filter_pred<op>(a < v, a > v)) << (i - begin);
+        }
+        bits[w] &= mask;
+    }
+}
+
+template <typename T, CompOp op>
+__attribute__((target("avx2"))) inline void filter_kernel_avx2(const char *col, size_t stride, size_t n,
+                                                               const char *value, int len, uint64_t *bits) {
+    T v;
+    memcpy(&v, value, sizeof(T));
+    if (stride == sizeof(T)) {
+        filter_kernel_avx2_impl<T, op, true>(col, stride, n, v, bits);
+    } else {
+        filter_kernel_avx2_impl<T, op, false>(col, stride, n, v, bits);
+    }
+}
+
+#endif
+
+template <CompOp op>
+inline FilterKernel filter_kernel_for_op(ColType type, bool avx2) {
+#ifdef FILTER_KERNEL_X86
+    if (avx2 && type == TYPE_INT) {
+        return filter_kernel_avx2<int32_t, op>;
+    }
+    if (avx2 && type == TYPE_FLOAT) {
+        return filter_kernel_avx2<float, op>;
+    }
+#endif
+    switch (type) {
+        case TYPE_INT: return filter_kernel_scalar<int32_t, op>;
+        case TYPE_FLOAT: return filter_kernel_scalar<float, op>;
+        case TYPE_STRING: return filter_kernel_string<op>;
+        default: throw InternalError("Unexpected data type");
+    }
+}
+
+/**
+ * @description: 选择`col op 常量`条件的过滤内核，字段类型和运算符在编译期确定
+ * @return {FilterKernel} 过滤内核
+ * @param {ColType} type 字段类型
+ * @param {CompOp} op 比较运算符
+ * @param {bool} avx2 是否使用AVX2内核，为false或非x86平台时使用标量内核
+ */
+inline FilterKernel filter_kernel(ColType type, CompOp op, bool avx2) {
+    switch (op) {
+        case OP_EQ: return filter_kernel_for_op<OP_EQ>(type, avx2);
+        case OP_NE: return filter_kernel_for_op<OP_NE>(type, avx2);
+        case OP_LT: return filter_kernel_for_op<OP_LT>(type, avx2);
+        case OP_GT: return filter_kernel_for_op<OP_GT>(type, avx2);
+        case OP_LE: return filter_kernel_for_op<OP_LE>(type, avx2);
+        case OP_GE: return filter_kernel_for_op<OP_GE>(type, avx2);
+        default: throw InternalError("Unexpected comparison operator");
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common/context.h"
+#include "execution_defs.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+IndexWriteBuffer缓存一条DML语句对表上各个索引的修改，语句结束时由flush()统一写入索引
+每个索引的修改排序后一次性批量执行(IxIndexHandle::insert_entries/delete_entries)，
+相邻的key落在同一个叶子中时复用已经pin住并加锁的叶子，而不是每行每个索引都从根结点下降；
+哈希索引按hash值的顺序批量执行
+索引key从语句的内存池Context::arena_中分配，语句结束后统一释放
+*/
+class IndexWriteBuffer {
+   public:
+    IndexWriteBuffer(const TableHandle &table, Context *context) : context_(context) {
+        for (auto &index : table.indexes) {
+            indexes_.push_back({&index, index.meta, {}, {}, {}});
+        }
+    }
+
+    /**
+     * @description: 记录插入一条记录后需要插入的索引项
+     * @param {char*} record 插入的记录
+     * @param {Rid&} rid 记录的位置
+     */
+    void insert_record(const char *record, const Rid &rid) {
+        for (auto &changes : indexes_) {
+            changes.insert_keys.push_back(make_key(*changes.meta, record));
+            changes.insert_rids.push_back(rid);
+        }
+    }
+
+    /**
+     * @description: 记录删除一条记录后需要删除的索引项
+     * @param {char*} record 删除的记录
+     */
+    void delete_record(const char *record) {
+        for (auto &changes : indexes_) {
+            changes.delete_keys.push_back(make_key(*changes.meta, record));
+        }
+    }
+
+    /**
+     * @description: 记录更新一条记录后需要修改的索引项，key没有变化的索引不做修改
+     * @param {char*} old_record 更新前的记录
+     * @param {char*} new_record 更新后的记录
+     * @param {Rid&} rid 记录的位置
+     */
+    void update_record(const char *old_record, const char *new_record, const Rid &rid) {
+        for (auto &changes : indexes_) {
+            char *old_key = make_key(*changes.meta, old_record);
+            char *new_key = make_key(*changes.meta, new_record);
+            if (memcmp(old_key, new_key, changes.meta->col_tot_len) != 0) {
+                changes.delete_keys.push_back(old_key);
+                changes.insert_keys.push_back(new_key);
+                changes.insert_rids.push_back(rid);
+            }
+        }
+    }
+
+    /**
+     * @description: 把缓存的修改写入索引，每个索引先删除再插入，使语句内key互换的更新也能得到正确结果
+     */
+    void flush() {
+        for (auto &changes : indexes_) {
+            if (!changes.delete_keys.empty()) {
+                changes.index->delete_entries(changes.delete_keys, context_->txn_);
+                changes.delete_keys.clear();
+            }
+            if (!changes.insert_keys.empty()) {
+                changes.index->insert_entries(changes.insert_keys, changes.insert_rids, context_->txn_);
+                changes.insert_keys.clear();
+                changes.insert_rids.clear();
+            }
+        }
+    }
+
+   private:
+    struct IndexChanges {
+        const IndexHandle *index;
+        const IndexMeta *meta;
+        std::vector<const char *> delete_keys;
+        std::vector<const char *> insert_keys;
+        std::vector<Rid> insert_rids;
+    };
+
+    char *make_key(const IndexMeta &index, const char *record) {
+        char *key = context_->arena_.allocate(index.col_tot_len);
+        int offset = 0;
+        for (auto &col : index.cols) {
+            memcpy(key + offset, record + col.offset, col.len);
+            offset += col.len;
+        }
+        return key;
+    }
+
+    Context *context_;
+    std::vector<IndexChanges> indexes_;
+};
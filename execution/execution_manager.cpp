@@ -7,6 +7,8 @@
 #include "executor_projection.h"
 #include "executor_seq_scan.h"
 #include "executor_update.h"
+#include "explain.h"
+#include "common/metrics.h"
 #include "index/ix.h"
 #include "record_printer.h"
 
@@ -15,12 +17,17 @@ const char *help_info = "Supported SQL syntax:\n"
                    "command:\n"
                    "  CREATE TABLE table_name (column_name type [, column_name type ...])\n"
                    "  DROP TABLE table_name\n"
-                   "  CREATE INDEX table_name (column_name)\n"
+                   "  CREATE INDEX table_name (column_name) [USING BTREE | HASH]\n"
                    "  DROP INDEX table_name (column_name)\n"
-                   "  INSERT INTO table_name VALUES (value [, value ...])\n"
+                   "  SHOW {TABLES | STATS}\n"
+                   "  ANALYZE table_name\n"
+                   "  VACUUM table_name\n"
+                   "  COPY table_name FROM 'file.csv'\n"
+                   "  INSERT INTO table_name VALUES (value [, value ...]) [, (value [, value ...]) ...]\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
                    "  SELECT selector FROM table_name [WHERE where_clause]\n"
+                   "  EXPLAIN [ANALYZE] {SELECT | INSERT | DELETE | UPDATE} ...\n"
                    "type:\n"
                    "  {INT | FLOAT | CHAR(n)}\n"
                    "where_clause:\n"
@@ -40,7 +47,7 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
         switch(x->tag) {
             case T_CreateTable:
             {
-                sm_manager_->create_table(x->tab_name_, x->cols_, context);
+                sm_manager_->create_table(x->tab_name_, x->cols_, context, x->layout_, x->partition_);
                 break;
             }
             case T_DropTable:
@@ -50,7 +57,7 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
             }
             case T_CreateIndex:
             {
-                sm_manager_->create_index(x->tab_name_, x->tab_col_names_, context);
+                sm_manager_->create_index(x->tab_name_, x->tab_col_names_, context, x->index_type_);
                 break;
             }
             case T_DropIndex:
@@ -65,7 +72,7 @@ void QlManager::run_mutli_query(std::shared_ptr<Plan> plan, Context *context){
     }
 }
 
-// 执行help; show tables; desc table; begin; commit; abort;语句
+// 执行help; show tables; show stats; desc table; analyze table; vacuum table; copy table; begin; commit; abort;语句
 void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Context *context) {
     if (auto x = std::dynamic_pointer_cast<OtherPlan>(plan)) {
         switch(x->tag) {
@@ -80,11 +87,31 @@ void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Co
                 sm_manager_->show_tables(context);
                 break;
             }
+            case T_ShowStats:
+            {
+                show_stats(context);
+                break;
+            }
             case T_DescTable:
             {
                 sm_manager_->desc_table(x->tab_name_, context);
                 break;
             }
+            case T_Analyze:
+            {
+                sm_manager_->analyze_table(x->tab_name_, context);
+                break;
+            }
+            case T_Vacuum:
+            {
+                sm_manager_->vacuum_table(x->tab_name_, context);
+                break;
+            }
+            case T_Load:
+            {
+                sm_manager_->load_table(x->tab_name_, x->file_name_, context);
+                break;
+            }
             case T_Transaction_begin:
             {
                 // 显示开启一个事务
@@ -117,7 +144,18 @@ void QlManager::run_cmd_utility(std::shared_ptr<Plan> plan, txn_id_t *txn_id, Co
     }
 }
 
-// 执行select语句，select语句的输出除了需要返回客户端外，还需要写入output.txt文件中
+// 结果日志中的一行："| v1 | v2 |"
+static void append_log_line(const std::vector<std::string> &columns, std::string &log_text) {
+    log_text += '|';
+    for (auto &col : columns) {
+        log_text += ' ';
+        log_text += col;
+        log_text += " |";
+    }
+    log_text += '\n';
+}
+
+// 执行select语句，select语句的输出除了需要返回客户端外，还需要写入结果日志output.txt中
 void QlManager::select_from(std::unique_ptr<AbstractExecutor> executorTreeRoot, std::vector<TabCol> sel_cols, 
                             Context *context) {
     std::vector<std::string> captions;
@@ -126,57 +164,125 @@ void QlManager::select_from(std::unique_ptr<AbstractExecutor> executorTreeRoot,
         captions.push_back(sel_col.col_name);
     }
 
+    if (context->binary_result_) {
+        select_binary(std::move(executorTreeRoot), captions, context);
+        return;
+    }
+
     // Print header into buffer
     RecordPrinter rec_printer(sel_cols.size());
     rec_printer.print_separator(context);
     rec_printer.print_record(captions, context);
     rec_printer.print_separator(context);
-    // print header into file
-    std::fstream outfile;
-    outfile.open("output.txt", std::ios::out | std::ios::app);
-    outfile << "|";
-    for(int i = 0; i < captions.size(); ++i) {
-        outfile << " " << captions[i] << " |";
+    // print header into result log，整条语句的输出生成完后一次提交，不记录结果日志时不生成
+    bool log_result = context->result_log_ != nullptr;
+    std::string log_text;
+    if (log_result) {
+        append_log_line(captions, log_text);
     }
-    outfile << "\n";
 
     // Print records
     size_t num_rec = 0;
-    // 执行query_plan
-    for (executorTreeRoot->beginTuple(); !executorTreeRoot->is_end(); executorTreeRoot->nextTuple()) {
-        auto Tuple = executorTreeRoot->Next();
-        std::vector<std::string> columns;
-        for (auto &col : executorTreeRoot->cols()) {
-            std::string col_str;
-            char *rec_buf = Tuple->data + col.offset;
-            if (col.type == TYPE_INT) {
-                col_str = std::to_string(*(int *)rec_buf);
-            } else if (col.type == TYPE_FLOAT) {
-                col_str = std::to_string(*(float *)rec_buf);
-            } else if (col.type == TYPE_STRING) {
-                col_str = std::string((char *)rec_buf, col.len);
-                col_str.resize(strlen(col_str.c_str()));
+    // 执行query_plan，按批次取出结果
+    RowBatch batch;
+    for (executorTreeRoot->beginBatch(); executorTreeRoot->NextBatch(batch);) {
+        for (size_t r = 0; r < batch.size(); r++) {
+            const char *tuple = batch.row(r);
+            std::vector<std::string> columns;
+            for (auto &col : executorTreeRoot->cols()) {
+                std::string col_str;
+                const char *rec_buf = tuple + col.offset;
+                if (col.type == TYPE_INT) {
+                    col_str = std::to_string(*(int *)rec_buf);
+                } else if (col.type == TYPE_FLOAT) {
+                    col_str = std::to_string(*(float *)rec_buf);
+                } else if (col.type == TYPE_STRING) {
+                    col_str = std::string((char *)rec_buf, col.len);
+                    col_str.resize(strlen(col_str.c_str()));
+                }
+                columns.push_back(col_str);
             }
-            columns.push_back(col_str);
+            // print record into buffer
+            rec_printer.print_record(columns, context);
+            // print record into result log
+            if (log_result) {
+                append_log_line(columns, log_text);
+            }
+            num_rec++;
         }
-        // print record into buffer
-        rec_printer.print_record(columns, context);
-        // print record into file
-        outfile << "|";
-        for(int i = 0; i < columns.size(); ++i) {
-            outfile << " " << columns[i] << " |";
+        // 每批记录输出后就发送给客户端，客户端在查询结束前即可收到前面的结果
+        context->flush_result();
+    }
+    if (log_result) {
+        if (context->captured_log_ != nullptr) {
+            *context->captured_log_ = log_text;
         }
-        outfile << "\n";
-        num_rec++;
+        context->result_log_->append(std::move(log_text));
     }
-    outfile.close();
     // Print footer into buffer
     rec_printer.print_separator(context);
     // Print record count into buffer
     RecordPrinter::print_record_count(num_rec, context);
 }
 
+// 以二进制格式返回select的结果，记录中的值直接编码，不格式化为文本，也不写入output.txt
+void QlManager::select_binary(std::unique_ptr<AbstractExecutor> executorTreeRoot, const std::vector<std::string> &captions,
+                              Context *context) {
+    BinaryRecordPrinter printer(executorTreeRoot->cols());
+    printer.print_header(captions, context);
+    uint64_t num_rec = 0;
+    RowBatch batch;
+    for (executorTreeRoot->beginBatch(); executorTreeRoot->NextBatch(batch);) {
+        for (size_t r = 0; r < batch.size(); r++) {
+            printer.print_record(batch.row(r), context);
+        }
+        num_rec += batch.size();
+        context->flush_result();
+    }
+    printer.print_footer(num_rec, context);
+}
+
 // 执行DML语句
 void QlManager::run_dml(std::unique_ptr<AbstractExecutor> exec){
     exec->Next();
+}
+
+// 输出引擎的计数器和延迟直方图，每个指标一行。指标随运行变化，不写入结果日志
+void QlManager::show_stats(Context *context) {
+    for (auto &line : EngineMetrics::get().format_text()) {
+        RecordPrinter::print_line(line, context);
+    }
+}
+
+/**
+ * @description: 输出EXPLAIN的计划树。EXPLAIN ANALYZE时先执行语句，select的结果不返回给客户端，
+ *               INSERT/UPDATE/DELETE的修改照常生效
+ * @param {unique_ptr<AbstractExecutor>} executorTreeRoot 包装了执行统计的算子树，EXPLAIN时为空
+ * @param {bool} is_select 被解释的语句是否为select
+ * @param {ExplainStats&} stats 计划描述和各算子的执行统计
+ * @param {time_point} start_time 开始生成算子的时间，UPDATE/DELETE查找记录的时间也计入执行时间
+ */
+void QlManager::explain(std::unique_ptr<AbstractExecutor> executorTreeRoot, bool is_select, const ExplainStats &stats,
+                        std::chrono::steady_clock::time_point start_time, Context *context) {
+    uint64_t total_ns = 0;
+    if (stats.analyze()) {
+        if (is_select) {
+            RowBatch batch;
+            for (executorTreeRoot->beginBatch(); executorTreeRoot->NextBatch(batch);) {
+            }
+        } else {
+            executorTreeRoot->Next();
+        }
+        total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time)
+                       .count();
+    }
+    std::string log_text;
+    for (auto &line : stats.format(total_ns)) {
+        RecordPrinter::print_line(line, context);
+        log_text += line;
+        log_text += '\n';
+    }
+    if (context->result_log_ != nullptr) {
+        context->result_log_->append(std::move(log_text));
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -15,6 +16,7 @@
 #include "executor_abstract.h"
 #include "transaction/transaction_manager.h"
 
+class ExplainStats;
 
 class QlManager {
    private:
@@ -31,4 +33,13 @@ class QlManager {
                         Context *context);
 
     void run_dml(std::unique_ptr<AbstractExecutor> exec);
+
+    void explain(std::unique_ptr<AbstractExecutor> executorTreeRoot, bool is_select, const ExplainStats &stats,
+                 std::chrono::steady_clock::time_point start_time, Context *context);
+
+   private:
+    void show_stats(Context *context);
+
+    void select_binary(std::unique_ptr<AbstractExecutor> executorTreeRoot, const std::vector<std::string> &captions,
+                       Context *context);
 };
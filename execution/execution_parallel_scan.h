@@ -0,0 +1,393 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "common/thread_pool.h"
+#include "execution_filter.h"
+#include "execution_pax_scan.h"
+#include "execution_projector.h"
+#include "execution_snapshot.h"
+#include "record/rm.h"
+#include "row_batch.h"
+
+/**
+ * @description: 所有并行扫描共用的线程池，第一次使用时创建，大小为PARALLEL_SCAN_THREADS，为0时每个核一个线程。
+ *               它由执行请求的worker线程创建，因此同样屏蔽了SIGINT
+ */
+inline ThreadPool &scan_worker_pool() {
+    static ThreadPool pool(PARALLEL_SCAN_THREADS > 0 ? PARALLEL_SCAN_THREADS
+                                                     : std::max(1u, std::thread::hardware_concurrency()),
+                           BUFFER_POOL_NUMA);
+    return pool;
+}
+
+/*
+MorselScan把一张表的顺序扫描分给多个worker并行执行
+1. 数据页[RM_FIRST_RECORD_PAGE, num_pages)按PARALLEL_SCAN_MORSEL_PAGES个页面切分为morsel，worker通过原子计数器
+   领取下一个morsel，先完成的worker自然领取更多的morsel，不需要预先分配。页数在扫描开始时确定
+2. 每个worker有自己的过滤条件副本，扫描到的记录整批过滤后再投影，输出的批次之间没有顺序。
+   读取快照时每个worker也有自己的SnapshotScan，每个morsel中已删除的记录由扫描该morsel的worker输出；
+   PAX格式的表不读取快照时，每个morsel由PaxBatchScan直接在minipage上过滤和投影；
+   各worker的RmScan共用由过滤条件得到的zone map条件，跳过不可能有满足条件的记录的页面
+3. 发起扫描的线程本身也领取morsel，线程池忙于其他查询时扫描仍然能完成，只是并行度降低；
+   结束扫描时只等待已经开始执行的worker，仍在线程池队列中的任务开始后发现扫描已结束会直接返回
+两种用法：
+- start()/next()：线程池中的worker把结果批次放入有界队列，由发起扫描的线程逐批取出，用于SeqScanExecutor::NextBatch
+- run()：每个worker直接在自己的线程上处理结果批次，用于聚合等可以按worker分别计算再合并的算子
+*/
+class MorselScan : public std::enable_shared_from_this<MorselScan> {
+   public:
+    // 每个worker处理结果批次的回调，参数为worker的编号和批次，返回false时停止整个扫描
+    using Consumer = std::function<bool(size_t, RowBatch &)>;
+
+    /**
+     * @param {SnapshotScan*} snapshot 读取快照时各worker复制的快照扫描，为空时读取堆表中最新的记录
+     */
+    MorselScan(const RmFileHandle *file_handle, const ConditionFilter &filter, const ColumnProjector &projector,
+               size_t rec_len, const SnapshotScan *snapshot = nullptr)
+        : file_handle_(file_handle),
+          filter_(filter),
+          zone_conds_(filter.zone_conditions(file_handle->zone_map())),
+          projector_(projector),
+          rec_len_(rec_len),
+          snapshot_(snapshot),
+          next_page_(RM_FIRST_RECORD_PAGE),
+          end_page_(file_handle->get_file_hdr().num_pages),
+          local_(this) {}
+
+    ~MorselScan() { finish(); }
+
+    /**
+     * @description: 并行扫描需要的worker数(包括发起扫描的线程)，表的页面少于PARALLEL_SCAN_MIN_PAGES时为1
+     */
+    static size_t num_workers(const RmFileHandle *file_handle) {
+        int num_pages = file_handle->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
+        if (num_pages < PARALLEL_SCAN_MIN_PAGES) {
+            return 1;
+        }
+        size_t num_morsels = (num_pages + PARALLEL_SCAN_MORSEL_PAGES - 1) / PARALLEL_SCAN_MORSEL_PAGES;
+        return std::min(scan_worker_pool().size(), num_morsels);
+    }
+
+    /**
+     * @description: 向线程池提交num_producers个worker，它们扫描得到的批次由next()取出
+     */
+    void start(size_t num_producers) {
+        capacity_ = 2 * (num_producers + 1);
+        for (size_t i = 0; i < num_producers; i++) {
+            scan_worker_pool().submit([self = shared_from_this()] { self->produce(); });
+        }
+    }
+
+    /**
+     * @description: 取出下一批满足条件的记录，队列为空时发起扫描的线程自己扫描一个morsel
+     * @return {bool} 扫描完所有morsel且队列为空时结束扫描并返回false
+     */
+    bool next(RowBatch &batch) {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(latch_);
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                if (!queue_.empty()) {
+                    std::swap(batch, queue_.front());
+                    queue_.pop_front();
+                    not_full_.notify_one();
+                    return true;
+                }
+            }
+            if (!local_done_) {
+                if (local_.next(batch)) {
+                    return true;
+                }
+                local_done_ = true;
+                continue;
+            }
+            // 所有morsel都已被领取，等待其余worker输出它们的morsel
+            std::unique_lock<std::mutex> lock(latch_);
+            state_cv_.wait(lock, [this] { return !queue_.empty() || running_ == 0 || error_; });
+            if (queue_.empty() && !error_) {
+                lock.unlock();
+                finish();
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @description: 以num_workers个worker并行扫描，发起扫描的线程是0号worker，其余worker来自线程池。
+     *               consume在各worker的线程上并发调用，同一个worker的调用是串行的。返回时所有worker都已结束
+     * @return {bool} 扫描是否完成，consume返回false而停止时为false
+     * @param {size_t} num_workers worker数，worker编号在[0, num_workers)内
+     * @param {Consumer&} consume 处理每个worker扫描得到的批次
+     */
+    bool run(size_t num_workers, const Consumer &consume) {
+        auto work = [this, &consume](size_t id) {
+            Worker worker(this);
+            RowBatch batch;
+            while (!cancelled_ && worker.next(batch)) {
+                if (!consume(id, batch)) {
+                    stopped_ = true;
+                    cancelled_ = true;
+                }
+            }
+        };
+        for (size_t i = 1; i < num_workers; i++) {
+            scan_worker_pool().submit([self = shared_from_this(), &work] {
+                size_t id;
+                if (!self->enter(&id)) {
+                    return;
+                }
+                PageAccessCounter before = PageAccessCounter::local();
+                try {
+                    work(id);
+                } catch (...) {
+                    self->fail(std::current_exception());
+                }
+                self->add_worker_counts(before);
+                self->leave();
+            });
+        }
+        try {
+            work(0);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        finish();
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return !stopped_;
+    }
+
+    /**
+     * @description: 停止扫描并等待已经开始的worker结束，之后不再访问表的数据文件。
+     *               第一次调用时把线程池中worker访问的页面和记录计入当前线程的PageAccessCounter
+     */
+    void finish() {
+        std::unique_lock<std::mutex> lock(latch_);
+        closed_ = true;
+        cancelled_ = true;
+        not_full_.notify_all();
+        state_cv_.wait(lock, [this] { return running_ == 0; });
+        local_.release();
+        if (!counted_) {
+            counted_ = true;
+            PageAccessCounter &counter = PageAccessCounter::local();
+            counter.fetches += worker_counts_.fetches;
+            counter.hits += worker_counts_.hits;
+            counter.rows += worker_counts_.rows;
+        }
+    }
+
+   private:
+    // 一个worker的扫描状态：当前morsel的扫描位置和自己的过滤条件
+    class Worker {
+       public:
+        explicit Worker(MorselScan *owner) : owner_(owner), filter_(owner->filter_) {
+            if (owner->snapshot_ != nullptr) {
+                snapshot_ = std::make_unique<SnapshotScan>(*owner->snapshot_);
+            }
+        }
+
+        // 输出下一批满足条件并投影后的记录，当前morsel扫描完后领取下一个，没有剩余的morsel时返回false
+        bool next(RowBatch &batch) {
+            const ColumnProjector &projector = owner_->projector_;
+            if (owner_->file_handle_->get_file_hdr().is_pax() && snapshot_ == nullptr) {
+                return next_pax_batch(batch);
+            }
+            if (projector.identity()) {
+                return next_full_batch(batch);
+            }
+            if (scan_batch_.capacity() != batch.capacity()) {
+                scan_batch_ = RowBatch(batch.capacity());
+            }
+            batch.reset(projector.len());
+            if (next_full_batch(scan_batch_)) {
+                for (size_t i = 0; i < scan_batch_.size(); i++) {
+                    projector.project(scan_batch_.row(i), batch.append(scan_batch_.rid(i)));
+                }
+            }
+            return !batch.empty();
+        }
+
+        // unpin当前morsel中的页面
+        void release() {
+            pax_.reset();
+            scan_.reset();
+        }
+
+       private:
+        // 当前morsel扫描完时领取下一个，没有剩余的morsel时返回false
+        bool claim_morsel() {
+            if (scan_ != nullptr && !morsel_done_) {
+                return true;
+            }
+            release();
+            int start_page, end_page;
+            if (!owner_->claim(&start_page, &end_page)) {
+                return false;
+            }
+            bool pax = snapshot_ == nullptr && owner_->file_handle_->get_file_hdr().is_pax();
+            scan_ = std::make_unique<RmScan>(owner_->file_handle_, start_page, end_page, pax, owner_->zone_conds_);
+            if (snapshot_ != nullptr) {
+                snapshot_->begin(start_page, end_page);
+            }
+            morsel_done_ = false;
+            return true;
+        }
+
+        bool next_pax_batch(RowBatch &batch) {
+            while (claim_morsel()) {
+                if (pax_ == nullptr) {
+                    pax_ = std::make_unique<PaxBatchScan>(scan_.get(), owner_->rec_len_);
+                }
+                if (pax_->next(filter_, owner_->projector_, batch)) {
+                    return true;
+                }
+                morsel_done_ = true;
+            }
+            return false;
+        }
+
+        bool next_full_batch(RowBatch &batch) {
+            while (claim_morsel()) {
+                batch.reset(owner_->rec_len_);
+                if (snapshot_ != nullptr) {
+                    morsel_done_ = !snapshot_->fill(*scan_, batch);
+                } else {
+                    for (; !scan_->is_end() && !batch.full(); scan_->next()) {
+                        batch.append(scan_->record(), scan_->rid());
+                    }
+                    morsel_done_ = scan_->is_end();
+                }
+                filter_.filter(batch);
+                if (!batch.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        MorselScan *owner_;
+        ConditionFilter filter_;
+        std::unique_ptr<RmScan> scan_;          // 当前morsel的扫描
+        std::unique_ptr<PaxBatchScan> pax_;     // PAX格式的表按页面扫描当前morsel
+        std::unique_ptr<SnapshotScan> snapshot_;    // 读取快照时当前morsel的快照扫描
+        bool morsel_done_ = false;              // 当前morsel已经扫描完
+        RowBatch scan_batch_;                   // 需要投影时，扫描到的完整记录先放在这里过滤
+    };
+
+    // 领取下一个morsel，没有剩余的morsel或扫描已停止时返回false
+    bool claim(int *start_page, int *end_page) {
+        if (cancelled_) {
+            return false;
+        }
+        int page = next_page_.fetch_add(PARALLEL_SCAN_MORSEL_PAGES, std::memory_order_relaxed);
+        if (page >= end_page_) {
+            return false;
+        }
+        *start_page = page;
+        *end_page = std::min(page + PARALLEL_SCAN_MORSEL_PAGES, end_page_);
+        return true;
+    }
+
+    // 线程池中的任务开始执行，扫描已结束时返回false
+    bool enter(size_t *id = nullptr) {
+        std::scoped_lock lock{latch_};
+        if (closed_) {
+            return false;
+        }
+        running_++;
+        if (id != nullptr) {
+            *id = ++num_entered_;
+        }
+        return true;
+    }
+
+    void leave() {
+        std::scoped_lock lock{latch_};
+        running_--;
+        state_cv_.notify_all();
+    }
+
+    // 线程池中的任务结束前调用，累加它在所在线程上访问的页面和记录，before为任务开始时的计数
+    void add_worker_counts(const PageAccessCounter &before) {
+        const PageAccessCounter &after = PageAccessCounter::local();
+        std::scoped_lock lock{latch_};
+        worker_counts_.fetches += after.fetches - before.fetches;
+        worker_counts_.hits += after.hits - before.hits;
+        worker_counts_.rows += after.rows - before.rows;
+    }
+
+    // 记录第一个错误并停止扫描
+    void fail(std::exception_ptr error) {
+        std::scoped_lock lock{latch_};
+        if (!error_) {
+            error_ = error;
+        }
+        cancelled_ = true;
+        not_full_.notify_all();
+        state_cv_.notify_all();
+    }
+
+    // start()提交的worker：把扫描得到的批次放入队列，队列满时等待
+    void produce() {
+        if (!enter()) {
+            return;
+        }
+        PageAccessCounter before = PageAccessCounter::local();
+        try {
+            Worker worker(this);
+            RowBatch batch;
+            while (!cancelled_ && worker.next(batch)) {
+                std::unique_lock<std::mutex> lock(latch_);
+                not_full_.wait(lock, [this] { return queue_.size() < capacity_ || cancelled_; });
+                if (cancelled_) {
+                    break;
+                }
+                queue_.push_back(std::move(batch));
+                state_cv_.notify_all();
+            }
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        add_worker_counts(before);
+        leave();
+    }
+
+    const RmFileHandle *file_handle_;
+    ConditionFilter filter_;                    // 各worker复制的过滤条件
+    std::vector<RmZoneCondition> zone_conds_;   // filter_中能用zone map跳过页面的条件
+    ColumnProjector projector_;
+    size_t rec_len_;                            // 表中完整记录的长度
+    const SnapshotScan *snapshot_;              // 读取快照时各worker复制的快照扫描
+    std::atomic<int> next_page_;                // 下一个morsel的第一个页号
+    int end_page_;                              // 扫描开始时文件的页数
+    std::atomic<bool> cancelled_{false};        // 不再领取新的morsel
+    std::atomic<bool> stopped_{false};          // run()被consume停止
+
+    std::mutex latch_;                          // 保护以下成员
+    std::condition_variable not_full_;          // 队列有空位或扫描停止时唤醒producer
+    std::condition_variable state_cv_;          // 队列有批次、worker结束或出错时唤醒
+    std::deque<RowBatch> queue_;                // producer扫描得到、尚未取出的批次
+    size_t capacity_ = 0;                       // 队列中最多的批次数
+    size_t running_ = 0;                        // 正在执行的worker数
+    size_t num_entered_ = 0;                    // 已经开始执行的worker数，用于分配编号
+    bool closed_ = false;                       // 扫描已结束，之后开始的任务直接返回
+    std::exception_ptr error_;
+    PageAccessCounter worker_counts_;           // 线程池中的worker访问的页面和记录
+    bool counted_ = false;                      // worker_counts_已经计入发起扫描的线程
+
+    Worker local_;                              // 发起扫描的线程在next()中使用的worker
+    bool local_done_ = false;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "execution_filter.h"
+#include "execution_projector.h"
+#include "record/rm.h"
+#include "record/rm_pax_codec.h"
+#include "row_batch.h"
+
+/*
+PaxBatchScan按页面批量扫描PAX格式的表，代替逐条复制完整记录再过滤的行式批量扫描
+1. 每进入一个页面，先把页面的bitmap转成选择位图，再用ConditionFilter::filter_columns()直接在各列的minipage上
+   执行过滤内核：minipage中同一字段的值紧密排列，内核只读取条件涉及的列
+2. 只为满足条件的记录从minipage中取出上层需要的字段，其余的列不会被读取；
+   有字段与字段比较的条件时，先取出完整的记录求值这些条件
+3. 一个页面中满足条件的记录超过批次的剩余空间时，剩余的记录留到下一次next()，每个页面只过滤一次
+4. 压缩的表中不在缓冲池、在压缩页缓存中的页面不解码，直接在编码后的数据上过滤(RmScan需要以compressed_reads创建)：
+   frame-of-reference编码的整数列把常量换算成与base的差后比较编号，常量超出页面的取值范围时整页结果相同；
+   字典编码的列对字典中的每个值求值一次条件，再按每条记录的编号查表。其余的条件解码出该列后交给过滤内核，
+   满足条件的记录只解码需要的字段
+读取快照时记录需要换成快照中的版本，仍然使用行式的批量扫描
+*/
+class PaxBatchScan {
+   public:
+    /**
+     * @param {RmScan*} scan 扫描的范围，PaxBatchScan按页面移动它
+     */
+    PaxBatchScan(RmScan *scan, size_t rec_len) : scan_(scan), rec_buf_(rec_len) {}
+
+    /**
+     * @description: 把之后满足条件的记录投影后放入batch，直到batch满或扫描结束
+     * @return {bool} batch是否不为空，为false时扫描已经结束
+     */
+    bool next(ConditionFilter &filter, const ColumnProjector &projector, RowBatch &batch) {
+        batch.reset(projector.len());
+        while (!batch.full() && !scan_->is_end()) {
+            int page_no = scan_->rid().page_no;
+            if (const RmCompressedPage *compressed = scan_->compressed_page()) {
+                if (page_no != page_no_) {
+                    select(filter, *compressed);
+                    page_no_ = page_no;
+                }
+                emit(*compressed, page_no, projector, batch);
+                if (pos_ == selected_.size()) {
+                    scan_->next_page();
+                }
+                continue;
+            }
+            const RmPageHandle &page = scan_->page();
+            if (page_no != page_no_) {
+                select(filter, page);
+                page_no_ = page_no;
+            }
+            for (; pos_ < selected_.size() && !batch.full(); pos_++) {
+                int slot_no = selected_[pos_];
+                char *out = batch.append(Rid{page_no, slot_no});
+                if (projector.identity()) {
+                    const char *rec = page.get_record(slot_no, out);
+                    if (rec != out) {
+                        memcpy(out, rec, batch.tuple_len());
+                    }
+                    continue;
+                }
+                for (auto &field : projector.fields()) {
+                    size_t stride;
+                    const char *col = page.column(field.src, &stride);
+                    memcpy(out + field.dst, col + slot_no * stride, field.len);
+                }
+            }
+            if (pos_ == selected_.size()) {
+                scan_->next_page();
+            }
+        }
+        return !batch.empty();
+    }
+
+   private:
+    // 求出当前页面中满足条件的slot
+    void select(ConditionFilter &filter, const RmPageHandle &page) {
+        int n = page.file_hdr->num_records_per_page;
+        bits_.assign((n + 63) / 64, 0);
+        for (int slot_no = page.next_record(-1); slot_no < n; slot_no = page.next_record(slot_no)) {
+            bits_[slot_no / 64] |= 1ULL << (slot_no % 64);
+        }
+        filter.filter_columns(n, bits_, [&page](int offset, size_t *stride) { return page.column(offset, stride); });
+        collect(filter, page);
+    }
+
+    // 求出压缩页缓存中的页面中满足条件的slot，能在编码后的数据上比较的条件不解码
+    void select(ConditionFilter &filter, const RmCompressedPage &page) {
+        int n = page.num_slots();
+        bits_.assign((n + 63) / 64, 0);
+        for (int slot_no = page.next_record(-1); slot_no < n; slot_no = page.next_record(slot_no)) {
+            bits_[slot_no / 64] |= 1ULL << (slot_no % 64);
+        }
+        filter.filter_conditions(bits_, [&](const ConditionFilter::ConstCondition &cond, uint64_t *bits) {
+            const RmEncodedMinipage &mp = page.minipage(page.find_minipage(cond.offset));
+            if (!filter_encoded(mp, cond, bits)) {
+                size_t stride;
+                const char *col = page.column(cond.offset, &stride, &col_buf_);
+                cond.kernel(col, stride, n, cond.value, cond.len, bits);
+            }
+        });
+        collect(filter, page);
+    }
+
+    // 按选择位图收集slot，并求值字段与字段比较的条件
+    template <typename Page>
+    void collect(const ConditionFilter &filter, const Page &page) {
+        selected_.clear();
+        pos_ = 0;
+        for (size_t w = 0; w < bits_.size(); w++) {
+            for (uint64_t rest = bits_[w]; rest != 0; rest &= rest - 1) {
+                int slot_no = static_cast<int>(w * 64 + __builtin_ctzll(rest));
+                if (!filter.has_residual() || filter.eval_residual(page.get_record(slot_no, rec_buf_.data()))) {
+                    selected_.push_back(slot_no);
+                }
+            }
+        }
+    }
+
+    /**
+     * @description: 在编码后的minipage上求值`字段 op 常量`的条件，条件的字段需要是整个minipage
+     * @return {bool} 是否已经求值，minipage原样保存或不能直接比较时返回false
+     */
+    bool filter_encoded(const RmEncodedMinipage &mp, const ConditionFilter::ConstCondition &cond, uint64_t *bits) const {
+        if (cond.offset != mp.offset || cond.len != mp.len) {
+            return false;
+        }
+        if (mp.mode == RM_ENCODING_FOR && cond.type == TYPE_INT) {
+            // 值为base + code，与常量v比较等价于code与v - base比较
+            int32_t value;
+            memcpy(&value, cond.value, sizeof(value));
+            int64_t target = static_cast<int64_t>(value) - mp.base;
+            int64_t max_code = (1LL << mp.width) - 1;
+            if (target < 0 || target > max_code) {
+                if (!ConditionFilter::eval_op(target < 0 ? 1 : -1, cond.op)) {
+                    clear_all(bits);
+                }
+                return true;
+            }
+            retain(bits, [&](int slot_no) {
+                int64_t code = mp.code(slot_no);
+                return ConditionFilter::eval_op(code < target ? -1 : (code > target ? 1 : 0), cond.op);
+            });
+            return true;
+        }
+        if (mp.mode == RM_ENCODING_DICT) {
+            std::vector<char> match(mp.dict_size);
+            for (int i = 0; i < mp.dict_size; i++) {
+                match[i] = ConditionFilter::eval_op(
+                    ix_compare(mp.dict + static_cast<size_t>(i) * mp.len, cond.value, cond.type, cond.len), cond.op);
+            }
+            retain(bits, [&](int slot_no) { return match[mp.code(slot_no)] != 0; });
+            return true;
+        }
+        return false;
+    }
+
+    // 只保留选择位图中keep(slot_no)为true的记录
+    template <typename Keep>
+    void retain(uint64_t *bits, Keep keep) const {
+        for (size_t w = 0; w < bits_.size(); w++) {
+            for (uint64_t rest = bits[w]; rest != 0; rest &= rest - 1) {
+                int bit = __builtin_ctzll(rest);
+                if (!keep(static_cast<int>(w * 64 + bit))) {
+                    bits[w] &= ~(1ULL << bit);
+                }
+            }
+        }
+    }
+
+    void clear_all(uint64_t *bits) const { std::fill(bits, bits + bits_.size(), 0); }
+
+    // 输出压缩页缓存中的页面中满足条件的记录，只解码需要的字段
+    void emit(const RmCompressedPage &page, int page_no, const ColumnProjector &projector, RowBatch &batch) {
+        for (; pos_ < selected_.size() && !batch.full(); pos_++) {
+            int slot_no = selected_[pos_];
+            char *out = batch.append(Rid{page_no, slot_no});
+            if (projector.identity()) {
+                page.get_record(slot_no, out);
+                continue;
+            }
+            for (auto &field : projector.fields()) {
+                const RmEncodedMinipage &mp = page.minipage(page.find_minipage(field.src));
+                if (field.src == mp.offset && field.len == mp.len) {
+                    mp.get(slot_no, out + field.dst);
+                } else {
+                    mp.get(slot_no, rec_buf_.data());
+                    memcpy(out + field.dst, rec_buf_.data() + (field.src - mp.offset), field.len);
+                }
+            }
+        }
+    }
+
+    RmScan *scan_;
+    int page_no_ = -1;                  // selected_所属的页面
+    std::vector<uint64_t> bits_;        // 当前页面的选择位图
+    std::vector<int> selected_;         // 当前页面中满足条件的slot
+    size_t pos_ = 0;                    // selected_中下一个要输出的slot
+    std::vector<char> rec_buf_;         // 求值字段与字段比较的条件时取出的完整记录
+    std::vector<char> col_buf_;         // 压缩的页面中解码出的一列，交给过滤内核
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "defs.h"
+#include "system/sm_meta.h"
+
+/*
+ColumnProjector把记录中需要的字段复制为一条更窄的记录，用于扫描算子在读取记录时就去掉上层算子用不到的字段
+输出记录中的字段保持输入中的顺序并紧密排列，输入中相邻的字段合并为一次memcpy；
+输入按列存放(PAX页面)时调用者按fields()逐个字段取出，只读取需要的列
+*/
+class ColumnProjector {
+   public:
+    // 一次复制：输入记录[src, src + len)复制到输出记录[dst, dst + len)
+    struct CopyRun {
+        int src;
+        int dst;
+        int len;
+    };
+
+   private:
+    std::vector<ColMeta> cols_;                 // 输出记录的字段
+    size_t len_ = 0;                            // 输出记录的长度
+    std::vector<CopyRun> runs_;
+    std::vector<CopyRun> fields_;               // 每个输出字段一次复制，不合并相邻的字段
+    bool identity_ = true;                      // 是否保留了全部字段，此时不需要复制
+
+   public:
+    ColumnProjector() = default;
+
+    /**
+     * @param {vector<ColMeta>&} rec_cols 输入记录的字段
+     * @param {vector<string>&} proj_cols 需要保留的字段名，为空时保留全部字段
+     */
+    ColumnProjector(const std::vector<ColMeta> &rec_cols, const std::vector<std::string> &proj_cols) {
+        int offset = 0;
+        for (auto &col : rec_cols) {
+            if (!proj_cols.empty() && std::find(proj_cols.begin(), proj_cols.end(), col.name) == proj_cols.end()) {
+                identity_ = false;
+                continue;
+            }
+            if (!runs_.empty() && runs_.back().src + runs_.back().len == col.offset) {
+                runs_.back().len += col.len;
+            } else {
+                runs_.push_back({col.offset, offset, col.len});
+            }
+            fields_.push_back({col.offset, offset, col.len});
+            ColMeta out = col;
+            out.offset = offset;
+            offset += col.len;
+            cols_.push_back(out);
+        }
+        len_ = offset;
+    }
+
+    const std::vector<ColMeta> &cols() const { return cols_; }
+
+    size_t len() const { return len_; }
+
+    bool identity() const { return identity_; }
+
+    // 输出的各字段在输入记录中的位置
+    const std::vector<CopyRun> &fields() const { return fields_; }
+
+    void project(const char *src, char *dst) const {
+        for (auto &run : runs_) {
+            memcpy(dst + run.dst, src + run.src, run.len);
+        }
+    }
+};
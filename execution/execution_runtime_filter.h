@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/bloom_filter.h"
+#include "common/metrics.h"
+#include "row_batch.h"
+#include "system/sm_meta.h"
+
+/**
+ * @description: 记录中一组连接字段的hash值，hash连接的build侧和probe侧、运行时过滤器都用它计算，
+ *               两侧字段的值相等时hash值相同
+ * @param {char*} row 记录
+ * @param {vector<ColMeta>&} keys 连接字段在该记录中的位置，两侧按相同的顺序排列
+ */
+inline uint64_t hash_join_key(const char *row, const std::vector<ColMeta> &keys) {
+    auto mix = [](uint64_t h) {
+        h *= 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 32);
+    };
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (auto &key : keys) {
+        const char *p = row + key.offset;
+        if (key.type == TYPE_FLOAT) {
+            // 0.0与-0.0相等，hash值也必须相同
+            float f;
+            memcpy(&f, p, sizeof(float));
+            uint32_t bits = 0;
+            if (f != 0) {
+                memcpy(&bits, &f, sizeof(float));
+            }
+            h = mix(h ^ bits);
+            continue;
+        }
+        int i = 0;
+        for (; i + 8 <= key.len; i += 8) {
+            uint64_t word;
+            memcpy(&word, p + i, 8);
+            h = mix(h ^ word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, p + i, key.len - i);
+        h = mix(h ^ tail ^ (static_cast<uint64_t>(key.len - i) << 56));
+    }
+    return h;
+}
+
+/*
+RuntimeFilter是hash连接建立hash表之后生成的运行时过滤器：对build侧全部连接字段的hash值建立分块bloom filter，
+下推到probe侧的扫描算子，扫描在复制和投影记录之前丢弃在build侧一定没有匹配的记录。
+bloom filter只会误判为可能匹配，被放过的记录仍由hash表探测，连接结果不变
+*/
+class RuntimeFilter {
+   public:
+    /**
+     * @param {vector<ColMeta>&} keys probe侧记录中的连接字段，与build侧计算hash值时的顺序相同
+     * @param {shared_ptr<BloomFilter>} bloom build侧连接字段的hash值
+     */
+    RuntimeFilter(std::vector<ColMeta> keys, std::shared_ptr<const BloomFilter> bloom)
+        : keys_(std::move(keys)), bloom_(std::move(bloom)) {}
+
+    /**
+     * @description: 把连接字段按表名和字段名重新定位到另一种格式的记录上，例如投影之前的完整记录
+     * @return {shared_ptr<RuntimeFilter>} 共用同一个bloom filter的过滤器，cols中缺少连接字段时为nullptr
+     * @param {vector<ColMeta>&} cols 新的记录格式
+     */
+    std::shared_ptr<const RuntimeFilter> bind(const std::vector<ColMeta> &cols) const {
+        std::vector<ColMeta> keys;
+        for (auto &key : keys_) {
+            auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) {
+                return col.tab_name == key.tab_name && col.name == key.name;
+            });
+            if (pos == cols.end()) {
+                return nullptr;
+            }
+            keys.push_back(*pos);
+        }
+        return std::make_shared<RuntimeFilter>(std::move(keys), bloom_);
+    }
+
+    // 记录在build侧可能有匹配
+    bool may_match(const char *row) const {
+        if (bloom_->may_contain_hash(hash_join_key(row, keys_))) {
+            return true;
+        }
+        EngineMetrics::get().join_filter_drops.add();
+        return false;
+    }
+
+    // 从批次的选择向量中去掉一定没有匹配的记录
+    void filter(RowBatch &batch) const {
+        auto &sel = batch.selection();
+        size_t n = 0;
+        for (uint32_t i : sel) {
+            sel[n] = i;
+            n += bloom_->may_contain_hash(hash_join_key(batch.data() + i * batch.tuple_len(), keys_));
+        }
+        if (n < sel.size()) {
+            EngineMetrics::get().join_filter_drops.add(sel.size() - n);
+            sel.resize(n);
+        }
+    }
+
+   private:
+    std::vector<ColMeta> keys_;
+    std::shared_ptr<const BloomFilter> bloom_;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#include "common/context.h"
+#include "record/rm.h"
+#include "row_batch.h"
+
+/*
+SnapshotScan把RmScan扫描到的堆表记录换成事务快照中的版本(见VersionStore)
+1. 每次fill()在表的共享latch下进行，有版本链的记录换成快照看到的版本，快照中不存在的记录被跳过
+2. 已从堆表删除、但快照中仍然存在的记录在扫描离开它所在的页面时输出
+3. 一个页面的所有记录和它的已删除记录在同一次持有latch时处理，批次放不下的部分留到下一次fill()；
+   下一次fill()从下一个页面的开头重新查找，因此不会因为两次fill()之间其他事务的修改而重复或遗漏记录
+*/
+class SnapshotScan {
+   public:
+    SnapshotScan(VersionStore::Table *table, VersionStore::Snapshot snapshot, size_t rec_len)
+        : table_(table), snapshot_(snapshot), rec_len_(rec_len) {}
+
+    /**
+     * @description: 事务需要读取快照时返回它的快照扫描，否则返回nullptr
+     */
+    static std::unique_ptr<SnapshotScan> create(Context *context, int fd, size_t rec_len) {
+        if (!reads_snapshot(context)) {
+            return nullptr;
+        }
+        return std::make_unique<SnapshotScan>(context->version_store_->get_table(fd), snapshot_of(context), rec_len);
+    }
+
+    // 语句是否读取事务的快照
+    static bool reads_snapshot(Context *context) {
+        return context != nullptr && context->snapshot_read_ && context->version_store_ != nullptr &&
+               context->txn_ != nullptr;
+    }
+
+    static VersionStore::Snapshot snapshot_of(Context *context) {
+        return {context->txn_->get_transaction_id(), context->txn_->get_start_ts()};
+    }
+
+    /**
+     * @description: 开始扫描[start_page, end_page)，end_page为INT_MAX时扫描到文件末尾
+     */
+    void begin(int start_page, int end_page = INT_MAX) {
+        next_page_ = start_page;
+        end_page_ = end_page;
+        pending_.clear();
+        pending_rids_.clear();
+        pending_pos_ = 0;
+    }
+
+    /**
+     * @description: 从scan中读取快照中的记录，直到batch满或扫描结束
+     * @return {bool} 之后是否还可能有记录，为false时扫描已经结束
+     */
+    bool fill(RmScan &scan, RowBatch &batch) {
+        drain(batch);
+        std::shared_lock<std::shared_mutex> lock(table_->latch());
+        if (!scan.is_end() && !batch.full()) {
+            // 上次停在下一个页面的第一条记录上，该页面之后可能被修改
+            scan.rescan_page();
+        }
+        while (!batch.full() && !scan.is_end()) {
+            int page_no = scan.rid().page_no;
+            add_deleted(page_no);
+            for (; !scan.is_end() && scan.rid().page_no == page_no; scan.next()) {
+                const char *data = table_->resolve(snapshot_, scan.rid(), scan.record());
+                if (data != nullptr) {
+                    emit(batch, data, scan.rid());
+                }
+            }
+            add_deleted(page_no + 1);
+        }
+        if (scan.is_end()) {
+            add_deleted(end_page_);
+        }
+        drain(batch);
+        return !scan.is_end() || pending_pos_ < pending_rids_.size();
+    }
+
+   private:
+    // 输出[next_page_, end_page)中已删除的记录
+    void add_deleted(int end_page) {
+        if (end_page <= next_page_) {
+            return;
+        }
+        if (!table_->empty()) {
+            table_->for_each_deleted(snapshot_, next_page_, end_page,
+                                     [this](const Rid &rid, const char *data) { push(data, rid); });
+        }
+        next_page_ = end_page;
+    }
+
+    void emit(RowBatch &batch, const char *data, const Rid &rid) {
+        if (pending_pos_ == pending_rids_.size() && !batch.full()) {
+            batch.append(data, rid);
+        } else {
+            push(data, rid);
+        }
+    }
+
+    void push(const char *data, const Rid &rid) {
+        pending_.insert(pending_.end(), data, data + rec_len_);
+        pending_rids_.push_back(rid);
+    }
+
+    // 把留下的记录放入batch
+    void drain(RowBatch &batch) {
+        for (; pending_pos_ < pending_rids_.size() && !batch.full(); pending_pos_++) {
+            batch.append(pending_.data() + pending_pos_ * rec_len_, pending_rids_[pending_pos_]);
+        }
+        if (pending_pos_ == pending_rids_.size()) {
+            pending_.clear();
+            pending_rids_.clear();
+            pending_pos_ = 0;
+        }
+    }
+
+    VersionStore::Table *table_;
+    VersionStore::Snapshot snapshot_;
+    size_t rec_len_;
+    int next_page_ = 0;                     // 尚未输出已删除记录的第一个页面
+    int end_page_ = INT_MAX;
+    std::vector<char> pending_;             // batch放不下的记录
+    std::vector<Rid> pending_rids_;
+    size_t pending_pos_ = 0;                // pending_中下一条要输出的记录
+};
+
+/*
+SnapshotReader按rid读取事务快照中的记录，用于通过索引或页面头访问表的算子(见VersionStore)
+1. 索引和页面头只反映堆表中最新的记录。快照之后被修改过的记录由for_each_changed()列出，
+   它们在索引中的位置可能已经改变或已被删除，算子按快照中的数据重新判断；其余记录的索引项与快照一致
+2. 快照看到的每条记录不会再改变，在同一次持有latch时确定要读取的rid后，释放latch再用read()读取也能得到快照中的记录
+*/
+class SnapshotReader {
+   public:
+    SnapshotReader(VersionStore::Table *table, VersionStore::Snapshot snapshot, RmFileHandle *fh)
+        : table_(table), snapshot_(snapshot), fh_(fh) {}
+
+    /**
+     * @description: 事务需要读取快照时返回表的快照读取器，否则返回nullptr
+     */
+    static std::unique_ptr<SnapshotReader> create(Context *context, RmFileHandle *fh) {
+        if (!SnapshotScan::reads_snapshot(context)) {
+            return nullptr;
+        }
+        return std::make_unique<SnapshotReader>(context->version_store_->get_table(fh->GetFd()),
+                                                SnapshotScan::snapshot_of(context), fh);
+    }
+
+    // 表的版本latch，current()和for_each_changed()要求调用者持有共享latch
+    std::shared_mutex &latch() { return table_->latch(); }
+
+    bool current(const Rid &rid) const { return table_->current(snapshot_, rid); }
+
+    /**
+     * @description: 对快照之后被修改过的每个rid调用f(rid, data)，data为快照中的记录，快照中不存在时为nullptr
+     */
+    template <typename F>
+    void for_each_changed(F &&f) const {
+        if (!table_->empty()) {
+            table_->for_each_changed(snapshot_, std::forward<F>(f));
+        }
+    }
+
+    /**
+     * @description: 把快照中rid处的记录复制到buf
+     * @return {bool} 快照中是否存在该记录
+     */
+    bool read(const Rid &rid, char *buf) {
+        std::shared_lock<std::shared_mutex> lock(table_->latch());
+        if (table_->current(snapshot_, rid)) {
+            if (!fh_->is_record(rid)) {
+                return false;
+            }
+            RmRecordView rec = fh_->get_record_view(rid);
+            memcpy(buf, rec.data(), rec.size());
+            return true;
+        }
+        const char *data = table_->resolve(snapshot_, rid, nullptr);
+        if (data == nullptr) {
+            return false;
+        }
+        memcpy(buf, data, fh_->get_file_hdr().record_size);
+        return true;
+    }
+
+   private:
+    VersionStore::Table *table_;
+    VersionStore::Snapshot snapshot_;
+    RmFileHandle *fh_;
+};
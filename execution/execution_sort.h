@@ -1,39 +1,294 @@
 #pragma once
+#include <cstdio>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_sort_key.h"
+#include "common/memory_tracker.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
+/*
+SortExecutor按多个排序键(每个键可以分别为ASC/DESC)对儿子节点的记录做稳定排序
+1. 读入的记录不超过内存预算时，在内存中对行号排序后直接输出。内存中的排序先把排序键编码为规范化的字节串
+   (见execution_sort_key.h)，再对字节串做基数排序或memcmp排序
+2. 超过预算时外部排序：每读入一个批次后已读入的记录超过预算，就把它们排序后作为一个有序段(run)写入临时文件，
+   读完后对所有段做一遍k路归并，每个段只在内存中缓存一个批次，用最小堆选出下一条记录；
+   键相同时先输出较早的段中的记录，因此外部排序的结果同样是稳定的
+指定limit时只输出排序后的前limit条记录。limit条记录能放入内存预算时使用top-N模式：用大小为limit的最大堆
+保存目前最小的limit条记录，每条新记录只与堆顶比较，最后只对这limit条记录排序，不需要缓存全部输入
+缓存的记录连同排序用到的键和行号记在语句的MemoryTracker上，超过语句的内存上限时与超过预算一样写入一个有序段；
+归并时各段的缓冲区和top-N的堆不能再写入临时文件，超过上限则抛出QueryMemoryLimitError
+*/
 class SortExecutor : public AbstractExecutor {
    private:
+    struct FileCloser {
+        void operator()(std::FILE *file) const { std::fclose(file); }
+    };
+    using TempFile = std::unique_ptr<std::FILE, FileCloser>;
+
+    // 写入临时文件的一个有序段，buf中缓存从文件读入的一批记录
+    struct Run {
+        TempFile file;
+        size_t rows_left = 0;                   // 文件中还没有读入的记录数
+        std::vector<char> buf;
+        size_t count = 0;                       // buf中的记录数
+        size_t pos = 0;                         // buf中下一条要输出的记录
+    };
+
     std::unique_ptr<AbstractExecutor> prev_;
-    ColMeta cols_;                              // 框架中只支持一个键排序，需要自行修改数据结构支持多个键排序
+    std::vector<SortKeyPart> keys_;
+    size_t key_len_ = 0;                        // 规范化的排序键的长度
+    std::vector<char> norm_keys_;               // 内存中每条记录的规范化排序键
+    size_t memory_budget_;                      // 内存中缓存的记录超过该字节数时写入一个有序段
+    MemoryReservation memory_;                  // 缓存的记录在语句的MemoryTracker上占用的内存
     size_t tuple_num;
-    bool is_desc_;
-    std::vector<size_t> used_tuple;
-    std::unique_ptr<RmRecord> current_tuple;
+    std::vector<char> tuples_;                  // 内存中的记录，按行连续存放
+    std::vector<size_t> order_;                 // 排序后的行号
+    size_t pos_;                                // 下一条要返回的记录在order_中的位置
+    size_t limit_;                              // 最多输出的记录数，SIZE_MAX表示不限制
+    std::vector<size_t> seqs_;                  // top-N模式下tuples_中每条记录在输入中的序号
+
+    // 外部排序的状态
+    bool spilled_ = false;
+    std::vector<Run> runs_;
+    std::vector<size_t> heap_;                  // 当前记录最小的段在堆顶
+    size_t emitted_ = 0;                        // 归并时已经输出的记录数
 
    public:
-    SortExecutor(std::unique_ptr<AbstractExecutor> prev, TabCol sel_cols, bool is_desc) {
+    /**
+     * @param {unique_ptr<AbstractExecutor>} prev 儿子节点
+     * @param {vector<TabCol>} sel_cols 排序键，按优先级从高到低
+     * @param {vector<bool>} is_desc 每个排序键是否降序
+     * @param {size_t} memory_budget 内存中缓存的记录的字节数上限
+     * @param {size_t} limit 最多输出的记录数
+     * @param {MemoryTracker*} tracker 语句的内存统计，为空时只受memory_budget限制
+     */
+    SortExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &sel_cols,
+                 const std::vector<bool> &is_desc, size_t memory_budget = SORT_MEMORY_BUDGET,
+                 size_t limit = SIZE_MAX, MemoryTracker *tracker = nullptr)
+        : memory_(tracker) {
         prev_ = std::move(prev);
-        cols_ = prev_->get_col_offset(sel_cols);
-        is_desc_ = is_desc;
+        for (size_t i = 0; i < sel_cols.size(); i++) {
+            ColMeta col = prev_->get_col_offset(sel_cols[i]);
+            keys_.push_back({col.offset, col.type, col.len, is_desc[i]});
+            key_len_ += col.len;
+        }
+        memory_budget_ = std::max(memory_budget, prev_->tupleLen());
+        limit_ = limit;
         tuple_num = 0;
-        used_tuple.clear();
+        pos_ = 0;
     }
 
-    void beginTuple() override { 
-        
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    std::string getType() override { return "SortExecutor"; }
+
+    /**
+     * @description: 批量读出儿子节点的全部记录，超过内存预算时分段排序并写入临时文件，最后准备归并
+     */
+    void beginTuple() override {
+        size_t len = prev_->tupleLen();
+        tuples_.clear();
+        runs_.clear();
+        heap_.clear();
+        spilled_ = false;
+        emitted_ = 0;
+        pos_ = 0;
+        memory_.resize(0);
+        if (len == 0 || (limit_ <= memory_budget_ / len && limit_ <= memory_.available() / row_bytes())) {
+            top_n();
+            return;
+        }
+        RowBatch batch;
+        for (prev_->beginBatch(); prev_->NextBatch(batch);) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                tuples_.insert(tuples_.end(), batch.row(i), batch.row(i) + len);
+            }
+            if (tuples_.size() >= memory_budget_) {
+                spill_run();
+            } else if (!memory_.try_resize(tuples_.size() / len * row_bytes())) {
+                EngineMetrics::get().query_memory_spills.add();
+                spill_run();
+            }
+        }
+        if (!spilled_) {
+            sort_tuples();
+            tuple_num = std::min(tuple_num, limit_);
+            std::vector<char>().swap(norm_keys_);
+            return;
+        }
+        if (!tuples_.empty()) {
+            spill_run();
+        }
+        std::vector<char>().swap(norm_keys_);
+        tuples_.clear();
+        tuples_.shrink_to_fit();
+        order_.clear();
+        order_.shrink_to_fit();
+        // 只归并一遍，段太多以致缓冲区超过内存上限时语句失败
+        memory_.resize(runs_.size() * ROW_BATCH_SIZE * len);
+        for (size_t r = 0; r < runs_.size(); r++) {
+            std::rewind(runs_[r].file.get());
+            if (fill_run(runs_[r])) {
+                heap_.push_back(r);
+                std::push_heap(heap_.begin(), heap_.end(), heap_cmp());
+            }
+        }
     }
 
     void nextTuple() override {
-        
+        assert(!is_end());
+        if (!spilled_) {
+            pos_++;
+            return;
+        }
+        emitted_++;
+        std::pop_heap(heap_.begin(), heap_.end(), heap_cmp());
+        Run &run = runs_[heap_.back()];
+        if (++run.pos < run.count || fill_run(run)) {
+            std::push_heap(heap_.begin(), heap_.end(), heap_cmp());
+        } else {
+            heap_.pop_back();
+        }
     }
 
+    bool is_end() const override { return spilled_ ? heap_.empty() || emitted_ >= limit_ : pos_ >= tuple_num; }
+
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        assert(!is_end());
+        return std::make_unique<RmRecord>(prev_->tupleLen(), current());
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(prev_->tupleLen());
+        for (; !is_end() && !batch.full(); nextTuple()) {
+            batch.append(current());
+        }
+        return !batch.empty();
     }
 
     Rid &rid() override { return _abstract_rid; }
-};
\ No newline at end of file
+
+   private:
+    const char *row(size_t i) const { return tuples_.data() + i * prev_->tupleLen(); }
+
+    const char *run_row(const Run &run) const { return run.buf.data() + run.pos * prev_->tupleLen(); }
+
+    const char *current() const { return spilled_ ? run_row(runs_[heap_.front()]) : row(order_[pos_]); }
+
+    // 内存中的每条记录占用的字节数，包括记录本身、规范化的排序键和行号
+    size_t row_bytes() const { return prev_->tupleLen() + key_len_ + 2 * sizeof(size_t); }
+
+    // 按排序键依次比较两条记录
+    int compare(const char *a, const char *b) const {
+        for (auto &key : keys_) {
+            int cmp = ix_compare(a + key.offset, b + key.offset, key.type, key.len);
+            if (cmp != 0) {
+                return key.is_desc ? -cmp : cmp;
+            }
+        }
+        return 0;
+    }
+
+    // 堆的比较函数，使当前记录最小(相同时段号最小)的段位于堆顶
+    struct HeapCmp {
+        const SortExecutor *sort;
+        bool operator()(size_t a, size_t b) const {
+            int cmp = sort->compare(sort->run_row(sort->runs_[a]), sort->run_row(sort->runs_[b]));
+            return cmp > 0 || (cmp == 0 && a > b);
+        }
+    };
+
+    HeapCmp heap_cmp() const { return HeapCmp{this}; }
+
+    // top-N模式的比较函数，键相同时输入中较早的记录较小，使结果稳定
+    bool top_less(size_t a, size_t b) const {
+        int cmp = compare(row(a), row(b));
+        return cmp < 0 || (cmp == 0 && seqs_[a] < seqs_[b]);
+    }
+
+    // 读入全部记录，只保留最小的limit_条，排序后的行号为order_
+    void top_n() {
+        size_t len = prev_->tupleLen();
+        auto less = [this](size_t a, size_t b) { return top_less(a, b); };
+        order_.clear();
+        seqs_.clear();
+        size_t seq = 0;
+        RowBatch batch;
+        if (limit_ != 0) {
+            for (prev_->beginBatch(); prev_->NextBatch(batch);) {
+                for (size_t i = 0; i < batch.size(); i++, seq++) {
+                    if (order_.size() < limit_) {
+                        memory_.resize((order_.size() + 1) * row_bytes());
+                        tuples_.insert(tuples_.end(), batch.row(i), batch.row(i) + len);
+                        seqs_.push_back(seq);
+                        order_.push_back(order_.size());
+                        std::push_heap(order_.begin(), order_.end(), less);
+                    } else if (compare(batch.row(i), row(order_.front())) < 0) {
+                        // 新记录比堆顶(目前保留的记录中最大的)小，替换堆顶
+                        std::pop_heap(order_.begin(), order_.end(), less);
+                        size_t slot = order_.back();
+                        memcpy(tuples_.data() + slot * len, batch.row(i), len);
+                        seqs_[slot] = seq;
+                        std::push_heap(order_.begin(), order_.end(), less);
+                    }
+                }
+            }
+        }
+        std::sort_heap(order_.begin(), order_.end(), less);
+        tuple_num = order_.size();
+    }
+
+    // 对tuples_中的记录按规范化的排序键稳定排序，结果为order_
+    void sort_tuples() {
+        size_t len = prev_->tupleLen();
+        tuple_num = len == 0 ? 0 : tuples_.size() / len;
+        norm_keys_.resize(tuple_num * key_len_);
+        for (size_t i = 0; i < tuple_num; i++) {
+            encode_sort_key(row(i), keys_, norm_keys_.data() + i * key_len_);
+        }
+        sort_keys(norm_keys_.data(), tuple_num, key_len_, order_);
+    }
+
+    // 把内存中的记录排序后作为一个有序段写入临时文件
+    void spill_run() {
+        sort_tuples();
+        std::FILE *file = std::tmpfile();
+        if (file == nullptr) {
+            throw UnixError();
+        }
+        runs_.emplace_back();
+        Run &run = runs_.back();
+        run.file.reset(file);
+        size_t len = prev_->tupleLen();
+        for (auto i : order_) {
+            if (std::fwrite(row(i), len, 1, file) != 1) {
+                throw UnixError();
+            }
+        }
+        run.rows_left = tuple_num;
+        tuples_.clear();
+        memory_.resize(0);
+        spilled_ = true;
+    }
+
+    // 从文件读入段的下一批记录，返回是否读到了记录
+    bool fill_run(Run &run) {
+        size_t len = prev_->tupleLen();
+        run.count = std::min(run.rows_left, ROW_BATCH_SIZE);
+        run.pos = 0;
+        if (run.count == 0) {
+            return false;
+        }
+        run.buf.resize(run.count * len);
+        if (std::fread(run.buf.data(), len, run.count, run.file.get()) != run.count) {
+            throw UnixError();
+        }
+        run.rows_left -= run.count;
+        return true;
+    }
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/config.h"
+#include "defs.h"
+#include "errors.h"
+
+/*
+排序键的规范化编码：把记录的各个排序键依次编码为定长字节串，使编码后的memcmp顺序与按ix_compare逐键比较
+(DESC的键取反)的顺序相同，排序时不再按字段类型分派比较函数
+- TYPE_INT：翻转符号位后按大端序写入
+- TYPE_FLOAT：非负数翻转符号位，负数翻转全部位，按大端序写入；-0.0与0.0编码相同
+- TYPE_STRING：定长字符串本身就按memcmp比较，直接复制
+- DESC的键把编码的每个字节取反
+规范化的键不超过SORT_RADIX_MAX_KEY_BYTES字节时用LSD基数排序，否则用基于memcmp的稳定排序
+*/
+
+// 一个排序键的编码方式
+struct SortKeyPart {
+    int offset;         // 字段在记录中的偏移
+    ColType type;
+    int len;
+    bool is_desc;
+};
+
+inline void sort_key_store_be32(uint32_t u, char *out) {
+    out[0] = static_cast<char>(u >> 24);
+    out[1] = static_cast<char>(u >> 16);
+    out[2] = static_cast<char>(u >> 8);
+    out[3] = static_cast<char>(u);
+}
+
+/**
+ * @description: 把记录的排序键编码为规范化的字节串
+ * @param {char*} rec 记录
+ * @param {vector<SortKeyPart>&} parts 排序键，按优先级从高到低
+ * @param {char*} out 输出，长度为各个键的长度之和
+ */
+inline void encode_sort_key(const char *rec, const std::vector<SortKeyPart> &parts, char *out) {
+    for (auto &part : parts) {
+        const char *col = rec + part.offset;
+        switch (part.type) {
+            case TYPE_INT: {
+                uint32_t u;
+                memcpy(&u, col, sizeof(u));
+                sort_key_store_be32(u ^ 0x80000000u, out);
+                break;
+            }
+            case TYPE_FLOAT: {
+                float f;
+                memcpy(&f, col, sizeof(f));
+                uint32_t u = 0;
+                if (f != 0) {
+                    memcpy(&u, &f, sizeof(u));
+                }
+                sort_key_store_be32((u & 0x80000000u) ? ~u : (u | 0x80000000u), out);
+                break;
+            }
+            case TYPE_STRING:
+                memcpy(out, col, part.len);
+                break;
+            default:
+                throw InternalError("Unexpected data type");
+        }
+        if (part.is_desc) {
+            for (int i = 0; i < part.len; i++) {
+                out[i] = static_cast<char>(~out[i]);
+            }
+        }
+        out += part.len;
+    }
+}
+
+/**
+ * @description: 对n个规范化的键做LSD基数排序，键相同时保持原有顺序
+ * 键与行号一起存放，每趟按一个字节做计数排序并移动整条键；一遍扫描统计所有字节位置的直方图，
+ * 所有键在某个字节位置上都相同时跳过这一趟
+ * @param {char*} keys 第i个键位于keys + i * key_len
+ * @param {size_t} n 键的个数
+ * @param {size_t} key_len 键的长度
+ * @param {vector<size_t>&} order 输出排序后的行号
+ */
+inline void sort_keys_radix(const char *keys, size_t n, size_t key_len, std::vector<size_t> &order) {
+    size_t entry_len = key_len + sizeof(uint32_t);
+    std::vector<char> entries(n * entry_len);
+    std::vector<char> tmp(n * entry_len);
+    std::vector<size_t> counts(key_len * 256, 0);
+    for (size_t i = 0; i < n; i++) {
+        char *entry = entries.data() + i * entry_len;
+        const unsigned char *key = reinterpret_cast<const unsigned char *>(keys + i * key_len);
+        memcpy(entry, key, key_len);
+        uint32_t row = static_cast<uint32_t>(i);
+        memcpy(entry + key_len, &row, sizeof(row));
+        for (size_t b = 0; b < key_len; b++) {
+            counts[b * 256 + key[b]]++;
+        }
+    }
+    for (size_t b = key_len; b-- > 0;) {
+        size_t *count = counts.data() + b * 256;
+        const unsigned char first = static_cast<unsigned char>(entries[b]);
+        if (count[first] == n) {
+            continue;
+        }
+        size_t pos = 0;
+        for (int v = 0; v < 256; v++) {
+            size_t c = count[v];
+            count[v] = pos;
+            pos += c;
+        }
+        for (size_t i = 0; i < n; i++) {
+            const char *entry = entries.data() + i * entry_len;
+            memcpy(tmp.data() + (count[static_cast<unsigned char>(entry[b])]++) * entry_len, entry, entry_len);
+        }
+        entries.swap(tmp);
+    }
+    order.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t row;
+        memcpy(&row, entries.data() + i * entry_len + key_len, sizeof(row));
+        order[i] = row;
+    }
+}
+
+/**
+ * @description: 对n个规范化的键排序，键相同时保持原有顺序
+ * @param {char*} keys 第i个键位于keys + i * key_len
+ * @param {size_t} n 键的个数
+ * @param {size_t} key_len 键的长度
+ * @param {vector<size_t>&} order 输出排序后的行号
+ */
+inline void sort_keys(const char *keys, size_t n, size_t key_len, std::vector<size_t> &order) {
+    if (n != 0 && key_len <= SORT_RADIX_MAX_KEY_BYTES && n <= UINT32_MAX) {
+        sort_keys_radix(keys, n, key_len, order);
+        return;
+    }
+    order.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return memcmp(keys + a * key_len, keys + b * key_len, key_len) < 0;
+    });
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "execution_defs.h"
+#include "execution_runtime_filter.h"
+#include "row_batch.h"
 #include "common/common.h"
 #include "index/ix.h"
 #include "system/sm.h"
@@ -32,7 +34,32 @@ class AbstractExecutor {
 
     virtual std::unique_ptr<RmRecord> Next() = 0;
 
-    virtual ColMeta get_col_offset(const TabCol &target) { return ColMeta();};
+    // 开始批量执行，之后调用NextBatch()。默认与beginTuple()相同，需要为批量执行单独维护状态的算子重写该函数
+    virtual void beginBatch() { beginTuple(); }
+
+    /**
+     * @description: 批量执行接口，beginBatch()之后反复调用，每次最多返回batch.capacity()条记录，
+     *               与beginTuple()/Next()/nextTuple()不能在同一次执行中混用。默认实现逐条调用Next()
+     * @return {bool} 是否返回了记录，返回false表示已经执行完毕
+     * @param {RowBatch&} batch 输出的记录，调用时被清空
+     */
+    virtual bool NextBatch(RowBatch &batch) {
+        batch.reset(tupleLen());
+        for (; !is_end() && !batch.full(); nextTuple()) {
+            auto rec = Next();
+            batch.append(rec->data, rid());
+        }
+        return !batch.empty();
+    }
+
+    /**
+     * @description: hash连接把build侧生成的运行时过滤器下推到probe侧，之后输出的记录可以只保留filter可能匹配的。
+     *               过滤器的字段是本算子输出记录的字段；filter为nullptr时撤销之前下推的过滤器。默认不接受
+     * @return {bool} 是否接受了过滤器
+     */
+    virtual bool push_runtime_filter(std::shared_ptr<const RuntimeFilter> filter) { return false; }
+
+    virtual ColMeta get_col_offset(const TabCol &target) { return *get_col(cols(), target); };
 
     std::vector<ColMeta>::const_iterator get_col(const std::vector<ColMeta> &rec_cols, const TabCol &target) {
         auto pos = std::find_if(rec_cols.begin(), rec_cols.end(), [&](const ColMeta &col) {
@@ -0,0 +1,105 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+AppendExecutor依次输出各个儿子节点的全部记录，用于扫描分区表：每个没有被剪掉的分区一个扫描算子。
+分区的字段属于分区表，各儿子节点输出的记录格式相同
+*/
+class AppendExecutor : public AbstractExecutor {
+   private:
+    std::vector<std::unique_ptr<AbstractExecutor>> children_;
+    size_t current_ = 0;                        // 正在输出的儿子节点，等于children_.size()时执行完毕
+
+   public:
+    AppendExecutor(std::vector<std::unique_ptr<AbstractExecutor>> children) {
+        assert(!children.empty());
+        children_ = std::move(children);
+    }
+
+    size_t tupleLen() const override { return children_[0]->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return children_[0]->cols(); }
+
+    std::string getType() override { return "AppendExecutor"; }
+
+    void beginTuple() override {
+        current_ = 0;
+        children_[0]->beginTuple();
+        skip_finished();
+    }
+
+    void beginBatch() override {
+        current_ = 0;
+        children_[0]->beginBatch();
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        children_[current_]->nextTuple();
+        skip_finished();
+    }
+
+    bool is_end() const override { return current_ == children_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override { return children_[current_]->Next(); }
+
+    bool NextBatch(RowBatch &batch) override {
+        while (current_ < children_.size()) {
+            if (children_[current_]->NextBatch(batch)) {
+                return true;
+            }
+            if (++current_ < children_.size()) {
+                children_[current_]->beginBatch();
+            }
+        }
+        return false;
+    }
+
+    Rid &rid() override { return children_[current_]->rid(); }
+
+    // 各分区的扫描输出相同格式的记录，过滤器下推到每个分区
+    bool push_runtime_filter(std::shared_ptr<const RuntimeFilter> filter) override {
+        bool pushed = false;
+        for (auto &child : children_) {
+            pushed |= child->push_runtime_filter(filter);
+        }
+        return pushed;
+    }
+
+   private:
+    // 当前儿子节点已经输出完时开始下一个，直到找到还有记录的儿子节点
+    void skip_finished() {
+        while (children_[current_]->is_end() && ++current_ < children_.size()) {
+            children_[current_]->beginTuple();
+        }
+    }
+};
+
+/*
+PartitionWriteExecutor依次执行各个分区上的INSERT/UPDATE/DELETE算子，把一条语句对分区表的修改分发到各个分区
+*/
+class PartitionWriteExecutor : public AbstractExecutor {
+   private:
+    std::vector<std::unique_ptr<AbstractExecutor>> children_;
+
+   public:
+    PartitionWriteExecutor(std::vector<std::unique_ptr<AbstractExecutor>> children, Context *context) {
+        children_ = std::move(children);
+        context_ = context;
+    }
+
+    std::string getType() override { return "PartitionWriteExecutor"; }
+
+    std::unique_ptr<RmRecord> Next() override {
+        for (auto &child : children_) {
+            child->Next();
+        }
+        return nullptr;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_snapshot.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+CountStarExecutor计算没有条件的单表COUNT(*)：表中的记录数由每个页面头中的num_records相加得到，不读取记录
+输出一条记录，每个聚合函数(只能是COUNT)一个INT字段
+读取快照时，在表的版本latch下相加页面头中的记录数，再按快照之后修改过的每条记录在快照和堆表中是否存在修正
+*/
+class CountStarExecutor : public AbstractExecutor {
+   private:
+    std::string tab_name_;                      // 表的名称
+    RmFileHandle *fh_;                          // 表的数据文件句柄
+    std::vector<ColMeta> cols_;                 // 输出记录的字段
+    size_t len_;                                // 输出记录的长度
+    bool isend_ = true;
+    int count_ = 0;
+    std::unique_ptr<SnapshotReader> snapshot_;  // 读取快照时不为nullptr
+
+    SmManager *sm_manager_;
+
+   public:
+    CountStarExecutor(SmManager *sm_manager, const TableHandle &table, const std::vector<AggExpr> &aggs,
+                      Context *context) {
+        sm_manager_ = sm_manager;
+        tab_name_ = table.tab->name;
+        fh_ = table.fh;
+        context_ = context;
+        int offset = 0;
+        for (auto &agg : aggs) {
+            if (agg.type != AGG_COUNT) {
+                throw InternalError("CountStarExecutor only computes COUNT");
+            }
+            cols_.push_back({agg.output.tab_name, agg.output.col_name, TYPE_INT, sizeof(int), offset, false});
+            offset += sizeof(int);
+        }
+        len_ = offset;
+        snapshot_ = SnapshotReader::create(context, fh_);
+    }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "CountStarExecutor"; }
+
+    void beginTuple() override {
+        isend_ = false;
+        if (snapshot_ == nullptr) {
+            count_ = static_cast<int>(fh_->count_records());
+            return;
+        }
+        std::shared_lock<std::shared_mutex> lock(snapshot_->latch());
+        count_ = static_cast<int>(fh_->count_records());
+        snapshot_->for_each_changed([this](const Rid &rid, const char *data) {
+            count_ += (data != nullptr) - fh_->is_record(rid);
+        });
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        isend_ = true;
+    }
+
+    bool is_end() const override { return isend_; }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        auto rec = std::make_unique<RmRecord>(len_);
+        for (auto &col : cols_) {
+            memcpy(rec->data + col.offset, &count_, sizeof(count_));
+        }
+        return rec;
+    }
+
+    void beginBatch() override { beginTuple(); }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        if (!isend_) {
+            char *out = batch.append();
+            for (auto &col : cols_) {
+                memcpy(out + col.offset, &count_, sizeof(count_));
+            }
+            isend_ = true;
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+};
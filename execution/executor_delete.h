@@ -2,31 +2,54 @@
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_index_buffer.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
 class DeleteExecutor : public AbstractExecutor {
    private:
-    TabMeta tab_;                   // 表的元数据
+    const TableHandle &table_;      // 表打开的句柄
+    const TabMeta &tab_;            // 表的元数据
     std::vector<Condition> conds_;  // delete的条件
     RmFileHandle *fh_;              // 表的数据文件句柄
     std::vector<Rid> rids_;         // 需要删除的记录的位置
-    std::string tab_name_;          // 表名称
     SmManager *sm_manager_;
 
    public:
-    DeleteExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Condition> conds,
-                   std::vector<Rid> rids, Context *context) {
+    DeleteExecutor(SmManager *sm_manager, const TableHandle &table, std::vector<Condition> conds,
+                   std::vector<Rid> rids, Context *context)
+        : table_(table), tab_(*table.tab) {
         sm_manager_ = sm_manager;
-        tab_name_ = tab_name;
-        tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = table_.fh;
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
 
     std::unique_ptr<RmRecord> Next() override {
+        // 修改之前锁住所有要删除的记录，加锁失败时语句还没有修改任何记录
+        context_->lock_for_write(fh_->GetFd(), rids_);
+        // 先删除所有记录，索引项在最后按key排序后统一删除
+        IndexWriteBuffer index_buffer(table_, context_);
+        int record_size = fh_->get_file_hdr().record_size;
+        for (auto &rid : rids_) {
+            VersionStore::Writer versions(context_->version_store_, context_->txn_, tab_.id, fh_->GetFd(), record_size);
+            auto rec = fh_->get_record_view(rid);
+            index_buffer.delete_record(rec.data());
+            sm_manager_->update_stats(tab_, rec.data(), nullptr);
+            versions.remove(rid, rec.data());
+            lsn_t lsn = INVALID_LSN;
+            if (context_->logging()) {
+                DeleteLogRecord log_record(context_->txn_->get_transaction_id(), tab_.id, rid, rec.data(), rec.size());
+                lsn = context_->log_mgr_->append_txn_log(context_->txn_, &log_record);
+            }
+            fh_->delete_record(rid, context_);
+            if (lsn != INVALID_LSN) {
+                fh_->set_page_lsn(rid.page_no, lsn);
+            }
+        }
+        index_buffer.flush();
+        table_.bump_data_version();
         return nullptr;
     }
 
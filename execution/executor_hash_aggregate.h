@@ -0,0 +1,374 @@
+#pragma once
+#include <cstdio>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_aggregate.h"
+#include "executor_seq_scan.h"
+#include "common/memory_tracker.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+AggregateHashTable保存一组分组状态(格式见execution_aggregate.h)，查找分组时只需比较hash值和规范化的key
+分组状态连续存放在groups_中，hash表为开放寻址、线性探测的槽数组，槽中保存分组的下标，装载率不超过1/2
+*/
+class AggregateHashTable {
+   private:
+    static constexpr uint32_t NO_GROUP = UINT32_MAX;
+
+    const AggregateFunctions *aggs_;
+    size_t key_len_;                            // 规范化的key的长度
+    size_t state_len_;                          // 每个分组状态的长度
+    std::vector<char> groups_;
+    std::vector<uint64_t> hashes_;              // 每个分组的key的hash值
+    std::vector<uint32_t> slots_;               // 大小为2的幂，NO_GROUP表示空槽
+    size_t num_groups_ = 0;
+    std::vector<char> key_buf_;                 // 当前记录的规范化的key
+
+   public:
+    explicit AggregateHashTable(const AggregateFunctions *aggs)
+        : aggs_(aggs), key_len_(aggs->key_len()), state_len_(aggs->state_len()), key_buf_(key_len_) {
+        clear();
+    }
+
+    size_t size() const { return num_groups_; }
+
+    char *group(size_t g) { return groups_.data() + g * state_len_; }
+
+    size_t memory_used() const {
+        return groups_.capacity() + hashes_.capacity() * sizeof(uint64_t) + slots_.size() * sizeof(uint32_t);
+    }
+
+    // 同时释放分组占用的内存，逐个分区聚合时上一个分区的内存不再计入memory_used()
+    void clear() {
+        std::vector<char>().swap(groups_);
+        std::vector<uint64_t>().swap(hashes_);
+        slots_.assign(16, NO_GROUP);
+        num_groups_ = 0;
+    }
+
+    // 没有分组字段且输入为空时输出的一组
+    void add_empty_group() {
+        groups_.assign(state_len_, 0);
+        hashes_.push_back(0);
+        num_groups_ = 1;
+    }
+
+    /**
+     * @description: 把记录聚合到它的分组中
+     * @return {bool} 是否聚合了该记录，分组不存在且不允许创建时返回false
+     * @param {char*} row 输入记录
+     * @param {bool} allow_insert 分组不存在时是否创建
+     * @param {uint64_t*} hash 输出记录的key的hash值
+     */
+    bool aggregate_row(const char *row, bool allow_insert, uint64_t *hash) {
+        aggs_->encode_key(row, key_buf_.data());
+        uint64_t h = hash_key(key_buf_.data());
+        *hash = h;
+        size_t idx = find(h, key_buf_.data());
+        if (slots_[idx] != NO_GROUP) {
+            aggs_->update(group(slots_[idx]), row);
+            return true;
+        }
+        if (!allow_insert) {
+            return false;
+        }
+        aggs_->init(group(insert(h, idx)), key_buf_.data(), row);
+        return true;
+    }
+
+    // 把另一个hash表中的分组合并进来，两个表使用同一个AggregateFunctions
+    void merge(AggregateHashTable &other) {
+        for (size_t i = 0; i < other.num_groups_; i++) {
+            const char *state = other.group(i);
+            uint64_t h = other.hashes_[i];
+            size_t idx = find(h, state);
+            if (slots_[idx] != NO_GROUP) {
+                aggs_->merge(group(slots_[idx]), state);
+            } else {
+                memcpy(group(insert(h, idx)), state, state_len_);
+            }
+        }
+    }
+
+   private:
+    uint64_t hash_key(const char *key) const {
+        uint64_t h = 0x9e3779b97f4a7c15ULL;
+        size_t i = 0;
+        for (; i + 8 <= key_len_; i += 8) {
+            uint64_t word;
+            memcpy(&word, key + i, 8);
+            h = mix(h ^ word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, key + i, key_len_ - i);
+        return mix(h ^ tail ^ (static_cast<uint64_t>(key_len_ - i) << 56));
+    }
+
+    static uint64_t mix(uint64_t h) {
+        h *= 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 32);
+    }
+
+    // 查找key所在的槽，分组不存在时返回应插入的空槽
+    size_t find(uint64_t h, const char *key) {
+        size_t mask = slots_.size() - 1;
+        size_t idx = h & mask;
+        for (; slots_[idx] != NO_GROUP; idx = (idx + 1) & mask) {
+            uint32_t g = slots_[idx];
+            if (hashes_[g] == h && memcmp(group(g), key, key_len_) == 0) {
+                break;
+            }
+        }
+        return idx;
+    }
+
+    // 在空槽idx处创建一个未初始化的分组，返回分组的下标
+    uint32_t insert(uint64_t h, size_t idx) {
+        if ((num_groups_ + 1) * 2 > slots_.size()) {
+            grow();
+            size_t mask = slots_.size() - 1;
+            for (idx = h & mask; slots_[idx] != NO_GROUP; idx = (idx + 1) & mask) {
+            }
+        }
+        uint32_t g = static_cast<uint32_t>(num_groups_++);
+        slots_[idx] = g;
+        hashes_.push_back(h);
+        groups_.resize(groups_.size() + state_len_);
+        return g;
+    }
+
+    // 槽数组扩大一倍并重新插入所有分组
+    void grow() {
+        slots_.assign(slots_.size() * 2, NO_GROUP);
+        size_t mask = slots_.size() - 1;
+        for (size_t g = 0; g < num_groups_; g++) {
+            size_t idx = hashes_[g] & mask;
+            while (slots_[idx] != NO_GROUP) {
+                idx = (idx + 1) & mask;
+            }
+            slots_[idx] = static_cast<uint32_t>(g);
+        }
+    }
+};
+
+/*
+HashAggregateExecutor按分组字段对儿子节点的记录分组并计算COUNT/SUM/MIN/MAX/AVG，输出记录为分组字段后接各个聚合结果
+1. 分组保存在AggregateHashTable中
+2. 分组占用的内存超过预算后不再创建新的分组：已有分组的记录继续原地聚合，其余记录按key的hash值写入
+   HASH_AGG_PARTITIONS个临时文件。内存中的分组输出完后逐个分区重新聚合，同一个分组的记录只会在一个分区中；
+   数据倾斜导致单个分区超过预算时仍在内存中聚合该分区
+3. 儿子节点是可以并行扫描的SeqScanExecutor时，各个扫描worker先聚合到自己的hash表中，扫描结束后合并。
+   各worker的分组合计超过内存预算时放弃并行的结果，重新按2串行聚合
+4. 分组占用的内存同时记在语句的MemoryTracker上，超过语句的内存上限时与超过预算一样写入分区；
+   重新聚合一个分区时不能再写入分区，超过上限则抛出QueryMemoryLimitError
+没有分组字段时整个输入是一组，输入为空也输出一条记录(COUNT为0，其余聚合结果为0)
+*/
+class HashAggregateExecutor : public AbstractExecutor {
+   private:
+    struct FileCloser {
+        void operator()(std::FILE *file) const { std::fclose(file); }
+    };
+    using TempFile = std::unique_ptr<std::FILE, FileCloser>;
+
+    std::unique_ptr<AbstractExecutor> prev_;    // 儿子节点
+    AggregateFunctions aggs_;                   // 分组状态的格式和聚合函数的计算
+    size_t memory_budget_;                      // 分组占用的内存超过该字节数时写入分区
+    MemoryReservation memory_;                  // 分组在语句的MemoryTracker上占用的内存
+    std::unique_ptr<AggregateHashTable> table_;
+
+    // 分区的状态
+    bool spilled_ = false;
+    std::vector<TempFile> partitions_;
+    std::vector<size_t> partition_rows_;
+    size_t partition_ = 0;                      // 下一个要聚合的分区
+
+    size_t emit_pos_ = 0;                       // 下一个要输出的分组
+
+    // 逐条执行时缓存的输出结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
+
+   public:
+    /**
+     * @param {unique_ptr<AbstractExecutor>} prev 儿子节点
+     * @param {vector<TabCol>} group_cols 分组字段
+     * @param {vector<AggExpr>} aggs 聚合函数
+     * @param {size_t} memory_budget 分组占用的内存的字节数上限
+     * @param {MemoryTracker*} tracker 语句的内存统计，为空时只受memory_budget限制
+     */
+    HashAggregateExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &group_cols,
+                          const std::vector<AggExpr> &aggs, size_t memory_budget = HASH_AGG_MEMORY_BUDGET,
+                          MemoryTracker *tracker = nullptr)
+        : memory_(tracker) {
+        prev_ = std::move(prev);
+        memory_budget_ = memory_budget;
+        aggs_ = AggregateFunctions(prev_.get(), group_cols, aggs);
+        table_ = std::make_unique<AggregateHashTable>(&aggs_);
+    }
+
+    size_t tupleLen() const override { return aggs_.len(); }
+
+    const std::vector<ColMeta> &cols() const override { return aggs_.cols(); }
+
+    std::string getType() override { return "HashAggregateExecutor"; }
+
+    // 逐条执行时在内部按批次输出，每次返回缓存批次中的一条记录
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
+    }
+
+    bool is_end() const override { return out_batch_.empty(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(aggs_.len(), out_batch_.row(out_pos_));
+    }
+
+    /**
+     * @description: 读入儿子节点的全部记录并聚合，内存不足时把新分组的记录写入分区
+     */
+    void beginBatch() override {
+        table_->clear();
+        memory_.resize(0);
+        spilled_ = false;
+        partitions_.clear();
+        partition_ = 0;
+        if (!aggregate_parallel()) {
+            aggregate_serial();
+        }
+        if (!aggs_.has_group_cols() && table_->size() == 0) {
+            // 没有分组字段时，空输入也输出一组
+            table_->add_empty_group();
+        }
+        for (auto &file : partitions_) {
+            std::rewind(file.get());
+        }
+        emit_pos_ = 0;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(aggs_.len());
+        while (!batch.full()) {
+            if (emit_pos_ < table_->size()) {
+                aggs_.finalize(table_->group(emit_pos_++), batch.append());
+            } else if (spilled_ && partition_ < HASH_AGG_PARTITIONS) {
+                load_partition(partition_++);
+            } else {
+                break;
+            }
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    void aggregate_serial() {
+        size_t in_len = prev_->tupleLen();
+        RowBatch batch;
+        for (prev_->beginBatch(); prev_->NextBatch(batch);) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                const char *row = batch.row(i);
+                uint64_t h;
+                if (table_->aggregate_row(row, !spilled_, &h)) {
+                    continue;
+                }
+                size_t p = (h >> 32) % HASH_AGG_PARTITIONS;
+                if (std::fwrite(row, in_len, 1, partitions_[p].get()) != 1) {
+                    throw UnixError();
+                }
+                partition_rows_[p]++;
+            }
+            if (!spilled_ && table_->memory_used() > memory_budget_) {
+                start_spill();
+            } else if (!spilled_ && !memory_.try_resize(table_->memory_used())) {
+                EngineMetrics::get().query_memory_spills.add();
+                start_spill();
+            }
+        }
+    }
+
+    /**
+     * @description: 儿子节点是足够大的表的顺序扫描时，各worker分别聚合后合并到table_中
+     * @return {bool} 是否完成了聚合，不能并行或分组超出内存预算时返回false
+     */
+    bool aggregate_parallel() {
+        auto scan = dynamic_cast<SeqScanExecutor *>(prev_.get());
+        if (scan == nullptr) {
+            return false;
+        }
+        size_t num_workers = scan->parallel_workers();
+        if (num_workers <= 1) {
+            return false;
+        }
+        std::vector<AggregateHashTable> locals(num_workers, AggregateHashTable(&aggs_));
+        size_t budget = std::min(memory_budget_, memory_.available()) / num_workers;
+        bool done = scan->scan_parallel(num_workers, [&](size_t w, RowBatch &batch) {
+            AggregateHashTable &local = locals[w];
+            for (size_t i = 0; i < batch.size(); i++) {
+                uint64_t h;
+                local.aggregate_row(batch.row(i), true, &h);
+            }
+            return local.memory_used() <= budget;
+        });
+        if (!done) {
+            return false;
+        }
+        for (auto &local : locals) {
+            table_->merge(local);
+        }
+        if (!memory_.try_resize(table_->memory_used())) {
+            table_->clear();
+            return false;
+        }
+        return true;
+    }
+
+    // 此后不再创建新的分组，没有分组的记录写入分区
+    void start_spill() {
+        spilled_ = true;
+        partitions_.clear();
+        partition_rows_.assign(HASH_AGG_PARTITIONS, 0);
+        for (size_t p = 0; p < HASH_AGG_PARTITIONS; p++) {
+            std::FILE *file = std::tmpfile();
+            if (file == nullptr) {
+                throw UnixError();
+            }
+            partitions_.emplace_back(file);
+        }
+    }
+
+    // 清空hash表并聚合分区p中的记录
+    void load_partition(size_t p) {
+        table_->clear();
+        emit_pos_ = 0;
+        size_t in_len = prev_->tupleLen();
+        std::vector<char> rows(ROW_BATCH_SIZE * in_len);
+        for (size_t left = partition_rows_[p]; left != 0;) {
+            size_t n = std::min(left, ROW_BATCH_SIZE);
+            if (std::fread(rows.data(), in_len, n, partitions_[p].get()) != n) {
+                throw UnixError();
+            }
+            for (size_t i = 0; i < n; i++) {
+                uint64_t h;
+                table_->aggregate_row(rows.data() + i * in_len, true, &h);
+            }
+            memory_.resize(table_->memory_used());
+            left -= n;
+        }
+        partitions_[p].reset();
+    }
+};
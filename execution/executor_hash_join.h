@@ -0,0 +1,414 @@
+#pragma once
+#include <cstdio>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_filter.h"
+#include "common/memory_tracker.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+HashJoinExecutor对含有等值连接条件的两个输入做hash连接，输出的记录与NestedLoopJoinExecutor相同，为左记录后接右记录
+1. 交替读取左右儿子的批次，先读完的一侧较小，作为build侧建立hash表；另一侧作为probe侧，已经读入的部分先探测，其余部分边读边探测
+2. 两侧都没有读完而读入的记录已经超过内存预算时，把两侧的记录按key的hash值分别写入HASH_JOIN_PARTITIONS个临时文件(grace hash join)，
+   之后逐个分区连接，每个分区用较小的一侧建立hash表。数据倾斜导致单个分区超过预算时仍在内存中建立该分区的hash表
+   读入的记录和hash表同时记在语句的MemoryTracker上，超过语句的内存上限时与超过预算一样写入分区；
+   分区的hash表不能再写入分区，超过上限则抛出QueryMemoryLimitError
+3. 在内存中连接时，建立hash表后为build侧的连接字段生成运行时过滤器(RuntimeFilter)下推到probe侧，
+   probe侧的扫描在输出记录之前丢弃一定没有匹配的记录
+等值条件只用于计算hash值和筛选候选记录，所有连接条件最后都在连接后的记录上求值
+*/
+class HashJoinExecutor : public AbstractExecutor {
+   private:
+    // 一个等值连接条件在左右两侧记录中的位置
+    struct JoinKey {
+        int left_offset;
+        int right_offset;
+        int len;
+        ColType type;
+    };
+
+    struct FileCloser {
+        void operator()(std::FILE *file) const { std::fclose(file); }
+    };
+    using TempFile = std::unique_ptr<std::FILE, FileCloser>;
+
+    static constexpr uint32_t NO_ROW = UINT32_MAX;
+
+    std::unique_ptr<AbstractExecutor> left_;    // 左儿子节点
+    std::unique_ptr<AbstractExecutor> right_;   // 右儿子节点
+    size_t len_;                                // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;                 // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;          // join条件
+    ConditionFilter filter_;                    // 在连接后的记录上求值fed_conds_
+    std::vector<JoinKey> keys_;                 // 用于hash的等值条件
+    std::vector<ColMeta> left_key_cols_;        // keys_在左儿子记录中的字段
+    std::vector<ColMeta> right_key_cols_;       // keys_在右儿子记录中的字段
+    size_t memory_budget_;                      // 读入内存的记录超过该字节数时写入临时文件
+    MemoryReservation memory_;                  // 读入的记录和hash表在语句的MemoryTracker上占用的内存
+
+    // hash表，build侧记录连续存放在build_rows_中，同一个桶中的记录通过next_组成链表
+    bool build_left_;                           // build侧是否为左儿子
+    std::vector<char> build_rows_;
+    std::vector<uint64_t> build_hashes_;
+    std::vector<uint32_t> heads_;
+    std::vector<uint32_t> next_;
+
+    // probe侧当前的一组记录
+    std::vector<char> probe_rows_;
+    size_t probe_count_ = 0;
+    size_t probe_pos_ = 0;                      // 正在探测的记录
+    uint64_t probe_hash_ = 0;
+    uint32_t match_ = NO_ROW;                   // probe_pos_在hash表中下一个候选的build侧记录
+    bool isend;
+
+    // 内存中连接时probe侧的状态，pending_为建立hash表时已经读入的probe侧记录
+    std::vector<char> pending_;
+    RowBatch probe_batch_;
+
+    // grace hash join的状态，partitions_[0]为左儿子的分区，partitions_[1]为右儿子的分区
+    bool spilled_ = false;
+    std::vector<TempFile> partitions_[2];
+    std::vector<size_t> partition_rows_[2];
+    size_t partition_ = 0;                      // 正在连接的分区
+
+    // 逐条执行时缓存的连接结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
+
+   public:
+    HashJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right,
+                     std::vector<Condition> conds, size_t memory_budget = HASH_JOIN_MEMORY_BUDGET,
+                     MemoryTracker *tracker = nullptr)
+        : memory_(tracker) {
+        left_ = std::move(left);
+        right_ = std::move(right);
+        len_ = left_->tupleLen() + right_->tupleLen();
+        cols_ = left_->cols();
+        auto right_cols = right_->cols();
+        for (auto &col : right_cols) {
+            col.offset += left_->tupleLen();
+        }
+        cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
+        isend = false;
+        fed_conds_ = std::move(conds);
+        filter_ = ConditionFilter(cols_, fed_conds_);
+        memory_budget_ = memory_budget;
+
+        for (auto &cond : fed_conds_) {
+            if (cond.op != OP_EQ || cond.is_rhs_val) {
+                continue;
+            }
+            const ColMeta *lhs_left = find_col(left_->cols(), cond.lhs_col);
+            const ColMeta *rhs_right = find_col(right_->cols(), cond.rhs_col);
+            if (lhs_left == nullptr || rhs_right == nullptr) {
+                lhs_left = find_col(left_->cols(), cond.rhs_col);
+                rhs_right = find_col(right_->cols(), cond.lhs_col);
+            }
+            if (lhs_left != nullptr && rhs_right != nullptr && lhs_left->type == rhs_right->type &&
+                lhs_left->len == rhs_right->len) {
+                keys_.push_back({lhs_left->offset, rhs_right->offset, lhs_left->len, lhs_left->type});
+                left_key_cols_.push_back(*lhs_left);
+                right_key_cols_.push_back(*rhs_right);
+            }
+        }
+        if (keys_.empty()) {
+            throw InternalError("Hash join requires an equality condition between its inputs");
+        }
+    }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "HashJoinExecutor"; }
+
+    // 逐条执行时在内部按批次连接，每次返回缓存批次中的一条记录
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
+    }
+
+    bool is_end() const override { return out_batch_.empty(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(len_, out_batch_.row(out_pos_));
+    }
+
+    void beginBatch() override {
+        build_rows_.clear();
+        pending_.clear();
+        memory_.resize(0);
+        probe_count_ = 0;
+        probe_pos_ = 0;
+        match_ = NO_ROW;
+        spilled_ = false;
+        isend = false;
+        build();
+        // build侧为空时没有连接结果，不再读取probe侧
+        isend = !spilled_ && build_rows_.empty();
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        size_t left_len = left_->tupleLen();
+        while (!isend && !batch.full()) {
+            if (match_ == NO_ROW) {
+                // 当前probe记录的候选已经比较完，探测下一条记录
+                if (probe_count_ != 0) {
+                    probe_pos_++;
+                }
+                if (probe_pos_ >= probe_count_ && !next_probe_rows()) {
+                    isend = true;
+                    break;
+                }
+                probe_hash_ = hash_key(probe_row(), !build_left_);
+                match_ = heads_.empty() ? NO_ROW : heads_[probe_hash_ & (heads_.size() - 1)];
+                continue;
+            }
+            uint32_t cand = match_;
+            match_ = next_[cand];
+            const char *build_row = build_rows_.data() + static_cast<size_t>(cand) * build_len();
+            const char *probe = probe_row();
+            if (build_hashes_[cand] != probe_hash_ || !keys_equal(build_left_ ? build_row : probe,
+                                                                  build_left_ ? probe : build_row)) {
+                continue;
+            }
+            char *out = batch.append();
+            memcpy(out, build_left_ ? build_row : probe, left_len);
+            memcpy(out + left_len, build_left_ ? probe : build_row, len_ - left_len);
+            if (!filter_.eval(out)) {
+                batch.pop_back();
+            }
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    static const ColMeta *find_col(const std::vector<ColMeta> &cols, const TabCol &target) {
+        for (auto &col : cols) {
+            if (col.tab_name == target.tab_name && col.name == target.col_name) {
+                return &col;
+            }
+        }
+        return nullptr;
+    }
+
+    // 分区连接时每个分区的build侧可能不同，记录长度需要按当前的build_left_计算
+    size_t build_len() const { return build_left_ ? left_->tupleLen() : right_->tupleLen(); }
+
+    size_t probe_len() const { return build_left_ ? right_->tupleLen() : left_->tupleLen(); }
+
+    const char *probe_row() const { return probe_rows_.data() + probe_pos_ * probe_len(); }
+
+    // 计算记录中所有等值连接字段的hash值，left表示记录来自左儿子
+    uint64_t hash_key(const char *row, bool left) const {
+        return hash_join_key(row, left ? left_key_cols_ : right_key_cols_);
+    }
+
+    bool keys_equal(const char *left_row, const char *right_row) const {
+        for (auto &key : keys_) {
+            if (ix_compare(left_row + key.left_offset, right_row + key.right_offset, key.type, key.len) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 把批次中选中的记录追加到rows末尾
+    static void append_rows(std::vector<char> &rows, const RowBatch &batch) {
+        size_t len = batch.tuple_len();
+        for (size_t i = 0; i < batch.size(); i++) {
+            rows.insert(rows.end(), batch.row(i), batch.row(i) + len);
+        }
+    }
+
+    /**
+     * @description: 交替读取左右儿子，选择build侧并建立hash表；读入的记录超过内存预算时改为把两侧写入分区
+     */
+    void build() {
+        // 重新执行时撤销上一次下推的过滤器，两侧都先完整地读取
+        left_->push_runtime_filter(nullptr);
+        right_->push_runtime_filter(nullptr);
+        left_->beginBatch();
+        right_->beginBatch();
+        AbstractExecutor *children[2] = {left_.get(), right_.get()};
+        std::vector<char> rows[2];
+        bool done[2] = {false, false};
+        RowBatch batch;
+        for (int side = 0; !done[0] && !done[1]; side ^= 1) {
+            if (!children[side]->NextBatch(batch)) {
+                done[side] = true;
+                break;
+            }
+            append_rows(rows[side], batch);
+            size_t bytes = rows[0].size() + rows[1].size();
+            if (bytes > memory_budget_) {
+                spill(rows);
+                return;
+            }
+            if (!memory_.try_resize(bytes)) {
+                EngineMetrics::get().query_memory_spills.add();
+                spill(rows);
+                return;
+            }
+        }
+        build_left_ = done[0];
+        build_rows_ = std::move(rows[build_left_ ? 0 : 1]);
+        pending_ = std::move(rows[build_left_ ? 1 : 0]);
+        build_table();
+        push_runtime_filter_to_probe();
+    }
+
+    // 为build侧的连接字段建立bloom filter，下推到probe侧还没有读取的部分。build侧为空时不再读取probe侧，不需要过滤器
+    void push_runtime_filter_to_probe() {
+        if (JOIN_FILTER_BITS_PER_KEY <= 0 || build_hashes_.empty()) {
+            return;
+        }
+        auto bloom = std::make_shared<BloomFilter>(build_hashes_.size(), JOIN_FILTER_BITS_PER_KEY);
+        for (uint64_t h : build_hashes_) {
+            bloom->add_hash(h);
+        }
+        AbstractExecutor *probe = build_left_ ? right_.get() : left_.get();
+        probe->push_runtime_filter(
+            std::make_shared<RuntimeFilter>(build_left_ ? right_key_cols_ : left_key_cols_, std::move(bloom)));
+    }
+
+    // 为build_rows_建立hash表
+    void build_table() {
+        size_t n = build_rows_.size() / build_len();
+        size_t buckets = 16;
+        while (buckets < n * 2) {
+            buckets <<= 1;
+        }
+        heads_.assign(buckets, NO_ROW);
+        next_.resize(n);
+        build_hashes_.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t h = hash_key(build_rows_.data() + i * build_len(), build_left_);
+            build_hashes_[i] = h;
+            uint32_t &head = heads_[h & (buckets - 1)];
+            next_[i] = head;
+            head = static_cast<uint32_t>(i);
+        }
+        memory_.resize(build_rows_.size() + pending_.size() + heads_.size() * sizeof(uint32_t) +
+                       n * (sizeof(uint32_t) + sizeof(uint64_t)));
+    }
+
+    /**
+     * @description: 读取probe侧的下一组记录到probe_rows_，grace hash join时一个分区读完后连接下一个分区
+     * @return {bool} 是否还有记录
+     */
+    bool next_probe_rows() {
+        probe_pos_ = 0;
+        probe_count_ = 0;
+        if (!spilled_) {
+            if (!pending_.empty()) {
+                probe_rows_ = std::move(pending_);
+                pending_.clear();
+            } else {
+                AbstractExecutor *probe = build_left_ ? right_.get() : left_.get();
+                if (!probe->NextBatch(probe_batch_)) {
+                    return false;
+                }
+                probe_rows_.clear();
+                append_rows(probe_rows_, probe_batch_);
+            }
+            probe_count_ = probe_rows_.size() / probe_len();
+            return true;
+        }
+        while (partition_ < HASH_JOIN_PARTITIONS) {
+            // 有一侧为空的分区没有连接结果
+            if (partition_rows_[0][partition_] != 0 && partition_rows_[1][partition_] != 0) {
+                int probe_side = build_left_ ? 1 : 0;
+                probe_rows_.resize(ROW_BATCH_SIZE * probe_len());
+                probe_count_ = std::fread(probe_rows_.data(), probe_len(), ROW_BATCH_SIZE,
+                                          partitions_[probe_side][partition_].get());
+                if (probe_count_ != 0) {
+                    return true;
+                }
+            }
+            partitions_[0][partition_].reset();
+            partitions_[1][partition_].reset();
+            partition_++;
+            load_partition();
+        }
+        return false;
+    }
+
+    // 把两侧已读入的记录和剩余的记录按hash值写入分区，然后读入第一个分区
+    void spill(std::vector<char> *rows) {
+        spilled_ = true;
+        AbstractExecutor *children[2] = {left_.get(), right_.get()};
+        for (int side = 0; side < 2; side++) {
+            partitions_[side].clear();
+            partition_rows_[side].assign(HASH_JOIN_PARTITIONS, 0);
+            for (size_t p = 0; p < HASH_JOIN_PARTITIONS; p++) {
+                std::FILE *file = std::tmpfile();
+                if (file == nullptr) {
+                    throw UnixError();
+                }
+                partitions_[side].emplace_back(file);
+            }
+            size_t len = children[side]->tupleLen();
+            for (size_t off = 0; off < rows[side].size(); off += len) {
+                write_partition(side, rows[side].data() + off, len);
+            }
+            rows[side].clear();
+            rows[side].shrink_to_fit();
+            RowBatch batch;
+            while (children[side]->NextBatch(batch)) {
+                for (size_t i = 0; i < batch.size(); i++) {
+                    write_partition(side, batch.row(i), len);
+                }
+            }
+            for (auto &file : partitions_[side]) {
+                std::rewind(file.get());
+            }
+        }
+        memory_.resize(0);
+        partition_ = 0;
+        load_partition();
+    }
+
+    void write_partition(int side, const char *row, size_t len) {
+        size_t p = (hash_key(row, side == 0) >> 32) % HASH_JOIN_PARTITIONS;
+        if (std::fwrite(row, len, 1, partitions_[side][p].get()) != 1) {
+            throw UnixError();
+        }
+        partition_rows_[side][p]++;
+    }
+
+    // 读入当前分区中较小的一侧并建立hash表
+    void load_partition() {
+        build_rows_.clear();
+        if (partition_ >= HASH_JOIN_PARTITIONS) {
+            return;
+        }
+        size_t left_bytes = partition_rows_[0][partition_] * left_->tupleLen();
+        size_t right_bytes = partition_rows_[1][partition_] * right_->tupleLen();
+        build_left_ = left_bytes <= right_bytes;
+        int side = build_left_ ? 0 : 1;
+        size_t bytes = build_left_ ? left_bytes : right_bytes;
+        memory_.resize(bytes);
+        build_rows_.resize(bytes);
+        if (bytes != 0 && std::fread(build_rows_.data(), 1, bytes, partitions_[side][partition_].get()) != bytes) {
+            throw UnixError();
+        }
+        build_table();
+    }
+};
@@ -0,0 +1,302 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_filter.h"
+#include "execution_snapshot.h"
+#include "executor_index_scan.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+IndexNestedLoopJoinExecutor用外表(左儿子)的每条记录在内表的索引上查找匹配的记录，输出左记录后接内表记录
+内表的连接字段依次对应索引的前几个字段：
+1. 覆盖了全部索引字段时，每读入一个外表批次就用IxIndexHandle::get_values_batch()批量查找整批key，
+   哈希索引用IxHashIndexHandle::get_values_batch()
+2. 只覆盖前缀时，对每个key在[前缀+最小值, 前缀+最大值]区间上做索引扫描，哈希索引不支持
+内表只通过rid读取匹配的记录，连接条件和内表自身的扫描条件都在连接后的记录上求值
+读取快照时，每个外表批次的查找在内表的版本latch下进行：跳过指向快照之后被修改过的记录的索引项，
+这些记录按快照中的连接字段与整批key匹配；匹配到的记录从快照中读取(见SnapshotReader)
+*/
+class IndexNestedLoopJoinExecutor : public AbstractExecutor {
+   private:
+    // 索引字段与外表记录中对应连接字段的位置
+    struct ProbeKey {
+        int outer_offset;
+        ColMeta index_col;
+    };
+
+    std::unique_ptr<AbstractExecutor> left_;    // 外表
+    std::string tab_name_;                      // 内表名称
+    RmFileHandle *fh_;                          // 内表的数据文件句柄
+    const IndexMeta *index_meta_;               // 用于查找内表的索引
+    const IndexHandle *index_;                  // 用于查找内表的索引的文件
+    IxIndexHandle *ih_;
+    size_t len_;                                // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;                 // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;          // 连接条件和内表的扫描条件
+    ConditionFilter filter_;                    // 在连接后的记录上求值fed_conds_
+    std::vector<ProbeKey> keys_;                // 用于查找的索引前缀字段
+    bool full_key_;                             // keys_是否覆盖全部索引字段
+    std::unique_ptr<SnapshotReader> snapshot_;  // 读取快照时不为nullptr
+    std::vector<char> inner_buf_;               // 读取快照时从快照中读出的内表记录
+
+    SmManager *sm_manager_;
+
+    // 当前外表批次及其每条记录匹配到的内表rid
+    RowBatch left_batch_;
+    std::vector<std::vector<Rid>> matches_;
+    size_t left_pos_ = 0;
+    size_t match_pos_ = 0;
+    bool isend;
+
+    // 逐条执行时缓存的连接结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
+
+   public:
+    /**
+     * @param {unique_ptr<AbstractExecutor>} left 外表
+     * @param {TableHandle&} table 内表
+     * @param {vector<Condition>} inner_conds 内表自身的扫描条件
+     * @param {int} index_id 内表上用于查找的索引的编号
+     * @param {vector<Condition>} conds 连接条件，其中与索引前缀字段对应的等值条件用于查找
+     */
+    IndexNestedLoopJoinExecutor(SmManager *sm_manager, std::unique_ptr<AbstractExecutor> left, const TableHandle &table,
+                                std::vector<Condition> inner_conds, int index_id, std::vector<Condition> conds,
+                                Context *context) {
+        sm_manager_ = sm_manager;
+        context_ = context;
+        left_ = std::move(left);
+        const TabMeta &tab = *table.tab;
+        tab_name_ = tab.name;
+        fh_ = table.fh;
+        const IndexHandle &index = table.get_index(index_id);
+        index_meta_ = index.meta;
+        index_ = &index;
+        ih_ = index.ih;
+
+        len_ = left_->tupleLen() + tab.cols.back().offset + tab.cols.back().len;
+        cols_ = left_->cols();
+        for (auto col : tab.cols) {
+            col.offset += left_->tupleLen();
+            cols_.push_back(col);
+        }
+        isend = false;
+
+        for (auto &col : index_meta_->cols) {
+            const ColMeta *outer = outer_col(conds, col);
+            if (outer == nullptr) {
+                break;
+            }
+            keys_.push_back({outer->offset, col});
+        }
+        if (keys_.empty()) {
+            throw InternalError("Index nested loop join requires an equality condition on the index prefix");
+        }
+        full_key_ = keys_.size() == index_meta_->cols.size();
+        if (!full_key_ && ih_ == nullptr) {
+            throw InternalError("Index nested loop join on a hash index requires equality conditions on all index columns");
+        }
+
+        fed_conds_ = std::move(conds);
+        fed_conds_.insert(fed_conds_.end(), inner_conds.begin(), inner_conds.end());
+        filter_ = ConditionFilter(cols_, fed_conds_);
+        snapshot_ = SnapshotReader::create(context, fh_);
+        if (snapshot_ != nullptr) {
+            inner_buf_.resize(fh_->get_file_hdr().record_size);
+        }
+    }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "IndexNestedLoopJoinExecutor"; }
+
+    // 逐条执行时在内部按批次连接，每次返回缓存批次中的一条记录
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
+    }
+
+    bool is_end() const override { return out_batch_.empty(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(len_, out_batch_.row(out_pos_));
+    }
+
+    void beginBatch() override {
+        left_->beginBatch();
+        left_batch_.reset(left_->tupleLen());
+        matches_.clear();
+        left_pos_ = 0;
+        match_pos_ = 0;
+        isend = false;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        size_t left_len = left_->tupleLen();
+        while (!isend && !batch.full()) {
+            if (left_pos_ == left_batch_.size()) {
+                if (!left_->NextBatch(left_batch_)) {
+                    isend = true;
+                    break;
+                }
+                probe();
+                left_pos_ = 0;
+                match_pos_ = 0;
+                continue;
+            }
+            auto &rids = matches_[left_pos_];
+            if (match_pos_ == rids.size()) {
+                left_pos_++;
+                match_pos_ = 0;
+                continue;
+            }
+            const Rid &rid = rids[match_pos_++];
+            RmRecordView rec;
+            const char *inner = inner_buf_.data();
+            if (snapshot_ == nullptr) {
+                rec = fh_->get_record_view(rid);
+                inner = rec.data();
+            } else if (!snapshot_->read(rid, inner_buf_.data())) {
+                continue;
+            }
+            char *out = batch.append();
+            memcpy(out, left_batch_.row(left_pos_), left_len);
+            memcpy(out + left_len, inner, len_ - left_len);
+            if (!filter_.eval(out)) {
+                batch.pop_back();
+            }
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    // 与索引字段col有等值连接条件的外表字段
+    const ColMeta *outer_col(const std::vector<Condition> &conds, const ColMeta &col) const {
+        for (auto &cond : conds) {
+            if (cond.op != OP_EQ || cond.is_rhs_val) {
+                continue;
+            }
+            const TabCol *other = nullptr;
+            if (cond.lhs_col.tab_name == tab_name_ && cond.lhs_col.col_name == col.name) {
+                other = &cond.rhs_col;
+            } else if (cond.rhs_col.tab_name == tab_name_ && cond.rhs_col.col_name == col.name) {
+                other = &cond.lhs_col;
+            }
+            if (other == nullptr) {
+                continue;
+            }
+            auto &outer_cols = left_->cols();
+            auto pos = std::find_if(outer_cols.begin(), outer_cols.end(), [&](const ColMeta &outer) {
+                return outer.tab_name == other->tab_name && outer.name == other->col_name;
+            });
+            if (pos != outer_cols.end() && pos->type == col.type && pos->len == col.len) {
+                return &*pos;
+            }
+        }
+        return nullptr;
+    }
+
+    // 查找当前外表批次中每条记录匹配的内表rid
+    void probe() {
+        size_t n = left_batch_.size();
+        std::vector<char> keys(n * index_meta_->col_tot_len);
+        for (size_t i = 0; i < n; i++) {
+            char *key = keys.data() + i * index_meta_->col_tot_len;
+            int offset = 0;
+            for (auto &probe_key : keys_) {
+                memcpy(key + offset, left_batch_.row(i) + probe_key.outer_offset, probe_key.index_col.len);
+                offset += probe_key.index_col.len;
+            }
+        }
+        if (snapshot_ == nullptr) {
+            lookup(keys);
+            return;
+        }
+        std::shared_lock<std::shared_mutex> lock(snapshot_->latch());
+        lookup(keys);
+        for (auto &rids : matches_) {
+            rids.erase(std::remove_if(rids.begin(), rids.end(),
+                                      [this](const Rid &rid) { return !snapshot_->current(rid); }),
+                       rids.end());
+        }
+        // 快照之后修改过的记录按快照中的连接字段匹配外表记录
+        int prefix_len = 0;
+        for (auto &probe_key : keys_) {
+            prefix_len += probe_key.index_col.len;
+        }
+        std::unordered_map<std::string, std::vector<size_t>> outer;
+        for (size_t i = 0; i < n; i++) {
+            outer[std::string(keys.data() + i * index_meta_->col_tot_len, prefix_len)].push_back(i);
+        }
+        std::string prefix(prefix_len, 0);
+        snapshot_->for_each_changed([&](const Rid &rid, const char *data) {
+            if (data == nullptr) {
+                return;
+            }
+            int offset = 0;
+            for (auto &probe_key : keys_) {
+                memcpy(&prefix[offset], data + probe_key.index_col.offset, probe_key.index_col.len);
+                offset += probe_key.index_col.len;
+            }
+            auto it = outer.find(prefix);
+            if (it != outer.end()) {
+                for (size_t i : it->second) {
+                    matches_[i].push_back(rid);
+                }
+            }
+        });
+    }
+
+    // 在索引上查找keys中的每个key(只有前缀字段时在对应的区间上扫描)，结果放入matches_
+    void lookup(std::vector<char> &keys) {
+        size_t n = left_batch_.size();
+        Transaction *txn = context_ == nullptr ? nullptr : context_->txn_;
+        if (full_key_) {
+            std::vector<const char *> key_ptrs(n);
+            for (size_t i = 0; i < n; i++) {
+                key_ptrs[i] = keys.data() + i * index_meta_->col_tot_len;
+            }
+            index_->get_values_batch(key_ptrs, &matches_, txn);
+            return;
+        }
+        // 只有前缀字段时，其余字段分别取最小值和最大值作为扫描区间的上下界
+        matches_.assign(n, {});
+        int prefix_len = 0;
+        for (auto &probe_key : keys_) {
+            prefix_len += probe_key.index_col.len;
+        }
+        std::vector<char> upper(index_meta_->col_tot_len);
+        for (size_t i = 0; i < n; i++) {
+            char *lower = keys.data() + i * index_meta_->col_tot_len;
+            memcpy(upper.data(), lower, prefix_len);
+            int offset = prefix_len;
+            for (size_t c = keys_.size(); c < index_meta_->cols.size(); c++) {
+                auto &col = index_meta_->cols[c];
+                IndexScanExecutor::fill_extreme(lower + offset, col, false);
+                IndexScanExecutor::fill_extreme(upper.data() + offset, col, true);
+                offset += col.len;
+            }
+            IxScan scan(ih_, ih_->lower_bound(lower), ih_->upper_bound(upper.data()), sm_manager_->get_bpm());
+            for (; !scan.is_end(); scan.next()) {
+                matches_[i].push_back(scan.rid());
+            }
+        }
+    }
+};
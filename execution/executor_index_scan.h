@@ -1,43 +1,81 @@
 #pragma once
 
+#include <algorithm>
+#include <limits>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_filter.h"
+#include "execution_projector.h"
+#include "execution_snapshot.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
+/*
+IndexScanExecutor按索引的扫描区间读取记录，用全部条件过滤后输出上层需要的字段
+index-only模式下条件和输出的字段都包含在索引key中，直接从叶子结点取出key并按字段偏移还原到记录缓冲区中，
+不再通过Rid访问数据页
+哈希索引上的扫描条件对每个索引字段都有等值条件，扫描区间只有一个key，用一次哈希查找代替B+树的区间扫描
+读取快照时，在表的版本latch下一次确定扫描区间内的所有rid：索引项指向快照之后被修改过的记录时跳过，
+这些记录按快照中的数据用全部条件判断，满足条件的按索引顺序合并进来；之后逐条从快照中读取记录(见SnapshotReader)
+*/
 class IndexScanExecutor : public AbstractExecutor {
    private:
     std::string tab_name_;                      // 表名称
-    TabMeta tab_;                               // 表的元数据
+    const TabMeta *tab_;                        // 表的元数据
     std::vector<Condition> conds_;              // 扫描条件
     RmFileHandle *fh_;                          // 表的数据文件句柄
     std::vector<ColMeta> cols_;                 // 需要读取的字段
     size_t len_;                                // 选取出来的一条记录的长度
     std::vector<Condition> fed_conds_;          // 扫描条件，和conds_字段相同
 
-    std::vector<std::string> index_col_names_;  // index scan涉及到的索引包含的字段
-    IndexMeta index_meta_;                      // index scan涉及到的索引元数据
+    const IndexMeta *index_meta_;               // index scan涉及到的索引元数据
+    IxIndexHandle *ih_;                         // index scan涉及到的索引文件
+    IxHashIndexHandle *hash_;                   // index scan涉及到的哈希索引，B+树索引时为nullptr
+    bool is_desc_;                              // 按索引逆序扫描，scan_需以reverse模式构造
+    bool index_only_;                           // 只读取索引，不访问数据页
+    std::vector<char> key_buf_;                 // index-only模式下当前索引项的key
+    std::vector<char> rec_buf_;                 // index-only模式下由key还原的记录，只有索引字段有效；
+                                                // 读取快照时为快照中的记录
+    std::unique_ptr<SnapshotReader> snapshot_;  // 读取快照时不为nullptr
+    std::vector<char> snapshot_keys_;           // 读取快照的index-only模式下rids_中每个rid的key
 
     Rid rid_;
-    std::unique_ptr<RecScan> scan_;
+    std::unique_ptr<IxScan> scan_;
+    std::vector<Rid> rids_;                     // 哈希查找或读取快照时确定的rid
+    size_t rid_pos_ = 0;                        // rids_中当前的位置
+    RmRecordView current_;                      // rid_对应的记录，pin在缓冲池中
+    ConditionFilter filter_;                    // 由fed_conds_解析出的条件，在完整的记录上求值
+    ColumnProjector projector_;                 // 从完整的记录中取出上层需要的字段
 
     SmManager *sm_manager_;
 
    public:
-    IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, std::vector<std::string> index_col_names,
-                    Context *context) {
+    /**
+     * @param {TableHandle&} table 扫描的表
+     * @param {int} index_id 扫描的索引在表内的编号
+     * @param {vector<string>&} proj_cols 上层需要的字段，为空时输出完整的记录
+     * @param {bool} index_only 条件和proj_cols中的字段都是索引字段时，只读取索引
+     */
+    IndexScanExecutor(SmManager *sm_manager, const TableHandle &table, std::vector<Condition> conds, int index_id,
+                    Context *context, bool is_desc = false, const std::vector<std::string> &proj_cols = {},
+                    bool index_only = false) {
         sm_manager_ = sm_manager;
+        is_desc_ = is_desc;
+        index_only_ = index_only;
         context_ = context;
-        tab_name_ = std::move(tab_name);
-        tab_ = sm_manager_->db_.get_table(tab_name_);
+        tab_ = table.tab;
+        tab_name_ = tab_->cols[0].tab_name;     // 分区的字段属于分区表，条件按分区表的名称引用字段
         conds_ = std::move(conds);
-        // index_no_ = index_no;
-        index_col_names_ = index_col_names; 
-        index_meta_ = *(tab_.get_index_meta(index_col_names_));
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
-        cols_ = tab_.cols;
-        len_ = cols_.back().offset + cols_.back().len;
+        const IndexHandle &index = table.get_index(index_id);
+        index_meta_ = index.meta;
+        ih_ = index.ih;
+        hash_ = index.hash;
+        fh_ = table.fh;
+        projector_ = ColumnProjector(tab_->cols, proj_cols);
+        cols_ = projector_.cols();
+        len_ = projector_.len();
         std::map<CompOp, CompOp> swap_op = {
             {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
         };
@@ -52,19 +90,307 @@ class IndexScanExecutor : public AbstractExecutor {
             }
         }
         fed_conds_ = conds_;
+        filter_ = ConditionFilter(tab_->cols, fed_conds_);
+        snapshot_ = SnapshotReader::create(context, fh_);
+        if (index_only_ || snapshot_ != nullptr) {
+            key_buf_.resize(index_meta_->col_tot_len);
+            rec_buf_.assign(fh_->get_file_hdr().record_size, 0);
+        }
     }
 
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "IndexScanExecutor"; }
+
+    /**
+     * @description: 根据索引字段上的条件确定扫描区间[lower_bound(lower), upper_bound(upper))，
+     *               区间只需包含所有满足条件的记录，记录本身仍然用全部条件过滤
+     */
     void beginTuple() override {
-        
+        std::vector<char> lower(index_meta_->col_tot_len);
+        std::vector<char> upper(index_meta_->col_tot_len);
+        build_bounds(lower.data(), upper.data());
+        if (hash_ != nullptr) {
+            // 哈希索引只用于所有索引字段都有等值条件的扫描，此时lower与upper相同
+            if (memcmp(lower.data(), upper.data(), lower.size()) != 0) {
+                throw InternalError("Hash index scan requires equality conditions on all index columns");
+            }
+            rids_.clear();
+            rid_pos_ = 0;
+            if (snapshot_ != nullptr) {
+                std::shared_lock<std::shared_mutex> lock(snapshot_->latch());
+                hash_->get_value(lower.data(), &rids_, context_->txn_);
+                collect_snapshot(nullptr);
+            } else {
+                hash_->get_value(lower.data(), &rids_, context_ == nullptr ? nullptr : context_->txn_);
+            }
+            seek();
+            return;
+        }
+        Iid lower_iid = ih_->lower_bound(lower.data());
+        Iid upper_iid = ih_->upper_bound(upper.data());
+        scan_ = std::make_unique<IxScan>(ih_, lower_iid, upper_iid, sm_manager_->get_bpm(), is_desc_);
+        if (snapshot_ != nullptr) {
+            rids_.clear();
+            snapshot_keys_.clear();
+            rid_pos_ = 0;
+            std::shared_lock<std::shared_mutex> lock(snapshot_->latch());
+            collect_snapshot(scan_.get());
+        }
+        seek();
     }
 
     void nextTuple() override {
-        
+        assert(!is_end());
+        if (listed()) {
+            rid_pos_++;
+        } else {
+            scan_->next();
+        }
+        seek();
+    }
+
+    bool is_end() const override {
+        if (listed()) {
+            return rid_pos_ >= rids_.size();
+        }
+        return scan_ == nullptr || scan_->is_end();
     }
 
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        assert(!is_end());
+        if (projector_.identity() && !buffered()) {
+            return current_.materialize();
+        }
+        auto rec = std::make_unique<RmRecord>(len_);
+        projector_.project(current(), rec->data);
+        return rec;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        for (; !is_end() && !batch.full(); nextTuple()) {
+            projector_.project(current(), batch.append(rid_));
+        }
+        return !batch.empty();
     }
 
     Rid &rid() override { return rid_; }
+
+    // 把字段填为该类型的最小值或最大值，用于构造只约束了前缀字段的索引key
+    static void fill_extreme(char *dst, const ColMeta &col, bool max) {
+        if (col.type == TYPE_INT) {
+            int val = max ? std::numeric_limits<int>::max() : std::numeric_limits<int>::min();
+            memcpy(dst, &val, sizeof(int));
+        } else if (col.type == TYPE_FLOAT) {
+            float val = max ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+            memcpy(dst, &val, sizeof(float));
+        } else {
+            memset(dst, max ? 0xff : 0x00, col.len);
+        }
+    }
+
+   private:
+    // 记录是否在rec_buf_中，而不是pin在缓冲池中的current_
+    bool buffered() const { return index_only_ || snapshot_ != nullptr; }
+
+    // 是否按rids_而不是scan_逐条读取
+    bool listed() const { return hash_ != nullptr || snapshot_ != nullptr; }
+
+    const char *current() const { return buffered() ? rec_buf_.data() : current_.data(); }
+
+    // 从当前位置开始跳过不满足条件的记录，满足条件的记录保存在current_中
+    void seek() {
+        current_.release();
+        if (snapshot_ != nullptr) {
+            seek_snapshot();
+            return;
+        }
+        if (index_only_) {
+            seek_index_only();
+            return;
+        }
+        if (hash_ != nullptr) {
+            for (; rid_pos_ < rids_.size(); rid_pos_++) {
+                RmRecordView rec = fh_->get_record_view(rids_[rid_pos_]);
+                if (filter_.eval(rec.data())) {
+                    rid_ = rids_[rid_pos_];
+                    current_ = std::move(rec);
+                    return;
+                }
+            }
+            return;
+        }
+        while (!scan_->is_end()) {
+            Rid rid = scan_->rid();
+            RmRecordView rec = fh_->get_record_view(rid);
+            if (filter_.eval(rec.data())) {
+                rid_ = rid;
+                current_ = std::move(rec);
+                return;
+            }
+            scan_->next();
+        }
+    }
+
+    // index-only模式下跳过不满足条件的索引项，满足条件的索引项的key还原到rec_buf_中
+    void seek_index_only() {
+        while (!scan_->is_end()) {
+            Rid rid = scan_->entry(key_buf_.data());
+            restore_key(key_buf_.data());
+            if (filter_.eval(rec_buf_.data())) {
+                rid_ = rid;
+                return;
+            }
+            scan_->next();
+        }
+    }
+
+    // 读取快照时跳过不满足条件的记录，满足条件的记录保存在rec_buf_中
+    void seek_snapshot() {
+        for (; rid_pos_ < rids_.size(); rid_pos_++) {
+            if (index_only_) {
+                restore_key(snapshot_keys_.data() + rid_pos_ * key_buf_.size());
+            } else if (!snapshot_->read(rids_[rid_pos_], rec_buf_.data())) {
+                continue;
+            }
+            if (filter_.eval(rec_buf_.data())) {
+                rid_ = rids_[rid_pos_];
+                return;
+            }
+        }
+    }
+
+    // 把key中的各个索引字段还原到rec_buf_中
+    void restore_key(const char *key) {
+        int offset = 0;
+        for (auto &col : index_meta_->cols) {
+            memcpy(rec_buf_.data() + col.offset, key + offset, col.len);
+            offset += col.len;
+        }
+    }
+
+    // 从记录中取出索引key
+    void make_key(const char *rec, char *key) const {
+        int offset = 0;
+        for (auto &col : index_meta_->cols) {
+            memcpy(key + offset, rec + col.offset, col.len);
+            offset += col.len;
+        }
+    }
+
+    /**
+     * @description: 在版本latch下确定读取快照时要读取的rid。哈希索引时scan为nullptr，rids_中已是查找到的rid；
+     *               B+树索引时沿scan读取区间内的索引项，快照之后修改过的记录按key的顺序合并进来
+     */
+    void collect_snapshot(IxScan *scan) {
+        size_t key_len = key_buf_.size();
+        // 快照之后修改过、且快照中的记录满足条件的记录，它们的索引项不代表快照中的key
+        std::vector<Rid> changed;
+        std::vector<char> changed_keys;
+        snapshot_->for_each_changed([&](const Rid &rid, const char *data) {
+            if (data == nullptr || !filter_.eval(data)) {
+                return;
+            }
+            changed.push_back(rid);
+            changed_keys.resize(changed_keys.size() + key_len);
+            make_key(data, changed_keys.data() + changed_keys.size() - key_len);
+        });
+        if (scan == nullptr) {
+            rids_.erase(std::remove_if(rids_.begin(), rids_.end(),
+                                       [this](const Rid &rid) { return !snapshot_->current(rid); }),
+                        rids_.end());
+            rids_.insert(rids_.end(), changed.begin(), changed.end());
+            return;
+        }
+        std::vector<ColType> col_types;
+        std::vector<int> col_lens;
+        for (auto &col : index_meta_->cols) {
+            col_types.push_back(col.type);
+            col_lens.push_back(col.len);
+        }
+        // before(a, b)：扫描方向上a在b之前
+        auto before = [&](const char *a, const char *b) {
+            int res = ix_compare(a, b, col_types, col_lens);
+            return is_desc_ ? res > 0 : res < 0;
+        };
+        std::vector<size_t> order(changed.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return before(changed_keys.data() + a * key_len, changed_keys.data() + b * key_len);
+        });
+        auto add = [&](const Rid &rid, const char *key) {
+            rids_.push_back(rid);
+            if (index_only_) {
+                snapshot_keys_.insert(snapshot_keys_.end(), key, key + key_len);
+            }
+        };
+        size_t next = 0;
+        for (; !scan->is_end(); scan->next()) {
+            Rid rid = scan->entry(key_buf_.data());
+            for (; next < order.size() && before(changed_keys.data() + order[next] * key_len, key_buf_.data()); next++) {
+                add(changed[order[next]], changed_keys.data() + order[next] * key_len);
+            }
+            if (snapshot_->current(rid)) {
+                add(rid, key_buf_.data());
+            }
+        }
+        for (; next < order.size(); next++) {
+            add(changed[order[next]], changed_keys.data() + order[next] * key_len);
+        }
+    }
+
+    /**
+     * @description: 生成扫描区间的上下界key：从第一个索引字段开始，有等值条件的字段上下界都取该值，
+     *               遇到第一个没有等值条件的字段时取其范围条件(没有则取类型的最小/最大值)，之后的字段取最小/最大值
+     */
+    void build_bounds(char *lower, char *upper) const {
+        int offset = 0;
+        bool ranged = false;
+        for (auto &col : index_meta_->cols) {
+            const char *eq = nullptr;
+            const char *lo = nullptr;
+            const char *hi = nullptr;
+            if (!ranged) {
+                for (auto &cond : fed_conds_) {
+                    if (!cond.is_rhs_val || cond.lhs_col.tab_name != tab_name_ || cond.lhs_col.col_name != col.name) {
+                        continue;
+                    }
+                    const char *val = cond.rhs_val.raw->data;
+                    if (cond.op == OP_EQ) {
+                        eq = val;
+                    } else if (cond.op == OP_GT || cond.op == OP_GE) {
+                        if (lo == nullptr || ix_compare(val, lo, col.type, col.len) > 0) {
+                            lo = val;
+                        }
+                    } else if (cond.op == OP_LT || cond.op == OP_LE) {
+                        if (hi == nullptr || ix_compare(val, hi, col.type, col.len) < 0) {
+                            hi = val;
+                        }
+                    }
+                }
+            }
+            if (eq != nullptr) {
+                lo = eq;
+                hi = eq;
+            } else {
+                ranged = true;
+            }
+            if (lo != nullptr) {
+                memcpy(lower + offset, lo, col.len);
+            } else {
+                fill_extreme(lower + offset, col, false);
+            }
+            if (hi != nullptr) {
+                memcpy(upper + offset, hi, col.len);
+            } else {
+                fill_extreme(upper + offset, col, true);
+            }
+            offset += col.len;
+        }
+    }
 };
\ No newline at end of file
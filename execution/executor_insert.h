@@ -2,58 +2,83 @@
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_index_buffer.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
 class InsertExecutor : public AbstractExecutor {
    private:
-    TabMeta tab_;                   // 表的元数据
-    std::vector<Value> values_;     // 需要插入的数据
+    const TableHandle &table_;      // 表打开的句柄
+    const TabMeta &tab_;            // 表的元数据
+    std::vector<Value> values_;     // 需要插入的数据，多行insert时各行的值依次存放
     RmFileHandle *fh_;              // 表的数据文件句柄
-    std::string tab_name_;          // 表名称
-    Rid rid_;                       // 插入的位置，由于系统默认插入时不指定位置，因此当前rid_在插入后才赋值
+    Rid rid_;                       // 最后一行插入的位置，由于系统默认插入时不指定位置，因此当前rid_在插入后才赋值
     SmManager *sm_manager_;
 
    public:
-    InsertExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Value> values, Context *context) {
+    InsertExecutor(SmManager *sm_manager, const TableHandle &table, std::vector<Value> values, Context *context)
+        : table_(table), tab_(*table.tab) {
         sm_manager_ = sm_manager;
-        tab_ = sm_manager_->db_.get_table(tab_name);
-        values_ = values;
-        tab_name_ = tab_name;
-        if (values.size() != tab_.cols.size()) {
+        values_ = std::move(values);
+        if (values_.empty() || values_.size() % tab_.cols.size() != 0) {
             throw InvalidValueCountError();
         }
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = table_.fh;
         context_ = context;
     };
 
+    // 所有行先生成记录，再一次性按顺序写入数据页，最后把各个索引的修改排序后批量写入
     std::unique_ptr<RmRecord> Next() override {
-        // Make record buffer
-        RmRecord rec(fh_->get_file_hdr().record_size);
-        for (size_t i = 0; i < values_.size(); i++) {
-            auto &col = tab_.cols[i];
-            auto &val = values_[i];
-            if (col.type != val.type) {
-                throw IncompatibleTypeError(coltype2str(col.type), coltype2str(val.type));
+        // Make record buffers
+        size_t num_cols = tab_.cols.size();
+        size_t num_rows = values_.size() / num_cols;
+        int record_size = fh_->get_file_hdr().record_size;
+        std::vector<char *> records;
+        records.reserve(num_rows);
+        for (size_t r = 0; r < num_rows; r++) {
+            char *rec = context_->arena_.allocate(record_size);
+            memset(rec, 0, record_size);
+            for (size_t i = 0; i < num_cols; i++) {
+                auto &col = tab_.cols[i];
+                auto &val = values_[r * num_cols + i];
+                if (col.type != val.type) {
+                    throw IncompatibleTypeError(coltype2str(col.type), coltype2str(val.type));
+                }
+                val.init_raw(col.len, &context_->arena_);
+                memcpy(rec + col.offset, val.raw->data, col.len);
             }
-            val.init_raw(col.len);
-            memcpy(rec.data + col.offset, val.raw->data, col.len);
+            records.push_back(rec);
         }
         // Insert into record file
-        rid_ = fh_->insert_record(rec.data, context_);
-        
-        // Insert into index
-        for(size_t i = 0; i < tab_.indexes.size(); ++i) {
-            auto& index = tab_.indexes[i];
-            auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-            char* key = new char[index.col_tot_len];
-            int offset = 0;
-            for(size_t i = 0; i < index.col_num; ++i) {
-                memcpy(key + offset, rec.data + index.cols[i].offset, index.cols[i].len);
-                offset += index.cols[i].len;
+        context_->lock_for_write(fh_->GetFd(), {});
+        // 写入记录和登记插入版本时持有表的版本latch，快照读不会看到尚未登记的新记录
+        std::vector<Rid> rids;
+        {
+            VersionStore::Writer versions(context_->version_store_, context_->txn_, tab_.id, fh_->GetFd(), record_size);
+            rids = fh_->insert_records(records, context_);
+            for (auto &rid : rids) {
+                versions.insert(rid);
+            }
+        }
+        rid_ = rids.back();
+        if (context_->logging()) {
+            for (size_t r = 0; r < num_rows; r++) {
+                InsertLogRecord log_record(context_->txn_->get_transaction_id(), tab_.id, rids[r], records[r],
+                                           record_size);
+                fh_->set_page_lsn(rids[r].page_no, context_->log_mgr_->append_txn_log(context_->txn_, &log_record));
             }
-            ih->insert_entry(key, rid_, context_->txn_);
         }
+
+        // Insert into index
+        IndexWriteBuffer index_buffer(table_, context_);
+        for (size_t r = 0; r < num_rows; r++) {
+            sm_manager_->update_stats(tab_, nullptr, records[r]);
+            index_buffer.insert_record(records[r], rids[r]);
+        }
+        index_buffer.flush();
+        table_.bump_data_version();
+        // 新记录在写入之后才有位置，插入完成后再加锁，加锁失败时回滚能撤销完整的插入
+        context_->lock_for_write(fh_->GetFd(), rids);
         return nullptr;
     }
     Rid &rid() override { return rid_; }
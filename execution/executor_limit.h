@@ -0,0 +1,71 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+LimitExecutor只输出儿子节点的前limit条记录，之后不再向儿子节点读取
+用于没有排序或者排序已经由有序的索引扫描完成的LIMIT，需要排序的LIMIT由SortExecutor的top-N模式完成
+*/
+class LimitExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;
+    size_t limit_;
+    size_t emitted_ = 0;                        // 已经输出的记录数
+
+   public:
+    LimitExecutor(std::unique_ptr<AbstractExecutor> prev, size_t limit) {
+        prev_ = std::move(prev);
+        limit_ = limit;
+    }
+
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    std::string getType() override { return "LimitExecutor"; }
+
+    void beginTuple() override {
+        emitted_ = 0;
+        if (limit_ != 0) {
+            prev_->beginTuple();
+        }
+    }
+
+    void beginBatch() override {
+        emitted_ = 0;
+        if (limit_ != 0) {
+            prev_->beginBatch();
+        }
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++emitted_ < limit_) {
+            prev_->nextTuple();
+        }
+    }
+
+    bool is_end() const override { return emitted_ >= limit_ || prev_->is_end(); }
+
+    std::unique_ptr<RmRecord> Next() override { return prev_->Next(); }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(prev_->tupleLen());
+        while (emitted_ < limit_ && prev_->NextBatch(batch)) {
+            auto &sel = batch.selection();
+            if (sel.size() > limit_ - emitted_) {
+                sel.resize(limit_ - emitted_);
+            }
+            emitted_ += sel.size();
+            if (!batch.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Rid &rid() override { return prev_->rid(); }
+};
@@ -0,0 +1,220 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_filter.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+MergeJoinExecutor连接两个已经按连接字段升序排列的输入，输出左记录后接右记录
+conds的第一个条件为归并条件`左字段 op 右字段`，op可以是等值或范围比较，两个输入必须分别按这两个字段升序输出
+右表的记录按需读入缓冲区，对每条左记录维护两个只会前移的位置：lt_为第一条key >= 左key的右记录，
+le_为第一条key > 左key的右记录，则各运算符匹配的右记录区间为
+    EQ: [lt_, le_)    LT: [le_, 末尾)    LE: [lt_, 末尾)    GT: [0, lt_)    GE: [0, le_)
+左key递增时区间的端点也递增，两个输入都只读一遍。EQ/LT/LE不会再用到lt_之前的右记录，缓冲区会丢弃它们，
+等值连接只需缓存当前key相同的一组右记录；LT/LE需要读完右表，GT/GE需要缓存已读入的全部右记录
+所有连接条件(包括归并条件)最后都在连接后的记录上求值
+*/
+class MergeJoinExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> left_;    // 左儿子节点，按left_key_升序
+    std::unique_ptr<AbstractExecutor> right_;   // 右儿子节点，按right_key_升序
+    size_t len_;                                // join后获得的每条记录的长度
+    std::vector<ColMeta> cols_;                 // join后获得的记录的字段
+    std::vector<Condition> fed_conds_;          // join条件，第一个为归并条件
+    ConditionFilter filter_;                    // 在连接后的记录上求值fed_conds_
+    ColMeta left_key_;                          // 归并条件左侧字段，偏移相对左记录
+    ColMeta right_key_;                         // 归并条件右侧字段，偏移相对右记录
+    CompOp op_;                                 // 归并条件的运算符
+    bool isend;
+
+    // 左表当前批次
+    RowBatch left_batch_;
+    size_t left_pos_ = 0;
+    bool left_started_ = false;                 // left_pos_是否指向一条已经确定匹配区间的左记录
+
+    // 右表缓冲区，缓冲区第i行是右表的第base_ + i行
+    RowBatch right_batch_;
+    std::vector<char> right_rows_;
+    size_t right_count_ = 0;                    // 缓冲区的行数
+    size_t base_ = 0;                           // 缓冲区第一行在右表中的行号
+    bool right_done_ = false;                   // 右表是否已经读完
+    size_t lt_ = 0;                             // 第一条key >= 左key的右记录(右表中的行号)
+    size_t le_ = 0;                             // 第一条key > 左key的右记录(右表中的行号)
+    size_t emit_pos_ = 0;                       // 当前左记录下一个要连接的右记录(右表中的行号)
+    size_t emit_end_ = 0;
+
+    // 逐条执行时缓存的连接结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
+
+   public:
+    MergeJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right,
+                      std::vector<Condition> conds) {
+        left_ = std::move(left);
+        right_ = std::move(right);
+        len_ = left_->tupleLen() + right_->tupleLen();
+        cols_ = left_->cols();
+        auto right_cols = right_->cols();
+        for (auto &col : right_cols) {
+            col.offset += left_->tupleLen();
+        }
+        cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
+        isend = false;
+        fed_conds_ = std::move(conds);
+        filter_ = ConditionFilter(cols_, fed_conds_);
+
+        if (fed_conds_.empty() || fed_conds_[0].is_rhs_val) {
+            throw InternalError("Merge join requires a join condition between its inputs");
+        }
+        left_key_ = ConditionFilter::find_col(left_->cols(), fed_conds_[0].lhs_col);
+        right_key_ = ConditionFilter::find_col(right_->cols(), fed_conds_[0].rhs_col);
+        op_ = fed_conds_[0].op;
+        if (op_ == OP_NE || left_key_.type != right_key_.type || left_key_.len != right_key_.len) {
+            throw InternalError("Unexpected merge join condition");
+        }
+    }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "MergeJoinExecutor"; }
+
+    // 逐条执行时在内部按批次连接，每次返回缓存批次中的一条记录
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
+    }
+
+    bool is_end() const override { return out_batch_.empty(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(len_, out_batch_.row(out_pos_));
+    }
+
+    void beginBatch() override {
+        left_->beginBatch();
+        right_->beginBatch();
+        left_batch_.reset(left_->tupleLen());
+        left_pos_ = 0;
+        left_started_ = false;
+        right_rows_.clear();
+        right_count_ = 0;
+        base_ = 0;
+        right_done_ = false;
+        lt_ = 0;
+        le_ = 0;
+        isend = false;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        size_t left_len = left_->tupleLen();
+        size_t right_len = right_->tupleLen();
+        while (!isend && !batch.full()) {
+            if (!left_started_) {
+                if (left_pos_ == left_batch_.size()) {
+                    left_pos_ = 0;
+                    if (!left_->NextBatch(left_batch_)) {
+                        isend = true;
+                        break;
+                    }
+                }
+                seek(left_batch_.row(left_pos_));
+                left_started_ = true;
+                if (no_more_matches()) {
+                    isend = true;
+                    break;
+                }
+            }
+            if (emit_pos_ == emit_end_) {
+                left_pos_++;
+                left_started_ = false;
+                continue;
+            }
+            char *out = batch.append();
+            memcpy(out, left_batch_.row(left_pos_), left_len);
+            memcpy(out + left_len, right_row(emit_pos_++), right_len);
+            if (!filter_.eval(out)) {
+                batch.pop_back();
+            }
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    const char *right_row(size_t i) const { return right_rows_.data() + (i - base_) * right_->tupleLen(); }
+
+    int compare(const char *left_row, size_t right_i) const {
+        return ix_compare(left_row + left_key_.offset, right_row(right_i) + right_key_.offset, left_key_.type,
+                          left_key_.len);
+    }
+
+    // EQ/LT/LE在右表读完且所有右记录的key都小于当前左key时，之后的左记录都不会再有匹配
+    bool no_more_matches() const {
+        return op_ != OP_GT && op_ != OP_GE && right_done_ && lt_ == base_ + right_count_;
+    }
+
+    // 读入右表的下一个批次，返回是否读到了记录
+    bool load_right() {
+        if (right_done_ || !right_->NextBatch(right_batch_)) {
+            right_done_ = true;
+            return false;
+        }
+        size_t len = right_->tupleLen();
+        for (size_t i = 0; i < right_batch_.size(); i++) {
+            right_rows_.insert(right_rows_.end(), right_batch_.row(i), right_batch_.row(i) + len);
+        }
+        right_count_ += right_batch_.size();
+        return true;
+    }
+
+    // 为左记录确定匹配的右记录区间[emit_pos_, emit_end_)
+    void seek(const char *left_row) {
+        size_t end = base_ + right_count_;
+        // lt_/le_前移到第一条key >= / > 左key的右记录，缓冲区读完时继续读入右表
+        while (true) {
+            while (lt_ < end && compare(left_row, lt_) > 0) {
+                lt_++;
+            }
+            le_ = std::max(le_, lt_);
+            while (le_ < end && compare(left_row, le_) >= 0) {
+                le_++;
+            }
+            if (le_ < end || !load_right()) {
+                break;
+            }
+            end = base_ + right_count_;
+        }
+        if (op_ == OP_LT || op_ == OP_LE) {
+            while (load_right()) {
+            }
+            end = base_ + right_count_;
+        }
+        bool upper_bounded = op_ == OP_GT || op_ == OP_GE;
+        emit_pos_ = upper_bounded ? base_ : (op_ == OP_LT ? le_ : lt_);
+        emit_end_ = upper_bounded ? (op_ == OP_GT ? lt_ : le_) : (op_ == OP_EQ ? le_ : end);
+        // EQ/LT/LE之后的左记录不会再匹配lt_之前的右记录，丢弃缓冲区中超过一半的无用记录
+        if ((op_ == OP_EQ || op_ == OP_LT || op_ == OP_LE) && lt_ - base_ > right_count_ / 2 &&
+            lt_ - base_ >= ROW_BATCH_SIZE) {
+            size_t drop = lt_ - base_;
+            right_rows_.erase(right_rows_.begin(), right_rows_.begin() + drop * right_->tupleLen());
+            right_count_ -= drop;
+            base_ = lt_;
+        }
+    }
+};
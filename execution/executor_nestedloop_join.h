@@ -2,6 +2,7 @@
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_filter.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
@@ -14,10 +15,25 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
 
     std::vector<Condition> fed_conds_;          // join条件
     bool isend;
+    ConditionFilter filter_;                    // 在连接后的记录上求值fed_conds_
+    size_t block_size_;                         // 每个左表块最多缓存的字节数
+
+    // 块嵌套循环的状态：左表的记录按块缓存在内存中，右表每扫描一遍与一整块左表记录做连接
+    std::vector<char> block_;                   // 当前左表块，记录连续存放
+    size_t block_rows_ = 0;                     // 当前左表块的记录数
+    bool left_done_ = false;                    // 左表是否已经读完
+    RowBatch left_batch_;
+    RowBatch right_batch_;
+    size_t block_pos_ = 0;                      // 下一个要连接的左表块行
+    size_t right_pos_ = 0;                      // block_pos_行下一个要连接的右批次行
+
+    // 逐条执行时缓存的连接结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
 
    public:
     NestedLoopJoinExecutor(std::unique_ptr<AbstractExecutor> left, std::unique_ptr<AbstractExecutor> right, 
-                            std::vector<Condition> conds) {
+                            std::vector<Condition> conds, size_t block_size = NESTED_LOOP_JOIN_BLOCK_PAGES * PAGE_SIZE) {
         left_ = std::move(left);
         right_ = std::move(right);
         len_ = left_->tupleLen() + right_->tupleLen();
@@ -30,20 +46,119 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
         cols_.insert(cols_.end(), right_cols.begin(), right_cols.end());
         isend = false;
         fed_conds_ = std::move(conds);
-
+        filter_ = ConditionFilter(cols_, fed_conds_);
+        block_size_ = block_size;
     }
 
-    void beginTuple() override {
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "NestedLoopJoinExecutor"; }
 
+    // 逐条执行时同样按块连接，每次返回缓存批次中的一条记录，右表的扫描次数与批量执行相同
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
     }
 
     void nextTuple() override {
-        
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
     }
 
+    bool is_end() const override { return out_batch_.empty(); }
+
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        assert(!is_end());
+        return std::make_unique<RmRecord>(len_, out_batch_.row(out_pos_));
+    }
+
+    void beginBatch() override {
+        left_->beginBatch();
+        left_done_ = false;
+        isend = !load_block();
+        if (!isend) {
+            right_->beginBatch();
+            isend = !right_->NextBatch(right_batch_);
+        }
+        block_pos_ = 0;
+        right_pos_ = 0;
+    }
+
+    /**
+     * @description: 块嵌套循环连接：左表每次读入最多block_size_字节的一块记录，与右表的各个批次依次连接，
+     *               右表扫描完后再读入下一块并重新扫描右表，右表的扫描次数从左表的行数降为左表的块数。
+     *               每个左表块内按(右批次, 左行, 右行)的顺序输出
+     */
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(len_);
+        while (!isend && !batch.full()) {
+            if (block_pos_ == block_rows_) {
+                // 当前右批次已经与整个左表块连接完，读取右表的下一个批次
+                block_pos_ = 0;
+                right_pos_ = 0;
+                if (!right_->NextBatch(right_batch_)) {
+                    // 右表扫描完毕，读入左表的下一块并重新扫描右表
+                    if (!load_block()) {
+                        isend = true;
+                        break;
+                    }
+                    right_->beginBatch();
+                    if (!right_->NextBatch(right_batch_)) {
+                        isend = true;
+                        break;
+                    }
+                }
+            }
+            join_block(batch);
+        }
+        return !batch.empty();
     }
 
     Rid &rid() override { return _abstract_rid; }
+
+   private:
+    // 读入左表的下一块记录，块中至少有一个批次，返回是否读到了记录
+    bool load_block() {
+        block_.clear();
+        block_rows_ = 0;
+        size_t left_len = left_->tupleLen();
+        while (!left_done_ && block_.size() < block_size_) {
+            if (!left_->NextBatch(left_batch_)) {
+                left_done_ = true;
+                break;
+            }
+            for (size_t i = 0; i < left_batch_.size(); i++) {
+                block_.insert(block_.end(), left_batch_.row(i), left_batch_.row(i) + left_len);
+            }
+            block_rows_ += left_batch_.size();
+        }
+        return block_rows_ != 0;
+    }
+
+    // 连接左表块[block_pos_, )与right_batch_，直到连接完或batch已满
+    void join_block(RowBatch &batch) {
+        size_t left_len = left_->tupleLen();
+        size_t right_len = right_->tupleLen();
+        while (block_pos_ < block_rows_ && !batch.full()) {
+            const char *left_row = block_.data() + block_pos_ * left_len;
+            for (; right_pos_ < right_batch_.size() && !batch.full(); right_pos_++) {
+                char *out = batch.append();
+                memcpy(out, left_row, left_len);
+                memcpy(out + left_len, right_batch_.row(right_pos_), right_len);
+                if (!filter_.eval(out)) {
+                    batch.pop_back();
+                }
+            }
+            if (right_pos_ == right_batch_.size()) {
+                right_pos_ = 0;
+                block_pos_++;
+            }
+        }
+    }
 };
\ No newline at end of file
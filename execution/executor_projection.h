@@ -11,6 +11,7 @@ class ProjectionExecutor : public AbstractExecutor {
     std::vector<ColMeta> cols_;                     // 需要投影的字段
     size_t len_;                                    // 字段总长度
     std::vector<size_t> sel_idxs_;                  
+    RowBatch prev_batch_;                           // 儿子节点返回的批次
 
    public:
     ProjectionExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &sel_cols) {
@@ -29,13 +30,49 @@ class ProjectionExecutor : public AbstractExecutor {
         len_ = curr_offset;
     }
 
-    void beginTuple() override {}
+    size_t tupleLen() const override { return len_; }
 
-    void nextTuple() override {}
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "ProjectionExecutor"; }
+
+    void beginTuple() override { prev_->beginTuple(); }
+
+    void beginBatch() override { prev_->beginBatch(); }
+
+    void nextTuple() override { prev_->nextTuple(); }
+
+    bool is_end() const override { return prev_->is_end(); }
 
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        auto prev_rec = prev_->Next();
+        auto rec = std::make_unique<RmRecord>(len_);
+        project(prev_rec->data, rec->data);
+        return rec;
     }
 
-    Rid &rid() override { return _abstract_rid; }
+    bool NextBatch(RowBatch &batch) override {
+        // 儿子节点的批次与batch容量相同，投影后不会超过batch的容量
+        if (prev_batch_.capacity() != batch.capacity()) {
+            prev_batch_ = RowBatch(batch.capacity());
+        }
+        batch.reset(len_);
+        if (!prev_->NextBatch(prev_batch_)) {
+            return false;
+        }
+        for (size_t i = 0; i < prev_batch_.size(); i++) {
+            project(prev_batch_.row(i), batch.append(prev_batch_.rid(i)));
+        }
+        return true;
+    }
+
+    Rid &rid() override { return prev_->rid(); }
+
+   private:
+    void project(const char *src, char *dst) const {
+        auto &prev_cols = prev_->cols();
+        for (size_t i = 0; i < cols_.size(); i++) {
+            memcpy(dst + cols_[i].offset, src + prev_cols[sel_idxs_[i]].offset, cols_[i].len);
+        }
+    }
 };
\ No newline at end of file
@@ -3,6 +3,11 @@
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_filter.h"
+#include "execution_parallel_scan.h"
+#include "execution_pax_scan.h"
+#include "execution_projector.h"
+#include "execution_snapshot.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
@@ -13,39 +18,204 @@ class SeqScanExecutor : public AbstractExecutor {
     RmFileHandle *fh_;                  // 表的数据文件句柄
     std::vector<ColMeta> cols_;         // scan后生成的记录的字段
     size_t len_;                        // scan后生成的每条记录的长度
+    size_t rec_len_;                    // 表中完整记录的长度
     std::vector<Condition> fed_conds_;  // 同conds_，两个字段相同
 
     Rid rid_;
-    std::unique_ptr<RecScan> scan_;     // table_iterator
+    std::unique_ptr<RmScan> scan_;      // table_iterator
+    std::unique_ptr<PaxBatchScan> pax_;     // PAX格式的表串行批量扫描时按页面读取scan_，为空时逐条复制记录
+    ConditionFilter filter_;            // 由fed_conds_解析出的条件，在完整的记录上求值
+    std::vector<RmZoneCondition> zone_conds_;   // fed_conds_中字段有zone map的常量条件，扫描据此跳过页面
+    ColumnProjector projector_;         // 从完整的记录中取出上层需要的字段
+    RowBatch scan_batch_;               // 需要投影时，扫描到的完整记录先放在这里过滤
+    std::shared_ptr<MorselScan> parallel_;  // 表足够大时NextBatch()使用的并行扫描，为空时由scan_串行扫描
+    std::unique_ptr<SnapshotScan> snapshot_;    // SELECT读取事务的快照，为空时读取堆表中最新的记录
+    std::vector<ColMeta> rec_cols_;     // 表中完整记录的字段
+    std::shared_ptr<const RuntimeFilter> runtime_filter_;       // hash连接下推的过滤器，在完整的记录上求值
+    std::shared_ptr<const RuntimeFilter> out_runtime_filter_;   // 同上，在输出的记录上求值，用于并行扫描和PAX批量扫描
 
     SmManager *sm_manager_;
 
    public:
-    SeqScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<Condition> conds, Context *context) {
+    /**
+     * @param {TableHandle&} table 扫描的表
+     * @param {vector<string>&} proj_cols 上层需要的字段，为空时输出完整的记录
+     */
+    SeqScanExecutor(SmManager *sm_manager, const TableHandle &table, std::vector<Condition> conds, Context *context,
+                    const std::vector<std::string> &proj_cols = {}) {
         sm_manager_ = sm_manager;
-        tab_name_ = std::move(tab_name);
+        const TabMeta &tab = *table.tab;
+        tab_name_ = tab.name;
         conds_ = std::move(conds);
-        TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
-        cols_ = tab.cols;
-        len_ = cols_.back().offset + cols_.back().len;
+        fh_ = table.fh;
 
         context_ = context;
 
         fed_conds_ = conds_;
+        filter_ = ConditionFilter(tab.cols, fed_conds_);
+        zone_conds_ = filter_.zone_conditions(fh_->zone_map());
+        rec_len_ = tab.cols.back().offset + tab.cols.back().len;
+        rec_cols_ = tab.cols;
+        projector_ = ColumnProjector(tab.cols, proj_cols);
+        cols_ = projector_.cols();
+        len_ = projector_.len();
+        snapshot_ = SnapshotScan::create(context_, fh_->GetFd(), rec_len_);
     }
 
+    ~SeqScanExecutor() override { finish_parallel(); }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "SeqScanExecutor"; }
+
     void beginTuple() override {
-        
+        finish_parallel();
+        pax_.reset();
+        scan_ = std::make_unique<RmScan>(fh_, RM_FIRST_RECORD_PAGE, -1, false, zone_conds_);
+        seek();
     }
 
     void nextTuple() override {
-        
+        assert(!is_end());
+        scan_->next();
+        seek();
     }
 
+    bool is_end() const override { return scan_ == nullptr || scan_->is_end(); }
+
     std::unique_ptr<RmRecord> Next() override {
-        return nullptr;
+        assert(!is_end());
+        if (projector_.identity()) {
+            return std::make_unique<RmRecord>(len_, scan_->record());
+        }
+        auto rec = std::make_unique<RmRecord>(len_);
+        projector_.project(scan_->record(), rec->data);
+        return rec;
+    }
+
+    /**
+     * @description: 表的页面不少于PARALLEL_SCAN_MIN_PAGES时按morsel并行扫描，输出的批次不保持表中的顺序。
+     *               读取快照时只有批量执行的接口使用快照，UPDATE/DELETE通过逐条执行的接口读取最新的记录
+     */
+    void beginBatch() override {
+        finish_parallel();
+        pax_.reset();
+        size_t num_workers = MorselScan::num_workers(fh_);
+        if (num_workers > 1) {
+            scan_.reset();
+            parallel_ = std::make_shared<MorselScan>(fh_, filter_, projector_, rec_len_, snapshot_.get());
+            parallel_->start(num_workers - 1);
+        } else {
+            // PaxBatchScan可以直接读取压缩页缓存中的页面
+            bool pax = snapshot_ == nullptr && fh_->get_file_hdr().is_pax();
+            scan_ = std::make_unique<RmScan>(fh_, RM_FIRST_RECORD_PAGE, -1, pax, zone_conds_);
+            if (snapshot_ != nullptr) {
+                snapshot_->begin(RM_FIRST_RECORD_PAGE);
+            } else if (pax) {
+                pax_ = std::make_unique<PaxBatchScan>(scan_.get(), rec_len_);
+            }
+        }
+    }
+
+    /**
+     * @description: 把扫描到的记录整批复制到批次中，再用过滤内核批量求值条件，
+     *               一批记录全部不满足条件时继续扫描下一批；需要投影时只把满足条件的记录的部分字段复制到batch中。
+     *               PAX格式的表直接在页面的minipage上过滤，只取出满足条件的记录中需要的字段
+     */
+    bool NextBatch(RowBatch &batch) override {
+        if (parallel_ != nullptr || pax_ != nullptr) {
+            while (parallel_ != nullptr ? parallel_->next(batch) : pax_->next(filter_, projector_, batch)) {
+                if (out_runtime_filter_ != nullptr) {
+                    out_runtime_filter_->filter(batch);
+                }
+                if (!batch.empty()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (!projector_.identity()) {
+            // 完整记录的批次与batch容量相同，投影后不会超过batch的容量
+            if (scan_batch_.capacity() != batch.capacity()) {
+                scan_batch_ = RowBatch(batch.capacity());
+            }
+            batch.reset(len_);
+            if (next_full_batch(scan_batch_)) {
+                for (size_t i = 0; i < scan_batch_.size(); i++) {
+                    projector_.project(scan_batch_.row(i), batch.append(scan_batch_.rid(i)));
+                }
+            }
+            return !batch.empty();
+        }
+        return next_full_batch(batch);
     }
 
     Rid &rid() override { return rid_; }
+
+    /**
+     * @description: 串行扫描在复制和投影记录之前求值过滤器；并行扫描和PAX批量扫描的记录由扫描线程或页面直接输出，
+     *               在输出的批次上求值
+     */
+    bool push_runtime_filter(std::shared_ptr<const RuntimeFilter> filter) override {
+        runtime_filter_ = filter != nullptr ? filter->bind(rec_cols_) : nullptr;
+        out_runtime_filter_ = filter;
+        return runtime_filter_ != nullptr;
+    }
+
+    // 并行扫描本表时的worker数，表太小时为1
+    size_t parallel_workers() const { return MorselScan::num_workers(fh_); }
+
+    /**
+     * @description: 并行扫描整张表，每个worker把过滤并投影后的批次交给consume，用于按worker分别聚合再合并
+     * @return {bool} 扫描是否完成，consume返回false而停止时为false
+     * @param {size_t} num_workers worker数，consume的第一个参数为worker的编号
+     * @param {Consumer&} consume 在各worker的线程上并发调用
+     */
+    bool scan_parallel(size_t num_workers, const MorselScan::Consumer &consume) {
+        auto scan = std::make_shared<MorselScan>(fh_, filter_, projector_, rec_len_, snapshot_.get());
+        return scan->run(num_workers, consume);
+    }
+
+   private:
+    // 停止上一次的并行扫描，等待仍在扫描的worker结束
+    void finish_parallel() {
+        if (parallel_ != nullptr) {
+            parallel_->finish();
+            parallel_.reset();
+        }
+    }
+
+    // 扫描下一批满足条件的完整记录
+    bool next_full_batch(RowBatch &batch) {
+        bool more;
+        do {
+            batch.reset(rec_len_);
+            if (snapshot_ != nullptr) {
+                more = snapshot_->fill(*scan_, batch);
+            } else {
+                for (; !scan_->is_end() && !batch.full(); scan_->next()) {
+                    batch.append(scan_->record(), scan_->rid());
+                }
+                more = !scan_->is_end();
+            }
+            filter_.filter(batch);
+            if (runtime_filter_ != nullptr) {
+                runtime_filter_->filter(batch);
+            }
+        } while (batch.empty() && more);
+        return !batch.empty();
+    }
+
+    // 从当前位置开始跳过不满足条件的记录
+    void seek() {
+        while (!scan_->is_end() && (!filter_.eval(scan_->record()) ||
+                                    (runtime_filter_ != nullptr && !runtime_filter_->may_match(scan_->record())))) {
+            scan_->next();
+        }
+        if (!scan_->is_end()) {
+            rid_ = scan_->rid();
+        }
+    }
 };
\ No newline at end of file
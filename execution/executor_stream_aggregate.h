@@ -0,0 +1,120 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "execution_aggregate.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/*
+StreamAggregateExecutor对分组字段相同的记录连续出现的输入(如按以分组字段开头的索引顺序扫描)做流式聚合
+只保存当前分组的状态(格式见execution_aggregate.h)，记录的规范化key与当前分组不同时输出当前分组并开始新的分组，
+不缓存输入，也不需要hash表
+没有分组字段时整个输入是一组，输入为空也输出一条记录(COUNT为0，其余聚合结果为0)
+*/
+class StreamAggregateExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;    // 儿子节点，分组字段相同的记录连续出现
+    AggregateFunctions aggs_;                   // 分组状态的格式和聚合函数的计算
+    std::vector<char> state_;                   // 当前分组的状态
+    bool has_group_ = false;                    // state_中是否有还没有输出的分组
+    bool is_empty_ = true;                      // 是否还没有读到输入记录
+    std::vector<char> key_buf_;                 // 当前记录的规范化的key
+
+    // 儿子节点当前批次
+    RowBatch in_batch_;
+    size_t in_pos_ = 0;
+    bool input_done_ = false;
+
+    // 逐条执行时缓存的输出结果
+    RowBatch out_batch_;
+    size_t out_pos_ = 0;
+
+   public:
+    /**
+     * @param {unique_ptr<AbstractExecutor>} prev 儿子节点
+     * @param {vector<TabCol>} group_cols 分组字段
+     * @param {vector<AggExpr>} aggs 聚合函数
+     */
+    StreamAggregateExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<TabCol> &group_cols,
+                            const std::vector<AggExpr> &aggs) {
+        prev_ = std::move(prev);
+        aggs_ = AggregateFunctions(prev_.get(), group_cols, aggs);
+        state_.resize(aggs_.state_len());
+        key_buf_.resize(aggs_.key_len());
+    }
+
+    size_t tupleLen() const override { return aggs_.len(); }
+
+    const std::vector<ColMeta> &cols() const override { return aggs_.cols(); }
+
+    std::string getType() override { return "StreamAggregateExecutor"; }
+
+    // 逐条执行时在内部按批次聚合，每次返回缓存批次中的一条记录
+    void beginTuple() override {
+        beginBatch();
+        out_pos_ = 0;
+        NextBatch(out_batch_);
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        if (++out_pos_ == out_batch_.size()) {
+            out_pos_ = 0;
+            NextBatch(out_batch_);
+        }
+    }
+
+    bool is_end() const override { return out_batch_.empty(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return std::make_unique<RmRecord>(aggs_.len(), out_batch_.row(out_pos_));
+    }
+
+    void beginBatch() override {
+        prev_->beginBatch();
+        in_batch_.reset(prev_->tupleLen());
+        in_pos_ = 0;
+        input_done_ = false;
+        has_group_ = false;
+        is_empty_ = true;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        batch.reset(aggs_.len());
+        while (!batch.full() && !input_done_) {
+            if (in_pos_ == in_batch_.size()) {
+                in_pos_ = 0;
+                if (!prev_->NextBatch(in_batch_)) {
+                    input_done_ = true;
+                    if (!has_group_ && is_empty_ && !aggs_.has_group_cols()) {
+                        // 没有分组字段时，空输入也输出一组
+                        std::fill(state_.begin(), state_.end(), 0);
+                        has_group_ = true;
+                    }
+                    if (has_group_) {
+                        aggs_.finalize(state_.data(), batch.append());
+                        has_group_ = false;
+                    }
+                    break;
+                }
+            }
+            const char *row = in_batch_.row(in_pos_++);
+            is_empty_ = false;
+            aggs_.encode_key(row, key_buf_.data());
+            if (has_group_ && memcmp(state_.data(), key_buf_.data(), key_buf_.size()) == 0) {
+                aggs_.update(state_.data(), row);
+                continue;
+            }
+            if (has_group_) {
+                aggs_.finalize(state_.data(), batch.append());
+            }
+            aggs_.init(state_.data(), key_buf_.data(), row);
+            has_group_ = true;
+        }
+        return !batch.empty();
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+};
@@ -2,35 +2,107 @@
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
+#include "execution_index_buffer.h"
 #include "index/ix.h"
 #include "system/sm.h"
 
 class UpdateExecutor : public AbstractExecutor {
    private:
-    TabMeta tab_;
+    const TableHandle &table_;
+    const TabMeta &tab_;
     std::vector<Condition> conds_;
     RmFileHandle *fh_;
     std::vector<Rid> rids_;
-    std::string tab_name_;
     std::vector<SetClause> set_clauses_;
     SmManager *sm_manager_;
 
    public:
-    UpdateExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<SetClause> set_clauses,
-                   std::vector<Condition> conds, std::vector<Rid> rids, Context *context) {
+    UpdateExecutor(SmManager *sm_manager, const TableHandle &table, std::vector<SetClause> set_clauses,
+                   std::vector<Condition> conds, std::vector<Rid> rids, Context *context)
+        : table_(table), tab_(*table.tab) {
         sm_manager_ = sm_manager;
-        tab_name_ = tab_name;
         set_clauses_ = set_clauses;
-        tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = table_.fh;
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
     std::unique_ptr<RmRecord> Next() override {
-        
+        std::vector<ColMeta> set_cols;
+        for (auto &set_clause : set_clauses_) {
+            auto col = tab_.get_col(set_clause.lhs.col_name);
+            if (col->type != set_clause.rhs.type) {
+                throw IncompatibleTypeError(coltype2str(col->type), coltype2str(set_clause.rhs.type));
+            }
+            set_clause.rhs.init_raw(col->len, &context_->arena_);
+            set_cols.push_back(*col);
+        }
+        // 修改之前锁住所有要更新的记录，加锁失败时语句还没有修改任何记录
+        context_->lock_for_write(fh_->GetFd(), rids_);
+        // 先更新所有记录，key发生变化的索引项在最后按key排序后统一修改
+        IndexWriteBuffer index_buffer(table_, context_);
+        int record_size = fh_->get_file_hdr().record_size;
+        for (auto &rid : rids_) {
+            // 修改一条记录时持有表的版本latch，快照读在修改前后都看到完整的记录
+            VersionStore::Writer versions(context_->version_store_, context_->txn_, tab_.id, fh_->GetFd(), record_size);
+            // 旧记录只用于生成索引key和旧版本，直接读取页面，不复制
+            auto rec = fh_->get_record_view(rid);
+            RmRecord new_rec(rec.size(), rec.data(), &context_->arena_);
+            for (size_t i = 0; i < set_clauses_.size(); i++) {
+                memcpy(new_rec.data + set_cols[i].offset, set_clauses_[i].rhs.raw->data, set_cols[i].len);
+            }
+            sm_manager_->update_stats(tab_, rec.data(), new_rec.data);
+            if (!fh_->can_update_in_place(rid, new_rec.data)) {
+                move_record(rid, rec, new_rec.data, versions, index_buffer);
+                continue;
+            }
+            index_buffer.update_record(rec.data(), new_rec.data, rid);
+            versions.update(rid, rec.data(), new_rec.data);
+            lsn_t lsn = INVALID_LSN;
+            if (context_->logging()) {
+                UpdateLogRecord log_record(context_->txn_->get_transaction_id(), tab_.id, rid, rec.data(),
+                                           new_rec.data, rec.size());
+                lsn = context_->log_mgr_->append_txn_log(context_->txn_, &log_record);
+            }
+            rec.release();
+            fh_->update_record(rid, new_rec.data, context_);
+            if (lsn != INVALID_LSN) {
+                fh_->set_page_lsn(rid.page_no, lsn);
+            }
+        }
+        index_buffer.flush();
+        table_.bump_data_version();
         return nullptr;
     }
 
     Rid &rid() override { return _abstract_rid; }
+
+   private:
+    /**
+     * @description: 变长的新记录在原来的页面中放不下，删除旧记录后把新记录插入到其他位置。
+     *               按一次删除和一次插入登记版本、写日志，每条日志仍然只修改一个页面，回滚时分别撤销
+     */
+    void move_record(const Rid &rid, RmRecordView &rec, char *new_record, VersionStore::Writer &versions,
+                     IndexWriteBuffer &index_buffer) {
+        index_buffer.delete_record(rec.data());
+        versions.remove(rid, rec.data());
+        lsn_t lsn = INVALID_LSN;
+        if (context_->logging()) {
+            DeleteLogRecord log_record(context_->txn_->get_transaction_id(), tab_.id, rid, rec.data(), rec.size());
+            lsn = context_->log_mgr_->append_txn_log(context_->txn_, &log_record);
+        }
+        int record_size = rec.size();
+        rec.release();
+        fh_->delete_record(rid, context_);
+        if (lsn != INVALID_LSN) {
+            fh_->set_page_lsn(rid.page_no, lsn);
+        }
+        Rid new_rid = fh_->insert_record(new_record, context_);
+        versions.insert(new_rid);
+        if (context_->logging()) {
+            InsertLogRecord log_record(context_->txn_->get_transaction_id(), tab_.id, new_rid, new_record, record_size);
+            fh_->set_page_lsn(new_rid.page_no, context_->log_mgr_->append_txn_log(context_->txn_, &log_record));
+        }
+        index_buffer.insert_record(new_record, new_rid);
+    }
 };
\ No newline at end of file
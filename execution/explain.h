@@ -0,0 +1,363 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "executor_abstract.h"
+#include "optimizer/plan.h"
+#include "storage/buffer_pool_instance.h"
+
+// 一个算子的实际执行统计。时间和页面访问包含儿子节点，页面访问只统计执行语句的线程
+struct OperatorStats {
+    std::string executor;       // 实际生成的算子，读取快照时可能与计划中的算子不同
+    size_t rows = 0;            // 输出的记录数，多次执行时累加
+    size_t loops = 0;           // 执行次数，如块嵌套循环连接的内表每个外表块执行一次
+    uint64_t time_ns = 0;
+    uint64_t fetches = 0;       // fetch_page的次数
+    uint64_t hits = 0;          // 其中在缓冲池中命中的次数
+};
+
+/*
+InstrumentedExecutor包装一个算子，转发所有接口并记录执行统计
+beginTuple()/nextTuple()之后没有结束时算作输出一条记录，NextBatch()按批次中的记录数累加，
+因此只用rid()读取记录的UPDATE/DELETE的扫描也能统计行数
+按具体类型识别儿子节点的算子(如并行的hash聚合)看到的是包装后的算子，EXPLAIN ANALYZE时串行执行
+*/
+class InstrumentedExecutor : public AbstractExecutor {
+   private:
+    // 统计一次调用的耗时和页面访问
+    class Timer {
+       public:
+        explicit Timer(OperatorStats *stats)
+            : stats_(stats), start_(std::chrono::steady_clock::now()), counter_(PageAccessCounter::local()),
+              fetches_(counter_.fetches), hits_(counter_.hits) {}
+
+        ~Timer() {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            stats_->time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            stats_->fetches += counter_.fetches - fetches_;
+            stats_->hits += counter_.hits - hits_;
+        }
+
+       private:
+        OperatorStats *stats_;
+        std::chrono::steady_clock::time_point start_;
+        PageAccessCounter &counter_;
+        uint64_t fetches_;
+        uint64_t hits_;
+    };
+
+    std::unique_ptr<AbstractExecutor> prev_;
+    OperatorStats *stats_;
+
+   public:
+    InstrumentedExecutor(std::unique_ptr<AbstractExecutor> prev, OperatorStats *stats)
+        : prev_(std::move(prev)), stats_(stats) {
+        stats_->executor = prev_->getType();
+    }
+
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    std::string getType() override { return prev_->getType(); }
+
+    void beginTuple() override {
+        Timer timer(stats_);
+        stats_->loops++;
+        prev_->beginTuple();
+        stats_->rows += !prev_->is_end();
+    }
+
+    void nextTuple() override {
+        Timer timer(stats_);
+        prev_->nextTuple();
+        stats_->rows += !prev_->is_end();
+    }
+
+    bool is_end() const override { return prev_->is_end(); }
+
+    Rid &rid() override { return prev_->rid(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        Timer timer(stats_);
+        return prev_->Next();
+    }
+
+    void beginBatch() override {
+        Timer timer(stats_);
+        stats_->loops++;
+        prev_->beginBatch();
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        Timer timer(stats_);
+        bool has_rows = prev_->NextBatch(batch);
+        stats_->rows += batch.size();
+        return has_rows;
+    }
+
+    ColMeta get_col_offset(const TabCol &target) override { return prev_->get_col_offset(target); }
+};
+
+/*
+ExplainStats生成EXPLAIN的输出：构造时按计划树生成每个节点的描述，
+EXPLAIN ANALYZE时Portal生成的每个算子都通过instrument()包装，最后在各节点后附上实际执行统计
+节点的描述只读取计划，不依赖生成的算子，语句执行之后也可以生成
+*/
+class ExplainStats {
+   public:
+    ExplainStats(const std::shared_ptr<Plan> &plan, bool analyze) : analyze_(analyze) {
+        describe(plan, 0);
+    }
+
+    bool analyze() const { return analyze_; }
+
+    // 包装plan对应的算子，同一个计划节点生成多个算子时统计累加
+    std::unique_ptr<AbstractExecutor> instrument(const Plan *plan, std::unique_ptr<AbstractExecutor> executor) {
+        if (executor == nullptr) {
+            return executor;
+        }
+        return std::make_unique<InstrumentedExecutor>(std::move(executor), &stats_[plan]);
+    }
+
+    // 输出的每一行，不含换行符
+    std::vector<std::string> format(uint64_t total_ns = 0) const {
+        std::vector<std::string> lines;
+        for (auto &node : nodes_) {
+            std::string indent(node.depth * 2, ' ');
+            std::string line = (node.depth == 0 ? "" : indent + "->  ") + node.title;
+            auto it = stats_.find(node.plan);
+            if (it != stats_.end()) {
+                line += format_stats(it->second, node);
+            } else if (analyze_ && node.has_executor) {
+                line += " (never executed)";
+            }
+            lines.push_back(std::move(line));
+            std::string detail_indent = node.depth == 0 ? "  " : indent + "      ";
+            for (auto &detail : node.details) {
+                lines.push_back(detail_indent + detail);
+            }
+        }
+        if (analyze_) {
+            lines.push_back("Execution Time: " + format_ms(total_ns) + " ms");
+        }
+        return lines;
+    }
+
+   private:
+    struct Node {
+        int depth;
+        const Plan *plan;
+        std::string title;                  // 节点类型和访问的表
+        std::vector<std::string> details;   // 条件、排序键等，每项一行
+        bool is_dml = false;                // INSERT/UPDATE/DELETE节点只统计时间
+        bool has_executor = true;           // 节点是否单独生成算子
+    };
+
+    void describe(const std::shared_ptr<Plan> &plan, int depth) {
+        if (auto x = std::dynamic_pointer_cast<DMLPlan>(plan)) {
+            if (x->tag == T_select) {
+                // select的DMLPlan只是ProjectionPlan的外壳
+                describe(x->subplan_, depth);
+                return;
+            }
+            Node &node = add_node(x.get(), depth, dml_name(x->tag) + " on " + x->tab_name_);
+            node.is_dml = true;
+            if (x->tag == T_Insert) {
+                node.details.push_back("Rows: " + std::to_string(x->values_.size()));
+            }
+            for (auto &set_clause : x->set_clauses_) {
+                node.details.push_back("Set: " + set_clause.lhs.col_name + " = " + value_str(set_clause.rhs));
+            }
+            if (x->subplan_ != nullptr) {
+                describe(x->subplan_, depth + 1);
+            }
+        } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+            add_node(x.get(), depth, "Projection").details.push_back("Output: " + cols_str(x->sel_cols_));
+            describe(x->subplan_, depth + 1);
+        } else if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+            describe_scan(x.get(), depth);
+        } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+            Node &node = add_node(x.get(), depth, join_name(x->tag));
+            if (!x->conds_.empty()) {
+                node.details.push_back("Join Cond: " + conds_str(x->conds_));
+            }
+            describe(x->left_, depth + 1);
+            if (x->tag == T_IndexNestLoop) {
+                // 内表不单独生成算子，由连接算子在内表的索引上查找
+                auto inner = std::dynamic_pointer_cast<ScanPlan>(x->right_);
+                Node &inner_node = add_node(inner.get(), depth + 1,
+                                            "Index Lookup on " + inner->tab_name_ + " (" + names_str(x->index_col_names_) + ")");
+                inner_node.has_executor = false;
+                if (!inner->conds_.empty()) {
+                    inner_node.details.push_back("Filter: " + conds_str(inner->conds_));
+                }
+            } else {
+                describe(x->right_, depth + 1);
+            }
+        } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+            Node &node = add_node(x.get(), depth, x->limit_ < 0 ? "Sort" : "Top-N Sort");
+            std::string keys;
+            for (size_t i = 0; i < x->sel_cols_.size(); i++) {
+                keys += (i == 0 ? "" : ", ") + col_str(x->sel_cols_[i]) + (x->is_desc_[i] ? " DESC" : "");
+            }
+            node.details.push_back("Sort Key: " + keys);
+            if (x->limit_ >= 0) {
+                node.details.push_back("Limit: " + std::to_string(x->limit_));
+            }
+            describe(x->subplan_, depth + 1);
+        } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+            describe_aggregate(x.get(), depth);
+        } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+            add_node(x.get(), depth, "Limit").details.push_back("Limit: " + std::to_string(x->limit_));
+            describe(x->subplan_, depth + 1);
+        }
+    }
+
+    void describe_scan(const ScanPlan *scan, int depth) {
+        std::string title;
+        if (scan->tag == T_SeqScan) {
+            title = "Seq Scan on " + scan->tab_name_;
+        } else {
+            title = std::string(scan->index_only_ ? "Index Only Scan" : "Index Scan") + (scan->is_desc_ ? " Backward" : "") +
+                    " using " + scan->tab_name_ + " (" + names_str(scan->index_col_names_) + ")";
+        }
+        Node &node = add_node(scan, depth, title);
+        if (scan->table_->tab->is_partitioned()) {
+            node.details.push_back("Partitions: " + std::to_string(scan->partitions_.size()) + " of " +
+                                   std::to_string(scan->table_->tab->partition.partitions.size()));
+        }
+        if (!scan->conds_.empty()) {
+            node.details.push_back("Filter: " + conds_str(scan->conds_));
+        }
+        if (!scan->proj_cols_.empty()) {
+            node.details.push_back("Output: " + names_str(scan->proj_cols_));
+        }
+    }
+
+    void describe_aggregate(const AggregatePlan *agg, int depth) {
+        std::string title = agg->tag == T_CountStar       ? "Count Star"
+                            : agg->tag == T_StreamAggregate ? "Stream Aggregate"
+                                                            : "Hash Aggregate";
+        Node &node = add_node(agg, depth, title);
+        if (!agg->group_cols_.empty()) {
+            node.details.push_back("Group Key: " + cols_str(agg->group_cols_));
+        }
+        std::string aggs;
+        for (size_t i = 0; i < agg->aggs_.size(); i++) {
+            aggs += (i == 0 ? "" : ", ") + agg->aggs_[i].output.col_name;
+        }
+        node.details.push_back("Aggregates: " + aggs);
+        if (agg->tag == T_CountStar) {
+            // 记录数直接从页面头中读取，扫描节点不生成算子
+            auto scan = std::dynamic_pointer_cast<ScanPlan>(agg->subplan_);
+            node.title += " on " + scan->tab_name_;
+            return;
+        }
+        describe(agg->subplan_, depth + 1);
+    }
+
+    Node &add_node(const Plan *plan, int depth, std::string title) {
+        nodes_.push_back(Node{.depth = depth, .plan = plan, .title = std::move(title)});
+        return nodes_.back();
+    }
+
+    std::string format_stats(const OperatorStats &stats, const Node &node) const {
+        std::string str = " (actual";
+        if (!node.is_dml) {
+            str += " rows=" + std::to_string(stats.rows) + " loops=" + std::to_string(stats.loops);
+        }
+        str += " time=" + format_ms(stats.time_ns) + "ms pages=" + std::to_string(stats.fetches) +
+               " hits=" + std::to_string(stats.hits) + ")";
+        std::string expected = expected_executor(node.plan);
+        if (!expected.empty() && stats.executor != expected) {
+            str += " [executed as " + stats.executor + "]";
+        }
+        return str;
+    }
+
+    // 按计划生成的算子，读取快照时索引扫描等会被替换为其他算子
+    static std::string expected_executor(const Plan *plan) {
+        switch (plan->tag) {
+            case T_SeqScan: return "SeqScanExecutor";
+            case T_IndexScan: return "IndexScanExecutor";
+            case T_IndexNestLoop: return "IndexNestedLoopJoinExecutor";
+            case T_CountStar: return "CountStarExecutor";
+            default: return "";
+        }
+    }
+
+    static std::string format_ms(uint64_t ns) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.3f", ns / 1e6);
+        return buf;
+    }
+
+    static std::string dml_name(PlanTag tag) {
+        switch (tag) {
+            case T_Insert: return "Insert";
+            case T_Update: return "Update";
+            case T_Delete: return "Delete";
+            default: return "DML";
+        }
+    }
+
+    static std::string join_name(PlanTag tag) {
+        switch (tag) {
+            case T_HashJoin: return "Hash Join";
+            case T_MergeJoin: return "Merge Join";
+            case T_IndexNestLoop: return "Index Nested Loop Join";
+            default: return "Nested Loop Join";
+        }
+    }
+
+    static std::string col_str(const TabCol &col) {
+        return col.tab_name.empty() ? col.col_name : col.tab_name + "." + col.col_name;
+    }
+
+    static std::string cols_str(const std::vector<TabCol> &cols) {
+        std::string str;
+        for (size_t i = 0; i < cols.size(); i++) {
+            str += (i == 0 ? "" : ", ") + col_str(cols[i]);
+        }
+        return str;
+    }
+
+    static std::string names_str(const std::vector<std::string> &names) {
+        std::string str;
+        for (size_t i = 0; i < names.size(); i++) {
+            str += (i == 0 ? "" : ", ") + names[i];
+        }
+        return str;
+    }
+
+    static std::string value_str(const Value &val) {
+        if (val.param >= 0) {
+            return "$" + std::to_string(val.param + 1);
+        }
+        switch (val.type) {
+            case TYPE_INT: return std::to_string(val.int_val);
+            case TYPE_FLOAT: return std::to_string(val.float_val);
+            default: return "'" + val.str_val + "'";
+        }
+    }
+
+    static std::string conds_str(const std::vector<Condition> &conds) {
+        static const char *op_str[] = {"=", "<>", "<", ">", "<=", ">="};
+        std::string str;
+        for (size_t i = 0; i < conds.size(); i++) {
+            auto &cond = conds[i];
+            str += (i == 0 ? "" : " AND ") + col_str(cond.lhs_col) + " " + op_str[cond.op] + " " +
+                   (cond.is_rhs_val ? value_str(cond.rhs_val) : col_str(cond.rhs_col));
+        }
+        return str;
+    }
+
+    bool analyze_;
+    std::vector<Node> nodes_;                                   // 按先序遍历的计划节点
+    std::unordered_map<const Plan *, OperatorStats> stats_;     // 元素的地址在插入后不变，包装的算子直接引用
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "common/config.h"
+#include "defs.h"
+
+/*
+RowBatch是算子之间批量传递的一组定长记录，由AbstractExecutor::NextBatch()填充
+记录按行连续存放在rows_中，每行tuple_len_字节；sel_为选择向量，保存仍然有效的行号，
+过滤只需要缩小选择向量，不需要移动记录。size()/row(i)/rid(i)都是相对选择向量而言的
+*/
+class RowBatch {
+   public:
+    explicit RowBatch(size_t capacity = ROW_BATCH_SIZE) : capacity_(capacity) {}
+
+    /**
+     * @description: 清空批次，之后每行的长度为tuple_len
+     */
+    void reset(size_t tuple_len) {
+        tuple_len_ = tuple_len;
+        num_rows_ = 0;
+        rows_.resize(capacity_ * tuple_len_);
+        rids_.resize(capacity_);
+        sel_.clear();
+    }
+
+    bool full() const { return num_rows_ == capacity_; }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t tuple_len() const { return tuple_len_; }
+
+    /**
+     * @description: 在批次末尾追加一行，返回该行的存储位置，由调用者填充记录
+     * @param {Rid&} rid 记录的位置，不是来自表的记录可以不填
+     */
+    char *append(const Rid &rid = Rid{-1, -1}) {
+        rids_[num_rows_] = rid;
+        sel_.push_back(static_cast<uint32_t>(num_rows_));
+        return rows_.data() + (num_rows_++) * tuple_len_;
+    }
+
+    void append(const char *data, const Rid &rid = Rid{-1, -1}) { memcpy(append(rid), data, tuple_len_); }
+
+    // 撤销最后一次append()，用于先写入记录再判断条件的情况
+    void pop_back() {
+        sel_.pop_back();
+        num_rows_--;
+    }
+
+    // 选择向量中的行数
+    size_t size() const { return sel_.size(); }
+
+    bool empty() const { return sel_.empty(); }
+
+    char *row(size_t i) { return rows_.data() + sel_[i] * tuple_len_; }
+
+    const char *row(size_t i) const { return rows_.data() + sel_[i] * tuple_len_; }
+
+    const Rid &rid(size_t i) const { return rids_[sel_[i]]; }
+
+    // 选择向量，过滤算子可以直接修改它
+    std::vector<uint32_t> &selection() { return sel_; }
+
+    // 已经写入的行数，包括被选择向量过滤掉的行
+    size_t num_rows() const { return num_rows_; }
+
+    // 第0行的存储位置，第j行位于data() + j * tuple_len()，j不经过选择向量
+    const char *data() const { return rows_.data(); }
+
+   private:
+    size_t capacity_;
+    size_t tuple_len_ = 0;
+    size_t num_rows_ = 0;           // rows_中已经写入的行数，包括被选择向量过滤掉的行
+    std::vector<char> rows_;
+    std::vector<Rid> rids_;
+    std::vector<uint32_t> sel_;
+};
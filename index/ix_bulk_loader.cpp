@@ -0,0 +1,285 @@
+#include "ix_bulk_loader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+/**
+ * @param ih 要构建的空索引
+ * @param fill_factor 结点填充率，取值(0, 1]，实际填充数不少于结点的最小键值对数量
+ * @param sort_buffer_size 内存排序缓冲区的字节数
+ */
+IxBulkLoader::IxBulkLoader(IxIndexHandle *ih, double fill_factor, size_t sort_buffer_size)
+    : ih_(ih), file_hdr_(ih->file_hdr_), fill_factor_(fill_factor), sort_buffer_size_(sort_buffer_size) {
+    key_len_ = file_hdr_->col_tot_len_;
+    entry_len_ = key_len_ + sizeof(Rid);
+    int order = file_hdr_->btree_order_;
+    int min_size = (order + 1) / 2;
+    node_fill_ = std::clamp(static_cast<int>(std::lround(order * fill_factor)), min_size, order);
+}
+
+IxBulkLoader::~IxBulkLoader() {
+    for (auto run : runs_) {
+        std::fclose(run);
+    }
+}
+
+/**
+ * @brief 添加一个键值对，key的顺序任意
+ */
+void IxBulkLoader::add(const char *key, const Rid &rid) {
+    size_t offset = buffer_.size();
+    buffer_.resize(offset + entry_len_);
+    memcpy(buffer_.data() + offset, key, key_len_);
+    memcpy(buffer_.data() + offset + key_len_, &rid, sizeof(Rid));
+    num_entries_++;
+    if (buffer_.size() >= sort_buffer_size_) {
+        spill_run();
+    }
+}
+
+/**
+ * @brief 按key比较两个(key, rid)，key相同时按rid比较，使结果与输入顺序无关
+ */
+int IxBulkLoader::compare_entry(const char *a, const char *b) const {
+    int res = file_hdr_->key_cmp_(a, b);
+    if (res != 0) {
+        return res;
+    }
+    const Rid *ra = reinterpret_cast<const Rid *>(a + key_len_);
+    const Rid *rb = reinterpret_cast<const Rid *>(b + key_len_);
+    if (ra->page_no != rb->page_no) {
+        return ra->page_no < rb->page_no ? -1 : 1;
+    }
+    return (ra->slot_no > rb->slot_no) - (ra->slot_no < rb->slot_no);
+}
+
+/**
+ * @brief 对buffer_中的键值对排序，只排序偏移量，不移动较长的key
+ * @param[out] order 排序后各键值对在buffer_中的偏移
+ */
+void IxBulkLoader::sort_buffer(std::vector<size_t> *order) const {
+    size_t n = buffer_.size() / entry_len_;
+    order->resize(n);
+    for (size_t i = 0; i < n; i++) {
+        (*order)[i] = i * entry_len_;
+    }
+    const char *base = buffer_.data();
+    std::sort(order->begin(), order->end(),
+              [&](size_t a, size_t b) { return compare_entry(base + a, base + b) < 0; });
+}
+
+/**
+ * @brief 把buffer_排序后写入临时文件，形成一个有序段
+ */
+void IxBulkLoader::spill_run() {
+    std::vector<size_t> order;
+    sort_buffer(&order);
+    std::FILE *run = std::tmpfile();
+    if (run == nullptr) {
+        throw UnixError();
+    }
+    runs_.push_back(run);
+    for (size_t offset : order) {
+        if (std::fwrite(buffer_.data() + offset, entry_len_, 1, run) != 1) {
+            throw UnixError();
+        }
+    }
+    std::rewind(run);
+    buffer_.clear();
+}
+
+/**
+ * @brief 把num_entries个键值对尽量均匀地分到若干结点中，每个结点不超过node_fill_个，
+ *        有多个结点时每个结点不少于最小键值对数量
+ * @return 每个结点的键值对数量
+ */
+std::vector<int> IxBulkLoader::plan_nodes(size_t num_entries) const {
+    size_t min_size = (file_hdr_->btree_order_ + 1) / 2;
+    size_t num_nodes = std::max<size_t>(1, (num_entries + node_fill_ - 1) / node_fill_);
+    // 填充率较低时，均分后的结点可能少于最小键值对数量，减少结点个数
+    while (num_nodes > 1 && num_entries / num_nodes < min_size) {
+        num_nodes--;
+    }
+    std::vector<int> sizes(num_nodes, num_entries / num_nodes);
+    for (size_t i = 0; i < num_entries % num_nodes; i++) {
+        sizes[i]++;
+    }
+    assert(sizes[0] <= file_hdr_->btree_order_ || num_nodes == 1);
+    return sizes;
+}
+
+/**
+ * @brief 把一层的孩子按顺序分到若干内部结点中，每个结点至少两个孩子，占用的字节数不超过fill_factor倍的可用字节数；
+ *        最后一个结点不足半满时与前一个结点重新划分
+ * @return 各结点在level中的起始下标，最后一个元素为level.size()
+ */
+std::vector<size_t> IxBulkLoader::plan_internal_nodes(const IxSeparators &level) const {
+    int capacity = IxNodeHandle::internal_capacity(file_hdr_);
+    int target = static_cast<int>(capacity * fill_factor_);
+    std::vector<size_t> bounds = {0};
+    size_t begin = 0;
+    while (begin < level.size()) {
+        size_t end = begin + 1;
+        while (end < level.size() &&
+               IxNodeHandle::separators_size(file_hdr_, level, begin, end + 1) <= (end - begin < 2 ? capacity : target)) {
+            end++;
+        }
+        bounds.push_back(end);
+        begin = end;
+    }
+    size_t num_nodes = bounds.size() - 1;
+    if (num_nodes > 1 &&
+        IxNodeHandle::separators_size(file_hdr_, level, bounds[num_nodes - 1], level.size()) < capacity / 2) {
+        int mid = IxNodeHandle::choose_split(file_hdr_, level, bounds[num_nodes - 2], level.size());
+        if (mid > 0) {
+            bounds[num_nodes - 1] = mid;
+        }
+    }
+    return bounds;
+}
+
+/**
+ * @brief 创建一个空结点，叶子按顺序链接在前一个叶子之后
+ */
+IxNodeHandle *IxBulkLoader::new_node(bool is_leaf) {
+    IxNodeHandle *node = ih_->create_node();
+    node->page_hdr->next_free_page_no = IX_NO_PAGE;
+    node->page_hdr->parent = IX_NO_PAGE;
+    node->page_hdr->num_key = 0;
+    node->page_hdr->is_leaf = is_leaf;
+    node->page_hdr->prev_leaf = IX_NO_PAGE;
+    node->page_hdr->next_leaf = IX_NO_PAGE;
+    return node;
+}
+
+void IxBulkLoader::begin_leaves(size_t num_entries) {
+    leaf_sizes_ = plan_nodes(num_entries);
+    leaf_idx_ = 0;
+    // 第一个叶子复用空索引的根结点
+    leaf_ = ih_->fetch_node(file_hdr_->root_page_);
+    if (!leaf_->is_leaf_page() || leaf_->get_size() != 0) {
+        ih_->buffer_pool_manager_->unpin_page(leaf_->get_page_id(), false);
+        delete leaf_;
+        leaf_ = nullptr;
+        throw InternalError("IxBulkLoader: index is not empty");
+    }
+    leaf_->set_prev_leaf(IX_LEAF_HEADER_PAGE);
+    leaf_->set_next_leaf(IX_LEAF_HEADER_PAGE);
+    first_leaf_ = leaf_->get_page_no();
+    parent_seps_.clear();
+}
+
+/**
+ * @brief 按顺序追加一个键值对到当前叶子，当前叶子填满后链接并切换到下一个叶子
+ */
+void IxBulkLoader::append_leaf(const char *entry) {
+    int pos = leaf_->get_size();
+    if (pos == 0) {
+        // 分隔key介于上一个叶子的最后一个key和当前叶子的第一个key之间，第一个叶子的分隔key为空
+        std::string separator =
+            parent_seps_.empty() ? std::string() : IxNodeHandle::make_separator(file_hdr_, last_key_.data(), entry);
+        parent_seps_.push_back(IxSeparator{leaf_->get_page_no(), std::move(separator)});
+    }
+    leaf_->set_key(pos, entry);
+    leaf_->set_rid(pos, *reinterpret_cast<const Rid *>(entry + key_len_));
+    leaf_->set_size(pos + 1);
+    if (pos + 1 < leaf_sizes_[leaf_idx_] || leaf_idx_ + 1 == leaf_sizes_.size()) {
+        return;
+    }
+    last_key_.assign(entry, entry + key_len_);
+    IxNodeHandle *next = new_node(true);
+    next->set_prev_leaf(leaf_->get_page_no());
+    next->set_next_leaf(IX_LEAF_HEADER_PAGE);
+    leaf_->set_next_leaf(next->get_page_no());
+    ih_->buffer_pool_manager_->unpin_page(leaf_->get_page_id(), true);
+    delete leaf_;
+    leaf_ = next;
+    leaf_idx_++;
+}
+
+/**
+ * @brief 最后一个叶子填满后，更新叶子链表的头结点和文件头
+ */
+void IxBulkLoader::finish_leaves() {
+    page_id_t last_leaf = leaf_->get_page_no();
+    ih_->buffer_pool_manager_->unpin_page(leaf_->get_page_id(), true);
+    delete leaf_;
+    leaf_ = nullptr;
+
+    IxNodeHandle *header = ih_->fetch_node(IX_LEAF_HEADER_PAGE);
+    header->set_next_leaf(first_leaf_);
+    header->set_prev_leaf(last_leaf);
+    ih_->buffer_pool_manager_->unpin_page(header->get_page_id(), true);
+    delete header;
+    file_hdr_->first_leaf_ = first_leaf_;
+    file_hdr_->last_leaf_ = last_leaf;
+}
+
+/**
+ * @brief 由下一层各结点的(分隔key, 页号)逐层构建内部结点，直到只剩一个结点作为根。
+ *        每个内部结点第一个孩子的分隔key上移到再上一层
+ */
+void IxBulkLoader::build_internal_levels() {
+    IxSeparators level;
+    page_id_t root = first_leaf_;
+    while (parent_seps_.size() > 1) {
+        level.swap(parent_seps_);
+        parent_seps_.clear();
+        std::vector<size_t> bounds = plan_internal_nodes(level);
+        for (size_t i = 0; i + 1 < bounds.size(); i++) {
+            IxNodeHandle *node = new_node(false);
+            [[maybe_unused]] bool fits = node->set_separators(level, bounds[i], bounds[i + 1]);
+            assert(fits);
+            for (int j = 0; j < node->get_size(); j++) {
+                ih_->maintain_child(node, j);
+            }
+            parent_seps_.push_back(IxSeparator{node->get_page_no(), std::move(level[bounds[i]].key)});
+            root = node->get_page_no();
+            ih_->buffer_pool_manager_->unpin_page(node->get_page_id(), true);
+            delete node;
+        }
+    }
+    file_hdr_->root_page_ = root;
+}
+
+/**
+ * @brief 排序所有键值对并构建B+树，结束后文件头中的根结点和首尾叶子已经更新
+ */
+void IxBulkLoader::finish() {
+    if (num_entries_ == 0) {
+        return;
+    }
+    begin_leaves(num_entries_);
+    if (runs_.empty()) {
+        std::vector<size_t> order;
+        sort_buffer(&order);
+        for (size_t offset : order) {
+            append_leaf(buffer_.data() + offset);
+        }
+    } else {
+        if (!buffer_.empty()) {
+            spill_run();
+        }
+        // 多路归并：堆中存放各有序段的下标，按各段当前的键值对排序
+        std::vector<std::vector<char>> heads(runs_.size(), std::vector<char>(entry_len_));
+        auto greater = [&](size_t a, size_t b) { return compare_entry(heads[a].data(), heads[b].data()) > 0; };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+        for (size_t i = 0; i < runs_.size(); i++) {
+            if (std::fread(heads[i].data(), entry_len_, 1, runs_[i]) == 1) {
+                heap.push(i);
+            }
+        }
+        while (!heap.empty()) {
+            size_t i = heap.top();
+            heap.pop();
+            append_leaf(heads[i].data());
+            if (std::fread(heads[i].data(), entry_len_, 1, runs_[i]) == 1) {
+                heap.push(i);
+            }
+        }
+    }
+    buffer_.clear();
+    finish_leaves();
+    build_internal_levels();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "ix_defs.h"
+#include "ix_index_handle.h"
+
+/*
+IxBulkLoader用于为已有数据的表自底向上地批量构建B+树
+1. add()收集(key, rid)，内存缓冲区超过sort_buffer_size后排序并写出为一个有序段(run)，即外部排序
+2. finish()归并所有有序段，按顺序把key填满叶子结点，再逐层为上一层构建内部结点，直到只剩根结点
+叶子按键值对数量、内部结点按分隔key占用的字节数以fill_factor填充，结点按页号顺序分配和写入，避免逐条insert_entry时自顶向下的查找和反复分裂
+只能用于空索引，且构建期间索引不能被其他线程访问，因此不对结点加锁
+*/
+class IxBulkLoader {
+   public:
+    IxBulkLoader(IxIndexHandle *ih, double fill_factor = IX_BULK_LOAD_FILL_FACTOR,
+                 size_t sort_buffer_size = IX_BULK_LOAD_SORT_BUFFER);
+
+    ~IxBulkLoader();
+
+    void add(const char *key, const Rid &rid);
+
+    void finish();
+
+    size_t num_runs() const { return runs_.size(); }
+
+   private:
+    int compare_entry(const char *a, const char *b) const;
+
+    void sort_buffer(std::vector<size_t> *order) const;
+
+    void spill_run();
+
+    std::vector<int> plan_nodes(size_t num_entries) const;
+
+    std::vector<size_t> plan_internal_nodes(const IxSeparators &level) const;
+
+    void begin_leaves(size_t num_entries);
+
+    void append_leaf(const char *entry);
+
+    void finish_leaves();
+
+    IxNodeHandle *new_node(bool is_leaf);
+
+    void build_internal_levels();
+
+    IxIndexHandle *ih_;
+    IxFileHdr *file_hdr_;
+    int key_len_;
+    int entry_len_;                     // key + Rid
+    int node_fill_;                     // 每个叶子的目标键值对数量
+    double fill_factor_;
+    size_t sort_buffer_size_;
+    std::vector<char> buffer_;          // 内存中尚未排序的(key, rid)
+    std::vector<std::FILE *> runs_;     // 已经写出的有序段
+    size_t num_entries_ = 0;
+
+    std::vector<int> leaf_sizes_;       // 每个叶子的键值对数量
+    size_t leaf_idx_ = 0;               // 当前叶子在leaf_sizes_中的下标
+    IxNodeHandle *leaf_ = nullptr;      // 正在填充的叶子
+    page_id_t first_leaf_ = IX_NO_PAGE;
+    std::vector<char> last_key_;        // 上一个叶子的最后一个key
+    IxSeparators parent_seps_;          // 已完成的结点的(分隔key, 页号)，用于构建上一层
+};
@@ -0,0 +1,58 @@
+#include "ix_change_buffer.h"
+
+/**
+ * @description: 缓存插入(key, rid)，与key上已经缓存的修改合并
+ * @param {char*} key 插入的key
+ * @param {int} key_len key的长度
+ * @param {Rid&} rid 插入的rid
+ */
+void IxChangeBuffer::insert(const char *key, int key_len, const Rid &rid) {
+    auto [it, inserted] = entries_.try_emplace(std::string(key, key_len), Change{ChangeType::INSERT, rid});
+    if (!inserted && it->second.type == ChangeType::DELETE) {
+        it->second = Change{ChangeType::REPLACE, rid};
+    }
+}
+
+/**
+ * @description: 缓存删除key，覆盖key上已经缓存的修改
+ * @param {char*} key 删除的key
+ * @param {int} key_len key的长度
+ */
+void IxChangeBuffer::remove(const char *key, int key_len) {
+    entries_.insert_or_assign(std::string(key, key_len), Change{ChangeType::DELETE, Rid{-1, -1}});
+}
+
+/**
+ * @description: 取出key上缓存的修改，用于查找key之前写入索引
+ * @param {char*} key 查找的key
+ * @param {int} key_len key的长度
+ * @param {Batch*} batch 取出的修改追加到这里
+ */
+void IxChangeBuffer::take(const char *key, int key_len, Batch *batch) {
+    auto it = entries_.find(std::string(key, key_len));
+    if (it != entries_.end()) {
+        add_to_batch(it->first, it->second, batch);
+        entries_.erase(it);
+    }
+}
+
+/**
+ * @description: 取出全部缓存的修改，按key的顺序
+ * @param {Batch*} batch 取出的修改追加到这里
+ */
+void IxChangeBuffer::take_all(Batch *batch) {
+    for (auto &[key, change] : entries_) {
+        add_to_batch(key, change, batch);
+    }
+    entries_.clear();
+}
+
+void IxChangeBuffer::add_to_batch(const std::string &key, const Change &change, Batch *batch) {
+    if (change.type != ChangeType::INSERT) {
+        batch->delete_keys.push_back(key);
+    }
+    if (change.type != ChangeType::DELETE) {
+        batch->insert_keys.push_back(key);
+        batch->insert_rids.push_back(change.rid);
+    }
+}
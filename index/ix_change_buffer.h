@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "defs.h"
+#include "ix_compare.h"
+
+/*
+IxChangeBuffer缓存B+树索引上还没有写入叶子的插入和删除，按key排序，每个key只保留合并后的一个修改：
+1. INSERT：插入(key, rid)，与直接插入一样，key已经存在时不做修改
+2. DELETE：删除key
+3. REPLACE：先删除key，再插入(key, rid)
+同一个key上的修改按发生的顺序合并：DELETE之后INSERT得到REPLACE，INSERT/REPLACE之后的INSERT不起作用，
+任何修改之后DELETE得到DELETE。写入索引时先执行全部删除再执行全部插入，结果与逐条执行原来的修改相同
+本身不加锁，由IxIndexHandle的change_latch_保护
+*/
+class IxChangeBuffer {
+   public:
+    // 从缓冲中取出、等待写入索引的修改，REPLACE同时出现在删除和插入中
+    struct Batch {
+        std::vector<std::string> delete_keys;
+        std::vector<std::string> insert_keys;
+        std::vector<Rid> insert_rids;
+
+        bool empty() const { return delete_keys.empty() && insert_keys.empty(); }
+    };
+
+    explicit IxChangeBuffer(const IxKeyComparator *key_cmp) : entries_(KeyLess{key_cmp}) {}
+
+    void insert(const char *key, int key_len, const Rid &rid);
+
+    void remove(const char *key, int key_len);
+
+    bool contains(const char *key, int key_len) const { return entries_.count(std::string(key, key_len)) > 0; }
+
+    size_t size() const { return entries_.size(); }
+
+    bool empty() const { return entries_.empty(); }
+
+    void take(const char *key, int key_len, Batch *batch);
+
+    void take_all(Batch *batch);
+
+   private:
+    enum class ChangeType { INSERT, DELETE, REPLACE };
+
+    struct Change {
+        ChangeType type;
+        Rid rid;
+    };
+
+    struct KeyLess {
+        const IxKeyComparator *key_cmp;
+
+        bool operator()(const std::string &a, const std::string &b) const { return (*key_cmp)(a.data(), b.data()) < 0; }
+    };
+
+    static void add_to_batch(const std::string &key, const Change &change, Batch *batch);
+
+    std::map<std::string, Change, KeyLess> entries_;
+};
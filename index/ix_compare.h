@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "defs.h"
+#include "errors.h"
+
+inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
+    switch (type) {
+        case TYPE_INT: {
+            int ia = *(int *)a;
+            int ib = *(int *)b;
+            return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
+        }
+        case TYPE_FLOAT: {
+            float fa = *(float *)a;
+            float fb = *(float *)b;
+            return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+        }
+        case TYPE_STRING:
+            return memcmp(a, b, col_len);
+        default:
+            throw InternalError("Unexpected data type");
+    }
+}
+
+inline int ix_compare(const char* a, const char* b, const std::vector<ColType>& col_types, const std::vector<int>& col_lens) {
+    int offset = 0;
+    for(size_t i = 0; i < col_types.size(); ++i) {
+        int res = ix_compare(a + offset, b + offset, col_types[i], col_lens[i]);
+        if(res != 0) return res;
+        offset += col_lens[i];
+    }
+    return 0;
+}
+
+/*
+B+树内部结点存放截断后的分隔key：分隔key是某个完整key的前缀，只在字段边界或TYPE_STRING字段内部截断，
+缺少的部分视为小于任何取值，因此以完整key为前缀的分隔key不大于该完整key。
+字段的比较单位为整个TYPE_INT/TYPE_FLOAT字段或TYPE_STRING字段中的一个字节，公共前缀和分隔key的长度都落在比较单位的边界上
+*/
+
+/**
+ * @description: 按字段类型比较a和b在[from, to)字节范围内的部分，from和to落在比较单位的边界上
+ * @return {int} a < b返回负数，相等返回0，a > b返回正数
+ * @param {char*} a 完整的key
+ * @param {char*} b 另一个key的第from字节
+ */
+inline int ix_compare_range(const char *a, const char *b, int from, int to, const std::vector<ColType> &col_types,
+                            const std::vector<int> &col_lens) {
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size() && offset < to; ++i) {
+        int end = offset + col_lens[i];
+        if (end > from) {
+            int res;
+            if (col_types[i] == TYPE_STRING) {
+                int begin = std::max(offset, from);
+                res = memcmp(a + begin, b + (begin - from), std::min(end, to) - begin);
+            } else {
+                res = ix_compare(a + offset, b + (offset - from), col_types[i], col_lens[i]);
+            }
+            if (res != 0) return res;
+        }
+        offset = end;
+    }
+    return 0;
+}
+
+/**
+ * @description: 比较完整的key与长度为sep_len的分隔key
+ * @return {int} key < sep返回负数，相等返回0，key > sep返回正数
+ */
+inline int ix_compare_separator(const char *key, const char *sep, int sep_len, const std::vector<ColType> &col_types,
+                                const std::vector<int> &col_lens) {
+    int res = ix_compare_range(key, sep, 0, sep_len, col_types, col_lens);
+    if (res != 0) return res;
+    int tot_len = 0;
+    for (int len : col_lens) {
+        tot_len += len;
+    }
+    return sep_len < tot_len;
+}
+
+/**
+ * @description: 两个key(完整key或分隔key)公共前缀的字节数，包括相等的完整字段和第一个不相等的TYPE_STRING字段中相等的字节
+ * @param {int} a_len a的长度
+ * @param {int} b_len b的长度
+ */
+inline int ix_common_prefix(const char *a, int a_len, const char *b, int b_len, const std::vector<ColType> &col_types,
+                            const std::vector<int> &col_lens) {
+    int len = std::min(a_len, b_len);
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size(); ++i) {
+        int end = offset + col_lens[i];
+        if (col_types[i] == TYPE_STRING) {
+            int stop = std::min(end, len);
+            while (offset < stop && a[offset] == b[offset]) {
+                offset++;
+            }
+            if (offset < end) return offset;
+        } else if (end > len || memcmp(a + offset, b + offset, col_lens[i]) != 0) {
+            return offset;
+        }
+        offset = end;
+    }
+    return offset;
+}
+
+/**
+ * @description: 最短分隔key的长度：right的这个长度的前缀大于left且不大于right
+ * @param {char*} left 完整的key，小于right
+ * @param {char*} right 完整的key
+ */
+inline int ix_separator_len(const char *left, const char *right, const std::vector<ColType> &col_types,
+                            const std::vector<int> &col_lens) {
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size(); ++i) {
+        int end = offset + col_lens[i];
+        if (col_types[i] == TYPE_STRING) {
+            for (int j = offset; j < end; ++j) {
+                if (left[j] != right[j]) return j + 1;
+            }
+        } else if (ix_compare(left + offset, right + offset, col_types[i], col_lens[i]) != 0) {
+            return end;
+        }
+        offset = end;
+    }
+    return offset;
+}
+
+/*
+IxKeyComparator是针对某个索引的key比较器，打开索引时根据索引字段构造一次
+常见的key形状(int、int+int、定长字符串、int+字符串)使用模板特化的比较函数，字段类型和偏移在编译期确定，
+比较时只需一次间接调用，不再逐字段遍历col_types_/col_lens_；其余形状退回通用的ix_compare
+*/
+class IxKeyComparator {
+   public:
+    IxKeyComparator() = default;
+
+    IxKeyComparator(const std::vector<ColType> &col_types, const std::vector<int> &col_lens) { init(col_types, col_lens); }
+
+    /**
+     * @description: 根据索引字段选择比较函数
+     * @param {vector<ColType>&} col_types 字段类型
+     * @param {vector<int>&} col_lens 字段长度
+     */
+    void init(const std::vector<ColType> &col_types, const std::vector<int> &col_lens) {
+        col_types_ = col_types;
+        col_lens_ = col_lens;
+        bool int0 = col_types.size() >= 1 && col_types[0] == TYPE_INT && col_lens[0] == sizeof(int);
+        if (col_types.size() == 1 && int0) {
+            compare_ = &compare_shape<Shape::INT>;
+        } else if (col_types.size() == 2 && int0 && col_types[1] == TYPE_INT && col_lens[1] == sizeof(int)) {
+            compare_ = &compare_shape<Shape::INT_INT>;
+        } else if (col_types.size() == 1 && col_types[0] == TYPE_STRING) {
+            str_len_ = col_lens[0];
+            compare_ = &compare_shape<Shape::STRING>;
+        } else if (col_types.size() == 2 && int0 && col_types[1] == TYPE_STRING) {
+            str_len_ = col_lens[1];
+            compare_ = &compare_shape<Shape::INT_STRING>;
+        } else {
+            compare_ = &compare_shape<Shape::GENERIC>;
+        }
+    }
+
+    /**
+     * @description: 比较两个key
+     * @return {int} a < b返回负数，a == b返回0，a > b返回正数
+     */
+    int operator()(const char *a, const char *b) const { return compare_(this, a, b); }
+
+   private:
+    enum class Shape { INT, INT_INT, STRING, INT_STRING, GENERIC };
+
+    using CompareFn = int (*)(const IxKeyComparator *, const char *, const char *);
+
+    static int compare_int(const char *a, const char *b) {
+        int ia = *reinterpret_cast<const int *>(a);
+        int ib = *reinterpret_cast<const int *>(b);
+        return (ia > ib) - (ia < ib);
+    }
+
+    template <Shape shape>
+    static int compare_shape(const IxKeyComparator *self, const char *a, const char *b) {
+        if constexpr (shape == Shape::INT) {
+            return compare_int(a, b);
+        } else if constexpr (shape == Shape::INT_INT) {
+            int res = compare_int(a, b);
+            return res != 0 ? res : compare_int(a + sizeof(int), b + sizeof(int));
+        } else if constexpr (shape == Shape::STRING) {
+            return memcmp(a, b, self->str_len_);
+        } else if constexpr (shape == Shape::INT_STRING) {
+            int res = compare_int(a, b);
+            return res != 0 ? res : memcmp(a + sizeof(int), b + sizeof(int), self->str_len_);
+        } else {
+            return ix_compare(a, b, self->col_types_, self->col_lens_);
+        }
+    }
+
+    CompareFn compare_ = &compare_shape<Shape::GENERIC>;
+    int str_len_ = 0;                   // 字符串字段的长度，用于STRING和INT_STRING
+    std::vector<ColType> col_types_;    // 用于GENERIC
+    std::vector<int> col_lens_;
+};
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "defs.h"
+#include "ix_compare.h"
+#include "ix_search.h"
 #include "storage/buffer_pool_manager.h"
 
 constexpr int IX_NO_PAGE = -1;
@@ -11,22 +14,42 @@ constexpr int IX_LEAF_HEADER_PAGE = 1;
 constexpr int IX_INIT_ROOT_PAGE = 2;
 constexpr int IX_INIT_NUM_PAGES = 3;
 constexpr int IX_MAX_COL_LEN = 512;
+constexpr int IX_FILE_MAGIC = 0x58494255;   // 索引文件头的前4个字节，"UBIX"
+constexpr int IX_FILE_FORMAT_VERSION = 2;   // 结点格式变化时递增。2：内部结点保存前缀压缩的最短分隔key
+constexpr bool IX_OPTIMISTIC_READ = true;   // 索引查找默认使用版本校验的乐观读，不对结点加锁
+constexpr int IX_OPTIMISTIC_RETRIES = 8;    // 乐观读连续冲突的次数超过该值后退回加读锁的查找
+constexpr double IX_BULK_LOAD_FILL_FACTOR = 0.9;            // 批量建索引时每个结点的填充率
+constexpr size_t IX_BULK_LOAD_SORT_BUFFER = 64 << 20;     // 批量建索引时内存排序缓冲区的大小，超过后外部排序
+constexpr size_t IX_CHANGE_BUFFER_CAPACITY = 8192;          // 每个索引最多缓存的修改数量，达到后由写入者全部写入
+constexpr size_t IX_CHANGE_BUFFER_BG_MERGE = 1024;          // 后台刷脏时写入缓存的修改不少于该数量的索引
+
+// 结点内查找key的方式，打开索引时根据索引字段选定一次
+enum class IxKeySearch {
+    GENERIC = 0,    // key比较器key_cmp_ + 无分支二分查找，适用于多字段和TYPE_STRING
+    INT_SSE,        // 单字段TYPE_INT
+    INT_AVX2,
+    FLOAT_SSE,      // 单字段TYPE_FLOAT
+    FLOAT_AVX2
+};
 
 class IxFileHdr {
 public: 
-    page_id_t first_free_page_no_;      // 文件中第一个空闲的磁盘页面的页面号
-    int num_pages_;                     // 磁盘文件中页面的数量
+    int format_version_ = IX_FILE_FORMAT_VERSION;   // 索引文件的格式版本，打开时与IX_FILE_FORMAT_VERSION比较
+    page_id_t first_free_page_no_;      // 空闲页链表的表头：合并或删除后不再属于B+树的结点，通过页头的next_free_page_no链接
+    int num_pages_;                     // 磁盘文件中页面的数量，包括空闲页链表中的页面
     page_id_t root_page_;               // B+树根节点对应的页面号
     int col_num_;                       // 索引包含的字段数量
     std::vector<ColType> col_types_;    // 字段的类型
     std::vector<int> col_lens_;         // 字段的长度
     int col_tot_len_;                   // 索引包含的字段的总长度
-    int btree_order_;                   // # children per page 每个结点最多可插入的键值对数量
+    int btree_order_;                   // # children per page 叶子结点最多可插入的键值对数量，内部结点的可用字节数也由它确定
     int keys_size_;                     // keys_size = (btree_order + 1) * col_tot_len
     // first_leaf初始化之后没有进行修改，只不过是在测试文件中遍历叶子结点的时候用了
     page_id_t first_leaf_;              // 首叶节点对应的页号，在上层IxManager的open函数进行初始化，初始化为root page_no
     page_id_t last_leaf_;               // 尾叶节点对应的页号
     int tot_len_;                       // 记录结构体的整体长度
+    IxKeySearch key_search_ = IxKeySearch::GENERIC;  // 结点内查找key的方式，由init_key_search()选定，不写入磁盘
+    IxKeyComparator key_cmp_;           // key比较器，由init_key_search()构造，不写入磁盘
 
     IxFileHdr() {
         tot_len_ = col_num_ = 0;
@@ -39,14 +62,45 @@ public:
                     tot_len_ = 0;
                 } 
 
+    /**
+     * @description: 根据索引字段和CPU选择结点内查找key的方式和key比较器，单字段的int/float key使用SIMD查找
+     */
+    void init_key_search() {
+        key_cmp_.init(col_types_, col_lens_);
+        key_search_ = IxKeySearch::GENERIC;
+        if (col_num_ != 1) {
+            return;
+        }
+        bool avx2 = ix_cpu_has_avx2();
+        if (col_types_[0] == TYPE_INT && col_lens_[0] == sizeof(int32_t)) {
+            key_search_ = avx2 ? IxKeySearch::INT_AVX2 : IxKeySearch::INT_SSE;
+        } else if (col_types_[0] == TYPE_FLOAT && col_lens_[0] == sizeof(float)) {
+            key_search_ = avx2 ? IxKeySearch::FLOAT_AVX2 : IxKeySearch::FLOAT_SSE;
+        }
+    }
+
     void update_tot_len() {
         tot_len_ = 0;
-        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 6;
+        tot_len_ += sizeof(page_id_t) * 4 + sizeof(int) * 8;
         tot_len_ += sizeof(ColType) * col_num_ + sizeof(int) * col_num_;
     }
 
+    /**
+     * @brief 读取序列化的文件头中的格式版本，没有IX_FILE_MAGIC的文件由加入版本之前的代码创建，返回0
+     */
+    static int read_format_version(const char* src) {
+        int magic, version;
+        memcpy(&magic, src, sizeof(int));
+        memcpy(&version, src + sizeof(int), sizeof(int));
+        return magic == IX_FILE_MAGIC ? version : 0;
+    }
+
     void serialize(char* dest) {
         int offset = 0;
+        memcpy(dest + offset, &IX_FILE_MAGIC, sizeof(int));
+        offset += sizeof(int);
+        memcpy(dest + offset, &format_version_, sizeof(int));
+        offset += sizeof(int);
         memcpy(dest + offset, &tot_len_, sizeof(int));
         offset += sizeof(int);
         memcpy(dest + offset, &first_free_page_no_, sizeof(page_id_t));
@@ -79,7 +133,8 @@ public:
     }
 
     void deserialize(char* src) {
-        int offset = 0;
+        format_version_ = read_format_version(src);
+        int offset = sizeof(int) * 2;
         tot_len_ = *reinterpret_cast<const int*>(src + offset);
         offset += sizeof(int);
         first_free_page_no_ = *reinterpret_cast<const page_id_t*>(src + offset);
@@ -90,7 +145,6 @@ public:
         offset += sizeof(page_id_t);
         col_num_ = *reinterpret_cast<const int*>(src + offset);
         offset += sizeof(int);
-        std::cout << col_num_ << "\n";
         for(int i = 0; i < col_num_; ++i) {
             // col_types_[i] = *reinterpret_cast<const ColType*>(src + offset);
             ColType type = *reinterpret_cast<const ColType*>(src + offset);
@@ -114,12 +168,13 @@ public:
         last_leaf_ = *reinterpret_cast<const page_id_t*>(src + offset);
         offset += sizeof(page_id_t);
         assert(offset == tot_len_);
+        init_key_search();
     }
 };
 
 class IxPageHdr {
 public:
-    page_id_t next_free_page_no;    // unused
+    page_id_t next_free_page_no;    // 结点被释放后在空闲页链表中的下一个页面
     page_id_t parent;               // 父亲节点所在页面的叶号
     int num_key;                    // # current keys (always equals to #child - 1) 已插入的keys数量，key_idx∈[0,num_key)
     bool is_leaf;                   // 是否为叶节点
@@ -127,6 +182,33 @@ public:
     page_id_t next_leaf;            // next leaf node's page_no, effective only when is_leaf is true
 };
 
+/*
+内部结点的变长布局，紧跟在IxPageHdr之后：
+| IxInternalHdr | 公共前缀(补齐到4字节) | IxInternalSlot * num_key | 各分隔key去掉公共前缀后的后缀 |
+第i个孩子对应第i个分隔key，第0个分隔key为空，表示负无穷；第i个分隔key(i > 0)大于第i-1个孩子子树中的所有key，
+且不大于第i个孩子子树中的所有key，是区分两侧的最短前缀(见ix_separator_len)。公共前缀是第1个及之后的分隔key的公共前缀
+*/
+class IxInternalHdr {
+public:
+    uint16_t prefix_len;            // 公共前缀的长度
+    uint16_t used_len;              // 从IxInternalHdr开始到最后一个后缀结束的字节数
+};
+
+class IxInternalSlot {
+public:
+    page_id_t child;                // 孩子结点的页号
+    uint16_t key_off;               // 后缀在页面中的偏移
+    uint16_t key_len;               // 后缀的长度
+};
+
+// 内部结点的一个孩子及其分隔key(完整的分隔key，包括公共前缀)，修改内部结点时先取出全部分隔key，修改后整体写回
+struct IxSeparator {
+    page_id_t child;
+    std::string key;
+};
+
+using IxSeparators = std::vector<IxSeparator>;
+
 class Iid {
 public:
     int page_no;
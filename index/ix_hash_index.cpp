@@ -0,0 +1,389 @@
+#include "ix_hash_index.h"
+
+#include <algorithm>
+
+IxHashIndexHandle::IxHashIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
+    : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
+    std::vector<char> buf(PAGE_SIZE);
+    disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf.data(), PAGE_SIZE);
+    file_hdr_.deserialize(buf.data());
+
+    // 目录读入内存，之后只在关闭时写回
+    size_t dir_size = size_t{1} << file_hdr_.global_depth_;
+    std::vector<std::atomic<page_id_t>> dir(dir_size);
+    for (size_t i = 0; i < dir_size; i += IX_HASH_DIR_ENTRIES_PER_PAGE) {
+        disk_manager_->read_page(fd, file_hdr_.dir_pages_[i / IX_HASH_DIR_ENTRIES_PER_PAGE], buf.data(), PAGE_SIZE);
+        auto entries = reinterpret_cast<const page_id_t *>(buf.data());
+        for (size_t j = 0; j < IX_HASH_DIR_ENTRIES_PER_PAGE && i + j < dir_size; j++) {
+            dir[i + j].store(entries[j], std::memory_order_relaxed);
+        }
+    }
+    dir_ = std::move(dir);
+
+    // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages_开始分配page_no
+    disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages_);
+}
+
+uint64_t IxHashIndexHandle::hash(const char *key) const {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int offset = 0;
+    for (int i = 0; i < file_hdr_.col_num_; i++) {
+        const char *val = key + offset;
+        int len = file_hdr_.col_lens_[i];
+        float zero = 0;
+        if (file_hdr_.col_types_[i] == TYPE_FLOAT && *reinterpret_cast<const float *>(val) == 0) {
+            val = reinterpret_cast<const char *>(&zero);
+        }
+        for (int j = 0; j < len; j++) {
+            h = (h ^ static_cast<unsigned char>(val[j])) * 0x100000001b3ULL;
+        }
+        offset += len;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+/**
+ * @brief 对hash值为h的key所在的桶加锁。读取目录项之后、加锁之前桶可能已经分裂，
+ * 加锁后key不再属于该桶时重新读取目录项(分裂在释放桶的锁之前已经修改了目录项)
+ *
+ * @param h key的hash值
+ * @param exclusive 是否加写锁
+ * @return Page* pin住并加锁的桶页面
+ * @note 调用者需持有dir_latch_的读锁
+ */
+Page *IxHashIndexHandle::lock_bucket(uint64_t h, bool exclusive) {
+    while (true) {
+        page_id_t page_no = dir_[hash_prefix(h, file_hdr_.global_depth_)].load(std::memory_order_acquire);
+        Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+        assert(page != nullptr);
+        if (exclusive) {
+            page->wlatch();
+        } else {
+            page->rlatch();
+        }
+        auto hdr = reinterpret_cast<const IxHashBucketHdr *>(page->get_data());
+        if (hash_prefix(h, hdr->local_depth) == hdr->hash_bits) {
+            return page;
+        }
+        unlock_bucket(page, exclusive, false);
+    }
+}
+
+void IxHashIndexHandle::unlock_bucket(Page *page, bool exclusive, bool dirty) {
+    if (exclusive) {
+        page->wunlatch();
+    } else {
+        page->runlatch();
+    }
+    buffer_pool_manager_->unpin_page(page->get_page_id(), dirty);
+}
+
+/**
+ * @brief 依次访问桶页面及其溢出页，直到visit返回true。溢出页只在持有桶页面的锁时访问，由桶页面的锁保护
+ *
+ * @param head 已经加锁的桶页面
+ * @param modify visit返回true时是否修改了该页面，用于unpin溢出页
+ * @return bool visit是否返回过true
+ */
+template <typename Visit>
+bool IxHashIndexHandle::visit_chain(Page *head, bool modify, Visit visit) {
+    IxHashBucket bucket(&file_hdr_, head);
+    if (visit(bucket)) {
+        return true;
+    }
+    page_id_t next = bucket.hdr()->next_overflow;
+    while (next != IX_NO_PAGE) {
+        Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, next});
+        IxHashBucket overflow(&file_hdr_, page);
+        next = overflow.hdr()->next_overflow;
+        bool stop = visit(overflow);
+        buffer_pool_manager_->unpin_page(page->get_page_id(), stop && modify);
+        if (stop) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 查找key对应的rid
+ *
+ * @param key 查找的目标key值
+ * @param result 用于存放结果的容器
+ * @param transaction 事务指针
+ * @return bool 返回目标键值对是否存在
+ */
+bool IxHashIndexHandle::get_value(const char *key, std::vector<Rid> *result, Transaction *transaction) {
+    return lookup(key, hash(key), result);
+}
+
+bool IxHashIndexHandle::lookup(const char *key, uint64_t h, std::vector<Rid> *result) {
+    std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+    Page *page = lock_bucket(h, false);
+    bool found = visit_chain(page, false, [&](IxHashBucket &bucket) {
+        int pos = bucket.find(key);
+        if (pos >= 0) {
+            result->push_back(bucket.rid_at(pos));
+        }
+        return pos >= 0;
+    });
+    unlock_bucket(page, false, false);
+    return found;
+}
+
+/**
+ * @brief 批量查找多个key，按hash值的顺序查找，落在同一个桶中的key连续访问该桶
+ *
+ * @param keys 要查找的key，顺序任意，可以重复
+ * @param[out] results results[i]为keys[i]对应的所有rid，与get_value的结果相同
+ * @param transaction 事务指针
+ * @return int 找到的key的数量
+ */
+int IxHashIndexHandle::get_values_batch(const std::vector<const char *> &keys,
+                                        std::vector<std::vector<Rid>> *results, Transaction *transaction) {
+    results->assign(keys.size(), {});
+    std::vector<uint64_t> hashes;
+    int found = 0;
+    for (size_t i : hash_order(keys, &hashes)) {
+        found += lookup(keys[i], hashes[i], &(*results)[i]);
+    }
+    return found;
+}
+
+/**
+ * @brief 将指定键值对插入到哈希索引中，key已经存在时不做修改
+ * @param (key, value) 要插入的键值对
+ * @param transaction 事务指针
+ * @return page_id_t 插入到的桶页面或溢出页的page_no
+ */
+page_id_t IxHashIndexHandle::insert_entry(const char *key, const Rid &value, Transaction *transaction) {
+    return insert(key, hash(key), value);
+}
+
+page_id_t IxHashIndexHandle::insert(const char *key, uint64_t h, const Rid &value) {
+    while (true) {
+        std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+        Page *page = lock_bucket(h, true);
+        IxHashBucket bucket(&file_hdr_, page);
+        page_id_t page_no = page->get_page_id().page_no;
+        if (visit_chain(page, false, [&](IxHashBucket &b) { return b.find(key) >= 0; })) {
+            unlock_bucket(page, true, false);
+            return page_no;
+        }
+        if (!bucket.full()) {
+            bucket.append(key, value);
+            unlock_bucket(page, true, true);
+            return page_no;
+        }
+        int global_depth = file_hdr_.global_depth_;
+        if (bucket.hdr()->local_depth < global_depth) {
+            // 分裂后key所在的桶仍可能是满的(所有key的新增位都相同)，重新查找
+            split(bucket);
+            unlock_bucket(page, true, true);
+            continue;
+        }
+        if (global_depth < IX_HASH_MAX_DEPTH) {
+            unlock_bucket(page, true, false);
+            dir_lock.unlock();
+            grow_directory(global_depth);
+            continue;
+        }
+        page_no = append_overflow(bucket, key, value);
+        unlock_bucket(page, true, true);
+        return page_no;
+    }
+}
+
+/**
+ * @brief 批量插入键值对，已经存在的key不会重复插入。按hash值的顺序插入，落在同一个桶中的key连续访问该桶
+ * @param keys 要插入的key，顺序任意
+ * @param rids rids[i]为keys[i]对应的rid
+ */
+void IxHashIndexHandle::insert_entries(const std::vector<const char *> &keys, const std::vector<Rid> &rids,
+                                       Transaction *transaction) {
+    assert(keys.size() == rids.size());
+    std::vector<uint64_t> hashes;
+    for (size_t i : hash_order(keys, &hashes)) {
+        insert(keys[i], hashes[i], rids[i]);
+    }
+}
+
+/**
+ * @brief 删除key对应的键值对
+ * @param key 要删除的key值
+ * @param transaction 事务指针
+ * @return bool key是否存在
+ */
+bool IxHashIndexHandle::delete_entry(const char *key, Transaction *transaction) {
+    return remove(key, hash(key));
+}
+
+bool IxHashIndexHandle::remove(const char *key, uint64_t h) {
+    std::shared_lock<std::shared_mutex> dir_lock(dir_latch_);
+    Page *page = lock_bucket(h, true);
+    bool deleted = visit_chain(page, true, [&](IxHashBucket &bucket) {
+        int pos = bucket.find(key);
+        if (pos >= 0) {
+            bucket.erase(pos);
+        }
+        return pos >= 0;
+    });
+    unlock_bucket(page, true, deleted);
+    return deleted;
+}
+
+/**
+ * @brief 批量删除key
+ * @param keys 要删除的key，顺序任意
+ * @return int 成功删除的key的数量
+ */
+int IxHashIndexHandle::delete_entries(const std::vector<const char *> &keys, Transaction *transaction) {
+    std::vector<uint64_t> hashes;
+    int deleted = 0;
+    for (size_t i : hash_order(keys, &hashes)) {
+        deleted += remove(keys[i], hashes[i]);
+    }
+    return deleted;
+}
+
+// 计算每个key的hash值，返回按hash值排序的下标
+std::vector<size_t> IxHashIndexHandle::hash_order(const std::vector<const char *> &keys,
+                                                  std::vector<uint64_t> *hashes) const {
+    hashes->resize(keys.size());
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        (*hashes)[i] = hash(keys[i]);
+        order[i] = i;
+    }
+    // 目录按hash值的高位定位，排序后同一个桶中的key相邻
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return (*hashes)[a] < (*hashes)[b]; });
+    return order;
+}
+
+/**
+ * @brief 把已经加写锁的满桶分裂为两个：新桶接收hash值的第local_depth + 1个高位为1的键值对，
+ * 原来指向该桶的连续目录项中的后一半改为指向新桶。只修改属于该桶的目录项，持有dir_latch_的读锁即可
+ *
+ * @param bucket 要分裂的桶，local_depth小于global_depth
+ */
+void IxHashIndexHandle::split(IxHashBucket &bucket) {
+    IxHashBucketHdr *hdr = bucket.hdr();
+    int depth = hdr->local_depth;
+    assert(depth < file_hdr_.global_depth_);
+    PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+    Page *new_page = buffer_pool_manager_->new_page(&new_page_id);
+    new_page->wlatch();
+    IxHashBucket sibling(&file_hdr_, new_page);
+    *sibling.hdr() = {
+        .local_depth = depth + 1,
+        .hash_bits = (hdr->hash_bits << 1) | 1,
+        .num_entries = 0,
+        .next_overflow = IX_NO_PAGE,
+    };
+    hdr->local_depth = depth + 1;
+    hdr->hash_bits <<= 1;
+    for (int i = 0; i < bucket.size();) {
+        if (hash_prefix(hash(bucket.key_at(i)), depth + 1) & 1) {
+            sibling.append(bucket.key_at(i), bucket.rid_at(i));
+            bucket.erase(i);
+        } else {
+            i++;
+        }
+    }
+    // 在释放原桶的锁之前修改目录项，之后加锁的查找能发现key已经不属于原桶
+    int shift = file_hdr_.global_depth_ - (depth + 1);
+    size_t first = static_cast<size_t>(sibling.hdr()->hash_bits) << shift;
+    for (size_t i = first; i < first + (size_t{1} << shift); i++) {
+        dir_[i].store(new_page_id.page_no, std::memory_order_release);
+    }
+    new_page->wunlatch();
+    buffer_pool_manager_->unpin_page(new_page_id, true);
+}
+
+/**
+ * @brief 目录翻倍，新目录的第2i和2i + 1项都指向原来第i项指向的桶
+ *
+ * @param global_depth 调用者看到的global depth，其他线程已经翻倍时不再翻倍
+ */
+void IxHashIndexHandle::grow_directory(int global_depth) {
+    std::unique_lock<std::shared_mutex> dir_lock(dir_latch_);
+    if (file_hdr_.global_depth_ != global_depth) {
+        return;
+    }
+    size_t size = dir_.size();
+    std::vector<std::atomic<page_id_t>> dir(size * 2);
+    for (size_t i = 0; i < size * 2; i++) {
+        dir[i].store(dir_[i >> 1].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    dir_ = std::move(dir);
+    file_hdr_.global_depth_++;
+}
+
+/**
+ * @brief 不能再分裂的满桶中插入键值对：放入第一个有空位的溢出页，都满时在最后追加一个溢出页
+ * @return page_id_t 插入到的溢出页的page_no
+ */
+page_id_t IxHashIndexHandle::append_overflow(IxHashBucket &bucket, const char *key, const Rid &value) {
+    Page *tail = bucket.page();
+    bool pinned = false;    // tail是否是这里pin住的溢出页
+    while (true) {
+        IxHashBucket curr(&file_hdr_, tail);
+        if (!curr.full()) {
+            curr.append(key, value);
+            page_id_t page_no = tail->get_page_id().page_no;
+            if (pinned) {
+                buffer_pool_manager_->unpin_page(tail->get_page_id(), true);
+            }
+            return page_no;
+        }
+        page_id_t next = curr.hdr()->next_overflow;
+        Page *page;
+        if (next == IX_NO_PAGE) {
+            PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
+            page = buffer_pool_manager_->new_page(&new_page_id);
+            *reinterpret_cast<IxHashBucketHdr *>(page->get_data()) = {
+                .local_depth = curr.hdr()->local_depth,
+                .hash_bits = curr.hdr()->hash_bits,
+                .num_entries = 0,
+                .next_overflow = IX_NO_PAGE,
+            };
+            curr.hdr()->next_overflow = new_page_id.page_no;
+        } else {
+            page = buffer_pool_manager_->fetch_page(PageId{fd_, next});
+        }
+        if (pinned) {
+            buffer_pool_manager_->unpin_page(tail->get_page_id(), next == IX_NO_PAGE);
+        }
+        tail = page;
+        pinned = true;
+    }
+}
+
+/**
+ * @brief 把目录写入目录页(目录变大时追加目录页)，再写回文件头
+ */
+void IxHashIndexHandle::flush() {
+    std::unique_lock<std::shared_mutex> dir_lock(dir_latch_);
+    size_t num_dir_pages = (dir_.size() + IX_HASH_DIR_ENTRIES_PER_PAGE - 1) / IX_HASH_DIR_ENTRIES_PER_PAGE;
+    while (file_hdr_.dir_pages_.size() < num_dir_pages) {
+        file_hdr_.dir_pages_.push_back(disk_manager_->allocate_page(fd_));
+    }
+    std::vector<char> buf(PAGE_SIZE);
+    for (size_t p = 0; p < num_dir_pages; p++) {
+        std::fill(buf.begin(), buf.end(), 0);
+        auto entries = reinterpret_cast<page_id_t *>(buf.data());
+        for (size_t j = 0; j < IX_HASH_DIR_ENTRIES_PER_PAGE && p * IX_HASH_DIR_ENTRIES_PER_PAGE + j < dir_.size(); j++) {
+            entries[j] = dir_[p * IX_HASH_DIR_ENTRIES_PER_PAGE + j].load(std::memory_order_relaxed);
+        }
+        disk_manager_->write_page(fd_, file_hdr_.dir_pages_[p], buf.data(), PAGE_SIZE);
+    }
+    file_hdr_.num_pages_ = disk_manager_->get_fd2pageno(fd_);
+    assert(file_hdr_.tot_len() <= PAGE_SIZE);
+    std::fill(buf.begin(), buf.end(), 0);
+    file_hdr_.serialize(buf.data());
+    disk_manager_->write_page(fd_, IX_FILE_HDR_PAGE, buf.data(), PAGE_SIZE);
+}
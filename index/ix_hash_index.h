@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <shared_mutex>
+#include <vector>
+
+#include "ix_defs.h"
+#include "transaction/transaction.h"
+
+constexpr int IX_HASH_BUCKET_PAGE = 1;          // 新建的哈希索引唯一的桶
+constexpr int IX_HASH_INIT_DIR_PAGE = 2;        // 新建的哈希索引的目录页
+constexpr int IX_HASH_INIT_NUM_PAGES = 3;
+constexpr int IX_HASH_MAX_DEPTH = 19;           // global depth的上限，达到后桶满时改为追加溢出页
+constexpr int IX_HASH_DIR_ENTRIES_PER_PAGE = PAGE_SIZE / sizeof(page_id_t);
+
+/* 哈希索引桶页面的页面头，溢出页使用相同的格式 */
+struct IxHashBucketHdr {
+    int local_depth;
+    uint32_t hash_bits;         // 桶中所有key的hash值的高local_depth位
+    int num_entries;            // 页面中键值对的数量
+    page_id_t next_overflow;    // 下一个溢出页，IX_NO_PAGE表示没有
+};
+
+/* 哈希索引的文件头，保存在第0页，关闭索引时写回 */
+class IxHashFileHdr {
+   public:
+    int num_pages_ = 0;                     // 磁盘文件中页面的数量
+    int global_depth_ = 0;                  // 目录有2^global_depth_项，按key的hash值的高global_depth_位定位
+    int col_num_ = 0;                       // 索引包含的字段数量
+    std::vector<ColType> col_types_;        // 字段的类型
+    std::vector<int> col_lens_;             // 字段的长度
+    int col_tot_len_ = 0;                   // 索引包含的字段的总长度
+    int bucket_capacity_ = 0;               // 每个桶页面最多存放的键值对数量
+    std::vector<page_id_t> dir_pages_;      // 依次存放目录的页面
+    IxKeyComparator key_cmp_;               // key比较器，不写入磁盘
+
+    IxHashFileHdr() = default;
+
+    IxHashFileHdr(const std::vector<ColType> &col_types, const std::vector<int> &col_lens)
+        : col_num_(static_cast<int>(col_types.size())), col_types_(col_types), col_lens_(col_lens) {
+        for (int len : col_lens_) {
+            col_tot_len_ += len;
+        }
+        bucket_capacity_ = static_cast<int>((PAGE_SIZE - sizeof(IxHashBucketHdr)) / (col_tot_len_ + sizeof(Rid)));
+        key_cmp_.init(col_types_, col_lens_);
+    }
+
+    // 序列化后的长度，需要不超过PAGE_SIZE
+    int tot_len() const {
+        return static_cast<int>(sizeof(int) * 6 + (sizeof(ColType) + sizeof(int)) * col_num_ +
+                                sizeof(page_id_t) * dir_pages_.size());
+    }
+
+    void serialize(char *dest) const {
+        int offset = 0;
+        auto put = [&](const void *src, size_t len) {
+            memcpy(dest + offset, src, len);
+            offset += static_cast<int>(len);
+        };
+        int num_dir_pages = static_cast<int>(dir_pages_.size());
+        put(&num_pages_, sizeof(int));
+        put(&global_depth_, sizeof(int));
+        put(&col_num_, sizeof(int));
+        put(col_types_.data(), sizeof(ColType) * col_num_);
+        put(col_lens_.data(), sizeof(int) * col_num_);
+        put(&col_tot_len_, sizeof(int));
+        put(&bucket_capacity_, sizeof(int));
+        put(&num_dir_pages, sizeof(int));
+        put(dir_pages_.data(), sizeof(page_id_t) * num_dir_pages);
+        assert(offset == tot_len());
+    }
+
+    void deserialize(const char *src) {
+        int offset = 0;
+        auto get = [&](void *dst, size_t len) {
+            memcpy(dst, src + offset, len);
+            offset += static_cast<int>(len);
+        };
+        int num_dir_pages;
+        get(&num_pages_, sizeof(int));
+        get(&global_depth_, sizeof(int));
+        get(&col_num_, sizeof(int));
+        col_types_.resize(col_num_);
+        col_lens_.resize(col_num_);
+        get(col_types_.data(), sizeof(ColType) * col_num_);
+        get(col_lens_.data(), sizeof(int) * col_num_);
+        get(&col_tot_len_, sizeof(int));
+        get(&bucket_capacity_, sizeof(int));
+        get(&num_dir_pages, sizeof(int));
+        dir_pages_.resize(num_dir_pages);
+        get(dir_pages_.data(), sizeof(page_id_t) * num_dir_pages);
+        key_cmp_.init(col_types_, col_lens_);
+    }
+};
+
+/* 管理哈希索引的一个桶页面或溢出页：页面头之后依次是bucket_capacity_个key和bucket_capacity_个rid，
+   前num_entries个有效，无序存放 */
+class IxHashBucket {
+   public:
+    IxHashBucket(const IxHashFileHdr *file_hdr, Page *page) : file_hdr_(file_hdr), page_(page) {
+        hdr_ = reinterpret_cast<IxHashBucketHdr *>(page->get_data());
+        keys_ = page->get_data() + sizeof(IxHashBucketHdr);
+        rids_ = reinterpret_cast<Rid *>(keys_ + file_hdr->bucket_capacity_ * file_hdr->col_tot_len_);
+    }
+
+    Page *page() const { return page_; }
+
+    IxHashBucketHdr *hdr() const { return hdr_; }
+
+    int size() const { return hdr_->num_entries; }
+
+    bool full() const { return hdr_->num_entries >= file_hdr_->bucket_capacity_; }
+
+    const char *key_at(int i) const { return keys_ + i * file_hdr_->col_tot_len_; }
+
+    const Rid &rid_at(int i) const { return rids_[i]; }
+
+    // key在页面中的位置，不存在时返回-1
+    int find(const char *key) const {
+        for (int i = 0; i < hdr_->num_entries; i++) {
+            if (file_hdr_->key_cmp_(key_at(i), key) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void append(const char *key, const Rid &rid) {
+        assert(!full());
+        memcpy(keys_ + hdr_->num_entries * file_hdr_->col_tot_len_, key, file_hdr_->col_tot_len_);
+        rids_[hdr_->num_entries] = rid;
+        hdr_->num_entries++;
+    }
+
+    // 删除第i个键值对，用最后一个键值对填补
+    void erase(int i) {
+        int last = --hdr_->num_entries;
+        if (i != last) {
+            memcpy(keys_ + i * file_hdr_->col_tot_len_, key_at(last), file_hdr_->col_tot_len_);
+            rids_[i] = rids_[last];
+        }
+    }
+
+   private:
+    const IxHashFileHdr *file_hdr_;
+    Page *page_;
+    IxHashBucketHdr *hdr_;
+    char *keys_;
+    Rid *rids_;
+};
+
+/*
+IxHashIndexHandle是只支持等值查找的可扩展哈希(extendible hashing)索引，桶是缓冲池中的页面
+1. 目录有2^global_depth项，key的hash值的高global_depth位决定它所在的目录项，目录项指向桶页面；
+   桶记录自己的local_depth和桶中所有key的hash值的高local_depth位，连续的2^(global_depth - local_depth)个目录项
+   指向同一个桶
+2. 桶满时分裂：local_depth小于global_depth时只新建一个桶，按hash值的下一个高位把键值对分到两个桶中，
+   修改原来指向该桶的后一半目录项；local_depth等于global_depth时先把目录翻倍。global_depth达到IX_HASH_MAX_DEPTH后
+   不再分裂，在桶后面追加溢出页
+3. 并发：dir_latch_保护目录的大小，查找、插入、删除和分裂都持有读锁，只有目录翻倍持有写锁。目录项是原子变量，
+   分裂在持有桶的写锁时修改只属于该桶的目录项，因此不同的桶可以同时分裂。读取目录项之后才对桶加锁，
+   期间桶可能已经分裂，加锁后检查key的hash值是否仍属于该桶，不属于时重新读取目录项
+4. 与B+树一样key唯一，插入已经存在的key时不做修改；删除不合并桶，溢出页也不回收
+5. 目录在内存中，打开时从目录页读入，关闭时与文件头一起写回；与B+树一样索引的修改不写日志，
+   崩溃恢复之后由SmManager::rebuild_indexes()重建
+*/
+class IxHashIndexHandle {
+    friend class IxManager;
+
+   public:
+    IxHashIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
+
+    // for search
+    bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
+
+    int get_values_batch(const std::vector<const char *> &keys, std::vector<std::vector<Rid>> *results,
+                         Transaction *transaction);
+
+    // for insert
+    page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
+
+    void insert_entries(const std::vector<const char *> &keys, const std::vector<Rid> &rids, Transaction *transaction);
+
+    // for delete
+    bool delete_entry(const char *key, Transaction *transaction);
+
+    int delete_entries(const std::vector<const char *> &keys, Transaction *transaction);
+
+    /**
+     * @description: key的64位hash值，与key比较器一致：比较结果相等的key的hash值相同(-0.0与0.0相同)
+     */
+    uint64_t hash(const char *key) const;
+
+    int global_depth() {
+        std::shared_lock<std::shared_mutex> lock(dir_latch_);
+        return file_hdr_.global_depth_;
+    }
+
+    const IxHashFileHdr &get_file_hdr() const { return file_hdr_; }
+
+   private:
+    // hash值的高depth位
+    static uint64_t hash_prefix(uint64_t h, int depth) { return depth == 0 ? 0 : h >> (64 - depth); }
+
+    // 已知hash值的查找、插入和删除
+    bool lookup(const char *key, uint64_t h, std::vector<Rid> *result);
+
+    page_id_t insert(const char *key, uint64_t h, const Rid &value);
+
+    bool remove(const char *key, uint64_t h);
+
+    std::vector<size_t> hash_order(const std::vector<const char *> &keys, std::vector<uint64_t> *hashes) const;
+
+    template <typename Visit>
+    bool visit_chain(Page *head, bool modify, Visit visit);
+
+    page_id_t append_overflow(IxHashBucket &bucket, const char *key, const Rid &value);
+
+    // 对key所在的桶加锁，返回pin住的桶页面。调用者需持有dir_latch_的读锁
+    Page *lock_bucket(uint64_t h, bool exclusive);
+
+    void unlock_bucket(Page *page, bool exclusive, bool dirty);
+
+    void split(IxHashBucket &bucket);
+
+    void grow_directory(int global_depth);
+
+    // 把目录和文件头写回磁盘，由IxManager::close_index()调用
+    void flush();
+
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    int fd_;
+    IxHashFileHdr file_hdr_;
+    std::shared_mutex dir_latch_;                       // 保护file_hdr_.global_depth_和dir_的大小
+    std::vector<std::atomic<page_id_t>> dir_;           // 目录，第i项为hash值高global_depth位为i的key所在的桶
+};
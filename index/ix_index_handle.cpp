@@ -1,64 +1,80 @@
 #include "ix_index_handle.h"
 
+#include <algorithm>
+
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "ix_scan.h"
 
+namespace {
+
+// 下降时给结点加锁，需要等待其他线程释放时计入index_latch_waits
+void latch_node(Page *page, bool exclusive) {
+    if (exclusive ? page->try_wlatch() : page->try_rlatch()) {
+        return;
+    }
+    EngineMetrics::get().index_latch_waits.add();
+    if (exclusive) {
+        page->wlatch();
+    } else {
+        page->rlatch();
+    }
+}
+
+}  // namespace
+
 /**
- * @brief 在当前node中查找第一个>=target的key_idx
+ * @brief 结点内查找的通用实现，按file_hdr->key_search_选择查找内核
  *
- * @return key_idx，范围为[0,num_key)，如果返回的key_idx=num_key，则表示target大于最后一个key
- * @note 返回key index（同时也是rid index），作为slot no
+ * @tparam upper true查找第一个>target的key_idx，false查找第一个>=target的key_idx
  */
-int IxNodeHandle::lower_bound(const char *target) const {
+template <bool upper>
+int IxNodeHandle::search(const char *target) const {
     int n = page_hdr->num_key;
-    if (binary_search) {
-        int l = 0, r = n;
-        while (l < r) {
-            int mid = (l + r) / 2;
-            int cmp = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-            if (cmp < 0) {
-                l = mid + 1;
-            } else {
-                r = mid;
-            }
-        }
-        return l;
+    switch (file_hdr->key_search_) {
+        case IxKeySearch::INT_SSE:
+        case IxKeySearch::INT_AVX2:
+            return ix_search_keys<int32_t, upper>(reinterpret_cast<const int32_t *>(keys), n,
+                                                  *reinterpret_cast<const int32_t *>(target),
+                                                  file_hdr->key_search_ == IxKeySearch::INT_AVX2);
+        case IxKeySearch::FLOAT_SSE:
+        case IxKeySearch::FLOAT_AVX2:
+            return ix_search_keys<float, upper>(reinterpret_cast<const float *>(keys), n,
+                                                *reinterpret_cast<const float *>(target),
+                                                file_hdr->key_search_ == IxKeySearch::FLOAT_AVX2);
+        default:
+            break;
     }
-    for (int i = 0; i < n; ++i) {
-        if (ix_compare(get_key(i), target, file_hdr->col_types_, file_hdr->col_lens_) >= 0) {
-            return i;
-        }
+    // 无分支二分查找：答案始终位于[base, base + n]，每轮只根据比较结果移动base
+    int base = 0;
+    while (n > 1) {
+        int half = n / 2;
+        int cmp = file_hdr->key_cmp_(get_key(base + half - 1), target);
+        base = (upper ? cmp <= 0 : cmp < 0) ? base + half : base;
+        n -= half;
     }
-    return n;
+    if (n == 1) {
+        int cmp = file_hdr->key_cmp_(get_key(base), target);
+        base += (upper ? cmp <= 0 : cmp < 0);
+    }
+    return base;
 }
 
+/**
+ * @brief 在当前node中查找第一个>=target的key_idx
+ *
+ * @return key_idx，范围为[0,num_key)，如果返回的key_idx=num_key，则表示target大于最后一个key
+ * @note 返回key index（同时也是rid index），作为slot no
+ */
+int IxNodeHandle::lower_bound(const char *target) const { return search<false>(target); }
+
 /**
  * @brief 在当前node中查找第一个>target的key_idx
  *
  * @return key_idx，范围为[1,num_key)，如果返回的key_idx=num_key，则表示target大于等于最后一个key
  * @note 注意此处的范围从1开始
  */
-int IxNodeHandle::upper_bound(const char *target) const {
-    int n = page_hdr->num_key;
-    if (binary_search) {
-        int l = 0, r = n;
-        while (l < r) {
-            int mid = (l + r) / 2;
-            int cmp = ix_compare(get_key(mid), target, file_hdr->col_types_, file_hdr->col_lens_);
-            if (cmp <= 0) {
-                l = mid + 1;
-            } else {
-                r = mid;
-            }
-        }
-        return l;
-    }
-    for (int i = 0; i < n; ++i) {
-        if (ix_compare(get_key(i), target, file_hdr->col_types_, file_hdr->col_lens_) > 0) {
-            return i;
-        }
-    }
-    return n;
-}
+int IxNodeHandle::upper_bound(const char *target) const { return search<true>(target); }
 
 /**
  * @brief 用于叶子结点根据key来查找该结点中的键值对
@@ -73,13 +89,85 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
     if (pos == get_size()) {
         return false;
     }
-    if (ix_compare(get_key(pos), key, file_hdr->col_types_, file_hdr->col_lens_) != 0) {
+    if (file_hdr->key_cmp_(get_key(pos), key) != 0) {
         return false;
     }
     *value = get_rid(pos);
     return true;
 }
 
+namespace {
+
+int align_slots(int prefix_len) { return (prefix_len + 3) & ~3; }
+
+}  // namespace
+
+/**
+ * @brief 内部结点的槽数组
+ *
+ * @param[out] num_slots 槽的数量，截断到页面能容纳的范围
+ */
+const IxInternalSlot *IxNodeHandle::internal_slots(int *num_slots) const {
+    int offset = sizeof(IxPageHdr) + sizeof(IxInternalHdr) + align_slots(get_prefix_len());
+    int max_slots = (PAGE_SIZE - offset) / static_cast<int>(sizeof(IxInternalSlot));
+    *num_slots = std::max(0, std::min(page_hdr->num_key, max_slots));
+    return reinterpret_cast<const IxInternalSlot *>(page->get_data() + offset);
+}
+
+/**
+ * @brief 槽对应的分隔key去掉公共前缀后的后缀。偏移截断后，从后缀开始读到完整key的长度也不会越过页面
+ *
+ * @param[out] len 后缀的长度
+ */
+const char *IxNodeHandle::suffix_at(const IxInternalSlot &slot, int prefix_len, int *len) const {
+    int max_len = file_hdr->col_tot_len_ - prefix_len;
+    *len = std::min<int>(slot.key_len, max_len);
+    return page->get_data() + std::min<int>(slot.key_off, PAGE_SIZE - max_len);
+}
+
+/**
+ * @brief 比较完整的key与槽对应的分隔key，调用者已确认key以公共前缀开头
+ *
+ * @return key < 分隔key返回负数，相等返回0，key > 分隔key返回正数
+ */
+int IxNodeHandle::compare_suffix(const char *key, const IxInternalSlot &slot, int prefix_len) const {
+    int len;
+    const char *suffix = suffix_at(slot, prefix_len, &len);
+    int sep_len = prefix_len + len;
+    if (prefix_len == 0 && sep_len == file_hdr->col_tot_len_) {
+        return file_hdr->key_cmp_(key, suffix);
+    }
+    int res = ix_compare_range(key, suffix, prefix_len, sep_len, file_hdr->col_types_, file_hdr->col_lens_);
+    return res != 0 ? res : sep_len < file_hdr->col_tot_len_;
+}
+
+/**
+ * @brief 内部结点中目标key所在孩子的下标，即不大于key的分隔key(第0个除外)的数量
+ */
+int IxNodeHandle::child_index(const char *key) const {
+    int n;
+    const IxInternalSlot *slots = internal_slots(&n);
+    if (n <= 1) {
+        return 0;
+    }
+    // 先与公共前缀比较：前缀不同时key小于或大于全部分隔key
+    int prefix_len = get_prefix_len();
+    int res = ix_compare_range(key, internal_prefix(), 0, prefix_len, file_hdr->col_types_, file_hdr->col_lens_);
+    if (res != 0) {
+        return res < 0 ? 0 : n - 1;
+    }
+    // 无分支二分查找第一个大于key的分隔key，答案始终位于[base, base + count]
+    int base = 1;
+    int count = n - 1;
+    while (count > 1) {
+        int half = count / 2;
+        base = compare_suffix(key, slots[base + half - 1], prefix_len) >= 0 ? base + half : base;
+        count -= half;
+    }
+    base += compare_suffix(key, slots[base], prefix_len) >= 0;
+    return base - 1;
+}
+
 /**
  * 用于内部结点（非叶子节点）查找目标key所在的孩子结点（子树）
  * @param key 目标key
@@ -87,9 +175,160 @@ bool IxNodeHandle::leaf_lookup(const char *key, Rid **value) {
  */
 page_id_t IxNodeHandle::internal_lookup(const char *key) {
     assert(!is_leaf_page());
-    int idx = upper_bound(key);
-    int child_idx = (idx == 0) ? 0 : idx - 1;
-    return value_at(child_idx);
+    return value_at(child_index(key));
+}
+
+/**
+ * @brief 叶子结点的键值对少于一半，或内部结点占用的字节数少于可用字节数的一半
+ */
+bool IxNodeHandle::is_underfull() {
+    if (is_leaf_page()) {
+        return get_size() < get_min_size();
+    }
+    return get_used_bytes() < get_internal_capacity() / 2;
+}
+
+/**
+ * @brief 内部结点的第i个分隔key，包括公共前缀，第0个为空
+ */
+std::string IxNodeHandle::separator_at(int i) const {
+    int n;
+    const IxInternalSlot *slots = internal_slots(&n);
+    if (i <= 0 || i >= n) {
+        return std::string();
+    }
+    int prefix_len = get_prefix_len();
+    int len;
+    const char *suffix = suffix_at(slots[i], prefix_len, &len);
+    std::string key(internal_prefix(), prefix_len);
+    key.append(suffix, len);
+    return key;
+}
+
+/**
+ * @brief 取出内部结点的全部孩子及其分隔key
+ */
+void IxNodeHandle::get_separators(IxSeparators *seps) const {
+    int n;
+    const IxInternalSlot *slots = internal_slots(&n);
+    seps->clear();
+    seps->reserve(n + 1);
+    for (int i = 0; i < n; i++) {
+        seps->push_back(IxSeparator{slots[i].child, separator_at(i)});
+    }
+}
+
+/**
+ * @brief 用seps[begin, end)重写内部结点，seps[begin]的分隔key视为空
+ *
+ * @param max_prefix_len 公共前缀的最大长度。删除分隔key时传入原来的前缀长度，剩余的分隔key一定放得下
+ * @return 是否放得下，放不下时结点不变
+ */
+bool IxNodeHandle::set_separators(const IxSeparators &seps, size_t begin, size_t end, int max_prefix_len) {
+    int prefix_len;
+    int size = separators_size(file_hdr, seps, begin, end, max_prefix_len, &prefix_len);
+    if (size > get_internal_capacity()) {
+        return false;
+    }
+    IxInternalHdr *hdr = internal_hdr();
+    hdr->prefix_len = prefix_len;
+    hdr->used_len = size;
+    if (end - begin > 1) {
+        memcpy(keys + sizeof(IxInternalHdr), seps[begin + 1].key.data(), prefix_len);
+    }
+    auto slots = reinterpret_cast<IxInternalSlot *>(keys + sizeof(IxInternalHdr) + align_slots(prefix_len));
+    char *suffix = reinterpret_cast<char *>(slots + (end - begin));
+    for (size_t i = begin; i < end; i++) {
+        IxInternalSlot &slot = slots[i - begin];
+        slot.child = seps[i].child;
+        slot.key_off = suffix - page->get_data();
+        slot.key_len = i == begin ? 0 : seps[i].key.size() - prefix_len;
+        memcpy(suffix, seps[i].key.data() + prefix_len, slot.key_len);
+        suffix += slot.key_len;
+    }
+    set_size(end - begin);
+    return true;
+}
+
+/**
+ * @brief 内部结点的可用字节数：与叶子相同大小的空间，最多为一个页面。测试调小btree_order时内部结点也随之变小
+ */
+int IxNodeHandle::internal_capacity(const IxFileHdr *file_hdr) {
+    int leaf_bytes = (file_hdr->btree_order_ + 1) * (file_hdr->col_tot_len_ + static_cast<int>(sizeof(Rid)));
+    return std::min(PAGE_SIZE - static_cast<int>(sizeof(IxPageHdr)), leaf_bytes);
+}
+
+/**
+ * @brief 用seps[begin, end)组成内部结点时占用的字节数
+ *
+ * @param max_prefix_len 公共前缀的最大长度
+ * @param[out] prefix_len 公共前缀的长度
+ */
+int IxNodeHandle::separators_size(const IxFileHdr *file_hdr, const IxSeparators &seps, size_t begin, size_t end,
+                                  int max_prefix_len, int *prefix_len) {
+    int prefix = 0;
+    size_t keys_len = 0;
+    if (end - begin > 1) {
+        const std::string &first = seps[begin + 1].key;
+        prefix = std::min<int>(first.size(), max_prefix_len);
+        for (size_t i = begin + 2; i < end && prefix > 0; i++) {
+            prefix = ix_common_prefix(first.data(), prefix, seps[i].key.data(), seps[i].key.size(),
+                                      file_hdr->col_types_, file_hdr->col_lens_);
+        }
+        for (size_t i = begin + 1; i < end; i++) {
+            keys_len += seps[i].key.size() - prefix;
+        }
+    }
+    if (prefix_len != nullptr) {
+        *prefix_len = prefix;
+    }
+    return sizeof(IxInternalHdr) + align_slots(prefix) + (end - begin) * sizeof(IxInternalSlot) + keys_len;
+}
+
+/**
+ * @brief 把seps[begin, end)分成两个内部结点的位置mid：[begin, mid)和[mid, end)都放得下，seps[mid]的分隔key上移到父结点。
+ *        从两边字节数最接近的位置开始向两侧依次尝试
+ *
+ * @param accept 对分裂位置的额外要求，为空时不限制
+ * @return mid∈(begin, end)，没有满足要求的位置时返回-1
+ */
+int IxNodeHandle::choose_split(const IxFileHdr *file_hdr, const IxSeparators &seps, size_t begin, size_t end,
+                               const std::function<bool(size_t)> &accept) {
+    if (end - begin < 2) {
+        return -1;
+    }
+    size_t total = 0;
+    for (size_t i = begin; i < end; i++) {
+        total += sizeof(IxInternalSlot) + seps[i].key.size();
+    }
+    size_t balanced = begin + 1;
+    for (size_t left = 0; balanced < end - 1; balanced++) {
+        left += sizeof(IxInternalSlot) + seps[balanced - 1].key.size();
+        if (left * 2 >= total) {
+            break;
+        }
+    }
+    int capacity = internal_capacity(file_hdr);
+    auto fits = [&](size_t mid) {
+        return separators_size(file_hdr, seps, begin, mid) <= capacity &&
+               separators_size(file_hdr, seps, mid, end) <= capacity && (!accept || accept(mid));
+    };
+    for (size_t d = 0; d < end - begin; d++) {
+        if (balanced >= begin + 1 + d && fits(balanced - d)) {
+            return balanced - d;
+        }
+        if (d > 0 && balanced + d < end && fits(balanced + d)) {
+            return balanced + d;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 相邻的两个key之间最短的分隔key：right的最短前缀，大于left且不大于right
+ */
+std::string IxNodeHandle::make_separator(const IxFileHdr *file_hdr, const char *left, const char *right) {
+    return std::string(right, ix_separator_len(left, right, file_hdr->col_types_, file_hdr->col_lens_));
 }
 
 /**
@@ -132,7 +371,7 @@ void IxNodeHandle::insert_pairs(int pos, const char *key, const Rid *rid, int n)
  */
 int IxNodeHandle::insert(const char *key, const Rid &value) {
     int pos = lower_bound(key);
-    if (pos < get_size() && ix_compare(get_key(pos), key, file_hdr->col_types_, file_hdr->col_lens_) == 0) {
+    if (pos < get_size() && file_hdr->key_cmp_(get_key(pos), key) == 0) {
         return get_size();
     }
     insert_pair(pos, key, value);
@@ -163,7 +402,7 @@ void IxNodeHandle::erase_pair(int pos) {
  */
 int IxNodeHandle::remove(const char *key) {
     int pos = lower_bound(key);
-    if (pos < get_size() && ix_compare(get_key(pos), key, file_hdr->col_types_, file_hdr->col_lens_) == 0) {
+    if (pos < get_size() && file_hdr->key_cmp_(get_key(pos), key) == 0) {
         erase_pair(pos);
     }
     return get_size();
@@ -183,27 +422,278 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     disk_manager_->set_fd2pageno(fd, file_hdr_->num_pages_);
 }
 
+/**
+ * @brief 判断node在执行operation之后是否不会影响其祖先结点，安全时可以释放祖先结点的写锁
+ * 插入：叶子不会分裂；内部结点在插入一个最长的分隔key后仍放得下
+ * 删除：叶子不会合并或重分配；内部结点在删除一个分隔key后仍不少于半满
+ * 分隔key只区分相邻的孩子，叶子的第一个key变化时不需要修改祖先结点
+ *
+ * @param node 下降过程中已经加写锁的结点
+ * @param key 要插入或删除的key
+ * @param operation 操作类型，INSERT或DELETE
+ */
+bool IxIndexHandle::is_safe(IxNodeHandle *node, const char *key, Operation operation) {
+    if (node->is_leaf_page()) {
+        if (operation == Operation::INSERT) {
+            return node->get_size() + 1 < node->get_max_size();
+        }
+        // 根结点为叶子时删空才需要调整
+        return node->is_root_page() ? node->get_size() > 1 : node->get_size() - 1 >= node->get_min_size();
+    }
+    int size = node->get_size();
+    int prefix_len = node->get_prefix_len();
+    int max_entry = sizeof(IxInternalSlot) + file_hdr_->col_tot_len_ - prefix_len;
+    if (operation == Operation::INSERT) {
+        // 插入到两个已有分隔key之间的分隔key一定以公共前缀开头；插入到两端时公共前缀可能变短，每个后缀都随之变长
+        int child = node->child_index(key);
+        int growth = max_entry;
+        if (child == 0 || child == size - 1) {
+            growth = sizeof(IxInternalSlot) + file_hdr_->col_tot_len_ + prefix_len * std::max(size - 1, 0);
+        }
+        return node->get_used_bytes() + growth <= node->get_internal_capacity();
+    }
+    if (node->is_root_page()) {
+        // 根结点为内部结点时只剩一个孩子才需要调整
+        return size > 2;
+    }
+    // 删除分隔key时保留原来的公共前缀，占用的字节数最多减少一个最长的后缀和槽
+    return node->get_used_bytes() - max_entry >= node->get_internal_capacity() / 2;
+}
+
+/**
+ * @brief 释放transaction中除最后一个结点以外的所有结点的写锁，并unpin这些结点
+ */
+void IxIndexHandle::release_ancestors(Transaction *transaction) {
+    auto page_set = transaction->get_index_latch_page_set();
+    while (page_set->size() > 1) {
+        Page *page = page_set->front();
+        page_set->pop_front();
+        page->wunlatch();
+        buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+    }
+}
+
+/**
+ * @brief 插入或删除结束后，释放下降过程中加写锁的所有结点以及根结点锁
+ * @param root_is_latched find_leaf_page返回的根结点锁是否仍被持有
+ */
+void IxIndexHandle::release_latched_pages(Transaction *transaction, bool root_is_latched) {
+    auto page_set = transaction->get_index_latch_page_set();
+    while (!page_set->empty()) {
+        Page *page = page_set->front();
+        page_set->pop_front();
+        page->wunlatch();
+        buffer_pool_manager_->unpin_page(page->get_page_id(), true);
+    }
+    // 合并或调整根结点时摘除的结点，在释放所有锁之后才能被其他线程复用
+    auto deleted_set = transaction->get_index_deleted_page_set();
+    while (!deleted_set->empty()) {
+        free_node(deleted_set->front());
+        deleted_set->pop_front();
+    }
+    if (root_is_latched) {
+        root_latch_.unlock();
+    }
+}
+
 /**
  * @brief 用于查找指定键所在的叶子结点
+ * FIND：自上而下加读锁，孩子加锁后立即释放父结点
+ * INSERT/DELETE：先乐观下降，内部结点只加读锁、叶子加写锁，叶子安全时直接返回；
+ * 否则重新悲观下降，每个结点加写锁并放入transaction的index_latch_page_set_，遇到安全结点时释放其全部祖先
+ *
  * @param key 要查找的目标key值
  * @param operation 查找到目标键值对后要进行的操作类型
- * @param transaction 事务参数，如果不需要则默认传入nullptr
+ * @param transaction 事务参数，INSERT/DELETE时不能为nullptr，加写锁的结点(包括叶子)都存放在其中
  * @return [leaf node] and [root_is_latched] 返回目标叶子结点以及根结点是否加锁
  * @note need to Unlatch and unpin the leaf node outside!
  * 注意：用了FindLeafPage之后一定要unlatch叶结点，否则下次latch该结点会堵塞！
+ * FIND返回的叶子加了读锁，需调用者runlatch后unpin；INSERT/DELETE由release_latched_pages统一释放
  */
 std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, 
     Operation operation,Transaction *transaction, bool find_first) {
+    // 结点一旦创建就不会在叶子和内部结点之间转换，可以在加锁之前读取is_leaf
+    root_latch_.lock_shared();
     if (is_empty()) {
+        root_latch_.unlock_shared();
         return std::make_pair(nullptr, false);
     }
     IxNodeHandle *node = fetch_node(file_hdr_->root_page_);
+    bool write_leaf = operation != Operation::FIND;
+    latch_node(node->page, write_leaf && node->is_leaf_page());
+    root_latch_.unlock_shared();
     while (!node->is_leaf_page()) {
-        page_id_t child = node->internal_lookup(key);
+        IxNodeHandle *child = fetch_node(node->internal_lookup(key));
+        latch_node(child->page, write_leaf && child->is_leaf_page());
+        node->page->runlatch();
         buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-        node = fetch_node(child);
+        delete node;
+        node = child;
+    }
+    if (!write_leaf) {
+        return std::make_pair(node, false);
+    }
+    if (is_safe(node, key, operation)) {
+        transaction->append_index_latch_page_set(node->page);
+        return std::make_pair(node, false);
+    }
+    node->page->wunlatch();
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    delete node;
+
+    // 叶子不安全，可能修改祖先结点，重新悲观下降
+    EngineMetrics::get().index_pessimistic_descents.add();
+    root_latch_.lock();
+    bool root_is_latched = true;
+    if (is_empty()) {
+        root_latch_.unlock();
+        return std::make_pair(nullptr, false);
     }
-    return std::make_pair(node, false);
+    node = fetch_node(file_hdr_->root_page_);
+    latch_node(node->page, true);
+    transaction->append_index_latch_page_set(node->page);
+    while (true) {
+        if (is_safe(node, key, operation)) {
+            release_ancestors(transaction);
+            if (root_is_latched) {
+                root_latch_.unlock();
+                root_is_latched = false;
+            }
+        }
+        if (node->is_leaf_page()) {
+            break;
+        }
+        IxNodeHandle *child = fetch_node(node->internal_lookup(key));
+        latch_node(child->page, true);
+        transaction->append_index_latch_page_set(child->page);
+        delete node;
+        node = child;
+    }
+    return std::make_pair(node, root_is_latched);
+}
+
+/**
+ * @brief unpin乐观读访问的结点并释放其句柄
+ */
+void IxIndexHandle::release_node(IxNodeHandle *node) const {
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    delete node;
+}
+
+/**
+ * @brief 乐观下降到key所在的叶子：不加任何锁，每一层读取孩子页号后校验父结点版本，
+ * 取得孩子版本后再次校验父结点(lock coupling)，保证读到的孩子确实是父结点当前的孩子
+ *
+ * @param key 要查找的目标key值
+ * @param[out] leaf 返回pin住但未加锁的叶子，树为空时返回nullptr
+ * @param[out] version 叶子的版本号，读完叶子后需调用validate_version校验
+ * @return 是否成功，返回false表示与写者冲突，需要重新查找
+ */
+bool IxIndexHandle::optimistic_find_leaf(const char *key, IxNodeHandle **leaf, uint64_t *version) const {
+    page_id_t root = file_hdr_->root_page_;
+    if (root == IX_NO_PAGE) {
+        *leaf = nullptr;
+        return true;
+    }
+    IxNodeHandle *node = fetch_node(root);
+    uint64_t node_version;
+    // 根结点分裂或被替换时持有旧根的写锁，读到版本号后根页号必须仍然是root
+    if (!node->page->try_read_version(&node_version) || file_hdr_->root_page_ != root) {
+        release_node(node);
+        return false;
+    }
+    while (!node->is_leaf_page()) {
+        page_id_t child_page_no = node->internal_lookup(key);
+        if (!node->page->validate_version(node_version)) {
+            release_node(node);
+            return false;
+        }
+        IxNodeHandle *child = fetch_node(child_page_no);
+        uint64_t child_version;
+        bool consistent = child->page->try_read_version(&child_version) && node->page->validate_version(node_version);
+        release_node(node);
+        if (!consistent) {
+            release_node(child);
+            return false;
+        }
+        node = child;
+        node_version = child_version;
+    }
+    *leaf = node;
+    *version = node_version;
+    return true;
+}
+
+/**
+ * @brief get_value的乐观读实现
+ * @return 1表示找到，0表示不存在，-1表示与写者冲突需要重试
+ */
+int IxIndexHandle::optimistic_get_value(const char *key, std::vector<Rid> *result) const {
+    IxNodeHandle *leaf;
+    uint64_t version;
+    if (!optimistic_find_leaf(key, &leaf, &version)) {
+        return -1;
+    }
+    if (leaf == nullptr) {
+        return 0;
+    }
+    std::vector<Rid> rids;
+    int pos = leaf->lower_bound(key);
+    while (pos < leaf->get_size() &&
+           file_hdr_->key_cmp_(leaf->get_key(pos), key) == 0) {
+        rids.push_back(*leaf->get_rid(pos));
+        pos++;
+    }
+    bool consistent = leaf->page->validate_version(version);
+    release_node(leaf);
+    if (!consistent) {
+        return -1;
+    }
+    result->insert(result->end(), rids.begin(), rids.end());
+    return rids.empty() ? 0 : 1;
+}
+
+/**
+ * @brief lower_bound/upper_bound的乐观读实现，向右移动时先校验当前叶子再访问下一个叶子
+ * @param upper true表示upper_bound，false表示lower_bound
+ * @param[out] iid 查找结果
+ * @return 是否成功，返回false表示与写者冲突需要重试
+ */
+bool IxIndexHandle::optimistic_bound(const char *key, bool upper, Iid *iid) const {
+    IxNodeHandle *leaf;
+    uint64_t version;
+    if (!optimistic_find_leaf(key, &leaf, &version)) {
+        return false;
+    }
+    if (leaf == nullptr) {
+        *iid = Iid{-1, -1};
+        return true;
+    }
+    while (true) {
+        int pos = upper ? leaf->upper_bound(key) : leaf->lower_bound(key);
+        int size = leaf->get_size();
+        page_id_t page_no = leaf->get_page_no();
+        page_id_t next = leaf->get_next_leaf();
+        bool consistent = leaf->page->validate_version(version);
+        release_node(leaf);
+        if (!consistent) {
+            return false;
+        }
+        if (pos < size) {
+            *iid = Iid{page_no, pos};
+            return true;
+        }
+        if (next == IX_LEAF_HEADER_PAGE || next == IX_NO_PAGE) {
+            break;
+        }
+        leaf = fetch_node(next);
+        if (!leaf->page->try_read_version(&version)) {
+            release_node(leaf);
+            return false;
+        }
+    }
+    *iid = leaf_end();
+    return true;
 }
 
 /**
@@ -216,7 +706,19 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key,
  */
 bool IxIndexHandle::get_value(const char *key, std::vector<Rid> 
     *result, Transaction *transaction) {
-    std::lock_guard<std::mutex> guard(root_latch_);
+    if (num_buffered_.load() != 0) {
+        merge_keys({key});
+    }
+    if (optimistic_read_) {
+        for (int attempt = 0; attempt < IX_OPTIMISTIC_RETRIES; attempt++) {
+            int found = optimistic_get_value(key, result);
+            if (found >= 0) {
+                return found == 1;
+            }
+            EngineMetrics::get().index_optimistic_retries.add();
+        }
+        EngineMetrics::get().index_optimistic_fallbacks.add();
+    }
     auto [leaf, root_latched] = find_leaf_page(key, Operation::FIND, transaction);
     if (leaf == nullptr) {
         return false;
@@ -224,25 +726,99 @@ bool IxIndexHandle::get_value(const char *key, std::vector<Rid>
     bool found = false;
     int pos = leaf->lower_bound(key);
     while (pos < leaf->get_size() &&
-           ix_compare(leaf->get_key(pos), key, file_hdr_->col_types_, file_hdr_->col_lens_) == 0) {
+           file_hdr_->key_cmp_(leaf->get_key(pos), key) == 0) {
         result->push_back(*leaf->get_rid(pos));
         found = true;
         pos++;
     }
+    leaf->page->runlatch();
     buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+    delete leaf;
     return found;
 }
 
 /**
- * @brief  将传入的一个node拆分(Split)成两个结点，在node的右边生成一个新结点new node
- * @param node 需要拆分的结点
+ * @brief 批量查找多个key。先把key排序，再按顺序查找：下一个key仍在当前叶子或右边相邻的叶子中时
+ * 直接在叶子中查找，不再从根结点下降，只有跨度较大时才重新下降
+ *
+ * @param keys 要查找的key，顺序任意，可以重复
+ * @param[out] results results[i]为keys[i]对应的所有rid，与get_value的结果相同
+ * @param transaction 事务指针
+ * @return int 找到的key的数量
+ * @note 只持有当前叶子的读锁，向右移动时先释放当前叶子再加锁下一个叶子，与get_value一样不阻塞其他读者
+ */
+int IxIndexHandle::get_values_batch(const std::vector<const char *> &keys, std::vector<std::vector<Rid>> *results,
+                                    Transaction *transaction) {
+    merge_keys(keys);
+    results->assign(keys.size(), {});
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return file_hdr_->key_cmp_(keys[a], keys[b]) < 0; });
+
+    // 已经加读锁的叶子中key不会被其他线程修改，且排好序的key不会落到当前叶子左边
+    auto in_leaf = [&](IxNodeHandle *leaf, const char *key) {
+        int size = leaf->get_size();
+        return size > 0 && file_hdr_->key_cmp_(key, leaf->get_key(size - 1)) <= 0;
+    };
+    auto release = [&](IxNodeHandle *leaf) {
+        leaf->page->runlatch();
+        buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        delete leaf;
+    };
+
+    int found = 0;
+    IxNodeHandle *leaf = nullptr;
+    for (size_t i : order) {
+        const char *key = keys[i];
+        if (leaf != nullptr && !in_leaf(leaf, key)) {
+            page_id_t next = leaf->get_next_leaf();
+            release(leaf);
+            leaf = nullptr;
+            if (next != IX_LEAF_HEADER_PAGE && next != IX_NO_PAGE) {
+                leaf = fetch_node(next);
+                leaf->page->rlatch();
+                // 释放锁期间可能有叶子分裂，key小于右边叶子的第一个key时无法确定其所在的叶子
+                if (!in_leaf(leaf, key) || file_hdr_->key_cmp_(key, leaf->get_key(0)) < 0) {
+                    release(leaf);
+                    leaf = nullptr;
+                }
+            }
+        }
+        if (leaf == nullptr) {
+            leaf = find_leaf_page(key, Operation::FIND, transaction).first;
+            if (leaf == nullptr) {
+                break;
+            }
+        }
+        std::vector<Rid> &result = (*results)[i];
+        int pos = leaf->lower_bound(key);
+        while (pos < leaf->get_size() && file_hdr_->key_cmp_(leaf->get_key(pos), key) == 0) {
+            result.push_back(*leaf->get_rid(pos));
+            pos++;
+        }
+        found += !result.empty();
+    }
+    if (leaf != nullptr) {
+        release(leaf);
+    }
+    return found;
+}
+
+/**
+ * @brief  将传入的叶子结点node拆分(Split)成两个结点，在node的右边生成一个新结点new node
+ * @param node 需要拆分的叶子结点
  * @return 拆分得到的new_node
  * @note need to unpin the new node outside
  * 注意：本函数执行完毕后，原node和new node都需要在函数外面进行unpin
  */
 IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
+    assert(node->is_leaf_page());
+    TraceSpan span("btree.split", "page_no", node->get_page_no());
     IxNodeHandle *new_node = create_node();
-    new_node->page_hdr->is_leaf = node->is_leaf_page();
+    new_node->page_hdr->is_leaf = true;
     new_node->page_hdr->parent = node->get_parent_page_no();
     new_node->page_hdr->num_key = 0;
     new_node->page_hdr->prev_leaf = IX_NO_PAGE;
@@ -254,22 +830,45 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
     new_node->insert_pairs(0, node->get_key(mid), node->get_rid(mid), move_num);
     node->set_size(mid);
 
-    if (new_node->is_leaf_page()) {
-        new_node->set_prev_leaf(node->get_page_no());
-        new_node->set_next_leaf(node->get_next_leaf());
-        node->set_next_leaf(new_node->get_page_no());
-        if (new_node->get_next_leaf() != IX_NO_PAGE) {
-            IxNodeHandle *next = fetch_node(new_node->get_next_leaf());
-            next->set_prev_leaf(new_node->get_page_no());
-            buffer_pool_manager_->unpin_page(next->get_page_id(), true);
-        }
-        if (file_hdr_->last_leaf_ == node->get_page_no() || new_node->get_next_leaf() == IX_LEAF_HEADER_PAGE) {
-            file_hdr_->last_leaf_ = new_node->get_page_no();
-        }
-    } else {
-        for (int i = 0; i < new_node->get_size(); ++i) {
-            maintain_child(new_node, i);
-        }
+    new_node->set_prev_leaf(node->get_page_no());
+    new_node->set_next_leaf(node->get_next_leaf());
+    node->set_next_leaf(new_node->get_page_no());
+    if (new_node->get_next_leaf() != IX_NO_PAGE) {
+        IxNodeHandle *next = fetch_node(new_node->get_next_leaf());
+        next->page->wlatch();
+        next->set_prev_leaf(new_node->get_page_no());
+        next->page->wunlatch();
+        buffer_pool_manager_->unpin_page(next->get_page_id(), true);
+        delete next;
+    }
+    if (file_hdr_->last_leaf_ == node->get_page_no() || new_node->get_next_leaf() == IX_LEAF_HEADER_PAGE) {
+        file_hdr_->last_leaf_ = new_node->get_page_no();
+    }
+    return new_node;
+}
+
+/**
+ * @brief 把内部结点node拆分成两个结点：seps[0, mid)写回node，seps[mid, end)写入node右边的新结点，
+ *        seps[mid]的分隔key由调用者插入父结点
+ * @param seps node的全部孩子及其分隔key，可能比node多一个刚插入的孩子
+ * @param mid choose_split选出的分裂位置
+ * @return 拆分得到的new_node，需要在函数外面进行unpin
+ */
+IxNodeHandle *IxIndexHandle::split_internal(IxNodeHandle *node, const IxSeparators &seps, int mid) {
+    TraceSpan span("btree.split", "page_no", node->get_page_no());
+    IxNodeHandle *new_node = create_node();
+    new_node->page_hdr->is_leaf = false;
+    new_node->page_hdr->parent = node->get_parent_page_no();
+    new_node->page_hdr->num_key = 0;
+    new_node->page_hdr->prev_leaf = IX_NO_PAGE;
+    new_node->page_hdr->next_leaf = IX_NO_PAGE;
+
+    [[maybe_unused]] bool fits = node->set_separators(seps, 0, mid);
+    assert(fits);
+    fits = new_node->set_separators(seps, mid, seps.size());
+    assert(fits);
+    for (int i = 0; i < new_node->get_size(); ++i) {
+        maintain_child(new_node, i);
     }
     return new_node;
 }
@@ -277,18 +876,18 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
 /**
  * @brief Insert key & value pair into internal page after split
  * 拆分(Split)后，向上找到old_node的父结点
- * 将new_node的第一个key插入到父结点，其位置在 父结点指向old_node的孩子指针 之后
- * 如果插入后>=maxsize，则必须继续拆分父结点，然后在其父结点的父结点再插入，即需要递归
+ * 将分隔old_node和new_node的key插入到父结点，其位置在 父结点指向old_node的孩子指针 之后
+ * 如果父结点放不下，则必须继续拆分父结点，然后在其父结点的父结点再插入，即需要递归
  * 直到找到的old_node为根结点时，结束递归（此时将会新建一个根R，关键字为key，old_node和new_node为其孩子）
  *
  * @param (old_node, new_node) 原结点为old_node，old_node被分裂之后产生了新的右兄弟结点new_node
- * @param key 要插入parent的key
+ * @param key 要插入parent的分隔key，大于old_node中的所有key且不大于new_node中的所有key
  * @note 一个结点插入了键值对之后需要分裂，分裂后左半部分的键值对保留在原结点，在参数中称为old_node，
  * 右半部分的键值对分裂为新的右兄弟节点，在参数中称为new_node（参考Split函数来理解old_node和new_node）
  * @note 本函数执行完毕后，new node和old node都需要在函数外面进行unpin
  */
-void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, 
-    IxNodeHandle *new_node,Transaction *transaction) {
+void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const std::string &key, IxNodeHandle *new_node,
+                                       Transaction *transaction) {
     if (old_node->is_root_page()) {
         IxNodeHandle *new_root = create_node();
         new_root->page_hdr->is_leaf = false;
@@ -296,11 +895,7 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
         new_root->page_hdr->num_key = 0;
         new_root->page_hdr->prev_leaf = IX_NO_PAGE;
         new_root->page_hdr->next_leaf = IX_NO_PAGE;
-
-        Rid old_rid = {.page_no = old_node->get_page_no(), .slot_no = 0};
-        new_root->insert_pair(0, old_node->get_key(0), old_rid);
-        Rid new_rid = {.page_no = new_node->get_page_no(), .slot_no = 0};
-        new_root->insert_pair(1, key, new_rid);
+        new_root->set_separators({{old_node->get_page_no(), std::string()}, {new_node->get_page_no(), key}});
 
         old_node->set_parent_page_no(new_root->get_page_no());
         new_node->set_parent_page_no(new_root->get_page_no());
@@ -308,62 +903,99 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
         update_root_page_no(new_root->get_page_no());
         file_hdr_->first_leaf_ = file_hdr_->first_leaf_ == IX_NO_PAGE ? old_node->get_page_no() : file_hdr_->first_leaf_;
         buffer_pool_manager_->unpin_page(new_root->get_page_id(), true);
+        delete new_root;
         return;
     }
 
     IxNodeHandle *parent = fetch_node(old_node->get_parent_page_no());
-    int pos = parent->find_child(old_node) + 1;
-    Rid new_rid = {.page_no = new_node->get_page_no(), .slot_no = 0};
-    parent->insert_pair(pos, key, new_rid);
+    IxSeparators seps;
+    parent->get_separators(&seps);
+    seps.insert(seps.begin() + parent->find_child(old_node) + 1, IxSeparator{new_node->get_page_no(), key});
     new_node->set_parent_page_no(parent->get_page_no());
 
-    if (parent->get_size() >= parent->get_max_size()) {
-        IxNodeHandle *parent_new = split(parent);
-        insert_into_parent(parent, parent_new->get_key(0), parent_new, transaction);
+    if (!parent->set_separators(seps)) {
+        int mid = IxNodeHandle::choose_split(file_hdr_, seps, 0, seps.size());
+        assert(mid > 0);
+        IxNodeHandle *parent_new = split_internal(parent, seps, mid);
+        insert_into_parent(parent, seps[mid].key, parent_new, transaction);
         buffer_pool_manager_->unpin_page(parent_new->get_page_id(), true);
+        delete parent_new;
     }
     buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
+    delete parent;
 }
 
 /**
  * @brief 将指定键值对插入到B+树中
  * @param (key, value) 要插入的键值对
  * @param transaction 事务指针
- * @return page_id_t 插入到的叶结点的page_no
+ * @return page_id_t 插入到的叶结点的page_no，插入被缓存时为IX_NO_PAGE
  */
 page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value, 
     Transaction *transaction) {
-    std::lock_guard<std::mutex> guard(root_latch_);
+    if (change_buffer_ == nullptr) {
+        return insert_entry_now(key, value, transaction);
+    }
+    page_id_t page_no = IX_NO_PAGE;
+    {
+        std::shared_lock merge_lock{merge_latch_};
+        if (!buffer_change(key, &value)) {
+            page_no = insert_entry_now(key, value, transaction);
+        }
+    }
+    merge_if_full();
+    return page_no;
+}
+
+/**
+ * @brief 直接在叶子中插入键值对，不经过修改缓冲
+ */
+page_id_t IxIndexHandle::insert_entry_now(const char *key, const Rid &value, Transaction *transaction) {
+    Transaction local_txn(INVALID_TXN_ID);
+    if (transaction == nullptr) {
+        transaction = &local_txn;
+    }
     auto [leaf, root_latched] = find_leaf_page(key, Operation::INSERT, transaction);
     if (leaf == nullptr) {
         return IX_NO_PAGE;
     }
+    return insert_into_leaf(leaf, root_latched, key, value, transaction);
+}
+
+/**
+ * @brief 向find_leaf_page(INSERT)返回的叶子插入键值对，必要时分裂并更新祖先结点，结束后释放所有加锁的结点
+ * @return page_id_t 插入到的叶结点的page_no
+ */
+page_id_t IxIndexHandle::insert_into_leaf(IxNodeHandle *leaf, bool root_latched, const char *key, const Rid &value,
+                                          Transaction *transaction) {
     int before = leaf->get_size();
     int after = leaf->insert(key, value);
     if (after == before) {
-        buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
-        return leaf->get_page_no();
-    }
-
-    if (leaf->get_size() > 0) {
-        maintain_parent(leaf);
+        page_id_t page_no = leaf->get_page_no();
+        release_latched_pages(transaction, root_latched);
+        delete leaf;
+        return page_no;
     }
 
     page_id_t ret_page = leaf->get_page_no();
     if (leaf->get_size() >= leaf->get_max_size()) {
         IxNodeHandle *new_leaf = split(leaf);
-        if (ix_compare(key, new_leaf->get_key(0), file_hdr_->col_types_, file_hdr_->col_lens_) >= 0) {
+        if (file_hdr_->key_cmp_(key, new_leaf->get_key(0)) >= 0) {
             ret_page = new_leaf->get_page_no();
         }
-        insert_into_parent(leaf, new_leaf->get_key(0), new_leaf, transaction);
+        std::string separator =
+            IxNodeHandle::make_separator(file_hdr_, leaf->get_key(leaf->get_size() - 1), new_leaf->get_key(0));
+        insert_into_parent(leaf, separator, new_leaf, transaction);
         buffer_pool_manager_->unpin_page(new_leaf->get_page_id(), true);
+        delete new_leaf;
     }
 
     if (leaf->get_next_leaf() == IX_LEAF_HEADER_PAGE || leaf->get_page_no() == file_hdr_->last_leaf_) {
         file_hdr_->last_leaf_ = file_hdr_->last_leaf_ == IX_NO_PAGE ? leaf->get_page_no() : file_hdr_->last_leaf_;
     }
 
-    buffer_pool_manager_->unpin_page(leaf->get_page_id(), true);
+    release_latched_pages(transaction, root_latched);
+    delete leaf;
     return ret_page;
 }
 
@@ -371,39 +1003,333 @@ page_id_t IxIndexHandle::insert_entry(const char *key, const Rid &value,
  * @brief 用于删除B+树中含有指定key的键值对
  * @param key 要删除的key值
  * @param transaction 事务指针
+ * @return 是否删除成功，删除被缓存时不检查key是否存在，返回true
  */
 bool IxIndexHandle::delete_entry(const char *key, Transaction *transaction) {
-    std::lock_guard<std::mutex> guard(root_latch_);
+    if (change_buffer_ == nullptr) {
+        return delete_entry_now(key, transaction);
+    }
+    bool deleted = true;
+    {
+        std::shared_lock merge_lock{merge_latch_};
+        if (!buffer_change(key, nullptr)) {
+            deleted = delete_entry_now(key, transaction);
+        }
+    }
+    merge_if_full();
+    return deleted;
+}
+
+/**
+ * @brief 直接从叶子中删除key，不经过修改缓冲
+ */
+bool IxIndexHandle::delete_entry_now(const char *key, Transaction *transaction) {
+    Transaction local_txn(INVALID_TXN_ID);
+    if (transaction == nullptr) {
+        transaction = &local_txn;
+    }
     auto [leaf, root_latched] = find_leaf_page(key, Operation::DELETE, transaction);
     if (leaf == nullptr) {
         return false;
     }
+    return delete_from_leaf(leaf, root_latched, key, transaction);
+}
+
+/**
+ * @brief 从find_leaf_page(DELETE)返回的叶子删除key，必要时合并或重分配，结束后释放所有加锁的结点
+ * @return 是否删除成功
+ */
+bool IxIndexHandle::delete_from_leaf(IxNodeHandle *leaf, bool root_latched, const char *key,
+                                     Transaction *transaction) {
     int before = leaf->get_size();
     leaf->remove(key);
     if (leaf->get_size() == before) {
-        buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        release_latched_pages(transaction, root_latched);
+        delete leaf;
         return false;
     }
-    if (leaf->get_size() > 0) {
-        maintain_parent(leaf);
+    // coalesce_or_redistribute会unpin传入的结点，叶子的pin和写锁仍由release_latched_pages释放
+    bool root_is_latched = root_latched;
+    buffer_pool_manager_->fetch_page(leaf->get_page_id());
+    coalesce_or_redistribute(leaf, transaction, &root_is_latched);
+    release_latched_pages(transaction, root_latched);
+    delete leaf;
+    return true;
+}
+
+/**
+ * @brief 判断key能否直接在已加写锁的leaf中插入或删除：key一定属于leaf，且操作不会分裂或合并leaf
+ */
+bool IxIndexHandle::fits_in_leaf(IxNodeHandle *leaf, const char *key, Operation operation) {
+    int size = leaf->get_size();
+    return size > 0 && file_hdr_->key_cmp_(key, leaf->get_key(size - 1)) <= 0 && is_safe(leaf, key, operation);
+}
+
+/**
+ * @brief 批量插入或删除的公共流程：按key排序后依次处理，下一个key可以直接在当前叶子中完成时
+ * 保留叶子的pin和写锁，不再从根结点下降；否则释放当前叶子，按单个key的流程处理
+ *
+ * @param keys 要处理的key
+ * @param rids 插入时对应的rid，删除时为nullptr
+ * @param operation INSERT或DELETE
+ * @return 成功删除的key的数量，插入时为0
+ */
+int IxIndexHandle::apply_entries(const std::vector<const char *> &keys, const std::vector<Rid> *rids,
+                                 Operation operation, Transaction *transaction) {
+    Transaction local_txn(INVALID_TXN_ID);
+    if (transaction == nullptr) {
+        transaction = &local_txn;
+    }
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
     }
-    bool root_is_latched = false;
-    bool need_delete = coalesce_or_redistribute(leaf, transaction, &root_is_latched);
-    if (need_delete && transaction != nullptr) {
-        Page *page = buffer_pool_manager_->fetch_page(leaf->get_page_id());
-        transaction->append_index_deleted_page(page);
-        buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return file_hdr_->key_cmp_(keys[a], keys[b]) < 0; });
+
+    int deleted = 0;
+    // leaf是transaction的index_latch_page_set_中唯一的结点，且没有持有root_latch_
+    IxNodeHandle *leaf = nullptr;
+    for (size_t i : order) {
+        const char *key = keys[i];
+        if (leaf != nullptr && !fits_in_leaf(leaf, key, operation)) {
+            release_latched_pages(transaction, false);
+            delete leaf;
+            leaf = nullptr;
+        }
+        if (leaf == nullptr) {
+            auto [node, root_latched] = find_leaf_page(key, operation, transaction);
+            if (node == nullptr) {
+                continue;
+            }
+            if (root_latched || transaction->get_index_latch_page_set()->size() != 1 ||
+                !fits_in_leaf(node, key, operation)) {
+                if (operation == Operation::INSERT) {
+                    insert_into_leaf(node, root_latched, key, (*rids)[i], transaction);
+                } else {
+                    deleted += delete_from_leaf(node, root_latched, key, transaction);
+                }
+                continue;
+            }
+            leaf = node;
+        }
+        if (operation == Operation::INSERT) {
+            leaf->insert(key, (*rids)[i]);
+        } else {
+            int before = leaf->get_size();
+            deleted += leaf->remove(key) != before;
+        }
+    }
+    if (leaf != nullptr) {
+        release_latched_pages(transaction, false);
+        delete leaf;
+    }
+    return deleted;
+}
+
+/**
+ * @brief 批量插入键值对，已经存在的key不会重复插入
+ * @param keys 要插入的key，顺序任意
+ * @param rids rids[i]为keys[i]对应的rid
+ */
+void IxIndexHandle::insert_entries(const std::vector<const char *> &keys, const std::vector<Rid> &rids,
+                                   Transaction *transaction) {
+    assert(keys.size() == rids.size());
+    if (change_buffer_ == nullptr) {
+        apply_entries(keys, &rids, Operation::INSERT, transaction);
+        return;
+    }
+    {
+        std::shared_lock merge_lock{merge_latch_};
+        std::vector<const char *> direct_keys;
+        std::vector<Rid> direct_rids;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (!buffer_change(keys[i], &rids[i])) {
+                direct_keys.push_back(keys[i]);
+                direct_rids.push_back(rids[i]);
+            }
+        }
+        apply_entries(direct_keys, &direct_rids, Operation::INSERT, transaction);
+    }
+    merge_if_full();
+}
+
+/**
+ * @brief 批量删除key
+ * @param keys 要删除的key，顺序任意
+ * @return int 成功删除的key的数量，被缓存的删除不计入
+ */
+int IxIndexHandle::delete_entries(const std::vector<const char *> &keys, Transaction *transaction) {
+    if (change_buffer_ == nullptr) {
+        return apply_entries(keys, nullptr, Operation::DELETE, transaction);
+    }
+    int deleted;
+    {
+        std::shared_lock merge_lock{merge_latch_};
+        std::vector<const char *> direct_keys;
+        for (auto key : keys) {
+            if (!buffer_change(key, nullptr)) {
+                direct_keys.push_back(key);
+            }
+        }
+        deleted = apply_entries(direct_keys, nullptr, Operation::DELETE, transaction);
     }
+    merge_if_full();
+    return deleted;
+}
+
+/**
+ * @brief 开启修改缓冲：插入和删除的key所在的叶子(或下降路径上的结点)不在缓冲池中时，修改先缓存在内存中，
+ * 在查找这个key、开始范围扫描、缓存的修改达到capacity或后台合并时再批量写入叶子，避免每个修改一次随机读。
+ * 缓存的修改不写入磁盘，崩溃恢复从表中的记录重建索引；关闭索引之前由IxManager::close_index全部写入。
+ * 只能在索引开始使用之前调用
+ * @param capacity 缓存的修改的最大数量
+ */
+void IxIndexHandle::enable_change_buffer(size_t capacity) {
+    change_buffer_ = std::make_unique<IxChangeBuffer>(&file_hdr_->key_cmp_);
+    change_buffer_capacity_ = capacity;
+}
+
+/**
+ * @brief 把缓存的全部修改按key的顺序写入索引，用于后台合并、范围扫描之前和关闭索引之前
+ * @return size_t 写入的修改数量
+ */
+size_t IxIndexHandle::merge_changes() {
+    if (change_buffer_ == nullptr || num_buffered_.load() == 0) {
+        return 0;
+    }
+    // 先独占merge_latch_再取出修改：之后同一个key上新的修改要么被缓存，要么等待本次写入完成后再直接写入
+    std::unique_lock merge_lock{merge_latch_};
+    IxChangeBuffer::Batch batch;
+    {
+        std::scoped_lock lock{change_latch_};
+        change_buffer_->take_all(&batch);
+        num_buffered_.store(0);
+    }
+    return apply_batch(batch);
+}
+
+/**
+ * @brief 判断下降到key所在叶子的路径上的结点是否都在缓冲池中。只是对修改是否需要读盘的估计，
+ * 判断之后页面仍可能被淘汰或读入
+ */
+bool IxIndexHandle::leaf_resident(const char *key) {
+    root_latch_.lock_shared();
+    if (is_empty()) {
+        root_latch_.unlock_shared();
+        return true;
+    }
+    page_id_t root = file_hdr_->root_page_;
+    if (!buffer_pool_manager_->is_resident(PageId{fd_, root})) {
+        root_latch_.unlock_shared();
+        return false;
+    }
+    IxNodeHandle *node = fetch_node(root);
+    node->page->rlatch();
+    root_latch_.unlock_shared();
+    bool resident = true;
+    while (!node->is_leaf_page()) {
+        page_id_t child_page_no = node->internal_lookup(key);
+        if (!buffer_pool_manager_->is_resident(PageId{fd_, child_page_no})) {
+            resident = false;
+            break;
+        }
+        IxNodeHandle *child = fetch_node(child_page_no);
+        child->page->rlatch();
+        node->page->runlatch();
+        release_node(node);
+        node = child;
+    }
+    node->page->runlatch();
+    release_node(node);
+    return resident;
+}
+
+/**
+ * @brief 叶子不在缓冲池中，或者key上已经有缓存的修改时，缓存这个修改。调用者持有merge_latch_的共享锁
+ * @param rid 插入的rid，删除时为nullptr
+ * @return 是否已缓存，返回false时由调用者直接修改叶子
+ */
+bool IxIndexHandle::buffer_change(const char *key, const Rid *rid) {
+    bool resident = leaf_resident(key);
+    int key_len = file_hdr_->col_tot_len_;
+    std::scoped_lock lock{change_latch_};
+    if (resident && !change_buffer_->contains(key, key_len)) {
+        return false;
+    }
+    if (rid != nullptr) {
+        change_buffer_->insert(key, key_len, *rid);
+    } else {
+        change_buffer_->remove(key, key_len);
+    }
+    num_buffered_.store(change_buffer_->size());
+    EngineMetrics::get().index_changes_buffered.add();
     return true;
 }
 
+/**
+ * @brief 查找keys之前把它们上缓存的修改写入索引
+ */
+void IxIndexHandle::merge_keys(const std::vector<const char *> &keys) {
+    if (change_buffer_ == nullptr || num_buffered_.load() == 0) {
+        return;
+    }
+    int key_len = file_hdr_->col_tot_len_;
+    {
+        std::scoped_lock lock{change_latch_};
+        if (std::none_of(keys.begin(), keys.end(),
+                         [&](const char *key) { return change_buffer_->contains(key, key_len); })) {
+            return;
+        }
+    }
+    std::unique_lock merge_lock{merge_latch_};
+    IxChangeBuffer::Batch batch;
+    {
+        std::scoped_lock lock{change_latch_};
+        for (auto key : keys) {
+            change_buffer_->take(key, key_len, &batch);
+        }
+        num_buffered_.store(change_buffer_->size());
+    }
+    apply_batch(batch);
+}
+
+/**
+ * @brief 缓存的修改达到容量时全部写入索引。调用者不能持有merge_latch_
+ */
+void IxIndexHandle::merge_if_full() {
+    if (num_buffered_.load() >= change_buffer_capacity_) {
+        merge_changes();
+    }
+}
+
+/**
+ * @brief 把取出的修改写入叶子：先删除再插入，REPLACE的删除和插入都在其中。调用者独占merge_latch_
+ * @return size_t 写入的修改数量
+ */
+size_t IxIndexHandle::apply_batch(const IxChangeBuffer::Batch &batch) {
+    std::vector<const char *> keys;
+    for (auto &key : batch.delete_keys) {
+        keys.push_back(key.data());
+    }
+    apply_entries(keys, nullptr, Operation::DELETE, nullptr);
+    keys.clear();
+    for (auto &key : batch.insert_keys) {
+        keys.push_back(key.data());
+    }
+    apply_entries(keys, &batch.insert_rids, Operation::INSERT, nullptr);
+    size_t num_changes = batch.delete_keys.size() + batch.insert_keys.size();
+    EngineMetrics::get().index_changes_merged.add(num_changes);
+    return num_changes;
+}
+
 /**
  * @brief 用于处理合并和重分配的逻辑，用于删除键值对后调用
  *
  * @param node 执行完删除操作的结点
  * @param transaction 事务指针
  * @param root_is_latched 传出参数：根节点是否上锁，用于并发操作
- * @return 是否需要删除结点
+ * @return 是否删除了根结点。合并或调整根结点时摘除的结点记录在transaction的index_deleted_page_set_中，由release_latched_pages()释放
  * @note User needs to first find the sibling of input page.
  * If sibling's size + input page's size >= 2 * page's minsize, then redistribute.
  * Otherwise, merge(Coalesce).
@@ -412,10 +1338,13 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node,
     Transaction *transaction, bool *root_is_latched) {
     if (node->is_root_page()) {
         bool del_root = adjust_root(node);
+        if (del_root && transaction != nullptr) {
+            transaction->append_index_deleted_page(node->get_page_no());
+        }
         buffer_pool_manager_->unpin_page(node->get_page_id(), true);
         return del_root;
     }
-    if (node->get_size() >= node->get_min_size()) {
+    if (!node->is_underfull()) {
         buffer_pool_manager_->unpin_page(node->get_page_id(), true);
         return false;
     }
@@ -423,20 +1352,37 @@ bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node,
     int node_idx = parent->find_child(node);
     int neighbor_idx = (node_idx > 0) ? node_idx - 1 : node_idx + 1;
     IxNodeHandle *neighbor = fetch_node(parent->value_at(neighbor_idx));
+    // 兄弟结点不在下降路径上，父结点的写锁保证没有其他写者同时修改它，读者可能仍在读
+    Page *neighbor_page = neighbor->page;
+    neighbor_page->wlatch();
+
+    // 叶子按键值对数量判断；内部结点在合并后放得下时合并，否则重分配
+    bool redistribute_pairs;
+    if (node->is_leaf_page()) {
+        redistribute_pairs = node->get_size() + neighbor->get_size() >= node->get_min_size() * 2;
+    } else {
+        IxNodeHandle *left = node_idx < neighbor_idx ? node : neighbor;
+        IxNodeHandle *right = node_idx < neighbor_idx ? neighbor : node;
+        IxSeparators seps = concat_separators(left, right, parent, std::max(node_idx, neighbor_idx));
+        redistribute_pairs =
+            IxNodeHandle::separators_size(file_hdr_, seps, 0, seps.size()) > node->get_internal_capacity();
+    }
 
     bool result = false;
-    if (node->get_size() + neighbor->get_size() >= node->get_min_size() * 2) {
+    if (redistribute_pairs) {
         redistribute(neighbor, node, parent, node_idx);
         result = false;
     } else {
         bool delete_parent = coalesce(&neighbor, &node, &parent, node_idx, transaction, root_is_latched);
         if (delete_parent) {
+            neighbor_page->wunlatch();
             buffer_pool_manager_->unpin_page(neighbor->get_page_id(), true);
             buffer_pool_manager_->unpin_page(node->get_page_id(), true);
             return coalesce_or_redistribute(parent, transaction, root_is_latched);
         }
         result = false;
     }
+    neighbor_page->wunlatch();
     buffer_pool_manager_->unpin_page(neighbor->get_page_id(), true);
     buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
     buffer_pool_manager_->unpin_page(node->get_page_id(), true);
@@ -471,6 +1417,7 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
  * @brief 重新分配node和兄弟结点neighbor_node的键值对
  * Redistribute key & value pairs from one page to its sibling page. If index == 0, move sibling page's first key
  * & value pair into end of input "node", otherwise move sibling page's last key & value pair into head of input "node".
+ * 内部结点拼接两个结点的分隔key后重新选择分裂位置，使两边的字节数接近
  *
  * @param neighbor_node sibling page of input "node"
  * @param node input from method coalesceOrRedistribute()
@@ -479,32 +1426,64 @@ bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
  * @note node是之前刚被删除过一个key的结点
  * index=0，则neighbor是node后继结点，表示：node(left)      neighbor(right)
  * index>0，则neighbor是node前驱结点，表示：neighbor(left)  node(right)
- * 注意更新parent结点的相关kv对
+ * 注意更新parent结点中两者之间的分隔key。新的分隔key可能更长，parent放不下时不做调整，node保持不足半满
  */
 void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, 
     IxNodeHandle *node, IxNodeHandle *parent, int index) {
+    if (!node->is_leaf_page()) {
+        IxNodeHandle *left = index == 0 ? node : neighbor_node;
+        IxNodeHandle *right = index == 0 ? neighbor_node : node;
+        int right_idx = index == 0 ? 1 : index;
+        int left_size = left->get_size();
+        IxSeparators seps = concat_separators(left, right, parent, right_idx);
+        IxSeparators parent_seps;
+        parent->get_separators(&parent_seps);
+        int mid = IxNodeHandle::choose_split(file_hdr_, seps, 0, seps.size(), [&](size_t mid) {
+            parent_seps[right_idx].key = seps[mid].key;
+            return static_cast<int>(mid) != left_size &&
+                   IxNodeHandle::separators_size(file_hdr_, parent_seps, 0, parent_seps.size()) <=
+                       parent->get_internal_capacity();
+        });
+        if (mid < 0) {
+            return;
+        }
+        parent_seps[right_idx].key = seps[mid].key;
+        parent->set_separators(parent_seps);
+        left->set_separators(seps, 0, mid);
+        right->set_separators(seps, mid, seps.size());
+        // 移到另一个结点的孩子更新父结点指针
+        for (int i = 0; i < left_size - mid; ++i) {
+            maintain_child(right, i);
+        }
+        for (int i = left_size; i < mid; ++i) {
+            maintain_child(left, i);
+        }
+        return;
+    }
     if (index == 0) {
         // neighbor is right sibling
+        std::string separator =
+            IxNodeHandle::make_separator(file_hdr_, neighbor_node->get_key(0), neighbor_node->get_key(1));
+        if (!replace_separator(parent, 1, separator)) {
+            return;
+        }
         char tmp_key[IX_MAX_COL_LEN];
         memcpy(tmp_key, neighbor_node->get_key(0), file_hdr_->col_tot_len_);
         Rid tmp_rid = *neighbor_node->get_rid(0);
         neighbor_node->erase_pair(0);
         node->insert_pair(node->get_size(), tmp_key, tmp_rid);
-        if (!node->is_leaf_page()) {
-            maintain_child(node, node->get_size() - 1);
-        }
-        parent->set_key(index + 1, neighbor_node->get_key(0));
     } else {
         int move_idx = neighbor_node->get_size() - 1;
+        std::string separator = IxNodeHandle::make_separator(file_hdr_, neighbor_node->get_key(move_idx - 1),
+                                                             neighbor_node->get_key(move_idx));
+        if (!replace_separator(parent, index, separator)) {
+            return;
+        }
         char tmp_key[IX_MAX_COL_LEN];
         memcpy(tmp_key, neighbor_node->get_key(move_idx), file_hdr_->col_tot_len_);
         Rid tmp_rid = *neighbor_node->get_rid(move_idx);
         neighbor_node->erase_pair(move_idx);
         node->insert_pair(0, tmp_key, tmp_rid);
-        if (!node->is_leaf_page()) {
-            maintain_child(node, 0);
-        }
-        parent->set_key(index, node->get_key(0));
     }
 }
 
@@ -524,6 +1503,7 @@ void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node,
  */
 bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, 
     IxNodeHandle **parent, int index,Transaction *transaction, bool *root_is_latched) {
+    TraceSpan span("btree.coalesce", "page_no", (*node)->get_page_no());
     if (index == 0) {
         std::swap(*neighbor_node, *node);
         index = 1;
@@ -531,17 +1511,23 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
     IxNodeHandle *left = *neighbor_node;
     IxNodeHandle *right = *node;
     int left_origin = left->get_size();
-    left->insert_pairs(left_origin, right->get_key(0), right->get_rid(0), right->get_size());
     if (!left->is_leaf_page()) {
+        // 右结点的第0个孩子以parent中两者之间的分隔key作为分隔key
+        [[maybe_unused]] bool fits = left->set_separators(concat_separators(left, right, *parent, index));
+        assert(fits);
         for (int i = left_origin; i < left->get_size(); ++i) {
             maintain_child(left, i);
         }
     } else {
+        left->insert_pairs(left_origin, right->get_key(0), right->get_rid(0), right->get_size());
         left->set_next_leaf(right->get_next_leaf());
         if (right->get_next_leaf() != IX_NO_PAGE) {
             IxNodeHandle *next = fetch_node(right->get_next_leaf());
+            next->page->wlatch();
             next->set_prev_leaf(left->get_page_no());
+            next->page->wunlatch();
             buffer_pool_manager_->unpin_page(next->get_page_id(), true);
+            delete next;
         }
         if (file_hdr_->last_leaf_ == right->get_page_no()) {
             file_hdr_->last_leaf_ = left->get_page_no();
@@ -550,13 +1536,20 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
             file_hdr_->first_leaf_ = left->get_page_no();
         }
     }
-    (*parent)->erase_pair(index);
+    // 删除分隔key时保留原来的公共前缀，parent一定放得下
+    IxSeparators parent_seps;
+    (*parent)->get_separators(&parent_seps);
+    parent_seps.erase(parent_seps.begin() + index);
+    (*parent)->set_separators(parent_seps, 0, parent_seps.size(), (*parent)->get_prefix_len());
     right->set_size(0);
+    if (transaction != nullptr) {
+        transaction->append_index_deleted_page(right->get_page_no());
+    }
     bool delete_parent;
     if ((*parent)->is_root_page()) {
         delete_parent = (*parent)->get_size() <= 1;
     } else {
-        delete_parent = (*parent)->get_size() < (*parent)->get_min_size();
+        delete_parent = (*parent)->is_underfull();
     }
     return delete_parent;
 }
@@ -572,11 +1565,42 @@ bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node,
  */
 Rid IxIndexHandle::get_rid(const Iid &iid) const {
     IxNodeHandle *node = fetch_node(iid.page_no);
+    node->page->rlatch();
     if (iid.slot_no >= node->get_size()) {
+        node->page->runlatch();
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
         throw IndexEntryNotFoundError();
     }
+    Rid rid = *node->get_rid(iid.slot_no);
+    node->page->runlatch();
     buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
-    return *node->get_rid(iid.slot_no);
+    delete node;
+    return rid;
+}
+
+/**
+ * @brief 读取iid处的索引项：把key复制到key中并返回rid，用于index-only scan直接从叶子结点取出字段值
+ *
+ * @param iid
+ * @param key 输出，长度为col_tot_len_
+ * @return Rid
+ */
+Rid IxIndexHandle::get_entry(const Iid &iid, char *key) const {
+    IxNodeHandle *node = fetch_node(iid.page_no);
+    node->page->rlatch();
+    if (iid.slot_no >= node->get_size()) {
+        node->page->runlatch();
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
+        throw IndexEntryNotFoundError();
+    }
+    memcpy(key, node->get_key(iid.slot_no), file_hdr_->col_tot_len_);
+    Rid rid = *node->get_rid(iid.slot_no);
+    node->page->runlatch();
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    delete node;
+    return rid;
 }
 
 /**
@@ -588,9 +1612,21 @@ Rid IxIndexHandle::get_rid(const Iid &iid) const {
  * 可用*(int *)key转换回去
  */
 Iid IxIndexHandle::lower_bound(const char *key) {
+    // 范围扫描可能经过任何key，先写入全部缓存的修改
+    merge_changes();
     if (is_empty()) {
         return Iid{-1, -1};
     }
+    if (optimistic_read_) {
+        Iid iid;
+        for (int attempt = 0; attempt < IX_OPTIMISTIC_RETRIES; attempt++) {
+            if (optimistic_bound(key, false, &iid)) {
+                return iid;
+            }
+            EngineMetrics::get().index_optimistic_retries.add();
+        }
+        EngineMetrics::get().index_optimistic_fallbacks.add();
+    }
     auto [leaf, root_latched] = find_leaf_page(key, Operation::FIND, nullptr, true);
     if (leaf == nullptr) {
         return Iid{-1, -1};
@@ -599,15 +1635,22 @@ Iid IxIndexHandle::lower_bound(const char *key) {
         int pos = leaf->lower_bound(key);
         if (pos < leaf->get_size()) {
             Iid iid{leaf->get_page_no(), pos};
+            leaf->page->runlatch();
             buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+            delete leaf;
             return iid;
         }
         page_id_t next = leaf->get_next_leaf();
+        leaf->page->runlatch();
         buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        delete leaf;
         if (next == IX_LEAF_HEADER_PAGE || next == IX_NO_PAGE) {
             break;
         }
+        // 向右移动时先释放当前叶子再加锁下一个叶子，避免与向左加锁兄弟结点的写者死锁；
+        // 被合并掉的叶子不会被回收，其next_leaf仍然有效
         leaf = fetch_node(next);
+        leaf->page->rlatch();
     }
     return leaf_end();
 }
@@ -619,9 +1662,20 @@ Iid IxIndexHandle::lower_bound(const char *key) {
  * @return Iid
  */
 Iid IxIndexHandle::upper_bound(const char *key) {
+    merge_changes();
     if (is_empty()) {
         return Iid{-1, -1};
     }
+    if (optimistic_read_) {
+        Iid iid;
+        for (int attempt = 0; attempt < IX_OPTIMISTIC_RETRIES; attempt++) {
+            if (optimistic_bound(key, true, &iid)) {
+                return iid;
+            }
+            EngineMetrics::get().index_optimistic_retries.add();
+        }
+        EngineMetrics::get().index_optimistic_fallbacks.add();
+    }
     auto [leaf, root_latched] = find_leaf_page(key, Operation::FIND, nullptr, true);
     if (leaf == nullptr) {
         return Iid{-1, -1};
@@ -630,15 +1684,22 @@ Iid IxIndexHandle::upper_bound(const char *key) {
         int pos = leaf->upper_bound(key);
         if (pos < leaf->get_size()) {
             Iid iid{leaf->get_page_no(), pos};
+            leaf->page->runlatch();
             buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+            delete leaf;
             return iid;
         }
         page_id_t next = leaf->get_next_leaf();
+        leaf->page->runlatch();
         buffer_pool_manager_->unpin_page(leaf->get_page_id(), false);
+        delete leaf;
         if (next == IX_LEAF_HEADER_PAGE || next == IX_NO_PAGE) {
             break;
         }
+        // 向右移动时先释放当前叶子再加锁下一个叶子，避免与向左加锁兄弟结点的写者死锁；
+        // 被合并掉的叶子不会被回收，其next_leaf仍然有效
         leaf = fetch_node(next);
+        leaf->page->rlatch();
     }
     return leaf_end();
 }
@@ -651,8 +1712,11 @@ Iid IxIndexHandle::upper_bound(const char *key) {
  */
 Iid IxIndexHandle::leaf_end() const {
     IxNodeHandle *node = fetch_node(file_hdr_->last_leaf_);
-    Iid iid = {.page_no = file_hdr_->last_leaf_, .slot_no = node->get_size()};
+    node->page->rlatch();
+    Iid iid = {.page_no = node->get_page_no(), .slot_no = node->get_size()};
+    node->page->runlatch();
     buffer_pool_manager_->unpin_page(node->get_page_id(), false);  // unpin it!
+    delete node;
     return iid;
 }
 
@@ -662,7 +1726,8 @@ Iid IxIndexHandle::leaf_end() const {
  *
  * @return Iid
  */
-Iid IxIndexHandle::leaf_begin() const {
+Iid IxIndexHandle::leaf_begin() {
+    merge_changes();
     Iid iid = {.page_no = file_hdr_->first_leaf_, .slot_no = 0};
     return iid;
 }
@@ -671,56 +1736,74 @@ Iid IxIndexHandle::leaf_begin() const {
  * @brief 获取一个指定结点
  *
  * @param page_no
+ * @param access_type 访问模式提示，IxScan沿叶子链表遍历时传入AccessType::Scan
  * @return IxNodeHandle*
  * @note pin the page, remember to unpin it outside!
  */
-IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
-    Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+IxNodeHandle *IxIndexHandle::fetch_node(int page_no, AccessType access_type) const {
+    Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no}, access_type);
     assert(page != nullptr);
     IxNodeHandle *node = new IxNodeHandle(file_hdr_, page);  
     return node;
 }
 
 /**
- * @brief 创建一个新结点
+ * @brief 创建一个新结点，优先复用空闲页链表中的页面，链表为空时才在文件末尾分配新页面
  *
  * @return IxNodeHandle*
- * @note pin the page, remember to unpin it outside!
- * 注意：对于Index的处理是，删除某个页面后，认为该被删除的页面是free_page
- * 而first_free_page实际上就是最新被删除的页面，初始为IX_NO_PAGE
- * 在最开始插入时，一直是create node，那么first_page_no一直没变，一直是IX_NO_PAGE
- * 与Record的处理不同，Record将未插入满的记录页认为是free_page
+ * @note pin the page, remember to unpin it outside! 调用者负责初始化页头中的各个字段
  */
 IxNodeHandle *IxIndexHandle::create_node() {
-    IxNodeHandle *node;
-    file_hdr_->num_pages_++;
+    Page *page = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(hdr_latch_);
+        if (file_hdr_->first_free_page_no_ != IX_NO_PAGE) {
+            page = buffer_pool_manager_->fetch_page(PageId{fd_, file_hdr_->first_free_page_no_});
+            file_hdr_->first_free_page_no_ = reinterpret_cast<IxPageHdr *>(page->get_data())->next_free_page_no;
+        }
+    }
+    if (page != nullptr) {
+        // 加一次写锁使版本号变化，仍在读该页面旧内容的乐观读者校验失败后重新查找
+        page->wlatch();
+        reinterpret_cast<IxPageHdr *>(page->get_data())->next_free_page_no = IX_NO_PAGE;
+        page->wunlatch();
+        return new IxNodeHandle(file_hdr_, page);
+    }
     PageId new_page_id = {.fd = fd_, .page_no = INVALID_PAGE_ID};
-    Page *page = buffer_pool_manager_->new_page(&new_page_id);
-    node = new IxNodeHandle(file_hdr_, page);
-    return node;
+    page = buffer_pool_manager_->new_page(&new_page_id);
+    {
+        std::lock_guard<std::mutex> guard(hdr_latch_);
+        file_hdr_->num_pages_ = std::max(file_hdr_->num_pages_, new_page_id.page_no + 1);
+    }
+    return new IxNodeHandle(file_hdr_, page);
 }
 
 /**
- * @brief 从node开始更新其父节点的第一个key，一直向上更新直到根节点
+ * @brief 按顺序拼接两个相邻内部结点的孩子及分隔key，右结点第0个孩子的分隔key取parent中两者之间的分隔key
  *
- * @param node
+ * @param index right在parent中的rid_idx
  */
-void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
-    IxNodeHandle *curr = node;
-    while (curr->get_parent_page_no() != IX_NO_PAGE) {
-        IxNodeHandle *parent = fetch_node(curr->get_parent_page_no());
-        int rank = parent->find_child(curr);
-        char *parent_key = parent->get_key(rank);
-        char *child_first_key = curr->get_key(0);
-        if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) {
-            assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
-            break;
-        }
-        memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
-        curr = parent;
+IxSeparators IxIndexHandle::concat_separators(IxNodeHandle *left, IxNodeHandle *right, IxNodeHandle *parent,
+                                              int index) {
+    IxSeparators seps;
+    IxSeparators right_seps;
+    left->get_separators(&seps);
+    right->get_separators(&right_seps);
+    right_seps[0].key = parent->separator_at(index);
+    seps.insert(seps.end(), std::make_move_iterator(right_seps.begin()), std::make_move_iterator(right_seps.end()));
+    return seps;
+}
 
-        assert(buffer_pool_manager_->unpin_page(parent->get_page_id(), true));
-    }
+/**
+ * @brief 把parent的第index个分隔key替换为key
+ *
+ * @return parent是否放得下，放不下时parent不变
+ */
+bool IxIndexHandle::replace_separator(IxNodeHandle *parent, int index, const std::string &key) {
+    IxSeparators seps;
+    parent->get_separators(&seps);
+    seps[index].key = key;
+    return parent->set_separators(seps);
 }
 
 /**
@@ -739,16 +1822,26 @@ void IxIndexHandle::erase_leaf(IxNodeHandle *leaf) {
 }
 
 /**
- * @brief 删除node时，更新file_hdr_.num_pages
+ * @brief 把已经从B+树中摘除的结点放入空闲页链表的表头，之后create_node()优先复用。
+ * 链表随文件头在关闭索引时写回，重新打开后仍然可以复用
  *
- * @param node
+ * @param page_no 被释放的结点，调用者已经释放了它的锁和pin
  */
-void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
-    file_hdr_->num_pages_--;
+void IxIndexHandle::free_node(page_id_t page_no) {
+    Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+    std::lock_guard<std::mutex> guard(hdr_latch_);
+    page->wlatch();
+    auto page_hdr = reinterpret_cast<IxPageHdr *>(page->get_data());
+    page_hdr->num_key = 0;
+    page_hdr->next_free_page_no = file_hdr_->first_free_page_no_;
+    page->wunlatch();
+    file_hdr_->first_free_page_no_ = page_no;
+    buffer_pool_manager_->unpin_page(page->get_page_id(), true);
 }
 
 /**
  * @brief 将node的第child_idx个孩子结点的父节点置为node
+ * @note 不对孩子加锁：只有持有孩子原父结点写锁的线程才会修改或沿着parent指针向上读取该字段
  */
 void IxIndexHandle::maintain_child(IxNodeHandle *node, int child_idx) {
     if (!node->is_leaf_page()) {
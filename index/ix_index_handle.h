@@ -1,45 +1,23 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include "ix_change_buffer.h"
 #include "ix_defs.h"
 #include "transaction/transaction.h"
 
 enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
 
-static const bool binary_search = false;
-
-inline int ix_compare(const char *a, const char *b, ColType type, int col_len) {
-    switch (type) {
-        case TYPE_INT: {
-            int ia = *(int *)a;
-            int ib = *(int *)b;
-            return (ia < ib) ? -1 : ((ia > ib) ? 1 : 0);
-        }
-        case TYPE_FLOAT: {
-            float fa = *(float *)a;
-            float fb = *(float *)b;
-            return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
-        }
-        case TYPE_STRING:
-            return memcmp(a, b, col_len);
-        default:
-            throw InternalError("Unexpected data type");
-    }
-}
-
-inline int ix_compare(const char* a, const char* b, const std::vector<ColType>& col_types, const std::vector<int>& col_lens) {
-    int offset = 0;
-    for(size_t i = 0; i < col_types.size(); ++i) {
-        int res = ix_compare(a + offset, b + offset, col_types[i], col_lens[i]);
-        if(res != 0) return res;
-        offset += col_lens[i];
-    }
-    return 0;
-}
-
 /* 管理B+树中的每个节点 */
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
+    friend class IxBulkLoader;
 
    private:
     const IxFileHdr *file_hdr;      // 节点所在文件的头部信息
@@ -48,6 +26,20 @@ class IxNodeHandle {
     char *keys;                     // page->data的第二部分，指针指向首地址，长度为file_hdr->keys_size，每个key的长度为file_hdr->col_len
     Rid *rids;                      // page->data的第三部分，指针指向首地址
 
+    template <bool upper>
+    int search(const char *target) const;
+
+    // 内部结点的布局，读取时把长度和偏移截断在页面内，乐观读读到修改中的结点时不会越界，版本校验失败后丢弃结果
+    IxInternalHdr *internal_hdr() const { return reinterpret_cast<IxInternalHdr *>(keys); }
+
+    const char *internal_prefix() const { return keys + sizeof(IxInternalHdr); }
+
+    const IxInternalSlot *internal_slots(int *num_slots) const;
+
+    const char *suffix_at(const IxInternalSlot &slot, int prefix_len, int *len) const;
+
+    int compare_suffix(const char *key, const IxInternalSlot &slot, int prefix_len) const;
+
    public:
     IxNodeHandle() = default;
 
@@ -65,10 +57,23 @@ class IxNodeHandle {
 
     int get_min_size() { return get_max_size() / 2; }
 
-    int key_at(int i) { return *(int *)get_key(i); }
+    // 测试用：叶子结点的第i个key，或内部结点的第i个分隔key补0后的前4个字节
+    int key_at(int i) {
+        if (is_leaf_page()) {
+            return *(int *)get_key(i);
+        }
+        std::string key = separator_at(i);
+        int value = 0;
+        memcpy(&value, key.data(), std::min(key.size(), sizeof(int)));
+        return value;
+    }
 
-    /* 得到第i个孩子结点的page_no */
-    page_id_t value_at(int i) { return get_rid(i)->page_no; }
+    /* 得到内部结点第i个孩子结点的page_no */
+    page_id_t value_at(int i) const {
+        int num_slots;
+        const IxInternalSlot *slots = internal_slots(&num_slots);
+        return i < num_slots ? slots[i].child : INVALID_PAGE_ID;
+    }
 
     page_id_t get_page_no() { return page->get_page_id().page_no; }
 
@@ -104,8 +109,37 @@ class IxNodeHandle {
 
     void insert_pairs(int pos, const char *key, const Rid *rid, int n);
 
+    int child_index(const char *key) const;
+
     page_id_t internal_lookup(const char *key);
 
+    // 内部结点：分隔key的公共前缀长度、占用的字节数和是否不足半满
+    int get_prefix_len() const { return std::min<int>(internal_hdr()->prefix_len, file_hdr->col_tot_len_); }
+
+    int get_used_bytes() const { return internal_hdr()->used_len; }
+
+    int get_internal_capacity() const { return internal_capacity(file_hdr); }
+
+    bool is_underfull();
+
+    std::string separator_at(int i) const;
+
+    void get_separators(IxSeparators *seps) const;
+
+    bool set_separators(const IxSeparators &seps, size_t begin, size_t end, int max_prefix_len = IX_MAX_COL_LEN);
+
+    bool set_separators(const IxSeparators &seps) { return set_separators(seps, 0, seps.size()); }
+
+    static int internal_capacity(const IxFileHdr *file_hdr);
+
+    static int separators_size(const IxFileHdr *file_hdr, const IxSeparators &seps, size_t begin, size_t end,
+                               int max_prefix_len = IX_MAX_COL_LEN, int *prefix_len = nullptr);
+
+    static int choose_split(const IxFileHdr *file_hdr, const IxSeparators &seps, size_t begin, size_t end,
+                            const std::function<bool(size_t)> &accept = nullptr);
+
+    static std::string make_separator(const IxFileHdr *file_hdr, const char *left, const char *right);
+
     bool leaf_lookup(const char *key, Rid **value);
 
     int insert(const char *key, const Rid &value);
@@ -125,8 +159,7 @@ class IxNodeHandle {
     page_id_t remove_and_return_only_child() {
         assert(get_size() == 1);
         page_id_t child_page_no = value_at(0);
-        erase_pair(0);
-        assert(get_size() == 0);
+        set_size(0);
         return child_page_no;
     }
 
@@ -138,7 +171,7 @@ class IxNodeHandle {
     int find_child(IxNodeHandle *child) {
         int rid_idx;
         for (rid_idx = 0; rid_idx < page_hdr->num_key; rid_idx++) {
-            if (get_rid(rid_idx)->page_no == child->get_page_no()) {
+            if (value_at(rid_idx) == child->get_page_no()) {
                 break;
             }
         }
@@ -151,33 +184,65 @@ class IxNodeHandle {
 class IxIndexHandle {
     friend class IxScan;
     friend class IxManager;
+    friend class IxBulkLoader;
 
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     int fd_;                                    // 存储B+树的文件
     IxFileHdr* file_hdr_;                       // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
-    std::mutex root_latch_;
+    std::shared_mutex root_latch_;              // 保护file_hdr_->root_page_，下降到根结点安全之后释放
+    std::mutex hdr_latch_;                      // 保护file_hdr_->num_pages_和空闲页链表，不同子树上的分裂可能同时创建结点
+    bool optimistic_read_ = IX_OPTIMISTIC_READ; // 查找是否使用乐观读
+    std::unique_ptr<IxChangeBuffer> change_buffer_; // 叶子不在缓冲池中时缓存插入和删除，为空时直接修改叶子
+    size_t change_buffer_capacity_ = 0;         // 缓存的修改达到该数量时由写入者全部写入索引
+    std::atomic<size_t> num_buffered_{0};       // change_buffer_中的修改数量，查找时不加锁判断是否需要先写入
+    std::mutex change_latch_;                   // 保护change_buffer_
+    std::shared_mutex merge_latch_;             // 直接修改叶子时共享持有，把缓存的修改写入索引时独占持有，
+                                                // 保证同一个key上的修改按发生的顺序写入叶子
 
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
 
+    /**
+     * @description: 设置该索引的查找(get_value、lower_bound、upper_bound)是否使用乐观读。
+     *               乐观读不对结点加锁，读完后校验结点版本号，冲突时重新查找，适合读多写少的索引
+     * @param {bool} optimistic_read 是否开启
+     */
+    void set_optimistic_read(bool optimistic_read) { optimistic_read_ = optimistic_read; }
+
+    void enable_change_buffer(size_t capacity);
+
+    size_t merge_changes();
+
+    size_t get_num_buffered() const { return num_buffered_.load(); }
+
     // for search
     bool get_value(const char *key, std::vector<Rid> *result, Transaction *transaction);
 
+    int get_values_batch(const std::vector<const char *> &keys, std::vector<std::vector<Rid>> *results,
+                         Transaction *transaction);
+
     std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
                                                  bool find_first = false);
 
     // for insert
     page_id_t insert_entry(const char *key, const Rid &value, Transaction *transaction);
 
+    void insert_entries(const std::vector<const char *> &keys, const std::vector<Rid> &rids, Transaction *transaction);
+
     IxNodeHandle *split(IxNodeHandle *node);
 
-    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
+    IxNodeHandle *split_internal(IxNodeHandle *node, const IxSeparators &seps, int mid);
+
+    void insert_into_parent(IxNodeHandle *old_node, const std::string &key, IxNodeHandle *new_node,
+                            Transaction *transaction);
 
     // for delete
     bool delete_entry(const char *key, Transaction *transaction);
 
+    int delete_entries(const std::vector<const char *> &keys, Transaction *transaction);
+
     bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
                                 bool *root_is_latched = nullptr);
     bool adjust_root(IxNodeHandle *old_root_node);
@@ -193,7 +258,7 @@ class IxIndexHandle {
 
     Iid leaf_end() const;
 
-    Iid leaf_begin() const;
+    Iid leaf_begin();
 
    private:
     // 辅助函数
@@ -202,19 +267,66 @@ class IxIndexHandle {
     bool is_empty() const { return file_hdr_->root_page_ == IX_NO_PAGE; }
 
     // for get/create node
-    IxNodeHandle *fetch_node(int page_no) const;
+    IxNodeHandle *fetch_node(int page_no, AccessType access_type = AccessType::Normal) const;
 
     IxNodeHandle *create_node();
 
     // for maintain data structure
-    void maintain_parent(IxNodeHandle *node);
+    IxSeparators concat_separators(IxNodeHandle *left, IxNodeHandle *right, IxNodeHandle *parent, int index);
+
+    bool replace_separator(IxNodeHandle *parent, int index, const std::string &key);
 
     void erase_leaf(IxNodeHandle *leaf);
 
-    void release_node_handle(IxNodeHandle &node);
+    void free_node(page_id_t page_no);
+
+    // for latch crabbing
+    bool is_safe(IxNodeHandle *node, const char *key, Operation operation);
+
+    void release_ancestors(Transaction *transaction);
+
+    void release_latched_pages(Transaction *transaction, bool root_is_latched);
+
+    // for insert and delete
+    page_id_t insert_into_leaf(IxNodeHandle *leaf, bool root_latched, const char *key, const Rid &value,
+                               Transaction *transaction);
+
+    bool delete_from_leaf(IxNodeHandle *leaf, bool root_latched, const char *key, Transaction *transaction);
+
+    // for batched insert and delete
+    bool fits_in_leaf(IxNodeHandle *leaf, const char *key, Operation operation);
+
+    int apply_entries(const std::vector<const char *> &keys, const std::vector<Rid> *rids, Operation operation,
+                      Transaction *transaction);
+
+    // for change buffer
+    bool leaf_resident(const char *key);
+
+    bool buffer_change(const char *key, const Rid *rid);
+
+    void merge_keys(const std::vector<const char *> &keys);
+
+    void merge_if_full();
+
+    size_t apply_batch(const IxChangeBuffer::Batch &batch);
+
+    page_id_t insert_entry_now(const char *key, const Rid &value, Transaction *transaction);
+
+    bool delete_entry_now(const char *key, Transaction *transaction);
+
+    // for optimistic read
+    bool optimistic_find_leaf(const char *key, IxNodeHandle **leaf, uint64_t *version) const;
+
+    int optimistic_get_value(const char *key, std::vector<Rid> *result) const;
+
+    bool optimistic_bound(const char *key, bool upper, Iid *iid) const;
+
+    void release_node(IxNodeHandle *node) const;
 
     void maintain_child(IxNodeHandle *node, int child_idx);
 
     // for index test
     Rid get_rid(const Iid &iid) const;
+
+    Rid get_entry(const Iid &iid, char *key) const;
 };
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "system/sm_meta.h"
 #include "ix_defs.h"
+#include "ix_hash_index.h"
 #include "ix_index_handle.h"
 
 class IxManager {
@@ -65,6 +66,7 @@ class IxManager {
         }
         // 根据 |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE 求得n的最大值btree_order
         // 即 n <= btree_order，那么btree_order就是每个结点最多可插入的键值对数量（实际还多留了一个空位，但其不可插入）
+        // 内部结点使用变长布局，存放去掉公共前缀的最短分隔key，可用字节数与叶子相同(见IxNodeHandle::internal_capacity)
         int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (col_tot_len + sizeof(Rid)) - 1);
         assert(btree_order > 2);
 
@@ -123,6 +125,47 @@ class IxManager {
         disk_manager_->close_file(fd);
     }
 
+    // 创建哈希索引文件：文件头、一个空桶和一个目录页，global depth为0。索引文件名与B+树相同
+    void create_hash_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
+        std::string ix_name = get_index_name(filename, index_cols);
+        std::vector<ColType> col_types;
+        std::vector<int> col_lens;
+        int col_tot_len = 0;
+        for (auto &col : index_cols) {
+            col_types.push_back(col.type);
+            col_lens.push_back(col.len);
+            col_tot_len += col.len;
+        }
+        if (col_tot_len > IX_MAX_COL_LEN) {
+            throw InvalidColLengthError(col_tot_len);
+        }
+        disk_manager_->create_file(ix_name);
+        int fd = disk_manager_->open_file(ix_name);
+
+        IxHashFileHdr fhdr(col_types, col_lens);
+        fhdr.num_pages_ = IX_HASH_INIT_NUM_PAGES;
+        fhdr.dir_pages_.push_back(IX_HASH_INIT_DIR_PAGE);
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        fhdr.serialize(page_buf);
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<IxHashBucketHdr *>(page_buf) = {
+            .local_depth = 0,
+            .hash_bits = 0,
+            .num_entries = 0,
+            .next_overflow = IX_NO_PAGE,
+        };
+        disk_manager_->write_page(fd, IX_HASH_BUCKET_PAGE, page_buf, PAGE_SIZE);
+
+        memset(page_buf, 0, PAGE_SIZE);
+        *reinterpret_cast<page_id_t *>(page_buf) = IX_HASH_BUCKET_PAGE;
+        disk_manager_->write_page(fd, IX_HASH_INIT_DIR_PAGE, page_buf, PAGE_SIZE);
+
+        disk_manager_->close_file(fd);
+    }
+
     void destroy_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         disk_manager_->destroy_file(ix_name);
@@ -134,24 +177,75 @@ class IxManager {
     }
 
     // 注意这里打开文件，创建并返回了index file handle的指针
-    std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<ColMeta>& index_cols) {
-        std::string ix_name = get_index_name(filename, index_cols);
-        int fd = disk_manager_->open_file(ix_name);
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+    /**
+     * @description: 打开B+树索引文件
+     * @param {bool} read_only 只读打开，索引文件整个映射到内存，结点直接从映射中读取，不进入缓冲池
+     */
+    std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<ColMeta>& index_cols,
+                                              bool read_only = false) {
+        return open_btree(get_index_name(filename, index_cols), read_only);
     }
 
-    std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<std::string>& index_cols) {
+    std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<std::string>& index_cols,
+                                              bool read_only = false) {
+        return open_btree(get_index_name(filename, index_cols), read_only);
+    }
+
+    std::unique_ptr<IxHashIndexHandle> open_hash_index(const std::string &filename,
+                                                       const std::vector<ColMeta>& index_cols) {
         std::string ix_name = get_index_name(filename, index_cols);
         int fd = disk_manager_->open_file(ix_name);
-        return std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        return std::make_unique<IxHashIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
     }
 
-    void close_index(const IxIndexHandle *ih) {
+    void close_index(IxIndexHandle *ih) {
+        // 只读映射的索引没有被修改过，不需要写回
+        if (buffer_pool_manager_->is_mapped(ih->fd_)) {
+            buffer_pool_manager_->unmap_file(ih->fd_);
+            disk_manager_->close_file(ih->fd_);
+            return;
+        }
+        // 缓存的修改不写入磁盘，关闭之前写入索引
+        ih->merge_changes();
         char* data = new char[ih->file_hdr_->tot_len_];
         ih->file_hdr_->serialize(data);
         disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, data, ih->file_hdr_->tot_len_);
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->flush_all_pages(ih->fd_);
+        evict_pages(ih->fd_, ih->file_hdr_->num_pages_);
+        disk_manager_->close_file(ih->fd_);
+    }
+
+    void close_index(IxHashIndexHandle *ih) {
+        ih->flush();
+        buffer_pool_manager_->flush_all_pages(ih->fd_);
+        evict_pages(ih->fd_, ih->file_hdr_.num_pages_);
         disk_manager_->close_file(ih->fd_);
     }
+
+   private:
+    std::unique_ptr<IxIndexHandle> open_btree(const std::string &ix_name, bool read_only) {
+        int fd = disk_manager_->open_file(ix_name);
+        // 结点格式不同的索引文件不能按当前格式读取，需要删除后重建
+        char hdr[sizeof(int) * 2];
+        disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, hdr, sizeof(hdr));
+        int version = IxFileHdr::read_format_version(hdr);
+        if (version != IX_FILE_FORMAT_VERSION) {
+            disk_manager_->close_file(fd);
+            throw IndexFormatError(ix_name, version, IX_FILE_FORMAT_VERSION);
+        }
+        auto ih = std::make_unique<IxIndexHandle>(disk_manager_, buffer_pool_manager_, fd);
+        if (read_only) {
+            // 索引按key随机访问结点，关闭内核的顺序预读
+            buffer_pool_manager_->map_file(fd, MappedFile::Advice::RANDOM);
+        }
+        return ih;
+    }
+
+    // 关闭后fd可能分配给重建的同名索引文件，不能让它读到缓冲池中旧文件的页面。仍被其他句柄pin住的页面保留
+    void evict_pages(int fd, int num_pages) {
+        for (int page_no = 0; page_no < num_pages; page_no++) {
+            buffer_pool_manager_->delete_page(PageId{fd, page_no});
+        }
+    }
 };
\ No newline at end of file
@@ -1,23 +1,148 @@
 #include "ix_scan.h"
 
+IxScan::IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm, bool reverse,
+               size_t limit)
+    : ih_(ih), iid_(lower), end_(upper), begin_(lower), bpm_(bpm), reverse_(reverse), limit_(limit) {
+    if (reverse_) {
+        if (lower == upper) {
+            reverse_end_ = true;
+        } else {
+            // upper不属于扫描区间，逆序扫描从它的前一项开始
+            iid_ = upper;
+            prev();
+        }
+    }
+}
+
 /**
  * @brief 
  * @todo 加上读锁（需要使用缓冲池得到page）
  */
 void IxScan::next() {
     assert(!is_end());
-    IxNodeHandle *node = ih_->fetch_node(iid_.page_no);
+    scanned_++;
+    PageAccessCounter::local().rows++;
+    if (reverse_) {
+        if (iid_ == begin_) {
+            reverse_end_ = true;
+        } else {
+            prev();
+        }
+        return;
+    }
+    IxNodeHandle *node = ih_->fetch_node(iid_.page_no, AccessType::Scan);
+    node->page->rlatch();
     assert(node->is_leaf_page());
     assert(iid_.slot_no < node->get_size());
     // increment slot no
     iid_.slot_no++;
+    page_id_t leaf_page_no = iid_.page_no;
+    page_id_t parent_page_no = node->get_parent_page_no();
+    bool leaf_changed = false;
     if (iid_.page_no != ih_->file_hdr_->last_leaf_ && iid_.slot_no == node->get_size()) {
         // go to next leaf
         iid_.slot_no = 0;
         iid_.page_no = node->get_next_leaf();
+        leaf_changed = true;
+    }
+    node->page->runlatch();
+    bpm_->unpin_page(node->get_page_id(), false);
+    delete node;
+    // 释放叶子的读锁之后再读父结点，持有孩子的锁向上加锁会与自上而下加锁的写者死锁
+    if (leaf_changed) {
+        if (leaves_ahead_ == 0) {
+            read_ahead(leaf_page_no, parent_page_no);
+        }
+        if (leaves_ahead_ > 0) {
+            leaves_ahead_--;
+        }
     }
 }
 
 Rid IxScan::rid() const {
     return ih_->get_rid(iid_);
-}
\ No newline at end of file
+}
+
+Rid IxScan::entry(char *key) const {
+    return ih_->get_entry(iid_, key);
+}
+
+/**
+ * @brief 逆序扫描时把iid_移动到前一个索引项，当前叶子已经到头时沿prev_leaf进入前一个叶子的最后一项
+ */
+void IxScan::prev() {
+    if (iid_.slot_no > 0) {
+        iid_.slot_no--;
+    } else {
+        IxNodeHandle *node = ih_->fetch_node(iid_.page_no, AccessType::Scan);
+        node->page->rlatch();
+        assert(node->is_leaf_page());
+        page_id_t leaf_page_no = iid_.page_no;
+        page_id_t parent_page_no = node->get_parent_page_no();
+        page_id_t prev_page_no = node->get_prev_leaf();
+        node->page->runlatch();
+        bpm_->unpin_page(node->get_page_id(), false);
+        delete node;
+        // 与next()相同，释放当前叶子的读锁之后再读前一个叶子和父结点
+        if (prev_page_no == IX_LEAF_HEADER_PAGE || prev_page_no == IX_NO_PAGE) {
+            reverse_end_ = true;
+            return;
+        }
+        IxNodeHandle *prev_node = ih_->fetch_node(prev_page_no, AccessType::Scan);
+        prev_node->page->rlatch();
+        iid_ = {.page_no = prev_page_no, .slot_no = prev_node->get_size() - 1};
+        prev_node->page->runlatch();
+        bpm_->unpin_page(prev_node->get_page_id(), false);
+        delete prev_node;
+        if (leaves_ahead_ == 0) {
+            read_ahead(leaf_page_no, parent_page_no);
+        }
+        if (leaves_ahead_ > 0) {
+            leaves_ahead_--;
+        }
+    }
+    // lower可能指向某个叶子的末尾(slot_no == size)，逆序越过它时不会与begin_相等
+    if (iid_.page_no == begin_.page_no && iid_.slot_no < begin_.slot_no) {
+        reverse_end_ = true;
+    }
+}
+/**
+ * @brief 预读leaf之后的叶子：叶子的页号不连续，从父结点中取出leaf右侧的兄弟结点，
+ *        至多READ_AHEAD_PAGES个，且不超过扫描的终点end_所在的叶子；
+ *        逆序扫描时预读leaf左侧的兄弟结点，不超过begin_所在的叶子
+ * @param leaf_page_no 刚离开的叶子结点
+ * @param parent_page_no 该叶子加锁时读到的父结点
+ */
+void IxScan::read_ahead(page_id_t leaf_page_no, page_id_t parent_page_no) {
+    if (parent_page_no == IX_NO_PAGE) {
+        return;
+    }
+    IxNodeHandle *parent = ih_->fetch_node(parent_page_no);
+    parent->page->rlatch();
+    // 释放叶子的锁之后parent指针可能已经过期(结点可能已被释放并作为叶子重新使用)，找不到leaf则不预读
+    int rank = 0;
+    int size = parent->is_leaf_page() ? 0 : parent->get_size();
+    while (rank < size && parent->value_at(rank) != leaf_page_no) {
+        rank++;
+    }
+    std::vector<page_id_t> leaves;
+    int step = reverse_ ? -1 : 1;
+    page_id_t stop_page_no = reverse_ ? begin_.page_no : end_.page_no;
+    if (rank < size) {
+        for (int i = rank + step; i >= 0 && i < size && static_cast<int>(leaves.size()) < READ_AHEAD_PAGES;
+             i += step) {
+            page_id_t page_no = parent->value_at(i);
+            leaves.push_back(page_no);
+            if (page_no == stop_page_no) {
+                break;
+            }
+        }
+    }
+    parent->page->runlatch();
+    bpm_->unpin_page(parent->get_page_id(), false);
+    delete parent;
+    if (!leaves.empty()) {
+        bpm_->prefetch_pages(ih_->fd_, leaves);
+    }
+    leaves_ahead_ = static_cast<int>(leaves.size());
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <limits>
+
 #include "ix_defs.h"
 #include "ix_index_handle.h"
 
@@ -7,22 +9,45 @@
 
 // 用于遍历叶子结点
 // 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
+// 扫描区间为[lower, upper)，reverse为true时从upper的前一项开始沿prev_leaf逆序遍历到lower
+// limit为最多返回的索引项个数，用于LIMIT提前结束扫描
 // TODO：对page遍历时，要加上读锁
 class IxScan : public RecScan {
     const IxIndexHandle *ih_;
-    Iid iid_;  // 初始为lower（用于遍历的指针）
+    Iid iid_;  // 初始为lower（用于遍历的指针），逆序扫描时初始为upper的前一项
     Iid end_;  // 初始为upper
+    Iid begin_;  // 初始为lower，逆序扫描的终点
     BufferPoolManager *bpm_;
+    bool reverse_;
+    bool reverse_end_ = false;  // 逆序扫描已经越过begin_
+    size_t limit_;
+    size_t scanned_ = 0;  // 已经调用next()的次数
+    int leaves_ahead_ = 0;  // 当前叶子之后(逆序时为之前)已经预读的叶子个数
 
    public:
-    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm)
-        : ih_(ih), iid_(lower), end_(upper), bpm_(bpm) {}
+    static constexpr size_t NO_LIMIT = std::numeric_limits<size_t>::max();
+
+    IxScan(const IxIndexHandle *ih, const Iid &lower, const Iid &upper, BufferPoolManager *bpm,
+           bool reverse = false, size_t limit = NO_LIMIT);
 
     void next() override;
 
-    bool is_end() const override { return iid_ == end_; }
+    bool is_end() const override {
+        if (scanned_ >= limit_) {
+            return true;
+        }
+        return reverse_ ? reverse_end_ : iid_ == end_;
+    }
 
     Rid rid() const override;
 
+    // 当前索引项的rid，同时把key复制到key中
+    Rid entry(char *key) const;
+
     const Iid &iid() const { return iid_; }
+
+   private:
+    void prev();
+
+    void read_ahead(page_id_t leaf_page_no, page_id_t parent_page_no);
 };
\ No newline at end of file
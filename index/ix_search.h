@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IX_SEARCH_X86
+#endif
+
+/*
+结点内单字段TYPE_INT/TYPE_FLOAT key的查找内核
+keys为结点中连续存放的有序key数组，查找分两步：
+1. 无分支二分查找，把答案所在的区间缩小到不超过IX_SEARCH_WINDOW个key，循环中没有难以预测的条件跳转
+2. 用SIMD比较统计窗口内满足谓词的key数量，即为答案在窗口内的偏移
+lower_bound的谓词为key < target，upper_bound的谓词为key <= target，有序数组中满足谓词的key恰好是一个前缀
+AVX2内核通过target属性单独编译，调用前需由ix_cpu_has_avx2()确认CPU支持
+*/
+
+constexpr int IX_SEARCH_WINDOW = 32;    // 二分查找结束时剩余的窗口大小，窗口内使用SIMD计数
+
+/**
+ * @description: 当前CPU是否支持AVX2，只在第一次调用时检测
+ */
+inline bool ix_cpu_has_avx2() {
+#ifdef IX_SEARCH_X86
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+template <typename T, bool upper>
+inline bool ix_search_pred(T key, T target) {
+    return upper ? key <= target : key < target;
+}
+
+/**
+ * @description: 无分支二分查找，返回答案所在窗口的起始下标，答案位于[start, start + len]
+ * @param {int*} len 输入数组长度，返回窗口长度，不超过IX_SEARCH_WINDOW
+ */
+template <typename T, bool upper>
+inline int ix_search_narrow(const T *keys, int *len, T target) {
+    int base = 0;
+    int n = *len;
+    while (n > IX_SEARCH_WINDOW) {
+        int half = n / 2;
+        // 编译为条件传送，base[half - 1]满足谓词时答案一定在后半部分
+        base = ix_search_pred<T, upper>(keys[base + half - 1], target) ? base + half : base;
+        n -= half;
+    }
+    *len = n;
+    return base;
+}
+
+template <typename T, bool upper>
+inline int ix_search_count_scalar(const T *keys, int n, T target) {
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        count += ix_search_pred<T, upper>(keys[i], target);
+    }
+    return count;
+}
+
+#ifdef IX_SEARCH_X86
+
+template <bool upper>
+inline int ix_search_count_sse(const int32_t *keys, int n, int32_t target) {
+    __m128i t = _mm_set1_epi32(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+        // upper统计key > target的数量再取反，SSE没有<=比较
+        __m128i m = upper ? _mm_cmpgt_epi32(k, t) : _mm_cmplt_epi32(k, t);
+        int bits = __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m)));
+        count += upper ? 4 - bits : bits;
+    }
+    return count + ix_search_count_scalar<int32_t, upper>(keys + i, n - i, target);
+}
+
+template <bool upper>
+inline int ix_search_count_sse(const float *keys, int n, float target) {
+    __m128 t = _mm_set1_ps(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 k = _mm_loadu_ps(keys + i);
+        __m128 m = upper ? _mm_cmple_ps(k, t) : _mm_cmplt_ps(k, t);
+        count += __builtin_popcount(_mm_movemask_ps(m));
+    }
+    return count + ix_search_count_scalar<float, upper>(keys + i, n - i, target);
+}
+
+template <bool upper>
+__attribute__((target("avx2"))) inline int ix_search_count_avx2(const int32_t *keys, int n, int32_t target) {
+    __m256i t = _mm256_set1_epi32(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        __m256i m = upper ? _mm256_cmpgt_epi32(k, t) : _mm256_cmpgt_epi32(t, k);
+        int bits = __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m)));
+        count += upper ? 8 - bits : bits;
+    }
+    return count + ix_search_count_sse<upper>(keys + i, n - i, target);
+}
+
+template <bool upper>
+__attribute__((target("avx2"))) inline int ix_search_count_avx2(const float *keys, int n, float target) {
+    __m256 t = _mm256_set1_ps(target);
+    int count = 0;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 k = _mm256_loadu_ps(keys + i);
+        __m256 m = upper ? _mm256_cmp_ps(k, t, _CMP_LE_OQ) : _mm256_cmp_ps(k, t, _CMP_LT_OQ);
+        count += __builtin_popcount(_mm256_movemask_ps(m));
+    }
+    return count + ix_search_count_sse<upper>(keys + i, n - i, target);
+}
+
+#endif
+
+/**
+ * @description: 在有序数组keys[0,n)中查找第一个>=target(lower)或>target(upper)的下标
+ * @return {int} 下标，范围为[0,n]
+ * @param {T*} keys 有序key数组，T为int32_t或float
+ * @param {int} n key的数量
+ * @param {T} target 目标key
+ * @param {bool} avx2 是否使用AVX2内核，为false时使用SSE内核(非x86平台使用标量计数)
+ */
+template <typename T, bool upper>
+inline int ix_search_keys(const T *keys, int n, T target, bool avx2) {
+    int len = n;
+    int base = ix_search_narrow<T, upper>(keys, &len, target);
+#ifdef IX_SEARCH_X86
+    if (avx2) {
+        return base + ix_search_count_avx2<upper>(keys + base, len, target);
+    }
+    return base + ix_search_count_sse<upper>(keys + base, len, target);
+#else
+    return base + ix_search_count_scalar<T, upper>(keys + base, len, target);
+#endif
+}
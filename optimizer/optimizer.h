@@ -28,9 +28,26 @@ class Optimizer {
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowTables>(query->parse)) {
             // show tables;
             return std::make_shared<OtherPlan>(T_ShowTable, std::string());
+        } else if (auto x = std::dynamic_pointer_cast<ast::ShowStats>(query->parse)) {
+            // show stats;
+            return std::make_shared<OtherPlan>(T_ShowStats, std::string());
         } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(query->parse)) {
             // desc table;
             return std::make_shared<OtherPlan>(T_DescTable, x->tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<ast::AnalyzeStmt>(query->parse)) {
+            // analyze table;
+            return std::make_shared<OtherPlan>(T_Analyze, x->tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<ast::VacuumStmt>(query->parse)) {
+            // vacuum table;
+            return std::make_shared<OtherPlan>(T_Vacuum, x->tab_name);
+        } else if (auto x = std::dynamic_pointer_cast<ast::ExplainStmt>(query->parse)) {
+            // explain [analyze] dml; 按被解释的语句生成计划
+            auto inner = std::make_shared<Query>(*query);
+            inner->parse = x->stmt;
+            return std::make_shared<ExplainPlan>(T_Explain, planner_->do_planner(inner, context), x->analyze);
+        } else if (auto x = std::dynamic_pointer_cast<ast::CopyStmt>(query->parse)) {
+            // copy table from 'file';
+            return std::make_shared<OtherPlan>(T_Load, x->tab_name, x->file_name);
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnBegin>(query->parse)) {
             // begin;
             return std::make_shared<OtherPlan>(T_Transaction_begin, std::string());
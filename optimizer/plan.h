@@ -13,7 +13,12 @@ typedef enum PlanTag{
     T_Invalid = 1,
     T_Help,
     T_ShowTable,
+    T_ShowStats,
     T_DescTable,
+    T_Analyze,
+    T_Vacuum,
+    T_Explain,
+    T_Load,
     T_CreateTable,
     T_DropTable,
     T_CreateIndex,
@@ -29,7 +34,14 @@ typedef enum PlanTag{
     T_SeqScan,
     T_IndexScan,
     T_NestLoop,
+    T_HashJoin,
+    T_IndexNestLoop,
+    T_MergeJoin,
     T_Sort,
+    T_Limit,
+    T_Aggregate,
+    T_StreamAggregate,
+    T_CountStar,
     T_Projection
 } PlanTag;
 
@@ -49,9 +61,7 @@ class ScanPlan : public Plan
             Plan::tag = tag;
             tab_name_ = std::move(tab_name);
             conds_ = std::move(conds);
-            TabMeta &tab = sm_manager->db_.get_table(tab_name_);
-            cols_ = tab.cols;
-            len_ = cols_.back().offset + cols_.back().len;
+            table_ = &sm_manager->get_table_handle(tab_name_);
             fed_conds_ = conds_;
             index_col_names_ = index_col_names;
         
@@ -59,11 +69,15 @@ class ScanPlan : public Plan
         ~ScanPlan(){}
         // 以下变量同ScanExecutor中的变量
         std::string tab_name_;                     
-        std::vector<ColMeta> cols_;                
+        const TableHandle *table_;                 // 表打开的句柄，计划生成时解析一次
         std::vector<Condition> conds_;             
-        size_t len_;                               
         std::vector<Condition> fed_conds_;
         std::vector<std::string> index_col_names_;
+        int index_id_ = -1;                        // T_IndexScan时index_col_names_对应的索引编号，计划生成的最后解析
+        bool is_desc_ = false;                     // T_IndexScan时按索引逆序扫描，用于ORDER BY ... DESC
+        std::vector<std::string> proj_cols_;       // 上层算子需要的字段，扫描只输出这些字段；为空时输出完整的记录
+        bool index_only_ = false;                  // T_IndexScan时条件和输出字段都在索引key中，只读取索引
+        std::vector<const TableHandle *> partitions_;  // 分区表按条件剪枝后剩下的分区，计划生成的最后解析；不是分区表时为空
     
 };
 
@@ -87,6 +101,9 @@ class JoinPlan : public Plan
         std::vector<Condition> conds_;
         // future TODO: 后续可以支持的连接类型
         JoinType type;
+        // T_IndexNestLoop时右节点为内表的ScanPlan，用内表上的该索引查找
+        std::vector<std::string> index_col_names_;
+        int index_id_ = -1;                         // index_col_names_对应的索引编号
         
 };
 
@@ -108,20 +125,59 @@ class ProjectionPlan : public Plan
 class SortPlan : public Plan
 {
     public:
-        SortPlan(PlanTag tag, std::shared_ptr<Plan> subplan, TabCol sel_col, bool is_desc)
+        SortPlan(PlanTag tag, std::shared_ptr<Plan> subplan, std::vector<TabCol> sel_cols, std::vector<bool> is_desc,
+                 int limit = -1)
         {
             Plan::tag = tag;
             subplan_ = std::move(subplan);
-            sel_col_ = sel_col;
-            is_desc_ = is_desc;
+            sel_cols_ = std::move(sel_cols);
+            is_desc_ = std::move(is_desc);
+            limit_ = limit;
         }
         ~SortPlan(){}
         std::shared_ptr<Plan> subplan_;
-        TabCol sel_col_;
-        bool is_desc_;
+        // 排序键，按优先级从高到低
+        std::vector<TabCol> sel_cols_;
+        // 每个排序键是否降序
+        std::vector<bool> is_desc_;
+        // 只需要排序后的前limit_条记录，-1表示没有LIMIT
+        int limit_;
         
 };
 
+class AggregatePlan : public Plan
+{
+    public:
+        AggregatePlan(PlanTag tag, std::shared_ptr<Plan> subplan, std::vector<TabCol> group_cols,
+                      std::vector<AggExpr> aggs)
+        {
+            Plan::tag = tag;
+            subplan_ = std::move(subplan);
+            group_cols_ = std::move(group_cols);
+            aggs_ = std::move(aggs);
+        }
+        ~AggregatePlan(){}
+        std::shared_ptr<Plan> subplan_;
+        // 分组字段，为空时整个输入是一组
+        std::vector<TabCol> group_cols_;
+        // 聚合函数，输出记录为分组字段后接各个聚合结果
+        std::vector<AggExpr> aggs_;
+};
+
+class LimitPlan : public Plan
+{
+    public:
+        LimitPlan(PlanTag tag, std::shared_ptr<Plan> subplan, int limit)
+        {
+            Plan::tag = tag;
+            subplan_ = std::move(subplan);
+            limit_ = limit;
+        }
+        ~LimitPlan(){}
+        std::shared_ptr<Plan> subplan_;
+        int limit_;
+};
+
 // dml语句，包括insert; delete; update; select语句　
 class DMLPlan : public Plan
 {
@@ -160,19 +216,39 @@ class DDLPlan : public Plan
         std::string tab_name_;
         std::vector<std::string> tab_col_names_;
         std::vector<ColDef> cols_;
+        TableLayout layout_ = TableLayout::ROW;    // CREATE TABLE的页面布局
+        IndexType index_type_ = IndexType::BTREE;  // CREATE INDEX的索引类型
+        PartitionSpec partition_;                  // CREATE TABLE的分区方式
 };
 
-// help; show tables; desc tables; begin; abort; commit; rollback语句对应的plan
+// help; show tables; desc tables; analyze; copy; begin; abort; commit; rollback语句对应的plan
 class OtherPlan : public Plan
 {
     public:
-        OtherPlan(PlanTag tag, std::string tab_name)
+        OtherPlan(PlanTag tag, std::string tab_name, std::string file_name = std::string())
         {
             Plan::tag = tag;
             tab_name_ = std::move(tab_name);            
+            file_name_ = std::move(file_name);
         }
         ~OtherPlan(){}
         std::string tab_name_;
+        std::string file_name_;     // copy导入的文件
+};
+
+// explain [analyze] 语句，subplan_为被解释的语句的计划
+class ExplainPlan : public Plan
+{
+    public:
+        ExplainPlan(PlanTag tag, std::shared_ptr<Plan> subplan, bool analyze)
+        {
+            Plan::tag = tag;
+            subplan_ = std::move(subplan);
+            analyze_ = analyze;
+        }
+        ~ExplainPlan(){}
+        std::shared_ptr<Plan> subplan_;
+        bool analyze_;              // 是否执行语句并统计每个算子的实际行数和耗时
 };
 
 class plannerInfo{
@@ -0,0 +1,220 @@
+#include "plan_cache.h"
+
+#include <cctype>
+
+/**
+ * @description: 规范化语句文本作为缓存的key：字符串常量之外的连续空白合并为一个空格，去掉首尾空白和结尾的分号。
+ *               表名和字段名区分大小写，因此不改变大小写
+ * @return {string} 规范化后的语句文本
+ * @param {string&} sql 客户端发送的语句
+ */
+std::string PlanCache::normalize(const std::string &sql) {
+    std::string res;
+    bool in_string = false;
+    bool pending_space = false;
+    for (char c : sql) {
+        if (c == '\0') {
+            break;
+        }
+        if (!in_string && std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !res.empty();
+            continue;
+        }
+        if (pending_space) {
+            res.push_back(' ');
+            pending_space = false;
+        }
+        if (c == '\'') {
+            in_string = !in_string;
+        }
+        res.push_back(c);
+    }
+    while (!res.empty() && (res.back() == ';' || res.back() == ' ')) {
+        res.pop_back();
+    }
+    return res;
+}
+
+/**
+ * @description: PREPARE name AS stmt语句中stmt的规范化文本，不同连接中以不同名字PREPARE的相同语句共享同一个计划
+ * @return {string} stmt的规范化文本
+ * @param {string&} sql 客户端发送的PREPARE语句
+ */
+std::string PlanCache::prepare_key(const std::string &sql) {
+    std::string key = normalize(sql);
+    size_t pos = 0;
+    // 跳过PREPARE、语句名和AS三个词
+    for (int i = 0; i < 3; i++) {
+        pos = key.find(' ', pos);
+        if (pos == std::string::npos) {
+            return key;
+        }
+        pos++;
+    }
+    return key.substr(pos);
+}
+
+/**
+ * @description: PREPARE一条语句，缓存中已有相同文本的语句时直接复用其计划，否则分析语句并生成参数未绑定的通用计划
+ * @return {shared_ptr<CachedPlan>} 缓存的计划
+ * @param {string&} sql 语句的规范化文本
+ * @param {shared_ptr<ast::TreeNode>} stmt 语句的语法树
+ * @param {Context*} context
+ */
+std::shared_ptr<CachedPlan> PlanCache::prepare(const std::string &sql, std::shared_ptr<ast::TreeNode> stmt,
+                                               Context *context) {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto it = entries_.find(sql);
+    if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        auto entry = *it->second;
+        if (entry->schema_version != sm_manager_->schema_version_) {
+            build(*entry, context);
+        }
+        return entry;
+    }
+    auto entry = std::make_shared<CachedPlan>();
+    entry->sql = sql;
+    entry->stmt = std::move(stmt);
+    build(*entry, context);
+    lru_.push_front(entry);
+    entries_[sql] = lru_.begin();
+    if (lru_.size() > capacity_) {
+        // 被淘汰的计划仍然可以被已经PREPARE了它的连接使用
+        entries_.erase(lru_.back()->sql);
+        lru_.pop_back();
+    }
+    return entry;
+}
+
+/**
+ * @description: EXECUTE一条PREPARE的语句：计划失效时重新生成，然后复制通用计划并绑定参数
+ * @return {shared_ptr<Plan>} 绑定参数后的计划，可以交给Portal执行
+ * @param {shared_ptr<CachedPlan>&} entry PREPARE时得到的缓存的计划
+ * @param {vector<Value>&} args 参数$1..$n的值
+ * @param {Context*} context
+ */
+std::shared_ptr<Plan> PlanCache::execute(const std::shared_ptr<CachedPlan> &entry, const std::vector<Value> &args,
+                                         Context *context) {
+    std::shared_ptr<Plan> plan;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        auto it = entries_.find(entry->sql);
+        if (it != entries_.end() && *it->second == entry) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+        }
+        if (entry->schema_version != sm_manager_->schema_version_) {
+            build(*entry, context);
+        }
+        plan = entry->plan;
+    }
+    if (static_cast<int>(args.size()) != entry->num_params) {
+        throw InvalidParamError("expected " + std::to_string(entry->num_params) + " values, got " +
+                                std::to_string(args.size()));
+    }
+    return bind(plan, args);
+}
+
+size_t PlanCache::size() {
+    std::lock_guard<std::mutex> guard(latch_);
+    return lru_.size();
+}
+
+// 分析语句并生成通用计划，调用者需持有latch_
+void PlanCache::build(CachedPlan &entry, Context *context) {
+    // 先读取版本，分析过程中发生的DDL会使下一次执行再重新生成计划
+    uint64_t version = sm_manager_->schema_version_;
+    std::shared_ptr<Query> query = analyze_->do_analyze(entry.stmt, true);
+    int num_params = query->num_params();
+    entry.plan = optimizer_->plan_query(std::move(query), context);
+    entry.num_params = num_params;
+    entry.schema_version = version;
+}
+
+/**
+ * @description: 复制计划树并把其中的参数替换为实际的值。Portal生成算子时会移走计划中的条件和字段，
+ *               因此没有参数的计划也需要复制，缓存中的通用计划始终保持不变
+ * @return {shared_ptr<Plan>} 复制后的计划
+ * @param {shared_ptr<Plan>&} plan 通用计划
+ * @param {vector<Value>&} args 参数的值
+ */
+std::shared_ptr<Plan> PlanCache::bind(const std::shared_ptr<Plan> &plan, const std::vector<Value> &args) {
+    if (plan == nullptr) {
+        return nullptr;
+    }
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        auto scan = std::make_shared<ScanPlan>(*x);
+        bind_conds(scan->conds_, args);
+        bind_conds(scan->fed_conds_, args);
+        // 生成计划时不知道参数的值，分区表按绑定后的条件重新剪枝
+        if (scan->table_->tab->is_partitioned()) {
+            scan->partitions_ = sm_manager_->get_partitions(*scan->table_->tab, scan->conds_);
+        }
+        return scan;
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        auto join = std::make_shared<JoinPlan>(*x);
+        join->left_ = bind(x->left_, args);
+        join->right_ = bind(x->right_, args);
+        bind_conds(join->conds_, args);
+        return join;
+    } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+        auto projection = std::make_shared<ProjectionPlan>(*x);
+        projection->subplan_ = bind(x->subplan_, args);
+        return projection;
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        auto sort = std::make_shared<SortPlan>(*x);
+        sort->subplan_ = bind(x->subplan_, args);
+        return sort;
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        auto aggregate = std::make_shared<AggregatePlan>(*x);
+        aggregate->subplan_ = bind(x->subplan_, args);
+        return aggregate;
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        auto limit = std::make_shared<LimitPlan>(*x);
+        limit->subplan_ = bind(x->subplan_, args);
+        return limit;
+    } else if (auto x = std::dynamic_pointer_cast<DMLPlan>(plan)) {
+        auto dml = std::make_shared<DMLPlan>(*x);
+        dml->subplan_ = bind(x->subplan_, args);
+        bind_conds(dml->conds_, args);
+        // insert和update的值由算子按字段长度生成raw
+        for (auto &val : dml->values_) {
+            bind_value(val, args, false);
+        }
+        for (auto &set_clause : dml->set_clauses_) {
+            bind_value(set_clause.rhs, args, false);
+        }
+        return dml;
+    }
+    // DDL和其他语句的计划不包含参数，也不会被修改
+    return plan;
+}
+
+void PlanCache::bind_conds(std::vector<Condition> &conds, const std::vector<Value> &args) {
+    for (auto &cond : conds) {
+        if (cond.is_rhs_val) {
+            bind_value(cond.rhs_val, args, true);
+        }
+    }
+}
+
+/**
+ * @description: 把参数替换为实际的值，不是参数的值保持不变
+ * @param {Value&} val 计划中的值
+ * @param {vector<Value>&} args 参数的值
+ * @param {bool} init_raw 是否按参数在分析时分配的raw的长度生成raw，条件中的值需要生成raw
+ */
+void PlanCache::bind_value(Value &val, const std::vector<Value> &args, bool init_raw) {
+    if (val.param < 0) {
+        return;
+    }
+    Value bound = args.at(val.param);
+    if (init_raw) {
+        if (bound.type != val.type) {
+            throw IncompatibleTypeError(coltype2str(val.type), coltype2str(bound.type));
+        }
+        bound.raw.reset();
+        bound.init_raw(val.raw->size);
+    }
+    val = std::move(bound);
+}
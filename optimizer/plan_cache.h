@@ -0,0 +1,61 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "analyze/analyze.h"
+#include "optimizer.h"
+#include "plan.h"
+
+// 计划缓存中的一个预编译语句
+struct CachedPlan {
+    std::string sql;                        // 规范化后的语句文本，缓存的key
+    std::shared_ptr<ast::TreeNode> stmt;    // 语句的语法树，计划失效后据此重新分析
+    int num_params = 0;                     // 参数$1..$n的个数
+    uint64_t schema_version = 0;            // 生成plan时SmManager的schema_version_
+    std::shared_ptr<Plan> plan;             // 参数未绑定的通用计划，执行时复制后绑定参数，本身不会被修改
+};
+
+// 每个连接中PREPARE的语句，语句名 -> 缓存的计划
+using PreparedStmts = std::unordered_map<std::string, std::shared_ptr<CachedPlan>>;
+
+/* 预编译语句的计划缓存，所有连接共享，按规范化后的语句文本查找，超过容量时淘汰最久未使用的计划。
+   DDL和ANALYZE会递增SmManager的schema_version_，执行时发现版本变化就重新分析和生成计划 */
+class PlanCache {
+   private:
+    SmManager *sm_manager_;
+    Analyze *analyze_;
+    Optimizer *optimizer_;
+    size_t capacity_;
+    std::mutex latch_;      // 保护lru_、entries_以及缓存项的重新生成
+    std::list<std::shared_ptr<CachedPlan>> lru_;    // 表头为最近使用的计划
+    std::unordered_map<std::string, std::list<std::shared_ptr<CachedPlan>>::iterator> entries_;
+
+   public:
+    PlanCache(SmManager *sm_manager, Analyze *analyze, Optimizer *optimizer, size_t capacity = PLAN_CACHE_SIZE)
+        : sm_manager_(sm_manager), analyze_(analyze), optimizer_(optimizer), capacity_(capacity) {}
+
+    static std::string normalize(const std::string &sql);
+
+    static std::string prepare_key(const std::string &sql);
+
+    std::shared_ptr<CachedPlan> prepare(const std::string &sql, std::shared_ptr<ast::TreeNode> stmt, Context *context);
+
+    std::shared_ptr<Plan> execute(const std::shared_ptr<CachedPlan> &entry, const std::vector<Value> &args,
+                                  Context *context);
+
+    size_t size();
+
+   private:
+    void build(CachedPlan &entry, Context *context);
+
+    std::shared_ptr<Plan> bind(const std::shared_ptr<Plan> &plan, const std::vector<Value> &args);
+
+    void bind_conds(std::vector<Condition> &conds, const std::vector<Value> &args);
+
+    void bind_value(Value &val, const std::vector<Value> &args, bool init_raw);
+};
@@ -1,6 +1,9 @@
 #include "planner.h"
 
+#include <strings.h>
+
 #include <memory>
+#include <set>
 
 #include "execution/executor_delete.h"
 #include "execution/executor_index_scan.h"
@@ -12,20 +15,58 @@
 #include "index/ix.h"
 #include "record_printer.h"
 
-// 目前的索引匹配规则为：完全匹配索引字段，且全部为单点查询，不会自动调整where条件的顺序
+// 没有统计信息时条件的默认选择率
+static constexpr double EQ_SELECTIVITY = 0.1;
+static constexpr double RANGE_SELECTIVITY = 1.0 / 3;
+static constexpr double NE_SELECTIVITY = 0.9;
+// index nested loop join每条外表记录探测一次索引的代价，以hash join处理一条记录的代价为单位
+static constexpr double INDEX_PROBE_COST = 4.0;
+// 访问路径的代价模型，同样以处理一条记录为单位：顺序读一个页面、随机读一个页面(B+树的一层或一个数据页)，
+// 以及索引扫描为每个Rid取回记录(缓冲池查找、pin/unpin)的额外代价
+static constexpr double SEQ_PAGE_COST = 10.0;
+static constexpr double RANDOM_PAGE_COST = 40.0;
+static constexpr double HEAP_FETCH_COST = 2.0;
+// B+树结点的平均填充率
+static constexpr double INDEX_FILL_FACTOR = 0.7;
+
+/**
+ * @brief 基于代价选择访问路径：对每个索引估计可用条件的选择率和索引扫描的代价，与顺序扫描的代价比较，
+ * 选出代价最小的访问路径
+ *
+ * @param tab_name 表名
+ * @param curr_conds 该表上的条件
+ * @param index_col_names 输出选中的索引包含的全部字段
+ * @return bool 是否使用索引扫描
+ */
 bool Planner::get_index_cols(std::string tab_name, std::vector<Condition> curr_conds, std::vector<std::string>& index_col_names) {
     index_col_names.clear();
-    for(auto& cond: curr_conds) {
-        if(cond.is_rhs_val && cond.op == OP_EQ && cond.lhs_col.tab_name.compare(tab_name) == 0)
-            index_col_names.push_back(cond.lhs_col.col_name);
-    }
     TabMeta& tab = sm_manager_->db_.get_table(tab_name);
-    if(tab.is_index(index_col_names)) return true;
-    return false;
+    double best = seq_scan_cost(tab_name);
+    const IndexMeta *best_index = nullptr;
+    for (auto &index : tab.indexes) {
+        bool usable = false;
+        double sel = index_selectivity(tab_name, index, curr_conds, &usable);
+        if (!usable) {
+            continue;
+        }
+        double cost = index_scan_cost(tab_name, index, sel);
+        if (cost < best || (cost == best && best_index != nullptr && index.col_num < best_index->col_num)) {
+            best = cost;
+            best_index = &index;
+        }
+    }
+    if (best_index == nullptr) {
+        return false;
+    }
+    for (auto &col : best_index->cols) {
+        index_col_names.push_back(col.name);
+    }
+    return true;
 }
 
 /**
- * @brief 表算子条件谓词生成
+ * @brief 表算子条件谓词生成：取出只涉及这个表的条件(字段与常量比较、或者同一表的两个字段比较)，
+ * 它们在扫描中求值，不会留到连接之上
  *
  * @param conds 条件
  * @param tab_names 表名
@@ -38,7 +79,8 @@ std::vector<Condition> pop_conds(std::vector<Condition> &conds, std::string tab_
     std::vector<Condition> solved_conds;
     auto it = conds.begin();
     while (it != conds.end()) {
-        if ((tab_names.compare(it->lhs_col.tab_name) == 0 && it->is_rhs_val) || (it->lhs_col.tab_name.compare(it->rhs_col.tab_name) == 0)) {
+        if (tab_names.compare(it->lhs_col.tab_name) == 0 &&
+            (it->is_rhs_val || it->lhs_col.tab_name.compare(it->rhs_col.tab_name) == 0)) {
             solved_conds.emplace_back(std::move(*it));
             it = conds.erase(it);
         } else {
@@ -48,65 +90,6 @@ std::vector<Condition> pop_conds(std::vector<Condition> &conds, std::string tab_
     return solved_conds;
 }
 
-int push_conds(Condition *cond, std::shared_ptr<Plan> plan)
-{
-    if(auto x = std::dynamic_pointer_cast<ScanPlan>(plan))
-    {
-        if(x->tab_name_.compare(cond->lhs_col.tab_name) == 0) {
-            return 1;
-        } else if(x->tab_name_.compare(cond->rhs_col.tab_name) == 0){
-            return 2;
-        } else {
-            return 0;
-        }
-    }
-    else if(auto x = std::dynamic_pointer_cast<JoinPlan>(plan))
-    {
-        int left_res = push_conds(cond, x->left_);
-        // 条件已经下推到左子节点
-        if(left_res == 3){
-            return 3;
-        }
-        int right_res = push_conds(cond, x->right_);
-        // 条件已经下推到右子节点
-        if(right_res == 3){
-            return 3;
-        }
-        // 左子节点或右子节点有一个没有匹配到条件的列
-        if(left_res == 0 || right_res == 0) {
-            return left_res + right_res;
-        }
-        // 左子节点匹配到条件的右边
-        if(left_res == 2) {
-            // 需要将左右两边的条件变换位置
-            std::map<CompOp, CompOp> swap_op = {
-                {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
-            };
-            std::swap(cond->lhs_col, cond->rhs_col);
-            cond->op = swap_op.at(cond->op);
-        }
-        x->conds_.emplace_back(std::move(*cond));
-        return 3;
-    }
-    return false;
-}
-
-std::shared_ptr<Plan> pop_scan(int *scantbl, std::string table, std::vector<std::string> &joined_tables, 
-                std::vector<std::shared_ptr<Plan>> plans)
-{
-    for (size_t i = 0; i < plans.size(); i++) {
-        auto x = std::dynamic_pointer_cast<ScanPlan>(plans[i]);
-        if(x->tab_name_.compare(table) == 0)
-        {
-            scantbl[i] = 1;
-            joined_tables.emplace_back(x->tab_name_);
-            return plans[i];
-        }
-    }
-    return nullptr;
-}
-
-
 std::shared_ptr<Query> Planner::logical_optimization(std::shared_ptr<Query> query, Context *context)
 {
     
@@ -120,10 +103,19 @@ std::shared_ptr<Plan> Planner::physical_optimization(std::shared_ptr<Query> quer
     std::shared_ptr<Plan> plan = make_one_rel(query);
     
     // 其他物理优化
+    choose_join_method(plan);
 
-    // 处理orderby
+    // 处理group by和聚合函数
+    if (!query->aggs.empty() || !query->group_cols.empty()) {
+        plan = generate_aggregate_plan(query, std::move(plan));
+    }
+
+    // 处理orderby和limit
     plan = generate_sort_plan(query, std::move(plan)); 
 
+    // 扫描只输出上层算子需要的字段
+    push_projection(query, plan);
+
     return plan;
 }
 
@@ -154,96 +146,695 @@ std::shared_ptr<Plan> Planner::make_one_rel(std::shared_ptr<Query> query)
     {
         return table_scan_executors[0];
     }
-    // 获取where条件
-    auto conds = std::move(query->conds);
-    std::shared_ptr<Plan> table_join_executors;
-    
-    int scantbl[tables.size()];
-    for(size_t i = 0; i < tables.size(); i++)
+    // 剩下的条件都是两个表之间的连接条件
+    return make_join_tree(tables, std::move(table_scan_executors), std::move(query->conds));
+}
+
+// 表上是否有恰好由这一个字段构成的索引。索引的key是唯一的，该字段上的等值条件最多匹配一条记录
+static bool is_unique_col(const TabMeta &tab, const std::string &col_name)
+{
+    return std::any_of(tab.indexes.begin(), tab.indexes.end(), [&](const IndexMeta &index) {
+        return index.cols.size() == 1 && index.cols[0].name.compare(col_name) == 0;
+    });
+}
+
+// 字段的统计信息和元数据，表没有收集统计信息时返回nullptr，调用时需持有stats_latch_
+static const ColumnStats *get_col_stats(const TabMeta &tab, const std::string &col_name, const ColMeta **col = nullptr)
+{
+    if (tab.stats == nullptr) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < tab.cols.size() && i < tab.stats->cols.size(); i++) {
+        if (tab.cols[i].name.compare(col_name) == 0) {
+            if (col != nullptr) {
+                *col = &tab.cols[i];
+            }
+            return &tab.stats->cols[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 表的记录数：有统计信息时使用ANALYZE之后增量维护的记录数，否则由页面头中的记录数估计，至少为1
+ */
+double Planner::table_rows(const std::string &tab_name)
+{
+    const TabMeta &tab = sm_manager_->db_.get_table(tab_name);
     {
-        scantbl[i] = -1;
+        std::lock_guard<std::mutex> guard(sm_manager_->stats_latch_);
+        if (tab.stats != nullptr) {
+            return std::max(1.0, static_cast<double>(tab.stats->row_count));
+        }
+    }
+    double rows = 0;
+    for (auto fh : table_files(tab)) {
+        rows += fh->estimate_records(CARDINALITY_SAMPLE_PAGES);
+    }
+    return std::max(1.0, rows);
+}
+
+/**
+ * @brief 表的数据页数，分区表为所有分区的数据页数之和，至少为1
+ */
+double Planner::table_pages(const std::string &tab_name)
+{
+    int pages = 0;
+    for (auto fh : table_files(sm_manager_->db_.get_table(tab_name))) {
+        pages += fh->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
     }
-    // 假设在ast中已经添加了jointree，这里需要修改的逻辑是，先处理jointree，然后再考虑剩下的部分
-    if(conds.size() >= 1)
+    return std::max(1, pages);
+}
+
+// 保存表中记录的数据文件，分区表为各个分区的数据文件
+std::vector<RmFileHandle *> Planner::table_files(const TabMeta &tab)
+{
+    std::vector<RmFileHandle *> files;
+    for (int part_id : tab.partition.partitions) {
+        files.push_back(sm_manager_->get_table_handle(part_id).fh);
+    }
+    if (files.empty()) {
+        files.push_back(sm_manager_->get_table_handle(tab.id).fh);
+    }
+    return files;
+}
+
+/**
+ * @brief 估计条件的选择率。字段有统计信息时：与常量的等值条件为1/NDV(常量超出最小/最大值时只匹配一条记录)，
+ * 范围条件由直方图估计，两个表的字段的等值条件为1/两侧NDV中较大的一个。
+ * 没有统计信息时：唯一索引字段与常量的等值条件只匹配一条记录；两个表的字段的等值条件按1/较大的表的记录数估计，
+ * 一侧为唯一索引字段时按1/该表的记录数估计；其余条件使用默认选择率。
+ * 与参数$n比较的条件在生成计划时不知道参数的值，按没有统计信息估计
+ */
+double Planner::selectivity(const Condition &cond)
+{
+    const TabMeta &lhs_tab = sm_manager_->db_.get_table(cond.lhs_col.tab_name);
+    double lhs_rows = table_rows(lhs_tab.name);
+    if (cond.is_rhs_val && cond.rhs_val.param < 0) {
+        std::lock_guard<std::mutex> guard(sm_manager_->stats_latch_);
+        const ColMeta *col = nullptr;
+        if (auto stats = get_col_stats(lhs_tab, cond.lhs_col.col_name, &col)) {
+            const char *val = cond.rhs_val.raw->data;
+            double eq = stats->eq_fraction(val, col->type, col->len);
+            double less = stats->less_fraction(val, col->type, col->len);
+            double sel = 0;
+            switch (cond.op) {
+                case OP_EQ: sel = eq; break;
+                case OP_NE: sel = 1 - eq; break;
+                case OP_LT: sel = less; break;
+                case OP_LE: sel = less + eq; break;
+                case OP_GT: sel = 1 - less - eq; break;
+                case OP_GE: sel = 1 - less; break;
+            }
+            return std::min(1.0, std::max(sel, 1 / lhs_rows));
+        }
+    }
+    if (cond.op == OP_NE) {
+        return NE_SELECTIVITY;
+    }
+    if (cond.op != OP_EQ) {
+        return RANGE_SELECTIVITY;
+    }
+    if (cond.is_rhs_val) {
+        return is_unique_col(lhs_tab, cond.lhs_col.col_name) ? 1 / lhs_rows : EQ_SELECTIVITY;
+    }
+    if (cond.lhs_col.tab_name.compare(cond.rhs_col.tab_name) == 0) {
+        return EQ_SELECTIVITY;
+    }
+    const TabMeta &rhs_tab = sm_manager_->db_.get_table(cond.rhs_col.tab_name);
+    double rhs_rows = table_rows(rhs_tab.name);
     {
-        // 有连接条件
-
-        // 根据连接条件，生成第一层join
-        std::vector<std::string> joined_tables(tables.size());
-        auto it = conds.begin();
-        while (it != conds.end()) {
-            std::shared_ptr<Plan> left , right;
-            left = pop_scan(scantbl, it->lhs_col.tab_name, joined_tables, table_scan_executors);
-            right = pop_scan(scantbl, it->rhs_col.tab_name, joined_tables, table_scan_executors);
-            std::vector<Condition> join_conds{*it};
-            //建立join
-            table_join_executors = std::make_shared<JoinPlan>(T_NestLoop, std::move(left), std::move(right), join_conds);
-            it = conds.erase(it);
+        std::lock_guard<std::mutex> guard(sm_manager_->stats_latch_);
+        auto lhs_stats = get_col_stats(lhs_tab, cond.lhs_col.col_name);
+        auto rhs_stats = get_col_stats(rhs_tab, cond.rhs_col.col_name);
+        if (lhs_stats != nullptr && rhs_stats != nullptr) {
+            return 1 / std::max({lhs_stats->ndv, rhs_stats->ndv, 1.0});
+        }
+    }
+    if (is_unique_col(lhs_tab, cond.lhs_col.col_name)) {
+        return 1 / lhs_rows;
+    }
+    if (is_unique_col(rhs_tab, cond.rhs_col.col_name)) {
+        return 1 / rhs_rows;
+    }
+    return 1 / std::max(lhs_rows, rhs_rows);
+}
+
+/**
+ * @brief 估计扫描或连接计划输出的记录数：表的记录数之积乘以所有条件的选择率
+ */
+double Planner::estimate_rows(std::shared_ptr<Plan> plan)
+{
+    double rows = 1;
+    std::vector<Condition> *conds = nullptr;
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        rows = table_rows(x->tab_name_);
+        conds = &x->conds_;
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        rows = estimate_rows(x->left_) * estimate_rows(x->right_);
+        conds = &x->conds_;
+    }
+    if (conds != nullptr) {
+        for (auto &cond : *conds) {
+            rows *= selectivity(cond);
+        }
+    }
+    return std::max(1.0, rows);
+}
+
+/**
+ * @brief 索引可用的条件为从第一个索引字段开始连续的等值条件，之后最多再加一个字段上的范围条件，
+ * 与IndexScanExecutor确定扫描区间的规则相同。返回这些条件的选择率之积，即扫描区间内的记录所占的比例。
+ * 哈希索引只能查找完整的key，所有索引字段上都有等值条件时才可用
+ *
+ * @param tab_name 表名
+ * @param index 索引
+ * @param conds 该表上的条件
+ * @param usable 输出是否有条件能缩小扫描区间
+ */
+double Planner::index_selectivity(const std::string &tab_name, const IndexMeta &index,
+                                  const std::vector<Condition> &conds, bool *usable)
+{
+    double sel = 1;
+    *usable = false;
+    size_t eq_cols = 0;
+    for (auto &col : index.cols) {
+        bool has_eq = false;
+        bool has_range = false;
+        double range_sel = 1;
+        for (auto &cond : conds) {
+            if (!cond.is_rhs_val || cond.lhs_col.tab_name.compare(tab_name) != 0 ||
+                cond.lhs_col.col_name.compare(col.name) != 0) {
+                continue;
+            }
+            if (cond.op == OP_EQ && !has_eq) {
+                has_eq = true;
+                sel *= selectivity(cond);
+            } else if (cond.op != OP_EQ && cond.op != OP_NE) {
+                has_range = true;
+                range_sel *= selectivity(cond);
+            }
+        }
+        if (!has_eq) {
+            // 第一个没有等值条件的字段上的范围条件也能缩小扫描区间，之后的字段不再使用
+            if (has_range) {
+                *usable = true;
+                sel *= range_sel;
+            }
             break;
         }
-        // 根据连接条件，生成第2-n层join
-        it = conds.begin();
-        while (it != conds.end()) {
-            std::shared_ptr<Plan> left_need_to_join_executors = nullptr;
-            std::shared_ptr<Plan> right_need_to_join_executors = nullptr;
-            bool isneedreverse = false;
-            if (std::find(joined_tables.begin(), joined_tables.end(), it->lhs_col.tab_name) == joined_tables.end()) {
-                left_need_to_join_executors = pop_scan(scantbl, it->lhs_col.tab_name, joined_tables, table_scan_executors);
-            }
-            if (std::find(joined_tables.begin(), joined_tables.end(), it->rhs_col.tab_name) == joined_tables.end()) {
-                right_need_to_join_executors = pop_scan(scantbl, it->rhs_col.tab_name, joined_tables, table_scan_executors);
-                isneedreverse = true;
-            } 
-
-            if(left_need_to_join_executors != nullptr && right_need_to_join_executors != nullptr) {
-                std::vector<Condition> join_conds{*it};
-                std::shared_ptr<Plan> temp_join_executors = std::make_shared<JoinPlan>(T_NestLoop, 
-                                                                    std::move(left_need_to_join_executors), 
-                                                                    std::move(right_need_to_join_executors), 
-                                                                    join_conds);
-                table_join_executors = std::make_shared<JoinPlan>(T_NestLoop, std::move(temp_join_executors), 
-                                                                    std::move(table_join_executors), 
-                                                                    std::vector<Condition>());
-            } else if(left_need_to_join_executors != nullptr || right_need_to_join_executors != nullptr) {
-                if(isneedreverse) {
-                    std::map<CompOp, CompOp> swap_op = {
-                        {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
-                    };
-                    std::swap(it->lhs_col, it->rhs_col);
-                    it->op = swap_op.at(it->op);
-                    left_need_to_join_executors = std::move(right_need_to_join_executors);
+        *usable = true;
+        eq_cols++;
+    }
+    if (index.type == IndexType::HASH && eq_cols < index.cols.size()) {
+        *usable = false;
+    }
+    return sel;
+}
+
+/**
+ * @brief 顺序扫描的代价：顺序读取全部数据页并处理每条记录
+ */
+double Planner::seq_scan_cost(const std::string &tab_name)
+{
+    return table_pages(tab_name) * SEQ_PAGE_COST + table_rows(tab_name);
+}
+
+/**
+ * @brief 索引扫描的代价：从根结点下降到叶结点，顺序读取扫描区间所在的叶结点，再为每个Rid取回记录。
+ * 取回的记录随机分布在数据页中，访问到的不同数据页数按Cardenas公式pages * (1 - (1 - 1/pages)^matches)估计；
+ * index-only scan不取回记录。哈希索引只读取key所在的桶
+ *
+ * @param tab_name 表名
+ * @param index 索引
+ * @param sel 扫描区间内的记录所占的比例
+ * @param index_only 是否只读取索引
+ */
+double Planner::index_scan_cost(const std::string &tab_name, const IndexMeta &index, double sel, bool index_only)
+{
+    double rows = table_rows(tab_name);
+    double matches = std::max(1.0, rows * sel);
+    double pages = table_pages(tab_name);
+    double heap_pages = pages * (1 - std::pow(1 - 1 / pages, matches));
+    if (index.type == IndexType::HASH) {
+        return RANDOM_PAGE_COST + heap_pages * RANDOM_PAGE_COST + matches * (1 + HEAP_FETCH_COST);
+    }
+    int btree_order = static_cast<int>((PAGE_SIZE - sizeof(IxPageHdr)) / (index.col_tot_len + sizeof(Rid)) - 1);
+    double per_leaf = std::max(2.0, btree_order * INDEX_FILL_FACTOR);
+    double height = 1 + std::max(0.0, std::ceil(std::log(rows / per_leaf) / std::log(per_leaf)));
+    double leaf_pages = std::ceil(matches / per_leaf);
+    if (index_only) {
+        return height * RANDOM_PAGE_COST + leaf_pages * SEQ_PAGE_COST + matches;
+    }
+    return height * RANDOM_PAGE_COST + leaf_pages * SEQ_PAGE_COST + heap_pages * RANDOM_PAGE_COST +
+           matches * (1 + HEAP_FETCH_COST);
+}
+
+/**
+ * @brief 扫描的代价，顺序扫描和索引扫描分别按seq_scan_cost和index_scan_cost估计
+ */
+double Planner::scan_cost(std::shared_ptr<ScanPlan> scan)
+{
+    if (scan->tag == T_SeqScan) {
+        return seq_scan_cost(scan->tab_name_);
+    }
+    TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+    const IndexMeta &index = *tab.get_index_meta(scan->index_col_names_);
+    bool usable = false;
+    double sel = index_selectivity(scan->tab_name_, index, scan->conds_, &usable);
+    return index_scan_cost(scan->tab_name_, index, sel, scan->index_only_);
+}
+
+/**
+ * @brief inner是否为单表扫描，且表上有以某个等值连接字段开头的索引，从而可以作为index nested loop join的内表
+ */
+bool Planner::has_join_index(std::shared_ptr<Plan> inner, const std::vector<Condition> &conds)
+{
+    auto scan = std::dynamic_pointer_cast<ScanPlan>(inner);
+    if (scan == nullptr) {
+        return false;
+    }
+    const TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+    if (tab.is_partitioned()) {
+        return false;
+    }
+    for (auto &cond : conds) {
+        if (cond.op != OP_EQ || cond.is_rhs_val) {
+            continue;
+        }
+        const TabCol &inner_col = cond.lhs_col.tab_name == scan->tab_name_ ? cond.lhs_col : cond.rhs_col;
+        bool leads = std::any_of(tab.indexes.begin(), tab.indexes.end(), [&](const IndexMeta &index) {
+            // 多字段的哈希索引需要所有字段都有等值连接条件，这里只按单字段的哈希索引估计
+            return (index.type != IndexType::HASH || index.cols.size() == 1) &&
+                   index.cols[0].name.compare(inner_col.col_name) == 0;
+        });
+        if (inner_col.tab_name == scan->tab_name_ && leads) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 连接两个子计划，估计结果的记录数和代价：代价为两侧的代价、连接本身的代价与输出记录数之和。
+ * 有等值条件时连接按hash join(两侧记录数之和)和index nested loop join(外表记录数乘以探测代价，不扫描内表)中
+ * 较小的代价估计，否则按nested loop join(两侧记录数之积)估计
+ *
+ * @param left 左子计划
+ * @param right 右子计划
+ * @param conds 全部连接条件，只使用一侧在left中、另一侧在right中的条件
+ * @param sels 每个连接条件的选择率
+ * @param table_ids 表名到位图中的位
+ * @return JoinRel 连接后的子计划
+ */
+JoinRel Planner::make_join_rel(const JoinRel &left, const JoinRel &right, const std::vector<Condition> &conds,
+                               const std::vector<double> &sels, const std::map<std::string, int> &table_ids)
+{
+    std::map<CompOp, CompOp> swap_op = {
+        {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+    };
+    JoinRel rel;
+    rel.tables = left.tables | right.tables;
+    std::vector<Condition> join_conds;
+    double sel = 1;
+    bool has_equi = false;
+    for (size_t i = 0; i < conds.size(); i++) {
+        uint32_t lhs = 1u << table_ids.at(conds[i].lhs_col.tab_name);
+        uint32_t rhs = 1u << table_ids.at(conds[i].rhs_col.tab_name);
+        Condition cond = conds[i];
+        if ((lhs & right.tables) && (rhs & left.tables)) {
+            // 条件的左侧字段放在左子计划中
+            std::swap(cond.lhs_col, cond.rhs_col);
+            cond.op = swap_op.at(cond.op);
+        } else if (!(lhs & left.tables) || !(rhs & right.tables)) {
+            continue;
+        }
+        sel *= sels[i];
+        has_equi = has_equi || cond.op == OP_EQ;
+        join_conds.push_back(std::move(cond));
+    }
+    rel.rows = std::max(1.0, left.rows * right.rows * sel);
+    double cost = left.cost + right.cost + left.rows * right.rows;
+    if (has_equi) {
+        cost = left.cost + right.cost + left.rows + right.rows;
+        if (has_join_index(right.plan, join_conds)) {
+            cost = std::min(cost, left.cost + left.rows * INDEX_PROBE_COST);
+        }
+        if (has_join_index(left.plan, join_conds)) {
+            cost = std::min(cost, right.cost + right.rows * INDEX_PROBE_COST);
+        }
+    }
+    rel.cost = cost + rel.rows;
+    rel.plan = std::make_shared<JoinPlan>(T_NestLoop, left.plan, right.plan, std::move(join_conds));
+    return rel;
+}
+
+/**
+ * @brief 基于代价选择连接顺序：不超过JOIN_DP_MAX_TABLES个表时按表的子集动态规划，枚举每个子集的所有划分，
+ * 保留代价最小的(可以是bushy的)连接树；表更多时贪心地每次连接结果代价最小的两个子计划。
+ * 只有子集内不存在有连接条件的划分时，才考虑笛卡尔积
+ *
+ * @param tables 表名
+ * @param scans 每个表的扫描计划
+ * @param conds 两个表之间的连接条件
+ * @return std::shared_ptr<Plan> 连接树，连接方法之后由choose_join_method选择
+ */
+std::shared_ptr<Plan> Planner::make_join_tree(const std::vector<std::string> &tables,
+                                              std::vector<std::shared_ptr<Plan>> scans, std::vector<Condition> conds)
+{
+    size_t n = tables.size();
+    std::map<std::string, int> table_ids;
+    std::vector<JoinRel> base(n);
+    for (size_t i = 0; i < n; i++) {
+        table_ids[tables[i]] = static_cast<int>(i);
+        auto scan = std::dynamic_pointer_cast<ScanPlan>(scans[i]);
+        base[i] = {scans[i], 1u << i, estimate_rows(scan), scan_cost(scan)};
+    }
+    std::vector<double> sels;
+    std::vector<std::pair<uint32_t, uint32_t>> cond_tables;
+    for (auto &cond : conds) {
+        sels.push_back(selectivity(cond));
+        cond_tables.emplace_back(1u << table_ids.at(cond.lhs_col.tab_name), 1u << table_ids.at(cond.rhs_col.tab_name));
+    }
+    // 两组表之间是否有连接条件
+    auto connected = [&](uint32_t a, uint32_t b) {
+        return std::any_of(cond_tables.begin(), cond_tables.end(), [&](const std::pair<uint32_t, uint32_t> &t) {
+            return ((t.first & a) && (t.second & b)) || ((t.first & b) && (t.second & a));
+        });
+    };
+
+    if (n <= JOIN_DP_MAX_TABLES) {
+        std::vector<JoinRel> best(1u << n);
+        for (size_t i = 0; i < n; i++) {
+            best[1u << i] = base[i];
+        }
+        // 子集按数值递增处理，它的所有真子集都已经处理过
+        for (uint32_t mask = 1; mask < (1u << n); mask++) {
+            if ((mask & (mask - 1)) == 0) {
+                continue;
+            }
+            for (bool cross : {false, true}) {
+                for (uint32_t sub = (mask - 1) & mask; sub != 0; sub = (sub - 1) & mask) {
+                    uint32_t rest = mask ^ sub;
+                    if (best[sub].plan == nullptr || best[rest].plan == nullptr || (!cross && !connected(sub, rest))) {
+                        continue;
+                    }
+                    JoinRel rel = make_join_rel(best[sub], best[rest], conds, sels, table_ids);
+                    if (best[mask].plan == nullptr || rel.cost < best[mask].cost) {
+                        best[mask] = std::move(rel);
+                    }
+                }
+                if (best[mask].plan != nullptr) {
+                    break;
                 }
-                std::vector<Condition> join_conds{*it};
-                table_join_executors = std::make_shared<JoinPlan>(T_NestLoop, std::move(left_need_to_join_executors), 
-                                                                    std::move(table_join_executors), join_conds);
-            } else {
-                push_conds(std::move(&(*it)), table_join_executors);
             }
-            it = conds.erase(it);
         }
-    } else {
-        table_join_executors = table_scan_executors[0];
-        scantbl[0] = 1;
+        return best.back().plan;
     }
 
-    //连接剩余表
-    for (size_t i = 0; i < tables.size(); i++) {
-        if(scantbl[i] == -1) {
-            table_join_executors = std::make_shared<JoinPlan>(T_NestLoop, std::move(table_scan_executors[i]), 
-                                                    std::move(table_join_executors), std::vector<Condition>());
+    std::vector<JoinRel> rels = std::move(base);
+    while (rels.size() > 1) {
+        JoinRel best;
+        size_t best_i = 0, best_j = 0;
+        for (bool cross : {false, true}) {
+            for (size_t i = 0; i < rels.size(); i++) {
+                for (size_t j = 0; j < rels.size(); j++) {
+                    if (i == j || (!cross && !connected(rels[i].tables, rels[j].tables))) {
+                        continue;
+                    }
+                    JoinRel rel = make_join_rel(rels[i], rels[j], conds, sels, table_ids);
+                    if (best.plan == nullptr || rel.cost < best.cost) {
+                        best = std::move(rel);
+                        best_i = i;
+                        best_j = j;
+                    }
+                }
+            }
+            if (best.plan != nullptr) {
+                break;
+            }
+        }
+        rels.erase(rels.begin() + std::max(best_i, best_j));
+        rels.erase(rels.begin() + std::min(best_i, best_j));
+        rels.push_back(std::move(best));
+    }
+    return rels[0].plan;
+}
+
+
+// 收集计划中排序和连接条件用到的字段
+static void collect_used_cols(std::shared_ptr<Plan> plan, std::set<std::pair<std::string, std::string>> &used)
+{
+    if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        for (auto &cond : x->conds_) {
+            used.insert({cond.lhs_col.tab_name, cond.lhs_col.col_name});
+            if (!cond.is_rhs_val) {
+                used.insert({cond.rhs_col.tab_name, cond.rhs_col.col_name});
+            }
+        }
+        collect_used_cols(x->left_, used);
+        collect_used_cols(x->right_, used);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        for (auto &col : x->sel_cols_) {
+            used.insert({col.tab_name, col.col_name});
+        }
+        collect_used_cols(x->subplan_, used);
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        collect_used_cols(x->subplan_, used);
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        collect_used_cols(x->subplan_, used);
+    }
+}
+
+// 设置计划中每个扫描的输出字段
+static void set_scan_projection(std::shared_ptr<Plan> plan, const std::set<std::pair<std::string, std::string>> &used)
+{
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        x->proj_cols_.clear();
+        for (auto &col : x->table_->tab->cols) {
+            if (used.count({col.tab_name, col.name}) != 0) {
+                x->proj_cols_.push_back(col.name);
+            }
+        }
+        if (x->proj_cols_.size() == x->table_->tab->cols.size()) {
+            x->proj_cols_.clear();
+        } else if (x->proj_cols_.empty()) {
+            // 上层不需要这个表的任何字段(如COUNT(*))时仍然输出一个字段，避免长度为0的记录
+            x->proj_cols_.push_back(x->table_->tab->cols[0].name);
+        }
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        set_scan_projection(x->left_, used);
+        set_scan_projection(x->right_, used);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        set_scan_projection(x->subplan_, used);
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        set_scan_projection(x->subplan_, used);
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        set_scan_projection(x->subplan_, used);
+    }
+}
+
+/**
+ * @brief 投影下推：上层算子只用到select列表、分组字段、聚合函数的参数、排序键和连接条件中的字段，
+ * 扫描在读取记录时就只保留这些字段，减少之后每个算子复制的字节数。扫描自身的条件在完整的记录上求值，不需要保留
+ *
+ * @param query 查询
+ * @param plan 查询计划
+ */
+void Planner::push_projection(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan)
+{
+    std::set<std::pair<std::string, std::string>> used;
+    for (auto &col : query->cols) {
+        used.insert({col.tab_name, col.col_name});
+    }
+    for (auto &col : query->group_cols) {
+        used.insert({col.tab_name, col.col_name});
+    }
+    for (auto &agg : query->aggs) {
+        used.insert({agg.col.tab_name, agg.col.col_name});
+    }
+    collect_used_cols(plan, used);
+    set_scan_projection(plan, used);
+    use_index_only(plan, used);
+}
+
+/**
+ * @brief 覆盖索引：扫描的条件和上层需要的字段都是某个索引的字段时，改为index-only scan。
+ * 已经是索引扫描的(可能为了顺序)只在其索引覆盖时改为index-only；顺序扫描在某个覆盖索引能缩小扫描区间、
+ * 且index-only scan的代价更小时改为该索引上的index-only scan。index nested loop join的内表由连接算子直接查找索引，
+ * COUNT(*)不读取记录，都不需要处理
+ *
+ * @param plan 查询计划
+ * @param used 上层算子用到的字段
+ */
+void Planner::use_index_only(std::shared_ptr<Plan> plan, const std::set<std::pair<std::string, std::string>> &used)
+{
+    if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        use_index_only(x->left_, used);
+        if (x->tag != T_IndexNestLoop) {
+            use_index_only(x->right_, used);
+        }
+        return;
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        use_index_only(x->subplan_, used);
+        return;
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        if (x->tag != T_CountStar) {
+            use_index_only(x->subplan_, used);
         }
+        return;
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        use_index_only(x->subplan_, used);
+        return;
+    }
+    auto scan = std::dynamic_pointer_cast<ScanPlan>(plan);
+    if (scan == nullptr) {
+        return;
+    }
+    std::set<std::string> needed;
+    bool output_any = false;                    // 上层是否需要这个表的字段
+    for (auto &col : scan->table_->tab->cols) {
+        if (used.count({col.tab_name, col.name}) != 0) {
+            needed.insert(col.name);
+            output_any = true;
+        }
+    }
+    for (auto &cond : scan->conds_) {
+        needed.insert(cond.lhs_col.col_name);
+        if (!cond.is_rhs_val) {
+            needed.insert(cond.rhs_col.col_name);
+        }
+    }
+    // 哈希索引的桶中没有按序的key可以还原记录，不用于index-only scan
+    auto covers = [&](const IndexMeta &index) {
+        return index.type != IndexType::HASH && std::all_of(needed.begin(), needed.end(), [&](const std::string &name) {
+            return std::any_of(index.cols.begin(), index.cols.end(),
+                               [&](const ColMeta &col) { return col.name.compare(name) == 0; });
+        });
+    };
+    TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+    const IndexMeta *chosen = nullptr;
+    if (scan->tag == T_IndexScan) {
+        const IndexMeta &index = *tab.get_index_meta(scan->index_col_names_);
+        chosen = covers(index) ? &index : nullptr;
+    } else {
+        double best = scan_cost(scan);
+        for (auto &index : tab.indexes) {
+            bool usable = false;
+            double sel = index_selectivity(scan->tab_name_, index, scan->conds_, &usable);
+            double cost = usable && covers(index) ? index_scan_cost(scan->tab_name_, index, sel, true) : best;
+            if (cost < best) {
+                best = cost;
+                chosen = &index;
+            }
+        }
+    }
+    if (chosen == nullptr) {
+        return;
+    }
+    scan->tag = T_IndexScan;
+    scan->index_only_ = true;
+    scan->index_col_names_.clear();
+    for (auto &col : chosen->cols) {
+        scan->index_col_names_.push_back(col.name);
     }
+    if (!output_any) {
+        // 上层不需要这个表的任何字段时输出一个索引字段
+        scan->proj_cols_ = {chosen->cols[0].name};
+    }
+}
 
-    return table_join_executors;
+/**
+ * @brief 生成分组聚合计划：没有条件的单表COUNT(*)直接由页面头中的记录数得到(分区表除外)；
+ * 单表的分组字段是某个索引的前几个字段(顺序不限)时按索引顺序扫描并流式聚合；其他情况用hash聚合
+ */
+std::shared_ptr<Plan> Planner::generate_aggregate_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan)
+{
+    auto scan = std::dynamic_pointer_cast<ScanPlan>(plan);
+    bool count_only = std::all_of(query->aggs.begin(), query->aggs.end(), [](const AggExpr &agg) {
+        return agg.type == AGG_COUNT;
+    });
+    if (scan != nullptr && scan->tag == T_SeqScan && scan->conds_.empty() && query->group_cols.empty() &&
+        count_only && !scan->table_->tab->is_partitioned()) {
+        // 没有NULL值，COUNT(col)与COUNT(*)相同
+        return std::make_shared<AggregatePlan>(T_CountStar, std::move(plan), query->group_cols, query->aggs);
+    }
+    if (!query->group_cols.empty() && use_index_grouping(plan, query->group_cols)) {
+        return std::make_shared<AggregatePlan>(T_StreamAggregate, std::move(plan), query->group_cols, query->aggs);
+    }
+    return std::make_shared<AggregatePlan>(T_Aggregate, std::move(plan), query->group_cols, query->aggs);
+}
 
+/**
+ * @brief 单表扫描的全部分组字段恰好是某个索引的前几个字段(顺序不限)时，改为按该索引顺序扫描，
+ * 使分组字段相同的记录连续出现
+ *
+ * @param plan 聚合的子计划
+ * @param group_cols 分组字段
+ * @return bool 是否改为了有序的索引扫描
+ */
+bool Planner::use_index_grouping(std::shared_ptr<Plan> plan, const std::vector<TabCol> &group_cols)
+{
+    auto scan = std::dynamic_pointer_cast<ScanPlan>(plan);
+    if (scan == nullptr) {
+        return false;
+    }
+    std::set<std::string> names;
+    for (auto &col : group_cols) {
+        if (col.tab_name.compare(scan->tab_name_) != 0) {
+            return false;
+        }
+        names.insert(col.col_name);
+    }
+    // 索引的前names.size()个字段是否恰好是全部分组字段，是则按这个顺序作为排序键
+    auto try_index = [&](const std::vector<std::string> &index_cols) {
+        if (index_cols.size() < names.size()) {
+            return false;
+        }
+        std::vector<TabCol> keys;
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names.count(index_cols[i]) == 0) {
+                return false;
+            }
+            keys.push_back({.tab_name = scan->tab_name_, .col_name = index_cols[i]});
+        }
+        return use_index_order(plan, keys, std::vector<bool>(keys.size(), scan->is_desc_));
+    };
+    if (scan->tag == T_IndexScan) {
+        return !is_hash_scan(scan) && try_index(scan->index_col_names_);
+    }
+    for (auto &index : sm_manager_->db_.get_table(scan->tab_name_).indexes) {
+        if (index.type == IndexType::HASH) {
+            continue;
+        }
+        std::vector<std::string> index_cols;
+        for (auto &col : index.cols) {
+            index_cols.push_back(col.name);
+        }
+        if (try_index(index_cols)) {
+            return true;
+        }
+    }
+    return false;
 }
 
+// 有LIMIT时在plan之上只取前limit条记录
+std::shared_ptr<Plan> Planner::generate_limit_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan)
+{
+    if (query->limit < 0) {
+        return plan;
+    }
+    return std::make_shared<LimitPlan>(T_Limit, std::move(plan), query->limit);
+}
 
+/**
+ * @brief 生成ORDER BY的排序计划，有LIMIT时排序只保留前limit条记录(top-N)
+ */
 std::shared_ptr<Plan> Planner::generate_sort_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan)
 {
     auto x = std::dynamic_pointer_cast<ast::SelectStmt>(query->parse);
     if(!x->has_sort) {
-        return plan;
+        return generate_limit_plan(query, std::move(plan));
     }
     std::vector<std::string> tables = query->tables;
     std::vector<ColMeta> all_cols;
@@ -252,13 +843,320 @@ std::shared_ptr<Plan> Planner::generate_sort_plan(std::shared_ptr<Query> query,
         const auto &sel_tab_cols = sm_manager_->db_.get_table(sel_tab_name).cols;
         all_cols.insert(all_cols.end(), sel_tab_cols.begin(), sel_tab_cols.end());
     }
-    TabCol sel_col;
-    for (auto &col : all_cols) {
-        if(col.name.compare(x->order->cols->col_name) == 0 )
-        sel_col = {.tab_name = col.tab_name, .col_name = col.name};
+    std::vector<TabCol> sel_cols;
+    std::vector<bool> is_desc;
+    for (auto &order : x->orders) {
+        TabCol sel_col;
+        for (auto &col : all_cols) {
+            if ((order->cols->tab_name.empty() || col.tab_name.compare(order->cols->tab_name) == 0) &&
+                col.name.compare(order->cols->col_name) == 0)
+            sel_col = {.tab_name = col.tab_name, .col_name = col.name};
+        }
+        if (sel_col.col_name.empty()) {
+            throw ColumnNotFoundError(order->cols->col_name);
+        }
+        sel_cols.push_back(sel_col);
+        is_desc.push_back(order->orderby_dir == ast::OrderBy_DESC);
+    }
+    if (use_index_order(plan, sel_cols, is_desc)) {
+        // 索引扫描已经有序，LIMIT只需要取前几条记录
+        return generate_limit_plan(query, std::move(plan));
+    }
+    return std::make_shared<SortPlan>(T_Sort, std::move(plan), std::move(sel_cols), std::move(is_desc),
+                                      query->limit);
+}
+
+/**
+ * @brief 单表查询的排序键依次是某个索引的前几个字段且方向相同时，改为按索引顺序(DESC时逆序)扫描，省去SortPlan；
+ * 子计划为流式聚合时，排序键依次是其扫描索引的前几个字段即可
+ *
+ * @param plan 排序的子计划
+ * @param sel_cols 排序键
+ * @param is_desc 每个排序键是否降序
+ * @return bool 是否改为了有序的索引扫描(或子计划已经有序)
+ */
+bool Planner::use_index_order(std::shared_ptr<Plan> plan, const std::vector<TabCol> &sel_cols,
+                              const std::vector<bool> &is_desc)
+{
+    if (std::find(is_desc.begin(), is_desc.end(), !is_desc[0]) != is_desc.end()) {
+        return false;
+    }
+    auto agg = std::dynamic_pointer_cast<AggregatePlan>(plan);
+    if (agg != nullptr && agg->tag == T_StreamAggregate) {
+        // 流式聚合按扫描的索引顺序输出分组，排序键是索引中的前几个分组字段时结果已经有序，反向扫描不影响分组
+        auto scan = std::dynamic_pointer_cast<ScanPlan>(agg->subplan_);
+        if (sel_cols.size() > agg->group_cols_.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < sel_cols.size(); i++) {
+            if (sel_cols[i].tab_name.compare(scan->tab_name_) != 0 ||
+                scan->index_col_names_[i].compare(sel_cols[i].col_name) != 0) {
+                return false;
+            }
+        }
+        scan->is_desc_ = is_desc[0];
+        return true;
+    }
+    auto scan = std::dynamic_pointer_cast<ScanPlan>(plan);
+    if (scan == nullptr) {
+        return false;
+    }
+    // 索引字段是否以全部排序键开头
+    auto leads_with_keys = [&](const std::vector<std::string> &index_cols) {
+        if (index_cols.size() < sel_cols.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < sel_cols.size(); i++) {
+            if (sel_cols[i].tab_name.compare(scan->tab_name_) != 0 || index_cols[i].compare(sel_cols[i].col_name) != 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (scan->tag == T_IndexScan) {
+        // 已经选择的索引以排序键开头，扫描结果本身有序
+        if (is_hash_scan(scan) || !leads_with_keys(scan->index_col_names_)) {
+            return false;
+        }
+    } else {
+        const TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+        std::vector<std::string> index_col_names;
+        auto index = std::find_if(tab.indexes.begin(), tab.indexes.end(), [&](const IndexMeta &index) {
+            if (index.type == IndexType::HASH) {
+                return false;
+            }
+            index_col_names.clear();
+            for (auto &col : index.cols) {
+                index_col_names.push_back(col.name);
+            }
+            return leads_with_keys(index_col_names);
+        });
+        if (index == tab.indexes.end()) {
+            return false;
+        }
+        scan->tag = T_IndexScan;
+        scan->index_col_names_ = std::move(index_col_names);
+    }
+    scan->is_desc_ = is_desc[0];
+    return true;
+}
+
+
+// 收集计划扫描的所有表
+static void collect_tables(std::shared_ptr<Plan> plan, std::set<std::string> &tables)
+{
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        tables.insert(x->tab_name_);
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        collect_tables(x->left_, tables);
+        collect_tables(x->right_, tables);
+    }
+}
+
+/**
+ * @brief 连接条件中含有左右两侧字段的等值比较(字段类型和长度相同)时，改用hash join
+ *
+ * @param plan 查询计划，递归处理其中所有的JoinPlan
+ */
+void Planner::choose_join_method(std::shared_ptr<Plan> plan)
+{
+    auto x = std::dynamic_pointer_cast<JoinPlan>(plan);
+    if (x == nullptr) {
+        return;
+    }
+    choose_join_method(x->left_);
+    choose_join_method(x->right_);
+    if (use_merge_join(x) || use_index_join(x)) {
+        return;
+    }
+    std::set<std::string> left_tables, right_tables;
+    collect_tables(x->left_, left_tables);
+    collect_tables(x->right_, right_tables);
+    for (auto &cond : x->conds_) {
+        if (cond.op != OP_EQ || cond.is_rhs_val) {
+            continue;
+        }
+        bool lhs_left = left_tables.count(cond.lhs_col.tab_name) != 0;
+        bool rhs_left = left_tables.count(cond.rhs_col.tab_name) != 0;
+        bool lhs_right = right_tables.count(cond.lhs_col.tab_name) != 0;
+        bool rhs_right = right_tables.count(cond.rhs_col.tab_name) != 0;
+        if (!(lhs_left && rhs_right) && !(lhs_right && rhs_left)) {
+            continue;
+        }
+        auto lhs = sm_manager_->db_.get_table(cond.lhs_col.tab_name).get_col(cond.lhs_col.col_name);
+        auto rhs = sm_manager_->db_.get_table(cond.rhs_col.tab_name).get_col(cond.rhs_col.col_name);
+        if (lhs->type == rhs->type && lhs->len == rhs->len) {
+            x->tag = T_HashJoin;
+            return;
+        }
+    }
+}
+
+
+/**
+ * @brief 扫描是否按字段col升序输出：已选的索引以col开头，或者表上有以col开头的索引(并改为该索引上的扫描)
+ *
+ * @param scan 单表扫描
+ * @param col_name 字段名
+ * @param convert 为false时只判断，不修改扫描
+ * @return bool 扫描是否能按col升序输出
+ */
+bool Planner::use_ordered_scan(std::shared_ptr<ScanPlan> scan, const std::string &col_name, bool convert)
+{
+    if (scan->tag == T_IndexScan) {
+        return !scan->is_desc_ && !is_hash_scan(scan) && scan->index_col_names_[0].compare(col_name) == 0;
+    }
+    const TabMeta &tab = sm_manager_->db_.get_table(scan->tab_name_);
+    auto index = std::find_if(tab.indexes.begin(), tab.indexes.end(), [&](const IndexMeta &index) {
+        return index.type != IndexType::HASH && index.cols[0].name.compare(col_name) == 0;
+    });
+    if (index == tab.indexes.end()) {
+        return false;
+    }
+    if (convert) {
+        scan->tag = T_IndexScan;
+        scan->index_col_names_.clear();
+        for (auto &col : index->cols) {
+            scan->index_col_names_.push_back(col.name);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 两侧都是单表扫描，且连接条件两侧的字段分别是两个表上某个索引的第一个字段时，
+ * 两侧改为按该索引顺序扫描，用merge join在一遍扫描中完成连接。优先选择等值条件，没有等值条件时选择范围比较条件；
+ * 等值条件下若某一侧还有自身的扫描条件，交给index nested loop join或hash join
+ *
+ * @param join 连接计划
+ * @return bool 是否改为了merge join
+ */
+bool Planner::use_merge_join(std::shared_ptr<JoinPlan> join)
+{
+    auto left = std::dynamic_pointer_cast<ScanPlan>(join->left_);
+    auto right = std::dynamic_pointer_cast<ScanPlan>(join->right_);
+    if (left == nullptr || right == nullptr) {
+        return false;
+    }
+    std::map<CompOp, CompOp> swap_op = {
+        {OP_EQ, OP_EQ}, {OP_NE, OP_NE}, {OP_LT, OP_GT}, {OP_GT, OP_LT}, {OP_LE, OP_GE}, {OP_GE, OP_LE},
+    };
+    bool has_equi = std::any_of(join->conds_.begin(), join->conds_.end(), [](const Condition &cond) {
+        return cond.op == OP_EQ && !cond.is_rhs_val;
+    });
+    for (bool equi : {true, false}) {
+        if (equi && (!left->conds_.empty() || !right->conds_.empty())) {
+            continue;
+        }
+        // 有等值连接条件时不按范围条件归并
+        if (!equi && has_equi) {
+            break;
+        }
+        for (size_t i = 0; i < join->conds_.size(); i++) {
+            Condition cond = join->conds_[i];
+            if (cond.is_rhs_val || cond.op == OP_NE || (cond.op == OP_EQ) != equi) {
+                continue;
+            }
+            if (cond.lhs_col.tab_name == right->tab_name_ && cond.rhs_col.tab_name == left->tab_name_) {
+                std::swap(cond.lhs_col, cond.rhs_col);
+                cond.op = swap_op.at(cond.op);
+            }
+            if (cond.lhs_col.tab_name != left->tab_name_ || cond.rhs_col.tab_name != right->tab_name_) {
+                continue;
+            }
+            auto lhs = sm_manager_->db_.get_table(left->tab_name_).get_col(cond.lhs_col.col_name);
+            auto rhs = sm_manager_->db_.get_table(right->tab_name_).get_col(cond.rhs_col.col_name);
+            if (lhs->type != rhs->type || lhs->len != rhs->len ||
+                !use_ordered_scan(left, cond.lhs_col.col_name, false) ||
+                !use_ordered_scan(right, cond.rhs_col.col_name, false)) {
+                continue;
+            }
+            use_ordered_scan(left, cond.lhs_col.col_name, true);
+            use_ordered_scan(right, cond.rhs_col.col_name, true);
+            // 归并条件放在第一个
+            join->conds_.erase(join->conds_.begin() + i);
+            join->conds_.insert(join->conds_.begin(), std::move(cond));
+            join->tag = T_MergeJoin;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * @brief 一侧为单表扫描，且该表与另一侧的等值连接条件覆盖了它某个索引的前缀时，改用index nested loop join，
+ * 该表作为内表(右节点)，选择被覆盖的前缀最长的索引。估计的探测代价超过hash join的代价(外表较大)时不使用
+ *
+ * @param join 连接计划
+ * @return bool 是否改为了index nested loop join
+ */
+bool Planner::use_index_join(std::shared_ptr<JoinPlan> join)
+{
+    for (int side = 0; side < 2; side++) {
+        auto inner = std::dynamic_pointer_cast<ScanPlan>(side == 0 ? join->right_ : join->left_);
+        if (inner == nullptr) {
+            continue;
+        }
+        TabMeta &tab = sm_manager_->db_.get_table(inner->tab_name_);
+        if (tab.is_partitioned()) {
+            // 每次探测都要查找所有分区的索引，不如hash join
+            continue;
+        }
+        // 内表中与另一侧字段有等值条件(类型和长度相同)的字段
+        std::set<std::string> join_cols;
+        for (auto &cond : join->conds_) {
+            if (cond.op != OP_EQ || cond.is_rhs_val) {
+                continue;
+            }
+            const TabCol *inner_col = &cond.lhs_col;
+            const TabCol *outer_col = &cond.rhs_col;
+            if (outer_col->tab_name == inner->tab_name_) {
+                std::swap(inner_col, outer_col);
+            }
+            if (inner_col->tab_name != inner->tab_name_ || outer_col->tab_name == inner->tab_name_) {
+                continue;
+            }
+            auto lhs = tab.get_col(inner_col->col_name);
+            auto rhs = sm_manager_->db_.get_table(outer_col->tab_name).get_col(outer_col->col_name);
+            if (lhs->type == rhs->type && lhs->len == rhs->len) {
+                join_cols.insert(inner_col->col_name);
+            }
+        }
+        const IndexMeta *best = nullptr;
+        size_t best_prefix = 0;
+        for (auto &index : tab.indexes) {
+            size_t prefix = 0;
+            while (prefix < index.cols.size() && join_cols.count(index.cols[prefix].name) != 0) {
+                prefix++;
+            }
+            if (index.type == IndexType::HASH && prefix < index.cols.size()) {
+                // 哈希索引只能用完整的key探测
+                continue;
+            }
+            if (prefix > best_prefix) {
+                best = &index;
+                best_prefix = prefix;
+            }
+        }
+        if (best == nullptr) {
+            continue;
+        }
+        double outer_rows = estimate_rows(side == 0 ? join->left_ : join->right_);
+        if (outer_rows * INDEX_PROBE_COST > scan_cost(inner) + outer_rows + estimate_rows(inner)) {
+            continue;
+        }
+        if (side == 1) {
+            std::swap(join->left_, join->right_);
+        }
+        join->tag = T_IndexNestLoop;
+        join->index_col_names_.clear();
+        for (auto &col : best->cols) {
+            join->index_col_names_.push_back(col.name);
+        }
+        return true;
     }
-    return std::make_shared<SortPlan>(T_Sort, std::move(plan), sel_col, 
-                                    x->order->orderby_dir == ast::OrderBy_DESC);
+    return false;
 }
 
 
@@ -282,6 +1180,93 @@ std::shared_ptr<Plan> Planner::generate_select_plan(std::shared_ptr<Query> query
     return plannerRoot;
 }
 
+/**
+ * @brief 把计划中按字段名选定的索引解析为索引编号，执行器按编号从表的句柄中直接取得索引文件；
+ * 分区表的扫描按最终的条件剪掉不可能包含满足条件的记录的分区。
+ * 计划生成的过程中可能多次改变选用的索引和下推的条件，因此在最后统一解析
+ *
+ * @param sm_manager 系统管理器
+ * @param plan 查询计划
+ */
+static void resolve_handles(SmManager *sm_manager, std::shared_ptr<Plan> plan)
+{
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        if (x->tag == T_IndexScan) {
+            x->index_id_ = x->table_->tab->get_index_meta(x->index_col_names_)->id;
+        }
+        if (x->table_->tab->is_partitioned()) {
+            x->partitions_ = sm_manager->get_partitions(*x->table_->tab, x->conds_);
+        }
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        resolve_handles(sm_manager, x->left_);
+        resolve_handles(sm_manager, x->right_);
+        if (x->tag == T_IndexNestLoop) {
+            auto inner = std::dynamic_pointer_cast<ScanPlan>(x->right_);
+            x->index_id_ = inner->table_->tab->get_index_meta(x->index_col_names_)->id;
+        }
+    } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+        resolve_handles(sm_manager, x->subplan_);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        resolve_handles(sm_manager, x->subplan_);
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        resolve_handles(sm_manager, x->subplan_);
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        resolve_handles(sm_manager, x->subplan_);
+    } else if (auto x = std::dynamic_pointer_cast<DMLPlan>(plan)) {
+        resolve_handles(sm_manager, x->subplan_);
+    }
+}
+
+/**
+ * @brief 把PARTITION BY子句转换为分区方式：RANGE分区的上界按分区字段的类型和长度编码，
+ * 分区数记录在partitions的大小中，各分区的表由SmManager创建
+ *
+ * @param clause PARTITION BY子句
+ * @param col_defs 表的字段
+ */
+PartitionSpec Planner::make_partition_spec(const ast::PartitionClause &clause, const std::vector<ColDef> &col_defs)
+{
+    auto col = std::find_if(col_defs.begin(), col_defs.end(),
+                            [&](const ColDef &col_def) { return col_def.name == clause.col_name; });
+    if (col == col_defs.end()) {
+        throw ColumnNotFoundError(clause.col_name);
+    }
+    PartitionSpec spec;
+    spec.col_name = clause.col_name;
+    size_t num_partitions = 0;
+    if (strcasecmp(clause.method.c_str(), "range") == 0 && clause.num_partitions == 0) {
+        spec.kind = PartitionKind::RANGE;
+        for (auto &sv_bound : clause.bounds) {
+            Value bound;
+            if (auto int_lit = std::dynamic_pointer_cast<ast::IntLit>(sv_bound)) {
+                bound.set_int(int_lit->val);
+            } else if (auto float_lit = std::dynamic_pointer_cast<ast::FloatLit>(sv_bound)) {
+                bound.set_float(float_lit->val);
+            } else if (auto str_lit = std::dynamic_pointer_cast<ast::StringLit>(sv_bound)) {
+                bound.set_str(str_lit->val);
+            } else {
+                throw InvalidPartitionError("range bounds must be constants");
+            }
+            if (bound.type != col->type) {
+                throw IncompatibleTypeError(coltype2str(col->type), coltype2str(bound.type));
+            }
+            bound.init_raw(col->len);
+            spec.bounds.emplace_back(bound.raw->data, col->len);
+        }
+        num_partitions = spec.bounds.size() + 1;
+    } else if (strcasecmp(clause.method.c_str(), "hash") == 0 && clause.bounds.empty()) {
+        spec.kind = PartitionKind::HASH;
+        if (clause.num_partitions <= 0) {
+            throw InvalidPartitionError("hash partitions must be positive");
+        }
+        num_partitions = static_cast<size_t>(clause.num_partitions);
+    } else {
+        throw InvalidSettingError("partition by", clause.method);
+    }
+    spec.partitions.assign(num_partitions, -1);
+    return spec;
+}
+
 // 生成DDL语句和DML语句的查询执行计划
 std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context *context)
 {
@@ -293,19 +1278,54 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
             if (auto sv_col_def = std::dynamic_pointer_cast<ast::ColDef>(field)) {
                 ColDef col_def = {.name = sv_col_def->col_name,
                                   .type = interp_sv_type(sv_col_def->type_len->type),
-                                  .len = sv_col_def->type_len->len};
+                                  .len = sv_col_def->type_len->len,
+                                  .var_len = sv_col_def->type_len->type == ast::SV_TYPE_VARCHAR};
                 col_defs.push_back(col_def);
             } else {
                 throw InternalError("Unexpected field type");
             }
         }
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        auto plan = std::make_shared<DDLPlan>(T_CreateTable, x->tab_name, std::vector<std::string>(), col_defs);
+        // WITH (layout = row | pax | lsm, compression = on | off)，压缩只支持PAX格式
+        bool compressed = false;
+        for (auto &option : x->options) {
+            const char *name = option.first.c_str();
+            const char *value = option.second.c_str();
+            if (strcasecmp(name, "layout") == 0 && strcasecmp(value, "pax") == 0) {
+                plan->layout_ = TableLayout::PAX;
+            } else if (strcasecmp(name, "layout") == 0 && strcasecmp(value, "row") == 0) {
+                plan->layout_ = TableLayout::ROW;
+            } else if (strcasecmp(name, "layout") == 0 && strcasecmp(value, "lsm") == 0) {
+                plan->layout_ = TableLayout::LSM;
+            } else if (strcasecmp(name, "compression") == 0 &&
+                       (strcasecmp(value, "on") == 0 || strcasecmp(value, "off") == 0)) {
+                compressed = strcasecmp(value, "on") == 0;
+            } else {
+                throw InvalidSettingError(option.first, option.second);
+            }
+        }
+        if (compressed) {
+            if (plan->layout_ != TableLayout::PAX) {
+                throw InvalidSettingError("compression", "on");
+            }
+            plan->layout_ = TableLayout::PAX_COMPRESSED;
+        }
+        if (x->partition != nullptr) {
+            plan->partition_ = make_partition_spec(*x->partition, col_defs);
+        }
+        plannerRoot = plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropTable>(query->parse)) {
         // drop table;
         plannerRoot = std::make_shared<DDLPlan>(T_DropTable, x->tab_name, std::vector<std::string>(), std::vector<ColDef>());
     } else if (auto x = std::dynamic_pointer_cast<ast::CreateIndex>(query->parse)) {
-        // create index;
-        plannerRoot = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        // create index [USING btree | hash];
+        auto plan = std::make_shared<DDLPlan>(T_CreateIndex, x->tab_name, x->col_names, std::vector<ColDef>());
+        if (strcasecmp(x->method.c_str(), "hash") == 0) {
+            plan->index_type_ = IndexType::HASH;
+        } else if (!x->method.empty() && strcasecmp(x->method.c_str(), "btree") != 0) {
+            throw InvalidSettingError("using", x->method);
+        }
+        plannerRoot = plan;
     } else if (auto x = std::dynamic_pointer_cast<ast::DropIndex>(query->parse)) {
         // drop index
         plannerRoot = std::make_shared<DDLPlan>(T_DropIndex, x->tab_name, x->col_names, std::vector<ColDef>());
@@ -363,5 +1383,6 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
     } else {
         throw InternalError("Unexpected AST root");
     }
+    resolve_handles(sm_manager_, plannerRoot);
     return plannerRoot;
 }
\ No newline at end of file
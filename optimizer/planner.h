@@ -3,6 +3,7 @@
 #include <cassert>
 #include <cstring>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -16,6 +17,14 @@
 #include "common/common.h"
 #include "analyze/analyze.h"
 
+// 连接顺序搜索中的一个子计划
+struct JoinRel {
+    std::shared_ptr<Plan> plan;
+    uint32_t tables = 0;        // 覆盖的表的位图，第i位对应query->tables[i]
+    double rows = 0;            // 估计的输出行数
+    double cost = 0;            // 估计的代价，单位约为处理一条记录
+};
+
 class Planner {
    private:
     SmManager *sm_manager_;
@@ -32,7 +41,62 @@ class Planner {
 
     std::shared_ptr<Plan> make_one_rel(std::shared_ptr<Query> query);
 
+    std::shared_ptr<Plan> make_join_tree(const std::vector<std::string> &tables,
+                                         std::vector<std::shared_ptr<Plan>> scans, std::vector<Condition> conds);
+
+    JoinRel make_join_rel(const JoinRel &left, const JoinRel &right, const std::vector<Condition> &conds,
+                          const std::vector<double> &sels, const std::map<std::string, int> &table_ids);
+
+    double table_rows(const std::string &tab_name);
+
+    double table_pages(const std::string &tab_name);
+
+    std::vector<RmFileHandle *> table_files(const TabMeta &tab);
+
+    double selectivity(const Condition &cond);
+
+    double estimate_rows(std::shared_ptr<Plan> plan);
+
+    double index_selectivity(const std::string &tab_name, const IndexMeta &index,
+                             const std::vector<Condition> &conds, bool *usable);
+
+    double seq_scan_cost(const std::string &tab_name);
+
+    double index_scan_cost(const std::string &tab_name, const IndexMeta &index, double sel, bool index_only = false);
+
+    double scan_cost(std::shared_ptr<ScanPlan> scan);
+
+    bool has_join_index(std::shared_ptr<Plan> inner, const std::vector<Condition> &conds);
+
     std::shared_ptr<Plan> generate_sort_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan);
+
+    std::shared_ptr<Plan> generate_limit_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan);
+
+    std::shared_ptr<Plan> generate_aggregate_plan(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan);
+
+    bool use_index_grouping(std::shared_ptr<Plan> plan, const std::vector<TabCol> &group_cols);
+
+    void push_projection(std::shared_ptr<Query> query, std::shared_ptr<Plan> plan);
+
+    void use_index_only(std::shared_ptr<Plan> plan, const std::set<std::pair<std::string, std::string>> &used);
+
+    bool use_index_order(std::shared_ptr<Plan> plan, const std::vector<TabCol> &sel_cols,
+                         const std::vector<bool> &is_desc);
+
+    void choose_join_method(std::shared_ptr<Plan> plan);
+
+    bool use_index_join(std::shared_ptr<JoinPlan> join);
+
+    bool use_merge_join(std::shared_ptr<JoinPlan> join);
+
+    bool use_ordered_scan(std::shared_ptr<ScanPlan> scan, const std::string &col_name, bool convert);
+
+    // 已经选择的索引扫描是否使用哈希索引，哈希索引的扫描结果无序
+    bool is_hash_scan(std::shared_ptr<ScanPlan> scan) {
+        return scan->tag == T_IndexScan &&
+               sm_manager_->db_.get_table(scan->tab_name_).get_index_meta(scan->index_col_names_)->type ==
+                   IndexType::HASH;
+    }
     
     std::shared_ptr<Plan> generate_select_plan(std::shared_ptr<Query> query, Context *context);
 
@@ -40,9 +104,12 @@ class Planner {
     // int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
     bool get_index_cols(std::string tab_name, std::vector<Condition> curr_conds, std::vector<std::string>& index_col_names);
 
+    PartitionSpec make_partition_spec(const ast::PartitionClause &clause, const std::vector<ColDef> &col_defs);
+
     ColType interp_sv_type(ast::SvType sv_type) {
         std::map<ast::SvType, ColType> m = {
-            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}};
+            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING},
+            {ast::SV_TYPE_VARCHAR, TYPE_STRING}};
         return m.at(sv_type);
     }
 };
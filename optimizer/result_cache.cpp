@@ -0,0 +1,187 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @description: 生成结果缓存的key：语句文本之后依次编码每个参数的类型和值，再加上结果的格式。
+ *               文本格式和二进制格式的结果不同，分别缓存
+ * @return {string} 缓存的key
+ * @param {string&} sql 规范化后的语句文本，EXECUTE时为PREPARE的语句的文本
+ * @param {vector<Value>&} args EXECUTE时参数$1..$n的值，其他语句为空
+ * @param {bool} binary_result 结果是否以二进制格式返回
+ */
+std::string ResultCache::make_key(const std::string &sql, const std::vector<Value> &args, bool binary_result) {
+    std::string key = sql;
+    key.push_back('\0');
+    key.push_back(binary_result ? 'b' : 't');
+    for (auto &arg : args) {
+        key.push_back(static_cast<char>(arg.type));
+        if (arg.type == TYPE_INT) {
+            key.append(reinterpret_cast<const char *>(&arg.int_val), sizeof(arg.int_val));
+        } else if (arg.type == TYPE_FLOAT) {
+            key.append(reinterpret_cast<const char *>(&arg.float_val), sizeof(arg.float_val));
+        } else {
+            uint32_t len = static_cast<uint32_t>(arg.str_val.size());
+            key.append(reinterpret_cast<const char *>(&len), sizeof(len));
+            key += arg.str_val;
+        }
+    }
+    return key;
+}
+
+/**
+ * @description: 查找缓存的结果，schema或任何一张表中的数据变化后缓存的结果被丢弃
+ * @return {shared_ptr<const CachedResult>} 仍然有效的结果，没有时为nullptr
+ * @param {string&} key make_key()生成的key
+ */
+std::shared_ptr<const CachedResult> ResultCache::lookup(const std::string &key) {
+    std::shared_ptr<const CachedResult> entry;
+    {
+        std::lock_guard<std::mutex> guard(latch_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        entry = *it->second;
+    }
+    // 读取表的版本时不持有latch_
+    if (is_valid(*entry)) {
+        return entry;
+    }
+    erase(key);
+    return nullptr;
+}
+
+/**
+ * @description: select执行之前记录它读取的表和表中数据的版本，执行完成后由insert()保存结果
+ * @return {bool} 语句的结果是否可以缓存，只有select的结果可以缓存
+ * @param {shared_ptr<Plan>&} plan 语句的计划
+ * @param {uint64_t} schema_version 生成计划之前读取的schema_version_
+ * @param {CachedResult*} entry 记录语句读取的表和版本
+ */
+bool ResultCache::prepare(const std::shared_ptr<Plan> &plan, uint64_t schema_version, CachedResult *entry) {
+    auto dml = std::dynamic_pointer_cast<DMLPlan>(plan);
+    if (dml == nullptr || dml->tag != T_select) {
+        return false;
+    }
+    std::vector<int> tables;
+    collect_tables(dml->subplan_, &tables);
+    entry->schema_version = schema_version;
+    entry->tables.clear();
+    for (int tab_id : tables) {
+        uint64_t version;
+        timestamp_t last_commit_ts;
+        if (!sm_manager_->get_data_version(tab_id, &version, &last_commit_ts)) {
+            return false;
+        }
+        entry->tables.emplace_back(tab_id, version);
+    }
+    return true;
+}
+
+/**
+ * @description: 保存一条select的结果。执行期间表中数据发生变化，或者语句的快照看不到已经结束的事务对表的修改时不保存
+ * @return {bool} 是否保存了结果
+ * @param {shared_ptr<CachedResult>} entry prepare()记录了版本、之后填入结果帧和日志文本的结果
+ * @param {timestamp_t} start_ts 语句所在事务的开始时间戳，即读取的快照
+ */
+bool ResultCache::insert(std::shared_ptr<CachedResult> entry, timestamp_t start_ts) {
+    size_t entry_bytes = entry->bytes();
+    if (entry_bytes > RESULT_CACHE_MAX_ENTRY_BYTES || entry_bytes > capacity_) {
+        return false;
+    }
+    for (auto &[tab_id, version] : entry->tables) {
+        uint64_t current;
+        timestamp_t last_commit_ts;
+        if (!sm_manager_->get_data_version(tab_id, &current, &last_commit_ts) || current != version ||
+            last_commit_ts >= start_ts) {
+            return false;
+        }
+    }
+    if (entry->schema_version != sm_manager_->schema_version_) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(latch_);
+    auto it = entries_.find(entry->key);
+    if (it != entries_.end()) {
+        bytes_ -= (*it->second)->bytes();
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+    lru_.push_front(entry);
+    entries_[entry->key] = lru_.begin();
+    bytes_ += entry_bytes;
+    while (bytes_ > capacity_) {
+        bytes_ -= lru_.back()->bytes();
+        entries_.erase(lru_.back()->key);
+        lru_.pop_back();
+    }
+    return true;
+}
+
+size_t ResultCache::size() {
+    std::lock_guard<std::mutex> guard(latch_);
+    return lru_.size();
+}
+
+size_t ResultCache::bytes() {
+    std::lock_guard<std::mutex> guard(latch_);
+    return bytes_;
+}
+
+// schema和语句读取的每张表中的数据都没有变化
+bool ResultCache::is_valid(const CachedResult &entry) {
+    if (entry.schema_version != sm_manager_->schema_version_) {
+        return false;
+    }
+    for (auto &[tab_id, version] : entry.tables) {
+        uint64_t current;
+        timestamp_t last_commit_ts;
+        if (!sm_manager_->get_data_version(tab_id, &current, &last_commit_ts) || current != version) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ResultCache::erase(const std::string &key) {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        bytes_ -= (*it->second)->bytes();
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+}
+
+// 收集计划中扫描的所有表，同一张表只记录一次，分区表记录扫描的分区
+void ResultCache::collect_tables(const std::shared_ptr<Plan> &plan, std::vector<int> *tables) {
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        // 分区表中的数据保存在各个分区中，只有扫描的分区中的数据变化才使结果失效
+        std::vector<int> tab_ids;
+        for (auto partition : x->partitions_) {
+            tab_ids.push_back(partition->tab->id);
+        }
+        if (tab_ids.empty()) {
+            tab_ids.push_back(x->table_->tab->id);
+        }
+        for (int tab_id : tab_ids) {
+            if (std::find(tables->begin(), tables->end(), tab_id) == tables->end()) {
+                tables->push_back(tab_id);
+            }
+        }
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        collect_tables(x->left_, tables);
+        collect_tables(x->right_, tables);
+    } else if (auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)) {
+        collect_tables(x->subplan_, tables);
+    } else if (auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
+        collect_tables(x->subplan_, tables);
+    } else if (auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+        collect_tables(x->subplan_, tables);
+    } else if (auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+        collect_tables(x->subplan_, tables);
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/common.h"
+#include "system/sm.h"
+#include "plan.h"
+
+// 结果缓存中一条select的结果
+struct CachedResult {
+    std::string key;                // 规范化后的语句文本或预编译语句和参数的值，见ResultCache::make_key()
+    uint64_t schema_version = 0;    // 生成计划之前SmManager的schema_version_
+    std::vector<std::pair<int, uint64_t>> tables;  // 语句读取的表的编号和执行之前表中数据的版本
+    std::string frames;             // 发送给客户端的全部结果帧，包括结束的空帧
+    std::string log_text;           // 写入结果日志的文本
+
+    size_t bytes() const { return key.size() + frames.size() + log_text.size() + sizeof(CachedResult); }
+};
+
+/* 自动提交的select的结果缓存，所有连接共享，超过RESULT_CACHE_BYTES时淘汰最久未使用的结果。
+   写入表的语句和修改过表的事务结束时递增表中数据的版本，DDL递增schema_version_，
+   查找时任何一个版本变化就丢弃缓存的结果。命中时不再生成计划和执行，直接把保存的结果帧发送给客户端 */
+class ResultCache {
+   private:
+    SmManager *sm_manager_;
+    size_t capacity_;
+    size_t bytes_ = 0;      // 缓存的结果占用的字节数
+    std::mutex latch_;      // 保护lru_、entries_和bytes_
+    std::list<std::shared_ptr<const CachedResult>> lru_;    // 表头为最近使用的结果
+    std::unordered_map<std::string, std::list<std::shared_ptr<const CachedResult>>::iterator> entries_;
+
+   public:
+    ResultCache(SmManager *sm_manager, size_t capacity = RESULT_CACHE_BYTES)
+        : sm_manager_(sm_manager), capacity_(capacity) {}
+
+    static std::string make_key(const std::string &sql, const std::vector<Value> &args, bool binary_result);
+
+    std::shared_ptr<const CachedResult> lookup(const std::string &key);
+
+    bool prepare(const std::shared_ptr<Plan> &plan, uint64_t schema_version, CachedResult *entry);
+
+    bool insert(std::shared_ptr<CachedResult> entry, timestamp_t start_ts);
+
+    size_t size();
+
+    size_t bytes();
+
+   private:
+    bool is_valid(const CachedResult &entry);
+
+    void erase(const std::string &key);
+
+    static void collect_tables(const std::shared_ptr<Plan> &plan, std::vector<int> *tables);
+};
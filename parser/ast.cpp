@@ -1,7 +1 @@
 #include "ast.h"
-
-namespace ast {
-
-std::shared_ptr<TreeNode> parse_tree;
-
-}
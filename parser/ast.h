@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <utility>
 
 enum JoinType {
     INNER_JOIN, LEFT_JOIN, RIGHT_JOIN, FULL_JOIN
@@ -10,13 +11,17 @@ enum JoinType {
 namespace ast {
 
 enum SvType {
-    SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING
+    SV_TYPE_INT, SV_TYPE_FLOAT, SV_TYPE_STRING, SV_TYPE_VARCHAR
 };
 
 enum SvCompOp {
     SV_OP_EQ, SV_OP_NE, SV_OP_LT, SV_OP_GT, SV_OP_LE, SV_OP_GE
 };
 
+enum SvAggFunc {
+    SV_AGG_COUNT, SV_AGG_SUM, SV_AGG_MIN, SV_AGG_MAX, SV_AGG_AVG
+};
+
 enum OrderByDir {
     OrderBy_DEFAULT,
     OrderBy_ASC,
@@ -34,6 +39,9 @@ struct Help : public TreeNode {
 struct ShowTables : public TreeNode {
 };
 
+struct ShowStats : public TreeNode {
+};
+
 struct TxnBegin : public TreeNode {
 };
 
@@ -64,12 +72,18 @@ struct ColDef : public Field {
             col_name(std::move(col_name_)), type_len(std::move(type_len_)) {}
 };
 
+struct PartitionClause;
+
+// CREATE TABLE name (fields) [WITH (option = value, ...)] [PARTITION BY ...]
 struct CreateTable : public TreeNode {
     std::string tab_name;
     std::vector<std::shared_ptr<Field>> fields;
+    std::vector<std::pair<std::string, std::string>> options;   // WITH子句中的表选项
+    std::shared_ptr<PartitionClause> partition;                 // 分区方式，不分区时为空
 
-    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_) :
-            tab_name(std::move(tab_name_)), fields(std::move(fields_)) {}
+    CreateTable(std::string tab_name_, std::vector<std::shared_ptr<Field>> fields_,
+                std::vector<std::pair<std::string, std::string>> options_ = {}) :
+            tab_name(std::move(tab_name_)), fields(std::move(fields_)), options(std::move(options_)) {}
 };
 
 struct DropTable : public TreeNode {
@@ -84,12 +98,35 @@ struct DescTable : public TreeNode {
     DescTable(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
 };
 
+struct AnalyzeStmt : public TreeNode {
+    std::string tab_name;
+
+    AnalyzeStmt(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
+struct VacuumStmt : public TreeNode {
+    std::string tab_name;
+
+    VacuumStmt(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
+// COPY t FROM 'file.csv'，从CSV文件批量导入记录
+struct CopyStmt : public TreeNode {
+    std::string tab_name;
+    std::string file_name;
+
+    CopyStmt(std::string tab_name_, std::string file_name_) :
+            tab_name(std::move(tab_name_)), file_name(std::move(file_name_)) {}
+};
+
+// CREATE INDEX t (cols) [USING method]，method为btree或hash，省略时为btree
 struct CreateIndex : public TreeNode {
     std::string tab_name;
     std::vector<std::string> col_names;
+    std::string method;
 
-    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_) :
-            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)) {}
+    CreateIndex(std::string tab_name_, std::vector<std::string> col_names_, std::string method_ = "") :
+            tab_name(std::move(tab_name_)), col_names(std::move(col_names_)), method(std::move(method_)) {}
 };
 
 struct DropIndex : public TreeNode {
@@ -124,6 +161,13 @@ struct StringLit : public Value {
     StringLit(std::string val_) : val(std::move(val_)) {}
 };
 
+// 预编译语句中的参数$n，idx为n-1
+struct Param : public Value {
+    int idx;
+
+    Param(int idx_) : idx(idx_) {}
+};
+
 struct Col : public Expr {
     std::string tab_name;
     std::string col_name;
@@ -132,6 +176,27 @@ struct Col : public Expr {
             tab_name(std::move(tab_name_)), col_name(std::move(col_name_)) {}
 };
 
+// select列表中的聚合函数，COUNT(*)的字段名为"*"
+struct AggCol : public Col {
+    SvAggFunc func;
+
+    AggCol(SvAggFunc func_, std::shared_ptr<Col> col_) :
+            Col(col_->tab_name, col_->col_name), func(func_) {}
+};
+
+// PARTITION BY RANGE (col) (bound, ...) 或 PARTITION BY HASH (col) PARTITIONS n
+struct PartitionClause : public TreeNode {
+    std::string method;
+    std::string col_name;
+    std::vector<std::shared_ptr<Value>> bounds;     // RANGE分区的上界，n个上界分出n+1个分区
+    int num_partitions = 0;                         // HASH分区的分区数
+
+    PartitionClause(std::string method_, std::string col_name_, std::vector<std::shared_ptr<Value>> bounds_,
+                    int num_partitions_ = 0) :
+            method(std::move(method_)), col_name(std::move(col_name_)), bounds(std::move(bounds_)),
+            num_partitions(num_partitions_) {}
+};
+
 struct SetClause : public TreeNode {
     std::string col_name;
     std::shared_ptr<Value> val;
@@ -157,12 +222,13 @@ struct OrderBy : public TreeNode
        cols(std::move(cols_)), orderby_dir(std::move(orderby_dir_)) {}
 };
 
+// INSERT INTO t VALUES (...), (...)，一条语句可以插入多行
 struct InsertStmt : public TreeNode {
     std::string tab_name;
-    std::vector<std::shared_ptr<Value>> vals;
+    std::vector<std::vector<std::shared_ptr<Value>>> rows;
 
-    InsertStmt(std::string tab_name_, std::vector<std::shared_ptr<Value>> vals_) :
-            tab_name(std::move(tab_name_)), vals(std::move(vals_)) {}
+    InsertStmt(std::string tab_name_, std::vector<std::vector<std::shared_ptr<Value>>> rows_) :
+            tab_name(std::move(tab_name_)), rows(std::move(rows_)) {}
 };
 
 struct DeleteStmt : public TreeNode {
@@ -200,28 +266,73 @@ struct SelectStmt : public TreeNode {
     std::vector<std::string> tabs;
     std::vector<std::shared_ptr<BinaryExpr>> conds;
     std::vector<std::shared_ptr<JoinExpr>> jointree;
+    std::vector<std::shared_ptr<Col>> group_by;     // GROUP BY的字段
 
     
     bool has_sort;
-    std::shared_ptr<OrderBy> order;
+    std::vector<std::shared_ptr<OrderBy>> orders;   // ORDER BY的排序键，按优先级从高到低
+    int limit;                                      // LIMIT的行数，-1表示没有LIMIT
 
 
     SelectStmt(std::vector<std::shared_ptr<Col>> cols_,
                std::vector<std::string> tabs_,
                std::vector<std::shared_ptr<BinaryExpr>> conds_,
-               std::shared_ptr<OrderBy> order_) :
+               std::vector<std::shared_ptr<Col>> group_by_,
+               std::vector<std::shared_ptr<OrderBy>> orders_,
+               int limit_ = -1) :
             cols(std::move(cols_)), tabs(std::move(tabs_)), conds(std::move(conds_)), 
-            order(std::move(order_)) {
-                has_sort = (bool)order;
+            group_by(std::move(group_by_)), orders(std::move(orders_)), limit(limit_) {
+                has_sort = !orders.empty();
             }
 };
 
+// SET name = value，设置当前连接的选项
+struct SetStmt : public TreeNode {
+    std::string name;
+    std::string value;
+
+    SetStmt(std::string name_, std::string value_) : name(std::move(name_)), value(std::move(value_)) {}
+};
+
+// PREPARE name AS stmt，stmt中的值可以是参数$n
+struct PrepareStmt : public TreeNode {
+    std::string name;
+    std::shared_ptr<TreeNode> stmt;
+
+    PrepareStmt(std::string name_, std::shared_ptr<TreeNode> stmt_) :
+            name(std::move(name_)), stmt(std::move(stmt_)) {}
+};
+
+// EXPLAIN [ANALYZE] stmt，ANALYZE时执行stmt并输出每个算子的执行统计
+struct ExplainStmt : public TreeNode {
+    std::shared_ptr<TreeNode> stmt;
+    bool analyze;
+
+    ExplainStmt(std::shared_ptr<TreeNode> stmt_, bool analyze_) : stmt(std::move(stmt_)), analyze(analyze_) {}
+};
+
+// EXECUTE name (v1, v2, ...)，vals依次绑定到参数$1, $2, ...
+struct ExecuteStmt : public TreeNode {
+    std::string name;
+    std::vector<std::shared_ptr<Value>> vals;
+
+    ExecuteStmt(std::string name_, std::vector<std::shared_ptr<Value>> vals_) :
+            name(std::move(name_)), vals(std::move(vals_)) {}
+};
+
+struct DeallocateStmt : public TreeNode {
+    std::string name;
+
+    DeallocateStmt(std::string name_) : name(std::move(name_)) {}
+};
+
 // Semantic value
 struct SemValue {
     int sv_int;
     float sv_float;
     std::string sv_str;
     OrderByDir sv_orderby_dir;
+    SvAggFunc sv_agg_func;
     std::vector<std::string> sv_strs;
 
     std::shared_ptr<TreeNode> sv_node;
@@ -237,6 +348,7 @@ struct SemValue {
 
     std::shared_ptr<Value> sv_val;
     std::vector<std::shared_ptr<Value>> sv_vals;
+    std::vector<std::vector<std::shared_ptr<Value>>> sv_rows;
 
     std::shared_ptr<Col> sv_col;
     std::vector<std::shared_ptr<Col>> sv_cols;
@@ -248,9 +360,12 @@ struct SemValue {
     std::vector<std::shared_ptr<BinaryExpr>> sv_conds;
 
     std::shared_ptr<OrderBy> sv_orderby;
-};
+    std::vector<std::shared_ptr<OrderBy>> sv_orderbys;
+
+    std::vector<std::pair<std::string, std::string>> sv_options;
 
-extern std::shared_ptr<ast::TreeNode> parse_tree;
+    std::shared_ptr<PartitionClause> sv_partition;
+};
 
 }
 
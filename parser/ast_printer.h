@@ -37,6 +37,7 @@ private:
                 {SV_TYPE_INT,    "INT"},
                 {SV_TYPE_FLOAT,  "FLOAT"},
                 {SV_TYPE_STRING, "STRING"},
+                {SV_TYPE_VARCHAR, "VARCHAR"},
         };
         return m.at(type);
     }
@@ -70,22 +71,39 @@ private:
             std::cout << "HELP\n";
         } else if (auto x = std::dynamic_pointer_cast<ShowTables>(node)) {
             std::cout << "SHOW_TABLES\n";
+        } else if (auto x = std::dynamic_pointer_cast<ShowStats>(node)) {
+            std::cout << "SHOW_STATS\n";
         } else if (auto x = std::dynamic_pointer_cast<CreateTable>(node)) {
             std::cout << "CREATE_TABLE\n";
             print_val(x->tab_name, offset);
             print_node_list(x->fields, offset);
+            for (auto &option : x->options) {
+                print_val(option.first + " = " + option.second, offset);
+            }
         } else if (auto x = std::dynamic_pointer_cast<DropTable>(node)) {
             std::cout << "DROP_TABLE\n";
             print_val(x->tab_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<DescTable>(node)) {
             std::cout << "DESC_TABLE\n";
             print_val(x->tab_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<AnalyzeStmt>(node)) {
+            std::cout << "ANALYZE\n";
+            print_val(x->tab_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<VacuumStmt>(node)) {
+            std::cout << "VACUUM\n";
+            print_val(x->tab_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<CopyStmt>(node)) {
+            std::cout << "COPY\n";
+            print_val(x->tab_name, offset);
+            print_val(x->file_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<CreateIndex>(node)) {
             std::cout << "CREATE_INDEX\n";
             print_val(x->tab_name, offset);
             // print_val(x->col_name, offset);
             for(auto col_name: x->col_names)
                 print_val(col_name, offset);
+            if (!x->method.empty())
+                print_val(x->method, offset);
         } else if (auto x = std::dynamic_pointer_cast<DropIndex>(node)) {
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
@@ -113,6 +131,9 @@ private:
         } else if (auto x = std::dynamic_pointer_cast<StringLit>(node)) {
             std::cout << "STRING_LIT\n";
             print_val(x->val, offset);
+        } else if (auto x = std::dynamic_pointer_cast<Param>(node)) {
+            std::cout << "PARAM\n";
+            print_val(x->idx + 1, offset);
         } else if (auto x = std::dynamic_pointer_cast<SetClause>(node)) {
             std::cout << "SET_CLAUSE\n";
             print_val(x->col_name, offset);
@@ -125,7 +146,9 @@ private:
         } else if (auto x = std::dynamic_pointer_cast<InsertStmt>(node)) {
             std::cout << "INSERT\n";
             print_val(x->tab_name, offset);
-            print_node_list(x->vals, offset);
+            for (auto &row : x->rows) {
+                print_node_list(row, offset);
+            }
         } else if (auto x = std::dynamic_pointer_cast<DeleteStmt>(node)) {
             std::cout << "DELETE\n";
             print_val(x->tab_name, offset);
@@ -140,6 +163,24 @@ private:
             print_node_list(x->cols, offset);
             print_val_list(x->tabs, offset);
             print_node_list(x->conds, offset);
+        } else if (auto x = std::dynamic_pointer_cast<SetStmt>(node)) {
+            std::cout << "SET\n";
+            print_val(x->name, offset);
+            print_val(x->value, offset);
+        } else if (auto x = std::dynamic_pointer_cast<PrepareStmt>(node)) {
+            std::cout << "PREPARE\n";
+            print_val(x->name, offset);
+            print_node(x->stmt, offset);
+        } else if (auto x = std::dynamic_pointer_cast<ExplainStmt>(node)) {
+            std::cout << (x->analyze ? "EXPLAIN_ANALYZE\n" : "EXPLAIN\n");
+            print_node(x->stmt, offset);
+        } else if (auto x = std::dynamic_pointer_cast<ExecuteStmt>(node)) {
+            std::cout << "EXECUTE\n";
+            print_val(x->name, offset);
+            print_node_list(x->vals, offset);
+        } else if (auto x = std::dynamic_pointer_cast<DeallocateStmt>(node)) {
+            std::cout << "DEALLOCATE\n";
+            print_val(x->name, offset);
         } else if (auto x = std::dynamic_pointer_cast<TxnBegin>(node)) {
             std::cout << "BEGIN\n";
         } else if (auto x = std::dynamic_pointer_cast<TxnCommit>(node)) {
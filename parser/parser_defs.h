@@ -1,11 +1,24 @@
 #pragma once
 
+#include <memory>
+
+#include "ast.h"
 #include "defs.h"
 
-int yyparse();
+// flex生成的可重入scanner的句柄
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+int yyparse(yyscan_t scanner, std::shared_ptr<ast::TreeNode> &parse_tree);
+
+int yylex_init(yyscan_t *scanner);
+
+int yylex_destroy(yyscan_t scanner);
 
 typedef struct yy_buffer_state *YY_BUFFER_STATE;
 
-YY_BUFFER_STATE yy_scan_string(const char *str);
+YY_BUFFER_STATE yy_scan_string(const char *str, yyscan_t scanner);
 
-void yy_delete_buffer(YY_BUFFER_STATE buffer);
+void yy_delete_buffer(YY_BUFFER_STATE buffer, yyscan_t scanner);
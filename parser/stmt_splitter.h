@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+ * @description: 从pos开始查找下一个结束语句的分号，字符串常量和注释中的分号不作为语句的结束
+ * @return {size_t} 分号的位置，没有时返回len
+ */
+inline size_t find_semicolon(const char *data, size_t len, size_t pos) {
+    while (pos < len) {
+        char c = data[pos];
+        if (c == '\'') {
+            // 字符串常量中没有转义，直到下一个单引号结束
+            while (++pos < len && data[pos] != '\'') {
+            }
+        } else if (c == '-' && pos + 1 < len && data[pos + 1] == '-') {
+            while (pos < len && data[pos] != '\n') {
+                pos++;
+            }
+            continue;
+        } else if (c == '/' && pos + 1 < len && data[pos + 1] == '*') {
+            pos += 2;
+            while (pos + 1 < len && !(data[pos] == '*' && data[pos + 1] == '/')) {
+                pos++;
+            }
+            pos++;
+        } else if (c == ';') {
+            return pos;
+        }
+        pos++;
+    }
+    return len;
+}
+
+/**
+ * @description: 把客户端一次发送的请求按分号拆分为多条语句，字符串常量和注释中的分号不作为语句的结束。
+ *               只包含空白的片段被忽略，最后一个分号之后的内容不属于任何语句，由调用者决定如何处理
+ * @return {size_t} 已经拆分的字节数，即最后一条完整语句的结束位置
+ * @param {char*} data 请求的内容
+ * @param {size_t} len 请求的长度
+ * @param {vector<string>&} stmts 拆分得到的语句，每条语句包含结尾的分号
+ */
+inline size_t split_statements(const char *data, size_t len, std::vector<std::string> &stmts) {
+    size_t begin = 0;
+    for (size_t pos = find_semicolon(data, len, 0); pos < len; pos = find_semicolon(data, len, begin)) {
+        size_t first = begin;
+        while (first < pos && std::isspace(static_cast<unsigned char>(data[first]))) {
+            first++;
+        }
+        if (first < pos) {
+            stmts.emplace_back(data + first, pos + 1 - first);
+        }
+        begin = pos + 1;
+    }
+    return begin;
+}
+
+/*
+RequestBuffer把一个连接上多次读取的数据组成完整的语句
+1. 数据中有分号时按分号拆分，最后一个分号之后不完整的语句留在缓冲区开头，与之后读到的数据拼接
+2. 数据中没有分号、也没有留下的语句时(每次请求只发送一条不带分号的语句的客户端)，读到的全部内容作为一条语句
+3. 一条语句超过缓冲区时不执行它的任何部分，由调用者报告错误，之后读到的数据中它剩余的部分被丢弃：
+   有分号时丢弃到下一个分号，没有分号时丢弃到这次请求结束，即某次读取没有读满缓冲区
+*/
+class RequestBuffer {
+   public:
+    explicit RequestBuffer(size_t capacity) : capacity_(capacity), data_(capacity + 1) {}
+
+    // 下一次读取的数据写入的位置和最多可写入的字节数
+    char *space() { return data_.data() + len_; }
+
+    size_t space_left() const { return capacity_ - len_; }
+
+    /**
+     * @description: 在space()处写入n个字节后，取出缓冲区中所有完整的语句
+     * @return {bool} 最后一条语句是否超过了缓冲区，它不在stmts中，剩余的部分会被丢弃
+     * @param {size_t} n 写入的字节数
+     * @param {vector<string>&} stmts 取出的语句，按顺序追加
+     */
+    bool consume(size_t n, std::vector<std::string> &stmts) {
+        size_t len = len_ + n;
+        bool full = len == capacity_;
+        bool semicolon = len_ > 0;      // 留下的语句所在的请求中有分号
+        len_ = 0;
+        size_t begin = 0;
+        if (discard_ != Discard::NONE) {
+            size_t end = find_semicolon(data_.data(), len, 0);
+            if (end == len) {
+                if (discard_ == Discard::TO_END_OF_REQUEST && !full) {
+                    discard_ = Discard::NONE;
+                }
+                return false;
+            }
+            // 分号结束被丢弃的语句，之后的内容照常拆分
+            discard_ = Discard::NONE;
+            semicolon = true;
+            begin = end + 1;
+        }
+        const char *data = data_.data() + begin;
+        len -= begin;
+        size_t consumed = split_statements(data, len, stmts);
+        std::string tail(data + consumed, len - consumed);
+        if (tail.find_first_not_of(" \t\r\n") == std::string::npos) {
+            return false;
+        }
+        if (consumed > 0 || semicolon) {
+            if (begin + consumed == 0 && full) {
+                discard_ = Discard::TO_SEMICOLON;
+                return true;
+            }
+            memmove(data_.data(), data + consumed, tail.size());
+            len_ = tail.size();
+            return false;
+        }
+        if (full) {
+            discard_ = Discard::TO_END_OF_REQUEST;
+            return true;
+        }
+        stmts.push_back(std::move(tail));
+        return false;
+    }
+
+   private:
+    enum class Discard { NONE, TO_SEMICOLON, TO_END_OF_REQUEST };
+
+    size_t capacity_;
+    std::vector<char> data_;
+    size_t len_ = 0;                    // 缓冲区开头留下的不完整语句的长度
+    Discard discard_ = Discard::NONE;   // 正在丢弃超过缓冲区的语句剩余的部分
+};
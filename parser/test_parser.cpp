@@ -15,28 +15,47 @@ int main() {
         "drop index tb(a, b, c);",
         "drop index tb(b);",
         "insert into tb values (1, 3.14, 'pi');",
+        "insert into tb values (1, 3.14, 'pi'), (2, 2.72, 'e'), ($1, 1.41, $2);",
+        "copy tb from 'tb.csv';",
         "delete from tb where a = 1;",
         "update tb set a = 1, b = 2.2, c = 'xyz' where x = 2 and y < 1.1 and z > 'abc';",
         "select * from tb;",
         "select * from tb where x <> 2 and y >= 3. and z <= '123' and b < tb.a;",
         "select x.a, y.b from x, y where x.a = y.b and c = d;",
         "select x.a, y.b from x join y where x.a = y.b and c = d;",
+        "prepare q as select * from tb where a = $1 and c > $2;",
+        "prepare ins as insert into tb values ($1, 3.14, $2);",
+        "execute q (1, 'abc');",
+        "execute ins;",
+        "deallocate q;",
+        "set result_format = binary;",
+        // 不保留的关键字可以作为表名、列名等标识符
+        "create table stats (count int, sum float, min int, max int, avg int, with char(4));",
+        "select count, sum(count), max(stats.max) from stats where analyze = 1 group by count;",
+        "select count(*) from partition join copy where partition.using = copy.execute;",
+        "create index stats(count, sum) using btree;",
+        "update stats set with = 'abc' where min < 1;",
+        "prepare explain as select avg from stats;",
+        "execute explain;",
         "exit;",
         "help;",
         "",
     };
+    yyscan_t scanner;
+    yylex_init(&scanner);
     for (auto &sql : sqls) {
         std::cout << sql << std::endl;
-        YY_BUFFER_STATE buf = yy_scan_string(sql.c_str());
-        assert(yyparse() == 0);
-        if (ast::parse_tree != nullptr) {
-            ast::TreePrinter::print(ast::parse_tree);
-            yy_delete_buffer(buf);
+        std::shared_ptr<ast::TreeNode> parse_tree;
+        YY_BUFFER_STATE buf = yy_scan_string(sql.c_str(), scanner);
+        assert(yyparse(scanner, parse_tree) == 0);
+        yy_delete_buffer(buf, scanner);
+        if (parse_tree != nullptr) {
+            ast::TreePrinter::print(parse_tree);
             std::cout << std::endl;
         } else {
             std::cout << "exit/EOF" << std::endl;
         }
     }
-    ast::parse_tree.reset();
+    yylex_destroy(scanner);
     return 0;
 }
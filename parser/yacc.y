@@ -4,17 +4,28 @@
 #include <iostream>
 #include <memory>
 
-int yylex(YYSTYPE *yylval, YYLTYPE *yylloc);
+int yylex(YYSTYPE *yylval, YYLTYPE *yylloc, yyscan_t scanner);
 
-void yyerror(YYLTYPE *locp, const char* s) {
+void yyerror(YYLTYPE *locp, yyscan_t scanner, std::shared_ptr<ast::TreeNode> &parse_tree, const char* s) {
     std::cerr << "Parser Error at line " << locp->first_line << " column " << locp->first_column << ": " << s << std::endl;
 }
 
 using namespace ast;
 %}
 
+%code requires {
+// 可重入的scanner的句柄，与flex生成的定义相同
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
+
 // request a pure (reentrant) parser
 %define api.pure full
+// scanner state and parse result are passed in by the caller instead of globals
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {std::shared_ptr<ast::TreeNode> &parse_tree}
 // enable location in error handler
 %locations
 // enable verbose syntax error message
@@ -22,17 +33,21 @@ using namespace ast;
 
 // keywords
 %token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM ASC ORDER BY
-WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY
+WHERE UPDATE SET SELECT INT CHAR VARCHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK ORDER_BY LIMIT
+GROUP AS
+// non-reserved keywords, the scanner passes their text so they can also be used as identifiers
+%token <sv_str> STATS COUNT SUM MIN MAX AVG ANALYZE VACUUM EXPLAIN COPY PREPARE EXECUTE DEALLOCATE WITH USING PARTITION
+PARTITIONS
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
 // type-specific tokens
 %token <sv_str> IDENTIFIER VALUE_STRING
-%token <sv_int> VALUE_INT
+%token <sv_int> VALUE_INT PARAM
 %token <sv_float> VALUE_FLOAT
 
 // specify types for non-terminal symbol
-%type <sv_node> stmt dbStmt ddl dml txnStmt
+%type <sv_node> stmt dbStmt ddl dml txnStmt prepareStmt explainStmt
 %type <sv_field> field
 %type <sv_fields> fieldList
 %type <sv_type_len> type
@@ -40,16 +55,23 @@ WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_CO
 %type <sv_expr> expr
 %type <sv_val> value
 %type <sv_vals> valueList
-%type <sv_str> tbName colName
+%type <sv_rows> valueRows
+%type <sv_str> tbName colName identifier unreservedKeyword
 %type <sv_strs> tableList colNameList
 %type <sv_col> col
-%type <sv_cols> colList selector
+%type <sv_cols> colList selector selList opt_group_clause
+%type <sv_col> selItem
+%type <sv_agg_func> aggFunc
 %type <sv_set_clause> setClause
 %type <sv_set_clauses> setClauses
+%type <sv_options> optionList
+%type <sv_partition> opt_partition_clause
 %type <sv_cond> condition
 %type <sv_conds> whereClause optWhereClause
-%type <sv_orderby>  order_clause opt_order_clause
+%type <sv_orderby>  order_item
+%type <sv_orderbys> order_clause opt_order_clause
 %type <sv_orderby_dir> opt_asc_desc
+%type <sv_int> opt_limit_clause
 
 %%
 start:
@@ -80,6 +102,8 @@ stmt:
     |   ddl
     |   dml
     |   txnStmt
+    |   prepareStmt
+    |   explainStmt
     ;
 
 txnStmt:
@@ -101,17 +125,67 @@ txnStmt:
     }
     ;
 
+prepareStmt:
+        PREPARE identifier AS dml
+    {
+        $$ = std::make_shared<PrepareStmt>($2, $4);
+    }
+    |   EXECUTE identifier
+    {
+        $$ = std::make_shared<ExecuteStmt>($2, std::vector<std::shared_ptr<Value>>());
+    }
+    |   EXECUTE identifier '(' valueList ')'
+    {
+        $$ = std::make_shared<ExecuteStmt>($2, $4);
+    }
+    |   DEALLOCATE identifier
+    {
+        $$ = std::make_shared<DeallocateStmt>($2);
+    }
+    ;
+
+explainStmt:
+        EXPLAIN dml
+    {
+        $$ = std::make_shared<ExplainStmt>($2, false);
+    }
+    |   EXPLAIN ANALYZE dml
+    {
+        $$ = std::make_shared<ExplainStmt>($3, true);
+    }
+    ;
+
 dbStmt:
         SHOW TABLES
     {
         $$ = std::make_shared<ShowTables>();
     }
+    |   SHOW STATS
+    {
+        $$ = std::make_shared<ShowStats>();
+    }
+    |   SET identifier '=' identifier
+    {
+        $$ = std::make_shared<SetStmt>($2, $4);
+    }
+    |   SET identifier '=' VALUE_INT
+    {
+        $$ = std::make_shared<SetStmt>($2, std::to_string($4));
+    }
     ;
 
 ddl:
-        CREATE TABLE tbName '(' fieldList ')'
+        CREATE TABLE tbName '(' fieldList ')' opt_partition_clause
     {
-        $$ = std::make_shared<CreateTable>($3, $5);
+        auto create = std::make_shared<CreateTable>($3, $5);
+        create->partition = $7;
+        $$ = create;
+    }
+    |   CREATE TABLE tbName '(' fieldList ')' WITH '(' optionList ')' opt_partition_clause
+    {
+        auto create = std::make_shared<CreateTable>($3, $5, $9);
+        create->partition = $11;
+        $$ = create;
     }
     |   DROP TABLE tbName
     {
@@ -121,10 +195,26 @@ ddl:
     {
         $$ = std::make_shared<DescTable>($2);
     }
+    |   ANALYZE tbName
+    {
+        $$ = std::make_shared<AnalyzeStmt>($2);
+    }
+    |   VACUUM tbName
+    {
+        $$ = std::make_shared<VacuumStmt>($2);
+    }
+    |   COPY tbName FROM VALUE_STRING
+    {
+        $$ = std::make_shared<CopyStmt>($2, $4);
+    }
     |   CREATE INDEX tbName '(' colNameList ')'
     {
         $$ = std::make_shared<CreateIndex>($3, $5);
     }
+    |   CREATE INDEX tbName '(' colNameList ')' USING identifier
+    {
+        $$ = std::make_shared<CreateIndex>($3, $5, $8);
+    }
     |   DROP INDEX tbName '(' colNameList ')'
     {
         $$ = std::make_shared<DropIndex>($3, $5);
@@ -132,9 +222,9 @@ ddl:
     ;
 
 dml:
-        INSERT INTO tbName VALUES '(' valueList ')'
+        INSERT INTO tbName VALUES valueRows
     {
-        $$ = std::make_shared<InsertStmt>($3, $6);
+        $$ = std::make_shared<InsertStmt>($3, $5);
     }
     |   DELETE FROM tbName optWhereClause
     {
@@ -144,9 +234,9 @@ dml:
     {
         $$ = std::make_shared<UpdateStmt>($2, $4, $5);
     }
-    |   SELECT selector FROM tableList optWhereClause opt_order_clause
+    |   SELECT selector FROM tableList optWhereClause opt_group_clause opt_order_clause opt_limit_clause
     {
-        $$ = std::make_shared<SelectStmt>($2, $4, $5, $6);
+        $$ = std::make_shared<SelectStmt>($2, $4, $5, $6, $7, $8);
     }
     ;
 
@@ -188,12 +278,27 @@ type:
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_STRING, $3);
     }
+    |   VARCHAR '(' VALUE_INT ')'
+    {
+        $$ = std::make_shared<TypeLen>(SV_TYPE_VARCHAR, $3);
+    }
     |   FLOAT
     {
         $$ = std::make_shared<TypeLen>(SV_TYPE_FLOAT, sizeof(float));
     }
     ;
 
+valueRows:
+        '(' valueList ')'
+    {
+        $$ = std::vector<std::vector<std::shared_ptr<Value>>>{$2};
+    }
+    |   valueRows ',' '(' valueList ')'
+    {
+        $$.push_back($4);
+    }
+    ;
+
 valueList:
         value
     {
@@ -218,6 +323,14 @@ value:
     {
         $$ = std::make_shared<StringLit>($1);
     }
+    |   PARAM
+    {
+        if ($1 < 1) {
+            yyerror(&@1, scanner, parse_tree, "parameter number must start from $1");
+            YYERROR;
+        }
+        $$ = std::make_shared<Param>($1 - 1);
+    }
     ;
 
 condition:
@@ -306,6 +419,29 @@ expr:
     }
     ;
 
+optionList:
+        identifier '=' identifier
+    {
+        $$ = std::vector<std::pair<std::string, std::string>>{{$1, $3}};
+    }
+    |   optionList ',' identifier '=' identifier
+    {
+        $$.emplace_back($3, $5);
+    }
+    ;
+
+opt_partition_clause:
+        PARTITION BY identifier '(' colName ')' '(' valueList ')'
+    {
+        $$ = std::make_shared<PartitionClause>($3, $5, $8);
+    }
+    |   PARTITION BY identifier '(' colName ')' PARTITIONS VALUE_INT
+    {
+        $$ = std::make_shared<PartitionClause>($3, $5, std::vector<std::shared_ptr<Value>>(), $8);
+    }
+    |   /* epsilon */ { $$ = nullptr; }
+    ;
+
 setClauses:
         setClause
     {
@@ -329,7 +465,41 @@ selector:
     {
         $$ = {};
     }
-    |   colList
+    |   selList
+    ;
+
+selList:
+        selItem
+    {
+        $$ = std::vector<std::shared_ptr<Col>>{$1};
+    }
+    |   selList ',' selItem
+    {
+        $$.push_back($3);
+    }
+    ;
+
+selItem:
+        col
+    |   COUNT '(' '*' ')'
+    {
+        $$ = std::make_shared<AggCol>(SV_AGG_COUNT, std::make_shared<Col>("", "*"));
+    }
+    |   COUNT '(' col ')'
+    {
+        $$ = std::make_shared<AggCol>(SV_AGG_COUNT, $3);
+    }
+    |   aggFunc '(' col ')'
+    {
+        $$ = std::make_shared<AggCol>($1, $3);
+    }
+    ;
+
+aggFunc:
+        SUM     { $$ = SV_AGG_SUM; }
+    |   MIN     { $$ = SV_AGG_MIN; }
+    |   MAX     { $$ = SV_AGG_MAX; }
+    |   AVG     { $$ = SV_AGG_AVG; }
     ;
 
 tableList:
@@ -347,6 +517,14 @@ tableList:
     }
     ;
 
+opt_group_clause:
+    GROUP BY colList
+    {
+        $$ = $3;
+    }
+    |   /* epsilon */ { /* ignore*/ }
+    ;
+
 opt_order_clause:
     ORDER BY order_clause      
     { 
@@ -356,19 +534,53 @@ opt_order_clause:
     ;
 
 order_clause:
+      order_item
+    {
+        $$ = std::vector<std::shared_ptr<OrderBy>>{$1};
+    }
+    |   order_clause ',' order_item
+    {
+        $$.push_back($3);
+    }
+    ;
+
+order_item:
       col  opt_asc_desc 
     { 
         $$ = std::make_shared<OrderBy>($1, $2);
     }
     ;   
 
+opt_limit_clause:
+    LIMIT VALUE_INT
+    {
+        if ($2 < 0) {
+            yyerror(&@2, scanner, parse_tree, "LIMIT must not be negative");
+            YYERROR;
+        }
+        $$ = $2;
+    }
+    |   /* epsilon */ { $$ = -1; }
+    ;
+
 opt_asc_desc:
     ASC          { $$ = OrderBy_ASC;     }
     |  DESC      { $$ = OrderBy_DESC;    }
     |       { $$ = OrderBy_DEFAULT; }
     ;    
 
-tbName: IDENTIFIER;
+tbName: identifier;
+
+colName: identifier;
 
-colName: IDENTIFIER;
+identifier:
+        IDENTIFIER
+    |   unreservedKeyword
+    ;
+
+// 不保留的关键字：只在特定位置有特殊含义，其他位置可以作为表名、列名等标识符
+unreservedKeyword:
+        STATS | COUNT | SUM | MIN | MAX | AVG | ANALYZE | VACUUM | EXPLAIN | COPY | PREPARE | EXECUTE | DEALLOCATE
+    |   WITH | USING | PARTITION | PARTITIONS
+    ;
 %%
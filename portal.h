@@ -6,6 +6,9 @@
 #include "optimizer/plan.h"
 #include "execution/executor_abstract.h"
 #include "execution/executor_nestedloop_join.h"
+#include "execution/executor_hash_join.h"
+#include "execution/executor_index_nestedloop_join.h"
+#include "execution/executor_merge_join.h"
 #include "execution/executor_projection.h"
 #include "execution/executor_seq_scan.h"
 #include "execution/executor_index_scan.h"
@@ -13,6 +16,13 @@
 #include "execution/executor_insert.h"
 #include "execution/executor_delete.h"
 #include "execution/execution_sort.h"
+#include "execution/executor_limit.h"
+#include "execution/executor_hash_aggregate.h"
+#include "execution/executor_stream_aggregate.h"
+#include "execution/executor_count_star.h"
+#include "execution/executor_append.h"
+#include "system/sm_partition.h"
+#include "execution/explain.h"
 #include "common/common.h"
 
 typedef enum portalTag{
@@ -20,7 +30,8 @@ typedef enum portalTag{
     PORTAL_ONE_SELECT,
     PORTAL_DML_WITHOUT_SELECT,
     PORTAL_MULTI_QUERY,
-    PORTAL_CMD_UTILITY
+    PORTAL_CMD_UTILITY,
+    PORTAL_EXPLAIN
 } portalTag;
 
 
@@ -30,6 +41,8 @@ struct PortalStmt {
     std::vector<TabCol> sel_cols;
     std::unique_ptr<AbstractExecutor> root;
     std::shared_ptr<Plan> plan;
+    std::unique_ptr<ExplainStats> explain_stats;    // PORTAL_EXPLAIN时的计划描述和执行统计
+    std::chrono::steady_clock::time_point start_time;   // EXPLAIN ANALYZE开始生成算子的时间
     
     PortalStmt(portalTag tag_, std::vector<TabCol> sel_cols_, std::unique_ptr<AbstractExecutor> root_, std::shared_ptr<Plan> plan_) :
             tag(tag_), sel_cols(std::move(sel_cols_)), root(std::move(root_)), plan(std::move(plan_)) {}
@@ -48,8 +61,13 @@ class Portal
     // 将查询执行计划转换成对应的算子树
     std::shared_ptr<PortalStmt> start(std::shared_ptr<Plan> plan, Context *context)
     {
+        if (sm_manager_->is_read_only()) {
+            check_read_only(plan);
+        }
         // 这里可以将select进行拆分，例如：一个select，带有return的select等
-        if (auto x = std::dynamic_pointer_cast<OtherPlan>(plan)) {
+        if (auto x = std::dynamic_pointer_cast<ExplainPlan>(plan)) {
+            return start_explain(x, context);
+        } else if (auto x = std::dynamic_pointer_cast<OtherPlan>(plan)) {
             return std::make_shared<PortalStmt>(PORTAL_CMD_UTILITY, std::vector<TabCol>(), std::unique_ptr<AbstractExecutor>(),plan);
         } else if (auto x = std::dynamic_pointer_cast<DDLPlan>(plan)) {
             return std::make_shared<PortalStmt>(PORTAL_MULTI_QUERY, std::vector<TabCol>(), std::unique_ptr<AbstractExecutor>(),plan);
@@ -57,6 +75,8 @@ class Portal
             switch(x->tag) {
                 case T_select:
                 {
+                    // SELECT读取事务开始时的快照，UPDATE/DELETE查找记录时读取最新的记录
+                    context->snapshot_read_ = true;
                     std::shared_ptr<ProjectionPlan> p = std::dynamic_pointer_cast<ProjectionPlan>(x->subplan_);
                     std::unique_ptr<AbstractExecutor> root= convert_plan_executor(p, context);
                     return std::make_shared<PortalStmt>(PORTAL_ONE_SELECT, std::move(p->sel_cols_), std::move(root), plan);
@@ -64,35 +84,46 @@ class Portal
                     
                 case T_Update:
                 {
-                    std::unique_ptr<AbstractExecutor> scan= convert_plan_executor(x->subplan_, context);
-                    std::vector<Rid> rids;
-                    for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
-                        rids.push_back(scan->rid());
+                    // 分区表在每个剩下的分区上分别查找和修改记录
+                    std::vector<std::unique_ptr<AbstractExecutor>> writers;
+                    for (auto &[table, rids] : find_rids(x, context)) {
+                        writers.push_back(std::make_unique<UpdateExecutor>(sm_manager_, *table, x->set_clauses_,
+                                                                           x->conds_, std::move(rids), context));
                     }
-                    std::unique_ptr<AbstractExecutor> root =std::make_unique<UpdateExecutor>(sm_manager_, 
-                                                            x->tab_name_, x->set_clauses_, x->conds_, rids, context);
-                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
+                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(),
+                                                        make_writer(std::move(writers), context), plan);
                 }
                 case T_Delete:
                 {
-                    std::unique_ptr<AbstractExecutor> scan= convert_plan_executor(x->subplan_, context);
-                    std::vector<Rid> rids;
-                    for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
-                        rids.push_back(scan->rid());
+                    std::vector<std::unique_ptr<AbstractExecutor>> writers;
+                    for (auto &[table, rids] : find_rids(x, context)) {
+                        writers.push_back(std::make_unique<DeleteExecutor>(sm_manager_, *table, x->conds_,
+                                                                           std::move(rids), context));
                     }
-
-                    std::unique_ptr<AbstractExecutor> root =
-                        std::make_unique<DeleteExecutor>(sm_manager_, x->tab_name_, x->conds_, rids, context);
-
-                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
+                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(),
+                                                        make_writer(std::move(writers), context), plan);
                 }
 
                 case T_Insert:
                 {
-                    std::unique_ptr<AbstractExecutor> root =
-                            std::make_unique<InsertExecutor>(sm_manager_, x->tab_name_, x->values_, context);
-            
-                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
+                    const TableHandle &table = sm_manager_->get_table_handle(x->tab_name_);
+                    if (!table.tab->is_partitioned()) {
+                        std::unique_ptr<AbstractExecutor> root =
+                            std::make_unique<InsertExecutor>(sm_manager_, table, x->values_, context);
+                        return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
+                    }
+                    // 按分区字段的值把各行分发到所在的分区
+                    std::vector<std::unique_ptr<AbstractExecutor>> writers;
+                    auto part_values = route_values(*table.tab, x->values_);
+                    for (size_t i = 0; i < part_values.size(); i++) {
+                        if (!part_values[i].empty()) {
+                            writers.push_back(std::make_unique<InsertExecutor>(
+                                sm_manager_, sm_manager_->get_table_handle(table.tab->partition.partitions[i]),
+                                std::move(part_values[i]), context));
+                        }
+                    }
+                    return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(),
+                                                        make_writer(std::move(writers), context), plan);
                 }
 
 
@@ -130,6 +161,13 @@ class Portal
                 ql->run_cmd_utility(portal->plan, txn_id, context);
                 break;
             }
+            case PORTAL_EXPLAIN:
+            {
+                auto x = std::dynamic_pointer_cast<ExplainPlan>(portal->plan);
+                bool is_select = x->subplan_->tag == T_select;
+                ql->explain(std::move(portal->root), is_select, *portal->explain_stats, portal->start_time, context);
+                break;
+            }
             default:
             {
                 throw InternalError("Unexpected field type");
@@ -141,30 +179,246 @@ class Portal
     void drop(){}
 
 
+    // EXPLAIN ANALYZE时生成的算子包装上执行统计
     std::unique_ptr<AbstractExecutor> convert_plan_executor(std::shared_ptr<Plan> plan, Context *context)
+    {
+        std::unique_ptr<AbstractExecutor> executor = build_executor(plan, context);
+        if (context->explain_stats_ != nullptr) {
+            executor = context->explain_stats_->instrument(plan.get(), std::move(executor));
+        }
+        return executor;
+    }
+
+   private:
+    std::unique_ptr<AbstractExecutor> build_executor(std::shared_ptr<Plan> plan, Context *context)
     {
         if(auto x = std::dynamic_pointer_cast<ProjectionPlan>(plan)){
             return std::make_unique<ProjectionExecutor>(convert_plan_executor(x->subplan_, context), 
                                                         x->sel_cols_);
         } else if(auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
-            if(x->tag == T_SeqScan) {
-                return std::make_unique<SeqScanExecutor>(sm_manager_, x->tab_name_, x->conds_, context);
+            if (x->partitions_.empty()) {
+                return build_scan(x, *x->table_, context);
+            }
+            if (x->partitions_.size() == 1) {
+                return build_scan(x, *x->partitions_[0], context);
+            }
+            // 分区表依次扫描剩下的每个分区。各分区的B+树索引扫描分别有序，合并后按索引字段排序，
+            // 保持索引扫描的输出顺序；排序需要的字段在投影之前读取
+            bool sorted = x->tag == T_IndexScan && !is_hash_scan(*x);
+            auto part_plan = x;
+            if (sorted) {
+                part_plan = std::make_shared<ScanPlan>(*x);
+                part_plan->proj_cols_.clear();
+                part_plan->index_only_ = false;
+            }
+            std::vector<std::unique_ptr<AbstractExecutor>> children;
+            for (auto partition : x->partitions_) {
+                children.push_back(build_scan(part_plan, *partition, context));
+            }
+            std::unique_ptr<AbstractExecutor> scan = std::make_unique<AppendExecutor>(std::move(children));
+            if (!sorted) {
+                return scan;
             }
-            else {
-                return std::make_unique<IndexScanExecutor>(sm_manager_, x->tab_name_, x->conds_, x->index_col_names_, context);
-            } 
+            return sort_by_index(x, std::move(scan), context);
         } else if(auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+            // 连接条件复制给算子，执行后计划保持完整，慢查询日志在语句结束后仍能描述它
             std::unique_ptr<AbstractExecutor> left = convert_plan_executor(x->left_, context);
+            if (x->tag == T_IndexNestLoop) {
+                auto inner = std::dynamic_pointer_cast<ScanPlan>(x->right_);
+                return std::make_unique<IndexNestedLoopJoinExecutor>(sm_manager_, std::move(left), *inner->table_,
+                                                                     inner->conds_, x->index_id_,
+                                                                     x->conds_, context);
+            }
             std::unique_ptr<AbstractExecutor> right = convert_plan_executor(x->right_, context);
+            if (x->tag == T_HashJoin) {
+                return std::make_unique<HashJoinExecutor>(std::move(left), std::move(right), x->conds_,
+                                                          HASH_JOIN_MEMORY_BUDGET, &context->memory_);
+            }
+            if (x->tag == T_MergeJoin) {
+                return std::make_unique<MergeJoinExecutor>(std::move(left), std::move(right), x->conds_);
+            }
             std::unique_ptr<AbstractExecutor> join = std::make_unique<NestedLoopJoinExecutor>(
                                 std::move(left), 
-                                std::move(right), std::move(x->conds_));
+                                std::move(right), x->conds_);
             return join;
         } else if(auto x = std::dynamic_pointer_cast<SortPlan>(plan)) {
             return std::make_unique<SortExecutor>(convert_plan_executor(x->subplan_, context), 
-                                            x->sel_col_, x->is_desc_);
+                                            x->sel_cols_, x->is_desc_, SORT_MEMORY_BUDGET,
+                                            x->limit_ < 0 ? SIZE_MAX : static_cast<size_t>(x->limit_),
+                                            &context->memory_);
+        } else if(auto x = std::dynamic_pointer_cast<AggregatePlan>(plan)) {
+            if (x->tag == T_CountStar) {
+                auto scan = std::dynamic_pointer_cast<ScanPlan>(x->subplan_);
+                return std::make_unique<CountStarExecutor>(sm_manager_, *scan->table_, x->aggs_, context);
+            }
+            if (x->tag == T_StreamAggregate) {
+                return std::make_unique<StreamAggregateExecutor>(convert_plan_executor(x->subplan_, context),
+                                                                 x->group_cols_, x->aggs_);
+            }
+            return std::make_unique<HashAggregateExecutor>(convert_plan_executor(x->subplan_, context),
+                                                           x->group_cols_, x->aggs_, HASH_AGG_MEMORY_BUDGET,
+                                                           &context->memory_);
+        } else if(auto x = std::dynamic_pointer_cast<LimitPlan>(plan)) {
+            return std::make_unique<LimitExecutor>(convert_plan_executor(x->subplan_, context), x->limit_);
         }
         return nullptr;
     }
 
+    /**
+     * @description: 在表或分区表的一个分区上生成扫描算子
+     * @param {shared_ptr<ScanPlan>} x 扫描的计划
+     * @param {TableHandle&} table 扫描的表，分区表时为其中一个分区
+     */
+    std::unique_ptr<AbstractExecutor> build_scan(std::shared_ptr<ScanPlan> x, const TableHandle &table, Context *context)
+    {
+        if(x->tag == T_SeqScan) {
+            return std::make_unique<SeqScanExecutor>(sm_manager_, table, x->conds_, context, x->proj_cols_);
+        }
+        else {
+            return std::make_unique<IndexScanExecutor>(sm_manager_, table, x->conds_, x->index_id_, context,
+                                                       x->is_desc_, x->proj_cols_, x->index_only_);
+        }
+    }
+
+    // 完整记录按索引扫描的索引字段和方向排序，之后只输出上层需要的字段
+    std::unique_ptr<AbstractExecutor> sort_by_index(std::shared_ptr<ScanPlan> x, std::unique_ptr<AbstractExecutor> scan,
+                                                    Context *context)
+    {
+        std::vector<TabCol> keys;
+        for (auto &col_name : x->index_col_names_) {
+            keys.push_back({x->tab_name_, col_name});
+        }
+        scan = std::make_unique<SortExecutor>(std::move(scan), keys, std::vector<bool>(keys.size(), x->is_desc_),
+                                              SORT_MEMORY_BUDGET, SIZE_MAX, &context->memory_);
+        if (x->proj_cols_.empty()) {
+            return scan;
+        }
+        std::vector<TabCol> sel_cols;
+        for (auto &col_name : x->proj_cols_) {
+            sel_cols.push_back({x->tab_name_, col_name});
+        }
+        return std::make_unique<ProjectionExecutor>(std::move(scan), sel_cols);
+    }
+
+    bool is_hash_scan(const ScanPlan &x) {
+        return x.table_->get_index(x.index_id_).hash != nullptr;
+    }
+
+    // 只读打开的数据库只能执行查询，DDL、DML以及ANALYZE、VACUUM和LOAD都会修改数据文件或目录
+    void check_read_only(const std::shared_ptr<Plan> &plan) {
+        if (std::dynamic_pointer_cast<DDLPlan>(plan) != nullptr) {
+            throw ReadOnlyError("DDL");
+        }
+        if (auto x = std::dynamic_pointer_cast<DMLPlan>(plan)) {
+            if (x->tag != T_select) {
+                throw ReadOnlyError(x->tag == T_Insert ? "INSERT" : x->tag == T_Update ? "UPDATE" : "DELETE");
+            }
+        } else if (auto x = std::dynamic_pointer_cast<OtherPlan>(plan)) {
+            if (x->tag == T_Analyze || x->tag == T_Vacuum || x->tag == T_Load) {
+                throw ReadOnlyError(x->tag == T_Analyze ? "ANALYZE" : x->tag == T_Vacuum ? "VACUUM" : "LOAD");
+            }
+        }
+    }
+
+    /**
+     * @description: 查找UPDATE/DELETE需要修改的记录。分区表在剪枝后剩下的每个分区上分别扫描，
+     *               同一个计划节点的各个扫描算子的执行统计累加
+     * @return 修改的表或分区，以及其中需要修改的记录的位置
+     */
+    std::vector<std::pair<const TableHandle *, std::vector<Rid>>> find_rids(std::shared_ptr<DMLPlan> x, Context *context)
+    {
+        auto scan_plan = std::dynamic_pointer_cast<ScanPlan>(x->subplan_);
+        std::vector<const TableHandle *> tables = scan_plan->partitions_;
+        if (tables.empty()) {
+            tables.push_back(scan_plan->table_);
+        }
+        std::vector<std::pair<const TableHandle *, std::vector<Rid>>> result;
+        for (auto table : tables) {
+            std::unique_ptr<AbstractExecutor> scan = build_scan(scan_plan, *table, context);
+            if (context->explain_stats_ != nullptr) {
+                scan = context->explain_stats_->instrument(scan_plan.get(), std::move(scan));
+            }
+            std::vector<Rid> rids;
+            for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
+                if (rids.size() == rids.capacity()) {
+                    // 记录的位置在修改之前全部保存在内存中，不能写入临时文件，超过语句的内存上限时语句失败
+                    size_t grow = std::max<size_t>(rids.capacity(), 16);
+                    context->memory_.consume(grow * sizeof(Rid));
+                    rids.reserve(rids.capacity() + grow);
+                }
+                rids.push_back(scan->rid());
+            }
+            result.emplace_back(table, std::move(rids));
+        }
+        return result;
+    }
+
+    /**
+     * @description: 按分区字段的值把INSERT的各行分发到所在的分区
+     * @return {vector<vector<Value>>} 每个分区插入的各行的值，依次存放
+     * @param {TabMeta&} tab 分区表的元数据
+     * @param {vector<Value>&} values 各行的值，依次存放
+     */
+    std::vector<std::vector<Value>> route_values(const TabMeta &tab, const std::vector<Value> &values)
+    {
+        size_t num_cols = tab.cols.size();
+        if (values.empty() || values.size() % num_cols != 0) {
+            throw InvalidValueCountError();
+        }
+        auto col = tab.get_col(tab.partition.col_name);
+        size_t key_idx = col - tab.cols.begin();
+        std::vector<std::vector<Value>> part_values(tab.partition.partitions.size());
+        for (size_t row = 0; row < values.size(); row += num_cols) {
+            Value key = values[row + key_idx];
+            if (key.type != col->type) {
+                throw IncompatibleTypeError(coltype2str(col->type), coltype2str(key.type));
+            }
+            key.raw.reset();
+            key.init_raw(col->len);
+            auto &dest = part_values[partition_of(tab, key.raw->data)];
+            dest.insert(dest.end(), values.begin() + row, values.begin() + row + num_cols);
+        }
+        return part_values;
+    }
+
+    // 不是分区表时只有一个修改的算子，直接执行它
+    std::unique_ptr<AbstractExecutor> make_writer(std::vector<std::unique_ptr<AbstractExecutor>> writers, Context *context)
+    {
+        if (writers.size() == 1) {
+            return std::move(writers[0]);
+        }
+        return std::make_unique<PartitionWriteExecutor>(std::move(writers), context);
+    }
+
+    /**
+     * @description: EXPLAIN只描述计划；EXPLAIN ANALYZE按原语句生成算子，每个算子都包装上执行统计，
+     *               UPDATE/DELETE查找记录的扫描在这里执行，同样计入统计
+     */
+    std::shared_ptr<PortalStmt> start_explain(std::shared_ptr<ExplainPlan> plan, Context *context)
+    {
+        auto stats = std::make_unique<ExplainStats>(plan->subplan_, plan->analyze_);
+        std::unique_ptr<AbstractExecutor> root;
+        auto start_time = std::chrono::steady_clock::now();
+        if (plan->analyze_) {
+            context->explain_stats_ = stats.get();
+            std::shared_ptr<PortalStmt> inner;
+            try {
+                inner = start(plan->subplan_, context);
+            } catch (...) {
+                context->explain_stats_ = nullptr;
+                throw;
+            }
+            context->explain_stats_ = nullptr;
+            root = std::move(inner->root);
+            if (inner->tag == PORTAL_DML_WITHOUT_SELECT) {
+                // INSERT/UPDATE/DELETE的算子直接生成，不经过convert_plan_executor
+                root = stats->instrument(plan->subplan_.get(), std::move(root));
+            }
+        }
+        auto portal = std::make_shared<PortalStmt>(PORTAL_EXPLAIN, std::vector<TabCol>(), std::move(root), plan);
+        portal->explain_stats = std::move(stats);
+        portal->start_time = start_time;
+        return portal;
+    }
+
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstring>
 
@@ -21,7 +22,7 @@ class Bitmap {
     static bool is_set(const char *bm, int pos) { return (bm[get_bucket(pos)] & get_bit(pos)) != 0; }
 
     /**
-     * @brief 找下一个为0 or 1的位
+     * @brief 找下一个为0 or 1的位，每次比较64位
      * @param bit false表示要找下一个为0的位，true表示要找下一个为1的位
      * @param bm 要找的起始地址为bm
      * @param max_n 要找的从起始地址开始的偏移为[curr+1,max_n)
@@ -29,10 +30,18 @@ class Bitmap {
      * @return 找到了就返回偏移位置，没找到就返回max_n
      */
     static int next_bit(bool bit, const char *bm, int max_n, int curr) {
-        for (int i = curr + 1; i < max_n; i++) {
-            if (is_set(bm, i) == bit) {
-                return i;
+        for (int pos = curr + 1; pos < max_n;) {
+            int base = pos / WORD_BITS * WORD_BITS;
+            uint64_t word = load_word(bm, base, max_n);
+            if (!bit) {
+                word = ~word;
             }
+            word &= ~0ULL >> (pos - base);  // 去掉pos之前的位
+            if (word != 0) {
+                int found = base + __builtin_clzll(word);
+                return found < max_n ? found : max_n;
+            }
+            pos = base + WORD_BITS;
         }
         return max_n;
     }
@@ -40,11 +49,42 @@ class Bitmap {
     // 找第一个为0 or 1的位
     static int first_bit(bool bit, const char *bm, int max_n) { return next_bit(bit, bm, max_n, -1); }
 
+    // [0, max_n)中为1的位数
+    static int count(const char *bm, int max_n) {
+        int cnt = 0;
+        for (int base = 0; base < max_n; base += WORD_BITS) {
+            uint64_t word = load_word(bm, base, max_n);
+            if (max_n - base < WORD_BITS) {
+                word &= ~(~0ULL >> (max_n - base));  // 去掉max_n及之后的位
+            }
+            cnt += __builtin_popcountll(word);
+        }
+        return cnt;
+    }
+
     // for example:
     // rid_.slot_no = Bitmap::next_bit(true, page_handle.bitmap, file_handle_->file_hdr_.num_records_per_page,
     // rid_.slot_no); int slot_no = Bitmap::first_bit(false, page_handle.bitmap, file_hdr_.num_records_per_page);
 
    private:
+    static constexpr int WORD_BITS = 64;
+
+    /**
+     * @brief 读出从base位开始的64位，base为64的倍数。每个字节的最高位在前，
+     *        读出后按大端序拼接，使第base + i位对应字的第63 - i位，可以直接用clz找第一个置位
+     *        只读取[0, max_n)所在的字节，不会越过bitmap的末尾
+     */
+    static uint64_t load_word(const char *bm, int base, int max_n) {
+        int begin = base / BITMAP_WIDTH;
+        int bytes = std::min(WORD_BITS / BITMAP_WIDTH, (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH - begin);
+        uint64_t word = 0;
+        memcpy(&word, bm + begin, bytes);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        return word;
+    }
+
     static int get_bucket(int pos) { return pos / BITMAP_WIDTH; }
 
     static char get_bit(int pos) { return BITMAP_HIGHEST_BIT >> static_cast<char>(pos % BITMAP_WIDTH); }
@@ -0,0 +1,9 @@
+#include "rm_defs.h"
+
+#include "common/arena.h"
+
+RmRecord::RmRecord(int size_, Arena* arena) {
+    size = size_;
+    data = arena->allocate(size_);
+    allocated_ = false;
+}
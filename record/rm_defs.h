@@ -3,48 +3,118 @@
 #include "defs.h"
 #include "storage/buffer_pool_manager.h"
 
+// 只在rm_defs.cpp中使用Arena的定义，rm.h的使用者不需要引入arena.h及其依赖的config.h
+class Arena;
+
 constexpr int RM_NO_PAGE = -1;
 constexpr int RM_FILE_HDR_PAGE = 0;
 constexpr int RM_FIRST_RECORD_PAGE = 1;
 constexpr int RM_MAX_RECORD_SIZE = 512;
+constexpr int RM_MAX_VAR_FIELDS = 64;
+constexpr int RM_MAX_MINIPAGES = 64;
+
+/* 变长字段在记录中的位置。记录在内存中仍然是定长的，变长字段只在slotted page中按实际长度存储 */
+struct RmVarField {
+    uint16_t offset;    // 字段在记录中的偏移量
+    uint16_t len;       // 字段的最大长度
+};
+
+/* PAX页面被淘汰到压缩页缓存时minipage的编码方式，见rm_pax_codec.h */
+enum RmEncoding : uint8_t {
+    RM_ENCODING_NONE = 0,   // 原样保存
+    RM_ENCODING_FOR = 1,    // 4字节整数：frame-of-reference，页面内的最小值加上按位紧密排列的差值
+    RM_ENCODING_DICT = 2,   // 定长字符串：页面内的字典加上按位紧密排列的字典编号
+};
+
+/* PAX格式中一个minipage存放的字段：记录中[offset, offset + len)的部分。各minipage按偏移量递增、首尾相接地覆盖整条记录 */
+struct RmMinipage {
+    uint16_t offset;    // 字段在记录中的偏移量
+    uint16_t len;       // 字段的长度，也是minipage中相邻两条记录的间隔
+    uint8_t encoding = RM_ENCODING_NONE;    // 压缩时的编码方式，RmEncoding
+    uint8_t reserved = 0;
+};
+
+/* 表中记录的存储方式 */
+enum RmStorage : int {
+    RM_STORAGE_HEAP = 0,    // 记录存放在数据文件的页面中，原地插入、删除和更新
+    RM_STORAGE_LSM = 1,     // 记录写入memtable后写成有序的sorted run(见rm_lsm_tree.h)，数据文件只有文件头
+};
 
 /* 文件头，记录表数据文件的元信息，写入磁盘中文件的第0号页面 */
 struct RmFileHdr {
-    int record_size;            // 表中每条记录的大小，由于不包含变长字段，因此当前字段初始化后保持不变
+    int record_size;            // 表中每条记录(定长的内存格式)的大小，初始化后保持不变
     int num_pages;              // 文件中分配的页面个数（初始化为1）
     int num_records_per_page;   // 每个页面最多能存储的元组个数
-    int first_free_page_no;     // 文件中当前第一个包含空闲空间的页面号（初始化为-1）
-    int bitmap_size;            // 每个页面bitmap大小
+    int first_free_page_no;     // 空闲页链表的表头，只链接free space map记录不下的页面（初始化为-1）
+    int bitmap_size;            // 每个页面bitmap大小，slotted page不使用bitmap，为0
+    int num_var_fields;         // 变长字段个数，为0时页面使用bitmap + 定长slot的格式，否则使用slotted page
+    int max_tuple_size;         // slotted page中一条元组编码后的最大长度，定长格式中等于record_size
+    RmVarField var_fields[RM_MAX_VAR_FIELDS];   // 按偏移量递增的变长字段
+    int num_minipages;          // PAX格式中每个页面的minipage个数，为0时按行存储记录
+    RmMinipage minipages[RM_MAX_MINIPAGES];     // 按偏移量递增的minipage
+    int storage;                // RmStorage，LSM表的num_pages是行号按num_records_per_page条一组编成的虚拟页面数
+
+    bool is_slotted() const { return num_var_fields > 0; }
+
+    bool is_lsm() const { return storage == RM_STORAGE_LSM; }
+
+    bool is_pax() const { return num_minipages > 0; }
+
+    // PAX页面被淘汰时是否编码后保存在压缩页缓存中
+    bool is_compressed() const {
+        for (int i = 0; i < num_minipages; i++) {
+            if (minipages[i].encoding != RM_ENCODING_NONE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 记录是否按定长的内存格式连续存放在页面中，此时可以直接指向页面中的slot而不需要解码
+    bool is_contiguous() const { return !is_slotted() && !is_pax() && !is_lsm(); }
 };
 
+constexpr int RM_FSM_WORDS = static_cast<int>((PAGE_SIZE - sizeof(RmFileHdr)) / sizeof(uint64_t));  // 文件头页中free space map的64位字数
+constexpr int RM_FSM_SIZE = RM_FSM_WORDS * static_cast<int>(sizeof(uint64_t));  // free space map的字节数，紧跟在RmFileHdr之后
+constexpr int RM_FSM_MAX_PAGES = RM_FSM_WORDS * 64;  // free space map能记录的页面数
+
 /* 表数据文件中每个页面的页头，记录每个页面的元信息 */
 struct RmPageHdr {
-    int next_free_page_no;  // 当前页面满了之后，下一个包含空闲空间的页面号（初始化为-1）
+    int next_free_page_no;  // 空闲页链表中下一个包含空闲空间的页面号（初始化为-1）
     int num_records;        // 当前页面中当前已经存储的记录个数（初始化为0）
 };
 
-/* 表中的记录 */
+/* 表中的记录
+   RmRecord只能移动不能复制，需要复制记录数据时显式使用RmRecord(size, data)
+   使用Arena构造的记录从语句的内存池中分配data，析构时不释放，语句结束时随Arena统一回收 */
 struct RmRecord {
-    char* data;  // 记录的数据
-    int size;    // 记录的大小
-    bool allocated_ = false;    // 是否已经为数据分配空间
+    char* data = nullptr;  // 记录的数据
+    int size = 0;    // 记录的大小
+    bool allocated_ = false;    // data是否由RmRecord自己new出来，需要在析构时释放
 
     RmRecord() = default;
 
-    RmRecord(const RmRecord& other) {
-        size = other.size;
-        data = new char[size];
-        memcpy(data, other.data, size);
-        allocated_ = true;
-    };
+    RmRecord(const RmRecord& other) = delete;
+    RmRecord &operator=(const RmRecord& other) = delete;
 
-    RmRecord &operator=(const RmRecord& other) {
-        size = other.size;
-        data = new char[size];
-        memcpy(data, other.data, size);
-        allocated_ = true;
+    RmRecord(RmRecord&& other) noexcept : data(other.data), size(other.size), allocated_(other.allocated_) {
+        other.data = nullptr;
+        other.size = 0;
+        other.allocated_ = false;
+    }
+
+    RmRecord &operator=(RmRecord&& other) noexcept {
+        if (this != &other) {
+            free_data();
+            data = other.data;
+            size = other.size;
+            allocated_ = other.allocated_;
+            other.data = nullptr;
+            other.size = 0;
+            other.allocated_ = false;
+        }
         return *this;
-    };
+    }
 
     RmRecord(int size_) {
         size = size_;
@@ -52,27 +122,38 @@ struct RmRecord {
         allocated_ = true;
     }
 
-    RmRecord(int size_, char* data_) {
+    RmRecord(int size_, const char* data_) {
         size = size_;
         data = new char[size_];
         memcpy(data, data_, size_);
         allocated_ = true;
     }
 
+    // 从内存池中分配记录
+    RmRecord(int size_, Arena* arena);
+
+    RmRecord(int size_, const char* data_, Arena* arena) : RmRecord(size_, arena) { memcpy(data, data_, size_); }
+
     void SetData(char* data_) {
         memcpy(data, data_, size);
     }
 
     void Deserialize(const char* data_) {
-        size = *reinterpret_cast<const int*>(data_);
-        if(allocated_) {
-            delete[] data;
+        int new_size = *reinterpret_cast<const int*>(data_);
+        // 大小不变时复用已有的缓冲区
+        if (!allocated_ || new_size != size) {
+            free_data();
+            data = new char[new_size];
+            allocated_ = true;
         }
-        data = new char[size];
+        size = new_size;
         memcpy(data, data_ + sizeof(int), size);
     }
 
-    ~RmRecord() {
+    ~RmRecord() { free_data(); }
+
+   private:
+    void free_data() {
         if(allocated_) {
             delete[] data;
         }
@@ -80,3 +161,63 @@ struct RmRecord {
         data = nullptr;
     }
 };
+
+/* 借用的记录：直接指向缓冲池中被pin住的页面里的slot，不复制记录数据，析构时unpin页面
+   谓词判断等只读操作直接使用data()，只有需要保留下来的记录才通过materialize()复制出来
+   slotted page中的元组需要解码，此时视图持有解码出的记录，不pin页面 */
+class RmRecordView {
+   public:
+    RmRecordView() = default;
+
+    RmRecordView(BufferPoolManager *bpm, PageId page_id, const char *data, int size)
+        : bpm_(bpm), page_id_(page_id), data_(data), size_(size) {}
+
+    RmRecordView(std::unique_ptr<char[]> owned, int size) : owned_(std::move(owned)), data_(owned_.get()), size_(size) {}
+
+    RmRecordView(const RmRecordView &) = delete;
+    RmRecordView &operator=(const RmRecordView &) = delete;
+
+    RmRecordView(RmRecordView &&other) noexcept { *this = std::move(other); }
+
+    RmRecordView &operator=(RmRecordView &&other) noexcept {
+        if (this != &other) {
+            release();
+            bpm_ = other.bpm_;
+            page_id_ = other.page_id_;
+            owned_ = std::move(other.owned_);
+            data_ = other.data_;
+            size_ = other.size_;
+            other.bpm_ = nullptr;
+            other.data_ = nullptr;
+        }
+        return *this;
+    }
+
+    ~RmRecordView() { release(); }
+
+    const char *data() const { return data_; }
+    int size() const { return size_; }
+
+    // 复制出一条独立的记录，之后可以释放视图
+    std::unique_ptr<RmRecord> materialize() const { return std::make_unique<RmRecord>(size_, data_); }
+
+    // 提前unpin页面，之后data()不再有效
+    void release() {
+        if (bpm_ != nullptr) {
+            bpm_->unpin_page(page_id_, false);
+            bpm_ = nullptr;
+            data_ = nullptr;
+        }
+        if (owned_ != nullptr) {
+            owned_.reset();
+            data_ = nullptr;
+        }
+    }
+
+   private:
+    BufferPoolManager *bpm_ = nullptr;
+    PageId page_id_;
+    std::unique_ptr<char[]> owned_;     // 解码出的记录，指向页面时为空
+    const char *data_ = nullptr;
+    int size_ = 0;
+};
@@ -7,18 +7,144 @@
  * @return {unique_ptr<RmRecord>} rid对应的记录对象指针
  */
 std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* context) const {
+    if (lsm_ != nullptr) {
+        auto record = std::make_unique<RmRecord>(file_hdr_.record_size);
+        if (!lsm_->get(lsm_key(rid), record->data)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        return record;
+    }
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-    if (rid.slot_no < 0 || !Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
+    if (!page_handle.is_record(rid.slot_no)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
         throw RecordNotFoundError(rid.page_no,rid.slot_no);
     }
-    char* record_data = page_handle.get_slot(rid.slot_no);
-    std::unique_ptr<RmRecord> record = std::make_unique<RmRecord>(file_hdr_.record_size, record_data);
+    std::unique_ptr<RmRecord> record = std::make_unique<RmRecord>(file_hdr_.record_size);
+    const char* record_data = page_handle.get_record(rid.slot_no, record->data);
+    if (record_data != record->data) {
+        memcpy(record->data, record_data, file_hdr_.record_size);
+    }
+    // 记录已经复制到RmRecord中，页面只被读取
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
     return record;
 }
 
+/**
+ * @description: 获取当前表中记录号为rid的记录，不复制记录数据，返回的视图持有页面的pin
+ * @param {Rid&} rid 记录号，指定记录的位置
+ * @return {RmRecordView} 指向页面中slot的记录视图，slotted page和PAX格式的记录解码后由视图持有
+ */
+RmRecordView RmFileHandle::get_record_view(const Rid& rid) const {
+    if (lsm_ != nullptr) {
+        auto buf = std::make_unique<char[]>(file_hdr_.record_size);
+        if (!lsm_->get(lsm_key(rid), buf.get())) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        return RmRecordView(std::move(buf), file_hdr_.record_size);
+    }
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    if (!page_handle.is_record(rid.slot_no)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
+    }
+    if (!file_hdr_.is_contiguous()) {
+        auto buf = std::make_unique<char[]>(file_hdr_.record_size);
+        page_handle.get_record(rid.slot_no, buf.get());
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        return RmRecordView(std::move(buf), file_hdr_.record_size);
+    }
+    return RmRecordView(buffer_pool_manager_, page_handle.page->get_page_id(), page_handle.get_slot(rid.slot_no),
+                        file_hdr_.record_size);
+}
+
+/**
+ * @description: 统计表中的记录数，只读取每个页面头中的num_records，不访问记录
+ * @return {size_t} 表中的记录数
+ */
+size_t RmFileHandle::count_records() const {
+    if (lsm_ != nullptr) {
+        return lsm_->count();
+    }
+    size_t count = 0;
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_hdr_.num_pages; page_no++) {
+        RmPageHandle page_handle = fetch_page_handle(page_no, AccessType::Scan);
+        count += page_handle.page_hdr->num_records;
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+    return count;
+}
+
+/**
+ * @description: 估计表中的记录数，用于查询优化：页面不超过sample_pages个时精确统计，
+ *               否则均匀抽取sample_pages个页面，按它们的平均记录数推算
+ * @param {int} sample_pages 最多读取的页面头个数
+ * @return {double} 估计的记录数
+ */
+double RmFileHandle::estimate_records(int sample_pages) const {
+    if (lsm_ != nullptr) {
+        return static_cast<double>(lsm_->count());
+    }
+    int data_pages = file_hdr_.num_pages - RM_FIRST_RECORD_PAGE;
+    if (data_pages <= sample_pages) {
+        return static_cast<double>(count_records());
+    }
+    size_t sampled = 0;
+    for (int i = 0; i < sample_pages; i++) {
+        int page_no = RM_FIRST_RECORD_PAGE + static_cast<int>(static_cast<int64_t>(i) * data_pages / sample_pages);
+        RmPageHandle page_handle = fetch_page_handle(page_no, AccessType::Scan);
+        sampled += page_handle.page_hdr->num_records;
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+    return static_cast<double>(sampled) * data_pages / sample_pages;
+}
+
+/**
+ * @description: 抽样读取表中的记录，用于收集统计信息：页面不超过sample_pages个时读取全部记录，
+ *               否则读取均匀抽取的sample_pages个页面中的全部记录
+ * @param {int} sample_pages 最多读取的页面个数
+ * @param {vector<char>&} out 输出抽样的记录，按record_size连续存放
+ * @return {size_t} 抽样的记录数
+ */
+size_t RmFileHandle::sample_records(int sample_pages, std::vector<char> &out) const {
+    out.clear();
+    int data_pages = file_hdr_.num_pages - RM_FIRST_RECORD_PAGE;
+    int pages = std::min(data_pages, sample_pages);
+    if (lsm_ != nullptr) {
+        // 抽取的虚拟页面中的行
+        size_t sampled = 0;
+        uint64_t per_page = file_hdr_.num_records_per_page;
+        auto it = lsm_->new_iterator();
+        for (int i = 0; i < pages; i++) {
+            uint64_t begin = static_cast<uint64_t>(static_cast<int64_t>(i) * data_pages / pages) * per_page;
+            for (it->seek(begin); it->valid() && it->key() < begin + per_page; it->next()) {
+                out.insert(out.end(), it->record(), it->record() + file_hdr_.record_size);
+                sampled++;
+            }
+        }
+        return sampled;
+    }
+    size_t sampled = 0;
+    for (int i = 0; i < pages; i++) {
+        int page_no = RM_FIRST_RECORD_PAGE + static_cast<int>(static_cast<int64_t>(i) * data_pages / pages);
+        RmPageHandle page_handle = fetch_page_handle(page_no, AccessType::Scan);
+        int n = file_hdr_.num_records_per_page;
+        for (int slot = page_handle.next_record(-1); slot < n; slot = page_handle.next_record(slot)) {
+            size_t pos = out.size();
+            out.resize(pos + file_hdr_.record_size);
+            const char *record = page_handle.get_record(slot, out.data() + pos);
+            if (record != out.data() + pos) {
+                memcpy(out.data() + pos, record, file_hdr_.record_size);
+            }
+            sampled++;
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+    return sampled;
+}
+
 /**
  * @description: 在当前表中插入一条记录，不指定插入位置
  * @param {char*} buf 要插入的记录的数据
@@ -26,56 +152,91 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid& rid, Context* cont
  * @return {Rid} 插入的记录的记录号（位置）
  */
 Rid RmFileHandle::insert_record(char* buf, Context* context) {
-    // Todo:
-    // 1. 获取当前未满的page handle
+    if (lsm_ != nullptr) {
+        uint64_t key = lsm_->insert(buf);
+        lsm_update_num_pages();
+        return lsm_rid(key);
+    }
+    // 1. 从free space map(或空闲页链表)中取得一个能放下记录的page handle
     // 2. 在page handle中找到空闲slot位置
-    // 3. 将buf复制到空闲slot位置
-    // 4. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
-    RmPageHandle page_handle = create_page_handle();
+    // 3. 将buf写入空闲slot位置
+    // 4. 更新page_handle.page_hdr中的数据结构，插入后页面已满时将其标记为已满
+    // 5. 扩大页面在zone map中的范围
+    RmPageHandle page_handle = create_page_handle(buf);
     int page_no = page_handle.page->get_page_id().page_no;
-    int free_slot = -1;
-    while(true){
-        int num = page_handle.file_hdr->num_records_per_page;
-        for (int slot_no = 0; slot_no < num; slot_no++) {
-            if (!Bitmap::is_set(page_handle.bitmap, slot_no)) {
-                free_slot = slot_no;
-                break;
-            }
-        }
-        if(free_slot!=-1)break;
-        page_no = page_handle.page_hdr->next_free_page_no;
-        file_hdr_.first_free_page_no = page_no;
-        if(page_no == -1)break;
-        page_handle = fetch_page_handle(page_no);
-    }
-    if (free_slot == -1) {    
-        RmPageHandle new_page_handle = create_new_page_handle();
-        page_no = new_page_handle.page->get_page_id().page_no;
-        page_handle.page_hdr->next_free_page_no = page_no;
-        file_hdr_.first_free_page_no = page_no;
-        page_handle = std::move(new_page_handle);
-        free_slot = 0;
-    }
-    char* slot_data = page_handle.get_slot(free_slot);
-    memcpy(slot_data, buf, file_hdr_.record_size);
-    Bitmap::set(page_handle.bitmap, free_slot);
-    page_handle.page_hdr->num_records++;
-    if(page_handle.page_hdr->num_records == file_hdr_.num_records_per_page){
-
-        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
-
+    int free_slot = page_handle.next_free_slot(-1);
+    assert(page_handle.can_insert(free_slot, buf));
+    page_handle.insert(free_slot, buf);
+    zone_map_.add(page_no, buf);
+    if (!page_handle.has_room()) {
+        mark_page_full(page_handle);
     }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
     return Rid{page_no, free_slot};
 }
 
+/**
+ * @description: 在当前表中批量插入多条记录，按顺序填满有空闲空间的页面，每个页面只pin一次
+ * @param {vector<char*>&} bufs 要插入的各条记录的数据
+ * @param {Context*} context
+ * @return {vector<Rid>} 各条记录插入的位置，与bufs一一对应
+ */
+std::vector<Rid> RmFileHandle::insert_records(const std::vector<char*>& bufs, Context* context) {
+    std::vector<Rid> rids;
+    rids.reserve(bufs.size());
+    if (lsm_ != nullptr) {
+        for (char *buf : bufs) {
+            rids.push_back(lsm_rid(lsm_->insert(buf)));
+        }
+        lsm_update_num_pages();
+        return rids;
+    }
+    size_t i = 0;
+    while (i < bufs.size()) {
+        RmPageHandle page_handle = create_page_handle(bufs[i]);
+        int page_no = page_handle.page->get_page_id().page_no;
+        int slot_no = page_handle.next_free_slot(-1);
+        while (i < bufs.size() && page_handle.can_insert(slot_no, bufs[i])) {
+            page_handle.insert(slot_no, bufs[i]);
+            zone_map_.add(page_no, bufs[i]);
+            rids.push_back(Rid{page_no, slot_no});
+            i++;
+            slot_no = page_handle.next_free_slot(slot_no);
+        }
+        if (!page_handle.has_room()) {
+            mark_page_full(page_handle);
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
+    }
+    return rids;
+}
+
 /**
  * @description: 在当前表中的指定位置插入一条记录
  * @param {Rid&} rid 要插入记录的位置
  * @param {char*} buf 要插入记录的数据
  */
 void RmFileHandle::insert_record(const Rid& rid, char* buf) {
-    
+    if (lsm_ != nullptr) {
+        uint64_t key = lsm_key(rid);
+        if (key == UINT64_MAX || lsm_->contains(key)) {
+            throw InternalError("RmFileHandle::insert_record: slot is not free");
+        }
+        lsm_->put(key, buf);
+        lsm_update_num_pages();
+        return;
+    }
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    if (!page_handle.can_insert(rid.slot_no, buf)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        throw InternalError("RmFileHandle::insert_record: slot is not free");
+    }
+    page_handle.insert(rid.slot_no, buf);
+    zone_map_.add(rid.page_no, buf);
+    if (!page_handle.has_room()) {
+        mark_page_full(page_handle);
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
 }
 
 /**
@@ -84,43 +245,228 @@ void RmFileHandle::insert_record(const Rid& rid, char* buf) {
  * @param {Context*} context
  */
 void RmFileHandle::delete_record(const Rid& rid, Context* context) {
-    // Todo:
+    if (lsm_ != nullptr) {
+        uint64_t key = lsm_key(rid);
+        if (!lsm_->contains(key)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        // 写入删除标记，合并sorted run时丢弃
+        lsm_->put(key, nullptr);
+        return;
+    }
     // 1. 获取指定记录所在的page handle
     // 2. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑删除一条记录后页面未满的情况，需要调用release_page_handle()
+    // 删除一条记录后页面从已满变为未满时，需要调用release_page_handle()
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-    if (rid.slot_no < 0) {
-        //printf("rid.slot_no < 0\n");
-        throw RecordNotFoundError(rid.page_no,rid.slot_no);
-    }
-    if(!Bitmap::is_set(page_handle.bitmap, rid.slot_no)){
-        //printf("Bitmap\n");
-        throw RecordNotFoundError(rid.page_no,rid.slot_no);
+    if (!page_handle.is_record(rid.slot_no)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
     }
-    Bitmap::reset(page_handle.bitmap, rid.slot_no);
-    page_handle.page_hdr->num_records--;
-    if (page_handle.page_hdr->num_records == file_hdr_.num_records_per_page - 1) {
+    bool had_room = page_handle.has_room();
+    page_handle.erase(rid.slot_no);
+    if (!had_room && page_handle.has_room()) {
         release_page_handle(page_handle);
     }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
 }
 
 
 /**
- * @description: 更新记录文件中记录号为rid的记录
+ * @description: 原地更新记录文件中记录号为rid的记录。slotted page中变长的新记录放不进所在页面时抛出异常，
+ *               调用方需要先用can_update_in_place()检查，放不下时改为删除后插入到其他位置
  * @param {Rid&} rid 要更新的记录的记录号（位置）
  * @param {char*} buf 新记录的数据
  * @param {Context*} context
  */
 void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context) {
-    // Todo:
+    if (lsm_ != nullptr) {
+        uint64_t key = lsm_key(rid);
+        if (!lsm_->contains(key)) {
+            throw RecordNotFoundError(rid.page_no, rid.slot_no);
+        }
+        lsm_->put(key, buf);
+        return;
+    }
     // 1. 获取指定记录所在的page handle
-    // 2. 更新记录
+    // 2. 更新记录，页面的空闲空间变化时更新free space map，新的值加入页面在zone map中的范围
     RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-    if (rid.slot_no < 0  || !Bitmap::is_set(page_handle.bitmap, rid.slot_no)) {
-        throw RecordNotFoundError(rid.page_no,rid.slot_no);
+    if (!page_handle.is_record(rid.slot_no)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        throw RecordNotFoundError(rid.page_no, rid.slot_no);
+    }
+    if (!page_handle.can_update(rid.slot_no, buf)) {
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        throw InternalError("RmFileHandle::update_record: record does not fit in its page");
+    }
+    bool had_room = page_handle.has_room();
+    page_handle.update(rid.slot_no, buf);
+    zone_map_.add(rid.page_no, buf);
+    if (had_room && !page_handle.has_room()) {
+        mark_page_full(page_handle);
+    } else if (!had_room && page_handle.has_room()) {
+        release_page_handle(page_handle);
+    }
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
+}
+
+/**
+ * @description: 能否在空闲的位置rid插入记录，撤销删除时用来判断原来的位置是否还可用
+ * @param {Rid&} rid 插入的位置
+ * @param {char*} buf 要插入的记录
+ */
+bool RmFileHandle::can_insert_at(const Rid& rid, const char* buf) const {
+    if (lsm_ != nullptr) {
+        uint64_t key = lsm_key(rid);
+        return key != UINT64_MAX && !lsm_->contains(key);
+    }
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    bool can_insert = page_handle.can_insert(rid.slot_no, buf);
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    return can_insert;
+}
+
+/**
+ * @description: rid上的记录能否原地更新为buf。定长格式总是可以；slotted page中记录变长后所在页面放不下时不行
+ * @param {Rid&} rid 要更新的记录
+ * @param {char*} buf 新记录的数据
+ */
+bool RmFileHandle::can_update_in_place(const Rid& rid, const char* buf) const {
+    if (!file_hdr_.is_slotted()) {
+        return true;
+    }
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    bool can_update = page_handle.can_update(rid.slot_no, buf);
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    return can_update;
+}
+
+/**
+ * @description: 记录修改页面的日志之后，把页面的page_lsn推进到该日志的lsn
+ * @param {int} page_no 被修改的页面
+ * @param {lsn_t} lsn 修改页面的日志的lsn
+ */
+void RmFileHandle::set_page_lsn(int page_no, lsn_t lsn) {
+    if (lsm_ != nullptr) {
+        // LSM表的修改在memtable中，由memtable记录日志的lsn
+        lsm_->note_lsn(lsn);
+        logged_.store(true, std::memory_order_relaxed);
+        return;
+    }
+    Page* page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});
+    if (page == nullptr) {
+        throw InternalError("RmFileHandle::set_page_lsn: buffer pool is full");
+    }
+    // 并发事务的日志可能先于本条日志推进page_lsn
+    bool advance = page->get_page_lsn() < lsn;
+    if (advance) {
+        page->set_page_lsn(lsn);
+    }
+    page->update_rec_lsn(lsn);
+    logged_.store(true, std::memory_order_relaxed);
+    buffer_pool_manager_->unpin_page(page->get_page_id(), advance);
+}
+
+/**
+ * @description: 崩溃恢复时按文件大小修正页面数。文件头只在关闭时写回，
+ *               崩溃前被写回磁盘的新页面可能不在文件头记录的页面数之内，而它们的日志可能已经被检查点丢弃
+ */
+void RmFileHandle::recover_num_pages() {
+    if (lsm_ != nullptr) {
+        return;
+    }
+    int file_size = disk_manager_->get_file_size(disk_manager_->get_file_name(fd_));
+    int num_pages = file_size / PAGE_SIZE;
+    if (num_pages > file_hdr_.num_pages) {
+        file_hdr_.num_pages = num_pages;
+        disk_manager_->set_fd2pageno(fd_, num_pages);
+        zone_map_.extend(num_pages, false);
+    }
+}
+
+/**
+ * @description: 按照每个页面中的记录数重建free space map和空闲页链表，按页面中的记录重建zone map。
+ *               崩溃恢复重做日志时只修改各个页面，文件头中的空闲空间信息在重做完成后由这里统一重建
+ */
+void RmFileHandle::rebuild_free_space() {
+    logged_.store(true, std::memory_order_relaxed);
+    if (lsm_ != nullptr) {
+        lsm_update_num_pages();
+        return;
+    }
+    fsm_ = RmFreeSpaceMap();
+    file_hdr_.first_free_page_no = RM_NO_PAGE;
+    bool rebuild_zones = !zone_map_.columns().empty();
+    if (rebuild_zones) {
+        zone_map_.reset(file_hdr_.num_pages);
+    }
+    std::vector<char> record_buf(file_hdr_.record_size);
+    // 从后向前把页面插入链表的表头，链表中的页面按页号递增
+    for (int page_no = file_hdr_.num_pages - 1; page_no >= RM_FIRST_RECORD_PAGE; page_no--) {
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        int next_free_page_no = page_handle.page_hdr->next_free_page_no;
+        page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
+        if (page_handle.has_room()) {
+            release_page_handle(page_handle);
+        }
+        int n = file_hdr_.num_records_per_page;
+        for (int slot = page_handle.next_record(-1); rebuild_zones && slot < n; slot = page_handle.next_record(slot)) {
+            zone_map_.add(page_no, page_handle.get_record(slot, record_buf.data()));
+        }
+        bool is_dirty = page_handle.page_hdr->next_free_page_no != next_free_page_no;
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), is_dirty);
+    }
+}
+
+/**
+ * @description: 页面page_no中能放下记录buf的第一个空闲slot，用于整理表时把记录移动到前面的页面
+ * @return {int} slot号，页面已满或放不下buf时返回-1
+ */
+int RmFileHandle::find_free_slot(int page_no, const char* buf) const {
+    if (lsm_ != nullptr) {
+        return -1;
     }
-    char* slot_data = page_handle.get_slot(rid.slot_no);
-    memcpy(slot_data, buf, file_hdr_.record_size);
+    RmPageHandle page_handle = fetch_page_handle(page_no);
+    int slot_no = page_handle.next_free_slot(-1);
+    bool can_insert = page_handle.can_insert(slot_no, buf);
+    buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    return can_insert ? slot_no : -1;
+}
+
+/**
+ * @description: 截掉文件末尾连续的空页面：从缓冲池中删除这些页面，页面数减少到最后一个有记录的页面之后，
+ *               之后新分配的页面从截断处开始复用页号，顺序扫描也不再读取它们。
+ *               磁盘文件的大小不变，崩溃恢复时recover_num_pages()仍然可以访问这些页面上的日志
+ *               LSM表合并全部sorted run并丢弃删除标记
+ * @return {int} 截掉的页面数，LSM表为释放的sorted run页面数
+ */
+int RmFileHandle::truncate() {
+    if (lsm_ != nullptr) {
+        return static_cast<int>(lsm_->compact());
+    }
+    int num_pages = file_hdr_.num_pages;
+    while (num_pages > RM_FIRST_RECORD_PAGE) {
+        RmPageHandle page_handle = fetch_page_handle(num_pages - 1);
+        bool empty = page_handle.page_hdr->num_records == 0;
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        if (!empty) {
+            break;
+        }
+        num_pages--;
+    }
+    int truncated = file_hdr_.num_pages - num_pages;
+    if (truncated == 0) {
+        return 0;
+    }
+    for (int page_no = num_pages; page_no < file_hdr_.num_pages; page_no++) {
+        if (!buffer_pool_manager_->delete_page(PageId{fd_, page_no})) {
+            throw InternalError("RmFileHandle::truncate: page is pinned");
+        }
+    }
+    file_hdr_.num_pages = num_pages;
+    disk_manager_->set_fd2pageno(fd_, num_pages);
+    // 截掉的页面可能在free space map或空闲页链表中，按剩余的页面重建
+    rebuild_free_space();
+    return truncated;
 }
 
 /**
@@ -129,82 +475,114 @@ void RmFileHandle::update_record(const Rid& rid, char* buf, Context* context) {
 /**
  * @description: 获取指定页面的页面句柄
  * @param {int} page_no 页面号
+ * @param {AccessType} access_type 访问模式提示，RmScan顺序扫描时传入AccessType::Scan
  * @return {RmPageHandle} 指定页面的句柄
  */
-RmPageHandle RmFileHandle::fetch_page_handle(int page_no) const {
+RmPageHandle RmFileHandle::fetch_page_handle(int page_no, AccessType access_type) const {
     // Todo:
     // 使用缓冲池获取指定页面，并生成page_handle返回给上层
     // if page_no is invalid, throw PageNotExistError exception
     std::string table_name = disk_manager_->get_file_name(fd_);
+    if (lsm_ != nullptr) {
+        throw InternalError("RmFileHandle::fetch_page_handle: LSM table has no record pages");
+    }
     if (page_no < 0 || page_no >= file_hdr_.num_pages) {
         throw PageNotExistError(table_name,page_no);
     }
-    Page* page = buffer_pool_manager_->fetch_page((PageId){fd_,page_no});
+    Page* page = buffer_pool_manager_->fetch_page((PageId){fd_,page_no}, access_type);
     return RmPageHandle(&file_hdr_, page);
 }
 
 /**
- * @description: 创建一个新的page handle
+ * @description: 创建一个新的page handle，新页面为空页，记录到free space map或空闲页链表中
  * @return {RmPageHandle} 新的PageHandle
+ * @note pin the page, remember to unpin it outside!
  */
 RmPageHandle RmFileHandle::create_new_page_handle() {
-    // Todo:
-    // 1.使用缓冲池来创建一个新page
-    // 2.更新page handle中的相关信息
-    // 3.更新file_hdr_
-    PageId page_id = (PageId){fd_,INVALID_PAGE_ID};
-    Page* page;
-    page = buffer_pool_manager_->new_page(&page_id);
-    int page_no = page_id.page_no;
-    file_hdr_.num_pages++;
-    if(file_hdr_.first_free_page_no==-1){
-        file_hdr_.first_free_page_no = page_no;
+    if (lsm_ != nullptr) {
+        throw InternalError("RmFileHandle::create_new_page_handle: LSM table has no record pages");
     }
-    else {
-        RmPageHandle firstFreePageHandle = fetch_page_handle(file_hdr_.first_free_page_no);
-        firstFreePageHandle.page_hdr->next_free_page_no = page_no;
+    PageId page_id = (PageId){fd_, INVALID_PAGE_ID};
+    Page* page = buffer_pool_manager_->new_page(&page_id);
+    if (page == nullptr) {
+        throw InternalError("RmFileHandle::create_new_page_handle: buffer pool is full");
     }
-    return RmPageHandle(&file_hdr_, page);
+    file_hdr_.num_pages++;
+    zone_map_.extend(file_hdr_.num_pages);
+    page->set_page_lsn(INVALID_LSN);
+    RmPageHandle page_handle(&file_hdr_, page);
+    page_handle.init();
+    release_page_handle(page_handle);
+    return page_handle;
 }
 
 /**
- * @brief 创建或获取一个空闲的page handle
+ * @description: LSM表的虚拟页面数覆盖已经分配的全部行号
+ */
+void RmFileHandle::lsm_update_num_pages() {
+    uint64_t per_page = file_hdr_.num_records_per_page;
+    file_hdr_.num_pages = RM_FIRST_RECORD_PAGE + static_cast<int>((lsm_->end_key() + per_page - 1) / per_page);
+}
+
+/**
+ * @brief 创建或获取一个能放下记录buf的page handle
  *
+ * @param buf 要插入的记录
  * @return RmPageHandle 返回生成的空闲page handle
  * @note pin the page, remember to unpin it outside!
  */
-RmPageHandle RmFileHandle::create_page_handle() {
-    // Todo:
-    // 1. 判断file_hdr_中是否还有空闲页
-    //     1.1 没有空闲页：使用缓冲池来创建一个新page；可直接调用create_new_page_handle()
-    //     1.2 有空闲页：直接获取第一个空闲页
-    // 2. 生成page handle并返回给上层
-    if(file_hdr_.first_free_page_no==-1){
-        RmPageHandle newpagehandle = create_new_page_handle();
-        newpagehandle.page_hdr->next_free_page_no=-1;
-        newpagehandle.page_hdr->num_records=0;
-        file_hdr_.first_free_page_no = newpagehandle.page->get_page_id().page_no; 
-        return newpagehandle;
+RmPageHandle RmFileHandle::create_page_handle(const char* buf) {
+    // 1. 优先从free space map中取得有空闲空间的页面
+    // 2. 其次取空闲页链表的表头，链表中只有free space map记录不下的页面（以及旧文件中的页面）
+    // 3. slotted page只有能放下最长的元组时才记录为有空闲空间，追加插入时先尝试把记录放进最后一个页面的剩余空间
+    // 4. 都没有时使用缓冲池创建一个新page
+    int page_no = fsm_.find_free_page();
+    if (page_no != RM_NO_PAGE) {
+        return fetch_page_handle(page_no);
     }
-    int page_no = file_hdr_.first_free_page_no;
-    return fetch_page_handle(page_no);
+    while (file_hdr_.first_free_page_no != RM_NO_PAGE) {
+        RmPageHandle page_handle = fetch_page_handle(file_hdr_.first_free_page_no);
+        if (page_handle.has_room()) {
+            return page_handle;
+        }
+        // 指定位置插入可能填满链表中间的页面，这里惰性地移除
+        mark_page_full(page_handle);
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
+    }
+    if (file_hdr_.is_slotted() && file_hdr_.num_pages > RM_FIRST_RECORD_PAGE) {
+        RmPageHandle page_handle = fetch_page_handle(file_hdr_.num_pages - 1);
+        if (page_handle.can_insert(page_handle.next_free_slot(-1), buf)) {
+            return page_handle;
+        }
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+    }
+    return create_new_page_handle();
 }
 
 /**
- * @description: 当一个页面从没有空闲空间的状态变为有空闲空间状态时，更新文件头和页头中空闲页面相关的元数据
+ * @description: 当一个页面从没有空闲空间的状态变为有空闲空间状态时，更新free space map或空闲页链表
  */
-void RmFileHandle::release_page_handle(RmPageHandle&page_handle) {
-    // Todo:
-    // 当page从已满变成未满，考虑如何更新：
-    // 1. page_handle.page_hdr->next_free_page_no
-    // 2. file_hdr_.first_free_page_no
-    if(file_hdr_.first_free_page_no==-1){
-        file_hdr_.first_free_page_no = page_handle.page->get_page_id().page_no;
-        page_handle.page_hdr->next_free_page_no = -1;
-    }
-    else{
-        int oldFirstFreePage = file_hdr_.first_free_page_no;
-        file_hdr_.first_free_page_no = page_handle.page->get_page_id().page_no;
-        page_handle.page_hdr->next_free_page_no = oldFirstFreePage;
-    }
-}
\ No newline at end of file
+void RmFileHandle::release_page_handle(RmPageHandle& page_handle) {
+    int page_no = page_handle.page->get_page_id().page_no;
+    if (RmFreeSpaceMap::tracks(page_no)) {
+        fsm_.set(page_no, true);
+        return;
+    }
+    page_handle.page_hdr->next_free_page_no = file_hdr_.first_free_page_no;
+    file_hdr_.first_free_page_no = page_no;
+}
+
+/**
+ * @description: 页面插入记录后已满，从free space map中清除，或者从空闲页链表的表头移除
+ *               不在表头的已满页面由create_page_handle()在其成为表头时移除
+ */
+void RmFileHandle::mark_page_full(RmPageHandle& page_handle) {
+    int page_no = page_handle.page->get_page_id().page_no;
+    if (RmFreeSpaceMap::tracks(page_no)) {
+        fsm_.set(page_no, false);
+    }
+    if (file_hdr_.first_free_page_no == page_no) {
+        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
+        page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
+    }
+}
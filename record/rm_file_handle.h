@@ -2,15 +2,25 @@
 
 #include <assert.h>
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 #include "bitmap.h"
 #include "common/context.h"
 #include "rm_defs.h"
+#include "rm_free_space_map.h"
+#include "rm_lsm_tree.h"
+#include "rm_slotted_page.h"
+#include "rm_zone_map.h"
 
 class RmManager;
 
-/* 对表数据文件中的页面进行封装 */
+/* 对表数据文件中的页面进行封装
+   定长格式的页面由bitmap和定长slot组成；含有变长字段的表使用RmSlottedPage，bitmap和slots不使用
+   PAX格式的页面同样使用bitmap，slots区域的大小也相同，但其中按列切分为minipage：
+   minipage i从slots + num_records_per_page * minipages[i].offset开始，依次存放每个slot中该部分字段的值
+   is_record()、insert()等接口对各种格式统一，记录都以定长的内存格式传入传出 */
 struct RmPageHandle {
     const RmFileHdr *file_hdr;  // 当前页面所在文件的文件头指针
     Page *page;                 // 页面的实际数据，包括页面存储的数据、元信息等
@@ -24,59 +34,265 @@ struct RmPageHandle {
         slots = bitmap + file_hdr->bitmap_size;
     }
 
-    // 返回指定slot_no的slot存储收地址
+    // 返回指定slot_no的slot存储收地址，只用于按行存储的定长格式
     char* get_slot(int slot_no) const {
         return slots + slot_no * file_hdr->record_size;  // slots的首地址 + slot个数 * 每个slot的大小(每个record的大小)
     }
+
+    // PAX格式中第i个minipage的首地址
+    char *minipage(int i) const { return slots + file_hdr->num_records_per_page * file_hdr->minipages[i].offset; }
+
+    /**
+     * @description: 记录中偏移为offset的字段在页面中的列视图，slotted page不支持
+     * @return {char*} 第0个slot中该字段的地址，第i个slot中该字段位于返回值 + i * stride
+     * @param {size_t*} stride 相邻两个slot中该字段的间隔：定长格式为记录长度，PAX格式为字段所在minipage的宽度
+     */
+    const char *column(int offset, size_t *stride) const {
+        if (!file_hdr->is_pax()) {
+            *stride = file_hdr->record_size;
+            return slots + offset;
+        }
+        int i = file_hdr->num_minipages - 1;
+        while (i > 0 && file_hdr->minipages[i].offset > offset) {
+            i--;
+        }
+        const RmMinipage &mp = file_hdr->minipages[i];
+        *stride = mp.len;
+        return minipage(i) + (offset - mp.offset);
+    }
+
+    RmSlottedPage slotted() const { return RmSlottedPage(file_hdr, page->get_data()); }
+
+    // 初始化一个空页面
+    void init() {
+        page_hdr->next_free_page_no = RM_NO_PAGE;
+        page_hdr->num_records = 0;
+        if (file_hdr->is_slotted()) {
+            slotted().init();
+        } else {
+            Bitmap::init(bitmap, file_hdr->bitmap_size);
+        }
+    }
+
+    bool is_record(int slot_no) const {
+        if (file_hdr->is_slotted()) {
+            return slotted().is_record(slot_no);
+        }
+        return slot_no >= 0 && slot_no < file_hdr->num_records_per_page && Bitmap::is_set(bitmap, slot_no);
+    }
+
+    // slot_no之后的第一条记录，没有时返回file_hdr->num_records_per_page
+    int next_record(int slot_no) const {
+        if (file_hdr->is_slotted()) {
+            return slotted().next_record(slot_no);
+        }
+        return Bitmap::next_bit(true, bitmap, file_hdr->num_records_per_page, slot_no);
+    }
+
+    // slot_no之后的第一个空闲slot，没有时返回file_hdr->num_records_per_page
+    int next_free_slot(int slot_no) const {
+        if (file_hdr->is_slotted()) {
+            return slotted().next_free_slot(slot_no);
+        }
+        return Bitmap::next_bit(false, bitmap, file_hdr->num_records_per_page, slot_no);
+    }
+
+    // 页面能否再插入任意一条记录，free space map和空闲页链表中只记录满足这一条件的页面
+    bool has_room() const {
+        if (file_hdr->is_slotted()) {
+            return slotted().has_room();
+        }
+        return page_hdr->num_records < file_hdr->num_records_per_page;
+    }
+
+    /**
+     * @description: 读取slot_no上的记录：定长格式直接返回页面中的slot，slotted page解码到buf中、
+     *               PAX格式从各minipage取出字段拼接到buf中，并返回buf
+     * @param {char*} buf 解码的缓冲区，有file_hdr->record_size字节，定长格式不使用
+     */
+    const char *get_record(int slot_no, char *buf) const {
+        if (file_hdr->is_slotted()) {
+            RmSlottedPage::decode(*file_hdr, slotted().tuple(slot_no), buf);
+            return buf;
+        }
+        if (file_hdr->is_pax()) {
+            for (int i = 0; i < file_hdr->num_minipages; i++) {
+                const RmMinipage &mp = file_hdr->minipages[i];
+                memcpy(buf + mp.offset, minipage(i) + slot_no * mp.len, mp.len);
+            }
+            return buf;
+        }
+        return get_slot(slot_no);
+    }
+
+    // 空闲的slot_no能否插入record
+    bool can_insert(int slot_no, const char *record) const {
+        if (file_hdr->is_slotted()) {
+            RmSlottedPage page = slotted();
+            return !page.is_record(slot_no) && page.can_put(slot_no, RmSlottedPage::encoded_size(*file_hdr, record));
+        }
+        return slot_no >= 0 && slot_no < file_hdr->num_records_per_page && !Bitmap::is_set(bitmap, slot_no);
+    }
+
+    // slot_no上的记录能否原地更新为record，定长格式总是可以
+    bool can_update(int slot_no, const char *record) const {
+        if (file_hdr->is_slotted()) {
+            return slotted().can_put(slot_no, RmSlottedPage::encoded_size(*file_hdr, record));
+        }
+        return true;
+    }
+
+    // 在空闲的slot_no插入一条记录，调用前需检查can_insert()
+    void insert(int slot_no, const char *record) {
+        write(slot_no, record);
+        if (!file_hdr->is_slotted()) {
+            Bitmap::set(bitmap, slot_no);
+        }
+        page_hdr->num_records++;
+    }
+
+    // 原地更新slot_no上的记录，调用前需检查can_update()
+    void update(int slot_no, const char *record) { write(slot_no, record); }
+
+    void erase(int slot_no) {
+        if (file_hdr->is_slotted()) {
+            slotted().erase(slot_no);
+        } else {
+            Bitmap::reset(bitmap, slot_no);
+        }
+        page_hdr->num_records--;
+    }
+
+   private:
+    void write(int slot_no, const char *record) {
+        if (file_hdr->is_slotted()) {
+            char tuple[PAGE_SIZE];
+            int size = RmSlottedPage::encode(*file_hdr, record, tuple);
+            slotted().put(slot_no, tuple, size);
+        } else if (file_hdr->is_pax()) {
+            for (int i = 0; i < file_hdr->num_minipages; i++) {
+                const RmMinipage &mp = file_hdr->minipages[i];
+                memcpy(minipage(i) + slot_no * mp.len, record + mp.offset, mp.len);
+            }
+        } else {
+            memcpy(get_slot(slot_no), record, file_hdr->record_size);
+        }
+    }
 };
 
-/* 每个RmFileHandle对应一个表的数据文件，里面有多个page，每个page的数据封装在RmPageHandle中 */
+/* 每个RmFileHandle对应一个表的数据文件，里面有多个page，每个page的数据封装在RmPageHandle中
+   LSM表的记录存放在RmLsmTree中，数据文件只有文件头。行号按num_records_per_page条一组编成虚拟的页面，
+   行号key的rid为{RM_FIRST_RECORD_PAGE + key / num_records_per_page, key % num_records_per_page}，
+   file_hdr_.num_pages覆盖已经分配的全部行号，按页面划分扫描范围的调用者不需要区分两种表 */
 class RmFileHandle {      
     friend class RmScan;    
     friend class RmManager;
+    friend class RecoveryManager;
 
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     int fd_;        // 打开文件后产生的文件句柄
     RmFileHdr file_hdr_;    // 文件头，维护当前表文件的元数据
+    RmFreeSpaceMap fsm_;    // 记录哪些页面还有空闲slot，与file_hdr_一起存放在文件头页中
+    RmZoneMap zone_map_;    // 每个页面中部分字段的最小值和最大值，存放在数据文件旁的zone map文件中
+    // 打开之后是否记录过修改页面的日志。文件头和空闲空间信息只在关闭时写回，为true时崩溃后需要重建
+    std::atomic<bool> logged_{false};
+    std::unique_ptr<RmLsmTree> lsm_;    // LSM表的存储，堆表为nullptr
 
    public:
     RmFileHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
         : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
         // 注意：这里从磁盘中读出文件描述符为fd的文件的file_hdr，读到内存中
         // 这里实际就是初始化file_hdr，只不过是从磁盘中读出进行初始化
-        // init file_hdr_
-        disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
+        // init file_hdr_ and fsm_
+        char page_buf[PAGE_SIZE];
+        disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        memcpy(&file_hdr_, page_buf, sizeof(file_hdr_));
+        fsm_.deserialize(page_buf + sizeof(file_hdr_));
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
     }
 
-    RmFileHdr get_file_hdr() { return file_hdr_; }
+    RmFileHdr get_file_hdr() const { return file_hdr_; }
+    const RmZoneMap &zone_map() const { return zone_map_; }
     int GetFd() { return fd_; }
+    RmLsmTree *lsm() const { return lsm_.get(); }
+
+    // LSM表memtable中最早的修改的lsn，作为检查点中文件头页的recLSN
+    lsn_t memtable_rec_lsn() const { return lsm_ != nullptr ? lsm_->rec_lsn() : INVALID_LSN; }
 
     /* 判断指定位置上是否已经存在一条记录，通过Bitmap来判断 */
     bool is_record(const Rid &rid) const {
+        if (lsm_ != nullptr) {
+            return lsm_->contains(lsm_key(rid));
+        }
         RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-        return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        bool is_set = page_handle.is_record(rid.slot_no);  // page的slot_no位置上是否有record
+        buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        return is_set;
     }
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
+    RmRecordView get_record_view(const Rid &rid) const;
+
+    size_t count_records() const;
+
+    double estimate_records(int sample_pages) const;
+
+    size_t sample_records(int sample_pages, std::vector<char> &out) const;
+
     Rid insert_record(char *buf, Context *context);
 
     void insert_record(const Rid &rid, char *buf);
 
+    std::vector<Rid> insert_records(const std::vector<char *> &bufs, Context *context);
+
     void delete_record(const Rid &rid, Context *context);
 
     void update_record(const Rid &rid, char *buf, Context *context);
 
+    bool can_insert_at(const Rid &rid, const char *buf) const;
+
+    bool can_update_in_place(const Rid &rid, const char *buf) const;
+
+    void set_page_lsn(int page_no, lsn_t lsn);
+
+    bool has_logged_changes() const { return logged_.load(std::memory_order_relaxed); }
+
+    void recover_num_pages();
+
+    void rebuild_free_space();
+
+    int find_free_slot(int page_no, const char *buf) const;
+
+    int truncate();
+
     RmPageHandle create_new_page_handle();
 
-    RmPageHandle fetch_page_handle(int page_no) const;
+    RmPageHandle fetch_page_handle(int page_no, AccessType access_type = AccessType::Normal) const;
 
    private:
-    RmPageHandle create_page_handle();
+    // LSM表中rid对应的行号，rid不可能存在时返回UINT64_MAX
+    uint64_t lsm_key(const Rid &rid) const {
+        if (rid.page_no < RM_FIRST_RECORD_PAGE || rid.slot_no < 0 || rid.slot_no >= file_hdr_.num_records_per_page) {
+            return UINT64_MAX;
+        }
+        return static_cast<uint64_t>(rid.page_no - RM_FIRST_RECORD_PAGE) * file_hdr_.num_records_per_page +
+               rid.slot_no;
+    }
+
+    Rid lsm_rid(uint64_t key) const {
+        int per_page = file_hdr_.num_records_per_page;
+        return Rid{RM_FIRST_RECORD_PAGE + static_cast<int>(key / per_page), static_cast<int>(key % per_page)};
+    }
+
+    void lsm_update_num_pages();
+
+    RmPageHandle create_page_handle(const char *buf);
 
     void release_page_handle(RmPageHandle &page_handle);
+
+    void mark_page_full(RmPageHandle &page_handle);
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "rm_defs.h"
+
+/*
+RmFreeSpaceMap是表数据文件的空闲空间位图，每个页面占一位，置1表示该页面还有空闲slot
+位图与RmFileHdr一起持久化在文件头页(第0页)中RmFileHdr之后的位置，因此最多只能记录RM_FSM_MAX_PAGES个页面，
+页号更大的页面仍然通过RmPageHdr::next_free_page_no组成的空闲页链表管理
+insert时按64位字查找置1的位，并从上一次找到的字开始查找，避免每次都从头扫描已满的页面
+*/
+class RmFreeSpaceMap {
+   public:
+    RmFreeSpaceMap() { memset(words_, 0, sizeof(words_)); }
+
+    // 该页面是否由位图记录
+    static bool tracks(int page_no) { return page_no >= 0 && page_no < RM_FSM_MAX_PAGES; }
+
+    /**
+     * @description: 设置页面是否还有空闲slot
+     * @param {int} page_no 页面号，必须满足tracks(page_no)
+     * @param {bool} has_free 是否还有空闲slot
+     */
+    void set(int page_no, bool has_free) {
+        uint64_t bit = 1ULL << (page_no % 64);
+        uint64_t &word = words_[page_no / 64];
+        if (((word & bit) != 0) == has_free) {
+            return;
+        }
+        word ^= bit;
+        num_free_ += has_free ? 1 : -1;
+        if (has_free) {
+            hint_ = page_no / 64;
+        }
+    }
+
+    bool is_free(int page_no) const { return tracks(page_no) && (words_[page_no / 64] >> (page_no % 64) & 1); }
+
+    /**
+     * @description: 查找一个还有空闲slot的页面
+     * @return {int} 页面号，没有空闲页面时返回RM_NO_PAGE
+     */
+    int find_free_page() {
+        if (num_free_ == 0) {
+            return RM_NO_PAGE;
+        }
+        for (int i = 0; i < RM_FSM_WORDS; i++) {
+            int w = (hint_ + i) % RM_FSM_WORDS;
+            if (words_[w] != 0) {
+                hint_ = w;
+                return w * 64 + __builtin_ctzll(words_[w]);
+            }
+        }
+        return RM_NO_PAGE;
+    }
+
+    int num_free_pages() const { return num_free_; }
+
+    // 序列化到文件头页中，dst至少有RM_FSM_SIZE字节
+    void serialize(char *dst) const { memcpy(dst, words_, sizeof(words_)); }
+
+    // 从文件头页中读出位图，旧文件中这部分为0，所有页面都由空闲页链表管理
+    void deserialize(const char *src) {
+        memcpy(words_, src, sizeof(words_));
+        num_free_ = 0;
+        for (auto word : words_) {
+            num_free_ += __builtin_popcountll(word);
+        }
+        hint_ = 0;
+    }
+
+   private:
+    uint64_t words_[RM_FSM_WORDS];
+    int num_free_ = 0;  // 置1的位数
+    int hint_ = 0;      // 下一次查找的起始字
+};
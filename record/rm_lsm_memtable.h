@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+
+#include "common/arena.h"
+#include "common/config.h"
+
+/* 按行号递增遍历LSM表中一个有序数据源(memtable、sorted run或它们的合并)的迭代器
+   record()指向当前行的记录，为nullptr表示该行在这个数据源中是删除标记；记录在调用next()或seek()之前有效 */
+class RmLsmIterator {
+   public:
+    virtual ~RmLsmIterator() = default;
+
+    // 定位到第一个行号不小于key的行
+    virtual void seek(uint64_t key) = 0;
+
+    virtual bool valid() const = 0;
+
+    virtual void next() = 0;
+
+    virtual uint64_t key() const = 0;
+
+    virtual const char *record() const = 0;
+};
+
+/*
+RmLsmMemTable是LSM表的内存写缓冲：以行号为key的跳表，每个行号一个节点，节点指向该行最新的记录或删除标记
+1. 写入由调用者串行化(RmLsmTree的write_latch_)，读取和遍历不加锁：新节点的各层指针先设置好，
+   再从低到高用release语义链入跳表；覆盖写入时记录复制到新分配的内存后原子地替换节点的记录指针，
+   读者看到的总是某一次完整写入的记录
+2. 节点和记录从Arena分配，memtable析构时统一释放，被覆盖的旧记录也计入内存用量，
+   用量超过LSM_MEMTABLE_SIZE时由RmLsmTree冻结并写成sorted run
+3. 记录修改它的日志中最小和最大的lsn：前者像脏页的recLSN一样限制检查点截断日志，
+   后者说明写出sorted run之前日志需要落盘到哪里
+*/
+class RmLsmMemTable {
+   private:
+    struct Node {
+        uint64_t key;
+        std::atomic<const char *> record;       // nullptr表示删除标记
+        std::atomic<Node *> next_[1];           // 实际有height个，在节点之后连续分配
+
+        std::atomic<Node *> *next(int level) { return &next_[level]; }
+    };
+
+   public:
+    static constexpr int MAX_HEIGHT = 12;
+
+    explicit RmLsmMemTable(int record_size) : record_size_(record_size) { head_ = new_node(0, MAX_HEIGHT); }
+
+    RmLsmMemTable(const RmLsmMemTable &) = delete;
+    RmLsmMemTable &operator=(const RmLsmMemTable &) = delete;
+
+    /**
+     * @description: 写入一行，行号已经存在时覆盖。调用者保证同一时刻只有一个写入者
+     * @param {uint64_t} key 行号
+     * @param {char*} record 记录，为nullptr时写入删除标记
+     */
+    void put(uint64_t key, const char *record) {
+        const char *data = nullptr;
+        if (record != nullptr) {
+            char *copy = arena_.allocate(record_size_);
+            memcpy(copy, record, record_size_);
+            data = copy;
+        }
+        Node *prev[MAX_HEIGHT];
+        Node *x = find_greater_or_equal(key, prev);
+        if (x != nullptr && x->key == key) {
+            x->record.store(data, std::memory_order_release);
+        } else {
+            int height = random_height();
+            int max_height = max_height_.load(std::memory_order_relaxed);
+            for (int i = max_height; i < height; i++) {
+                prev[i] = head_;
+            }
+            if (height > max_height) {
+                // 读者看到旧的高度时从较低的层开始查找，看到新的高度时head_的高层指针为空或指向新节点，都是正确的
+                max_height_.store(height, std::memory_order_relaxed);
+            }
+            x = new_node(key, height);
+            x->record.store(data, std::memory_order_relaxed);
+            for (int i = 0; i < height; i++) {
+                x->next(i)->store(prev[i]->next(i)->load(std::memory_order_relaxed), std::memory_order_relaxed);
+                prev[i]->next(i)->store(x, std::memory_order_release);
+            }
+            num_entries_.fetch_add(1, std::memory_order_relaxed);
+        }
+        memory_usage_.store(arena_.memory_usage(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @description: 查找一行
+     * @return {bool} memtable中是否有该行(包括删除标记)
+     * @param {char**} record 该行的记录，删除标记为nullptr
+     */
+    bool get(uint64_t key, const char **record) const {
+        Node *x = find_greater_or_equal(key, nullptr);
+        if (x == nullptr || x->key != key) {
+            return false;
+        }
+        *record = x->record.load(std::memory_order_acquire);
+        return true;
+    }
+
+    /* 遍历memtable，可以与写入并发，遍历期间新写入的行可能被看到也可能看不到 */
+    class Iterator : public RmLsmIterator {
+       public:
+        explicit Iterator(std::shared_ptr<const RmLsmMemTable> table) : table_(std::move(table)) {}
+
+        void seek(uint64_t key) override { set(table_->find_greater_or_equal(key, nullptr)); }
+
+        bool valid() const override { return node_ != nullptr; }
+
+        void next() override { set(node_->next(0)->load(std::memory_order_acquire)); }
+
+        uint64_t key() const override { return node_->key; }
+
+        const char *record() const override { return record_; }
+
+       private:
+        // 定位时读出记录指针，之后的覆盖写入不影响本次返回的记录
+        void set(Node *node) {
+            node_ = node;
+            record_ = node != nullptr ? node->record.load(std::memory_order_acquire) : nullptr;
+        }
+
+        std::shared_ptr<const RmLsmMemTable> table_;
+        Node *node_ = nullptr;
+        const char *record_ = nullptr;
+    };
+
+    size_t memory_usage() const { return memory_usage_.load(std::memory_order_relaxed); }
+
+    // 行数，包括删除标记
+    size_t size() const { return num_entries_.load(std::memory_order_relaxed); }
+
+    bool empty() const { return size() == 0; }
+
+    // 记录修改本memtable中的行的日志
+    void note_lsn(lsn_t lsn) {
+        lsn_t first = first_lsn_.load(std::memory_order_relaxed);
+        while ((first == INVALID_LSN || lsn < first) &&
+               !first_lsn_.compare_exchange_weak(first, lsn, std::memory_order_relaxed)) {
+        }
+        lsn_t last = last_lsn_.load(std::memory_order_relaxed);
+        while (lsn > last && !last_lsn_.compare_exchange_weak(last, lsn, std::memory_order_relaxed)) {
+        }
+    }
+
+    lsn_t first_lsn() const { return first_lsn_.load(std::memory_order_relaxed); }
+
+    lsn_t last_lsn() const { return last_lsn_.load(std::memory_order_relaxed); }
+
+   private:
+    Node *new_node(uint64_t key, int height) {
+        char *mem = arena_.allocate(sizeof(Node) + sizeof(std::atomic<Node *>) * (height - 1));
+        Node *node = new (mem) Node;
+        node->key = key;
+        node->record.store(nullptr, std::memory_order_relaxed);
+        for (int i = 0; i < height; i++) {
+            new (node->next(i)) std::atomic<Node *>(nullptr);
+        }
+        return node;
+    }
+
+    // 每层以1/4的概率继续增高
+    int random_height() {
+        int height = 1;
+        while (height < MAX_HEIGHT && (rng_() & 3) == 0) {
+            height++;
+        }
+        return height;
+    }
+
+    // 第一个行号不小于key的节点，prev不为空时记录每一层中最后一个小于key的节点
+    Node *find_greater_or_equal(uint64_t key, Node **prev) const {
+        Node *x = head_;
+        int level = max_height_.load(std::memory_order_relaxed) - 1;
+        while (true) {
+            Node *next = x->next(level)->load(std::memory_order_acquire);
+            if (next != nullptr && next->key < key) {
+                x = next;
+                continue;
+            }
+            if (prev != nullptr) {
+                prev[level] = x;
+            }
+            if (level == 0) {
+                return next;
+            }
+            level--;
+        }
+    }
+
+    int record_size_;
+    Arena arena_;
+    Node *head_;
+    std::atomic<int> max_height_{1};
+    std::minstd_rand rng_{0x5eed};
+    std::atomic<size_t> num_entries_{0};
+    std::atomic<size_t> memory_usage_{0};
+    std::atomic<lsn_t> first_lsn_{INVALID_LSN};
+    std::atomic<lsn_t> last_lsn_{INVALID_LSN};
+};
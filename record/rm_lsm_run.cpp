@@ -0,0 +1,314 @@
+#include "rm_lsm_run.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "common/metrics.h"
+
+namespace {
+
+constexpr uint32_t RUN_MAGIC = 0x4e55524c;     // "LRUN"
+constexpr int DATA_PAGE_HDR = 8;               // 数据页开头的行数和保留字段
+
+int pages_for(size_t bytes) { return static_cast<int>((bytes + PAGE_SIZE - 1) / PAGE_SIZE); }
+
+char *alloc_page() {
+    char *page = static_cast<char *>(aligned_alloc(PAGE_SIZE, PAGE_SIZE));
+    if (page == nullptr) {
+        throw std::bad_alloc();
+    }
+    return page;
+}
+
+}  // namespace
+
+/**
+ * @description: 每个数据页最多保存的行数
+ * @param {int} record_size 记录长度
+ */
+int RmLsmRunWriter::entries_per_page(int record_size) {
+    return (PAGE_SIZE - DATA_PAGE_HDR) / (static_cast<int>(sizeof(uint64_t)) + 1 + record_size);
+}
+
+/**
+ * @description: 创建sorted run文件，同名的旧文件(上次写到一半崩溃留下的)先删除
+ * @param {DiskManager*} disk_manager
+ * @param {string&} path 文件路径
+ * @param {int} record_size 记录长度
+ * @param {size_t} expected_entries 预计写入的行数，决定bloom filter的大小
+ */
+RmLsmRunWriter::RmLsmRunWriter(DiskManager *disk_manager, const std::string &path, int record_size,
+                               size_t expected_entries)
+    : disk_manager_(disk_manager) {
+    if (entries_per_page(record_size) < 1) {
+        throw InternalError("RmLsmRunWriter: record too large");
+    }
+    if (disk_manager_->is_file(path)) {
+        disk_manager_->destroy_file(path);
+    }
+    disk_manager_->create_file(path);
+    fd_ = disk_manager_->open_file(path);
+    page_ = alloc_page();
+    memset(page_, 0, PAGE_SIZE);
+    hdr_.magic = RUN_MAGIC;
+    hdr_.record_size = record_size;
+    hdr_.entries_per_page = entries_per_page(record_size);
+    bloom_ = BloomFilter(expected_entries, LSM_BLOOM_BITS_PER_KEY);
+    hdr_.bloom_bytes = static_cast<int64_t>(bloom_.size_bytes());
+}
+
+RmLsmRunWriter::~RmLsmRunWriter() {
+    free(page_);
+    disk_manager_->close_file(fd_);
+}
+
+/**
+ * @description: 加入一行，行号必须大于之前加入的所有行
+ * @param {uint64_t} key 行号
+ * @param {char*} record 记录，为nullptr时加入删除标记
+ */
+void RmLsmRunWriter::add(uint64_t key, const char *record) {
+    assert(!finished_ && (hdr_.num_entries == 0 || key > hdr_.max_key));
+    if (page_count_ == 0) {
+        first_keys_.push_back(key);
+    }
+    int epp = hdr_.entries_per_page;
+    reinterpret_cast<uint64_t *>(page_ + DATA_PAGE_HDR)[page_count_] = key;
+    char *deleted = page_ + DATA_PAGE_HDR + epp * sizeof(uint64_t);
+    char *records = deleted + epp;
+    deleted[page_count_] = record == nullptr;
+    if (record != nullptr) {
+        memcpy(records + page_count_ * hdr_.record_size, record, hdr_.record_size);
+    } else {
+        hdr_.num_deleted++;
+    }
+    bloom_.add(key);
+    if (hdr_.num_entries == 0) {
+        hdr_.min_key = key;
+    }
+    hdr_.max_key = key;
+    hdr_.num_entries++;
+    if (++page_count_ == epp) {
+        flush_data_page();
+    }
+}
+
+void RmLsmRunWriter::flush_data_page() {
+    *reinterpret_cast<int32_t *>(page_) = page_count_;
+    write_page(1 + hdr_.num_data_pages);
+    hdr_.num_data_pages++;
+    page_count_ = 0;
+    memset(page_, 0, PAGE_SIZE);
+}
+
+void RmLsmRunWriter::write_page(page_id_t page_no) { disk_manager_->write_page(fd_, page_no, page_, PAGE_SIZE); }
+
+/**
+ * @description: 写入块索引、bloom filter和文件头并落盘。文件头最后写入，没有写完的文件没有有效的文件头
+ */
+void RmLsmRunWriter::finish() {
+    if (page_count_ > 0) {
+        flush_data_page();
+    }
+    page_id_t page_no = 1 + hdr_.num_data_pages;
+    auto write_array = [&](const char *data, size_t bytes) {
+        int num_pages = pages_for(bytes);
+        for (int i = 0; i < num_pages; i++) {
+            memset(page_, 0, PAGE_SIZE);
+            memcpy(page_, data + i * PAGE_SIZE, std::min<size_t>(PAGE_SIZE, bytes - i * PAGE_SIZE));
+            write_page(page_no++);
+        }
+        return num_pages;
+    };
+    hdr_.num_index_pages = write_array(reinterpret_cast<const char *>(first_keys_.data()),
+                                       first_keys_.size() * sizeof(uint64_t));
+    hdr_.num_bloom_pages = write_array(bloom_.data(), bloom_.size_bytes());
+    disk_manager_->sync_file(fd_);
+    memset(page_, 0, PAGE_SIZE);
+    memcpy(page_, &hdr_, sizeof(hdr_));
+    write_page(0);
+    disk_manager_->sync_file(fd_);
+    finished_ = true;
+}
+
+/**
+ * @description: 打开sorted run文件，读入文件头、块索引和bloom filter
+ * @param {DiskManager*} disk_manager
+ * @param {BufferPoolManager*} buffer_pool_manager 读取数据页使用的缓冲池
+ * @param {string&} path 文件路径
+ */
+RmLsmRun::RmLsmRun(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, const std::string &path)
+    : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), path_(path) {
+    fd_ = disk_manager_->open_file(path);
+    std::unique_ptr<char, decltype(&free)> page(alloc_page(), &free);
+    disk_manager_->read_page(fd_, 0, page.get(), PAGE_SIZE);
+    memcpy(&hdr_, page.get(), sizeof(hdr_));
+    if (hdr_.magic != RUN_MAGIC) {
+        disk_manager_->close_file(fd_);
+        throw InternalError("RmLsmRun: bad run file " + path);
+    }
+    page_id_t page_no = 1 + hdr_.num_data_pages;
+    auto read_array = [&](char *data, size_t bytes, int num_pages) {
+        for (int i = 0; i < num_pages; i++) {
+            disk_manager_->read_page(fd_, page_no++, page.get(), PAGE_SIZE);
+            memcpy(data + i * PAGE_SIZE, page.get(), std::min<size_t>(PAGE_SIZE, bytes - i * PAGE_SIZE));
+        }
+    };
+    first_keys_.resize(hdr_.num_data_pages);
+    read_array(reinterpret_cast<char *>(first_keys_.data()), first_keys_.size() * sizeof(uint64_t),
+               hdr_.num_index_pages);
+    std::vector<char> bloom(hdr_.bloom_bytes);
+    read_array(bloom.data(), bloom.size(), hdr_.num_bloom_pages);
+    bloom_ = BloomFilter(bloom.data(), bloom.size());
+    disk_manager_->set_fd2pageno(fd_, num_pages());
+    // 文件句柄可能是之前关闭的文件用过的，缓冲池中可能残留那个文件的页面
+    for (int page_no = 0; page_no < num_pages(); page_no++) {
+        buffer_pool_manager_->delete_page(PageId{fd_, page_no});
+    }
+}
+
+/**
+ * @description: 从缓冲池中删除文件的页面后关闭文件，文件已经被合并时删除文件。
+ *               文件句柄可能被之后打开的文件复用，缓冲池中不能留下旧文件的页面
+ */
+RmLsmRun::~RmLsmRun() {
+    for (int page_no = 0; page_no < num_pages(); page_no++) {
+        buffer_pool_manager_->delete_page(PageId{fd_, page_no});
+    }
+    disk_manager_->close_file(fd_);
+    if (obsolete_) {
+        disk_manager_->destroy_file(path_);
+    }
+}
+
+bool RmLsmRun::may_contain(uint64_t key) const {
+    if (hdr_.num_entries == 0 || key < hdr_.min_key || key > hdr_.max_key) {
+        return false;
+    }
+    bool found = bloom_.may_contain(key);
+    if (!found) {
+        EngineMetrics::get().lsm_bloom_skips.add();
+    }
+    return found;
+}
+
+// 可能包含key的数据页在数据页中的下标，即第一个行号不大于key的最后一个数据页
+int RmLsmRun::find_data_page(uint64_t key) const {
+    auto it = std::upper_bound(first_keys_.begin(), first_keys_.end(), key);
+    return static_cast<int>(it - first_keys_.begin()) - 1;
+}
+
+/**
+ * @description: 查找一行
+ * @return {bool} 文件中是否有该行(包括删除标记)
+ * @param {uint64_t} key 行号
+ * @param {char*} record 找到记录时复制到这里，为nullptr时不复制
+ * @param {bool*} deleted 找到的是否为删除标记
+ */
+bool RmLsmRun::get(uint64_t key, char *record, bool *deleted) const {
+    if (!may_contain(key)) {
+        return false;
+    }
+    int idx = find_data_page(key);
+    if (idx < 0) {
+        return false;
+    }
+    PageId page_id{fd_, 1 + idx};
+    Page *page = buffer_pool_manager_->fetch_page(page_id);
+    if (page == nullptr) {
+        throw InternalError("RmLsmRun::get: buffer pool is full");
+    }
+    const char *data = page->get_data();
+    int count = *reinterpret_cast<const int32_t *>(data);
+    const uint64_t *keys = page_keys(data);
+    int slot = static_cast<int>(std::lower_bound(keys, keys + count, key) - keys);
+    bool found = slot < count && keys[slot] == key;
+    if (found) {
+        *deleted = page_deleted(data)[slot];
+        if (!*deleted && record != nullptr) {
+            memcpy(record, page_records(data) + slot * hdr_.record_size, hdr_.record_size);
+        }
+    }
+    buffer_pool_manager_->unpin_page(page_id, false);
+    return found;
+}
+
+/* 按行号顺序遍历sorted run，pin住当前数据页并预读之后的数据页 */
+class RmLsmRun::Iterator : public RmLsmIterator {
+   public:
+    explicit Iterator(const RmLsmRun *run) : run_(run) {}
+
+    ~Iterator() override { release(); }
+
+    void seek(uint64_t key) override {
+        int idx = std::max(run_->find_data_page(key), 0);
+        load(idx);
+        if (data_ == nullptr) {
+            return;
+        }
+        const uint64_t *keys = page_keys(data_);
+        slot_ = static_cast<int>(std::lower_bound(keys, keys + count_, key) - keys);
+        if (slot_ == count_) {
+            load(idx + 1);
+        }
+    }
+
+    bool valid() const override { return data_ != nullptr; }
+
+    void next() override {
+        if (++slot_ == count_) {
+            load(page_idx_ + 1);
+        }
+    }
+
+    uint64_t key() const override { return page_keys(data_)[slot_]; }
+
+    const char *record() const override {
+        if (run_->page_deleted(data_)[slot_]) {
+            return nullptr;
+        }
+        return run_->page_records(data_) + slot_ * run_->hdr_.record_size;
+    }
+
+   private:
+    void load(int idx) {
+        if (idx == page_idx_ && data_ != nullptr) {
+            slot_ = 0;
+            return;
+        }
+        release();
+        if (idx >= run_->hdr_.num_data_pages) {
+            return;
+        }
+        if (idx >= prefetch_idx_) {
+            prefetch_idx_ = std::min(idx + READ_AHEAD_PAGES, run_->hdr_.num_data_pages);
+            run_->buffer_pool_manager_->prefetch_pages(run_->fd_, 1 + idx, prefetch_idx_ - idx);
+        }
+        page_idx_ = idx;
+        page_ = run_->buffer_pool_manager_->fetch_page(PageId{run_->fd_, 1 + idx}, AccessType::Scan);
+        if (page_ == nullptr) {
+            throw InternalError("RmLsmRun::Iterator: buffer pool is full");
+        }
+        data_ = page_->get_data();
+        count_ = *reinterpret_cast<const int32_t *>(data_);
+        slot_ = 0;
+    }
+
+    void release() {
+        if (page_ != nullptr) {
+            run_->buffer_pool_manager_->unpin_page(page_->get_page_id(), false);
+            page_ = nullptr;
+        }
+        data_ = nullptr;
+    }
+
+    const RmLsmRun *run_;
+    Page *page_ = nullptr;
+    const char *data_ = nullptr;    // 当前数据页，为nullptr表示遍历结束
+    int page_idx_ = -1;
+    int prefetch_idx_ = 0;          // 已经预读到的数据页
+    int count_ = 0;
+    int slot_ = 0;
+};
+
+std::unique_ptr<RmLsmIterator> RmLsmRun::new_iterator() const { return std::make_unique<Iterator>(this); }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/bloom_filter.h"
+#include "rm_lsm_memtable.h"
+#include "storage/buffer_pool_manager.h"
+#include "storage/disk_manager.h"
+
+/*
+sorted run是LSM表的memtable写出或几个sorted run合并得到的不可变文件，按行号升序保存每一行的记录或删除标记
+1. 第0页是文件头，之后依次是数据页、块索引页和bloom filter页
+2. 数据页保存连续的若干行：行数、行号数组、删除标记数组和定长的记录数组，页内按行号二分查找
+3. 块索引是每个数据页的第一个行号，按缓存行分块的bloom filter对文件中的全部行号建立，打开文件时读入内存；
+   点查先用行号范围和bloom filter排除不含该行的文件，再用块索引定位到唯一可能的数据页
+4. 数据页经过缓冲池读取，缓冲池就是sorted run的块缓存；文件写完后不再修改，页面从不为脏
+*/
+
+struct RmLsmRunHdr {
+    uint32_t magic;
+    int32_t record_size;
+    int32_t entries_per_page;       // 每个数据页最多保存的行数
+    int32_t num_data_pages;
+    int64_t num_entries;            // 行数，包括删除标记
+    int64_t num_deleted;            // 删除标记的个数
+    uint64_t min_key;
+    uint64_t max_key;
+    int32_t num_index_pages;
+    int32_t num_bloom_pages;
+    int64_t bloom_bytes;            // 分块bloom filter的字节数
+};
+
+/* 写一个新的sorted run，行必须按行号严格递增加入，finish()之后文件完整落盘 */
+class RmLsmRunWriter {
+   public:
+    RmLsmRunWriter(DiskManager *disk_manager, const std::string &path, int record_size, size_t expected_entries);
+
+    ~RmLsmRunWriter();
+
+    void add(uint64_t key, const char *record);
+
+    void finish();
+
+    int64_t num_entries() const { return hdr_.num_entries; }
+
+    static int entries_per_page(int record_size);
+
+   private:
+    void flush_data_page();
+
+    void write_page(page_id_t page_no);
+
+    DiskManager *disk_manager_;
+    int fd_;
+    RmLsmRunHdr hdr_{};
+    char *page_;                        // 正在填充的数据页，按页对齐以便O_DIRECT写入
+    int page_count_ = 0;                // page_中的行数
+    std::vector<uint64_t> first_keys_;  // 每个数据页的第一个行号
+    BloomFilter bloom_;
+    bool finished_ = false;
+};
+
+class RmLsmRun {
+   public:
+    RmLsmRun(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, const std::string &path);
+
+    ~RmLsmRun();
+
+    RmLsmRun(const RmLsmRun &) = delete;
+    RmLsmRun &operator=(const RmLsmRun &) = delete;
+
+    bool get(uint64_t key, char *record, bool *deleted) const;
+
+    std::unique_ptr<RmLsmIterator> new_iterator() const;
+
+    const std::string &path() const { return path_; }
+
+    int64_t num_entries() const { return hdr_.num_entries; }
+
+    int64_t num_deleted() const { return hdr_.num_deleted; }
+
+    int num_pages() const { return 1 + hdr_.num_data_pages + hdr_.num_index_pages + hdr_.num_bloom_pages; }
+
+    // 被合并或删除之后调用，最后一个引用释放时删除文件
+    void set_obsolete() { obsolete_ = true; }
+
+   private:
+    class Iterator;
+
+    bool may_contain(uint64_t key) const;
+
+    int find_data_page(uint64_t key) const;
+
+    // 数据页中各个部分的位置
+    static const uint64_t *page_keys(const char *data) { return reinterpret_cast<const uint64_t *>(data + 8); }
+    const uint8_t *page_deleted(const char *data) const {
+        return reinterpret_cast<const uint8_t *>(data + 8 + hdr_.entries_per_page * sizeof(uint64_t));
+    }
+    const char *page_records(const char *data) const {
+        return data + 8 + hdr_.entries_per_page * (sizeof(uint64_t) + 1);
+    }
+
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    std::string path_;
+    int fd_;
+    RmLsmRunHdr hdr_;
+    std::vector<uint64_t> first_keys_;
+    BloomFilter bloom_;
+    std::atomic<bool> obsolete_{false};
+};
@@ -0,0 +1,506 @@
+#include "rm_lsm_tree.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <optional>
+
+#include "common/metrics.h"
+
+namespace {
+
+constexpr uint32_t MANIFEST_MAGIC = 0x4d534c4d;    // "MLSM"
+
+struct ManifestHdr {
+    uint32_t magic;
+    int32_t num_runs;
+    uint64_t next_key;
+    uint64_t run_rows;
+    int32_t next_run_id;
+    int32_t num_obsolete;
+};
+
+struct Manifest {
+    ManifestHdr hdr{MANIFEST_MAGIC, 0, 0, 0, 0, 0};
+    std::vector<int32_t> run_ids;       // 从新到旧
+    std::vector<int32_t> obsolete_ids;  // 已经被合并或正在写、重启时需要删除的sorted run
+};
+
+Manifest read_manifest(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Manifest manifest;
+    if (data.size() < sizeof(ManifestHdr)) {
+        throw InternalError("RmLsmTree: bad manifest " + path);
+    }
+    memcpy(&manifest.hdr, data.data(), sizeof(ManifestHdr));
+    size_t ids = manifest.hdr.num_runs + manifest.hdr.num_obsolete;
+    if (manifest.hdr.magic != MANIFEST_MAGIC || data.size() != sizeof(ManifestHdr) + ids * sizeof(int32_t)) {
+        throw InternalError("RmLsmTree: bad manifest " + path);
+    }
+    const int32_t *p = reinterpret_cast<const int32_t *>(data.data() + sizeof(ManifestHdr));
+    manifest.run_ids.assign(p, p + manifest.hdr.num_runs);
+    manifest.obsolete_ids.assign(p + manifest.hdr.num_runs, p + ids);
+    return manifest;
+}
+
+std::string encode_manifest(const Manifest &manifest) {
+    std::string data(reinterpret_cast<const char *>(&manifest.hdr), sizeof(ManifestHdr));
+    data.append(reinterpret_cast<const char *>(manifest.run_ids.data()), manifest.run_ids.size() * sizeof(int32_t));
+    data.append(reinterpret_cast<const char *>(manifest.obsolete_ids.data()),
+                manifest.obsolete_ids.size() * sizeof(int32_t));
+    return data;
+}
+
+// 上次写入manifest之后才开始写的sorted run使用manifest中之后的编号：
+// 同一时刻最多有一个memtable写出和一个合并在进行，最多占用两个编号
+constexpr int MAX_WRITING_RUNS = 2;
+
+}  // namespace
+
+/*
+MergeIterator把从新到旧的若干个数据源归并为按行号递增的一个序列：
+同一行号在多个数据源中出现时取最新的版本，最新的版本是删除标记时跳过该行
+*/
+class RmLsmTree::MergeIterator : public RmLsmIterator {
+   public:
+    explicit MergeIterator(Version version) : version_(std::move(version)) {
+        for (auto *mem : {&version_.mem, &version_.imm}) {
+            if (*mem != nullptr) {
+                children_.push_back(std::make_unique<RmLsmMemTable::Iterator>(*mem));
+            }
+        }
+        for (auto &run : version_.runs) {
+            children_.push_back(run->new_iterator());
+        }
+    }
+
+    void seek(uint64_t key) override {
+        for (auto &child : children_) {
+            child->seek(key);
+        }
+        settle();
+    }
+
+    bool valid() const override { return current_ != nullptr; }
+
+    void next() override {
+        skip(current_->key());
+        settle();
+    }
+
+    uint64_t key() const override { return current_->key(); }
+
+    const char *record() const override { return current_->record(); }
+
+   private:
+    // 所有数据源越过行号key
+    void skip(uint64_t key) {
+        for (auto &child : children_) {
+            if (child->valid() && child->key() == key) {
+                child->next();
+            }
+        }
+    }
+
+    // 定位到行号最小的行中最新的版本，跳过删除标记
+    void settle() {
+        while (true) {
+            current_ = nullptr;
+            for (auto &child : children_) {
+                if (child->valid() && (current_ == nullptr || child->key() < current_->key())) {
+                    current_ = child.get();
+                }
+            }
+            if (current_ == nullptr || current_->record() != nullptr) {
+                return;
+            }
+            skip(current_->key());
+        }
+    }
+
+    Version version_;
+    std::vector<std::unique_ptr<RmLsmIterator>> children_;     // 从新到旧
+    RmLsmIterator *current_ = nullptr;
+};
+
+/**
+ * @description: 打开LSM表：读取manifest，打开其中的sorted run，删除上次没有删完的文件，启动后台线程
+ * @param {DiskManager*} disk_manager
+ * @param {BufferPoolManager*} buffer_pool_manager 读取sorted run的缓冲池
+ * @param {string&} name 表的数据文件名，LSM表的其他文件以它为前缀
+ * @param {int} record_size 记录长度
+ * @param {function<void()>} log_flush_hook 写出sorted run之前调用，把日志刷盘
+ */
+RmLsmTree::RmLsmTree(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, const std::string &name,
+                     int record_size, std::function<void()> log_flush_hook)
+    : disk_manager_(disk_manager),
+      buffer_pool_manager_(buffer_pool_manager),
+      name_(name),
+      record_size_(record_size),
+      log_flush_hook_(std::move(log_flush_hook)) {
+    Manifest manifest = read_manifest(manifest_name(name));
+    next_key_ = manifest.hdr.next_key;
+    next_run_id_ = manifest.hdr.next_run_id;
+    run_rows_ = manifest.hdr.run_rows;
+    num_rows_ = run_rows_;
+    std::vector<int32_t> stale = manifest.obsolete_ids;
+    for (int i = 0; i < MAX_WRITING_RUNS; i++) {
+        stale.push_back(manifest.hdr.next_run_id + i);
+    }
+    for (int id : stale) {
+        if (disk_manager_->is_file(run_name(id))) {
+            disk_manager_->destroy_file(run_name(id));
+        }
+    }
+    for (int id : manifest.run_ids) {
+        runs_.push_back(Run{id, std::make_shared<RmLsmRun>(disk_manager_, buffer_pool_manager_, run_name(id))});
+    }
+    mem_ = std::make_shared<RmLsmMemTable>(record_size_);
+    worker_ = std::thread(&RmLsmTree::background_work, this);
+}
+
+/**
+ * @description: 停止后台线程，丢弃memtable。正常关闭先调用close()，不调用时相当于崩溃，memtable中的修改由日志恢复
+ */
+RmLsmTree::~RmLsmTree() {
+    {
+        std::scoped_lock lock{latch_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+/**
+ * @description: 创建空的LSM表
+ * @param {DiskManager*} disk_manager
+ * @param {string&} name 表的数据文件名
+ */
+void RmLsmTree::create(DiskManager *disk_manager, const std::string &name) {
+    disk_manager->replace_file(manifest_name(name), encode_manifest(Manifest{}));
+}
+
+/**
+ * @description: 删除LSM表的manifest和全部sorted run，表必须已经关闭
+ * @param {DiskManager*} disk_manager
+ * @param {string&} name 表的数据文件名
+ */
+void RmLsmTree::destroy(DiskManager *disk_manager, const std::string &name) {
+    std::string path = manifest_name(name);
+    if (!disk_manager->is_file(path)) {
+        return;
+    }
+    Manifest manifest = read_manifest(path);
+    std::vector<int32_t> ids = manifest.run_ids;
+    ids.insert(ids.end(), manifest.obsolete_ids.begin(), manifest.obsolete_ids.end());
+    for (int i = 0; i < MAX_WRITING_RUNS; i++) {
+        ids.push_back(manifest.hdr.next_run_id + i);
+    }
+    for (int id : ids) {
+        std::string run = name + ".run." + std::to_string(id);
+        if (disk_manager->is_file(run)) {
+            disk_manager->destroy_file(run);
+        }
+    }
+    disk_manager->destroy_file(path);
+}
+
+RmLsmTree::Version RmLsmTree::current() const {
+    std::scoped_lock lock{latch_};
+    Version version{mem_, imm_, {}};
+    for (auto &run : runs_) {
+        version.runs.push_back(run.file);
+    }
+    return version;
+}
+
+// 按从新到旧的顺序查找一行，record不为nullptr时复制找到的记录
+bool RmLsmTree::lookup(const Version &version, uint64_t key, char *record) const {
+    for (auto *mem : {version.mem.get(), version.imm.get()}) {
+        const char *data;
+        if (mem != nullptr && mem->get(key, &data)) {
+            if (data != nullptr && record != nullptr) {
+                memcpy(record, data, record_size_);
+            }
+            return data != nullptr;
+        }
+    }
+    for (auto &run : version.runs) {
+        bool deleted;
+        if (run->get(key, record, &deleted)) {
+            return !deleted;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 插入一行，分配下一个行号
+ * @return {uint64_t} 新行的行号
+ * @param {char*} record 记录
+ */
+uint64_t RmLsmTree::insert(const char *record) {
+    std::unique_lock<std::mutex> lock{write_latch_};
+    uint64_t key = next_key_.load(std::memory_order_relaxed);
+    if (mem_->memory_usage() >= LSM_MEMTABLE_SIZE) {
+        freeze(lock);
+    }
+    mem_->put(key, record);
+    next_key_.store(key + 1, std::memory_order_relaxed);
+    num_rows_.fetch_add(1, std::memory_order_relaxed);
+    return key;
+}
+
+/**
+ * @description: 写入指定行号的一行，用于更新、删除和恢复。行号不小于end_key()时推进end_key()
+ * @param {uint64_t} key 行号
+ * @param {char*} record 记录，为nullptr时删除该行
+ */
+void RmLsmTree::put(uint64_t key, const char *record) {
+    std::unique_lock<std::mutex> lock{write_latch_};
+    bool existed = key < next_key_.load(std::memory_order_relaxed) && lookup(current(), key, nullptr);
+    if (mem_->memory_usage() >= LSM_MEMTABLE_SIZE) {
+        freeze(lock);
+    }
+    mem_->put(key, record);
+    if (key >= next_key_.load(std::memory_order_relaxed)) {
+        next_key_.store(key + 1, std::memory_order_relaxed);
+    }
+    if (existed && record == nullptr) {
+        num_rows_.fetch_sub(1, std::memory_order_relaxed);
+    } else if (!existed && record != nullptr) {
+        num_rows_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @description: 读取一行
+ * @return {bool} 该行是否存在
+ * @param {uint64_t} key 行号
+ * @param {char*} record 该行存在时复制到这里
+ */
+bool RmLsmTree::get(uint64_t key, char *record) const { return lookup(current(), key, record); }
+
+bool RmLsmTree::contains(uint64_t key) const { return lookup(current(), key, nullptr); }
+
+/**
+ * @description: 在当前数据源的快照上创建按行号递增遍历全部行的迭代器，需要先调用seek()
+ */
+std::unique_ptr<RmLsmIterator> RmLsmTree::new_iterator() const { return std::make_unique<MergeIterator>(current()); }
+
+/**
+ * @description: 记录修改了memtable的日志，在写入memtable之后调用
+ * @param {lsn_t} lsn 日志的lsn
+ */
+void RmLsmTree::note_lsn(lsn_t lsn) {
+    std::scoped_lock lock{latch_};
+    mem_->note_lsn(lsn);
+}
+
+/**
+ * @description: memtable中最早的修改的lsn，之前的日志不再需要用于恢复本表
+ * @return {lsn_t} 没有记录了日志的修改时返回INVALID_LSN
+ */
+lsn_t RmLsmTree::rec_lsn() const {
+    std::scoped_lock lock{latch_};
+    lsn_t rec_lsn = INVALID_LSN;
+    for (auto *mem : {mem_.get(), imm_.get()}) {
+        if (mem != nullptr && mem->first_lsn() != INVALID_LSN &&
+            (rec_lsn == INVALID_LSN || mem->first_lsn() < rec_lsn)) {
+            rec_lsn = mem->first_lsn();
+        }
+    }
+    return rec_lsn;
+}
+
+// 冻结memtable交给后台线程写出，上一个immutable memtable还没有写完时等待。调用者持有write_latch_
+void RmLsmTree::freeze(std::unique_lock<std::mutex> &write_lock) {
+    assert(write_lock.owns_lock());
+    std::unique_lock<std::mutex> lock{latch_};
+    cv_.wait(lock, [&] { return imm_ == nullptr; });
+    imm_ = std::move(mem_);
+    mem_ = std::make_shared<RmLsmMemTable>(record_size_);
+    cv_.notify_all();
+}
+
+/**
+ * @description: 把memtable写成sorted run，返回时memtable中的修改都已经在sorted run中
+ */
+void RmLsmTree::flush() {
+    {
+        std::unique_lock<std::mutex> lock{write_latch_};
+        if (!mem_->empty()) {
+            freeze(lock);
+        }
+    }
+    std::unique_lock<std::mutex> lock{latch_};
+    cv_.wait(lock, [&] { return imm_ == nullptr; });
+}
+
+/**
+ * @description: 把全部sorted run合并为一个并丢弃删除标记，用于VACUUM
+ * @return {size_t} 释放的页面数
+ */
+size_t RmLsmTree::compact() { return compact_runs(true); }
+
+/**
+ * @description: 关闭LSM表：memtable写成sorted run后停止后台线程，关闭全部sorted run
+ */
+void RmLsmTree::close() {
+    flush();
+    {
+        std::scoped_lock lock{latch_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    std::scoped_lock lock{latch_};
+    runs_.clear();
+}
+
+// 分配一个sorted run的编号，写完安装之前它记录在manifest的待删除列表中，崩溃后重启时删除
+int RmLsmTree::allocate_run_id() {
+    std::scoped_lock lock{manifest_latch_};
+    int id = next_run_id_++;
+    writing_.push_back(id);
+    return id;
+}
+
+// 写入manifest，调用者持有manifest_latch_
+void RmLsmTree::write_manifest(const std::vector<Run> &runs, std::vector<int> obsolete) {
+    obsolete.insert(obsolete.end(), writing_.begin(), writing_.end());
+    Manifest manifest;
+    manifest.hdr.num_runs = static_cast<int32_t>(runs.size());
+    manifest.hdr.next_key = next_key_.load(std::memory_order_relaxed);
+    manifest.hdr.run_rows = run_rows_;
+    manifest.hdr.next_run_id = next_run_id_.load(std::memory_order_relaxed);
+    manifest.hdr.num_obsolete = static_cast<int32_t>(obsolete.size());
+    for (auto &run : runs) {
+        manifest.run_ids.push_back(run.id);
+    }
+    manifest.obsolete_ids.assign(obsolete.begin(), obsolete.end());
+    disk_manager_->replace_file(manifest_name(name_), encode_manifest(manifest));
+}
+
+// 后台线程：写出immutable memtable，sorted run过多时合并
+void RmLsmTree::background_work() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock{latch_};
+            cv_.wait(lock, [&] { return stop_ || imm_ != nullptr; });
+            if (imm_ == nullptr) {
+                return;
+            }
+        }
+        flush_imm();
+        if (std::scoped_lock lock{latch_}; runs_.size() <= LSM_MAX_RUNS) {
+            continue;
+        }
+        compact_runs(false);
+    }
+}
+
+// 把immutable memtable写成sorted run并加入manifest
+void RmLsmTree::flush_imm() {
+    Version version = current();
+    auto &imm = version.imm;
+    if (log_flush_hook_) {
+        log_flush_hook_();
+    }
+    int id = allocate_run_id();
+    RmLsmRunWriter writer(disk_manager_, run_name(id), record_size_, imm->size());
+    // sorted run中的行数按这些行写出前后的状态变化调整
+    int64_t delta = 0;
+    Version runs_only{nullptr, nullptr, version.runs};
+    RmLsmMemTable::Iterator it(imm);
+    for (it.seek(0); it.valid(); it.next()) {
+        writer.add(it.key(), it.record());
+        delta += (it.record() != nullptr) - lookup(runs_only, it.key(), nullptr);
+    }
+    writer.finish();
+    Run run{id, std::make_shared<RmLsmRun>(disk_manager_, buffer_pool_manager_, run_name(id))};
+    {
+        std::scoped_lock manifest_lock{manifest_latch_};
+        std::vector<Run> runs{run};
+        {
+            std::scoped_lock lock{latch_};
+            runs.insert(runs.end(), runs_.begin(), runs_.end());
+        }
+        run_rows_ += delta;
+        writing_.erase(std::find(writing_.begin(), writing_.end(), id));
+        write_manifest(runs, {});
+        std::scoped_lock lock{latch_};
+        runs_ = std::move(runs);
+        imm_ = nullptr;
+    }
+    cv_.notify_all();
+    EngineMetrics::get().lsm_memtable_flushes.add();
+}
+
+// 合并当前全部sorted run，合并期间新写出的sorted run排在合并结果之前。force为false时只有一个sorted run则不合并
+size_t RmLsmTree::compact_runs(bool force) {
+    std::scoped_lock compact_lock{compact_latch_};
+    std::vector<Run> olds;
+    {
+        std::scoped_lock lock{latch_};
+        olds = runs_;
+    }
+    if (olds.empty() || (olds.size() == 1 && (!force || olds[0].file->num_deleted() == 0))) {
+        return 0;
+    }
+    Version version;
+    size_t old_pages = 0;
+    int64_t expected = 0;
+    for (auto &run : olds) {
+        version.runs.push_back(run.file);
+        old_pages += run.file->num_pages();
+        expected += run.file->num_entries() - run.file->num_deleted();
+    }
+    int id = allocate_run_id();
+    std::optional<Run> merged;
+    {
+        RmLsmRunWriter writer(disk_manager_, run_name(id), record_size_, std::max<int64_t>(expected, 0));
+        MergeIterator it(std::move(version));
+        for (it.seek(0); it.valid(); it.next()) {
+            writer.add(it.key(), it.record());
+        }
+        writer.finish();
+        if (writer.num_entries() > 0) {
+            merged = Run{id, std::make_shared<RmLsmRun>(disk_manager_, buffer_pool_manager_, run_name(id))};
+        }
+    }
+    if (!merged.has_value()) {
+        disk_manager_->destroy_file(run_name(id));
+    }
+    std::vector<int> obsolete;
+    for (auto &run : olds) {
+        obsolete.push_back(run.id);
+    }
+    {
+        std::scoped_lock manifest_lock{manifest_latch_};
+        std::vector<Run> runs;
+        {
+            std::scoped_lock lock{latch_};
+            runs.assign(runs_.begin(), runs_.end() - olds.size());
+        }
+        if (merged.has_value()) {
+            runs.push_back(*merged);
+        }
+        writing_.erase(std::find(writing_.begin(), writing_.end(), id));
+        write_manifest(runs, obsolete);
+        std::scoped_lock lock{latch_};
+        runs_ = std::move(runs);
+    }
+    // 还在被遍历的sorted run在最后一个迭代器释放后删除
+    for (auto &run : olds) {
+        run.file->set_obsolete();
+    }
+    EngineMetrics::get().lsm_compactions.add();
+    size_t new_pages = merged.has_value() ? merged->file->num_pages() : 0;
+    return old_pages > new_pages ? old_pages - new_pages : 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rm_lsm_memtable.h"
+#include "rm_lsm_run.h"
+
+/*
+RmLsmTree是LSM表的存储引擎，表中的每一行由插入时分配的递增行号标识：
+1. 写入进入可变的memtable，memtable写满LSM_MEMTABLE_SIZE后冻结为只读的immutable memtable，
+   由后台线程写成一个新的sorted run，写入者只在上一个immutable memtable还没有写完时等待
+2. sorted run按从新到旧排列，超过LSM_MAX_RUNS个时后台线程把它们合并为一个，同时丢弃删除标记
+3. 读取按memtable、immutable memtable、sorted run从新到旧的顺序查找，第一个找到的版本就是该行的当前状态；
+   遍历在这些数据源的一个快照上做多路归并
+4. manifest文件(表名.lsm)记录当前的sorted run和下一个行号，以先写临时文件再替换的方式原子地更新。
+   sorted run写完并落盘后才加入manifest，被合并的sorted run在manifest更新之后删除
+5. memtable中的修改只在WAL中，写成sorted run之前先把日志刷盘；memtable中最早的修改的lsn作为
+   检查点的recLSN，崩溃恢复时重做之后的日志重建memtable
+*/
+class RmLsmTree {
+   public:
+    RmLsmTree(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, const std::string &name,
+              int record_size, std::function<void()> log_flush_hook);
+
+    ~RmLsmTree();
+
+    RmLsmTree(const RmLsmTree &) = delete;
+    RmLsmTree &operator=(const RmLsmTree &) = delete;
+
+    static void create(DiskManager *disk_manager, const std::string &name);
+
+    static void destroy(DiskManager *disk_manager, const std::string &name);
+
+    static std::string manifest_name(const std::string &name) { return name + ".lsm"; }
+
+    uint64_t insert(const char *record);
+
+    void put(uint64_t key, const char *record);
+
+    bool get(uint64_t key, char *record) const;
+
+    bool contains(uint64_t key) const;
+
+    std::unique_ptr<RmLsmIterator> new_iterator() const;
+
+    // 表中的行数，不包括删除标记
+    size_t count() const { return num_rows_.load(std::memory_order_relaxed); }
+
+    // 已经分配的行号都小于end_key()
+    uint64_t end_key() const { return next_key_.load(std::memory_order_relaxed); }
+
+    void note_lsn(lsn_t lsn);
+
+    lsn_t rec_lsn() const;
+
+    void flush();
+
+    size_t compact();
+
+    void close();
+
+   private:
+    struct Run {
+        int id;
+        std::shared_ptr<RmLsmRun> file;
+    };
+
+    // 读取使用的数据源快照，从新到旧
+    struct Version {
+        std::shared_ptr<RmLsmMemTable> mem;
+        std::shared_ptr<RmLsmMemTable> imm;
+        std::vector<std::shared_ptr<RmLsmRun>> runs;
+    };
+
+    class MergeIterator;
+
+    std::string run_name(int id) const { return name_ + ".run." + std::to_string(id); }
+
+    Version current() const;
+
+    bool lookup(const Version &version, uint64_t key, char *record) const;
+
+    void freeze(std::unique_lock<std::mutex> &lock);
+
+    int allocate_run_id();
+
+    void write_manifest(const std::vector<Run> &runs, std::vector<int> obsolete);
+
+    void background_work();
+
+    void flush_imm();
+
+    size_t compact_runs(bool force);
+
+    DiskManager *disk_manager_;
+    BufferPoolManager *buffer_pool_manager_;
+    std::string name_;
+    int record_size_;
+    std::function<void()> log_flush_hook_;      // 写出sorted run之前把日志刷盘
+
+    std::mutex write_latch_;                    // 串行化写入和冻结memtable
+    mutable std::mutex latch_;                  // 保护mem_、imm_、runs_和stop_
+    std::condition_variable cv_;
+    std::shared_ptr<RmLsmMemTable> mem_;
+    std::shared_ptr<RmLsmMemTable> imm_;        // 等待写成sorted run的memtable，为nullptr表示没有
+    std::vector<Run> runs_;                     // 从新到旧
+    bool stop_ = false;
+
+    std::mutex manifest_latch_;                 // 串行化sorted run的安装和manifest的写入
+    std::mutex compact_latch_;                  // 同一时刻只有一个合并
+    std::atomic<uint64_t> next_key_{0};
+    std::atomic<int> next_run_id_{0};
+    std::atomic<size_t> num_rows_{0};
+    size_t run_rows_ = 0;                       // sorted run中的行数，由manifest_latch_保护，记录在manifest中
+    std::vector<int> writing_;                  // 正在写的sorted run的编号，由manifest_latch_保护
+    std::thread worker_;
+};
@@ -2,29 +2,81 @@
 
 #include <assert.h>
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 #include "bitmap.h"
 #include "rm_defs.h"
 #include "rm_file_handle.h"
+#include "rm_pax_codec.h"
 
 /* 记录管理器，用于管理表的数据文件，进行文件的创建、打开、删除、关闭 */
 class RmManager {
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
+    std::function<void()> log_flush_hook_;     // LSM表写出sorted run之前调用，把日志刷盘
 
    public:
     RmManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
         : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager) {}
 
+    /**
+     * @description: 设置之后打开的LSM表把memtable写成sorted run之前调用的函数，需在open_file之前调用
+     * @param {function<void()>} hook 把日志刷盘的函数，没有日志时为空
+     */
+    void set_log_flush_hook(std::function<void()> hook) { log_flush_hook_ = std::move(hook); }
+
     /**
      * @description: 创建表的数据文件并初始化相关信息
      * @param {string&} filename 要创建的文件名称
      * @param {int} record_size 表中记录的大小
+     * @param {vector<RmVarField>&} var_fields 变长字段，不为空时页面使用slotted page格式。
+     *        超过RM_MAX_VAR_FIELDS个时多出的字段按定长存储，记录的内容不受影响
+     * @param {vector<RmMinipage>&} minipages 不为空时页面使用PAX格式，每个minipage存放记录中的一段字段，
+     *        需要按偏移量递增、首尾相接地覆盖整条记录。超过RM_MAX_MINIPAGES个时多出的部分并入最后一个minipage。
+     *        PAX格式中变长字段也按定长存储，var_fields被忽略。
+     *        minipage的encoding不为RM_ENCODING_NONE时页面被淘汰后压缩保存，RM_ENCODING_FOR只能用于4字节的minipage
+     * @param {vector<RmZoneColumn>&} zone_columns 在zone map中记录每个页面的最小值和最大值的字段，
+     *        只能是4字节的INT或FLOAT字段，超过RM_MAX_ZONE_COLUMNS个时多出的字段不记录
      */ 
-    void create_file(const std::string& filename, int record_size) {
+    void create_file(const std::string& filename, int record_size, std::vector<RmVarField> var_fields = {},
+                     const std::vector<RmMinipage>& minipages = {},
+                     const std::vector<RmZoneColumn>& zone_columns = {}) {
         if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
             throw InvalidRecordSizeError(record_size);
         }
+        int covered = 0;
+        for (auto &mp : minipages) {
+            if (mp.len == 0 || mp.offset != covered) {
+                throw InternalError("RmManager::create_file: minipages do not cover the record");
+            }
+            if (mp.encoding > RM_ENCODING_DICT || (mp.encoding == RM_ENCODING_FOR && mp.len != sizeof(int32_t))) {
+                throw InternalError("RmManager::create_file: invalid minipage encoding");
+            }
+            covered += mp.len;
+        }
+        if (!minipages.empty() && covered != record_size) {
+            throw InternalError("RmManager::create_file: minipages do not cover the record");
+        }
+        for (auto &col : zone_columns) {
+            if ((col.type != TYPE_INT && col.type != TYPE_FLOAT) || col.offset < 0 ||
+                col.offset + static_cast<int>(sizeof(int32_t)) > record_size) {
+                throw InternalError("RmManager::create_file: invalid zone map column");
+            }
+        }
+        if (!minipages.empty()) {
+            var_fields.clear();
+        }
+        std::sort(var_fields.begin(), var_fields.end(),
+                  [](const RmVarField &a, const RmVarField &b) { return a.offset < b.offset; });
+        for (size_t i = 0; i < var_fields.size(); i++) {
+            int end = i + 1 < var_fields.size() ? var_fields[i + 1].offset : record_size;
+            if (var_fields[i].len == 0 || var_fields[i].offset + var_fields[i].len > end) {
+                throw InternalError("RmManager::create_file: invalid variable-length field");
+            }
+        }
         disk_manager_->create_file(filename);
         int fd = disk_manager_->open_file(filename);
 
@@ -33,42 +85,140 @@ class RmManager {
         file_hdr.record_size = record_size;
         file_hdr.num_pages = 1;
         file_hdr.first_free_page_no = RM_NO_PAGE;
-        // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
-        file_hdr.num_records_per_page =
-            (BITMAP_WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmFileHdr)) + 1) / (1 + record_size * BITMAP_WIDTH);
-        file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        file_hdr.num_var_fields = std::min(static_cast<int>(var_fields.size()), RM_MAX_VAR_FIELDS);
+        file_hdr.num_minipages = std::min(static_cast<int>(minipages.size()), RM_MAX_MINIPAGES);
+        for (int i = 0; i < file_hdr.num_minipages; i++) {
+            file_hdr.minipages[i] = minipages[i];
+        }
+        if (file_hdr.num_minipages < static_cast<int>(minipages.size())) {
+            RmMinipage &last = file_hdr.minipages[file_hdr.num_minipages - 1];
+            last.len = static_cast<uint16_t>(record_size - last.offset);
+            if (last.encoding == RM_ENCODING_FOR) {
+                last.encoding = RM_ENCODING_NONE;
+            }
+        }
+        if (file_hdr.is_slotted()) {
+            // 每条元组至少有定长部分和各变长字段的长度，slot目录最多有这么多项
+            int min_tuple_size = record_size;
+            for (int i = 0; i < file_hdr.num_var_fields; i++) {
+                file_hdr.var_fields[i] = var_fields[i];
+                min_tuple_size += static_cast<int>(sizeof(uint16_t)) - var_fields[i].len;
+            }
+            file_hdr.max_tuple_size = record_size + file_hdr.num_var_fields * static_cast<int>(sizeof(uint16_t));
+            file_hdr.num_records_per_page =
+                (PAGE_SIZE - RM_SLOT_DIR_OFFSET) / (static_cast<int>(sizeof(RmSlot)) + min_tuple_size);
+            file_hdr.bitmap_size = 0;
+        } else {
+            // PAX格式的minipage合起来与按行存储的slots大小相同，页面能存放的记录数也相同
+            // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
+            int page_hdr_size = static_cast<int>(Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr));
+            file_hdr.max_tuple_size = record_size;
+            file_hdr.num_records_per_page =
+                (BITMAP_WIDTH * (PAGE_SIZE - 1 - page_hdr_size) + 1) / (1 + record_size * BITMAP_WIDTH);
+            file_hdr.bitmap_size = (file_hdr.num_records_per_page + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+        }
 
-        // 将file header写入磁盘文件（名为file name，文件描述符为fd）中的第0页
+        // 将file header写入磁盘文件（名为file name，文件描述符为fd）中的第0页，其后的free space map初始为空
         // head page直接写入磁盘，没有经过缓冲区的NewPage，那么也就不需要FlushPage
-        disk_manager_->write_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr, sizeof(file_hdr));
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        memcpy(page_buf, &file_hdr, sizeof(file_hdr));
+        disk_manager_->write_page(fd, RM_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
+        disk_manager_->close_file(fd);
+        RmZoneMap::create(RmZoneMap::file_name(filename), zone_columns);
+    }
+
+    /**
+     * @description: 创建LSM表的数据文件和manifest。记录不分页面存放，变长字段按定长存储，不建立zone map
+     * @param {string&} filename 要创建的文件名称
+     * @param {int} record_size 表中记录的大小
+     */
+    void create_lsm_file(const std::string& filename, int record_size) {
+        if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
+            throw InvalidRecordSizeError(record_size);
+        }
+        disk_manager_->create_file(filename);
+        int fd = disk_manager_->open_file(filename);
+        // 虚拟页面的行数与定长格式的页面相同，按页数估计的代价与堆表一致
+        RmFileHdr file_hdr{};
+        file_hdr.record_size = record_size;
+        file_hdr.max_tuple_size = record_size;
+        file_hdr.num_pages = 1;
+        file_hdr.first_free_page_no = RM_NO_PAGE;
+        file_hdr.storage = RM_STORAGE_LSM;
+        int page_hdr_size = static_cast<int>(Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr));
+        file_hdr.num_records_per_page =
+            (BITMAP_WIDTH * (PAGE_SIZE - 1 - page_hdr_size) + 1) / (1 + record_size * BITMAP_WIDTH);
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        memcpy(page_buf, &file_hdr, sizeof(file_hdr));
+        disk_manager_->write_page(fd, RM_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
         disk_manager_->close_file(fd);
+        RmLsmTree::create(disk_manager_, filename);
     }
 
     /**
      * @description: 删除表的数据文件
      * @param {string&} filename 要删除的文件名称
      */    
-    void destroy_file(const std::string& filename) { disk_manager_->destroy_file(filename); }
+    void destroy_file(const std::string& filename) {
+        RmLsmTree::destroy(disk_manager_, filename);
+        disk_manager_->destroy_file(filename);
+        std::string zone_file = RmZoneMap::file_name(filename);
+        if (disk_manager_->is_file(zone_file)) {
+            disk_manager_->destroy_file(zone_file);
+        }
+    }
 
     // 注意这里打开文件，创建并返回了record file handle的指针
     /**
      * @description: 打开表的数据文件，并返回文件句柄
      * @param {string&} filename 要打开的文件名称
+     * @param {bool} read_only 只读打开，堆表的数据文件整个映射到内存，页面直接从映射中读取，不进入缓冲池；
+     *        压缩的PAX表和LSM表仍然经过缓冲池
      * @return {unique_ptr<RmFileHandle>} 文件句柄的指针
      */
-    std::unique_ptr<RmFileHandle> open_file(const std::string& filename) {
+    std::unique_ptr<RmFileHandle> open_file(const std::string& filename, bool read_only = false) {
         int fd = disk_manager_->open_file(filename);
-        return std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        auto file_handle = std::make_unique<RmFileHandle>(disk_manager_, buffer_pool_manager_, fd);
+        if (file_handle->file_hdr_.is_lsm()) {
+            file_handle->lsm_ = std::make_unique<RmLsmTree>(disk_manager_, buffer_pool_manager_, filename,
+                                                            file_handle->file_hdr_.record_size, log_flush_hook_);
+            file_handle->lsm_update_num_pages();
+        }
+        file_handle->zone_map_.load(RmZoneMap::file_name(filename), file_handle->file_hdr_.num_pages);
+        // 压缩的PAX文件注册编解码器，被淘汰的页面编码后保存在压缩页缓存中
+        if (file_handle->file_hdr_.is_compressed()) {
+            buffer_pool_manager_->set_page_codec(fd, std::make_shared<RmPaxCodec>(file_handle->file_hdr_));
+        } else if (read_only && !file_handle->file_hdr_.is_lsm()) {
+            buffer_pool_manager_->map_file(fd, MappedFile::Advice::SEQUENTIAL);
+        }
+        return file_handle;
     }
     /**
      * @description: 关闭表的数据文件
      * @param {RmFileHandle*} file_handle 要关闭文件的句柄
      */
     void close_file(const RmFileHandle* file_handle) {
-        disk_manager_->write_page(file_handle->fd_, RM_FILE_HDR_PAGE, (char *)&file_handle->file_hdr_,
-                                  sizeof(file_handle->file_hdr_));
+        // 只读映射的文件没有被修改过，不需要写回
+        if (buffer_pool_manager_->is_mapped(file_handle->fd_)) {
+            buffer_pool_manager_->unmap_file(file_handle->fd_);
+            disk_manager_->close_file(file_handle->fd_);
+            return;
+        }
+        // LSM表的memtable写成sorted run，之后不再需要日志恢复
+        if (file_handle->lsm_ != nullptr) {
+            file_handle->lsm_->close();
+        }
+        char page_buf[PAGE_SIZE];
+        memset(page_buf, 0, PAGE_SIZE);
+        memcpy(page_buf, &file_handle->file_hdr_, sizeof(file_handle->file_hdr_));
+        file_handle->fsm_.serialize(page_buf + sizeof(file_handle->file_hdr_));
+        disk_manager_->write_page(file_handle->fd_, RM_FILE_HDR_PAGE, page_buf, PAGE_SIZE);
         // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
         buffer_pool_manager_->flush_all_pages(file_handle->fd_);
+        buffer_pool_manager_->set_page_codec(file_handle->fd_, nullptr);
+        file_handle->zone_map_.save(RmZoneMap::file_name(disk_manager_->get_file_name(file_handle->fd_)));
         disk_manager_->close_file(file_handle->fd_);
     }
 };
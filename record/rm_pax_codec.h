@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitmap.h"
+#include "rm_defs.h"
+#include "storage/page_codec.h"
+
+/*
+PAX页面的轻量压缩：页面被缓冲池淘汰时由RmPaxCodec编码后保存在压缩页缓存中，缓存中的页面比帧小得多，
+同样大小的内存可以容纳更多的冷页面；再次访问时才解码，按页面扫描时还可以直接在编码后的数据上过滤(见PaxBatchScan)
+1. 编码结果依次为：页面开头到bitmap末尾的原样拷贝(LSN、RmPageHdr和bitmap)，每个minipage一段，最后是页尾的非零字节
+2. 每个minipage一段，以一个字节的实际编码方式开头，编码方式由建表时的RmMinipage::encoding决定，
+   编码后没有变小时退回原样保存：
+   - RM_ENCODING_NONE：num_records_per_page * len字节的原样拷贝
+   - RM_ENCODING_FOR：int32的base和一个字节的位宽，之后是每个slot的值与base的差，按位宽紧密排列
+   - RM_ENCODING_DICT：uint16的字典大小和一个字节的位宽，之后是字典中的各个值，再之后是每个slot的值在字典中的编号
+3. 只有bitmap中有效的slot参与编码，空闲slot中残留的旧数据被丢弃，解码后为0
+*/
+
+// 按位紧密排列的编号：第i个编号占[i * width, (i + 1) * width)位，低位在前，可以跨越64位字的边界
+class RmBitPacking {
+   public:
+    static size_t packed_size(size_t n, int width) { return (n * width + 63) / 64 * sizeof(uint64_t); }
+
+    static void pack(const std::vector<uint32_t> &codes, int width, std::string *out) {
+        std::vector<uint64_t> words((codes.size() * width + 63) / 64, 0);
+        for (size_t i = 0; width > 0 && i < codes.size(); i++) {
+            size_t bit = i * width;
+            int shift = static_cast<int>(bit % 64);
+            words[bit / 64] |= static_cast<uint64_t>(codes[i]) << shift;
+            if (shift + width > 64) {
+                words[bit / 64 + 1] |= static_cast<uint64_t>(codes[i]) >> (64 - shift);
+            }
+        }
+        out->append(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+    }
+
+    static uint32_t unpack(const char *packed, int width, size_t i) {
+        if (width == 0) {
+            return 0;
+        }
+        size_t bit = i * width;
+        int shift = static_cast<int>(bit % 64);
+        uint64_t word;
+        memcpy(&word, packed + bit / 64 * sizeof(uint64_t), sizeof(word));
+        uint64_t value = word >> shift;
+        if (shift + width > 64) {
+            memcpy(&word, packed + (bit / 64 + 1) * sizeof(uint64_t), sizeof(word));
+            value |= word << (64 - shift);
+        }
+        return static_cast<uint32_t>(value & ((1ULL << width) - 1));
+    }
+};
+
+// 编码后的一个minipage
+struct RmEncodedMinipage {
+    uint8_t mode;                   // 页面中实际使用的编码方式
+    int offset;                     // 同RmMinipage
+    int len;
+    int32_t base = 0;               // FOR：页面中的最小值
+    int width = 0;                  // FOR、DICT：每个编号的位数
+    int dict_size = 0;              // DICT：字典中值的个数
+    const char *dict = nullptr;     // DICT：dict_size个值，每个len字节
+    const char *packed = nullptr;   // FOR、DICT：按位排列的编号
+    const char *raw = nullptr;      // NONE：原样拷贝的minipage
+
+    uint32_t code(int slot_no) const { return RmBitPacking::unpack(packed, width, slot_no); }
+
+    // slot_no中该minipage的值，写入out的len字节
+    void get(int slot_no, char *out) const {
+        switch (mode) {
+            case RM_ENCODING_FOR: {
+                int32_t value = static_cast<int32_t>(static_cast<uint32_t>(base) + code(slot_no));
+                memcpy(out, &value, sizeof(value));
+                break;
+            }
+            case RM_ENCODING_DICT:
+                // 没有有效记录的页面字典为空
+                if (dict_size == 0) {
+                    memset(out, 0, len);
+                } else {
+                    memcpy(out, dict + static_cast<size_t>(code(slot_no)) * len, len);
+                }
+                break;
+            default:
+                memcpy(out, raw + static_cast<size_t>(slot_no) * len, len);
+        }
+    }
+};
+
+/* 压缩页缓存中一个PAX页面的只读视图，不解码整个页面，按需取出记录或字段。调用者需要保证编码结果在使用期间有效 */
+class RmCompressedPage {
+   public:
+    RmCompressedPage(const RmFileHdr *file_hdr, const std::string &data) : file_hdr_(file_hdr), data_(data.data()) {
+        size_t n = file_hdr_->num_records_per_page;
+        size_t pos = prefix_size(*file_hdr_);
+        for (int i = 0; i < file_hdr_->num_minipages; i++) {
+            const RmMinipage &mp = file_hdr_->minipages[i];
+            RmEncodedMinipage enc;
+            enc.mode = static_cast<uint8_t>(data_[pos++]);
+            enc.offset = mp.offset;
+            enc.len = mp.len;
+            if (enc.mode == RM_ENCODING_FOR) {
+                memcpy(&enc.base, data_ + pos, sizeof(enc.base));
+                enc.width = static_cast<uint8_t>(data_[pos + sizeof(enc.base)]);
+                enc.packed = data_ + pos + sizeof(enc.base) + 1;
+                pos += sizeof(enc.base) + 1 + RmBitPacking::packed_size(n, enc.width);
+            } else if (enc.mode == RM_ENCODING_DICT) {
+                uint16_t dict_size;
+                memcpy(&dict_size, data_ + pos, sizeof(dict_size));
+                enc.dict_size = dict_size;
+                enc.width = static_cast<uint8_t>(data_[pos + sizeof(dict_size)]);
+                enc.dict = data_ + pos + sizeof(dict_size) + 1;
+                enc.packed = enc.dict + static_cast<size_t>(dict_size) * enc.len;
+                pos += sizeof(dict_size) + 1 + static_cast<size_t>(dict_size) * enc.len +
+                       RmBitPacking::packed_size(n, enc.width);
+            } else {
+                enc.raw = data_ + pos;
+                pos += n * enc.len;
+            }
+            minipages_.push_back(enc);
+        }
+        tail_ = pos;
+    }
+
+    // 页面开头原样保存的部分：LSN、RmPageHdr和bitmap
+    static size_t prefix_size(const RmFileHdr &file_hdr) {
+        return Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr) + file_hdr.bitmap_size;
+    }
+
+    // 页面中slot的个数，即file_hdr->num_records_per_page
+    int num_slots() const { return file_hdr_->num_records_per_page; }
+
+    const RmPageHdr *page_hdr() const { return reinterpret_cast<const RmPageHdr *>(data_ + Page::OFFSET_PAGE_HDR); }
+
+    const char *bitmap() const { return data_ + Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr); }
+
+    // slot_no之后的第一条记录，没有时返回file_hdr->num_records_per_page
+    int next_record(int slot_no) const {
+        return Bitmap::next_bit(true, bitmap(), file_hdr_->num_records_per_page, slot_no);
+    }
+
+    const RmEncodedMinipage &minipage(int i) const { return minipages_[i]; }
+
+    // 记录中偏移为offset的字段所在的minipage
+    int find_minipage(int offset) const {
+        int i = file_hdr_->num_minipages - 1;
+        while (i > 0 && file_hdr_->minipages[i].offset > offset) {
+            i--;
+        }
+        return i;
+    }
+
+    // 取出slot_no上的记录，buf有file_hdr->record_size字节
+    const char *get_record(int slot_no, char *buf) const {
+        for (auto &mp : minipages_) {
+            mp.get(slot_no, buf + mp.offset);
+        }
+        return buf;
+    }
+
+    /**
+     * @description: 记录中偏移为offset的字段的列视图，与RmPageHandle::column()相同。
+     *               原样保存的minipage直接指向编码结果，其余的minipage先解码到buf中
+     * @param {size_t*} stride 相邻两个slot中该字段的间隔，即字段所在minipage的宽度
+     * @param {vector<char>*} buf 解码minipage的缓冲区
+     */
+    const char *column(int offset, size_t *stride, std::vector<char> *buf) const {
+        const RmEncodedMinipage &mp = minipages_[find_minipage(offset)];
+        *stride = mp.len;
+        if (mp.mode == RM_ENCODING_NONE) {
+            return mp.raw + (offset - mp.offset);
+        }
+        int n = file_hdr_->num_records_per_page;
+        buf->resize(static_cast<size_t>(n) * mp.len);
+        for (int slot_no = 0; slot_no < n; slot_no++) {
+            mp.get(slot_no, buf->data() + static_cast<size_t>(slot_no) * mp.len);
+        }
+        return buf->data() + (offset - mp.offset);
+    }
+
+    // 还原出完整的页面，空闲slot中为0
+    void decode(char *page) const {
+        size_t prefix = prefix_size(*file_hdr_);
+        memset(page + prefix, 0, PAGE_SIZE - prefix);
+        memcpy(page, data_, prefix);
+        int n = file_hdr_->num_records_per_page;
+        char *slots = page + prefix;
+        for (auto &mp : minipages_) {
+            char *col = slots + static_cast<size_t>(n) * mp.offset;
+            for (int slot_no = next_record(-1); slot_no < n; slot_no = next_record(slot_no)) {
+                mp.get(slot_no, col + static_cast<size_t>(slot_no) * mp.len);
+            }
+        }
+        uint16_t tail_len;
+        memcpy(&tail_len, data_ + tail_, sizeof(tail_len));
+        memcpy(page + PAGE_SIZE - tail_len, data_ + tail_ + sizeof(tail_len), tail_len);
+    }
+
+   private:
+    const RmFileHdr *file_hdr_;
+    const char *data_;
+    std::vector<RmEncodedMinipage> minipages_;
+    size_t tail_;                   // 页尾部分在编码结果中的位置
+};
+
+/* 压缩PAX页面的编解码器，打开有编码方式的PAX文件时注册到缓冲池 */
+class RmPaxCodec : public PageCodec {
+   public:
+    explicit RmPaxCodec(const RmFileHdr &file_hdr) : file_hdr_(file_hdr) {}
+
+    bool encode(page_id_t page_no, const char *page, std::string *out) const override {
+        if (page_no == RM_FILE_HDR_PAGE) {
+            return false;
+        }
+        int n = file_hdr_.num_records_per_page;
+        size_t prefix = RmCompressedPage::prefix_size(file_hdr_);
+        const char *bitmap = page + Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr);
+        const char *slots = page + prefix;
+        std::vector<int> live;
+        for (int slot_no = Bitmap::first_bit(true, bitmap, n); slot_no < n;
+             slot_no = Bitmap::next_bit(true, bitmap, n, slot_no)) {
+            live.push_back(slot_no);
+        }
+        out->assign(page, prefix);
+        for (int i = 0; i < file_hdr_.num_minipages; i++) {
+            const RmMinipage &mp = file_hdr_.minipages[i];
+            const char *col = slots + static_cast<size_t>(n) * mp.offset;
+            if (mp.encoding == RM_ENCODING_FOR && mp.len == sizeof(int32_t) && encode_for(col, live, out)) {
+                continue;
+            }
+            if (mp.encoding == RM_ENCODING_DICT && encode_dict(col, mp.len, live, out)) {
+                continue;
+            }
+            out->push_back(static_cast<char>(RM_ENCODING_NONE));
+            out->append(col, static_cast<size_t>(n) * mp.len);
+        }
+        // 页尾不属于任何minipage的部分通常为0，只保存到最后一个非零字节
+        size_t end = prefix + static_cast<size_t>(n) * file_hdr_.record_size;
+        size_t tail_start = PAGE_SIZE;
+        for (size_t i = end; i < PAGE_SIZE; i++) {
+            if (page[i] != 0) {
+                tail_start = i;
+                break;
+            }
+        }
+        uint16_t tail_len = static_cast<uint16_t>(PAGE_SIZE - tail_start);
+        out->append(reinterpret_cast<const char *>(&tail_len), sizeof(tail_len));
+        out->append(page + tail_start, tail_len);
+        // 至少省下四分之一的空间才值得保存
+        return out->size() <= PAGE_SIZE / 4 * 3;
+    }
+
+    void decode(const std::string &data, char *page) const override { RmCompressedPage(&file_hdr_, data).decode(page); }
+
+   private:
+    // frame-of-reference：差值的位宽不小于32时不编码
+    bool encode_for(const char *col, const std::vector<int> &live, std::string *out) const {
+        int64_t min = 0;
+        int64_t max = 0;
+        for (size_t i = 0; i < live.size(); i++) {
+            int32_t value;
+            memcpy(&value, col + live[i] * sizeof(int32_t), sizeof(value));
+            min = i == 0 ? value : std::min<int64_t>(min, value);
+            max = i == 0 ? value : std::max<int64_t>(max, value);
+        }
+        uint64_t range = static_cast<uint64_t>(max - min);
+        int width = range == 0 ? 0 : 64 - __builtin_clzll(range);
+        if (width >= 32) {
+            return false;
+        }
+        std::vector<uint32_t> codes(file_hdr_.num_records_per_page, 0);
+        for (int slot_no : live) {
+            int32_t value;
+            memcpy(&value, col + slot_no * sizeof(int32_t), sizeof(value));
+            codes[slot_no] = static_cast<uint32_t>(value - min);
+        }
+        int32_t base = static_cast<int32_t>(min);
+        out->push_back(static_cast<char>(RM_ENCODING_FOR));
+        out->append(reinterpret_cast<const char *>(&base), sizeof(base));
+        out->push_back(static_cast<char>(width));
+        RmBitPacking::pack(codes, width, out);
+        return true;
+    }
+
+    // 页面内字典：不同的值太多、编码后没有变小时不编码
+    bool encode_dict(const char *col, int len, const std::vector<int> &live, std::string *out) const {
+        size_t n = file_hdr_.num_records_per_page;
+        std::unordered_map<std::string, uint32_t> ids;
+        std::vector<const char *> dict;
+        std::vector<uint32_t> codes(n, 0);
+        for (int slot_no : live) {
+            const char *value = col + static_cast<size_t>(slot_no) * len;
+            auto it = ids.emplace(std::string(value, len), static_cast<uint32_t>(dict.size())).first;
+            if (it->second == dict.size()) {
+                dict.push_back(value);
+                if (dict.size() > n / 2) {
+                    return false;
+                }
+            }
+            codes[slot_no] = it->second;
+        }
+        int width = dict.size() <= 1 ? 0 : 32 - __builtin_clz(static_cast<uint32_t>(dict.size() - 1));
+        if (dict.size() * len + RmBitPacking::packed_size(n, width) >= n * len) {
+            return false;
+        }
+        uint16_t dict_size = static_cast<uint16_t>(dict.size());
+        out->push_back(static_cast<char>(RM_ENCODING_DICT));
+        out->append(reinterpret_cast<const char *>(&dict_size), sizeof(dict_size));
+        out->push_back(static_cast<char>(width));
+        for (auto value : dict) {
+            out->append(value, len);
+        }
+        RmBitPacking::pack(codes, width, out);
+        return true;
+    }
+
+    RmFileHdr file_hdr_;
+};
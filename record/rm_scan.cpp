@@ -1,61 +1,222 @@
 #include "rm_scan.h"
+
+#include <algorithm>
+
 #include "rm_file_handle.h"
+#include "rm_pax_codec.h"
 
 /**
  * @brief 初始化file_handle和rid
  * @param file_handle
  */
-RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
-    // Todo:
-    // 初始化file_handle和rid（指向第一个存放了记录的位置）
-    rid_ = find_first_record();
-}
+RmScan::RmScan(const RmFileHandle *file_handle) : RmScan(file_handle, RM_FIRST_RECORD_PAGE, -1) {}
 
-//自己加的
-Rid RmScan::find_first_record() const {
-    RmFileHandle file_hdr= *file_handle_;
-    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_hdr.get_file_hdr().num_pages; page_no++) {
-        RmPageHandle page_handle = file_handle_->fetch_page_handle(page_no);
-        int num = page_handle.file_hdr->num_records_per_page;
-        for (int slot_no = 0; slot_no < num; slot_no++) {
-            if (file_handle_->is_record(Rid{page_no, slot_no})) {
-                return Rid{page_no, slot_no};
-            }
-        }
+/**
+ * @brief 初始化只扫描一段页面的RmScan
+ * @param file_handle
+ * @param start_page 第一个扫描的页号
+ * @param end_page 扫描范围的结束页号(不含)，超出文件的部分被忽略，为-1时扫描到文件末尾
+ * @param compressed_reads 是否直接读取压缩页缓存中的页面，只对压缩的PAX文件有效
+ * @param zone_conds 用zone map判断页面能否跳过的条件
+ */
+RmScan::RmScan(const RmFileHandle *file_handle, int start_page, int end_page, bool compressed_reads,
+               std::vector<RmZoneCondition> zone_conds)
+    : file_handle_(file_handle),
+      prefetch_page_no_(start_page),
+      end_page_(end_page),
+      compressed_reads_(compressed_reads && file_handle->file_hdr_.is_compressed()),
+      zone_conds_(std::move(zone_conds)) {
+    if (file_handle_->lsm_ != nullptr) {
+        lsm_iter_ = file_handle_->lsm_->new_iterator();
+        seek_lsm(start_page);
+        return;
+    }
+    if (!file_handle_->file_hdr_.is_contiguous()) {
+        record_buf_ = std::make_unique<char[]>(file_handle_->file_hdr_.record_size);
     }
-    return (Rid){-1, -1};
+    // rid指向第一个存放了记录的位置
+    rid_ = Rid{start_page, -1};
+    seek();
 }
 
+RmScan::~RmScan() { release_page(); }
+
 /**
  * @brief 找到文件中下一个存放了记录的位置
  */
 void RmScan::next() {
-    // Todo:
-    // 找到文件中下一个存放了记录的非空闲位置，用rid_来指向这个位置
-    while (rid_ != (Rid){-1,-1}) {
-        RmFileHandle file_hdr= *file_handle_;
-        int page_no = (file_hdr.get_file_hdr()).num_pages;
-        if (rid_.page_no < page_no) {
-            //printf("rid_page_no %d\n",rid_.page_no);
-            RmPageHandle page_handle = file_handle_->fetch_page_handle(rid_.page_no);
-            if (rid_.slot_no + 1 < page_handle.file_hdr->num_records_per_page) {
-                rid_.slot_no++;
-            } 
-            else {
-                rid_.page_no++;
-                rid_.slot_no = 0;
+    assert(!is_end());
+    if (lsm_iter_ != nullptr) {
+        lsm_iter_->next();
+        settle_lsm();
+        return;
+    }
+    seek();
+}
+
+/**
+ * @brief LSM表定位到虚拟页面page_no及之后的第一行
+ */
+void RmScan::seek_lsm(int page_no) {
+    uint64_t per_page = file_handle_->file_hdr_.num_records_per_page;
+    lsm_iter_->seek(static_cast<uint64_t>(std::max(page_no - RM_FIRST_RECORD_PAGE, 0)) * per_page);
+    settle_lsm();
+}
+
+// LSM表按迭代器的当前行设置rid_，越过扫描范围时结束
+void RmScan::settle_lsm() {
+    if (!lsm_iter_->valid()) {
+        rid_ = Rid{-1, -1};
+        return;
+    }
+    rid_ = file_handle_->lsm_rid(lsm_iter_->key());
+    if (end_page_ >= 0 && rid_.page_no >= end_page_) {
+        rid_ = Rid{-1, -1};
+        return;
+    }
+    PageAccessCounter::local().rows++;
+}
+
+/**
+ * @brief 从rid_之后查找下一条记录：在pin住的当前页面的bitmap中按字查找置位的slot(slotted page查找slot目录)，
+ *        当前页面没有更多记录时才unpin并进入下一个页面，每个页面只fetch一次。
+ *        compressed_reads_为true时在压缩页缓存中的页面直接查找编码结果中的bitmap。
+ *        zone map表明没有满足条件的记录的页面在fetch之前跳过，读取的页面上的记录数计入PageAccessCounter::rows
+ */
+void RmScan::seek() {
+    decoded_ = false;
+    int num_pages = end_page();
+    int num_slots = file_handle_->file_hdr_.num_records_per_page;
+    while (rid_.page_no < num_pages) {
+        if (page_handle_ == nullptr && compressed_page_ == nullptr) {
+            if (skip_page(rid_.page_no)) {
+                num_skipped_pages_++;
+                rid_ = Rid{rid_.page_no + 1, -1};
+                continue;
+            }
+            read_ahead(rid_.page_no);
+            if (compressed_reads_) {
+                compressed_data_ = file_handle_->buffer_pool_manager_->get_compressed_page(
+                    PageId{file_handle_->fd_, rid_.page_no});
+            }
+            if (compressed_data_ != nullptr) {
+                compressed_page_ = std::make_unique<RmCompressedPage>(&file_handle_->file_hdr_, *compressed_data_);
+            } else {
+                page_handle_ =
+                    std::make_unique<RmPageHandle>(file_handle_->fetch_page_handle(rid_.page_no, AccessType::Scan));
             }
+            // 读到的页面上的所有记录都计为扫描过的记录，按页面批量读取的调用者不逐条调用next()
+            PageAccessCounter::local().rows += page_handle_ != nullptr ? page_handle_->page_hdr->num_records
+                                                                       : compressed_page_->page_hdr()->num_records;
         }
-        if(rid_.page_no == page_no) {
-            rid_ = (Rid){-1,-1}; 
-            break;
+        int num_records =
+            page_handle_ != nullptr ? page_handle_->page_hdr->num_records : compressed_page_->page_hdr()->num_records;
+        if (num_records > 0) {
+            int slot_no = page_handle_ != nullptr ? page_handle_->next_record(rid_.slot_no)
+                                                  : compressed_page_->next_record(rid_.slot_no);
+            if (slot_no < num_slots) {
+                rid_.slot_no = slot_no;
+                return;
+            }
         }
-        else if(file_handle_->is_record(rid_)) {
-            break;
+        release_page();
+        rid_ = Rid{rid_.page_no + 1, -1};
+    }
+    rid_ = Rid{-1, -1};
+}
+
+/**
+ * @brief 从当前页面的开头重新查找记录，扫描停在页面的第一条记录上、释放外部latch之后页面可能被修改时使用
+ */
+void RmScan::rescan_page() {
+    assert(!is_end());
+    if (lsm_iter_ != nullptr) {
+        // 在新的快照上重新遍历，之前的快照看不到之后的修改
+        lsm_iter_ = file_handle_->lsm_->new_iterator();
+        seek_lsm(rid_.page_no);
+        return;
+    }
+    rid_.slot_no = -1;
+    seek();
+}
+
+/**
+ * @brief 当前记录所在的页面，调用next()离开该页面之后失效
+ */
+const RmPageHandle &RmScan::page() const {
+    assert(!is_end() && page_handle_ != nullptr);
+    return *page_handle_;
+}
+
+/**
+ * @brief 跳过当前页面，按页面批量读取记录的调用者处理完一个页面之后使用
+ */
+void RmScan::next_page() {
+    assert(!is_end());
+    if (lsm_iter_ != nullptr) {
+        seek_lsm(rid_.page_no + 1);
+        return;
+    }
+    release_page();
+    rid_ = Rid{rid_.page_no + 1, -1};
+    seek();
+}
+
+void RmScan::release_page() {
+    if (page_handle_ != nullptr) {
+        file_handle_->buffer_pool_manager_->unpin_page(page_handle_->page->get_page_id(), false);
+        page_handle_.reset();
+    }
+    compressed_page_.reset();
+    compressed_data_.reset();
+}
+
+// 扫描范围的结束页号，不超过文件当前的页数
+int RmScan::end_page() const {
+    int num_pages = file_handle_->file_hdr_.num_pages;
+    return end_page_ < 0 ? num_pages : std::min(end_page_, num_pages);
+}
+
+/**
+ * @brief 顺序预读：扫描到page_no时，若已预读的页面不足READ_AHEAD_PAGES / 2个，
+ *        则把[page_no, page_no + READ_AHEAD_PAGES)中尚未预读的页面一次读入缓冲池；
+ *        其中会被zone map跳过的页面不读，其余页面按连续的段分别预读
+ * @param page_no 扫描即将访问的页号
+ */
+void RmScan::read_ahead(int page_no) const {
+    if (page_no + READ_AHEAD_PAGES / 2 < prefetch_page_no_) {
+        return;
+    }
+    int start = std::max(page_no, prefetch_page_no_);
+    int end = std::min(page_no + READ_AHEAD_PAGES, end_page());
+    if (start >= end) {
+        return;
+    }
+    prefetch_page_no_ = end;
+    if (zone_conds_.empty()) {
+        file_handle_->buffer_pool_manager_->prefetch_pages(file_handle_->fd_, start, end - start);
+        return;
+    }
+    while (start < end) {
+        while (start < end && skip_page(start)) {
+            start++;
         }
+        int run_end = start;
+        while (run_end < end && !skip_page(run_end)) {
+            run_end++;
+        }
+        if (start < run_end) {
+            file_handle_->buffer_pool_manager_->prefetch_pages(file_handle_->fd_, start, run_end - start);
+        }
+        start = run_end;
     }
 }
 
+// zone map是否表明页面中没有满足扫描条件的记录
+bool RmScan::skip_page(int page_no) const {
+    return !zone_conds_.empty() && !file_handle_->zone_map_.may_match(page_no, zone_conds_);
+}
+
 /**
  * @brief ​ 判断是否到达文件末尾
  */
@@ -64,6 +225,28 @@ bool RmScan::is_end() const {
     return (rid_ == (Rid){-1,-1});
 }
 
+/**
+ * @brief 当前记录在页面中的slot，扫描一直pin住该页面，因此无需复制；slotted page和PAX格式的记录解码到record_buf_中
+ */
+const char *RmScan::record() const {
+    assert(!is_end());
+    if (lsm_iter_ != nullptr) {
+        return lsm_iter_->record();
+    }
+    if (record_buf_ == nullptr) {
+        return page_handle_->get_slot(rid_.slot_no);
+    }
+    if (!decoded_) {
+        if (compressed_page_ != nullptr) {
+            compressed_page_->get_record(rid_.slot_no, record_buf_.get());
+        } else {
+            page_handle_->get_record(rid_.slot_no, record_buf_.get());
+        }
+        decoded_ = true;
+    }
+    return record_buf_.get();
+}
+
 /**
  * @brief RmScan内部存放的rid
  */
@@ -1,19 +1,81 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "rm_defs.h"
+#include "rm_zone_map.h"
 
 class RmFileHandle;
+struct RmPageHandle;
+class RmCompressedPage;
+class RmLsmIterator;
 
+// 顺序扫描表数据文件，扫描期间一直pin住当前页面，直接在其bitmap(或slot目录)上查找下一条记录
+// 给出zone map条件时，zone map表明不可能有满足条件的记录的页面既不读取也不预读
+// LSM表按行号归并遍历memtable和sorted run，rid和页面范围使用RmFileHandle中的虚拟页面
 class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
     Rid rid_;
+    std::unique_ptr<RmPageHandle> page_handle_;  // rid_所在的页面，离开该页面时unpin
+    std::unique_ptr<char[]> record_buf_;    // slotted page或PAX格式中当前记录解码后的数据，定长格式为空
+    mutable bool decoded_ = false;          // record_buf_中是否已经是当前记录
+    mutable int prefetch_page_no_;  // 第一个尚未预读的页号
+    int end_page_;                  // 扫描范围的结束页号(不含)，为-1时扫描到文件末尾
+    bool compressed_reads_;         // 页面在压缩页缓存中时是否直接读取编码结果，不读入缓冲池
+    std::shared_ptr<const std::string> compressed_data_;    // 当前页面的编码结果，当前页面在缓冲池中时为空
+    std::unique_ptr<RmCompressedPage> compressed_page_;     // compressed_data_的视图
+    std::vector<RmZoneCondition> zone_conds_;   // 扫描的条件中能用zone map判断的部分，为空时读取所有页面
+    size_t num_skipped_pages_ = 0;  // 由zone map跳过的页面数
+    std::unique_ptr<RmLsmIterator> lsm_iter_;   // LSM表的遍历，堆表为空
 public:
     RmScan(const RmFileHandle *file_handle);
 
+    /**
+     * 只扫描[start_page, end_page)中的页面，并行扫描时每个morsel使用一个这样的RmScan
+     * compressed_reads为true时，在压缩页缓存中的页面不解码到缓冲池，调用者通过compressed_page()读取
+     * zone_conds为扫描的条件中字段有zone map的部分，跳过的页面中的记录一定不满足条件
+     */
+    RmScan(const RmFileHandle *file_handle, int start_page, int end_page, bool compressed_reads = false,
+           std::vector<RmZoneCondition> zone_conds = {});
+
+    ~RmScan();
+
     void next() override;
 
     bool is_end() const override;
 
     Rid rid() const override;
-    Rid find_first_record() const ;
+
+    // 当前记录在pin住的页面中的数据，不复制(slotted page中解码一次)，调用next()之后失效
+    const char *record() const;
+
+    // 从当前页面的第一个slot重新查找，当前页面在上次查找之后可能被修改时使用
+    void rescan_page();
+
+    // 当前记录所在的页面，扫描一直pin住它，用于按页面批量读取记录。当前页面在压缩页缓存中时不能调用
+    const RmPageHandle &page() const;
+
+    // 当前记录所在的页面在压缩页缓存中时返回它的编码结果，否则返回nullptr
+    const RmCompressedPage *compressed_page() const { return compressed_page_.get(); }
+
+    // 跳过当前页面中剩余的记录，移动到之后页面的第一条记录
+    void next_page();
+
+    size_t num_skipped_pages() const { return num_skipped_pages_; }
+private:
+    void seek();
+
+    void release_page();
+
+    void seek_lsm(int page_no);
+
+    void settle_lsm();
+
+    int end_page() const;
+
+    void read_ahead(int page_no) const;
+
+    bool skip_page(int page_no) const;
 };
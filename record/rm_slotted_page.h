@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "rm_defs.h"
+
+/*
+含有变长字段(VARCHAR)的表使用slotted page存储记录，记录在内存中仍然是定长的，只有页面中的元组是变长的
+1. 元组编码：按RmFileHdr::var_fields把记录切开，定长部分原样复制；每个变长字段去掉末尾的'\0'，
+   先写16位的实际长度再写内容。解码时把变长字段补'\0'恢复成定长的记录，因此上层看到的记录与定长格式完全相同
+2. 页面布局：RmPageHdr之后是RmSlottedPageHdr和slot目录，目录从前向后增长；元组区从页尾向前增长，
+   二者之间是连续的空闲空间。slot号即Rid::slot_no，删除记录只清空目录项，slot号可以被之后的插入复用
+3. 每个slot有一个容量，元组变短时容量不变，变长超出容量时在页内重新分配；连续的空闲空间不够而页面的
+   总空闲空间足够时先整理页面(compact)，把所有元组紧凑地移动到页尾。slot号在整理前后不变
+4. 元组只增不减地保留容量，保证撤销一次更新时修改前的元组总能放回原来的位置；
+   只有删除记录才释放它的空间，撤销删除时原来的空间可能已经被其他记录占用，此时调用方把记录插入到其他位置
+*/
+struct RmSlottedPageHdr {
+    uint16_t num_slots;     // slot目录的项数，包括空闲的slot，末尾的空闲slot会被截掉
+    uint16_t data_start;    // 元组区的起始位置(页面内偏移)，元组区从这里延伸到页尾
+    uint16_t used_bytes;    // 元组区中被使用的slot占用的字节数(按容量计)
+    uint16_t reserved;
+};
+
+struct RmSlot {
+    uint16_t offset;        // 元组在页面内的偏移，为0表示空闲slot
+    uint16_t capacity;      // 为元组分配的字节数，不小于元组编码后的长度
+};
+
+constexpr int RM_SLOT_DIR_OFFSET =
+    static_cast<int>(Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr) + sizeof(RmSlottedPageHdr));  // slot目录在页面中的偏移
+
+class RmSlottedPage {
+   public:
+    RmSlottedPage(const RmFileHdr *file_hdr, char *data)
+        : file_hdr_(file_hdr),
+          data_(data),
+          hdr_(reinterpret_cast<RmSlottedPageHdr *>(data + Page::OFFSET_PAGE_HDR + sizeof(RmPageHdr))),
+          slots_(reinterpret_cast<RmSlot *>(data + RM_SLOT_DIR_OFFSET)) {}
+
+    /**
+     * @description: 计算记录编码后的长度
+     * @param {RmFileHdr&} file_hdr 文件头，提供记录长度和变长字段
+     * @param {char*} record 定长的记录
+     */
+    static int encoded_size(const RmFileHdr &file_hdr, const char *record) {
+        int size = file_hdr.record_size;
+        for (int i = 0; i < file_hdr.num_var_fields; i++) {
+            const RmVarField &field = file_hdr.var_fields[i];
+            size += static_cast<int>(sizeof(uint16_t)) + var_len(record + field.offset, field.len) - field.len;
+        }
+        return size;
+    }
+
+    /**
+     * @description: 把定长的记录编码成元组
+     * @param {char*} out 输出的元组，至少有file_hdr.max_tuple_size字节
+     * @return {int} 元组的长度
+     */
+    static int encode(const RmFileHdr &file_hdr, const char *record, char *out) {
+        int pos = 0;
+        int offset = 0;
+        for (int i = 0; i < file_hdr.num_var_fields; i++) {
+            const RmVarField &field = file_hdr.var_fields[i];
+            memcpy(out + pos, record + offset, field.offset - offset);
+            pos += field.offset - offset;
+            uint16_t len = static_cast<uint16_t>(var_len(record + field.offset, field.len));
+            memcpy(out + pos, &len, sizeof(len));
+            memcpy(out + pos + sizeof(len), record + field.offset, len);
+            pos += sizeof(len) + len;
+            offset = field.offset + field.len;
+        }
+        memcpy(out + pos, record + offset, file_hdr.record_size - offset);
+        return pos + file_hdr.record_size - offset;
+    }
+
+    /**
+     * @description: 把元组解码成定长的记录，变长字段的实际长度超出字段长度时截断，损坏的元组不会越界
+     * @param {char*} tuple 元组
+     * @param {char*} out 输出的记录，有file_hdr.record_size字节
+     */
+    static void decode(const RmFileHdr &file_hdr, const char *tuple, char *out) {
+        int pos = 0;
+        int offset = 0;
+        for (int i = 0; i < file_hdr.num_var_fields; i++) {
+            const RmVarField &field = file_hdr.var_fields[i];
+            memcpy(out + offset, tuple + pos, field.offset - offset);
+            pos += field.offset - offset;
+            uint16_t len;
+            memcpy(&len, tuple + pos, sizeof(len));
+            len = std::min(len, field.len);
+            memcpy(out + field.offset, tuple + pos + sizeof(len), len);
+            memset(out + field.offset + len, 0, field.len - len);
+            pos += sizeof(len) + len;
+            offset = field.offset + field.len;
+        }
+        memcpy(out + offset, tuple + pos, file_hdr.record_size - offset);
+    }
+
+    // 初始化一个空页面
+    void init() {
+        hdr_->num_slots = 0;
+        hdr_->data_start = PAGE_SIZE;
+        hdr_->used_bytes = 0;
+        hdr_->reserved = 0;
+    }
+
+    int num_slots() const { return hdr_->num_slots; }
+
+    bool is_record(int slot_no) const { return slot_no >= 0 && slot_no < hdr_->num_slots && slots_[slot_no].offset != 0; }
+
+    // slot_no之后的第一条记录，没有时返回file_hdr->num_records_per_page
+    int next_record(int slot_no) const {
+        for (int i = slot_no + 1; i < hdr_->num_slots; i++) {
+            if (slots_[i].offset != 0) {
+                return i;
+            }
+        }
+        return file_hdr_->num_records_per_page;
+    }
+
+    // slot_no之后的第一个空闲slot，目录中没有空闲slot时返回目录末尾，目录已满时返回file_hdr->num_records_per_page
+    int next_free_slot(int slot_no) const {
+        for (int i = slot_no + 1; i < hdr_->num_slots; i++) {
+            if (slots_[i].offset == 0) {
+                return i;
+            }
+        }
+        return std::min(std::max(slot_no + 1, static_cast<int>(hdr_->num_slots)), file_hdr_->num_records_per_page);
+    }
+
+    const char *tuple(int slot_no) const { return data_ + slots_[slot_no].offset; }
+
+    // 页面中的总空闲字节数，整理页面之后都是连续的
+    int free_space() const { return PAGE_SIZE - dir_end(hdr_->num_slots) - hdr_->used_bytes; }
+
+    // 页面能否再插入任意一条记录，free space map和空闲页链表中只有满足这一条件的页面
+    bool has_room() const {
+        return free_space() >= file_hdr_->max_tuple_size + static_cast<int>(sizeof(RmSlot));
+    }
+
+    /**
+     * @description: 在slot_no放入size字节的元组是否放得下，slot_no上已有的元组会被替换，超出目录末尾时目录需要增长
+     */
+    bool can_put(int slot_no, int size) const {
+        if (slot_no < 0 || slot_no >= file_hdr_->num_records_per_page) {
+            return false;
+        }
+        int capacity = is_record(slot_no) ? slots_[slot_no].capacity : 0;
+        if (size <= capacity) {
+            return true;
+        }
+        int num_slots = std::max(slot_no + 1, static_cast<int>(hdr_->num_slots));
+        return PAGE_SIZE - dir_end(num_slots) - hdr_->used_bytes + capacity >= size;
+    }
+
+    /**
+     * @description: 把元组放入slot_no，已有的元组容量足够时原地覆盖，否则在页内重新分配，必要时整理页面。调用前需检查can_put()
+     */
+    void put(int slot_no, const char *tuple, int size) {
+        if (is_record(slot_no)) {
+            RmSlot &slot = slots_[slot_no];
+            if (size <= slot.capacity) {
+                memcpy(data_ + slot.offset, tuple, size);
+                return;
+            }
+            hdr_->used_bytes -= slot.capacity;
+            slot = RmSlot{0, 0};
+        }
+        // 目录增长之前先整理页面，否则新的目录项会覆盖元组区开头的元组
+        if (hdr_->data_start - dir_end(std::max(slot_no + 1, static_cast<int>(hdr_->num_slots))) < size) {
+            compact();
+        }
+        while (hdr_->num_slots <= slot_no) {
+            slots_[hdr_->num_slots++] = RmSlot{0, 0};
+        }
+        hdr_->data_start -= size;
+        hdr_->used_bytes += size;
+        slots_[slot_no] = RmSlot{hdr_->data_start, static_cast<uint16_t>(size)};
+        memcpy(data_ + hdr_->data_start, tuple, size);
+    }
+
+    // 删除slot_no上的元组，截掉目录末尾的空闲slot
+    void erase(int slot_no) {
+        hdr_->used_bytes -= slots_[slot_no].capacity;
+        slots_[slot_no] = RmSlot{0, 0};
+        while (hdr_->num_slots > 0 && slots_[hdr_->num_slots - 1].offset == 0) {
+            hdr_->num_slots--;
+        }
+        if (hdr_->num_slots == 0) {
+            hdr_->data_start = PAGE_SIZE;
+        }
+    }
+
+    // 整理页面：把所有元组紧凑地复制到页尾，slot号不变
+    void compact() {
+        char buf[PAGE_SIZE];
+        int pos = PAGE_SIZE;
+        for (int i = 0; i < hdr_->num_slots; i++) {
+            RmSlot &slot = slots_[i];
+            if (slot.offset != 0) {
+                pos -= slot.capacity;
+                memcpy(buf + pos, data_ + slot.offset, slot.capacity);
+                slot.offset = static_cast<uint16_t>(pos);
+            }
+        }
+        memcpy(data_ + pos, buf + pos, PAGE_SIZE - pos);
+        hdr_->data_start = static_cast<uint16_t>(pos);
+    }
+
+   private:
+    // 字段去掉末尾'\0'之后的长度
+    static int var_len(const char *field, int len) {
+        while (len > 0 && field[len - 1] == '\0') {
+            len--;
+        }
+        return len;
+    }
+
+    static int dir_end(int num_slots) { return RM_SLOT_DIR_OFFSET + num_slots * static_cast<int>(sizeof(RmSlot)); }
+
+    const RmFileHdr *file_hdr_;
+    char *data_;
+    RmSlottedPageHdr *hdr_;
+    RmSlot *slots_;
+};
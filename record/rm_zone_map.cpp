@@ -0,0 +1,127 @@
+#include "rm_zone_map.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t ZONE_MAGIC = 0x454e4f5a;    // "ZONE"
+
+struct ZoneFileHdr {
+    uint32_t magic;
+    int32_t num_columns;
+    int32_t num_pages;      // 文件中记录了范围的页面数，为0表示文件已过期
+    int32_t reserved;
+};
+
+void write_fully(int fd, const char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            throw UnixError();
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+// 把整个文件写为data并落盘
+void write_file(const std::string &path, const std::string &data) {
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    write_fully(fd, data.data(), data.size(), 0);
+    if (fdatasync(fd) < 0) {
+        ::close(fd);
+        throw UnixError();
+    }
+    ::close(fd);
+}
+
+}  // namespace
+
+void RmZoneMap::create(const std::string &path, const std::vector<RmZoneColumn> &columns) {
+    if (columns.empty()) {
+        return;
+    }
+    int num_columns = std::min(static_cast<int>(columns.size()), RM_MAX_ZONE_COLUMNS);
+    ZoneFileHdr hdr{ZONE_MAGIC, num_columns, 0, 0};
+    std::string data(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    data.append(reinterpret_cast<const char *>(columns.data()), num_columns * sizeof(RmZoneColumn));
+    write_file(path, data);
+}
+
+void RmZoneMap::load(const std::string &path, int num_pages) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    columns_.clear();
+    zones_.clear();
+    num_pages_ = 0;
+    int fd = ::open(path.c_str(), O_RDWR);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        throw UnixError();
+    }
+    std::vector<char> data(st.st_size);
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = pread(fd, data.data() + done, data.size() - done, done);
+        if (n <= 0) {
+            ::close(fd);
+            throw UnixError();
+        }
+        done += n;
+    }
+    ZoneFileHdr hdr{};
+    if (data.size() >= sizeof(hdr)) {
+        memcpy(&hdr, data.data(), sizeof(hdr));
+    }
+    size_t columns_end = sizeof(hdr) + std::max(hdr.num_columns, 0) * sizeof(RmZoneColumn);
+    if (hdr.magic != ZONE_MAGIC || hdr.num_columns <= 0 || hdr.num_columns > RM_MAX_ZONE_COLUMNS ||
+        data.size() < columns_end) {
+        ::close(fd);
+        return;
+    }
+    columns_.resize(hdr.num_columns);
+    memcpy(columns_.data(), data.data() + sizeof(hdr), hdr.num_columns * sizeof(RmZoneColumn));
+
+    // 不完整的文件中所有页面的范围未知，超出文件记录的页面的范围也未知
+    zones_.assign(static_cast<size_t>(num_pages) * columns_.size(), unknown_zone());
+    num_pages_ = num_pages;
+    size_t file_pages = hdr.num_pages;
+    if (data.size() == columns_end + file_pages * columns_.size() * sizeof(Zone)) {
+        size_t n = std::min(file_pages, static_cast<size_t>(num_pages)) * columns_.size();
+        memcpy(zones_.data(), data.data() + columns_end, n * sizeof(Zone));
+    }
+
+    // 关闭表之前的修改不会写入文件，崩溃后文件中的范围可能不包含页面中的记录
+    if (hdr.num_pages != 0) {
+        hdr.num_pages = 0;
+        write_fully(fd, reinterpret_cast<const char *>(&hdr), sizeof(hdr), 0);
+        if (fdatasync(fd) < 0) {
+            ::close(fd);
+            throw UnixError();
+        }
+    }
+    ::close(fd);
+}
+
+void RmZoneMap::save(const std::string &path) const {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    if (columns_.empty()) {
+        return;
+    }
+    ZoneFileHdr hdr{ZONE_MAGIC, static_cast<int32_t>(columns_.size()), num_pages_, 0};
+    std::string data(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    data.append(reinterpret_cast<const char *>(columns_.data()), columns_.size() * sizeof(RmZoneColumn));
+    data.append(reinterpret_cast<const char *>(zones_.data()), zones_.size() * sizeof(Zone));
+    write_file(path, data);
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "common/common.h"
+#include "rm_defs.h"
+
+constexpr int RM_MAX_ZONE_COLUMNS = 16;
+
+/* zone map记录范围的字段：记录中偏移为offset的4字节INT或FLOAT字段 */
+struct RmZoneColumn {
+    int offset;
+    ColType type;
+};
+
+/* 顺序扫描的一个`字段 op 常量`条件，column是字段在zone map中的下标，常量按字段类型转换为double */
+struct RmZoneCondition {
+    int column;
+    CompOp op;
+    double value;
+};
+
+/*
+RmZoneMap为表数据文件的每个页面记录若干字段的最小值和最大值，顺序扫描据此跳过不可能有满足条件的记录的页面，
+不需要读取这些页面
+1. 只记录4字节的INT和FLOAT字段，值转换为double保存，比较结果与ix_compare()相同
+2. 插入和更新记录时扩大所在页面的范围，删除记录时不缩小，因此范围包含页面中写入过的所有值，
+   快照读取的旧版本也在范围内。从未写入过记录的页面范围为空，总是被跳过；范围未知的页面为(-inf, +inf)，总是被读取
+3. 持久化在数据文件旁的<表名>.zone文件中，关闭表时整体写回。打开时读出之后立即把文件标记为过期(页面数写为0)，
+   崩溃后重新打开时所有页面的范围未知；崩溃恢复重建free space map时按页面中的记录一起重建
+4. 扫描线程与修改记录的线程并发访问，由latch_保护：扫描每个页面只判断一次，插入每条记录时更新一次
+*/
+class RmZoneMap {
+   public:
+    RmZoneMap() = default;
+
+    RmZoneMap(const RmZoneMap &) = delete;
+    RmZoneMap &operator=(const RmZoneMap &) = delete;
+
+    // 数据文件对应的zone map文件
+    static std::string file_name(const std::string &data_file) { return data_file + ".zone"; }
+
+    /**
+     * @description: 为新建的数据文件创建zone map文件，columns为空时不创建
+     * @param {string&} path zone map文件的路径
+     * @param {vector<RmZoneColumn>&} columns 记录范围的字段，最多RM_MAX_ZONE_COLUMNS个
+     */
+    static void create(const std::string &path, const std::vector<RmZoneColumn> &columns);
+
+    /**
+     * @description: 读出zone map文件并把它标记为过期。文件不存在时不记录任何字段，扫描不会跳过页面；
+     *               文件过期或不完整时所有页面的范围未知
+     * @param {string&} path zone map文件的路径
+     * @param {int} num_pages 数据文件的页面数
+     */
+    void load(const std::string &path, int num_pages);
+
+    /**
+     * @description: 把zone map写回文件并落盘，不记录任何字段时什么都不做
+     */
+    void save(const std::string &path) const;
+
+    const std::vector<RmZoneColumn> &columns() const { return columns_; }
+
+    // 记录中偏移为offset、类型为type的字段在zone map中的下标，不记录该字段时返回-1
+    int find_column(int offset, ColType type) const {
+        for (size_t i = 0; i < columns_.size(); i++) {
+            if (columns_[i].offset == offset && columns_[i].type == type) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @description: 数据文件增长到num_pages个页面，新页面的范围为空，known为false时新页面的范围未知
+     */
+    void extend(int num_pages, bool known = true) {
+        if (columns_.empty()) {
+            return;
+        }
+        std::unique_lock<std::shared_mutex> lock(latch_);
+        if (num_pages > num_pages_) {
+            zones_.resize(static_cast<size_t>(num_pages) * columns_.size(), known ? empty_zone() : unknown_zone());
+            num_pages_ = num_pages;
+        }
+    }
+
+    // 清空所有页面的范围，按页面中的记录重建之前调用
+    void reset(int num_pages) {
+        std::unique_lock<std::shared_mutex> lock(latch_);
+        zones_.assign(static_cast<size_t>(num_pages) * columns_.size(), empty_zone());
+        num_pages_ = num_pages;
+    }
+
+    // 页面page_no中写入了记录record，扩大该页面的范围
+    void add(int page_no, const char *record) {
+        if (columns_.empty()) {
+            return;
+        }
+        std::unique_lock<std::shared_mutex> lock(latch_);
+        if (page_no >= num_pages_) {
+            return;
+        }
+        Zone *zones = &zones_[static_cast<size_t>(page_no) * columns_.size()];
+        for (size_t i = 0; i < columns_.size(); i++) {
+            double value = column_value(columns_[i].type, record + columns_[i].offset);
+            if (value != value) {
+                // NaN与任何值比较都不成立，无法用范围表示
+                zones[i] = unknown_zone();
+                continue;
+            }
+            zones[i].min = std::min(zones[i].min, value);
+            zones[i].max = std::max(zones[i].max, value);
+        }
+    }
+
+    /**
+     * @description: 页面中是否可能有满足所有条件的记录，为false时扫描可以跳过该页面
+     */
+    bool may_match(int page_no, const std::vector<RmZoneCondition> &conds) const {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        if (page_no >= num_pages_) {
+            return true;
+        }
+        const Zone *zones = &zones_[static_cast<size_t>(page_no) * columns_.size()];
+        for (auto &cond : conds) {
+            const Zone &zone = zones[cond.column];
+            if (zone.min > zone.max) {
+                return false;
+            }
+            if (!zone_may_match(zone, cond.op, cond.value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 把字段的值转换为double
+    static double column_value(ColType type, const char *data) {
+        if (type == TYPE_INT) {
+            int value;
+            memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        float value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+   private:
+    struct Zone {
+        double min;
+        double max;
+    };
+
+    static Zone empty_zone() {
+        return Zone{std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+    }
+
+    static Zone unknown_zone() {
+        return Zone{-std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+    }
+
+    static bool zone_may_match(const Zone &zone, CompOp op, double value) {
+        switch (op) {
+            case OP_EQ: return zone.min <= value && value <= zone.max;
+            case OP_NE: return !(zone.min == value && zone.max == value);
+            case OP_LT: return zone.min < value;
+            case OP_GT: return zone.max > value;
+            case OP_LE: return zone.min <= value;
+            case OP_GE: return zone.max >= value;
+            default: return true;
+        }
+    }
+
+    mutable std::shared_mutex latch_;
+    std::vector<RmZoneColumn> columns_;
+    std::vector<Zone> zones_;   // 第page_no个页面第i个字段的范围位于page_no * columns_.size() + i
+    int num_pages_ = 0;
+};
@@ -7,6 +7,7 @@
 #include <sstream>
 #include "common/context.h"
 #include "common/config.h"
+#include "system/sm_meta.h"
 
 #define RECORD_COUNT_LENGTH 40
 
@@ -18,30 +19,20 @@ public:
         assert(num_cols_ > 0);
     }
 
+    // 每一行整体写入缓冲区，流式发送的每一帧都由完整的行组成
     void print_separator(Context *context) const {
+        std::string line;
         for (size_t i = 0; i < num_cols; i++) {
             // std::cout << '+' << std::string(COL_WIDTH + 2, '-');
-            std::string str = "+" + std::string(COL_WIDTH + 2, '-');
-            if(context->ellipsis_ == false && *context->offset_ + RECORD_COUNT_LENGTH + str.length() < BUFFER_LENGTH) {
-                memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-                *(context->offset_) = *(context->offset_) + str.length();
-            }
-            else {
-                context->ellipsis_ = true;
-            }
-        }
-        std::string str = "+\n";
-        if(context->ellipsis_ == false && *context->offset_ + RECORD_COUNT_LENGTH + str.length() < BUFFER_LENGTH) {
-            memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-            *(context->offset_) = *(context->offset_) + str.length();
-        }
-        else {
-            context->ellipsis_ = true;
+            line += "+" + std::string(COL_WIDTH + 2, '-');
         }
+        line += "+\n";
+        append(line, context);
     }
 
     void print_record(const std::vector<std::string> &rec_str, Context *context) const {
         assert(rec_str.size() == num_cols);
+        std::string line;
         for (auto col: rec_str) {
             if (col.size() > COL_WIDTH) {
                 col = col.substr(0, COL_WIDTH - 3) + "...";
@@ -49,22 +40,16 @@ public:
             // std::cout << "| " << std::setw(COL_WIDTH) << col << ' ';
             std::stringstream ss;
             ss << "| " << std::setw(COL_WIDTH) << col << " ";
-            if(context->ellipsis_ == false && *context->offset_ + RECORD_COUNT_LENGTH + ss.str().length() < BUFFER_LENGTH) {
-                memcpy(context->data_send_ + *(context->offset_), ss.str().c_str(), ss.str().length());
-                *(context->offset_) = *(context->offset_) + ss.str().length();
-            }
-            else {
-                context->ellipsis_ = true;
-            }
+            line += ss.str();
         }
         // std::cout << "|\n";
-        std::string str = "|\n";
-        if(context->ellipsis_ == false && *context->offset_ + RECORD_COUNT_LENGTH + str.length() < BUFFER_LENGTH) {
-            memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-            *(context->offset_) = *(context->offset_) + str.length();
-        }
+        line += "|\n";
+        append(line, context);
     }
 
+    // 不按表格排版的一行文本，如EXPLAIN的输出
+    static void print_line(const std::string &line, Context *context) { append(line + '\n', context); }
+
     static void print_record_count(size_t num_rec, Context *context) {
         // std::cout << "Total record(s): " << num_rec << '\n';
         std::string str = "";
@@ -75,4 +60,100 @@ public:
         memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
         *(context->offset_) = *(context->offset_) + str.length();
     }
+
+private:
+    // 把str写入结果缓冲区，缓冲区末尾预留RECORD_COUNT_LENGTH字节给记录数。
+    // 缓冲区写满时先把已有的结果流式发送给客户端；不支持流式发送时截断之后的结果，最后输出省略号
+    static void append(const std::string &str, Context *context) {
+        if (context->ellipsis_) {
+            return;
+        }
+        if (*context->offset_ + RECORD_COUNT_LENGTH + str.length() >= BUFFER_LENGTH &&
+            (!context->flush_result() || RECORD_COUNT_LENGTH + str.length() >= BUFFER_LENGTH)) {
+            context->ellipsis_ = true;
+            return;
+        }
+        memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
+        *(context->offset_) = *(context->offset_) + str.length();
+    }
+};
+
+/* 二进制格式的结果，供程序客户端使用，避免把数值格式化为文本。所有整数和浮点数均为小端序：
+   header: 1字节BINARY_RESULT_MAGIC，uint32字段数，每个字段为1字节ColType、uint32名称长度和名称
+   row:    1字节BINARY_ROW，每个字段为int32、float32，或uint32长度和去掉末尾'\0'的字符串
+   footer: 1字节BINARY_END，uint64记录数
+   每条记录整体写入缓冲区，缓冲区写满时流式发送给客户端 */
+class BinaryRecordPrinter {
+public:
+    static constexpr uint8_t BINARY_RESULT_MAGIC = 0xB1;    // 文本结果不会以该字节开头，客户端据此区分两种格式
+    static constexpr uint8_t BINARY_ROW = 1;
+    static constexpr uint8_t BINARY_END = 0;
+
+    BinaryRecordPrinter(std::vector<ColMeta> cols) : cols_(std::move(cols)) {}
+
+    void print_header(const std::vector<std::string> &captions, Context *context) const {
+        assert(captions.size() == cols_.size());
+        size_t len = 1 + 4;
+        for (auto &caption : captions) {
+            len += 1 + 4 + caption.size();
+        }
+        char *dst = reserve(len, context);
+        *dst++ = static_cast<char>(BINARY_RESULT_MAGIC);
+        dst = put_u32(dst, cols_.size());
+        for (size_t i = 0; i < cols_.size(); i++) {
+            *dst++ = static_cast<char>(cols_[i].type);
+            dst = put_u32(dst, captions[i].size());
+            memcpy(dst, captions[i].data(), captions[i].size());
+            dst += captions[i].size();
+        }
+    }
+
+    void print_record(const char *tuple, Context *context) const {
+        size_t len = 1;
+        for (auto &col : cols_) {
+            len += col.type == TYPE_STRING ? 4 + strnlen(tuple + col.offset, col.len) : 4;
+        }
+        char *dst = reserve(len, context);
+        *dst++ = static_cast<char>(BINARY_ROW);
+        for (auto &col : cols_) {
+            const char *val = tuple + col.offset;
+            if (col.type == TYPE_STRING) {
+                size_t str_len = strnlen(val, col.len);
+                dst = put_u32(dst, str_len);
+                memcpy(dst, val, str_len);
+                dst += str_len;
+            } else {
+                // int和float都是4字节，按位编码为小端序
+                uint32_t bits;
+                memcpy(&bits, val, sizeof(bits));
+                dst = put_u32(dst, bits);
+            }
+        }
+    }
+
+    void print_footer(uint64_t num_rec, Context *context) const {
+        char *dst = reserve(1 + 8, context);
+        *dst++ = static_cast<char>(BINARY_END);
+        put_u32(put_u32(dst, static_cast<uint32_t>(num_rec)), static_cast<uint32_t>(num_rec >> 32));
+    }
+
+private:
+    // 在结果缓冲区中预留len字节，空间不足时先发送已有的结果；二进制结果不能截断
+    static char *reserve(size_t len, Context *context) {
+        if (*context->offset_ + len > BUFFER_LENGTH && (!context->flush_result() || len > BUFFER_LENGTH)) {
+            throw InternalError("binary result row exceeds the result buffer");
+        }
+        char *dst = context->data_send_ + *context->offset_;
+        *context->offset_ += len;
+        return dst;
+    }
+
+    static char *put_u32(char *dst, uint32_t val) {
+        for (int i = 0; i < 4; i++) {
+            *dst++ = static_cast<char>(val >> (8 * i));
+        }
+        return dst;
+    }
+
+    std::vector<ColMeta> cols_;     // 输出记录的字段，顺序与表头一致
 };
@@ -1,5 +1,27 @@
 #include <cstring>
 #include "log_manager.h"
+#include "common/metrics.h"
+#include "common/trace.h"
+#include "transaction/transaction.h"
+
+std::atomic<bool> enable_logging(true);
+std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
+
+LogManager::LogManager(DiskManager* disk_manager)
+    : buffers_(std::make_unique<LogBuffer[]>(2)), disk_manager_(disk_manager) {
+    flusher_ = std::thread(&LogManager::run_flusher, this);
+}
+
+LogManager::~LogManager() {
+    {
+        std::scoped_lock lock{latch_};
+        stop_flusher_ = true;
+    }
+    flush_cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
 
 /**
  * @description: 添加日志记录到日志缓冲区中，并返回日志记录号
@@ -7,12 +29,246 @@
  * @return {lsn_t} 返回该日志的日志记录号
  */
 lsn_t LogManager::add_log_to_buffer(LogRecord* log_record) {
-  
+    uint32_t len = log_record->log_tot_len_;
+    while (true) {
+        uint64_t reserve = reserve_.fetch_add((1ull << 32) + len, std::memory_order_acq_rel);
+        lsn_t lsn = reserved_lsn(reserve);
+        int buffer = reserved_buffer(reserve);
+        uint32_t offset = reserved_offset(reserve);
+        if (offset + len <= LOG_BUFFER_SIZE) {
+            LogBuffer& log_buffer = buffers_[buffer];
+            log_record->lsn_ = lsn;
+            log_record->serialize(log_buffer.buffer_ + offset);
+            log_buffer.filled_.fetch_add(len, std::memory_order_release);
+            return lsn;
+        }
+        std::unique_lock<std::mutex> lock{latch_};
+        if (offset <= LOG_BUFFER_SIZE) {
+            // 越过缓冲区末尾的写入者负责切换缓冲区，它的lsn留给切换后的第一条日志
+            rotate(lock, buffer, offset, lsn);
+        } else {
+            rotate_cv_.wait(lock, [this, buffer] {
+                uint64_t current = reserve_.load(std::memory_order_acquire);
+                return reserved_buffer(current) != buffer || reserved_offset(current) <= LOG_BUFFER_SIZE;
+            });
+        }
+    }
+}
+
+/**
+ * @description: 把事务的一条日志记录写入缓冲区，并把它链接到事务的上一条日志记录之后。
+ *               事务的第一条日志记录之前先写入begin记录，没有写过日志的只读事务不产生任何日志
+ * @return {lsn_t} 该日志的日志记录号
+ * @param {Transaction*} txn 写日志的事务
+ * @param {LogRecord*} log_record 要写入缓冲区的日志记录
+ */
+lsn_t LogManager::append_txn_log(Transaction* txn, LogRecord* log_record) {
+    if (txn->get_prev_lsn() == INVALID_LSN && log_record->log_type_ != LogType::begin) {
+        BeginLogRecord begin_record(txn->get_transaction_id());
+        append_txn_log(txn, &begin_record);
+    }
+    txn_id_t txn_id = txn->get_transaction_id();
+    log_record->log_tid_ = txn_id;
+    log_record->prev_lsn_ = txn->get_prev_lsn();
+    lsn_t lsn;
+    if (log_record->log_type_ == LogType::begin) {
+        // 在txn_latch_下写入begin记录并登记，检查点读取ATT之后开始的事务的日志都在检查点开始记录之后
+        std::scoped_lock lock{txn_latch_};
+        lsn = add_log_to_buffer(log_record);
+        active_txns_.emplace(txn_id, lsn);
+    } else {
+        lsn = add_log_to_buffer(log_record);
+        if (log_record->log_type_ == LogType::commit || log_record->log_type_ == LogType::ABORT) {
+            std::scoped_lock lock{txn_latch_};
+            active_txns_.erase(txn_id);
+        }
+    }
+    txn->set_prev_lsn(lsn);
+    return lsn;
 }
 
 /**
- * @description: 把日志缓冲区的内容刷到磁盘中，由于目前只设置了一个缓冲区，因此需要阻塞其他日志操作
+ * @description: 等待lsn及之前的日志持久化，由flusher线程批量fsync后唤醒
+ * @param {lsn_t} lsn 需要持久化的日志记录号
+ */
+void LogManager::wait_for_persist(lsn_t lsn) {
+    std::unique_lock<std::mutex> lock{latch_};
+    if (persist_lsn_ >= lsn) {
+        return;
+    }
+    request_lsn_ = std::max(request_lsn_, lsn);
+    flush_cv_.notify_one();
+    persist_cv_.wait(lock, [this, lsn] { return persist_lsn_ >= lsn; });
+}
+
+/**
+ * @description: 把日志缓冲区的内容刷到磁盘中，返回时之前写入缓冲区的日志都已经持久化
  */
 void LogManager::flush_log_to_disk() {
+    lsn_t lsn = reserved_lsn(reserve_.load(std::memory_order_acquire)) - 1;
+    if (lsn != INVALID_LSN) {
+        wait_for_persist(lsn);
+    }
+}
+
+lsn_t LogManager::get_persist_lsn() {
+    std::scoped_lock lock{latch_};
+    return persist_lsn_;
+}
+
+/**
+ * @description: 恢复时设置下一条日志的lsn，使新的日志接在日志文件中已有的日志之后。只能在写入任何日志之前调用
+ * @param {lsn_t} lsn 下一条日志的lsn
+ */
+void LogManager::set_next_lsn(lsn_t lsn) {
+    std::scoped_lock lock{latch_};
+    reserve_.store(make_reserve(lsn, reserved_buffer(reserve_.load())), std::memory_order_release);
+    persist_lsn_ = lsn - 1;
+}
+
+/**
+ * @description: 读取活跃事务表，用于检查点
+ * @return {vector<CheckpointTxn>} 写过日志、尚未写入commit/abort记录的事务及其第一条日志
+ */
+std::vector<CheckpointTxn> LogManager::get_active_txns() {
+    std::scoped_lock lock{txn_latch_};
+    std::vector<CheckpointTxn> txns;
+    txns.reserve(active_txns_.size());
+    for (auto& entry : active_txns_) {
+        txns.push_back(CheckpointTxn{entry.first, entry.second});
+    }
+    return txns;
+}
+
+/**
+ * @description: 登记一个不是由append_txn_log()开始的活跃事务，用于恢复时正在撤销的失败事务，
+ *               在它的abort记录写入之前，检查点不会丢弃它的日志
+ * @param {txn_id_t} txn_id 事务
+ * @param {lsn_t} first_lsn 事务的第一条日志
+ */
+void LogManager::add_active_txn(txn_id_t txn_id, lsn_t first_lsn) {
+    std::scoped_lock lock{txn_latch_};
+    active_txns_.emplace(txn_id, first_lsn);
+}
+
+/**
+ * @description: 丢弃lsn之前的日志。日志文件中第一条lsn不小于它的日志成为新的开头，
+ *               调用者需保证lsn之前的日志已经持久化，并且恢复不再需要它们
+ * @param {lsn_t} lsn 需要保留的第一条日志
+ */
+void LogManager::truncate_log(lsn_t lsn) {
+    std::scoped_lock lock{file_latch_};
+    std::vector<char> buf(LOG_BUFFER_SIZE);
+    int offset = 0;     // buf[pos]在文件中的位置
+    int pos = 0;
+    int len = 0;
+    while (true) {
+        if (len - pos < LOG_HEADER_SIZE) {
+            len = disk_manager_->read_log(buf.data(), LOG_BUFFER_SIZE, offset);
+            pos = 0;
+            if (len < LOG_HEADER_SIZE) {
+                return;
+            }
+        }
+        LogRecord header;
+        header.deserialize(buf.data() + pos);
+        if (header.lsn_ >= lsn) {
+            break;
+        }
+        if (header.log_tot_len_ < LOG_HEADER_SIZE) {
+            return;
+        }
+        offset += header.log_tot_len_;
+        pos += header.log_tot_len_;
+    }
+    if (offset > 0) {
+        disk_manager_->truncate_log_head(offset);
+    }
+}
+
+// 封存buffer并切换到另一个缓冲区，调用者持有latch_。另一个缓冲区尚未写入磁盘时等待flusher
+void LogManager::rotate(std::unique_lock<std::mutex>& lock, int buffer, uint32_t size, lsn_t next_lsn) {
+    rotate_cv_.wait(lock, [this] { return sealed_buffer_ == -1; });
+    buffers_[buffer].size_ = size;
+    buffers_[buffer].last_lsn_ = next_lsn - 1;
+    sealed_buffer_ = buffer;
+    buffers_[1 - buffer].filled_.store(0, std::memory_order_relaxed);
+    reserve_.store(make_reserve(next_lsn, 1 - buffer), std::memory_order_release);
+    rotate_cv_.notify_all();
+    flush_cv_.notify_one();
+}
+
+// flusher封存当前缓冲区，调用者持有latch_。缓冲区为空、另一个缓冲区尚未写完或有写入者正在切换时返回false
+bool LogManager::seal_active() {
+    if (sealed_buffer_ != -1) {
+        return false;
+    }
+    uint64_t reserve = reserve_.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t offset = reserved_offset(reserve);
+        if (offset == 0 || offset > LOG_BUFFER_SIZE) {
+            return false;
+        }
+        int buffer = reserved_buffer(reserve);
+        lsn_t next_lsn = reserved_lsn(reserve);
+        buffers_[1 - buffer].filled_.store(0, std::memory_order_relaxed);
+        if (reserve_.compare_exchange_weak(reserve, make_reserve(next_lsn, 1 - buffer), std::memory_order_acq_rel)) {
+            buffers_[buffer].size_ = offset;
+            buffers_[buffer].last_lsn_ = next_lsn - 1;
+            sealed_buffer_ = buffer;
+            rotate_cv_.notify_all();
+            return true;
+        }
+    }
+}
 
+// flusher线程，有等待者时立即刷盘，否则每隔log_timeout刷盘一次
+void LogManager::run_flusher() {
+    std::unique_lock<std::mutex> lock{latch_};
+    while (true) {
+        bool woken = flush_cv_.wait_for(lock, log_timeout, [this] {
+            return stop_flusher_ || request_lsn_ > persist_lsn_ || sealed_buffer_ != -1;
+        });
+        // 只有写满的缓冲区时不封存当前缓冲区；每轮最多写两个缓冲区，持续写入时也会及时fsync
+        bool seal = !woken || stop_flusher_ || request_lsn_ > persist_lsn_;
+        lsn_t written = persist_lsn_;
+        for (int round = 0; round < 2; round++) {
+            if (sealed_buffer_ == -1 && !(seal && seal_active())) {
+                break;
+            }
+            LogBuffer& log_buffer = buffers_[sealed_buffer_];
+            lock.unlock();
+            // 等待在该缓冲区中预留了空间的写入者完成序列化
+            while (log_buffer.filled_.load(std::memory_order_acquire) != log_buffer.size_) {
+                std::this_thread::yield();
+            }
+            {
+                std::scoped_lock file_lock{file_latch_};
+                TraceSpan span("wal.write", "bytes", log_buffer.size_);
+                disk_manager_->write_log(log_buffer.buffer_, log_buffer.size_);
+            }
+            EngineMetrics::get().wal_bytes.add(log_buffer.size_);
+            lock.lock();
+            written = log_buffer.last_lsn_;
+            sealed_buffer_ = -1;
+            rotate_cv_.notify_all();
+        }
+        if (written > persist_lsn_) {
+            // 写盘和fsync期间其他事务继续写入另一个缓冲区，它们由下一次fsync持久化
+            lock.unlock();
+            {
+                std::scoped_lock file_lock{file_latch_};
+                ScopedLatency latency(EngineMetrics::get().wal_fsync_latency);
+                TraceSpan span("wal.fsync", "lsn", written);
+                disk_manager_->sync_log();
+            }
+            lock.lock();
+            persist_lsn_ = written;
+            persist_cv_.notify_all();
+        }
+        if (stop_flusher_ && sealed_buffer_ == -1 &&
+            reserved_offset(reserve_.load(std::memory_order_acquire)) == 0) {
+            break;
+        }
+    }
 }
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <iostream>
 #include "log_defs.h"
@@ -14,7 +19,9 @@ enum LogType: int {
     DELETE,
     begin,
     commit,
-    ABORT
+    ABORT,
+    CHECKPOINT_BEGIN,
+    CHECKPOINT_END
 };
 static std::string LogTypeStr[] = {
     "UPDATE",
@@ -22,7 +29,9 @@ static std::string LogTypeStr[] = {
     "DELETE",
     "BEGIN",
     "COMMIT",
-    "ABORT"
+    "ABORT",
+    "CHECKPOINT_BEGIN",
+    "CHECKPOINT_END"
 };
 
 class LogRecord {
@@ -87,131 +96,398 @@ public:
     }
 };
 
-/**
- * TODO: commit操作的日志记录
-*/
+/* commit操作的日志记录，事务提交时等待它持久化 */
 class CommitLogRecord: public LogRecord {
-
+public:
+    CommitLogRecord() {
+        log_type_ = LogType::commit;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = LOG_HEADER_SIZE;
+        log_tid_ = INVALID_TXN_ID;
+        prev_lsn_ = INVALID_LSN;
+    }
+    CommitLogRecord(txn_id_t txn_id) : CommitLogRecord() {
+        log_tid_ = txn_id;
+    }
+    void format_print() override {
+        printf("commit record\n");
+        LogRecord::format_print();
+    }
 };
 
-/**
- * TODO: abort操作的日志记录
-*/
+/* abort操作的日志记录 */
 class AbortLogRecord: public LogRecord {
-
+public:
+    AbortLogRecord() {
+        log_type_ = LogType::ABORT;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = LOG_HEADER_SIZE;
+        log_tid_ = INVALID_TXN_ID;
+        prev_lsn_ = INVALID_LSN;
+    }
+    AbortLogRecord(txn_id_t txn_id) : AbortLogRecord() {
+        log_tid_ = txn_id;
+    }
+    void format_print() override {
+        printf("abort record\n");
+        LogRecord::format_print();
+    }
 };
 
-class InsertLogRecord: public LogRecord {
+/* 检查点开始的日志记录，检查点结束记录中的ATT和DPT都在写入它之后读取 */
+class CheckpointBeginLogRecord: public LogRecord {
 public:
-    InsertLogRecord() {
-        log_type_ = LogType::INSERT;
+    CheckpointBeginLogRecord() {
+        log_type_ = LogType::CHECKPOINT_BEGIN;
         lsn_ = INVALID_LSN;
         log_tot_len_ = LOG_HEADER_SIZE;
         log_tid_ = INVALID_TXN_ID;
         prev_lsn_ = INVALID_LSN;
-        table_name_ = nullptr;
     }
-    InsertLogRecord(txn_id_t txn_id, RmRecord& insert_value, Rid& rid, std::string table_name) 
-        : InsertLogRecord() {
-        log_tid_ = txn_id;
-        insert_value_ = insert_value;
-        rid_ = rid;
-        log_tot_len_ += sizeof(int);
-        log_tot_len_ += insert_value_.size;
-        log_tot_len_ += sizeof(Rid);
-        table_name_size_ = table_name.length();
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, table_name.c_str(), table_name_size_);
-        log_tot_len_ += sizeof(size_t) + table_name_size_;
+    void format_print() override {
+        printf("checkpoint begin record\n");
+        LogRecord::format_print();
+    }
+};
+
+/* 检查点时的活跃事务 */
+struct CheckpointTxn {
+    txn_id_t txn_id;
+    lsn_t first_lsn;        // 事务的第一条日志，撤销时需要从这里开始的日志
+};
+
+/* 检查点时的脏页，页面上recLSN之前的修改都已经在磁盘上 */
+struct CheckpointPage {
+    int table_id;
+    page_id_t page_no;
+    lsn_t rec_lsn;
+};
+
+/* 检查点结束的日志记录，保存fuzzy checkpoint期间读取的ATT和DPT，
+   以及打开之后修改过的表(它们的文件头和索引只在关闭时写回，崩溃后需要重建) */
+class CheckpointEndLogRecord: public LogRecord {
+public:
+    CheckpointEndLogRecord() {
+        log_type_ = LogType::CHECKPOINT_END;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = OFFSET_CHECKPOINT_DATA;
+        log_tid_ = INVALID_TXN_ID;
+        prev_lsn_ = INVALID_LSN;
+    }
+    CheckpointEndLogRecord(lsn_t begin_lsn, std::vector<CheckpointTxn> active_txns,
+                           std::vector<CheckpointPage> dirty_pages, std::vector<int> tables)
+        : CheckpointEndLogRecord() {
+        begin_lsn_ = begin_lsn;
+        active_txns_ = std::move(active_txns);
+        dirty_pages_ = std::move(dirty_pages);
+        tables_ = std::move(tables);
+        log_tot_len_ += active_txns_.size() * sizeof(CheckpointTxn) + dirty_pages_.size() * sizeof(CheckpointPage) +
+                        tables_.size() * sizeof(int);
     }
 
-    // 把insert日志记录序列化到dest中
     void serialize(char* dest) const override {
         LogRecord::serialize(dest);
-        int offset = OFFSET_LOG_DATA;
-        memcpy(dest + offset, &insert_value_.size, sizeof(int));
-        offset += sizeof(int);
-        memcpy(dest + offset, insert_value_.data, insert_value_.size);
-        offset += insert_value_.size;
-        memcpy(dest + offset, &rid_, sizeof(Rid));
-        offset += sizeof(Rid);
-        memcpy(dest + offset, &table_name_size_, sizeof(size_t));
-        offset += sizeof(size_t);
-        memcpy(dest + offset, table_name_, table_name_size_);
-    }
-    // 从src中反序列化出一条Insert日志记录
+        uint32_t counts[3] = {static_cast<uint32_t>(active_txns_.size()), static_cast<uint32_t>(dirty_pages_.size()),
+                              static_cast<uint32_t>(tables_.size())};
+        memcpy(dest + OFFSET_LOG_DATA, &begin_lsn_, sizeof(lsn_t));
+        memcpy(dest + OFFSET_LOG_DATA + sizeof(lsn_t), counts, sizeof(counts));
+        char* pos = dest + OFFSET_CHECKPOINT_DATA;
+        pos = write_array(pos, active_txns_);
+        pos = write_array(pos, dirty_pages_);
+        write_array(pos, tables_);
+    }
     void deserialize(const char* src) override {
-        LogRecord::deserialize(src);  
-        insert_value_.Deserialize(src + OFFSET_LOG_DATA);
-        int offset = OFFSET_LOG_DATA + insert_value_.size + sizeof(int);
-        rid_ = *reinterpret_cast<const Rid*>(src + offset);
-        offset += sizeof(Rid);
-        table_name_size_ = *reinterpret_cast<const size_t*>(src + offset);
-        offset += sizeof(size_t);
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, src + offset, table_name_size_);
+        LogRecord::deserialize(src);
+        uint32_t counts[3];
+        memcpy(&begin_lsn_, src + OFFSET_LOG_DATA, sizeof(lsn_t));
+        memcpy(counts, src + OFFSET_LOG_DATA + sizeof(lsn_t), sizeof(counts));
+        const char* pos = src + OFFSET_CHECKPOINT_DATA;
+        pos = read_array(pos, counts[0], &active_txns_);
+        pos = read_array(pos, counts[1], &dirty_pages_);
+        read_array(pos, counts[2], &tables_);
     }
     void format_print() override {
-        printf("insert record\n");
+        printf("checkpoint end record\n");
         LogRecord::format_print();
-        printf("insert_value: %s\n", insert_value_.data);
-        printf("insert rid: %d, %d\n", rid_.page_no, rid_.slot_no);
-        printf("table name: %s\n", table_name_);
+        printf("begin_lsn: %d, active txns: %zu, dirty pages: %zu\n", begin_lsn_, active_txns_.size(),
+               dirty_pages_.size());
     }
 
-    RmRecord insert_value_;     // 插入的记录
-    Rid rid_;                   // 记录插入的位置
-    char* table_name_;          // 插入记录的表名称
-    size_t table_name_size_;    // 表名称的大小
+    lsn_t begin_lsn_ = INVALID_LSN;             // 对应的检查点开始记录
+    std::vector<CheckpointTxn> active_txns_;    // ATT
+    std::vector<CheckpointPage> dirty_pages_;   // DPT
+    std::vector<int> tables_;                   // 打开之后修改过的表
+
+private:
+    static constexpr int OFFSET_CHECKPOINT_DATA = OFFSET_LOG_DATA + sizeof(lsn_t) + 3 * sizeof(uint32_t);
+
+    template <typename T>
+    static char* write_array(char* dest, const std::vector<T>& items) {
+        memcpy(dest, items.data(), items.size() * sizeof(T));
+        return dest + items.size() * sizeof(T);
+    }
+    template <typename T>
+    static const char* read_array(const char* src, uint32_t count, std::vector<T>* items) {
+        items->resize(count);
+        memcpy(items->data(), src, count * sizeof(T));
+        return src + count * sizeof(T);
+    }
 };
 
-/**
- * TODO: delete操作的日志记录
-*/
-class DeleteLogRecord: public LogRecord {
+/* 修改表中一条记录的日志记录的公共部分，采用物理到页面、页内逻辑(physiological)的格式
+   表用数值编号table_id_表示，rid_.page_no与表一起确定被修改的页面，重做时只需要读取这一个页面，
+   并用页面上的page_lsn判断修改是否已经在页面上 */
+class PageLogRecord: public LogRecord {
+public:
+    int table_id_ = -1;         // 表的编号，见TabMeta::id
+    Rid rid_{};                 // 被修改的记录的位置
+
+    // 日志修改的页面，fd为table_id_对应的表文件
+    PageId page_id(int fd) const { return PageId{fd, rid_.page_no}; }
+
+    void serialize(char* dest) const override {
+        LogRecord::serialize(dest);
+        memcpy(dest + OFFSET_LOG_DATA, &table_id_, sizeof(int));
+        memcpy(dest + OFFSET_LOG_DATA + sizeof(int), &rid_, sizeof(Rid));
+    }
+    void deserialize(const char* src) override {
+        LogRecord::deserialize(src);
+        table_id_ = *reinterpret_cast<const int*>(src + OFFSET_LOG_DATA);
+        rid_ = *reinterpret_cast<const Rid*>(src + OFFSET_LOG_DATA + sizeof(int));
+    }
+    void format_print() override {
+        LogRecord::format_print();
+        printf("table id: %d\n", table_id_);
+        printf("rid: %d, %d\n", rid_.page_no, rid_.slot_no);
+    }
+
+protected:
+    static constexpr int OFFSET_PAGE_LOG_DATA = OFFSET_LOG_DATA + sizeof(int) + sizeof(Rid);
+
+    void init(LogType log_type, txn_id_t txn_id, int table_id, const Rid& rid) {
+        log_type_ = log_type;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = OFFSET_PAGE_LOG_DATA;
+        log_tid_ = txn_id;
+        prev_lsn_ = INVALID_LSN;
+        table_id_ = table_id;
+        rid_ = rid;
+    }
+};
+
+/* 带有一条完整记录镜像的日志记录：insert记录插入后的记录，delete记录删除前的记录
+   data_不拥有数据：构造时指向调用者的记录，反序列化后指向日志缓冲区，只在它们有效期间使用 */
+class RecordImageLogRecord: public PageLogRecord {
+public:
+    uint16_t size_ = 0;             // 记录的长度
+    const char* data_ = nullptr;    // 记录的数据
 
+    void serialize(char* dest) const override {
+        PageLogRecord::serialize(dest);
+        memcpy(dest + OFFSET_PAGE_LOG_DATA, &size_, sizeof(uint16_t));
+        memcpy(dest + OFFSET_PAGE_LOG_DATA + sizeof(uint16_t), data_, size_);
+    }
+    void deserialize(const char* src) override {
+        PageLogRecord::deserialize(src);
+        size_ = *reinterpret_cast<const uint16_t*>(src + OFFSET_PAGE_LOG_DATA);
+        data_ = src + OFFSET_PAGE_LOG_DATA + sizeof(uint16_t);
+    }
+
+protected:
+    void init(LogType log_type, txn_id_t txn_id, int table_id, const Rid& rid, const char* data, int size) {
+        PageLogRecord::init(log_type, txn_id, table_id, rid);
+        size_ = static_cast<uint16_t>(size);
+        data_ = data;
+        log_tot_len_ += sizeof(uint16_t) + size_;
+    }
 };
 
-/**
- * TODO: update操作的日志记录
-*/
-class UpdateLogRecord: public LogRecord {
+/* insert操作的日志记录 */
+class InsertLogRecord: public RecordImageLogRecord {
+public:
+    InsertLogRecord() { init(LogType::INSERT, INVALID_TXN_ID, -1, Rid{}, nullptr, 0); }
+    InsertLogRecord(txn_id_t txn_id, int table_id, const Rid& rid, const char* data, int size) {
+        init(LogType::INSERT, txn_id, table_id, rid, data, size);
+    }
+    void format_print() override {
+        printf("insert record\n");
+        PageLogRecord::format_print();
+    }
+};
+
+/* delete操作的日志记录 */
+class DeleteLogRecord: public RecordImageLogRecord {
+public:
+    DeleteLogRecord() { init(LogType::DELETE, INVALID_TXN_ID, -1, Rid{}, nullptr, 0); }
+    DeleteLogRecord(txn_id_t txn_id, int table_id, const Rid& rid, const char* data, int size) {
+        init(LogType::DELETE, txn_id, table_id, rid, data, size);
+    }
+    void format_print() override {
+        printf("delete record\n");
+        PageLogRecord::format_print();
+    }
+};
+
+/* update操作的日志记录，只记录新旧记录中不同的字节区间
+   diffs_中依次存放每个区间的偏移(uint16)、长度(uint16)、旧数据和新数据，
+   相距不超过DIFF_MERGE_GAP字节的区间合并为一个，省去一个区间头 */
+class UpdateLogRecord: public PageLogRecord {
+public:
+    static constexpr int DIFF_MERGE_GAP = 2 * sizeof(uint16_t);
+
+    UpdateLogRecord() { init(LogType::UPDATE, INVALID_TXN_ID, -1, Rid{}); }
+    UpdateLogRecord(txn_id_t txn_id, int table_id, const Rid& rid, const char* old_data, const char* new_data,
+                    int size) {
+        init(LogType::UPDATE, txn_id, table_id, rid);
+        int pos = 0;
+        while (pos < size) {
+            if (old_data[pos] == new_data[pos]) {
+                pos++;
+                continue;
+            }
+            int begin = pos;
+            int end = pos + 1;    // 区间中最后一个不同字节之后的位置
+            for (pos = end; pos < size && pos - end <= DIFF_MERGE_GAP; pos++) {
+                if (old_data[pos] != new_data[pos]) {
+                    end = pos + 1;
+                }
+            }
+            add_diff(begin, end - begin, old_data + begin, new_data + begin);
+            pos = end;
+        }
+        log_tot_len_ += sizeof(uint16_t) + diffs_.size();
+    }
 
+    // 把新数据写入slot
+    void redo(char* slot) const { apply(slot, true); }
+    // 把旧数据写回slot
+    void undo(char* slot) const { apply(slot, false); }
+
+    void serialize(char* dest) const override {
+        PageLogRecord::serialize(dest);
+        memcpy(dest + OFFSET_PAGE_LOG_DATA, &num_diffs_, sizeof(uint16_t));
+        memcpy(dest + OFFSET_PAGE_LOG_DATA + sizeof(uint16_t), diffs_.data(), diffs_.size());
+    }
+    void deserialize(const char* src) override {
+        PageLogRecord::deserialize(src);
+        num_diffs_ = *reinterpret_cast<const uint16_t*>(src + OFFSET_PAGE_LOG_DATA);
+        const char* begin = src + OFFSET_PAGE_LOG_DATA + sizeof(uint16_t);
+        diffs_.assign(begin, src + log_tot_len_);
+    }
+    void format_print() override {
+        printf("update record\n");
+        PageLogRecord::format_print();
+        printf("changed ranges: %d\n", num_diffs_);
+    }
+
+    uint16_t num_diffs_ = 0;    // 不同的字节区间的个数
+    std::vector<char> diffs_;   // 每个区间的偏移、长度、旧数据、新数据
+
+private:
+    void add_diff(int offset, int len, const char* old_data, const char* new_data) {
+        uint16_t header[2] = {static_cast<uint16_t>(offset), static_cast<uint16_t>(len)};
+        diffs_.insert(diffs_.end(), reinterpret_cast<const char*>(header),
+                      reinterpret_cast<const char*>(header) + sizeof(header));
+        diffs_.insert(diffs_.end(), old_data, old_data + len);
+        diffs_.insert(diffs_.end(), new_data, new_data + len);
+        num_diffs_++;
+    }
+
+    void apply(char* slot, bool is_redo) const {
+        const char* pos = diffs_.data();
+        for (int i = 0; i < num_diffs_; i++) {
+            uint16_t header[2];
+            memcpy(header, pos, sizeof(header));
+            pos += sizeof(header);
+            memcpy(slot + header[0], is_redo ? pos + header[1] : pos, header[1]);
+            pos += 2 * header[1];
+        }
+    }
 };
 
-/* 日志缓冲区，只有一个buffer，因此需要阻塞地去把日志写入缓冲区中 */
+/* 日志缓冲区。LogManager轮流使用两个缓冲区，一个接收新的日志时另一个被写入磁盘 */
 
 class LogBuffer {
 public:
     LogBuffer() { 
-        offset_ = 0; 
         memset(buffer_, 0, sizeof(buffer_));
     }
 
-    bool is_full(int append_size) {
-        if(offset_ + append_size > LOG_BUFFER_SIZE)
-            return true;
-        return false;
-    }
-
     char buffer_[LOG_BUFFER_SIZE+1];
-    int offset_;    // 写入log的offset
+    std::atomic<uint32_t> filled_{0};   // 已经序列化完成的字节数，等于size_时缓冲区可以写入磁盘
+    uint32_t size_ = 0;                 // 封存时缓冲区中日志的总长度
+    lsn_t last_lsn_ = INVALID_LSN;      // 封存时缓冲区中最后一条日志的lsn
 };
 
-/* 日志管理器，负责把日志写入日志缓冲区，以及把日志缓冲区中的内容写入磁盘中 */
+class Transaction;
+
+/*
+日志管理器，负责把日志写入日志缓冲区，以及把日志缓冲区中的内容写入磁盘中(group commit)
+1. 两个缓冲区轮流使用。reserve_把下一个lsn、当前缓冲区的编号和它的写入位置放在一个64位整数中，
+   写入者用一次fetch_add同时得到自己的lsn和缓冲区中互不重叠的空间，之后不持有latch_地序列化日志，完成后累加filled_
+2. fetch_add越过缓冲区末尾的写入者恰好有一个，它在latch_下等待另一个缓冲区写完，封存当前缓冲区并切换reserve_，
+   之后的写入者放弃得到的lsn，等待切换完成后重试，因此写入日志文件的lsn是连续的
+3. 提交的事务写入commit记录后在wait_for_persist()中登记自己的lsn并等待，不自己刷盘
+4. 后台的flusher线程被等待者唤醒，或每隔log_timeout醒来，封存当前缓冲区(切换到另一个缓冲区)，
+   等它的写入者全部完成后不持有latch_地写入日志文件并fsync，再推进persist_lsn_，唤醒所有lsn不超过它的等待者。
+   flusher写盘和fsync期间提交的事务积累在另一个缓冲区中，由下一次fsync一起持久化
+5. 写过日志的事务从begin记录到commit/abort记录之间登记在active_txns_中，检查点据此得到ATT；
+   检查点之后truncate_log()丢弃不再需要的日志，日志文件的替换与flusher的写盘用file_latch_互斥
+*/
 class LogManager {
 public:
-    LogManager(DiskManager* disk_manager) { disk_manager_ = disk_manager; }
+    LogManager(DiskManager* disk_manager);
+
+    ~LogManager();
     
     lsn_t add_log_to_buffer(LogRecord* log_record);
+
+    lsn_t append_txn_log(Transaction* txn, LogRecord* log_record);
+
+    void wait_for_persist(lsn_t lsn);
+
     void flush_log_to_disk();
 
-    LogBuffer* get_log_buffer() { return &log_buffer_; }
+    lsn_t get_persist_lsn();
+
+    void set_next_lsn(lsn_t lsn);
+
+    std::vector<CheckpointTxn> get_active_txns();
+
+    void add_active_txn(txn_id_t txn_id, lsn_t first_lsn);
+
+    void truncate_log(lsn_t lsn);
 
 private:    
-    std::atomic<lsn_t> global_lsn_{0};  // 全局lsn，递增，用于为每条记录分发lsn
-    std::mutex latch_;                  // 用于对log_buffer_的互斥访问
-    LogBuffer log_buffer_;              // 日志缓冲区
-    lsn_t persist_lsn_;                 // 记录已经持久化到磁盘中的最后一条日志的日志号
+    static constexpr int OFFSET_BITS = 31;
+    static constexpr uint64_t OFFSET_MASK = (1ull << OFFSET_BITS) - 1;
+
+    static lsn_t reserved_lsn(uint64_t reserve) { return static_cast<lsn_t>(reserve >> 32); }
+    static int reserved_buffer(uint64_t reserve) { return static_cast<int>((reserve >> OFFSET_BITS) & 1); }
+    static uint32_t reserved_offset(uint64_t reserve) { return static_cast<uint32_t>(reserve & OFFSET_MASK); }
+    static uint64_t make_reserve(lsn_t lsn, int buffer) {
+        return (static_cast<uint64_t>(lsn) << 32) | (static_cast<uint64_t>(buffer) << OFFSET_BITS);
+    }
+
+    void rotate(std::unique_lock<std::mutex>& lock, int buffer, uint32_t size, lsn_t next_lsn);
+
+    bool seal_active();
+
+    void run_flusher();
+
+    std::atomic<uint64_t> reserve_{0};  // 下一个lsn(高32位)|当前缓冲区编号(1位)|当前缓冲区的写入位置(31位)
+    std::unique_ptr<LogBuffer[]> buffers_;  // 两个轮流使用的日志缓冲区
+    std::mutex latch_;                  // 用于缓冲区切换及以下状态的互斥访问
+    int sealed_buffer_ = -1;            // 已封存、等待写入磁盘的缓冲区，没有时为-1
+    lsn_t persist_lsn_ = INVALID_LSN;   // 记录已经持久化到磁盘中的最后一条日志的日志号
+    lsn_t request_lsn_ = INVALID_LSN;   // 等待者需要持久化的最大lsn
+    std::condition_variable flush_cv_;  // 有等待者、缓冲区被封存或需要停止时唤醒flusher
+    std::condition_variable persist_cv_;    // persist_lsn_推进时唤醒等待者
+    std::condition_variable rotate_cv_; // 缓冲区切换或写完时唤醒等待的写入者
+    bool stop_flusher_ = false;
+    std::thread flusher_;
+    std::mutex txn_latch_;              // 用于active_txns_
+    std::unordered_map<txn_id_t, lsn_t> active_txns_;  // 写过日志、尚未结束的事务 -> 它的第一条日志
+    std::mutex file_latch_;             // 日志文件的写盘、fsync与截断互斥
     DiskManager* disk_manager_;
-}; 
+};
@@ -1,22 +1,571 @@
 #include "log_recovery.h"
 
+#include <algorithm>
+
+#include "common/thread_pool.h"
+#include "transaction/transaction.h"
+
+namespace {
+
+// 按照日志类型创建对应的日志记录，类型不合法时返回nullptr
+std::unique_ptr<LogRecord> make_log_record(LogType log_type) {
+    switch (log_type) {
+        case LogType::begin:
+            return std::make_unique<BeginLogRecord>();
+        case LogType::commit:
+            return std::make_unique<CommitLogRecord>();
+        case LogType::ABORT:
+            return std::make_unique<AbortLogRecord>();
+        case LogType::INSERT:
+            return std::make_unique<InsertLogRecord>();
+        case LogType::DELETE:
+            return std::make_unique<DeleteLogRecord>();
+        case LogType::UPDATE:
+            return std::make_unique<UpdateLogRecord>();
+        case LogType::CHECKPOINT_BEGIN:
+            return std::make_unique<CheckpointBeginLogRecord>();
+        case LogType::CHECKPOINT_END:
+            return std::make_unique<CheckpointEndLogRecord>();
+        default:
+            return nullptr;
+    }
+}
+
+}  // namespace
+
+RecoveryManager::~RecoveryManager() {
+    if (undo_thread_.joinable()) {
+        undo_thread_.join();
+    }
+}
+
 /**
  * @description: analyze阶段，需要获得脏页表（DPT）和未完成的事务列表（ATT）
  */
 void RecoveryManager::analyze() {
- 
+    int file_size = disk_manager_->get_file_size(LOG_FILE_NAME);
+    if (file_size <= 0) {
+        return;
+    }
+    lsn_t master_lsn = disk_manager_->read_master_record();
+    log_data_.resize(file_size);
+    disk_manager_->read_log(log_data_.data(), file_size, 0);
+
+    int offset = 0;
+    lsn_t max_lsn = INVALID_LSN;
+    while (offset + LOG_HEADER_SIZE <= file_size) {
+        const char* src = log_data_.data() + offset;
+        LogRecord header;
+        header.deserialize(src);
+        auto log_record = make_log_record(header.log_type_);
+        // 崩溃时只写入了一部分的记录
+        if (log_record == nullptr || header.log_tot_len_ < LOG_HEADER_SIZE ||
+            header.log_tot_len_ > static_cast<uint32_t>(file_size - offset)) {
+            break;
+        }
+        log_record->deserialize(src);
+        offset += log_record->log_tot_len_;
+        max_lsn = std::max(max_lsn, log_record->lsn_);
+
+        txn_id_t txn_id = log_record->log_tid_;
+        max_txn_id_ = std::max(max_txn_id_, txn_id);
+        switch (log_record->log_type_) {
+            case LogType::begin:
+                active_txns_[txn_id] = ActiveTxn();
+                active_txns_[txn_id].first_lsn = log_record->lsn_;
+                active_txns_[txn_id].last_lsn = log_record->lsn_;
+                break;
+            case LogType::commit:
+            case LogType::ABORT:
+                active_txns_.erase(txn_id);
+                break;
+            case LogType::CHECKPOINT_BEGIN:
+                break;
+            case LogType::CHECKPOINT_END: {
+                auto end_log = static_cast<CheckpointEndLogRecord*>(log_record.get());
+                if (end_log->begin_lsn_ == master_lsn) {
+                    load_checkpoint(end_log);
+                }
+                break;
+            }
+            default: {
+                auto page_log = static_cast<PageLogRecord*>(log_record.get());
+                auto& txn = active_txns_[txn_id];
+                if (txn.first_lsn == INVALID_LSN) {
+                    txn.first_lsn = page_log->lsn_;
+                }
+                txn.last_lsn = page_log->lsn_;
+                txn.page_logs.push_back(page_log);
+                rebuild_tables_.insert(page_log->table_id_);
+                break;
+            }
+        }
+        log_records_.push_back(std::move(log_record));
+    }
+    if (offset < file_size) {
+        disk_manager_->truncate_log(offset);
+    }
+    for (auto& log_record : log_records_) {
+        if (log_record->log_type_ == LogType::INSERT || log_record->log_type_ == LogType::DELETE ||
+            log_record->log_type_ == LogType::UPDATE) {
+            auto page_log = static_cast<PageLogRecord*>(log_record.get());
+            if (need_redo(page_log)) {
+                dirty_pages_.emplace(RecoveryPageId{page_log->table_id_, page_log->rid_.page_no}, page_log->lsn_);
+            }
+        }
+    }
+    if (log_manager_ != nullptr && max_lsn != INVALID_LSN) {
+        log_manager_->set_next_lsn(max_lsn + 1);
+    }
+}
+
+// 读取master record指向的检查点的ATT、DPT和打开之后修改过的表
+void RecoveryManager::load_checkpoint(const CheckpointEndLogRecord* log_record) {
+    checkpoint_lsn_ = log_record->begin_lsn_;
+    for (auto& txn : log_record->active_txns_) {
+        checkpoint_txns_.insert(txn.txn_id);
+    }
+    for (auto& page : log_record->dirty_pages_) {
+        checkpoint_pages_.emplace(RecoveryPageId{page.table_id, page.page_no}, page.rec_lsn);
+    }
+    rebuild_tables_.insert(log_record->tables_.begin(), log_record->tables_.end());
+}
+
+// 日志记录的修改是否可能不在磁盘上。检查点开始之前的修改，只有检查点时尚未结束的事务的修改和
+// 检查点时的脏页上recLSN之后的修改可能不在磁盘上
+bool RecoveryManager::need_redo(const PageLogRecord* log_record) const {
+    if (checkpoint_lsn_ == INVALID_LSN || log_record->lsn_ > checkpoint_lsn_ ||
+        checkpoint_txns_.count(log_record->log_tid_) > 0) {
+        return true;
+    }
+    auto it = checkpoint_pages_.find(RecoveryPageId{log_record->table_id_, log_record->rid_.page_no});
+    if (it == checkpoint_pages_.end()) {
+        // LSM表没有数据页，检查点把memtable的recLSN记在文件头页上
+        it = checkpoint_pages_.find(RecoveryPageId{log_record->table_id_, RM_FILE_HDR_PAGE});
+    }
+    return it != checkpoint_pages_.end() && log_record->lsn_ >= it->second;
 }
 
 /**
  * @description: 重做所有未落盘的操作
  */
 void RecoveryManager::redo() {
+    // 文件头只在关闭时写回，先按文件大小修正页面数，避免下面扩展文件时覆盖崩溃前已经写回的新页面
+    for (int table_id : rebuild_tables_) {
+        RmFileHandle* fh = get_table_file(table_id);
+        if (fh != nullptr) {
+            fh->recover_num_pages();
+        }
+    }
+    // 单线程把表文件扩展到日志中出现的最大页面，之后每个线程只修改分给它的页面
+    std::unordered_map<int, page_id_t> max_pages;
+    for (auto& entry : dirty_pages_) {
+        auto& max_page = max_pages.emplace(entry.first.table_id, entry.first.page_no).first->second;
+        max_page = std::max(max_page, entry.first.page_no);
+    }
+    for (auto& entry : max_pages) {
+        RmFileHandle* fh = get_table_file(entry.first);
+        while (fh != nullptr && fh->lsm_ == nullptr && fh->file_hdr_.num_pages <= entry.second) {
+            RmPageHandle page_handle = fh->create_new_page_handle();
+            buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), true);
+        }
+    }
+
+    size_t num_threads = RECOVERY_REDO_THREADS != 0 ? RECOVERY_REDO_THREADS
+                                                    : std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::max<size_t>(std::min(num_threads, dirty_pages_.size()), 1);
+    std::vector<std::vector<PageLogRecord*>> partitions(num_threads);
+    RecoveryPageIdHash hash;
+    for (auto& log_record : log_records_) {
+        if (log_record->log_type_ != LogType::INSERT && log_record->log_type_ != LogType::DELETE &&
+            log_record->log_type_ != LogType::UPDATE) {
+            continue;
+        }
+        auto page_log = static_cast<PageLogRecord*>(log_record.get());
+        RecoveryPageId page_id{page_log->table_id_, page_log->rid_.page_no};
+        auto it = dirty_pages_.find(page_id);
+        if (it != dirty_pages_.end() && page_log->lsn_ >= it->second) {
+            partitions[hash(page_id) % num_threads].push_back(page_log);
+        }
+    }
 
+    std::mutex error_latch;
+    std::exception_ptr error;
+    {
+        ThreadPool pool(num_threads);
+        for (auto& partition : partitions) {
+            pool.submit([this, &partition, &error_latch, &error] {
+                try {
+                    for (PageLogRecord* page_log : partition) {
+                        if (redo_page_log(page_log)) {
+                            num_redone_++;
+                        }
+                    }
+                } catch (...) {
+                    std::scoped_lock lock{error_latch};
+                    error = std::current_exception();
+                }
+            });
+        }
+    }
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+
+    for (int table_id : rebuild_tables_) {
+        RmFileHandle* fh = get_table_file(table_id);
+        if (fh != nullptr) {
+            fh->rebuild_free_space();
+            sm_manager_->rebuild_indexes(sm_manager_->db_.get_table_by_id(table_id)->name);
+        }
+    }
 }
 
 /**
- * @description: 回滚未完成的事务
+ * @description: 回滚未完成的事务。撤销在后台线程中进行，返回时失败事务修改过的表已经登记在undo_tables_中
  */
 void RecoveryManager::undo() {
+    std::vector<PageLogRecord*> page_logs;
+    for (auto& entry : active_txns_) {
+        // 撤销完成之前检查点不能丢弃失败事务的日志
+        if (log_manager_ != nullptr) {
+            log_manager_->add_active_txn(entry.first, entry.second.first_lsn);
+        }
+        for (PageLogRecord* page_log : entry.second.page_logs) {
+            TabMeta* tab = sm_manager_->db_.get_table_by_id(page_log->table_id_);
+            if (tab != nullptr) {
+                undo_tables_.insert(tab->name);
+            }
+            page_logs.push_back(page_log);
+        }
+    }
+    if (active_txns_.empty()) {
+        log_records_.clear();
+        log_data_ = std::vector<char>();
+        return;
+    }
+    std::sort(page_logs.begin(), page_logs.end(),
+              [](const PageLogRecord* x, const PageLogRecord* y) { return x->lsn_ > y->lsn_; });
+    undo_done_ = false;
+    undo_thread_ = std::thread(&RecoveryManager::run_undo, this, std::move(page_logs));
+}
+
+/**
+ * @description: 做一次fuzzy checkpoint。写入检查点开始记录后依次读取ATT和DPT，期间事务和刷脏照常进行；
+ *               结束记录持久化后更新master record，再丢弃恢复不再需要的日志。
+ *               DPT太大、结束记录放不进日志缓冲区时放弃本次检查点
+ */
+void RecoveryManager::checkpoint() {
+    if (log_manager_ == nullptr) {
+        return;
+    }
+    CheckpointBeginLogRecord begin_log;
+    lsn_t begin_lsn = log_manager_->add_log_to_buffer(&begin_log);
+    // ATT在DPT之前读取：读取DPT时修改了页面、还没有推进rec_lsn的事务要么在ATT中，要么在检查点开始之后才开始
+    std::vector<CheckpointTxn> active_txns = log_manager_->get_active_txns();
+    std::unordered_map<int, int> fd_tables;     // 表的数据文件 -> 表的编号
+    std::vector<int> tables;
+    // 没有打开过的表在缓冲池中没有脏页，也没有写过日志
+    std::vector<CheckpointPage> dirty_pages;
+    for (auto* table : sm_manager_->get_open_tables()) {
+        fd_tables.emplace(table->fh->GetFd(), table->tab->id);
+        if (table->fh->has_logged_changes()) {
+            tables.push_back(table->tab->id);
+        }
+        // LSM表memtable中的修改只在日志中，像脏页一样记录它们的recLSN
+        lsn_t rec_lsn = table->fh->memtable_rec_lsn();
+        if (rec_lsn != INVALID_LSN) {
+            dirty_pages.push_back(CheckpointPage{table->tab->id, RM_FILE_HDR_PAGE, rec_lsn});
+        }
+    }
+    for (auto& entry : buffer_pool_manager_->get_dirty_pages()) {
+        auto it = fd_tables.find(entry.first.fd);
+        if (it != fd_tables.end()) {
+            dirty_pages.push_back(CheckpointPage{it->second, entry.first.page_no, entry.second});
+        }
+    }
+
+    CheckpointEndLogRecord end_log(begin_lsn, std::move(active_txns), std::move(dirty_pages), std::move(tables));
+    if (end_log.log_tot_len_ > static_cast<uint32_t>(LOG_BUFFER_SIZE)) {
+        return;
+    }
+    log_manager_->wait_for_persist(log_manager_->add_log_to_buffer(&end_log));
+    disk_manager_->write_master_record(begin_lsn);
+
+    lsn_t truncate_lsn = begin_lsn;
+    for (auto& txn : end_log.active_txns_) {
+        truncate_lsn = std::min(truncate_lsn, txn.first_lsn);
+    }
+    for (auto& page : end_log.dirty_pages_) {
+        truncate_lsn = std::min(truncate_lsn, page.rec_lsn);
+    }
+    log_manager_->truncate_log(truncate_lsn);
+}
 
-}
\ No newline at end of file
+/**
+ * @description: 等待失败事务对指定表的撤销完成。tab_names为空时等待所有撤销完成，用于DDL等不指明表的语句
+ * @param {vector<string>&} tab_names 语句访问的表
+ */
+void RecoveryManager::wait_for_undo(const std::vector<std::string>& tab_names) {
+    if (undo_done_.load()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock{undo_latch_};
+    undo_cv_.wait(lock, [this, &tab_names] {
+        if (undo_done_.load()) {
+            return true;
+        }
+        if (tab_names.empty()) {
+            return false;
+        }
+        return std::none_of(tab_names.begin(), tab_names.end(),
+                            [this](const std::string& tab_name) { return undo_tables_.count(tab_name) > 0; });
+    });
+}
+
+/**
+ * @description: 在日志记录修改的页面上重做它，只访问这一个页面。页面的page_lsn不小于日志的lsn时修改已经在页面上，跳过
+ *               只修改页面本身，文件头中的空闲空间信息由redo()在重做完成后重建，因此不同线程可以并发重做同一张表的不同页面
+ * @return {bool} 是否重做了该日志，表已经被删除或修改已经在页面上时返回false
+ * @param {PageLogRecord*} log_record insert、delete或update日志记录
+ */
+bool RecoveryManager::redo_page_log(PageLogRecord* log_record) {
+    RmFileHandle* fh = get_table_file(log_record->table_id_);
+    if (fh == nullptr) {
+        return false;
+    }
+    if (fh->lsm_ != nullptr) {
+        return redo_lsm_log(fh, log_record);
+    }
+    const Rid& rid = log_record->rid_;
+    RmPageHandle page_handle = fh->fetch_page_handle(rid.page_no);
+    Page* page = page_handle.page;
+    if (page->get_page_lsn() >= log_record->lsn_) {
+        buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+        return false;
+    }
+    // 页面恢复到了日志之前的状态，页内的空间分配是确定的，原来放得下的记录重做时同样放得下
+    switch (log_record->log_type_) {
+        case LogType::INSERT: {
+            auto insert_log = static_cast<InsertLogRecord*>(log_record);
+            if (page_handle.is_record(rid.slot_no)) {
+                page_handle.update(rid.slot_no, insert_log->data_);
+            } else {
+                page_handle.insert(rid.slot_no, insert_log->data_);
+            }
+            break;
+        }
+        case LogType::DELETE: {
+            if (page_handle.is_record(rid.slot_no)) {
+                page_handle.erase(rid.slot_no);
+            }
+            break;
+        }
+        case LogType::UPDATE: {
+            if (page_handle.is_record(rid.slot_no)) {
+                std::vector<char> record(fh->get_file_hdr().record_size);
+                const char* data = page_handle.get_record(rid.slot_no, record.data());
+                if (data != record.data()) {
+                    memcpy(record.data(), data, record.size());
+                }
+                static_cast<UpdateLogRecord*>(log_record)->redo(record.data());
+                page_handle.update(rid.slot_no, record.data());
+            }
+            break;
+        }
+        default:
+            buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+            throw InternalError("RecoveryManager::redo_page_log: not a page log record");
+    }
+    page->set_page_lsn(log_record->lsn_);
+    page->update_rec_lsn(log_record->lsn_);
+    buffer_pool_manager_->unpin_page(page->get_page_id(), true);
+    return true;
+}
+
+/**
+ * @description: 在LSM表上重做一条日志。LSM表没有page_lsn，无法判断修改是否已经在sorted run中，
+ *               因此按lsn顺序无条件重放：插入和删除写入完整的记录或删除标记，更新只覆盖改变的字节，
+ *               重放已经生效的日志结果不变。同一行的日志都在同一个分区中，按lsn顺序重放
+ * @return {bool} 是否重做了该日志
+ * @param {RmFileHandle*} fh LSM表的数据文件
+ * @param {PageLogRecord*} log_record insert、delete或update日志记录
+ */
+bool RecoveryManager::redo_lsm_log(RmFileHandle* fh, PageLogRecord* log_record) {
+    RmLsmTree* lsm = fh->lsm_.get();
+    uint64_t key = fh->lsm_key(log_record->rid_);
+    switch (log_record->log_type_) {
+        case LogType::INSERT:
+            lsm->put(key, static_cast<InsertLogRecord*>(log_record)->data_);
+            break;
+        case LogType::DELETE:
+            lsm->put(key, nullptr);
+            break;
+        case LogType::UPDATE: {
+            std::vector<char> record(fh->get_file_hdr().record_size);
+            if (!lsm->get(key, record.data())) {
+                return false;
+            }
+            static_cast<UpdateLogRecord*>(log_record)->redo(record.data());
+            lsm->put(key, record.data());
+            break;
+        }
+        default:
+            throw InternalError("RecoveryManager::redo_lsm_log: not a page log record");
+    }
+    // 重做的修改在memtable中，下一个检查点仍然需要保留这些日志
+    lsm->note_lsn(log_record->lsn_);
+    return true;
+}
+
+// 后台撤销线程，page_logs按lsn递减
+void RecoveryManager::run_undo(std::vector<PageLogRecord*> page_logs) {
+    try {
+        std::map<txn_id_t, std::unique_ptr<Transaction>> txns;
+        for (auto& entry : active_txns_) {
+            auto txn = std::make_unique<Transaction>(entry.first);
+            txn->set_prev_lsn(entry.second.last_lsn);
+            txns.emplace(entry.first, std::move(txn));
+        }
+        for (PageLogRecord* page_log : page_logs) {
+            undo_page_log(txns.at(page_log->log_tid_).get(), page_log);
+        }
+        for (auto& entry : txns) {
+            AbortLogRecord abort_log(entry.first);
+            append_log(entry.second.get(), &abort_log);
+        }
+        if (log_manager_ != nullptr) {
+            log_manager_->flush_log_to_disk();
+        }
+    } catch (UniBaseError& e) {
+        std::cerr << "undo failed: " << e.what() << std::endl;
+    }
+    active_txns_.clear();
+    log_records_.clear();
+    log_data_ = std::vector<char>();
+    {
+        std::scoped_lock lock{undo_latch_};
+        undo_tables_.clear();
+        undo_done_ = true;
+    }
+    undo_cv_.notify_all();
+}
+
+/**
+ * @description: 撤销一条修改页面的日志。撤销按照记录(而不是页面)进行，同时维护索引和统计信息，并写入对应的日志，
+ *               再次崩溃时这些日志和原来的日志一起被撤销，结果仍然是事务开始之前的状态
+ */
+void RecoveryManager::undo_page_log(Transaction* txn, PageLogRecord* log_record) {
+    RmFileHandle* fh = get_table_file(log_record->table_id_);
+    if (fh == nullptr) {
+        return;
+    }
+    const TabMeta& tab = *sm_manager_->db_.get_table_by_id(log_record->table_id_);
+    const Rid& rid = log_record->rid_;
+    int record_size = fh->get_file_hdr().record_size;
+    lsn_t lsn = INVALID_LSN;
+    switch (log_record->log_type_) {
+        case LogType::INSERT: {
+            if (!fh->is_record(rid)) {
+                return;
+            }
+            auto record = fh->get_record(rid, nullptr);
+            DeleteLogRecord delete_log(txn->get_transaction_id(), tab.id, rid, record->data, record_size);
+            lsn = append_log(txn, &delete_log);
+            update_indexes(tab, rid, record->data, nullptr, txn);
+            sm_manager_->update_stats(tab, record->data, nullptr);
+            fh->delete_record(rid, nullptr);
+            break;
+        }
+        case LogType::DELETE: {
+            if (fh->is_record(rid)) {
+                return;
+            }
+            std::vector<char> record(static_cast<DeleteLogRecord*>(log_record)->data_,
+                                     static_cast<DeleteLogRecord*>(log_record)->data_ + record_size);
+            if (!fh->can_insert_at(rid, record.data())) {
+                // slotted page中原来的空间已经被其他记录占用，插入到其他位置
+                Rid new_rid = fh->insert_record(record.data(), nullptr);
+                InsertLogRecord insert_log(txn->get_transaction_id(), tab.id, new_rid, record.data(), record_size);
+                lsn_t insert_lsn = append_log(txn, &insert_log);
+                if (insert_lsn != INVALID_LSN) {
+                    fh->set_page_lsn(new_rid.page_no, insert_lsn);
+                }
+                update_indexes(tab, new_rid, nullptr, record.data(), txn);
+                sm_manager_->update_stats(tab, nullptr, record.data());
+                return;
+            }
+            InsertLogRecord insert_log(txn->get_transaction_id(), tab.id, rid, record.data(), record_size);
+            lsn = append_log(txn, &insert_log);
+            fh->insert_record(rid, record.data());
+            update_indexes(tab, rid, nullptr, record.data(), txn);
+            sm_manager_->update_stats(tab, nullptr, record.data());
+            break;
+        }
+        case LogType::UPDATE: {
+            auto record = fh->get_record(rid, nullptr);
+            std::vector<char> before(record->data, record->data + record_size);
+            static_cast<UpdateLogRecord*>(log_record)->undo(before.data());
+            UpdateLogRecord update_log(txn->get_transaction_id(), tab.id, rid, record->data, before.data(),
+                                       record_size);
+            lsn = append_log(txn, &update_log);
+            update_indexes(tab, rid, record->data, before.data(), txn);
+            sm_manager_->update_stats(tab, record->data, before.data());
+            fh->update_record(rid, before.data(), nullptr);
+            break;
+        }
+        default:
+            return;
+    }
+    if (lsn != INVALID_LSN) {
+        fh->set_page_lsn(rid.page_no, lsn);
+    }
+}
+
+// 写入撤销产生的日志，没有日志管理器时返回INVALID_LSN
+lsn_t RecoveryManager::append_log(Transaction* txn, LogRecord* log_record) {
+    if (log_manager_ == nullptr) {
+        return INVALID_LSN;
+    }
+    return log_manager_->append_txn_log(txn, log_record);
+}
+
+// 把记录从old_record改为new_record时修改表上的索引，old_record或new_record为nullptr表示插入或删除
+void RecoveryManager::update_indexes(const TabMeta& tab, const Rid& rid, const char* old_record,
+                                     const char* new_record, Transaction* txn) {
+    for (auto& index_handle : sm_manager_->get_table_handle(tab.id).indexes) {
+        const IndexMeta& index = *index_handle.meta;
+        auto make_key = [&index](const char* record) {
+            std::vector<char> key(index.col_tot_len);
+            int offset = 0;
+            for (auto& col : index.cols) {
+                memcpy(key.data() + offset, record + col.offset, col.len);
+                offset += col.len;
+            }
+            return key;
+        };
+        if (old_record != nullptr && new_record != nullptr && make_key(old_record) == make_key(new_record)) {
+            continue;
+        }
+        if (old_record != nullptr) {
+            index_handle.delete_entry(make_key(old_record).data(), txn);
+        }
+        if (new_record != nullptr) {
+            index_handle.insert_entry(make_key(new_record).data(), rid, txn);
+        }
+    }
+}
+
+// 返回编号为table_id的表的数据文件，表已经被删除时返回nullptr
+RmFileHandle* RecoveryManager::get_table_file(int table_id) {
+    auto it = table_files_.find(table_id);
+    if (it != table_files_.end()) {
+        return it->second;
+    }
+    RmFileHandle* fh = nullptr;
+    if (sm_manager_->db_.get_table_by_id(table_id) != nullptr) {
+        fh = sm_manager_->get_table_handle(table_id).fh;
+    }
+    table_files_[table_id] = fh;
+    return fh;
+}
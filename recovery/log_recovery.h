@@ -1,32 +1,121 @@
 #pragma once
 
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include "log_manager.h"
 #include "storage/disk_manager.h"
 #include "system/sm_manager.h"
 
-class RedoLogsInPage {
-public:
-    RedoLogsInPage() { table_file_ = nullptr; }
-    RmFileHandle* table_file_;
-    std::vector<lsn_t> redo_logs_;   // 在该page上需要redo的操作的lsn
+/* 恢复时的页面标识，表用编号表示，与日志中的PageLogRecord对应 */
+struct RecoveryPageId {
+    int table_id;
+    page_id_t page_no;
+
+    friend bool operator==(const RecoveryPageId &x, const RecoveryPageId &y) {
+        return x.table_id == y.table_id && x.page_no == y.page_no;
+    }
 };
 
+struct RecoveryPageIdHash {
+    size_t operator()(const RecoveryPageId &page_id) const {
+        return std::hash<int64_t>()((static_cast<int64_t>(page_id.table_id) << 32) | page_id.page_no);
+    }
+};
+
+/*
+ARIES风格的崩溃恢复
+1. analyze：顺序读取日志，得到活跃事务表(ATT，没有commit/abort记录的失败事务及其修改)和脏页表(DPT，每个页面第一次被修改的recLSN)。
+   日志末尾只写入了一部分的记录被截断，之后的日志从最大的lsn之后继续分配
+2. redo：按页面的哈希把需要重做的日志分给RECOVERY_REDO_THREADS个线程，每个线程按lsn顺序重做自己的页面，
+   page_lsn不小于日志lsn的修改已经在页面上，跳过。不同页面之间没有依赖，因此可以并行重做。
+   重做只修改页面本身，文件的扩展在分发之前完成，空闲空间信息和索引(索引的修改不写日志)在重做之后重建
+3. undo：在后台线程中按lsn从大到小撤销失败事务的修改，撤销也写入日志，最后为每个失败事务写入abort记录。
+   undo开始后服务端即可接受连接，访问失败事务修改过的表的语句在wait_for_undo()中等待撤销完成
+4. checkpoint：运行期间周期性地写入检查点开始/结束记录，结束记录中是期间读取的ATT(事务 -> 第一条日志)和
+   DPT(页面 -> recLSN)，不暂停事务和刷脏。结束记录持久化后master record指向该检查点，
+   日志中检查点开始、ATT中事务的第一条日志和DPT中recLSN三者最小值之前的部分被丢弃。
+   analyze读到master record指向的检查点时，检查点开始之前的日志只重做ATT中的事务和DPT中recLSN之后的修改
+*/
 class RecoveryManager {
 public:
-    RecoveryManager(DiskManager* disk_manager, BufferPoolManager* buffer_pool_manager, SmManager* sm_manager) {
+    RecoveryManager(DiskManager* disk_manager, BufferPoolManager* buffer_pool_manager, SmManager* sm_manager,
+                    LogManager* log_manager = nullptr) {
         disk_manager_ = disk_manager;
         buffer_pool_manager_ = buffer_pool_manager;
         sm_manager_ = sm_manager;
+        log_manager_ = log_manager;
     }
 
+    ~RecoveryManager();
+
     void analyze();
     void redo();
     void undo();
+
+    void checkpoint();
+
+    void wait_for_undo(const std::vector<std::string>& tab_names);
+
+    bool redo_page_log(PageLogRecord* log_record);
+
+    size_t get_num_redone() const { return num_redone_.load(); }
+
+    // 重启后分配的第一个事务ID，大于日志中的所有事务ID。后台undo仍以失败事务的ID写日志，新事务不能复用这些ID
+    txn_id_t get_next_txn_id() const { return max_txn_id_ + 1; }
+
+    // analyze之后日志中是否还有需要重做或撤销的内容，数据库只读打开时不能执行恢复
+    bool needs_recovery() const { return !active_txns_.empty() || !dirty_pages_.empty() || !rebuild_tables_.empty(); }
+
 private:
-    LogBuffer buffer_;                                              // 读入日志
+    /* 活跃事务表中的一项 */
+    struct ActiveTxn {
+        lsn_t first_lsn = INVALID_LSN;              // 事务的第一条日志
+        lsn_t last_lsn = INVALID_LSN;               // 事务的最后一条日志
+        std::vector<PageLogRecord*> page_logs;      // 事务修改页面的日志，按lsn递增
+    };
+
+    void load_checkpoint(const CheckpointEndLogRecord* log_record);
+
+    bool need_redo(const PageLogRecord* log_record) const;
+
+    bool redo_lsm_log(RmFileHandle* fh, PageLogRecord* log_record);
+
+    void run_undo(std::vector<PageLogRecord*> page_logs);
+
+    void undo_page_log(Transaction* txn, PageLogRecord* log_record);
+
+    lsn_t append_log(Transaction* txn, LogRecord* log_record);
+
+    void update_indexes(const TabMeta& tab, const Rid& rid, const char* old_record, const char* new_record,
+                        Transaction* txn);
+
+    RmFileHandle* get_table_file(int table_id);
+
     DiskManager* disk_manager_;                                     // 用来读写文件
     BufferPoolManager* buffer_pool_manager_;                        // 对页面进行读写
     SmManager* sm_manager_;                                         // 访问数据库元数据
-};
\ No newline at end of file
+    LogManager* log_manager_;                                       // 写入撤销产生的日志
+
+    std::vector<char> log_data_;                                    // 读入的日志，insert/delete日志的记录镜像指向这里
+    std::vector<std::unique_ptr<LogRecord>> log_records_;           // 按lsn递增的所有日志
+    std::map<txn_id_t, ActiveTxn> active_txns_;                     // ATT
+    std::unordered_map<RecoveryPageId, lsn_t, RecoveryPageIdHash> dirty_pages_;    // DPT，页面 -> recLSN
+    std::set<int> rebuild_tables_;                                  // 需要重建空闲空间和索引的表
+    lsn_t checkpoint_lsn_ = INVALID_LSN;                            // master record指向的检查点开始记录
+    std::unordered_set<txn_id_t> checkpoint_txns_;                  // 该检查点的ATT
+    std::unordered_map<RecoveryPageId, lsn_t, RecoveryPageIdHash> checkpoint_pages_;   // 该检查点的DPT
+    std::unordered_map<int, RmFileHandle*> table_files_;           // 表的编号 -> 表的数据文件
+    std::atomic<size_t> num_redone_{0};                             // 实际重做的日志数
+    txn_id_t max_txn_id_ = INVALID_TXN_ID;                          // analyze读到的最大事务ID
+
+    std::mutex undo_latch_;                                         // 用于undo_tables_
+    std::condition_variable undo_cv_;
+    std::set<std::string> undo_tables_;                             // 失败事务修改过、尚未撤销完成的表
+    std::atomic<bool> undo_done_{true};
+    std::thread undo_thread_;
+};
@@ -0,0 +1,92 @@
+#include "clock_replacer.h"
+
+ClockReplacer::ClockReplacer(size_t num_pages)
+    : in_replacer_(num_pages, 0), ref_(num_pages, 0), hand_(0), size_(0), max_size_(num_pages) {}
+
+ClockReplacer::~ClockReplacer() = default;
+
+/**
+ * @description: 使用CLOCK策略删除一个victim frame，并返回该frame的id。
+ *               时钟指针从上次停下的位置开始转动，引用位为1的帧获得第二次机会(引用位清零)，
+ *               遇到的第一个引用位为0的可淘汰帧即为victim，最多转动两圈
+ * @param {frame_id_t*} frame_id 被移除的frame的id，如果没有frame被移除返回nullptr
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool ClockReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+    if (size_ == 0) {
+        return false;
+    }
+    while (true) {
+        size_t cur = hand_;
+        hand_ = (hand_ + 1) % max_size_;
+        if (!in_replacer_[cur]) {
+            continue;
+        }
+        if (ref_[cur]) {
+            ref_[cur] = 0;
+            continue;
+        }
+        in_replacer_[cur] = 0;
+        size_--;
+        *frame_id = static_cast<frame_id_t>(cur);
+        return true;
+    }
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void ClockReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    size_t fid = static_cast<size_t>(frame_id);
+    if (fid >= max_size_ || !in_replacer_[fid]) {
+        return;
+    }
+    in_replacer_[fid] = 0;
+    ref_[fid] = 0;
+    size_--;
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰，同时设置其引用位
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void ClockReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    size_t fid = static_cast<size_t>(frame_id);
+    if (fid >= max_size_ || in_replacer_[fid]) {
+        return;
+    }
+    in_replacer_[fid] = 1;
+    ref_[fid] = 1;
+    size_++;
+}
+
+/**
+ * @description: 从时钟指针处开始收集至多max_num个候选帧，不修改引用位。
+ *               先收集引用位为0的帧(下一圈就会被淘汰)，再收集引用位为1的帧
+ * @param {vector<frame_id_t>*} frame_ids 候选帧追加到其末尾
+ * @param {size_t} max_num 最多收集的帧数
+ */
+void ClockReplacer::peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    for (uint8_t ref = 0; ref <= 1; ref++) {
+        for (size_t i = 0; i < max_size_ && max_num > 0; i++) {
+            size_t cur = (hand_ + i) % max_size_;
+            if (in_replacer_[cur] && ref_[cur] == ref) {
+                frame_ids->push_back(static_cast<frame_id_t>(cur));
+                max_num--;
+            }
+        }
+    }
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t ClockReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return size_;
+}
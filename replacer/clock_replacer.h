@@ -0,0 +1,40 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+ClockReplacer实现了CLOCK(second-chance)替换策略
+每个帧只占用数组中的两个标志位，pin/unpin不会申请或释放任何内存
+*/
+class ClockReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的ClockReplacer
+     * @param {size_t} num_pages ClockReplacer最多需要存储的page数量
+     */
+    explicit ClockReplacer(size_t num_pages);
+
+    ~ClockReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    void peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num);
+
+    size_t Size();
+
+   private:
+    std::mutex latch_;                  // 互斥锁
+    std::vector<uint8_t> in_replacer_;  // frame_id -> 该帧是否可以被淘汰(即已被unpin)
+    std::vector<uint8_t> ref_;          // frame_id -> 引用位，时钟指针经过时为1则置0并跳过
+    size_t hand_;                       // 时钟指针
+    size_t size_;                       // 当前可以被淘汰的帧数
+    size_t max_size_;                   // 最大容量（与缓冲池的容量相同）
+};
@@ -52,6 +52,18 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
     LRUhash_[frame_id] = LRUlist_.begin();
 }
 
+/**
+ * @description: 按淘汰顺序(从最久未使用开始)收集至多max_num个候选帧，不将其移出replacer
+ * @param {vector<frame_id_t>*} frame_ids 候选帧追加到其末尾
+ * @param {size_t} max_num 最多收集的帧数
+ */
+void LRUReplacer::peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    for (auto it = LRUlist_.rbegin(); it != LRUlist_.rend() && max_num > 0; ++it, --max_num) {
+        frame_ids->push_back(*it);
+    }
+}
+
 /**
  * @description: 获取当前replacer中可以被淘汰的页面数量
  */
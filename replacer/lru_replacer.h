@@ -27,6 +27,8 @@ class LRUReplacer : public Replacer {
 
     void unpin(frame_id_t frame_id);
 
+    void peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num);
+
     size_t Size();
 
    private:
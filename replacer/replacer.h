@@ -1,7 +1,15 @@
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
+/**
+ * 页面访问模式提示，由调用者在fetch_page时给出。
+ * Scan表示顺序扫描(RmScan/IxScan)，此类访问不应该把页面提升为热页
+ */
+enum class AccessType { Normal, Scan };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -29,6 +37,22 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Records an access to a frame right before it is pinned. Policies that do not
+     * distinguish access patterns can ignore it.
+     * @param frame_id the id of the accessed frame
+     * @param access_type hint describing how the frame is being accessed
+     */
+    virtual void record_access(frame_id_t frame_id, AccessType access_type) {}
+
+    /**
+     * Collects the frames that would be victimized next, in eviction order, without removing
+     * them. Used by the background flusher to write dirty frames back before they are evicted.
+     * @param[out] frame_ids the candidate frames are appended here
+     * @param max_num the maximum number of candidates to collect
+     */
+    virtual void peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num) {}
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
 };
@@ -0,0 +1,137 @@
+#include "two_queue_replacer.h"
+
+TwoQueueReplacer::TwoQueueReplacer(size_t num_pages)
+    : prev_(num_pages, INVALID_FRAME_ID),
+      next_(num_pages, INVALID_FRAME_ID),
+      queue_(num_pages, NONE),
+      hits_(num_pages, 0),
+      probation_target_(num_pages / 4 > 0 ? num_pages / 4 : 1),
+      max_size_(num_pages) {}
+
+TwoQueueReplacer::~TwoQueueReplacer() = default;
+
+/**
+ * @description: 将帧加入指定队列的head_端
+ */
+void TwoQueueReplacer::push_front(FrameList &list, Queue queue, frame_id_t frame_id) {
+    prev_[frame_id] = INVALID_FRAME_ID;
+    next_[frame_id] = list.head_;
+    if (list.head_ != INVALID_FRAME_ID) {
+        prev_[list.head_] = frame_id;
+    } else {
+        list.tail_ = frame_id;
+    }
+    list.head_ = frame_id;
+    list.size_++;
+    queue_[frame_id] = queue;
+}
+
+/**
+ * @description: 将帧从其所在的队列中移除
+ */
+void TwoQueueReplacer::remove(frame_id_t frame_id) {
+    FrameList &list = queue_[frame_id] == HOT ? hot_ : probation_;
+    if (prev_[frame_id] != INVALID_FRAME_ID) {
+        next_[prev_[frame_id]] = next_[frame_id];
+    } else {
+        list.head_ = next_[frame_id];
+    }
+    if (next_[frame_id] != INVALID_FRAME_ID) {
+        prev_[next_[frame_id]] = prev_[frame_id];
+    } else {
+        list.tail_ = prev_[frame_id];
+    }
+    list.size_--;
+    queue_[frame_id] = NONE;
+}
+
+/**
+ * @description: 使用2Q策略删除一个victim frame，并返回该frame的id。
+ *               试用队列超过目标长度或热队列为空时淘汰试用队列的tail_，否则淘汰热队列的tail_
+ * @param {frame_id_t*} frame_id 被移除的frame的id，如果没有frame被移除返回nullptr
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool TwoQueueReplacer::victim(frame_id_t *frame_id) {
+    std::scoped_lock lock{latch_};
+    if (probation_.size_ == 0 && hot_.size_ == 0) {
+        return false;
+    }
+    frame_id_t fid;
+    if (probation_.size_ > 0 && (probation_.size_ > probation_target_ || hot_.size_ == 0)) {
+        fid = probation_.tail_;
+    } else {
+        fid = hot_.tail_;
+    }
+    remove(fid);
+    // 该帧即将装入新的页面，访问历史清零
+    hits_[fid] = 0;
+    *frame_id = fid;
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void TwoQueueReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    if (static_cast<size_t>(frame_id) >= max_size_ || queue_[frame_id] == NONE) {
+        return;
+    }
+    remove(frame_id);
+}
+
+/**
+ * @description: 取消固定一个frame，代表该页面可以被淘汰。
+ *               被访问过至少两次(不计顺序扫描)的帧进入热队列，其余进入试用队列
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void TwoQueueReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    if (static_cast<size_t>(frame_id) >= max_size_ || queue_[frame_id] != NONE) {
+        return;
+    }
+    if (hits_[frame_id] >= 2) {
+        push_front(hot_, HOT, frame_id);
+    } else {
+        push_front(probation_, PROBATION, frame_id);
+    }
+}
+
+/**
+ * @description: 记录一次对帧的访问。顺序扫描的访问不计入访问次数，因此扫描过的页面总是留在试用队列
+ * @param {frame_id_t} frame_id 被访问的帧
+ * @param {AccessType} access_type 访问模式
+ */
+void TwoQueueReplacer::record_access(frame_id_t frame_id, AccessType access_type) {
+    std::scoped_lock lock{latch_};
+    if (static_cast<size_t>(frame_id) >= max_size_ || access_type == AccessType::Scan) {
+        return;
+    }
+    if (hits_[frame_id] < 2) {
+        hits_[frame_id]++;
+    }
+}
+
+/**
+ * @description: 收集至多max_num个候选帧，不将其移出replacer。
+ *               先按FIFO顺序收集试用队列，再按LRU顺序收集热队列
+ * @param {vector<frame_id_t>*} frame_ids 候选帧追加到其末尾
+ * @param {size_t} max_num 最多收集的帧数
+ */
+void TwoQueueReplacer::peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num) {
+    std::scoped_lock lock{latch_};
+    for (const FrameList *list : {&probation_, &hot_}) {
+        for (frame_id_t fid = list->tail_; fid != INVALID_FRAME_ID && max_num > 0; fid = prev_[fid], max_num--) {
+            frame_ids->push_back(fid);
+        }
+    }
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t TwoQueueReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return probation_.size_ + hot_.size_;
+}
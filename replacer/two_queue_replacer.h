@@ -0,0 +1,61 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+TwoQueueReplacer实现了简化的2Q替换策略，对全表扫描具有抵抗力
+只被访问过一次的帧和顺序扫描访问的帧进入试用队列(probation, FIFO)，
+被再次访问的帧晋升到热队列(hot, LRU)。
+淘汰时优先从试用队列中选择，因此一次全表扫描只会冲刷试用队列，不会淘汰B+树内部结点等热页。
+两个队列都是建立在数组上的侵入式双向链表，pin/unpin不申请内存
+*/
+class TwoQueueReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的TwoQueueReplacer
+     * @param {size_t} num_pages TwoQueueReplacer最多需要存储的page数量
+     */
+    explicit TwoQueueReplacer(size_t num_pages);
+
+    ~TwoQueueReplacer();
+
+    bool victim(frame_id_t *frame_id);
+
+    void pin(frame_id_t frame_id);
+
+    void unpin(frame_id_t frame_id);
+
+    void record_access(frame_id_t frame_id, AccessType access_type);
+
+    void peek_victims(std::vector<frame_id_t> *frame_ids, size_t max_num);
+
+    size_t Size();
+
+   private:
+    enum Queue : uint8_t { NONE = 0, PROBATION = 1, HOT = 2 };
+
+    /* 数组上的侵入式双向链表，head_为最近加入的一端，tail_为淘汰端 */
+    struct FrameList {
+        frame_id_t head_ = INVALID_FRAME_ID;
+        frame_id_t tail_ = INVALID_FRAME_ID;
+        size_t size_ = 0;
+    };
+
+    void push_front(FrameList &list, Queue queue, frame_id_t frame_id);
+
+    void remove(frame_id_t frame_id);
+
+    std::mutex latch_;                  // 互斥锁
+    std::vector<frame_id_t> prev_;      // frame_id -> 链表中的前驱(更靠近head_)
+    std::vector<frame_id_t> next_;      // frame_id -> 链表中的后继(更靠近tail_)
+    std::vector<Queue> queue_;          // frame_id -> 该帧当前所在的队列
+    std::vector<uint8_t> hits_;         // frame_id -> 帧被装入当前页面后的非扫描访问次数(饱和于2)
+    FrameList probation_;               // 试用队列，FIFO
+    FrameList hot_;                     // 热队列，LRU
+    size_t probation_target_;           // 试用队列的目标长度，超过时优先从试用队列淘汰
+    size_t max_size_;                   // 最大容量（与缓冲池的容量相同）
+};
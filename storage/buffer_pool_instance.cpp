@@ -0,0 +1,994 @@
+#include "buffer_pool_instance.h"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+#include "common/metrics.h"
+#include "common/numa.h"
+#include "common/trace.h"
+
+/**
+ * @description: 为帧数据区映射匿名内存。BUFFER_POOL_HUGE_PAGES开启时先尝试MAP_HUGETLB显式大页，
+ *               系统未预留大页时退回普通映射并建议内核使用透明大页，减少大缓冲池的TLB缺失。
+ *               指定了NUMA结点时在第一次写入之前绑定，物理页面分配在该结点上
+ * @return {char*} 按PAGE_SIZE对齐、已清零的数据区
+ * @param {size_t} size 需要的字节数
+ * @param {size_t*} mapped_size 返回实际映射的字节数，释放时使用
+ * @param {int} numa_node 数据区优先分配的NUMA结点，为-1时不指定
+ */
+char *BufferPoolInstance::allocate_arena(size_t size, size_t *mapped_size, int numa_node) {
+    size = std::max<size_t>(size, PAGE_SIZE);
+    void *arena = MAP_FAILED;
+    if (BUFFER_POOL_HUGE_PAGES) {
+        size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#ifdef MAP_HUGETLB
+        arena = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        if (arena == MAP_FAILED) {
+            arena = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (arena != MAP_FAILED) {
+                madvise(arena, huge_size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        size = huge_size;
+    } else {
+        arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (arena == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (numa_node >= 0) {
+        NumaTopology::get().bind_memory(arena, size, numa_node);
+    }
+    *mapped_size = size;
+    return static_cast<char *>(arena);
+}
+
+void BufferPoolInstance::free_arena(char *arena, size_t mapped_size) { munmap(arena, mapped_size); }
+
+/**
+ * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id，调用时需持有latch_。
+ *               找到的帧的pin_count_被置为-1，之后不加锁的命中路径无法再pin住它；
+ *               replacer给出的帧可能刚被不加锁地pin住，此时跳过该帧，它会在pin_count_降为0时重新加入replacer
+ * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
+ * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
+ */
+bool BufferPoolInstance::find_victim_page(frame_id_t* frame_id) {
+    // 空闲帧只会被校验失败的命中路径短暂pin住
+    for (size_t n = free_list_.size(); n > 0; n--) {
+        frame_id_t fid = free_list_.front();
+        free_list_.pop_front();
+        int expected = 0;
+        if (pages_[fid].pin_count_.compare_exchange_strong(expected, -1)) {
+            *frame_id = fid;
+            return true;
+        }
+        free_list_.push_back(fid);
+    }
+    frame_id_t fid;
+    while (replacer_->victim(&fid)) {
+        int expected = 0;
+        if (pages_[fid].pin_count_.compare_exchange_strong(expected, -1)) {
+            *frame_id = fid;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 不加锁地pin住页表命中的帧，并校验帧中确实是page_id且数据可用
+ * @return {bool} 是否pin住了page_id，失败时调用者需加锁重试
+ * @param {Page*} page 页表中查到的帧，可能已经过期
+ * @param {PageId} page_id 需要的页
+ */
+bool BufferPoolInstance::try_pin(Page *page, PageId page_id) {
+    int pin_count = page->pin_count_.load(std::memory_order_relaxed);
+    do {
+        if (pin_count < 0) {
+            return false;
+        }
+    } while (!page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1, std::memory_order_acq_rel,
+                                                     std::memory_order_relaxed));
+    if (page->key_.load(std::memory_order_acquire) == static_cast<uint64_t>(page_id.Get()) &&
+        !page->io_in_progress_.load(std::memory_order_acquire)) {
+        return true;
+    }
+    release_pin(static_cast<frame_id_t>(page - pages_));
+    return false;
+}
+
+/**
+ * @description: 释放帧上的一个pin。pin_count_大于1时不加锁递减，降为0需要持有latch_以便将帧加入replacer
+ * @param {frame_id_t} frame_id 目标帧
+ */
+void BufferPoolInstance::release_pin(frame_id_t frame_id) {
+    Page *page = pages_ + frame_id;
+    int pin_count = page->pin_count_.load(std::memory_order_relaxed);
+    while (pin_count >= 2) {
+        if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1, std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+            return;
+        }
+    }
+    std::scoped_lock lock{latch_};
+    unpin_frame(frame_id);
+}
+
+/**
+ * @description: 释放帧上的一个pin，调用时需持有latch_。
+ *               pin_count_降为0时帧重新成为可淘汰帧，并补记不加锁命中期间的访问
+ * @param {frame_id_t} frame_id 目标帧
+ */
+void BufferPoolInstance::unpin_frame(frame_id_t frame_id) {
+    Page *page = pages_ + frame_id;
+    if (page->pin_count_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    // 空闲帧只是被校验失败的命中路径短暂pin住，不属于replacer
+    if (page->id_.page_no == INVALID_PAGE_ID) {
+        return;
+    }
+    if (page->referenced_.exchange(false)) {
+        replacer_->pin(frame_id);
+        replacer_->record_access(frame_id, AccessType::Normal);
+    }
+    replacer_->unpin(frame_id);
+}
+
+/**
+ * @description: 将victim帧重新映射到新页面，调用时需持有latch_。
+ *               帧被pin住并标记为I/O进行中，旧页若为脏页则加入flushing_，由调用者在释放latch_后写回磁盘
+ * @return {bool} 旧页是否需要写回磁盘
+ * @param {Page*} page 被替换的帧
+ * @param {PageId} new_page_id 新的page_id
+ * @param {frame_id_t} new_frame_id 新的帧frame_id
+ * @param {PageId*} old_page_id 返回帧中原来的page_id
+ */
+bool BufferPoolInstance::update_page(Page *page, PageId new_page_id, frame_id_t new_frame_id, PageId *old_page_id) {
+    PageId old_id = page->id_;
+    bool write_back = page->is_dirty_ && old_id.page_no != INVALID_PAGE_ID;
+    if (old_id.page_no != INVALID_PAGE_ID) {
+        compress_page(page);
+        page_table_.erase(old_id);
+        EngineMetrics::get().buffer_pool_evictions.add();
+    }
+    if (write_back) {
+        flushing_.emplace(old_id, page->rec_lsn_.load(std::memory_order_relaxed));
+        EngineMetrics::get().buffer_pool_dirty_writebacks.add();
+    }
+    page->rec_lsn_.store(INVALID_LSN, std::memory_order_relaxed);
+    *old_page_id = old_id;
+    page->id_ = new_page_id;
+    page->key_.store(new_page_id.Get(), std::memory_order_release);
+    page->is_dirty_ = false;
+    page->referenced_ = false;
+    page->io_in_progress_.store(true, std::memory_order_release);
+    page_table_.insert(new_page_id, new_frame_id);
+    replacer_->pin(new_frame_id);
+    // 帧由find_victim_page独占(pin_count_为-1)，设置好页面信息后才允许其他线程pin住
+    page->pin_count_.store(1, std::memory_order_release);
+    return write_back;
+}
+
+/**
+ * @description: 把即将被淘汰的页面编码后放入压缩页缓存，调用时需持有latch_。
+ *               只处理注册了编解码器的文件；脏页的编码结果与随后写回磁盘的内容相同。
+ *               压缩页缓存只是磁盘的副本，编码失败或不值得保存时直接丢弃该页
+ * @param {Page*} page 被淘汰的帧，其中仍是旧页的数据
+ */
+void BufferPoolInstance::compress_page(Page *page) {
+    auto codec = codecs_.find(page->id_.fd);
+    if (codec == codecs_.end() || compressed_capacity_ == 0) {
+        return;
+    }
+    auto data = std::make_shared<std::string>();
+    try {
+        if (!codec->second->encode(page->id_.page_no, page->data_, data.get()) || data->size() > compressed_capacity_) {
+            return;
+        }
+        erase_compressed(page->id_);
+        compressed_order_.push_back(page->id_);
+        compressed_.emplace(page->id_, CompressedPage{std::move(data), std::prev(compressed_order_.end())});
+    } catch (...) {
+        return;
+    }
+    compressed_bytes_ += compressed_.at(page->id_).data->size();
+    while (compressed_bytes_ > compressed_capacity_) {
+        erase_compressed(compressed_order_.front());
+    }
+}
+
+/**
+ * @description: 从压缩页缓存中取走页面的编码结果，调用时需持有latch_。页面随后被解码到帧中，缓存中不再保留
+ * @return {shared_ptr<const string>} 编码结果，页面不在缓存中时为nullptr
+ */
+std::shared_ptr<const std::string> BufferPoolInstance::take_compressed(PageId page_id) {
+    auto it = compressed_.find(page_id);
+    if (it == compressed_.end()) {
+        return nullptr;
+    }
+    auto data = std::move(it->second.data);
+    compressed_bytes_ -= data->size();
+    compressed_order_.erase(it->second.pos);
+    compressed_.erase(it);
+    return data;
+}
+
+// 从压缩页缓存中删除页面，调用时需持有latch_
+void BufferPoolInstance::erase_compressed(PageId page_id) { take_compressed(page_id); }
+
+/**
+ * @description: 注册或注销文件的页面编解码器。注销时丢弃该文件在压缩页缓存中的所有页面，
+ *               关闭文件前必须注销，否则之后复用同一fd的文件会读到旧文件的页面
+ * @param {int} fd 文件句柄
+ * @param {shared_ptr<const PageCodec>} codec 编解码器，为nullptr时注销
+ */
+void BufferPoolInstance::set_page_codec(int fd, std::shared_ptr<const PageCodec> codec) {
+    std::scoped_lock lock{latch_};
+    if (codec != nullptr) {
+        codecs_[fd] = std::move(codec);
+        return;
+    }
+    codecs_.erase(fd);
+    for (auto it = compressed_order_.begin(); it != compressed_order_.end();) {
+        PageId page_id = *it++;
+        if (page_id.fd == fd) {
+            erase_compressed(page_id);
+        }
+    }
+}
+
+/**
+ * @description: 读取压缩页缓存中页面的编码结果，不把页面读入帧。
+ *               返回的编码结果在调用者持有期间保持有效，但页面之后可能被读入帧并修改，调用者读到的是调用时的内容
+ * @return {shared_ptr<const string>} 编码结果，页面不在缓存中(在帧中或只在磁盘上)时为nullptr
+ * @param {PageId} page_id 目标页
+ */
+std::shared_ptr<const std::string> BufferPoolInstance::get_compressed_page(PageId page_id) {
+    std::scoped_lock lock{latch_};
+    auto it = compressed_.find(page_id);
+    return it == compressed_.end() ? nullptr : it->second.data;
+}
+
+// 压缩页缓存占用的字节数
+size_t BufferPoolInstance::get_compressed_bytes() {
+    std::scoped_lock lock{latch_};
+    return compressed_bytes_;
+}
+
+/**
+ * @description: 帧上的I/O完成，调用时需持有latch_。清除I/O标记并唤醒等待该帧或旧页写回的线程
+ * @param {Page*} page 完成I/O的帧
+ * @param {bool} write_back 是否写回了旧页
+ * @param {PageId} old_page_id 被写回的旧页
+ */
+void BufferPoolInstance::finish_io(Page *page, bool write_back, PageId old_page_id) {
+    if (write_back) {
+        flushing_.erase(old_page_id);
+    }
+    page->io_in_progress_.store(false, std::memory_order_release);
+    io_cv_.notify_all();
+}
+
+/**
+ * @description: 帧上的I/O抛出异常，调用时需持有latch_。
+ *               若旧页尚未写回，则将帧恢复为旧页(仍为脏页)；否则将帧归还free_list_
+ * @param {Page*} page 发生I/O错误的帧
+ * @param {frame_id_t} frame_id 帧编号
+ * @param {bool} write_back 旧页是否需要写回
+ * @param {bool} written_back 旧页是否已经写回成功
+ * @param {PageId} old_page_id 帧中原来的page_id
+ */
+void BufferPoolInstance::abort_io(Page *page, frame_id_t frame_id, bool write_back, bool written_back,
+                                  PageId old_page_id) {
+    page_table_.erase(page->id_);
+    lsn_t old_rec_lsn = INVALID_LSN;
+    if (write_back) {
+        old_rec_lsn = flushing_.at(old_page_id);
+        flushing_.erase(old_page_id);
+    }
+    if (write_back && !written_back) {
+        // 旧页重新回到帧中，淘汰时放入压缩页缓存的编码结果不再有效
+        erase_compressed(old_page_id);
+        page->rec_lsn_.store(old_rec_lsn, std::memory_order_relaxed);
+        page->id_ = old_page_id;
+        page->key_.store(old_page_id.Get(), std::memory_order_release);
+        page->is_dirty_ = true;
+        page_table_.insert(old_page_id, frame_id);
+        page->io_in_progress_.store(false, std::memory_order_release);
+        unpin_frame(frame_id);
+    } else {
+        page->id_.page_no = INVALID_PAGE_ID;
+        page->key_.store(PageTable::EMPTY_KEY, std::memory_order_release);
+        page->is_dirty_ = false;
+        page->io_in_progress_.store(false, std::memory_order_release);
+        page->pin_count_.fetch_sub(1, std::memory_order_acq_rel);
+        free_list_.push_back(frame_id);
+    }
+    io_cv_.notify_all();
+}
+
+/**
+ * @description: 从buffer pool获取需要的页。
+ *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
+ *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim page，将其替换为磁盘中读取的page，pin_count置1。
+ *              页面在压缩页缓存中时从编码结果解码，不读磁盘。
+ *              写回victim和读入新页都在释放latch_后进行，同时访问该页的其他线程在io_cv_上等待I/O完成
+ * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
+ * @param {PageId} page_id 需要获取的页的PageId
+ * @param {AccessType} access_type 访问模式提示，传递给replacer
+ */
+Page* BufferPoolInstance::fetch_page(PageId page_id, AccessType access_type) {
+    PageAccessCounter &counter = PageAccessCounter::local();
+    counter.fetches++;
+    // 命中时不加锁：无锁查页表并pin住帧，访问记录在pin_count_降为0时补记到replacer
+    frame_id_t hit;
+    if (page_table_.find(page_id, &hit) && try_pin(pages_ + hit, page_id)) {
+        if (access_type == AccessType::Normal) {
+            pages_[hit].referenced_.store(true, std::memory_order_relaxed);
+        }
+        counter.hits++;
+        EngineMetrics::get().buffer_pool_hits.add();
+        return pages_ + hit;
+    }
+
+    std::unique_lock<std::mutex> lock{latch_};
+    while (true) {
+        // 该页正在从其他帧写回磁盘，需等待写回完成后才能从磁盘读到最新数据
+        if (flushing_.count(page_id)) {
+            io_cv_.wait(lock);
+            continue;
+        }
+        frame_id_t fid;
+        if (!page_table_.find(page_id, &fid)) {
+            break;
+        }
+        Page *page = pages_ + fid;
+        // 其他线程正在读入该页
+        if (page->io_in_progress_) {
+            io_cv_.wait(lock);
+            continue;
+        }
+        page->pin_count_++;
+        replacer_->record_access(fid, access_type);
+        replacer_->pin(fid);
+        counter.hits++;
+        EngineMetrics::get().buffer_pool_hits.add();
+        return page;
+    }
+    EngineMetrics::get().buffer_pool_misses.add();
+    TraceSpan span("buffer_pool.fetch_miss", "page_no", page_id.page_no);
+    frame_id_t victim;
+    if (!find_victim_page(&victim)) {
+        return nullptr;
+    }
+    Page *page = pages_ + victim;
+    PageId old_id;
+    bool write_back = update_page(page, page_id, victim, &old_id);
+    replacer_->record_access(victim, access_type);
+    // 页面在压缩页缓存中时解码到帧中，不读磁盘
+    auto compressed = take_compressed(page_id);
+    std::shared_ptr<const PageCodec> codec;
+    if (compressed != nullptr) {
+        codec = codecs_.at(page_id.fd);
+    }
+    lock.unlock();
+
+    bool written_back = false;
+    try {
+        if (write_back) {
+            disk_manager_->write_page(old_id.fd, old_id.page_no, page->data_, PAGE_SIZE);
+            written_back = true;
+        }
+        if (compressed != nullptr) {
+            codec->decode(*compressed, page->data_);
+        } else {
+            disk_manager_->read_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
+        }
+    } catch (...) {
+        lock.lock();
+        abort_io(page, victim, write_back, written_back, old_id);
+        throw;
+    }
+
+    lock.lock();
+    finish_io(page, write_back, old_id);
+    return page;
+}
+
+/**
+ * @description: 取消固定pin_count>0的在缓冲池中的page
+ * @return {bool} 如果目标页的pin_count<=0则返回false，否则返回true
+ * @param {PageId} page_id 目标page的page_id
+ * @param {bool} is_dirty 若目标page应该被标记为dirty则为true，否则为false
+ */
+bool BufferPoolInstance::unpin_page(PageId page_id, bool is_dirty) {
+    // 调用者持有pin，帧不会被淘汰；pin_count_大于1时不加锁递减
+    frame_id_t fid;
+    if (page_table_.find(page_id, &fid) &&
+        pages_[fid].key_.load(std::memory_order_acquire) == static_cast<uint64_t>(page_id.Get())) {
+        Page *page = pages_ + fid;
+        int pin_count = page->pin_count_.load(std::memory_order_relaxed);
+        if (pin_count <= 0) {
+            return false;
+        }
+        if (is_dirty) {
+            page->is_dirty_ = true;
+        }
+        while (pin_count >= 2) {
+            if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1, std::memory_order_acq_rel,
+                                                       std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+    std::scoped_lock lock{latch_};
+    if (!page_table_.find(page_id, &fid)) {
+        return false;
+    }
+    Page *page = pages_ + fid;
+    if (page->pin_count_ <= 0) {
+        return false;
+    }
+    if (is_dirty) {
+        page->is_dirty_ = true;
+    }
+    unpin_frame(fid);
+    return true;
+}
+
+/**
+ * @description: 将目标页写回磁盘，不考虑当前页面是否正在被使用
+ * @return {bool} 成功则返回true，否则返回false(只有page_table_中没有目标页时)
+ * @param {PageId} page_id 目标页的page_id，不能为INVALID_PAGE_ID
+ */
+bool BufferPoolInstance::flush_page(PageId page_id) {
+    std::unique_lock<std::mutex> lock{latch_};
+    frame_id_t fid;
+    while (true) {
+        if (!page_table_.find(page_id, &fid)) {
+            return false;
+        }
+        Page *page = pages_ + fid;
+        if (!page->io_in_progress_ && !page->write_in_progress_) {
+            break;
+        }
+        io_cv_.wait(lock);
+    }
+    // 与后台刷脏相同：pin住帧后释放latch_，在页面读锁下拷贝，写回时不持有任何锁
+    alignas(PAGE_SIZE) char buf[PAGE_SIZE];
+    begin_write_back(fid, true);
+    lock.unlock();
+    try {
+        copy_for_write_back(fid, buf);
+        disk_manager_->write_page(page_id.fd, page_id.page_no, buf, PAGE_SIZE);
+    } catch (...) {
+        lock.lock();
+        end_write_back(fid, false);
+        throw;
+    }
+    lock.lock();
+    end_write_back(fid, true);
+    return true;
+}
+
+/**
+ * @description: 创建一个新的page，即从磁盘中移动一个新建的空page到缓冲池某个位置。
+ *               若victim为脏页，则释放latch_后再写回
+ * @return {Page*} 返回新创建的page，若创建失败则返回nullptr
+ * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id；
+ *                          若传入的page_no为INVALID_PAGE_ID，则在找到可用帧后再向disk_manager申请页号，
+ *                          否则直接使用调用者(BufferPoolManager)预先分配好的页号
+ */
+Page* BufferPoolInstance::new_page(PageId* page_id) {
+    std::unique_lock<std::mutex> lock{latch_};
+    frame_id_t victim;
+    if (!find_victim_page(&victim)) {
+        return nullptr;
+    }
+    Page *page = pages_ + victim;
+    PageId new_id = *page_id;
+    if (new_id.page_no == INVALID_PAGE_ID) {
+        new_id.page_no = disk_manager_->allocate_page(new_id.fd);
+    }
+    PageId old_id;
+    bool write_back = update_page(page, new_id, victim, &old_id);
+    replacer_->record_access(victim, AccessType::Normal);
+    erase_compressed(new_id);
+    if (write_back) {
+        lock.unlock();
+        try {
+            disk_manager_->write_page(old_id.fd, old_id.page_no, page->data_, PAGE_SIZE);
+        } catch (...) {
+            lock.lock();
+            abort_io(page, victim, write_back, false, old_id);
+            throw;
+        }
+        page->reset_memory();
+        lock.lock();
+    } else {
+        page->reset_memory();
+    }
+    page->is_dirty_ = true;
+    finish_io(page, write_back, old_id);
+    *page_id = new_id;
+    return page;
+}
+
+/**
+ * @description: 从buffer_pool删除目标页
+ * @return {bool} 如果目标页不存在于buffer_pool或者成功被删除则返回true，若其存在于buffer_pool但无法删除则返回false
+ * @param {PageId} page_id 目标页
+ */
+bool BufferPoolInstance::delete_page(PageId page_id) {
+    std::scoped_lock lock{latch_};
+    erase_compressed(page_id);
+    frame_id_t fid;
+    if (!page_table_.find(page_id, &fid)) {
+        return true;
+    }
+    Page *page = pages_ + fid;
+    // 独占该帧，防止不加锁的命中路径在删除期间pin住它
+    int expected = 0;
+    if (!page->pin_count_.compare_exchange_strong(expected, -1)) {
+        return false;
+    }
+    replacer_->pin(fid);
+    if (page->is_dirty_) {
+        try {
+            disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
+        } catch (...) {
+            page->pin_count_.store(0, std::memory_order_release);
+            replacer_->unpin(fid);
+            throw;
+        }
+    }
+    page_table_.erase(page_id);
+    page->reset_memory();
+    page->id_.page_no = INVALID_PAGE_ID;
+    page->id_.fd = page_id.fd;
+    page->key_.store(PageTable::EMPTY_KEY, std::memory_order_release);
+    page->is_dirty_ = false;
+    page->rec_lsn_.store(INVALID_LSN, std::memory_order_relaxed);
+    page->pin_count_.store(0, std::memory_order_release);
+    free_list_.push_back(fid);
+    return true;
+}
+
+/**
+ * @description: 将buffer_pool中的所有页写回到磁盘，页号连续的页面合并为一次向量写。
+ *               会先等待该文件正在进行的淘汰写回完成，保证返回后文件可以安全关闭
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolInstance::flush_all_pages(int fd) {
+    std::unique_lock<std::mutex> lock{latch_};
+    io_cv_.wait(lock, [&] {
+        for (auto &entry : flushing_) {
+            if (entry.first.fd == fd) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < pool_size_; i++) {
+            if (pages_[i].write_in_progress_ && pages_[i].id_.fd == fd) {
+                return false;
+            }
+        }
+        return true;
+    });
+    std::vector<std::pair<frame_id_t, PageId>> frames;
+    for (size_t i = 0; i < pool_size_; i++) {
+        Page *page = pages_ + i;
+        if (page->id_.fd == fd && page->id_.page_no != INVALID_PAGE_ID) {
+            frames.emplace_back(static_cast<frame_id_t>(i), page->id_);
+        }
+    }
+    // 按页号排序，页号连续的一段页面用一次pwritev写回
+    std::sort(frames.begin(), frames.end(),
+              [](const std::pair<frame_id_t, PageId> &a, const std::pair<frame_id_t, PageId> &b) {
+                  return a.second.page_no < b.second.page_no;
+              });
+
+    // 每批至多IO_BATCH_SIZE个页面：持latch_时pin住，释放latch_后在页面读锁下拷贝并写回
+    size_t batch_size = std::max<size_t>(std::min(frames.size(), IO_BATCH_SIZE), 1);
+    std::unique_ptr<char, decltype(&free)> bufs(static_cast<char *>(aligned_alloc(PAGE_SIZE, batch_size * PAGE_SIZE)),
+                                                &free);
+    if (bufs == nullptr) {
+        throw std::bad_alloc();
+    }
+    std::vector<std::pair<frame_id_t, PageId>> batch;
+    std::vector<const char *> run;
+    for (size_t begin = 0; begin < frames.size(); begin += IO_BATCH_SIZE) {
+        size_t end = std::min(begin + IO_BATCH_SIZE, frames.size());
+        batch.clear();
+        for (size_t i = begin; i < end; i++) {
+            auto &entry = frames[i];
+            // 帧在此期间可能已被淘汰(淘汰时已写回)或装入了其他页面，正在读入的帧中还不是该页的有效数据
+            if (pages_[entry.first].id_ == entry.second && begin_write_back(entry.first, true)) {
+                batch.push_back(entry);
+            }
+        }
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            for (size_t i = 0; i < batch.size(); i++) {
+                copy_for_write_back(batch[i].first, bufs.get() + i * PAGE_SIZE);
+            }
+            for (size_t first = 0, last; first < batch.size(); first = last) {
+                run.clear();
+                for (last = first; last < batch.size() && batch[last].second.page_no ==
+                                                              batch[first].second.page_no + static_cast<int>(last - first);
+                     last++) {
+                    run.push_back(bufs.get() + last * PAGE_SIZE);
+                }
+                disk_manager_->write_pages(fd, batch[first].second.page_no, run.data(), static_cast<int>(run.size()));
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        for (auto &entry : batch) {
+            end_write_back(entry.first, error == nullptr);
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/**
+ * @description: 开始写回一个帧，调用时需持有latch_。
+ *               帧被pin住以防被淘汰，之后由调用者在释放latch_后用copy_for_write_back拷贝页面并写回拷贝，
+ *               写回期间被修改的页面会在unpin时重新被标记为脏页
+ * @return {bool} 该帧是否需要写回
+ * @param {frame_id_t} frame_id 要写回的帧
+ * @param {bool} force 为true时不是脏页也写回(flush_page和flush_all_pages)
+ */
+bool BufferPoolInstance::begin_write_back(frame_id_t frame_id, bool force) {
+    Page *page = pages_ + frame_id;
+    if ((!force && !page->is_dirty_) || page->io_in_progress_ || page->write_in_progress_ ||
+        page->id_.page_no == INVALID_PAGE_ID) {
+        return false;
+    }
+    page->pin_count_++;
+    replacer_->pin(frame_id);
+    page->write_in_progress_ = true;
+    page->is_dirty_ = false;
+    return true;
+}
+
+/**
+ * @description: 在页面读锁下把begin_write_back pin住的帧拷贝到buf中，调用时不能持有latch_，
+ *               否则会与持有页面写锁、正在调用缓冲池的线程互相等待。读锁保证写回的不是修改到一半的页面
+ * @param {frame_id_t} frame_id 要写回的帧
+ * @param {char*} buf 大小为PAGE_SIZE的拷贝缓冲区
+ */
+void BufferPoolInstance::copy_for_write_back(frame_id_t frame_id, char *buf) {
+    Page *page = pages_ + frame_id;
+    page->rlatch();
+    memcpy(buf, page->data_, PAGE_SIZE);
+    page->runlatch();
+}
+
+/**
+ * @description: 结束后台写回，调用时需持有latch_。写回失败时重新标记为脏页；
+ *               写回成功且期间没有被修改时清除rec_lsn，被修改过时保留原来的rec_lsn(偏小但安全)
+ * @param {frame_id_t} frame_id 写回的帧
+ * @param {bool} written 是否写回成功
+ */
+void BufferPoolInstance::end_write_back(frame_id_t frame_id, bool written) {
+    Page *page = pages_ + frame_id;
+    if (!written) {
+        page->is_dirty_ = true;
+    } else if (!page->is_dirty_) {
+        page->rec_lsn_.store(INVALID_LSN, std::memory_order_relaxed);
+    }
+    page->write_in_progress_ = false;
+    unpin_frame(frame_id);
+    io_cv_.notify_all();
+}
+
+/**
+ * @description: 在不阻塞前台访问的情况下同步写回一个脏帧，调用时需持有latch_，返回时仍持有latch_
+ * @return {bool} 是否写回了该帧
+ * @param {unique_lock<mutex>&} lock 持有latch_的锁
+ * @param {frame_id_t} frame_id 要写回的帧
+ * @param {char*} buf 大小为PAGE_SIZE的拷贝缓冲区
+ */
+bool BufferPoolInstance::write_back_frame(std::unique_lock<std::mutex> &lock, frame_id_t frame_id, char *buf) {
+    if (!begin_write_back(frame_id)) {
+        return false;
+    }
+    PageId page_id = pages_[frame_id].id_;
+    lock.unlock();
+
+    bool written = true;
+    try {
+        copy_for_write_back(frame_id, buf);
+        disk_manager_->write_page(page_id.fd, page_id.page_no, buf, PAGE_SIZE);
+    } catch (...) {
+        written = false;
+    }
+
+    lock.lock();
+    end_write_back(frame_id, written);
+    return written;
+}
+
+/**
+ * @description: 后台刷脏：当本分片的脏页数超过target_dirty时，写回至多max_pages个未被pin住的脏页。
+ *               优先写回replacer即将淘汰的帧，不足时再从flush_cursor_开始顺序扫描帧数组
+ * @return {size_t} 写回的页面数
+ * @param {size_t} target_dirty 本分片允许保留的脏页数
+ * @param {size_t} max_pages 本次最多写回的页面数
+ */
+size_t BufferPoolInstance::flush_dirty_pages(size_t target_dirty, size_t max_pages) {
+    std::unique_lock<std::mutex> lock{latch_};
+    size_t num_dirty = 0;
+    for (size_t i = 0; i < pool_size_; i++) {
+        if (pages_[i].is_dirty_ && pages_[i].id_.page_no != INVALID_PAGE_ID) {
+            num_dirty++;
+        }
+    }
+    if (num_dirty <= target_dirty) {
+        return 0;
+    }
+    size_t todo = std::min(num_dirty - target_dirty, max_pages);
+    std::vector<frame_id_t> candidates;
+    replacer_->peek_victims(&candidates, todo * 2);
+
+    alignas(PAGE_SIZE) char buf[PAGE_SIZE];
+    size_t flushed = 0;
+    for (frame_id_t fid : candidates) {
+        if (flushed >= todo) {
+            break;
+        }
+        if (pages_[fid].pin_count_ == 0 && write_back_frame(lock, fid, buf)) {
+            flushed++;
+        }
+    }
+    for (size_t i = 0; i < pool_size_ && flushed < todo; i++) {
+        frame_id_t fid = static_cast<frame_id_t>(flush_cursor_);
+        flush_cursor_ = (flush_cursor_ + 1) % pool_size_;
+        if (pages_[fid].pin_count_ == 0 && write_back_frame(lock, fid, buf)) {
+            flushed++;
+        }
+    }
+    return flushed;
+}
+
+/**
+ * @description: 检查点刷脏：写回调用时本分片中所有的脏页(包括被pin住的页)。
+ *               写回时不持有latch_，不会暂停前台的读写(fuzzy checkpoint)；
+ *               每批页面通过DiskManager的异步接口一次提交，io_uring后端下可同时有多个写请求在途
+ * @return {size_t} 写回的页面数
+ */
+size_t BufferPoolInstance::flush_all_dirty_pages() {
+    std::unique_lock<std::mutex> lock{latch_};
+    std::vector<std::pair<frame_id_t, PageId>> dirty_frames;
+    for (size_t i = 0; i < pool_size_; i++) {
+        if (pages_[i].is_dirty_ && pages_[i].id_.page_no != INVALID_PAGE_ID) {
+            dirty_frames.emplace_back(static_cast<frame_id_t>(i), pages_[i].id_);
+        }
+    }
+    // 每批至多IO_BATCH_SIZE个页面：持锁pin住后释放latch_，在页面读锁下拷贝，一次性提交所有异步写再统一等待
+    size_t batch_size = std::max<size_t>(std::min(dirty_frames.size(), IO_BATCH_SIZE), 1);
+    std::unique_ptr<char, decltype(&free)> bufs(static_cast<char *>(aligned_alloc(PAGE_SIZE, batch_size * PAGE_SIZE)),
+                                                &free);
+    if (bufs == nullptr) {
+        throw std::bad_alloc();
+    }
+    size_t flushed = 0;
+    for (size_t begin = 0; begin < dirty_frames.size(); begin += IO_BATCH_SIZE) {
+        size_t end = std::min(begin + IO_BATCH_SIZE, dirty_frames.size());
+        std::vector<std::pair<frame_id_t, PageId>> batch;
+        for (size_t i = begin; i < end; i++) {
+            auto &entry = dirty_frames[i];
+            // 帧在此期间可能已被淘汰(淘汰时已写回)或装入了其他页面
+            if (pages_[entry.first].id_ == entry.second && begin_write_back(entry.first)) {
+                batch.push_back(entry);
+            }
+        }
+        lock.unlock();
+
+        std::vector<IoHandle> handles;
+        std::vector<bool> written(batch.size(), false);
+        try {
+            for (size_t i = 0; i < batch.size(); i++) {
+                copy_for_write_back(batch[i].first, bufs.get() + i * PAGE_SIZE);
+            }
+            for (size_t i = 0; i < batch.size(); i++) {
+                handles.push_back(disk_manager_->write_page_async(batch[i].second.fd, batch[i].second.page_no,
+                                                                  bufs.get() + i * PAGE_SIZE, PAGE_SIZE));
+            }
+            disk_manager_->submit_io();
+        } catch (...) {
+        }
+        for (size_t i = 0; i < handles.size(); i++) {
+            try {
+                handles[i]->wait();
+                written[i] = true;
+            } catch (...) {
+            }
+        }
+
+        lock.lock();
+        for (size_t i = 0; i < batch.size(); i++) {
+            end_write_back(batch[i].first, written[i]);
+            flushed += written[i];
+        }
+    }
+    return flushed;
+}
+
+/**
+ * @description: 检查点读取脏页表：本分片中有rec_lsn的脏页，包括正在后台写回和正在被淘汰写回的页面
+ * @param {vector<pair<PageId, lsn_t>>*} dirty_pages 追加(页面, rec_lsn)
+ */
+void BufferPoolInstance::get_dirty_pages(std::vector<std::pair<PageId, lsn_t>> *dirty_pages) {
+    std::scoped_lock lock{latch_};
+    for (size_t i = 0; i < pool_size_; i++) {
+        Page *page = pages_ + i;
+        lsn_t rec_lsn = page->get_rec_lsn();
+        if ((page->is_dirty_ || page->write_in_progress_) && page->id_.page_no != INVALID_PAGE_ID &&
+            rec_lsn != INVALID_LSN) {
+            dirty_pages->emplace_back(page->id_, rec_lsn);
+        }
+    }
+    for (auto &entry : flushing_) {
+        if (entry.second != INVALID_LSN) {
+            dirty_pages->emplace_back(entry.first, entry.second);
+        }
+    }
+}
+
+/**
+ * @description: 缓存在本分片中的页面，按最近访问从新到旧排列：被pin住的页面在前，其余页面按replacer淘汰顺序的逆序
+ * @param {vector<PageId>*} page_ids 追加本分片的页面
+ */
+void BufferPoolInstance::get_resident_pages(std::vector<PageId> *page_ids) {
+    std::scoped_lock lock{latch_};
+    std::vector<frame_id_t> victims;
+    replacer_->peek_victims(&victims, pool_size_);
+    std::vector<bool> evictable(pool_size_, false);
+    for (frame_id_t fid : victims) {
+        evictable[fid] = true;
+    }
+    for (size_t i = 0; i < pool_size_; i++) {
+        if (!evictable[i] && pages_[i].pin_count_ > 0 && pages_[i].id_.page_no != INVALID_PAGE_ID) {
+            page_ids->push_back(pages_[i].id_);
+        }
+    }
+    for (auto it = victims.rbegin(); it != victims.rend(); ++it) {
+        if (pages_[*it].id_.page_no != INVALID_PAGE_ID) {
+            page_ids->push_back(pages_[*it].id_);
+        }
+    }
+}
+
+/**
+ * @description: 预读：把不在缓冲池中的页面批量读入空闲帧或可淘汰帧，读入后不pin住，以扫描模式登记到replacer。
+ *               一次至多占用本分片1/4的帧，避免预读挤掉工作集；异步后端下所有读请求一次提交，
+ *               同步后端下页号连续的页面合并为一次向量读
+ * @return {size_t} 实际读入的页面数
+ * @param {vector<PageId>&} page_ids 需要预读的页面，按扫描顺序排列
+ * @param {bool} free_frames_only 只使用空闲帧，不淘汰任何页面，也不限制占用的帧数，用于启动时预热缓冲池
+ */
+size_t BufferPoolInstance::prefetch_pages(const std::vector<PageId> &page_ids, bool free_frames_only) {
+    struct Prefetch {
+        frame_id_t frame_id;
+        PageId old_page_id;
+        bool write_back;
+        bool written_back;
+        bool done;
+    };
+    std::unique_lock<std::mutex> lock{latch_};
+    size_t limit = free_frames_only ? page_ids.size() : std::max<size_t>(pool_size_ / 4, 1);
+    std::vector<Prefetch> batch;
+    for (auto &page_id : page_ids) {
+        if (batch.size() >= limit || (free_frames_only && free_list_.empty())) {
+            break;
+        }
+        frame_id_t fid;
+        // 压缩页缓存中的页面在被访问时才解码
+        if (page_table_.find(page_id, &fid) || flushing_.count(page_id) || compressed_.count(page_id)) {
+            continue;
+        }
+        frame_id_t victim;
+        if (!find_victim_page(&victim)) {
+            break;
+        }
+        Prefetch prefetch{victim, PageId{}, false, false, false};
+        prefetch.write_back = update_page(pages_ + victim, page_id, victim, &prefetch.old_page_id);
+        replacer_->record_access(victim, AccessType::Scan);
+        batch.push_back(prefetch);
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+    lock.unlock();
+
+    // 先写回被淘汰的脏页，帧中的旧数据写回成功后才能被覆盖
+    for (auto &prefetch : batch) {
+        Page *page = pages_ + prefetch.frame_id;
+        if (prefetch.write_back) {
+            try {
+                disk_manager_->write_page(prefetch.old_page_id.fd, prefetch.old_page_id.page_no, page->data_,
+                                          PAGE_SIZE);
+                prefetch.written_back = true;
+            } catch (...) {
+            }
+        }
+    }
+    if (disk_manager_->is_async_io()) {
+        std::vector<std::pair<size_t, IoHandle>> handles;
+        try {
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (batch[i].write_back && !batch[i].written_back) {
+                    continue;
+                }
+                Page *page = pages_ + batch[i].frame_id;
+                handles.emplace_back(
+                    i, disk_manager_->read_page_async(page->id_.fd, page->id_.page_no, page->data_, PAGE_SIZE));
+            }
+            disk_manager_->submit_io();
+        } catch (...) {
+        }
+        for (auto &handle : handles) {
+            try {
+                handle.second->wait();
+                batch[handle.first].done = true;
+            } catch (...) {
+            }
+        }
+    } else {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (!batch[i].write_back || batch[i].written_back) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return pages_[batch[a].frame_id].id_.page_no < pages_[batch[b].frame_id].id_.page_no;
+        });
+        std::vector<char *> bufs;
+        for (size_t begin = 0, end; begin < order.size(); begin = end) {
+            PageId first = pages_[batch[order[begin]].frame_id].id_;
+            bufs.clear();
+            for (end = begin; end < order.size(); end++) {
+                PageId id = pages_[batch[order[end]].frame_id].id_;
+                if (id.fd != first.fd || id.page_no != first.page_no + static_cast<int>(end - begin)) {
+                    break;
+                }
+                bufs.push_back(pages_[batch[order[end]].frame_id].data_);
+            }
+            try {
+                disk_manager_->read_pages(first.fd, first.page_no, bufs.data(), static_cast<int>(bufs.size()));
+                for (size_t i = begin; i < end; i++) {
+                    batch[order[i]].done = true;
+                }
+            } catch (...) {
+            }
+        }
+    }
+
+    lock.lock();
+    size_t prefetched = 0;
+    for (auto &prefetch : batch) {
+        Page *page = pages_ + prefetch.frame_id;
+        if (!prefetch.done) {
+            abort_io(page, prefetch.frame_id, prefetch.write_back, prefetch.written_back, prefetch.old_page_id);
+            continue;
+        }
+        finish_io(page, prefetch.write_back, prefetch.old_page_id);
+        // 预读的页面不被pin住，若等待I/O的线程已经pin住了该页则由它们负责unpin
+        unpin_frame(prefetch.frame_id);
+        prefetched++;
+    }
+    return prefetched;
+}
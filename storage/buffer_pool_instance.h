@@ -0,0 +1,186 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "disk_manager.h"
+#include "errors.h"
+#include "page.h"
+#include "page_codec.h"
+#include "page_table.h"
+#include "replacer/clock_replacer.h"
+#include "replacer/lru_replacer.h"
+#include "replacer/replacer.h"
+#include "replacer/two_queue_replacer.h"
+
+/**
+ * 当前线程调用fetch_page的次数、其中命中缓冲池的次数和扫描读到的记录数，EXPLAIN ANALYZE按算子统计访问的页面，
+ * 慢查询日志统计每条语句访问的页面和记录。并行扫描结束时把线程池中worker的计数加到发起扫描的线程上
+ */
+struct PageAccessCounter {
+    uint64_t fetches = 0;
+    uint64_t hits = 0;
+    uint64_t rows = 0;      // 顺序扫描读到的页面上的记录数与索引扫描经过的索引项数之和
+
+    static PageAccessCounter &local() {
+        thread_local PageAccessCounter counter;
+        return counter;
+    }
+};
+
+/**
+ * @description: 缓冲池的一个分片。每个分片拥有独立的帧数组、页表、空闲链表、置换器和互斥锁，
+ *               由BufferPoolManager根据PageId的哈希值将请求路由到对应分片，从而避免所有线程争用同一把锁
+ */
+class BufferPoolInstance {
+   private:
+    size_t pool_size_;      // 本分片中可容纳页面的个数，即帧的个数
+    Page *pages_;           // 本分片的Page对象数组，在构造函数中申请内存空间，在析构函数中释放，大小为pool_size_
+    char *data_arena_;      // 所有帧的页面数据，按PAGE_SIZE对齐的连续内存，与Page元数据分开存放，满足O_DIRECT的对齐要求
+    size_t arena_size_;     // 数据区映射的字节数，按大页大小向上取整
+    PageTable page_table_;  // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号，命中时可以不加锁查找
+    std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    DiskManager *disk_manager_;
+    Replacer *replacer_;    // 本分片的置换策略，LRU、CLOCK或2Q
+    std::mutex latch_;      // 用于本分片共享数据结构的并发控制，磁盘I/O期间不持有该锁
+    std::condition_variable io_cv_;     // 等待帧上的I/O完成
+    std::unordered_map<PageId, lsn_t, PageIdHash> flushing_;   // 已离开page_table_但仍在写回磁盘的被淘汰页 -> 它的rec_lsn
+    size_t flush_cursor_ = 0;           // 后台刷脏时顺序扫描帧数组的游标
+
+    /* 压缩页缓存：注册了编解码器的文件的页面被淘汰时编码后保存在这里，缺页时解码而不读磁盘。
+       一个页面要么在帧中，要么在压缩页缓存中，不会同时存在：读入帧时取走编码结果，淘汰时重新编码，
+       因此缓存中的编码结果总是该页的最新内容。超出容量时按进入缓存的顺序丢弃 */
+    struct CompressedPage {
+        std::shared_ptr<const std::string> data;
+        std::list<PageId>::iterator pos;    // 在compressed_order_中的位置
+    };
+    std::unordered_map<int, std::shared_ptr<const PageCodec>> codecs_;     // fd -> 编解码器
+    std::unordered_map<PageId, CompressedPage, PageIdHash> compressed_;
+    std::list<PageId> compressed_order_;    // 按进入缓存的顺序排列的页面
+    size_t compressed_bytes_ = 0;
+    size_t compressed_capacity_;            // 压缩页缓存的字节数上限
+    int numa_node_;                         // 帧数据区所在的NUMA结点，-1表示未指定
+
+   public:
+    /**
+     * @param {int} numa_node 帧数据区优先分配在该NUMA结点上，为-1时不指定
+     */
+    BufferPoolInstance(size_t pool_size, DiskManager *disk_manager, size_t compressed_capacity = 0,
+                       int numa_node = -1)
+        : pool_size_(pool_size), page_table_(pool_size), disk_manager_(disk_manager),
+          compressed_capacity_(compressed_capacity), numa_node_(numa_node) {
+        // 为分片分配一块连续的内存空间，页面数据按PAGE_SIZE对齐
+        pages_ = new Page[pool_size_];
+        try {
+            data_arena_ = allocate_arena(pool_size_ * PAGE_SIZE, &arena_size_, numa_node_);
+        } catch (...) {
+            delete[] pages_;
+            throw;
+        }
+        for (size_t i = 0; i < pool_size_; ++i) {
+            pages_[i].data_ = data_arena_ + i * PAGE_SIZE;
+            pages_[i].reset_memory();
+        }
+        // 可以被Replacer改变，由config.h中的REPLACER_TYPE选择
+        if (REPLACER_TYPE == "CLOCK")
+            replacer_ = new ClockReplacer(pool_size_);
+        else if (REPLACER_TYPE == "2Q")
+            replacer_ = new TwoQueueReplacer(pool_size_);
+        else {
+            replacer_ = new LRUReplacer(pool_size_);
+        }
+        // 初始化时，所有的page都在free_list_中
+        for (size_t i = 0; i < pool_size_; ++i) {
+            free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+        }
+    }
+
+    ~BufferPoolInstance() {
+        delete[] pages_;
+        free_arena(data_arena_, arena_size_);
+        delete replacer_;
+    }
+
+    size_t get_pool_size() const { return pool_size_; }
+
+    int get_numa_node() const { return numa_node_; }
+
+   public:
+    Page* fetch_page(PageId page_id, AccessType access_type = AccessType::Normal);
+
+    bool unpin_page(PageId page_id, bool is_dirty);
+
+    bool flush_page(PageId page_id);
+
+    Page* new_page(PageId* page_id);
+
+    bool delete_page(PageId page_id);
+
+    void flush_all_pages(int fd);
+
+    size_t flush_dirty_pages(size_t target_dirty, size_t max_pages);
+
+    size_t flush_all_dirty_pages();
+
+    void get_dirty_pages(std::vector<std::pair<PageId, lsn_t>> *dirty_pages);
+
+    size_t prefetch_pages(const std::vector<PageId>& page_ids, bool free_frames_only = false);
+
+    void get_resident_pages(std::vector<PageId> *page_ids);
+
+    // 页面是否在本分片中，无锁查找页表，结果只是估计，返回后页面仍可能被淘汰或读入
+    bool is_resident(PageId page_id) const {
+        frame_id_t fid;
+        return page_table_.find(page_id, &fid);
+    }
+
+    void set_page_codec(int fd, std::shared_ptr<const PageCodec> codec);
+
+    std::shared_ptr<const std::string> get_compressed_page(PageId page_id);
+
+    size_t get_compressed_bytes();
+
+   private:
+    static char* allocate_arena(size_t size, size_t* mapped_size, int numa_node = -1);
+
+    static void free_arena(char* arena, size_t mapped_size);
+
+    bool find_victim_page(frame_id_t* frame_id);
+
+    bool try_pin(Page* page, PageId page_id);
+
+    void release_pin(frame_id_t frame_id);
+
+    void unpin_frame(frame_id_t frame_id);
+
+    bool begin_write_back(frame_id_t frame_id, bool force = false);
+
+    void copy_for_write_back(frame_id_t frame_id, char* buf);
+
+    void end_write_back(frame_id_t frame_id, bool written);
+
+    bool write_back_frame(std::unique_lock<std::mutex>& lock, frame_id_t frame_id, char* buf);
+
+    bool update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id, PageId* old_page_id);
+
+    void compress_page(Page* page);
+
+    std::shared_ptr<const std::string> take_compressed(PageId page_id);
+
+    void erase_compressed(PageId page_id);
+
+    void finish_io(Page* page, bool write_back, PageId old_page_id);
+
+    void abort_io(Page* page, frame_id_t frame_id, bool write_back, bool written_back, PageId old_page_id);
+};
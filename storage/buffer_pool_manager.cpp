@@ -1,68 +1,33 @@
 #include "buffer_pool_manager.h"
 
-/**
- * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
- * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
- * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
- */
-bool BufferPoolManager::find_victim_page(frame_id_t* frame_id) {
-    if (!free_list_.empty()) {
-        *frame_id = free_list_.front();
-        free_list_.pop_front();
-        return true;
-    }
-    return replacer_->victim(frame_id);
-}
+#include <algorithm>
+#include <unordered_map>
+
+#include "errors.h"
 
 /**
- * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page table
- * @param {Page*} page 写回页指针
- * @param {PageId} new_page_id 新的page_id
- * @param {frame_id_t} new_frame_id 新的帧frame_id
+ * @description: 根据PageId选择其所属的分片。分片由哈希值的低位决定，分片内的页表使用高位
+ * @return {BufferPoolInstance*} 目标页所在的分片
+ * @param {PageId&} page_id 目标页
  */
-void BufferPoolManager::update_page(Page *page, PageId new_page_id, frame_id_t new_frame_id) {
-    PageId old_id = page->id_;
-    if (page->is_dirty_ && old_id.page_no != INVALID_PAGE_ID) {
-        disk_manager_->write_page(old_id.fd, old_id.page_no, page->data_, PAGE_SIZE);
-        page->is_dirty_ = false;
+BufferPoolInstance* BufferPoolManager::get_instance(const PageId &page_id) {
+    if (instances_.size() == 1) {
+        return instances_[0].get();
     }
-    if (old_id.page_no != INVALID_PAGE_ID) {
-        page_table_.erase(old_id);
-    }
-    page->reset_memory();
-    page->id_ = new_page_id;
-    page->pin_count_ = 0;
-    page->is_dirty_ = false;
-    page_table_[new_page_id] = new_frame_id;
+    return instances_[PageIdHash()(page_id) % instances_.size()].get();
 }
 
 /**
- * @description: 从buffer pool获取需要的页。
- *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
- *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim page，将其替换为磁盘中读取的page，pin_count置1。
+ * @description: 从buffer pool获取需要的页，具体逻辑见BufferPoolInstance::fetch_page
  * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
  * @param {PageId} page_id 需要获取的页的PageId
+ * @param {AccessType} access_type 访问模式提示，顺序扫描应传入AccessType::Scan
  */
-Page* BufferPoolManager::fetch_page(PageId page_id) {
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it != page_table_.end()) {
-        frame_id_t fid = it->second;
-        Page *page = pages_ + fid;
-        page->pin_count_++;
-        replacer_->pin(fid);
-        return page;
-    }
-    frame_id_t victim;
-    if (!find_victim_page(&victim)) {
-        return nullptr;
-    }
-    Page *page = pages_ + victim;
-    update_page(page, page_id, victim);
-    disk_manager_->read_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
-    page->pin_count_ = 1;
-    replacer_->pin(victim);
-    return page;
+Page* BufferPoolManager::fetch_page(PageId page_id, AccessType access_type) {
+    if (MappedFile *file = mapped(page_id.fd)) {
+        return file->page(page_id.page_no);
+    }
+    return get_instance(page_id)->fetch_page(page_id, access_type);
 }
 
 /**
@@ -72,23 +37,11 @@ Page* BufferPoolManager::fetch_page(PageId page_id) {
  * @param {bool} is_dirty 若目标page应该被标记为dirty则为true，否则为false
  */
 bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
-        return false;
-    }
-    Page *page = pages_ + it->second;
-    if (page->pin_count_ <= 0) {
-        return false;
-    }
-    page->pin_count_--;
-    if (page->pin_count_ == 0) {
-        replacer_->unpin(it->second);
-    }
-    if (is_dirty) {
-        page->is_dirty_ = true;
+    if (mapped(page_id.fd) != nullptr) {
+        assert(!is_dirty);
+        return true;
     }
-    return true;
+    return get_instance(page_id)->unpin_page(page_id, is_dirty);
 }
 
 /**
@@ -97,37 +50,32 @@ bool BufferPoolManager::unpin_page(PageId page_id, bool is_dirty) {
  * @param {PageId} page_id 目标页的page_id，不能为INVALID_PAGE_ID
  */
 bool BufferPoolManager::flush_page(PageId page_id) {
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
-        return false;
+    if (mapped(page_id.fd) != nullptr) {
+        return true;
     }
-    Page *page = pages_ + it->second;
-    disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
-    page->is_dirty_ = false;
-    return true;
+    return get_instance(page_id)->flush_page(page_id);
 }
 
 /**
- * @description: 创建一个新的page，即从磁盘中移动一个新建的空page到缓冲池某个位置。
+ * @description: 创建一个新的page。
+ *               单分片时与原先一致，找到可用帧后才分配页号；
+ *               多分片时必须先分配页号才能确定分片，若该分片的帧全部被pin住则返回nullptr，已分配的页号不再回收
  * @return {Page*} 返回新创建的page，若创建失败则返回nullptr
  * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
  */
 Page* BufferPoolManager::new_page(PageId* page_id) {
-    std::scoped_lock lock{latch_};
-    frame_id_t victim;
-    if (!find_victim_page(&victim)) {
-        return nullptr;
-    }
-    Page *page = pages_ + victim;
-    PageId new_id;
-    new_id.fd = page_id->fd;
-    new_id.page_no = disk_manager_->allocate_page(new_id.fd);
-    update_page(page, new_id, victim);
-    page->pin_count_ = 1;
-    page->is_dirty_ = true;
-    replacer_->pin(victim);
-    *page_id = new_id;
+    if (mapped(page_id->fd) != nullptr) {
+        throw InternalError("BufferPoolManager::new_page: file is mapped read-only");
+    }
+    if (instances_.size() == 1) {
+        page_id->page_no = INVALID_PAGE_ID;
+        return instances_[0]->new_page(page_id);
+    }
+    PageId new_id{page_id->fd, disk_manager_->allocate_page(page_id->fd)};
+    Page *page = get_instance(new_id)->new_page(&new_id);
+    if (page != nullptr) {
+        *page_id = new_id;
+    }
     return page;
 }
 
@@ -137,41 +85,204 @@ Page* BufferPoolManager::new_page(PageId* page_id) {
  * @param {PageId} page_id 目标页
  */
 bool BufferPoolManager::delete_page(PageId page_id) {
-    std::scoped_lock lock{latch_};
-    auto it = page_table_.find(page_id);
-    if (it == page_table_.end()) {
+    if (mapped(page_id.fd) != nullptr) {
         return true;
     }
-    Page *page = pages_ + it->second;
-    if (page->pin_count_ > 0) {
-        return false;
+    return get_instance(page_id)->delete_page(page_id);
+}
+
+/**
+ * @description: 将buffer_pool中属于fd文件的所有页写回到磁盘，逐个分片加锁刷写
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::flush_all_pages(int fd) {
+    for (auto &instance : instances_) {
+        instance->flush_all_pages(fd);
+    }
+}
+
+/**
+ * @description: 后台刷脏，使每个分片的脏页比例降到dirty_ratio以下，max_pages按分片平均分配
+ * @return {size_t} 写回的页面数
+ * @param {double} dirty_ratio 允许保留的脏页比例
+ * @param {size_t} max_pages 本次最多写回的页面数
+ */
+size_t BufferPoolManager::flush_dirty_pages(double dirty_ratio, size_t max_pages) {
+    size_t per_instance = std::max<size_t>(max_pages / instances_.size(), 1);
+    size_t flushed = 0;
+    for (auto &instance : instances_) {
+        size_t target_dirty = static_cast<size_t>(dirty_ratio * instance->get_pool_size());
+        flushed += instance->flush_dirty_pages(target_dirty, per_instance);
+    }
+    return flushed;
+}
+
+/**
+ * @description: 写回缓冲池中当前所有的脏页，不阻塞前台访问，用于检查点
+ * @return {size_t} 写回的页面数
+ */
+size_t BufferPoolManager::flush_all_dirty_pages() {
+    size_t flushed = 0;
+    for (auto &instance : instances_) {
+        flushed += instance->flush_all_dirty_pages();
+    }
+    return flushed;
+}
+
+/**
+ * @description: 返回缓冲池的脏页表，即有rec_lsn的脏页及其rec_lsn，用于检查点。各分片依次读取，不暂停前台访问
+ * @return {vector<pair<PageId, lsn_t>>} (页面, rec_lsn)
+ */
+std::vector<std::pair<PageId, lsn_t>> BufferPoolManager::get_dirty_pages() {
+    std::vector<std::pair<PageId, lsn_t>> dirty_pages;
+    for (auto &instance : instances_) {
+        instance->get_dirty_pages(&dirty_pages);
+    }
+    return dirty_pages;
+}
+
+/**
+ * @description: 页面是否在缓冲池中，不加锁也不pin住页面，用于估计访问页面是否需要读盘
+ * @param {PageId} page_id 页面
+ */
+bool BufferPoolManager::is_resident(PageId page_id) {
+    if (MappedFile *file = mapped(page_id.fd)) {
+        return file->page(page_id.page_no) != nullptr;
+    }
+    return get_instance(page_id)->is_resident(page_id);
+}
+
+/**
+ * @description: 缓冲池中的所有页面，按最近访问从新到旧排列。各分片分别排序后轮流取出，得到近似的全局顺序
+ * @return {vector<PageId>} 页面
+ */
+std::vector<PageId> BufferPoolManager::get_resident_pages() {
+    std::vector<std::vector<PageId>> lists(instances_.size());
+    size_t max_size = 0;
+    for (size_t i = 0; i < instances_.size(); i++) {
+        instances_[i]->get_resident_pages(&lists[i]);
+        max_size = std::max(max_size, lists[i].size());
     }
-    replacer_->pin(it->second);
-    if (page->is_dirty_) {
-        disk_manager_->write_page(page_id.fd, page_id.page_no, page->data_, PAGE_SIZE);
+    std::vector<PageId> page_ids;
+    for (size_t rank = 0; rank < max_size; rank++) {
+        for (auto &list : lists) {
+            if (rank < list.size()) {
+                page_ids.push_back(list[rank]);
+            }
+        }
     }
-    page_table_.erase(it);
-    page->reset_memory();
-    page->id_.page_no = INVALID_PAGE_ID;
-    page->id_.fd = page_id.fd;
-    page->is_dirty_ = false;
-    page->pin_count_ = 0;
-    free_list_.push_back(static_cast<frame_id_t>(page - pages_));
-    return true;
+    return page_ids;
 }
 
 /**
- * @description: 将buffer_pool中的所有页写回到磁盘
+ * @description: 预读fd文件中的若干页面到缓冲池，页面按所属分片分组后批量读入
+ * @return {size_t} 实际读入的页面数
  * @param {int} fd 文件句柄
+ * @param {vector<page_id_t>&} page_nos 需要预读的页号
+ * @param {bool} free_frames_only 只读入空闲帧，不淘汰已缓存的页面
  */
-void BufferPoolManager::flush_all_pages(int fd) {
-    std::scoped_lock lock{latch_};
-    for (auto &entry : page_table_) {
-        if (entry.first.fd == fd) {
-            PageId pid = entry.first;
-            Page *page = pages_ + entry.second;
-            disk_manager_->write_page(pid.fd, pid.page_no, page->data_, PAGE_SIZE);
-            page->is_dirty_ = false;
+size_t BufferPoolManager::prefetch_pages(int fd, const std::vector<page_id_t> &page_nos, bool free_frames_only) {
+    if (MappedFile *file = mapped(fd)) {
+        for (page_id_t page_no : page_nos) {
+            file->will_need(page_no, 1);
+        }
+        return 0;
+    }
+    if (instances_.size() == 1) {
+        std::vector<PageId> page_ids;
+        for (page_id_t page_no : page_nos) {
+            page_ids.push_back(PageId{fd, page_no});
         }
+        return instances_[0]->prefetch_pages(page_ids, free_frames_only);
+    }
+    std::unordered_map<BufferPoolInstance *, std::vector<PageId>> groups;
+    for (page_id_t page_no : page_nos) {
+        PageId page_id{fd, page_no};
+        groups[get_instance(page_id)].push_back(page_id);
+    }
+    size_t prefetched = 0;
+    for (auto &group : groups) {
+        prefetched += group.first->prefetch_pages(group.second, free_frames_only);
+    }
+    return prefetched;
+}
+
+/**
+ * @description: 预读fd文件中页号为[start_page_no, start_page_no + num_pages)的页面，用于顺序扫描。
+ *               只读映射的文件只提示内核预读，不读入缓冲池
+ * @return {size_t} 实际读入的页面数
+ * @param {int} fd 文件句柄
+ * @param {page_id_t} start_page_no 起始页号
+ * @param {int} num_pages 页面数
+ */
+size_t BufferPoolManager::prefetch_pages(int fd, page_id_t start_page_no, int num_pages) {
+    if (MappedFile *file = mapped(fd)) {
+        file->will_need(start_page_no, num_pages);
+        return 0;
+    }
+    std::vector<page_id_t> page_nos;
+    for (int i = 0; i < num_pages; i++) {
+        page_nos.push_back(start_page_no + i);
+    }
+    return prefetch_pages(fd, page_nos);
+}
+
+/**
+ * @description: 注册或注销fd文件的页面编解码器，注册后该文件被淘汰的页面编码后保存在压缩页缓存中，
+ *               具体逻辑见BufferPoolInstance::set_page_codec
+ * @param {int} fd 文件句柄
+ * @param {shared_ptr<const PageCodec>} codec 编解码器，为nullptr时注销并丢弃该文件在压缩页缓存中的页面
+ */
+void BufferPoolManager::set_page_codec(int fd, std::shared_ptr<const PageCodec> codec) {
+    for (auto &instance : instances_) {
+        instance->set_page_codec(fd, codec);
+    }
+}
+
+/**
+ * @description: 读取压缩页缓存中页面的编码结果，不把页面读入缓冲池，具体逻辑见BufferPoolInstance::get_compressed_page
+ * @return {shared_ptr<const string>} 编码结果，页面不在压缩页缓存中时为nullptr
+ * @param {PageId} page_id 目标页
+ */
+std::shared_ptr<const std::string> BufferPoolManager::get_compressed_page(PageId page_id) {
+    return get_instance(page_id)->get_compressed_page(page_id);
+}
+
+/**
+ * @description: 所有分片的压缩页缓存占用的字节数之和
+ */
+size_t BufferPoolManager::get_compressed_bytes() {
+    size_t bytes = 0;
+    for (auto &instance : instances_) {
+        bytes += instance->get_compressed_bytes();
+    }
+    return bytes;
+}
+
+/**
+ * @description: 把以只读方式打开的fd文件整个映射到内存，此后该文件的页面由fetch_page直接从映射中返回，
+ *               pin、unpin和写回都不需要操作。缓冲池中该fd的页面(例如同一fd上次打开的文件留下的)被丢弃，
+ *               调用时不能有脏页或被pin住的页面，映射期间文件不能被修改
+ * @param {int} fd 文件句柄
+ * @param {Advice} advice 访问模式提示
+ */
+void BufferPoolManager::map_file(int fd, MappedFile::Advice advice) {
+    if (fd < 0 || fd >= DiskManager::MAX_FD) {
+        throw InternalError("BufferPoolManager::map_file: fd out of range");
+    }
+    auto file = std::make_unique<MappedFile>(fd, advice);
+    for (page_id_t page_no = 0; page_no < file->num_pages(); page_no++) {
+        delete_page(PageId{fd, page_no});
+    }
+    delete mapped_[fd].exchange(file.release(), std::memory_order_acq_rel);
+}
+
+/**
+ * @description: 解除fd文件的映射，关闭文件之前调用，调用时不能再有线程持有该文件的页面
+ * @param {int} fd 文件句柄
+ */
+void BufferPoolManager::unmap_file(int fd) {
+    if (fd >= 0 && fd < DiskManager::MAX_FD) {
+        delete mapped_[fd].exchange(nullptr, std::memory_order_acq_rel);
     }
 }
@@ -1,50 +1,54 @@
 #pragma once
-#include <fcntl.h>
-#include <unistd.h>
-
-#include <cassert>
-#include <list>
-#include <unordered_map>
+#include <atomic>
+#include <memory>
 #include <vector>
 
-#include "disk_manager.h"
-#include "errors.h"
-#include "page.h"
-#include "replacer/lru_replacer.h"
-#include "replacer/replacer.h"
+#include "buffer_pool_instance.h"
+#include "common/numa.h"
+#include "mapped_file.h"
 
+/**
+ * @description: 分片缓冲池。对外接口与单实例缓冲池保持一致，内部由若干BufferPoolInstance组成，
+ *               根据PageId的哈希值选择分片，不同分片上的缺页和淘汰互不阻塞
+ */
 class BufferPoolManager {
    private:
-    size_t pool_size_;      // buffer_pool中可容纳页面的个数，即帧的个数
-    Page *pages_;           // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
-    std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    size_t pool_size_;      // buffer_pool中可容纳页面的总个数，即所有分片的帧数之和
     DiskManager *disk_manager_;
-    Replacer *replacer_;    // buffer_pool的置换策略，当前赛题中为LRU置换策略
-    std::mutex latch_;      // 用于共享数据结构的并发控制
+    std::vector<std::unique_ptr<BufferPoolInstance>> instances_;    // 缓冲池分片
+    // fd -> 只读映射的文件，这些文件的页面直接从映射中读取，不进入缓冲池
+    std::unique_ptr<std::atomic<MappedFile *>[]> mapped_ =
+        std::make_unique<std::atomic<MappedFile *>[]>(DiskManager::MAX_FD);
 
    public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
+    /**
+     * @param {size_t} pool_size 缓冲池总帧数
+     * @param {DiskManager*} disk_manager
+     * @param {size_t} num_instances 分片个数，为0时根据pool_size自动选择：
+     *                 只有每个分片至少能分到BUFFER_POOL_MIN_INSTANCE_SIZE个帧时才分片，否则退化为单个分片
+     * @param {size_t} compressed_cache_size 压缩页缓存的总字节数，按分片平均分配
+     */
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, size_t num_instances = 0,
+                      size_t compressed_cache_size = COMPRESSED_CACHE_SIZE)
         : pool_size_(pool_size), disk_manager_(disk_manager) {
-        // 为buffer pool分配一块连续的内存空间
-        pages_ = new Page[pool_size_];
-        // 可以被Replacer改变
-        if (REPLACER_TYPE.compare("LRU"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE.compare("CLOCK"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else {
-            replacer_ = new LRUReplacer(pool_size_);
+        if (num_instances == 0) {
+            num_instances = BUFFER_POOL_INSTANCES;
+            while (num_instances > 1 && pool_size_ / num_instances < BUFFER_POOL_MIN_INSTANCE_SIZE) {
+                num_instances /= 2;
+            }
         }
-        // 初始化时，所有的page都在free_list_中
-        for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
+        if (num_instances > pool_size_) {
+            num_instances = pool_size_ > 0 ? pool_size_ : 1;
+        }
+        // 多个NUMA结点时分片轮流分配在各结点上，页面按哈希值分散到分片，各结点的内存带宽被均匀使用
+        size_t num_nodes = BUFFER_POOL_NUMA ? NumaTopology::get().num_nodes() : 1;
+        // 前pool_size_ % num_instances个分片各多分一个帧，保证总帧数恰好为pool_size_
+        for (size_t i = 0; i < num_instances; ++i) {
+            size_t size = pool_size_ / num_instances + (i < pool_size_ % num_instances ? 1 : 0);
+            int numa_node = num_nodes > 1 ? static_cast<int>(i % num_nodes) : -1;
+            instances_.emplace_back(std::make_unique<BufferPoolInstance>(
+                size, disk_manager_, compressed_cache_size / num_instances, numa_node));
         }
-    }
-
-    ~BufferPoolManager() {
-        delete[] pages_;
-        delete replacer_;
     }
 
     /**
@@ -53,8 +57,18 @@ class BufferPoolManager {
      */
     static void mark_dirty(Page* page) { page->is_dirty_ = true; }
 
+    ~BufferPoolManager() {
+        for (int fd = 0; fd < DiskManager::MAX_FD; fd++) {
+            delete mapped_[fd].load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t get_pool_size() const { return pool_size_; }
+
+    size_t get_num_instances() const { return instances_.size(); }
+
    public: 
-    Page* fetch_page(PageId page_id);
+    Page* fetch_page(PageId page_id, AccessType access_type = AccessType::Normal);
 
     bool unpin_page(PageId page_id, bool is_dirty);
 
@@ -66,8 +80,36 @@ class BufferPoolManager {
 
     void flush_all_pages(int fd);
 
+    size_t flush_dirty_pages(double dirty_ratio, size_t max_pages);
+
+    size_t flush_all_dirty_pages();
+
+    std::vector<std::pair<PageId, lsn_t>> get_dirty_pages();
+
+    std::vector<PageId> get_resident_pages();
+
+    bool is_resident(PageId page_id);
+
+    size_t prefetch_pages(int fd, const std::vector<page_id_t>& page_nos, bool free_frames_only = false);
+
+    size_t prefetch_pages(int fd, page_id_t start_page_no, int num_pages);
+
+    void set_page_codec(int fd, std::shared_ptr<const PageCodec> codec);
+
+    std::shared_ptr<const std::string> get_compressed_page(PageId page_id);
+
+    size_t get_compressed_bytes();
+
+    void map_file(int fd, MappedFile::Advice advice);
+
+    void unmap_file(int fd);
+
+    bool is_mapped(int fd) const { return mapped(fd) != nullptr; }
+
    private:
-    bool find_victim_page(frame_id_t* frame_id);
+    BufferPoolInstance* get_instance(const PageId &page_id);
 
-    void update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id);
-};
\ No newline at end of file
+    MappedFile* mapped(int fd) const {
+        return fd >= 0 && fd < DiskManager::MAX_FD ? mapped_[fd].load(std::memory_order_acquire) : nullptr;
+    }
+};
@@ -0,0 +1,104 @@
+#include "buffer_pool_warmer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+
+/**
+ * @description: 把缓冲池中的页面按最近访问从新到旧写入文件。先写临时文件再改名，崩溃时不会留下不完整的文件
+ * @return {size_t} 写入的页面数
+ * @param {string&} file_name 输出文件
+ */
+size_t BufferPoolWarmer::dump(const std::string &file_name) {
+    std::vector<PageId> page_ids = buffer_pool_manager_->get_resident_pages();
+    std::unordered_map<int, std::string> names;     // fd -> 文件名，已关闭的文件为空
+    std::string tmp_name = file_name + ".tmp";
+    std::ofstream out(tmp_name, std::ios::trunc);
+    if (!out) {
+        return 0;
+    }
+    size_t num_pages = 0;
+    for (auto &page_id : page_ids) {
+        auto it = names.find(page_id.fd);
+        if (it == names.end()) {
+            std::string name;
+            try {
+                name = disk_manager_->get_file_name(page_id.fd);
+            } catch (FileNotOpenError &) {
+            }
+            it = names.emplace(page_id.fd, std::move(name)).first;
+        }
+        if (!it->second.empty()) {
+            out << it->second << ' ' << page_id.page_no << '\n';
+            num_pages++;
+        }
+    }
+    out.close();
+    if (!out || rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+        remove(tmp_name.c_str());
+        return 0;
+    }
+    return num_pages;
+}
+
+/**
+ * @description: 按文件中的顺序分批预读页面，只使用空闲帧。无法打开的文件和超出文件已分配页数的页面被跳过，
+ *               文件不存在时直接返回
+ * @return {size_t} 读入的页面数
+ * @param {string&} file_name dump()写入的文件
+ */
+size_t BufferPoolWarmer::load(const std::string &file_name) {
+    std::ifstream in(file_name);
+    std::unordered_map<std::string, int> fds;       // 文件名 -> fd，无法打开的文件为-1
+    std::string name;
+    page_id_t page_no;
+    size_t loaded = 0;
+    bool more = true;
+    while (more && !stop_) {
+        // 同一批中的页面按文件和页号排序，页号连续的页面由一次向量读读入
+        std::map<int, std::vector<page_id_t>> batch;
+        size_t batch_size = 0;
+        while (batch_size < WARMUP_BATCH_PAGES && (more = static_cast<bool>(in >> name >> page_no))) {
+            auto it = fds.find(name);
+            if (it == fds.end()) {
+                int fd = resolve_file_ != nullptr ? resolve_file_(name) : disk_manager_->find_file_fd(name);
+                it = fds.emplace(name, fd).first;
+            }
+            int fd = it->second;
+            if (fd != -1 && page_no >= 0 && page_no < disk_manager_->get_fd2pageno(fd)) {
+                batch[fd].push_back(page_no);
+                batch_size++;
+            }
+        }
+        for (auto &entry : batch) {
+            std::sort(entry.second.begin(), entry.second.end());
+            loaded += buffer_pool_manager_->prefetch_pages(entry.first, entry.second, true);
+        }
+        pages_loaded_ = loaded;
+    }
+    return loaded;
+}
+
+/**
+ * @description: 启动后台线程执行load()，重复调用无效
+ * @param {string&} file_name dump()写入的文件
+ */
+void BufferPoolWarmer::start(const std::string &file_name) {
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread([this, file_name] { load(file_name); });
+}
+
+/**
+ * @description: 停止后台预热并等待线程退出，正在读入的一批页面读完后停止
+ */
+void BufferPoolWarmer::stop() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "buffer_pool_manager.h"
+
+/**
+ * @description: 缓冲池预热。dump()把缓冲池中的页面按最近访问从新到旧写入文件，每行为"文件名 页号"，
+ *               重启后fd会变化，因此按文件名记录；start()在后台线程中按文件中的顺序分批预读这些页面，
+ *               每批按文件和页号排序后读入，页号连续的页面合并为一次大的顺序读。
+ *               预热只使用空闲帧，不会挤掉前台已经读入的页面，缓冲池没有空闲帧时结束
+ */
+class BufferPoolWarmer {
+   public:
+    // 按文件名取得文件的fd，文件不可用时返回-1
+    using FileResolver = std::function<int(const std::string &)>;
+
+    /**
+     * @param {FileResolver} resolve_file 预热时按文件名取得fd，表在第一次使用时才打开，由它打开文件所属的表；
+     *                                    为空时只预热已经打开的文件
+     */
+    BufferPoolWarmer(BufferPoolManager *buffer_pool_manager, DiskManager *disk_manager,
+                     FileResolver resolve_file = nullptr)
+        : buffer_pool_manager_(buffer_pool_manager), disk_manager_(disk_manager), resolve_file_(std::move(resolve_file)) {}
+
+    ~BufferPoolWarmer() { stop(); }
+
+    size_t dump(const std::string &file_name);
+
+    size_t load(const std::string &file_name);
+
+    void start(const std::string &file_name);
+
+    void stop();
+
+    size_t get_pages_loaded() const { return pages_loaded_.load(); }
+
+   private:
+    BufferPoolManager *buffer_pool_manager_;
+    DiskManager *disk_manager_;
+    FileResolver resolve_file_;
+
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> pages_loaded_{0};   // 预热读入的页面数
+};
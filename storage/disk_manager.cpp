@@ -2,12 +2,30 @@
 
 #include <assert.h>    // for assert
 #include <string.h>    // for memset
+#include <limits.h>    // for IOV_MAX
 #include <sys/stat.h>  // for stat
-#include <unistd.h>    // for lseek
+#include <sys/uio.h>   // for preadv, pwritev
+#include <unistd.h>    // for pread, pwrite
 
+#include <algorithm>
+#include <vector>
+
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "defs.h"
+#include "storage/uring_io_backend.h"
 
-DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char))); }
+DiskManager::DiskManager() {
+    memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char)));
+    if (IO_BACKEND == "io_uring") {
+        io_backend_ = UringIoBackend::create();
+        async_io_ = io_backend_ != nullptr;
+    }
+    // 不支持io_uring时退回同步后端
+    if (io_backend_ == nullptr) {
+        io_backend_ = std::make_unique<SyncIoBackend>();
+    }
+}
 
 /**
  * @description: 将数据写入文件的指定磁盘页面中
@@ -18,10 +36,24 @@ DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<
  */
 void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int num_bytes) {
     off_t pos = static_cast<off_t>(page_no) * PAGE_SIZE;
-    if (lseek(fd, pos, SEEK_SET) == -1) {
-        throw UnixError();
+    if (!is_aligned(fd, offset, num_bytes)) {
+        // O_DIRECT文件上的非对齐写(如只写文件头)：先读出整页，修改前num_bytes字节后整页写回
+        alignas(PAGE_SIZE) char bounce[PAGE_SIZE];
+        read_page(fd, page_no, bounce, PAGE_SIZE);
+        memcpy(bounce, offset, num_bytes);
+        ScopedLatency latency(EngineMetrics::get().disk_write_latency);
+        TraceSpan span("disk.write_page", "page_no", page_no);
+        EngineMetrics::get().disk_write_bytes.add(PAGE_SIZE);
+        if (pwrite(fd, bounce, PAGE_SIZE, pos) != PAGE_SIZE) {
+            throw InternalError("DiskManager::write_page Error");
+        }
+        return;
     }
-    ssize_t written = write(fd, offset, num_bytes);
+    ScopedLatency latency(EngineMetrics::get().disk_write_latency);
+    TraceSpan span("disk.write_page", "page_no", page_no);
+    EngineMetrics::get().disk_write_bytes.add(num_bytes);
+    // pwrite不依赖也不修改fd的文件偏移，多个线程可以同时读写同一个文件
+    ssize_t written = pwrite(fd, offset, num_bytes, pos);
     if (written != num_bytes) {
         throw InternalError("DiskManager::write_page Error");
     }
@@ -36,18 +68,154 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int
  */
 void DiskManager::read_page(int fd, page_id_t page_no, char *offset, int num_bytes) {
     off_t pos = static_cast<off_t>(page_no) * PAGE_SIZE;
-    if (lseek(fd, pos, SEEK_SET) == -1) {
-        throw UnixError();
+    if (!is_aligned(fd, offset, num_bytes)) {
+        // O_DIRECT文件上的非对齐读：读出整页后拷贝需要的部分
+        alignas(PAGE_SIZE) char bounce[PAGE_SIZE];
+        read_page(fd, page_no, bounce, PAGE_SIZE);
+        memcpy(offset, bounce, num_bytes);
+        return;
+    }
+    ssize_t rd;
+    {
+        ScopedLatency latency(EngineMetrics::get().disk_read_latency);
+        TraceSpan span("disk.read_page", "page_no", page_no);
+        rd = pread(fd, offset, num_bytes, pos);
     }
-    ssize_t rd = read(fd, offset, num_bytes);
     if (rd == -1) {
         throw UnixError();
     }
+    EngineMetrics::get().disk_read_bytes.add(rd);
     if (rd < num_bytes) {
         memset(offset + rd, 0, num_bytes - rd);
     }
 }
 
+/**
+ * @description: 异步读取页面，同步后端下返回时已经完成
+ * @return {IoHandle} 完成句柄
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 指定的页面编号
+ * @param {char} *offset 读取的内容写入到offset中，I/O完成前不能释放
+ * @param {int} num_bytes 读取的数据量大小
+ */
+IoHandle DiskManager::read_page_async(int fd, page_id_t page_no, char *offset, int num_bytes) {
+    auto request = std::make_shared<IoRequest>(IoRequest::Op::READ, fd, page_no, offset, num_bytes);
+    if (!is_aligned(fd, offset, num_bytes)) {
+        // O_DIRECT文件上的非对齐请求同步完成
+        read_page(fd, page_no, offset, num_bytes);
+        request->complete(num_bytes);
+        return request;
+    }
+    EngineMetrics::get().disk_read_bytes.add(num_bytes);
+    io_backend_->submit(request);
+    return request;
+}
+
+/**
+ * @description: 异步写入页面，同步后端下返回时已经完成
+ * @return {IoHandle} 完成句柄
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} page_no 写入目标页面的page_id
+ * @param {char} *offset 要写入磁盘的数据，I/O完成前不能修改或释放
+ * @param {int} num_bytes 要写入磁盘的数据大小
+ */
+IoHandle DiskManager::write_page_async(int fd, page_id_t page_no, const char *offset, int num_bytes) {
+    auto request =
+        std::make_shared<IoRequest>(IoRequest::Op::WRITE, fd, page_no, const_cast<char *>(offset), num_bytes);
+    if (!is_aligned(fd, offset, num_bytes)) {
+        write_page(fd, page_no, offset, num_bytes);
+        request->complete(num_bytes);
+        return request;
+    }
+    EngineMetrics::get().disk_write_bytes.add(num_bytes);
+    io_backend_->submit(request);
+    return request;
+}
+
+/**
+ * @description: 将连续的num_pages个页面一次性写入文件，第i个页面的数据来自bufs[i]
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} start_page_no 第一个页面的编号
+ * @param {char**} bufs 每个页面的数据，长度均为PAGE_SIZE
+ * @param {int} num_pages 页面个数
+ */
+void DiskManager::write_pages(int fd, page_id_t start_page_no, const char *const *bufs, int num_pages) {
+    for (int i = 0; i < num_pages; i++) {
+        if (!is_aligned(fd, bufs[i], PAGE_SIZE)) {
+            for (int j = 0; j < num_pages; j++) {
+                write_page(fd, start_page_no + j, bufs[j], PAGE_SIZE);
+            }
+            return;
+        }
+    }
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < num_pages;) {
+        int cnt = std::min(num_pages - done, IOV_MAX);
+        for (int i = 0; i < cnt; i++) {
+            iov[i].iov_base = const_cast<char *>(bufs[done + i]);
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t pos = static_cast<off_t>(start_page_no + done) * PAGE_SIZE;
+        ssize_t written;
+        {
+            ScopedLatency latency(EngineMetrics::get().disk_write_latency);
+            TraceSpan span("disk.write_pages", "pages", cnt);
+            written = pwritev(fd, iov, cnt, pos);
+        }
+        if (written == -1) {
+            throw UnixError();
+        }
+        EngineMetrics::get().disk_write_bytes.add(written);
+        // 发生部分写时，剩余的页面逐页写入
+        for (int i = static_cast<int>(written / PAGE_SIZE); i < cnt; i++) {
+            write_page(fd, start_page_no + done + i, bufs[done + i], PAGE_SIZE);
+        }
+        done += cnt;
+    }
+}
+
+/**
+ * @description: 一次性读取文件中连续的num_pages个页面，第i个页面读入bufs[i]，超出文件末尾的部分填0
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} start_page_no 第一个页面的编号
+ * @param {char**} bufs 每个页面的读入位置，长度均为PAGE_SIZE
+ * @param {int} num_pages 页面个数
+ */
+void DiskManager::read_pages(int fd, page_id_t start_page_no, char *const *bufs, int num_pages) {
+    for (int i = 0; i < num_pages; i++) {
+        if (!is_aligned(fd, bufs[i], PAGE_SIZE)) {
+            for (int j = 0; j < num_pages; j++) {
+                read_page(fd, start_page_no + j, bufs[j], PAGE_SIZE);
+            }
+            return;
+        }
+    }
+    struct iovec iov[IOV_MAX];
+    for (int done = 0; done < num_pages;) {
+        int cnt = std::min(num_pages - done, IOV_MAX);
+        for (int i = 0; i < cnt; i++) {
+            iov[i].iov_base = bufs[done + i];
+            iov[i].iov_len = PAGE_SIZE;
+        }
+        off_t pos = static_cast<off_t>(start_page_no + done) * PAGE_SIZE;
+        ssize_t rd;
+        {
+            ScopedLatency latency(EngineMetrics::get().disk_read_latency);
+            TraceSpan span("disk.read_pages", "pages", cnt);
+            rd = preadv(fd, iov, cnt, pos);
+        }
+        if (rd == -1) {
+            throw UnixError();
+        }
+        EngineMetrics::get().disk_read_bytes.add(rd);
+        // 读到文件末尾或发生部分读时，剩余的页面逐页读取(超出文件末尾的部分填0)
+        for (int i = static_cast<int>(rd / PAGE_SIZE); i < cnt; i++) {
+            read_page(fd, start_page_no + done + i, bufs[done + i], PAGE_SIZE);
+        }
+        done += cnt;
+    }
+}
+
 /**
  * @description: 分配一个新的页号
  * @return {page_id_t} 分配的新页号
@@ -113,7 +281,7 @@ void DiskManager::create_file(const std::string &path) {
  * @param {string} &path 文件所在路径
  */
 void DiskManager::destroy_file(const std::string &path) {
-    if (path_refcnt_.count(path)) {
+    if (std::scoped_lock lock{files_latch_}; path_refcnt_.count(path)) {
         throw FileNotClosedError(path);
     }
     if (!is_file(path)) {
@@ -131,15 +299,26 @@ void DiskManager::destroy_file(const std::string &path) {
  * @param {string} &path 文件所在路径
  */
 int DiskManager::open_file(const std::string &path) {
+    std::scoped_lock lock{files_latch_};
     if (path2fd_.count(path)) {
         path_refcnt_[path] += 1;
         return path2fd_[path];
     }
-    int fd = open(path.c_str(), O_RDWR);
+    int fd = -1;
+    bool direct = false;
+    if (direct_io_) {
+        // 部分文件系统(如tmpfs)不支持O_DIRECT，此时退回普通打开方式
+        fd = open(path.c_str(), O_RDWR | O_DIRECT);
+        direct = fd != -1;
+    }
+    if (fd == -1) {
+        fd = open(path.c_str(), O_RDWR);
+    }
     if (fd == -1) {
         throw FileNotFoundError(path);
     }
     assert(fd >= 0 && fd < MAX_FD);
+    fd_direct_[fd] = direct;
     path2fd_[path] = fd;
     fd2path_[fd] = path;
     path_refcnt_[path] = 1;
@@ -151,6 +330,7 @@ int DiskManager::open_file(const std::string &path) {
  * @param {int} fd 打开的文件的文件句柄
  */
 void DiskManager::close_file(int fd) {
+    std::scoped_lock lock{files_latch_};
     if (!fd2path_.count(fd)) {
         throw FileNotOpenError(fd);
     }
@@ -165,6 +345,7 @@ void DiskManager::close_file(int fd) {
         }
         path_refcnt_.erase(ref_it);
         fd2path_.erase(fd);
+        fd_direct_[fd] = false;
         path2fd_.erase(path);
     }
 }
@@ -187,6 +368,7 @@ int DiskManager::get_file_size(const std::string &file_name) {
  * @param {int} fd 文件句柄
  */
 std::string DiskManager::get_file_name(int fd) {
+    std::scoped_lock lock{files_latch_};
     if (!fd2path_.count(fd)) {
         throw FileNotOpenError(fd);
     }
@@ -199,10 +381,19 @@ std::string DiskManager::get_file_name(int fd) {
  * @param {string} &file_name 文件名
  */
 int DiskManager::get_file_fd(const std::string &file_name) {
-    if (!path2fd_.count(file_name)) {
-        return open_file(file_name);
-    }
-    return path2fd_[file_name];
+    int fd = find_file_fd(file_name);
+    return fd != -1 ? fd : open_file(file_name);
+}
+
+/**
+ * @description: 获得已打开的文件的文件句柄，不打开文件
+ * @return {int} 文件句柄，文件没有打开时返回-1
+ * @param {string} &file_name 文件名
+ */
+int DiskManager::find_file_fd(const std::string &file_name) {
+    std::scoped_lock lock{files_latch_};
+    auto it = path2fd_.find(file_name);
+    return it != path2fd_.end() ? it->second : -1;
 }
 
 
@@ -216,7 +407,7 @@ int DiskManager::get_file_fd(const std::string &file_name) {
 int DiskManager::read_log(char *log_data, int size, int offset) {
     // read log file from the previous end
     if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
+        log_fd_ = open_log_file();
     }
     int file_size = get_file_size(LOG_FILE_NAME);
     if (offset > file_size) {
@@ -225,8 +416,7 @@ int DiskManager::read_log(char *log_data, int size, int offset) {
 
     size = std::min(size, file_size - offset);
     if(size == 0) return 0;
-    lseek(log_fd_, offset, SEEK_SET);
-    ssize_t bytes_read = read(log_fd_, log_data, size);
+    ssize_t bytes_read = pread(log_fd_, log_data, size, offset);
     assert(bytes_read == size);
     return bytes_read;
 }
@@ -239,7 +429,7 @@ int DiskManager::read_log(char *log_data, int size, int offset) {
  */
 void DiskManager::write_log(char *log_data, int size) {
     if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
+        log_fd_ = open_log_file();
     }
 
     // write from the file_end
@@ -249,3 +439,142 @@ void DiskManager::write_log(char *log_data, int size) {
         throw UnixError();
     }
 }
+
+/**
+ * @description: 把日志文件截断为size字节，用于丢弃崩溃时只写入了一部分的日志
+ * @param {int} size 保留的日志长度
+ */
+void DiskManager::truncate_log(int size) {
+    if (log_fd_ == -1) {
+        log_fd_ = open_log_file();
+    }
+    if (ftruncate(log_fd_, size) != 0) {
+        throw UnixError();
+    }
+}
+
+/**
+ * @description: 丢弃日志文件中offset之前的内容。之后的日志先拷贝到临时文件并持久化，再原子地替换日志文件，
+ *               崩溃时日志文件要么是原来的，要么是截断后的。替换后日志文件的句柄号不变，
+ *               调用者需保证期间没有并发的write_log和sync_log
+ * @param {int} offset 保留的第一条日志在文件中的位置，必须是一条日志的开头
+ */
+void DiskManager::truncate_log_head(int offset) {
+    if (log_fd_ == -1) {
+        log_fd_ = open_log_file();
+    }
+    std::string tmp_name = LOG_FILE_NAME + ".tmp";
+    int tmp_fd = open(tmp_name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (tmp_fd == -1) {
+        throw UnixError();
+    }
+    std::vector<char> buf(LOG_BUFFER_SIZE);
+    bool ok = true;
+    for (off_t pos = offset; ok;) {
+        ssize_t bytes_read = pread(log_fd_, buf.data(), buf.size(), pos);
+        if (bytes_read <= 0) {
+            ok = bytes_read == 0;
+            break;
+        }
+        ok = write(tmp_fd, buf.data(), bytes_read) == bytes_read;
+        pos += bytes_read;
+    }
+    // dup2使log_fd_指向新文件，打开文件的记录不需要修改
+    ok = ok && fdatasync(tmp_fd) == 0 && rename(tmp_name.c_str(), LOG_FILE_NAME.c_str()) == 0 &&
+         dup2(tmp_fd, log_fd_) != -1;
+    close(tmp_fd);
+    if (!ok) {
+        throw UnixError();
+    }
+    sync_dir();
+}
+
+/**
+ * @description: 写入master record，记录最后一个完整的检查点的lsn。先写临时文件再替换，崩溃时不会只写入一部分
+ * @param {lsn_t} checkpoint_lsn 检查点开始记录的lsn
+ */
+void DiskManager::write_master_record(lsn_t checkpoint_lsn) {
+    replace_file(MASTER_RECORD_NAME, std::string(reinterpret_cast<const char *>(&checkpoint_lsn), sizeof(lsn_t)));
+}
+
+/**
+ * @description: 读取master record
+ * @return {lsn_t} 最后一个完整的检查点的lsn，没有做过检查点时返回INVALID_LSN
+ */
+lsn_t DiskManager::read_master_record() {
+    int fd = open(MASTER_RECORD_NAME.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return INVALID_LSN;
+    }
+    lsn_t checkpoint_lsn;
+    if (pread(fd, &checkpoint_lsn, sizeof(lsn_t), 0) != sizeof(lsn_t)) {
+        checkpoint_lsn = INVALID_LSN;
+    }
+    close(fd);
+    return checkpoint_lsn;
+}
+
+/**
+ * @description: 把文件的内容写为data。先写临时文件并落盘再替换，崩溃时文件要么是旧内容要么是新内容
+ * @param {string} &path 文件路径
+ * @param {string} &data 文件的新内容
+ */
+void DiskManager::replace_file(const std::string &path, const std::string &data) {
+    std::string tmp_name = path + ".tmp";
+    int fd = open(tmp_name.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (fd == -1) {
+        throw UnixError();
+    }
+    bool ok = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) && fdatasync(fd) == 0;
+    close(fd);
+    if (!ok || rename(tmp_name.c_str(), path.c_str()) != 0) {
+        throw UnixError();
+    }
+    sync_dir();
+}
+
+/**
+ * @description: 把已打开文件写入的页面落盘，用于写完之后不再经过缓冲池修改的文件
+ * @param {int} fd 文件句柄
+ */
+void DiskManager::sync_file(int fd) {
+    if (fdatasync(fd) != 0) {
+        throw UnixError();
+    }
+}
+
+// 持久化当前目录中文件的创建和替换
+void DiskManager::sync_dir() {
+    int fd = open(".", O_RDONLY);
+    if (fd == -1) {
+        throw UnixError();
+    }
+    int rc = fsync(fd);
+    close(fd);
+    if (rc != 0) {
+        throw UnixError();
+    }
+}
+
+/**
+ * @description: 打开日志文件。日志按记录追加，长度和地址都不对齐，因此不使用O_DIRECT
+ */
+int DiskManager::open_log_file() {
+    bool direct_io = direct_io_;
+    direct_io_ = false;
+    int fd = open_file(LOG_FILE_NAME);
+    direct_io_ = direct_io;
+    return fd;
+}
+
+/**
+ * @description: 把已经写入的日志内容持久化到磁盘中
+ */
+void DiskManager::sync_log() {
+    if (log_fd_ == -1) {
+        return;
+    }
+    if (fdatasync(log_fd_) != 0) {
+        throw UnixError();
+    }
+}
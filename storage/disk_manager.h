@@ -7,11 +7,14 @@
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
 #include "common/config.h"
 #include "errors.h"  
+#include "io_backend.h"
 
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
@@ -26,6 +29,27 @@ class DiskManager {
 
     void read_page(int fd, page_id_t page_no, char *offset, int num_bytes);
 
+    void write_pages(int fd, page_id_t start_page_no, const char *const *bufs, int num_pages);
+
+    void read_pages(int fd, page_id_t start_page_no, char *const *bufs, int num_pages);
+
+    /*异步页面I/O，返回的句柄需要调用wait()等待完成；请求会先排队，submit_io()或wait()时才批量提交*/
+    IoHandle read_page_async(int fd, page_id_t page_no, char *offset, int num_bytes);
+
+    IoHandle write_page_async(int fd, page_id_t page_no, const char *offset, int num_bytes);
+
+    void submit_io() { io_backend_->flush(); }
+
+    bool is_async_io() const { return async_io_; }
+
+    /**
+     * @description: 设置之后打开的页面文件是否使用O_DIRECT绕过操作系统页缓存，需在open_file之前调用
+     * @param {bool} direct_io 是否开启
+     */
+    void set_direct_io(bool direct_io) { direct_io_ = direct_io; }
+
+    bool is_direct_io(int fd) const { return fd >= 0 && fd < MAX_FD && fd_direct_[fd]; }
+
     page_id_t allocate_page(int fd);
 
     void deallocate_page(page_id_t page_id);
@@ -52,13 +76,31 @@ class DiskManager {
 
     std::string get_file_name(int fd);
 
+    void sync_file(int fd);
+
+    void replace_file(const std::string &path, const std::string &data);
+
     int get_file_fd(const std::string &file_name);
 
+    int find_file_fd(const std::string &file_name);
+
     /*日志操作*/
     int read_log(char *log_data, int size, int offset);
 
     void write_log(char *log_data, int size);
 
+    void sync_log();
+
+    void truncate_log(int size);
+
+    void truncate_log_head(int offset);
+
+    void write_master_record(lsn_t checkpoint_lsn);
+
+    lsn_t read_master_record();
+
+    int open_log_file();
+
     void SetLogFd(int log_fd) { log_fd_ = log_fd; }
 
     int GetLogFd() { return log_fd_; }
@@ -80,11 +122,25 @@ class DiskManager {
    static constexpr int MAX_FD = 8192;
 
    private:
-    // 文件打开列表，用于记录文件是否被打开
+    bool is_aligned(int fd, const char *buf, int num_bytes) const {
+        return !fd_direct_[fd] ||
+               (reinterpret_cast<uintptr_t>(buf) % PAGE_SIZE == 0 && num_bytes % PAGE_SIZE == 0);
+    }
+
+    void sync_dir();
+
+    // 文件打开列表，用于记录文件是否被打开，由files_latch_保护。后台线程(如缓冲池预热)也会按文件名查找
+    std::mutex files_latch_;
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<std::string, int> path_refcnt_;  // 记录每个已打开文件的引用计数
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
 
+    std::unique_ptr<IoBackend> io_backend_;      // 异步页面I/O后端，由config.h中的IO_BACKEND选择
+    bool async_io_ = false;                     // io_backend_是否为真正的异步后端(io_uring)
+
+    bool direct_io_ = ENABLE_DIRECT_IO;         // 之后打开的页面文件是否使用O_DIRECT
+    bool fd_direct_[MAX_FD]{};                  // fd -> 该文件是否以O_DIRECT打开，此类文件的I/O地址、长度和偏移都必须对齐
+
     int log_fd_ = -1;                             // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 文件中已经分配的页面个数，初始值为0
 };
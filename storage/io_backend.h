@@ -0,0 +1,108 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "common/config.h"
+#include "errors.h"
+
+class IoBackend;
+
+/**
+ * @description: 一次异步页面I/O的完成句柄。
+ *               由IoBackend创建并在I/O完成时通过complete()唤醒等待者，调用者通过wait()等待完成
+ */
+class IoRequest {
+   public:
+    enum class Op { READ, WRITE };
+
+    IoRequest(Op op, int fd, page_id_t page_no, char *buf, int num_bytes)
+        : op_(op), fd_(fd), page_no_(page_no), buf_(buf), num_bytes_(num_bytes) {}
+
+    void wait();
+
+    bool is_done() {
+        std::scoped_lock lock{latch_};
+        return done_;
+    }
+
+    /**
+     * @description: 由IoBackend调用，记录结果并唤醒等待者；读操作读到文件末尾时剩余部分填0
+     * @param {int} result 传输的字节数，出错时为-errno
+     */
+    void complete(int result) {
+        if (op_ == Op::READ && result >= 0 && result < num_bytes_) {
+            memset(buf_ + result, 0, num_bytes_ - result);
+            result = num_bytes_;
+        }
+        {
+            std::scoped_lock lock{latch_};
+            result_ = result;
+            done_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    Op op_;
+    int fd_;
+    page_id_t page_no_;
+    char *buf_;
+    int num_bytes_;
+    IoBackend *backend_ = nullptr;  // 提交该请求的后端，尚未提交给内核时wait()会先让后端提交
+
+   private:
+    std::mutex latch_;
+    std::condition_variable cv_;
+    bool done_ = false;
+    int result_ = 0;
+};
+
+using IoHandle = std::shared_ptr<IoRequest>;
+
+/**
+ * @description: DiskManager的页面I/O后端。submit()提交一个请求，flush()把已排队但尚未交给内核的请求一次性提交
+ */
+class IoBackend {
+   public:
+    virtual ~IoBackend() = default;
+
+    virtual void submit(const IoHandle &request) = 0;
+
+    virtual void flush() {}
+};
+
+/**
+ * @description: 同步后端，submit时直接用pread/pwrite完成I/O
+ */
+class SyncIoBackend : public IoBackend {
+   public:
+    void submit(const IoHandle &request) override {
+        off_t pos = static_cast<off_t>(request->page_no_) * PAGE_SIZE;
+        ssize_t ret = request->op_ == IoRequest::Op::READ
+                          ? pread(request->fd_, request->buf_, request->num_bytes_, pos)
+                          : pwrite(request->fd_, request->buf_, request->num_bytes_, pos);
+        request->complete(ret < 0 ? -errno : static_cast<int>(ret));
+    }
+};
+
+/**
+ * @description: 阻塞直到I/O完成，失败时抛出异常。若请求仍在后端排队，会先触发一次批量提交
+ */
+inline void IoRequest::wait() {
+    if (backend_ != nullptr && !is_done()) {
+        backend_->flush();
+    }
+    std::unique_lock<std::mutex> lock{latch_};
+    cv_.wait(lock, [this] { return done_; });
+    if (result_ < 0) {
+        throw InternalError("DiskManager async I/O Error: " + std::string(strerror(-result_)));
+    }
+    if (op_ == Op::WRITE && result_ != num_bytes_) {
+        throw InternalError("DiskManager::write_page_async Error");
+    }
+}
@@ -0,0 +1,57 @@
+#include "mapped_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "errors.h"
+
+/**
+ * @description: 映射整个文件，文件末尾不满一页的部分不映射
+ * @param {int} fd 已经打开的文件
+ * @param {Advice} advice 整个映射的访问模式，顺序扫描为主的数据文件用SEQUENTIAL，索引用RANDOM
+ */
+MappedFile::MappedFile(int fd, Advice advice) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        throw UnixError();
+    }
+    num_pages_ = static_cast<int>(st.st_size / PAGE_SIZE);
+    size_ = static_cast<size_t>(num_pages_) * PAGE_SIZE;
+    if (size_ > 0) {
+        void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            throw UnixError();
+        }
+        data_ = static_cast<char *>(addr);
+        madvise(data_, size_, advice == Advice::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+    pages_ = std::make_unique<Page[]>(num_pages_);
+    for (int page_no = 0; page_no < num_pages_; page_no++) {
+        Page &page = pages_[page_no];
+        page.id_ = PageId{fd, page_no};
+        page.data_ = data_ + static_cast<size_t>(page_no) * PAGE_SIZE;
+        page.key_.store(page.id_.Get(), std::memory_order_relaxed);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(data_, size_);
+    }
+}
+
+/**
+ * @description: 提示内核预读[start_page_no, start_page_no + num_pages)中的页面，代替缓冲池的预读
+ * @param {page_id_t} start_page_no 起始页号
+ * @param {int} num_pages 页面数
+ */
+void MappedFile::will_need(page_id_t start_page_no, int num_pages) {
+    int end = std::min(start_page_no + num_pages, num_pages_);
+    if (start_page_no < 0 || start_page_no >= end) {
+        return;
+    }
+    madvise(data_ + static_cast<size_t>(start_page_no) * PAGE_SIZE,
+            static_cast<size_t>(end - start_page_no) * PAGE_SIZE, MADV_WILLNEED);
+}
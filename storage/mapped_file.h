@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+
+#include "page.h"
+
+/*
+MappedFile把只读打开的数据文件或索引文件整个映射到内存(mmap，PROT_READ)，读取页面时直接返回映射中的页，
+不复制到缓冲池的帧中，也不经过页表和分片锁
+1. 每个页面有一个常驻的Page描述符，data_指向映射中的该页，pin和unpin不需要任何操作；页面读写锁照常可用
+2. 页面的格式与缓冲池中的完全相同，上层按同样的页面结构读取
+3. 映射期间文件不能被修改或扩展，映射之后追加的页面读不到
+*/
+class MappedFile {
+   public:
+    // 访问模式提示，传给madvise
+    enum class Advice { SEQUENTIAL, RANDOM };
+
+    /**
+     * @param {int} fd 已经打开的文件
+     * @param {Advice} advice 整个映射的访问模式
+     */
+    MappedFile(int fd, Advice advice);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // 页面的描述符，页号超出文件时返回nullptr
+    Page *page(page_id_t page_no) {
+        return page_no >= 0 && page_no < num_pages_ ? &pages_[page_no] : nullptr;
+    }
+
+    int num_pages() const { return num_pages_; }
+
+    void will_need(page_id_t start_page_no, int num_pages);
+
+   private:
+    char *data_ = nullptr;
+    size_t size_ = 0;
+    int num_pages_ = 0;
+    std::unique_ptr<Page[]> pages_;
+};
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstring>
+#include <shared_mutex>
+#include <string>
+
 #include "common/config.h"
 
 /**
@@ -19,14 +24,26 @@ struct PageId {
         return "{fd: " + std::to_string(fd) + " page_no: " + std::to_string(page_no) + "}"; 
     }
 
+    // fd占高32位，page_no占低32位，不同的(fd, page_no)一定得到不同的值
     inline int64_t Get() const {
-        return (static_cast<int64_t>(fd << 16) | page_no);
+        return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(fd)) << 32) |
+                                    static_cast<uint32_t>(page_no));
     }
 };
 
 // PageId的自定义哈希算法, 用于构建unordered_map<PageId, frame_id_t, PageIdHash>
+// 对PageId::Get()做64位混合(murmur3 finalizer)，使同一文件中相邻的页也能均匀分散
 struct PageIdHash {
-    size_t operator()(const PageId &x) const { return (x.fd << 16) | x.page_no; }
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    size_t operator()(const PageId &x) const { return mix(static_cast<uint64_t>(x.Get())); }
 };
 
 template <>
@@ -40,10 +57,12 @@ struct std::hash<PageId> {
  */
 class Page {
     friend class BufferPoolManager;
+    friend class BufferPoolInstance;
+    friend class MappedFile;
 
    public:
     
-    Page() { reset_memory(); }
+    Page() = default;
 
     ~Page() = default;
 
@@ -53,6 +72,55 @@ class Page {
 
     bool is_dirty() const { return is_dirty_; }
 
+    int get_pin_count() const { return pin_count_.load(std::memory_order_relaxed); }
+
+    /** 页面读写锁，保护页面内容，与pin_count_无关：调用者需先pin住页面再加锁，解锁后再unpin */
+    void rlatch() { rwlatch_.lock_shared(); }
+
+    void runlatch() { rwlatch_.unlock_shared(); }
+
+    // 写锁期间version_为奇数，每次加锁和解锁都使其加1，供不加锁的乐观读者校验读到的内容
+    void wlatch() {
+        rwlatch_.lock();
+        version_.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    void wunlatch() {
+        version_.fetch_add(1, std::memory_order_release);
+        rwlatch_.unlock();
+    }
+
+    // 不阻塞地尝试加锁，用于统计锁等待
+    bool try_rlatch() { return rwlatch_.try_lock_shared(); }
+
+    bool try_wlatch() {
+        if (!rwlatch_.try_lock()) {
+            return false;
+        }
+        version_.fetch_add(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    /**
+     * @description: 乐观读开始前读取页面版本号
+     * @return {bool} 页面当前是否没有被加写锁，为false时读者应当重试
+     * @param {uint64_t*} version 返回版本号，读完后交给validate_version校验
+     */
+    bool try_read_version(uint64_t *version) const {
+        *version = version_.load(std::memory_order_acquire);
+        return (*version & 1) == 0;
+    }
+
+    /**
+     * @description: 乐观读结束后校验期间页面没有被修改过
+     * @return {bool} 读到的内容是否一致
+     * @param {uint64_t} version try_read_version返回的版本号
+     */
+    bool validate_version(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
     static constexpr size_t OFFSET_PAGE_START = 0;
     static constexpr size_t OFFSET_LSN = 0;
     static constexpr size_t OFFSET_PAGE_HDR = 4;
@@ -61,20 +129,57 @@ class Page {
 
     inline void set_page_lsn(lsn_t page_lsn) { memcpy(get_data() + OFFSET_LSN, &page_lsn, sizeof(lsn_t)); }
 
+    /**
+     * @description: 记录修改页面的日志，rec_lsn为页面上一次写回之后最早的这类日志，检查点据此确定日志中可以丢弃的部分
+     * @param {lsn_t} lsn 修改页面的日志的lsn
+     */
+    void update_rec_lsn(lsn_t lsn) {
+        lsn_t rec_lsn = rec_lsn_.load(std::memory_order_relaxed);
+        while ((rec_lsn == INVALID_LSN || lsn < rec_lsn) &&
+               !rec_lsn_.compare_exchange_weak(rec_lsn, lsn, std::memory_order_relaxed)) {
+        }
+    }
+
+    lsn_t get_rec_lsn() const { return rec_lsn_.load(std::memory_order_relaxed); }
+
    private:
     void reset_memory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
+    // Page只保存帧的元数据，BufferPoolInstance中的Page数组是紧凑的帧描述符数组，
+    // 遍历pin_count_或脏页标记时每个cache line可以覆盖多个帧，页面数据单独存放在数据区中
+
     /** page的唯一标识符 */
     PageId id_;
 
     /** The actual data that is stored within a page.
-     *  该页面在bufferPool中的偏移地址
+     *  该页面在bufferPool中的偏移地址，指向缓冲池按PAGE_SIZE对齐的数据区中的一帧，由BufferPoolInstance分配
      */
-    char data_[PAGE_SIZE] = {};
+    char *data_ = nullptr;
+
+    /** 与id_相同的PageId::Get()，供不加锁的页表命中路径校验帧中的页面，帧为空时为全1 */
+    std::atomic<uint64_t> key_{~0ULL};
+
+    /** The pin count of this page. 页表命中时不加锁地增减；为-1表示该帧正在被持有分片锁的线程独占(淘汰或删除) */
+    std::atomic<int> pin_count_{0};
 
     /** 脏页判断 */
-    bool is_dirty_ = false;
+    std::atomic<bool> is_dirty_{false};
+
+    /** 该帧是否正在进行磁盘I/O(读入新页或写回被淘汰的旧页)，为true时帧中的数据不可用 */
+    std::atomic<bool> io_in_progress_{false};
+
+    /** 不加锁命中后是否还未把这次访问告知replacer，在pin_count_降为0时由持锁线程补记 */
+    std::atomic<bool> referenced_{false};
+
+    /** 页面内容的读写锁，由索引等上层模块使用，缓冲池本身不加该锁 */
+    std::shared_mutex rwlatch_;
+
+    /** 页面内容的版本号，见wlatch() */
+    std::atomic<uint64_t> version_{0};
+
+    /** 页面上一次写回之后第一条修改它的日志的lsn(recLSN)，没有记录日志的修改不影响它 */
+    std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
 
-    /** The pin count of this page. */
-    int pin_count_ = 0;
+    /** 后台刷脏线程是否正在写回该帧(写回期间帧被pin住，数据仍然可读写) */
+    bool write_in_progress_ = false;
 };
\ No newline at end of file
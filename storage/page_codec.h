@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+
+#include "common/config.h"
+
+/**
+ * @description: 页面编解码器。缓冲池淘汰注册了编解码器的文件的页面时，把页面编码后保存在压缩页缓存中，
+ *               之后访问该页时直接解码，不必再读磁盘；编码结果不要求与页面逐字节相同，
+ *               但解码出的页面必须与原页面含义相同(例如空闲slot中的旧数据可以丢弃)
+ */
+class PageCodec {
+   public:
+    virtual ~PageCodec() = default;
+
+    /**
+     * @description: 编码一个页面，在持有缓冲池分片的latch_时调用，不能访问缓冲池
+     * @return {bool} 是否值得保存编码结果，为false时页面像普通页面一样被丢弃
+     * @param {page_id_t} page_no 页号
+     * @param {char*} page 页面数据
+     * @param {string*} out 编码结果
+     */
+    virtual bool encode(page_id_t page_no, const char *page, std::string *out) const = 0;
+
+    /**
+     * @description: 把encode()的结果解码成完整的页面
+     * @param {string&} data 编码结果
+     * @param {char*} page 输出的页面，有PAGE_SIZE字节
+     */
+    virtual void decode(const std::string &data, char *page) const = 0;
+};
@@ -0,0 +1,77 @@
+#include "page_flusher.h"
+
+/**
+ * @description: 启动后台线程，重复调用无效
+ */
+void PageFlusher::start() {
+    std::scoped_lock lock{latch_};
+    if (thread_.joinable()) {
+        return;
+    }
+    stop_ = false;
+    thread_ = std::thread(&PageFlusher::run, this);
+}
+
+/**
+ * @description: 停止后台线程并等待其退出，不会再做最后一次刷脏，关闭数据库时仍需调用flush_all_pages
+ */
+void PageFlusher::stop() {
+    {
+        std::scoped_lock lock{latch_};
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+/**
+ * @description: 执行一轮后台刷脏
+ */
+void PageFlusher::flush_once() {
+    if (merge_hook_) {
+        merge_hook_(false);
+    }
+    if (log_flush_hook_) {
+        log_flush_hook_();
+    }
+    pages_flushed_ += buffer_pool_manager_->flush_dirty_pages(dirty_ratio_, BG_FLUSH_BATCH_SIZE);
+}
+
+/**
+ * @description: 执行一次fuzzy checkpoint：写回当前所有脏页，期间不阻塞前台读写，完成后调用检查点回调
+ */
+void PageFlusher::checkpoint() {
+    if (merge_hook_) {
+        merge_hook_(true);
+    }
+    if (log_flush_hook_) {
+        log_flush_hook_();
+    }
+    pages_flushed_ += buffer_pool_manager_->flush_all_dirty_pages();
+    if (checkpoint_hook_) {
+        checkpoint_hook_();
+    }
+    num_checkpoints_++;
+}
+
+void PageFlusher::run() {
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock{latch_};
+    while (!stop_) {
+        cv_.wait_for(lock, flush_interval_, [this] { return stop_; });
+        if (stop_) {
+            break;
+        }
+        lock.unlock();
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_checkpoint >= checkpoint_interval_) {
+            checkpoint();
+            last_checkpoint = now;
+        } else {
+            flush_once();
+        }
+        lock.lock();
+    }
+}
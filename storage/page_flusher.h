@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "buffer_pool_manager.h"
+
+/**
+ * @description: 缓冲池后台刷脏与检查点线程。
+ *               每隔flush_interval按replacer的淘汰顺序提前写回脏页，使各分片的脏页比例保持在dirty_ratio以下，
+ *               前台缺页时就很少需要同步写回victim；每隔checkpoint_interval写回当时所有的脏页并调用检查点回调，
+ *               从而限制崩溃恢复时需要redo的日志范围
+ */
+class PageFlusher {
+   public:
+    PageFlusher(BufferPoolManager *buffer_pool_manager,
+                std::chrono::milliseconds flush_interval = std::chrono::milliseconds(BG_FLUSH_INTERVAL_MS),
+                double dirty_ratio = BG_FLUSH_DIRTY_RATIO,
+                std::chrono::milliseconds checkpoint_interval = std::chrono::milliseconds(CHECKPOINT_INTERVAL_MS))
+        : buffer_pool_manager_(buffer_pool_manager),
+          flush_interval_(flush_interval),
+          dirty_ratio_(dirty_ratio),
+          checkpoint_interval_(checkpoint_interval) {}
+
+    ~PageFlusher() { stop(); }
+
+    /**
+     * @description: 设置写回页面前调用的回调，用于先把日志刷到磁盘(WAL)
+     */
+    void set_log_flush_hook(std::function<void()> hook) { log_flush_hook_ = std::move(hook); }
+
+    /**
+     * @description: 设置检查点完成后调用的回调，此时检查点开始时的所有脏页都已落盘
+     */
+    void set_checkpoint_hook(std::function<void()> hook) { checkpoint_hook_ = std::move(hook); }
+
+    /**
+     * @description: 设置每轮刷脏之前调用的回调，参数表示本轮是否为检查点，用于先把索引修改缓冲中的修改写入页面
+     */
+    void set_merge_hook(std::function<void(bool)> hook) { merge_hook_ = std::move(hook); }
+
+    void start();
+
+    void stop();
+
+    void flush_once();
+
+    void checkpoint();
+
+    size_t get_pages_flushed() const { return pages_flushed_.load(); }
+
+    size_t get_num_checkpoints() const { return num_checkpoints_.load(); }
+
+   private:
+    void run();
+
+    BufferPoolManager *buffer_pool_manager_;
+    std::chrono::milliseconds flush_interval_;          // 后台刷脏的周期
+    double dirty_ratio_;                                // 每个分片允许保留的脏页比例
+    std::chrono::milliseconds checkpoint_interval_;     // 检查点的周期
+    std::function<void()> log_flush_hook_;
+    std::function<void()> checkpoint_hook_;
+    std::function<void(bool)> merge_hook_;
+
+    std::thread thread_;
+    std::mutex latch_;                  // 用于stop_和cv_
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::atomic<size_t> pages_flushed_{0};      // 累计写回的页面数
+    std::atomic<size_t> num_checkpoints_{0};    // 累计完成的检查点数
+};
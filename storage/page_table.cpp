@@ -0,0 +1,101 @@
+#include "page_table.h"
+
+#include <cassert>
+
+PageTable::PageTable(size_t num_frames) {
+    size_t capacity = 2;
+    int bits = 1;
+    while (capacity < num_frames * 2) {
+        capacity <<= 1;
+        bits++;
+    }
+    slots_ = std::make_unique<Slot[]>(capacity);
+    mask_ = capacity - 1;
+    shift_ = 64 - bits;
+}
+
+/**
+ * @description: 无锁查找page_id所在的帧
+ * @return {bool} 是否找到
+ * @param {PageId} page_id 目标页
+ * @param {frame_id_t*} frame_id 返回帧号，可能已经过期，需由调用者校验
+ */
+bool PageTable::find(PageId page_id, frame_id_t *frame_id) const {
+    uint64_t key = page_id.Get();
+    for (size_t i = home(key), n = 0; n <= mask_; i = (i + 1) & mask_, n++) {
+        uint64_t k = slots_[i].key_.load(std::memory_order_acquire);
+        if (k == EMPTY_KEY) {
+            return false;
+        }
+        if (k == key) {
+            *frame_id = slots_[i].frame_id_.load(std::memory_order_acquire);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 插入或更新page_id的映射，调用时需持有分片的latch_
+ * @param {PageId} page_id 目标页
+ * @param {frame_id_t} frame_id 目标页所在的帧
+ */
+void PageTable::insert(PageId page_id, frame_id_t frame_id) {
+    uint64_t key = page_id.Get();
+    assert(key != EMPTY_KEY);
+    size_t i = home(key);
+    while (true) {
+        uint64_t k = slots_[i].key_.load(std::memory_order_relaxed);
+        if (k == key) {
+            slots_[i].frame_id_.store(frame_id, std::memory_order_release);
+            return;
+        }
+        if (k == EMPTY_KEY) {
+            break;
+        }
+        i = (i + 1) & mask_;
+    }
+    assert(size_ < mask_);
+    // 先写帧号再发布key，读者看到key时帧号已经就绪
+    slots_[i].frame_id_.store(frame_id, std::memory_order_release);
+    slots_[i].key_.store(key, std::memory_order_release);
+    size_++;
+}
+
+/**
+ * @description: 删除page_id的映射，调用时需持有分片的latch_。
+ *               采用向后移动删除(backward shift deletion)而不是墓碑，表中不会堆积已删除的槽位
+ * @return {bool} page_id是否存在
+ * @param {PageId} page_id 目标页
+ */
+bool PageTable::erase(PageId page_id) {
+    uint64_t key = page_id.Get();
+    size_t i = home(key);
+    while (true) {
+        uint64_t k = slots_[i].key_.load(std::memory_order_relaxed);
+        if (k == EMPTY_KEY) {
+            return false;
+        }
+        if (k == key) {
+            break;
+        }
+        i = (i + 1) & mask_;
+    }
+    // 把后面探测链上可以前移的表项移到空出的槽位i，直到遇到空槽
+    for (size_t j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+        uint64_t k = slots_[j].key_.load(std::memory_order_relaxed);
+        if (k == EMPTY_KEY) {
+            break;
+        }
+        size_t h = home(k);
+        // 表项j的起始槽位h不在(i, j]之间时，才能移动到i而不破坏其探测链
+        if (((j - h) & mask_) >= ((j - i) & mask_)) {
+            slots_[i].frame_id_.store(slots_[j].frame_id_.load(std::memory_order_relaxed), std::memory_order_release);
+            slots_[i].key_.store(k, std::memory_order_release);
+            i = j;
+        }
+    }
+    slots_[i].key_.store(EMPTY_KEY, std::memory_order_release);
+    size_--;
+    return true;
+}
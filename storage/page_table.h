@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "page.h"
+
+/*
+PageTable是缓冲池分片的页表，记录PageId -> frame_id_t的映射
+采用线性探测的开放寻址哈希表，容量固定为帧数的两倍以上，负载因子不超过1/2
+find()不加锁，可以与insert()/erase()并发执行；insert()/erase()由调用者持有分片的latch_串行执行
+无锁的find()可能读到过期的帧号或暂时找不到正在被移动的表项，调用者必须在pin住帧之后校验帧中的页面，
+查找失败时再加锁重新查找
+*/
+class PageTable {
+   public:
+    /**
+     * @description: 创建一个页表
+     * @param {size_t} num_frames 页表最多需要存储的表项数量，即分片的帧数
+     */
+    explicit PageTable(size_t num_frames);
+
+    bool find(PageId page_id, frame_id_t *frame_id) const;
+
+    void insert(PageId page_id, frame_id_t frame_id);
+
+    bool erase(PageId page_id);
+
+    size_t size() const { return size_; }
+
+    static constexpr uint64_t EMPTY_KEY = ~0ULL;    // 空槽位，与fd = -1, page_no = -1的PageId相同，该PageId不会被插入
+
+   private:
+    struct Slot {
+        std::atomic<uint64_t> key_{EMPTY_KEY};      // PageId::Get()
+        std::atomic<frame_id_t> frame_id_{INVALID_FRAME_ID};
+    };
+
+    size_t home(uint64_t key) const { return PageIdHash::mix(key) >> shift_; }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_;       // 容量 - 1，容量为2的幂
+    int shift_;         // 64 - log2(容量)，取哈希值的高位作为槽位，低位留给分片选择
+    size_t size_ = 0;   // 当前表项数，只由持有latch_的写者修改
+};
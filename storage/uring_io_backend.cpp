@@ -0,0 +1,227 @@
+#include "uring_io_backend.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+
+#ifdef UNIBASE_HAS_IO_URING
+
+/**
+ * @description: 创建io_uring后端
+ * @return {unique_ptr<UringIoBackend>} 内核不支持io_uring(或被禁用)时返回nullptr
+ * @param {unsigned} entries SQ的长度
+ */
+std::unique_ptr<UringIoBackend> UringIoBackend::create(unsigned entries) {
+    std::unique_ptr<UringIoBackend> backend(new UringIoBackend());
+    if (!backend->init(entries)) {
+        return nullptr;
+    }
+    return backend;
+}
+
+bool UringIoBackend::init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    sq_entries_ = params.sq_entries;
+    cq_entries_ = params.cq_entries;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        return false;
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    reaper_ = std::thread(&UringIoBackend::reap, this);
+    return true;
+}
+
+UringIoBackend::~UringIoBackend() {
+    if (reaper_.joinable()) {
+        // 等待所有请求完成后，提交一个user_data为0的NOP唤醒收割线程使其退出
+        {
+            std::unique_lock<std::mutex> lock{sq_latch_};
+            submit_pending();
+            inflight_cv_.wait(lock, [this] { return inflight_ == 0; });
+            stop_ = true;
+            unsigned tail = *sq_tail_;
+            unsigned idx = tail & *sq_mask_;
+            io_uring_sqe *sqe = &sqes_[idx];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = 0;
+            sq_array_[idx] = idx;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+            pending_++;
+            submit_pending();
+        }
+        reaper_.join();
+    }
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+    }
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+}
+
+int UringIoBackend::enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0));
+}
+
+/**
+ * @description: 把SQ中排队的请求一次性交给内核，调用时需持有sq_latch_
+ */
+void UringIoBackend::submit_pending() {
+    while (pending_ > 0) {
+        int ret = enter(pending_, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            throw UnixError();
+        }
+        pending_ -= static_cast<unsigned>(ret);
+    }
+}
+
+/**
+ * @description: 把请求写入SQ，但不立即调用io_uring_enter。
+ *               同时在途的请求数不超过CQ的容量(预留一个位置给退出时的NOP)，超过时阻塞等待
+ * @param {IoHandle&} request 要提交的请求
+ */
+void UringIoBackend::submit(const IoHandle &request) {
+    std::unique_lock<std::mutex> lock{sq_latch_};
+    request->backend_ = this;
+    if (inflight_ + 1 >= cq_entries_) {
+        submit_pending();
+        inflight_cv_.wait(lock, [this] { return inflight_ + 1 < cq_entries_; });
+    }
+    unsigned tail = *sq_tail_;
+    if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) == sq_entries_) {
+        submit_pending();
+    }
+    unsigned idx = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request->op_ == IoRequest::Op::READ ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = request->fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(request->buf_);
+    sqe->len = static_cast<uint32_t>(request->num_bytes_);
+    sqe->off = static_cast<uint64_t>(request->page_no_) * PAGE_SIZE;
+    // 收割线程完成请求后释放这份引用
+    sqe->user_data = reinterpret_cast<uint64_t>(new IoHandle(request));
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    pending_++;
+    inflight_++;
+}
+
+/**
+ * @description: 批量提交所有排队的请求
+ */
+void UringIoBackend::flush() {
+    std::scoped_lock lock{sq_latch_};
+    submit_pending();
+}
+
+/**
+ * @description: 收割线程：阻塞等待完成事件，逐个完成对应的IoRequest
+ */
+void UringIoBackend::reap() {
+    while (true) {
+        int ret = enter(0, 1, IORING_ENTER_GETEVENTS);
+        if (ret < 0 && errno != EINTR) {
+            break;
+        }
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned completed = 0;
+        bool saw_stop = false;
+        for (; head != tail; head++) {
+            io_uring_cqe *cqe = &cqes_[head & *cq_mask_];
+            if (cqe->user_data == 0) {
+                saw_stop = true;
+                continue;
+            }
+            IoHandle *handle = reinterpret_cast<IoHandle *>(cqe->user_data);
+            (*handle)->complete(cqe->res);
+            delete handle;
+            completed++;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        if (completed > 0) {
+            std::scoped_lock lock{sq_latch_};
+            inflight_ -= completed;
+            inflight_cv_.notify_all();
+        }
+        if (saw_stop && stop_) {
+            break;
+        }
+    }
+}
+
+#else
+
+std::unique_ptr<UringIoBackend> UringIoBackend::create(unsigned entries) { return nullptr; }
+
+UringIoBackend::~UringIoBackend() = default;
+
+bool UringIoBackend::init(unsigned entries) { return false; }
+
+int UringIoBackend::enter(unsigned to_submit, unsigned min_complete, unsigned flags) { return -1; }
+
+void UringIoBackend::submit_pending() {}
+
+void UringIoBackend::submit(const IoHandle &request) {}
+
+void UringIoBackend::flush() {}
+
+void UringIoBackend::reap() {}
+
+#endif
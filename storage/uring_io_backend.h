@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_backend.h"
+
+#if __has_include(<linux/io_uring.h>)
+#define UNIBASE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#endif
+
+/**
+ * @description: 基于io_uring的异步I/O后端，直接使用io_uring_setup/io_uring_enter系统调用，不依赖liburing。
+ *               submit()只把请求写入SQ，flush()或SQ写满时才调用一次io_uring_enter批量提交；
+ *               由单独的收割线程等待CQ并唤醒各个IoRequest。
+ *               内核不支持io_uring时create()返回nullptr，由DiskManager退回同步后端
+ */
+class UringIoBackend : public IoBackend {
+   public:
+    static std::unique_ptr<UringIoBackend> create(unsigned entries = IO_URING_ENTRIES);
+
+    ~UringIoBackend();
+
+    void submit(const IoHandle &request) override;
+
+    void flush() override;
+
+   private:
+    UringIoBackend() = default;
+
+    bool init(unsigned entries);
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+    void submit_pending();
+
+    void reap();
+
+#ifdef UNIBASE_HAS_IO_URING
+    int ring_fd_ = -1;
+    unsigned sq_entries_ = 0;
+    unsigned cq_entries_ = 0;
+
+    // 与内核共享的SQ/CQ环形队列
+    void *sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void *cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe *sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned *sq_head_ = nullptr;
+    unsigned *sq_tail_ = nullptr;
+    unsigned *sq_mask_ = nullptr;
+    unsigned *sq_array_ = nullptr;
+    unsigned *cq_head_ = nullptr;
+    unsigned *cq_tail_ = nullptr;
+    unsigned *cq_mask_ = nullptr;
+    io_uring_cqe *cqes_ = nullptr;
+#endif
+
+    std::mutex sq_latch_;               // 保护SQ和pending_
+    std::condition_variable inflight_cv_;
+    unsigned pending_ = 0;              // 已写入SQ但尚未提交给内核的请求数
+    unsigned inflight_ = 0;             // 已提交但尚未完成的请求数，不超过CQ的容量
+    std::thread reaper_;                // 收割线程
+    std::atomic<bool> stop_{false};
+};
@@ -0,0 +1,236 @@
+#include "sm_catalog.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t CATALOG_MAGIC = 0x54414355;     // "UCAT"
+constexpr uint32_t CATALOG_VERSION = 1;
+constexpr uint32_t RUN_USED = 0x44455355;          // "USED"
+constexpr uint32_t RUN_FREE = 0x45455246;          // "FREE"
+
+struct CatalogHdr {
+    uint32_t magic;
+    uint32_t version;
+    int32_t next_tab_id;
+};
+
+struct RunHdr {
+    uint32_t magic;
+    uint32_t num_pages;
+    int32_t tab_id;
+    uint32_t len;           // 编码的字节数
+    uint64_t seq;           // 写入序号，同一张表有两个版本时保留较大的
+    uint32_t checksum;      // 编码的FNV-1a校验和
+};
+
+uint32_t checksum(const char *data, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return h;
+}
+
+void write_fully(int fd, const char *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            throw UnixError();
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+}  // namespace
+
+void Catalog::create(const std::string &path) {
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0600);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    std::string page(PAGE_SIZE, '\0');
+    CatalogHdr hdr{CATALOG_MAGIC, CATALOG_VERSION, 0};
+    memcpy(&page[0], &hdr, sizeof(hdr));
+    write_fully(fd, page.data(), page.size(), 0);
+    if (fdatasync(fd) < 0) {
+        ::close(fd);
+        throw UnixError();
+    }
+    ::close(fd);
+}
+
+void Catalog::open(const std::string &path, std::vector<TabMeta> *tables, int *next_tab_id) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDWR);
+    if (fd_ < 0) {
+        throw UnixError();
+    }
+    struct stat st;
+    if (fstat(fd_, &st) < 0) {
+        throw UnixError();
+    }
+    num_pages_ = static_cast<page_id_t>(st.st_size / PAGE_SIZE);
+    std::vector<char> data(static_cast<size_t>(num_pages_) * PAGE_SIZE);
+    for (size_t done = 0; done < data.size();) {
+        ssize_t n = pread(fd_, data.data() + done, data.size() - done, done);
+        if (n <= 0) {
+            throw UnixError();
+        }
+        done += n;
+    }
+    CatalogHdr hdr{};
+    if (num_pages_ > 0) {
+        memcpy(&hdr, data.data(), sizeof(hdr));
+    }
+    if (hdr.magic != CATALOG_MAGIC || hdr.version != CATALOG_VERSION) {
+        throw InternalError("Catalog::open: " + path + " is not a catalog file");
+    }
+    *next_tab_id = hdr.next_tab_id;
+
+    // 按RunHdr遍历，同一张表有两个版本时释放写入序号较小的一个
+    std::unordered_map<int, std::pair<Run, RunHdr>> live;
+    for (page_id_t page = 1; page < num_pages_;) {
+        RunHdr run_hdr;
+        const char *src = data.data() + static_cast<size_t>(page) * PAGE_SIZE;
+        memcpy(&run_hdr, src, sizeof(run_hdr));
+        int num_pages = static_cast<int>(run_hdr.num_pages);
+        if ((run_hdr.magic != RUN_USED && run_hdr.magic != RUN_FREE) || num_pages <= 0 ||
+            num_pages > num_pages_ - page) {
+            // 无法识别的页面(写入RunHdr时崩溃)，单独作为一个空闲run
+            add_free(page, 1);
+            page++;
+            continue;
+        }
+        bool valid = run_hdr.magic == RUN_USED &&
+                     sizeof(RunHdr) + run_hdr.len <= static_cast<size_t>(num_pages) * PAGE_SIZE &&
+                     checksum(src + sizeof(RunHdr), run_hdr.len) == run_hdr.checksum;
+        Run run{page, num_pages};
+        if (!valid) {
+            add_free(page, num_pages);
+        } else {
+            next_seq_ = std::max(next_seq_, run_hdr.seq + 1);
+            auto it = live.find(run_hdr.tab_id);
+            if (it == live.end()) {
+                live.emplace(run_hdr.tab_id, std::make_pair(run, run_hdr));
+            } else if (it->second.second.seq < run_hdr.seq) {
+                free_run(it->second.first);
+                it->second = std::make_pair(run, run_hdr);
+            } else {
+                free_run(run);
+            }
+        }
+        page += num_pages;
+    }
+    for (auto &entry : live) {
+        const Run &run = entry.second.first;
+        const RunHdr &run_hdr = entry.second.second;
+        CatalogDecoder decoder(data.data() + static_cast<size_t>(run.start) * PAGE_SIZE + sizeof(RunHdr), run_hdr.len);
+        TabMeta tab;
+        tab.decode(decoder);
+        *next_tab_id = std::max(*next_tab_id, tab.id + 1);
+        tables_[entry.first] = run;
+        tables->push_back(std::move(tab));
+    }
+}
+
+void Catalog::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    num_pages_ = 0;
+    tables_.clear();
+    free_runs_.clear();
+}
+
+void Catalog::write_table(int tab_id, const std::string &record) {
+    size_t total = sizeof(RunHdr) + record.size();
+    int num_pages = static_cast<int>((total + PAGE_SIZE - 1) / PAGE_SIZE);
+    std::vector<char> buf(static_cast<size_t>(num_pages) * PAGE_SIZE, 0);
+    RunHdr run_hdr{RUN_USED, static_cast<uint32_t>(num_pages), tab_id, static_cast<uint32_t>(record.size()),
+                   next_seq_++, checksum(record.data(), record.size())};
+    memcpy(buf.data(), &run_hdr, sizeof(run_hdr));
+    memcpy(buf.data() + sizeof(run_hdr), record.data(), record.size());
+
+    page_id_t start = allocate(num_pages);
+    write_fully(fd_, buf.data(), buf.size(), static_cast<off_t>(start) * PAGE_SIZE);
+    if (fdatasync(fd_) < 0) {
+        throw UnixError();
+    }
+    auto it = tables_.find(tab_id);
+    if (it != tables_.end()) {
+        free_run(it->second);
+    }
+    tables_[tab_id] = Run{start, num_pages};
+}
+
+void Catalog::remove_table(int tab_id) {
+    auto it = tables_.find(tab_id);
+    if (it == tables_.end()) {
+        return;
+    }
+    free_run(it->second);
+    tables_.erase(it);
+    if (fdatasync(fd_) < 0) {
+        throw UnixError();
+    }
+}
+
+void Catalog::set_next_tab_id(int next_tab_id) {
+    CatalogHdr hdr{CATALOG_MAGIC, CATALOG_VERSION, next_tab_id};
+    write_fully(fd_, reinterpret_cast<const char *>(&hdr), sizeof(hdr), 0);
+}
+
+// 首次适配分配num_pages个连续页面，剩余部分先写入空闲RunHdr
+page_id_t Catalog::allocate(int num_pages) {
+    for (auto it = free_runs_.begin(); it != free_runs_.end(); ++it) {
+        if (it->second < num_pages) {
+            continue;
+        }
+        page_id_t start = it->first;
+        int remaining = it->second - num_pages;
+        free_runs_.erase(it);
+        if (remaining > 0) {
+            write_run_hdr(start + num_pages, RUN_FREE, remaining);
+            free_runs_.emplace(start + num_pages, remaining);
+        }
+        return start;
+    }
+    page_id_t start = num_pages_;
+    num_pages_ += num_pages;
+    return start;
+}
+
+void Catalog::free_run(const Run &run) {
+    write_run_hdr(run.start, RUN_FREE, run.num_pages);
+    add_free(run.start, run.num_pages);
+}
+
+void Catalog::add_free(page_id_t start, int num_pages) {
+    auto next = free_runs_.lower_bound(start);
+    if (next != free_runs_.end() && next->first == start + num_pages) {
+        num_pages += next->second;
+        next = free_runs_.erase(next);
+    }
+    if (next != free_runs_.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == start) {
+            prev->second += num_pages;
+            return;
+        }
+    }
+    free_runs_.emplace(start, num_pages);
+}
+
+void Catalog::write_run_hdr(page_id_t start, uint32_t magic, int num_pages) {
+    RunHdr run_hdr{magic, static_cast<uint32_t>(num_pages), -1, 0, 0, 0};
+    write_fully(fd_, reinterpret_cast<const char *>(&run_hdr), sizeof(run_hdr), static_cast<off_t>(start) * PAGE_SIZE);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "sm_meta.h"
+
+/*
+Catalog把数据库的元数据以二进制保存在db.meta中，每张表编码后占用一段连续的页面(run)，DDL只重写被修改的表
+1. 第0页是文件头：魔数、格式版本和下一张新建的表的编号。之后的文件由若干run首尾相连组成，每个run的第一页以RunHdr开头：
+   使用中的run保存一张表的编码长度、校验和与写入序号，编码紧跟在RunHdr之后；空闲的run只记录页数
+2. 修改一张表时先把新的编码写入一个空闲run(首次适配，没有足够大的空闲run时追加到文件末尾)并fdatasync，
+   再把旧的run标记为空闲，崩溃时看到的是旧版本或新版本；两个版本都在时，打开时保留写入序号较大的一个
+3. 空闲run比需要的大时拆分，先在剩余部分的第一页写入空闲RunHdr，再写入新的run，因此任何时刻从第1页开始按RunHdr
+   都能遍历整个文件。内存中相邻的空闲run合并，磁盘上的RunHdr不需要修改
+4. 打开时一次读入整个文件，按RunHdr遍历并解码所有表
+*/
+class Catalog {
+   public:
+    Catalog() = default;
+
+    Catalog(const Catalog &) = delete;
+    Catalog &operator=(const Catalog &) = delete;
+
+    ~Catalog() { close(); }
+
+    /**
+     * @description: 创建只有文件头的目录文件，已经存在时清空
+     * @param {string&} path 目录文件的路径
+     */
+    static void create(const std::string &path);
+
+    /**
+     * @description: 打开目录文件并读出所有表的元数据
+     * @param {string&} path 目录文件的路径
+     * @param {vector<TabMeta>*} tables 读出的表
+     * @param {int*} next_tab_id 下一张新建的表的编号
+     */
+    void open(const std::string &path, std::vector<TabMeta> *tables, int *next_tab_id);
+
+    void close();
+
+    /**
+     * @description: 写入一张表的新版本并落盘，返回时旧版本已经被替换
+     * @param {int} tab_id 表的编号
+     * @param {string&} record TabMeta::encode()得到的编码
+     */
+    void write_table(int tab_id, const std::string &record);
+
+    /**
+     * @description: 删除一张表的元数据并落盘
+     * @param {int} tab_id 表的编号
+     */
+    void remove_table(int tab_id);
+
+    /**
+     * @description: 在文件头中记录下一张新建的表的编号，随之后的write_table()一起落盘
+     */
+    void set_next_tab_id(int next_tab_id);
+
+    page_id_t get_num_pages() const { return num_pages_; }
+
+    size_t get_num_free_pages() const {
+        size_t num_free = 0;
+        for (auto &entry : free_runs_) {
+            num_free += entry.second;
+        }
+        return num_free;
+    }
+
+   private:
+    struct Run {
+        page_id_t start;
+        int num_pages;
+    };
+
+    page_id_t allocate(int num_pages);
+
+    void free_run(const Run &run);
+
+    void add_free(page_id_t start, int num_pages);
+
+    void write_run_hdr(page_id_t start, uint32_t magic, int num_pages);
+
+    int fd_ = -1;
+    page_id_t num_pages_ = 0;                   // 文件的页数，包括文件头
+    uint64_t next_seq_ = 1;                     // 下一次写入的序号
+    std::unordered_map<int, Run> tables_;       // 表的编号 -> 保存它的run
+    std::map<page_id_t, int> free_runs_;        // 空闲run的第一页 -> 页数，相邻的空闲run已经合并
+};
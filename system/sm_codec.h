@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "errors.h"
+
+/*
+目录(db.meta)中元数据的二进制编码：定长字段按本机字节序原样写入，字符串和数组先写32位长度再写内容。
+TabMeta、IndexMeta、ColMeta和统计信息各自提供encode()/decode()，目录只负责把编码后的字节放入页面
+*/
+class CatalogEncoder {
+   public:
+    template <typename T>
+    void put(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be encoded");
+        buf_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void put_string(const std::string &value) {
+        put(static_cast<uint32_t>(value.size()));
+        buf_.append(value);
+    }
+
+    std::string &buffer() { return buf_; }
+
+   private:
+    std::string buf_;
+};
+
+class CatalogDecoder {
+   public:
+    CatalogDecoder(const char *data, size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be decoded");
+        T value;
+        memcpy(&value, take(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    std::string get_string() {
+        uint32_t len = get<uint32_t>();
+        const char *data = take(len);
+        return std::string(data, len);
+    }
+
+    bool at_end() const { return pos_ == size_; }
+
+   private:
+    const char *take(size_t len) {
+        if (len > size_ - pos_) {
+            throw InternalError("CatalogDecoder: truncated catalog record");
+        }
+        const char *data = data_ + pos_;
+        pos_ += len;
+        return data;
+    }
+
+    const char *data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
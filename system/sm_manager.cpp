@@ -3,11 +3,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <fstream>
-
 #include "index/ix.h"
 #include "record/rm.h"
 #include "record_printer.h"
+#include "sm_partition.h"
+#include "storage/buffer_pool_warmer.h"
+#include "table_loader.h"
 
 /**
  * @description: 判断是否为一个文件夹
@@ -28,7 +29,7 @@ void SmManager::create_db(const std::string& db_name) {
         throw DatabaseExistsError(db_name);
     }
     db_.name_ = db_name;
-    db_.tabs_.clear();
+    db_.clear();
     std::string cmd = "mkdir " + db_name;
     if (system(cmd.c_str()) < 0) { 
         throw UnixError();
@@ -36,11 +37,10 @@ void SmManager::create_db(const std::string& db_name) {
     if (chdir(db_name.c_str()) < 0) {  
         throw UnixError();
     }
-    DbMeta *new_db = new DbMeta();
-    new_db->name_ = db_name;
-    std::ofstream ofs(DB_META_NAME);
-    ofs << *new_db;  
-    delete new_db;
+    Catalog::create(DB_META_NAME);
+    // 新建的数据库成为当前数据库，之后的DDL直接写入它的目录
+    std::vector<TabMeta> tables;
+    catalog_.open(DB_META_NAME, &tables, &db_.next_tab_id_);
     disk_manager_->create_file(LOG_FILE_NAME);
 }
 
@@ -59,74 +59,288 @@ void SmManager::drop_db(const std::string& db_name) {
 }
 
 /**
- * @description: 打开数据库，找到数据库对应的文件夹，并加载数据库元数据和相关文件
+ * @description: 打开数据库，找到数据库对应的文件夹并加载数据库元数据。表的数据文件和索引文件不在这里打开，
+ *               由get_table_handle()在表第一次被使用时打开
  * @param {string&} db_name 数据库名称，与文件夹同名
+ * @param {bool} read_only 只读打开，之后打开的堆表和B+树索引文件映射到内存读取，调用者负责拒绝所有修改
  */
-void SmManager::open_db(const std::string& db_name) {
+void SmManager::open_db(const std::string& db_name, bool read_only) {
     if (!is_dir(db_name)) {
         throw DatabaseNotFoundError(db_name);
     }
     if (chdir(db_name.c_str()) < 0) {
         throw UnixError();
     }
-    std::ifstream ifs(DB_META_NAME);
-    if (!ifs.is_open()) {
-        throw UnixError();
-    }
-    ifs >> db_;
+    std::vector<TabMeta> tables;
+    db_.clear();
+    catalog_.open(DB_META_NAME, &tables, &db_.next_tab_id_);
     db_.name_ = db_name;
-    for (auto &entry : db_.tabs_) {
-        auto &tab_name = entry.first;
-        fhs_[tab_name] = rm_manager_->open_file(tab_name);
-        for (auto &index : entry.second.indexes) {
-            ihs_[ix_manager_->get_index_name(tab_name, index.cols)] = ix_manager_->open_index(tab_name, index.cols);
-        }
+    read_only_ = read_only;
+    for (auto &tab : tables) {
+        db_.add_table(tab);
     }
+    schema_version_++;
 }
 
 /**
- * @description: 把数据库相关的元数据刷入磁盘中
+ * @description: 把DML增量维护过统计信息的表写入目录，DDL修改的表已经在DDL中写入
  */
 void SmManager::flush_meta() {
-    // 默认清空文件
-    std::ofstream ofs(DB_META_NAME);
-    ofs << db_;
+    std::vector<int> changed;
+    {
+        std::lock_guard<std::mutex> guard(stats_latch_);
+        changed.assign(stats_changed_.begin(), stats_changed_.end());
+    }
+    for (int tab_id : changed) {
+        TabMeta *tab = db_.get_table_by_id(tab_id);
+        if (tab != nullptr) {
+            persist_table(*tab);
+        }
+    }
+}
+
+// 编码一张表的元数据并写入目录，统计信息在stats_latch_下编码
+void SmManager::persist_table(const TabMeta& tab) {
+    CatalogEncoder encoder;
+    {
+        std::lock_guard<std::mutex> guard(stats_latch_);
+        tab.encode(encoder);
+        stats_changed_.erase(tab.id);
+    }
+    catalog_.write_table(tab.id, encoder.buffer());
+}
+
+// 打开表的数据文件和各个索引的文件并生成句柄，已经打开的表直接返回。调用者持有handles_latch_
+TableHandle& SmManager::open_table(const TabMeta& tab) {
+    auto pos = handles_.find(tab.id);
+    if (pos != handles_.end()) {
+        return pos->second;
+    }
+    fhs_[tab.name] = rm_manager_->open_file(tab.name, read_only_);
+    for (auto &index : tab.indexes) {
+        open_index(tab.name, index);
+    }
+    open_handle(tab);
+    return handles_.at(tab.id);
+}
+
+// 按名称解析表的数据文件和各个索引的文件，重新生成表的句柄。DDL修改表之后调用，调用者持有handles_latch_
+void SmManager::open_handle(const TabMeta& tab) {
+    TableHandle &handle = handles_[tab.id];
+    handle.tab = &tab;
+    handle.fh = fhs_.at(tab.name).get();
+    handle.indexes.clear();
+    for (auto &index : tab.indexes) {
+        auto ix_name = ix_manager_->get_index_name(tab.name, index.cols);
+        if (index.type == IndexType::HASH) {
+            handle.indexes.push_back({&index, nullptr, hash_ihs_.at(ix_name).get()});
+        } else {
+            handle.indexes.push_back({&index, ihs_.at(ix_name).get()});
+        }
+    }
+}
+
+// 按索引的类型打开索引文件
+void SmManager::open_index(const std::string& tab_name, const IndexMeta& index) {
+    auto ix_name = ix_manager_->get_index_name(tab_name, index.cols);
+    if (index.type == IndexType::HASH) {
+        hash_ihs_[ix_name] = ix_manager_->open_hash_index(tab_name, index.cols);
+    } else {
+        auto &ih = ihs_[ix_name] = ix_manager_->open_index(tab_name, index.cols, read_only_);
+        if (ENABLE_INDEX_CHANGE_BUFFER && !read_only_) {
+            ih->enable_change_buffer(IX_CHANGE_BUFFER_CAPACITY);
+        }
+    }
+}
+
+// 关闭打开的索引文件
+void SmManager::close_index(const std::string& tab_name, const IndexMeta& index) {
+    auto ix_name = ix_manager_->get_index_name(tab_name, index.cols);
+    if (ihs_.count(ix_name)) {
+        ix_manager_->close_index(ihs_.at(ix_name).get());
+        ihs_.erase(ix_name);
+    }
+    if (hash_ihs_.count(ix_name)) {
+        ix_manager_->close_index(hash_ihs_.at(ix_name).get());
+        hash_ihs_.erase(ix_name);
+    }
+}
+
+const TableHandle& SmManager::get_table_handle(int tab_id) {
+    std::scoped_lock lock{handles_latch_};
+    auto pos = handles_.find(tab_id);
+    if (pos != handles_.end()) {
+        return pos->second;
+    }
+    const TabMeta *tab = db_.get_table_by_id(tab_id);
+    if (tab == nullptr) {
+        throw InternalError("SmManager::get_table_handle: table " + std::to_string(tab_id) + " not found");
+    }
+    return open_table(*tab);
+}
+
+/**
+ * @description: 按扫描的条件剪掉分区表中不可能包含满足条件的记录的分区，打开剩下的分区。
+ *               没有分区能满足条件时保留第一个分区，扫描时条件过滤掉它的所有记录，算子仍能得到输出的字段
+ * @return {vector<const TableHandle*>} 剩下的分区的句柄，按分区的顺序
+ * @param {TabMeta&} tab 分区表的元数据
+ * @param {vector<Condition>&} conds 扫描的条件
+ */
+std::vector<const TableHandle*> SmManager::get_partitions(const TabMeta& tab, const std::vector<Condition>& conds) {
+    std::vector<int> parts = prune_partitions(tab, conds);
+    if (parts.empty()) {
+        parts.push_back(0);
+    }
+    std::vector<const TableHandle*> handles;
+    for (int p : parts) {
+        handles.push_back(&get_table_handle(tab.partition.partitions[p]));
+    }
+    return handles;
+}
+
+/**
+ * @description: 把B+树索引的修改缓冲中缓存的修改写入索引，后台刷脏时调用，使前台写入者很少需要同步写入
+ * @return {size_t} 写入的修改数量
+ * @param {size_t} min_changes 只写入缓存的修改不少于该数量的索引
+ */
+size_t SmManager::merge_index_changes(size_t min_changes) {
+    std::vector<std::shared_ptr<IxIndexHandle>> indexes;
+    {
+        std::scoped_lock lock{handles_latch_};
+        for (auto &entry : ihs_) {
+            if (entry.second->get_num_buffered() >= min_changes) {
+                indexes.push_back(entry.second);
+            }
+        }
+    }
+    // 写入期间索引可能被关闭：关闭时已经写入了全部修改，之后这里不会再访问索引文件
+    size_t merged = 0;
+    for (auto &ih : indexes) {
+        merged += ih->merge_changes();
+    }
+    return merged;
+}
+
+/**
+ * @description: 获取所有已经打开的表的句柄，没有打开过的表在缓冲池中没有页面，也没有需要检查点记录的修改
+ */
+std::vector<const TableHandle*> SmManager::get_open_tables() {
+    std::scoped_lock lock{handles_latch_};
+    std::vector<const TableHandle*> tables;
+    for (auto &entry : handles_) {
+        tables.push_back(&entry.second);
+    }
+    return tables;
+}
+
+/**
+ * @description: 读取表中数据的版本，结果缓存判断缓存的结果是否失效时使用。不打开表
+ * @return {bool} 表是否已经打开，没有打开的表不会有缓存的结果
+ * @param {int} tab_id 表的编号
+ * @param {uint64_t*} version 表中数据的版本
+ * @param {timestamp_t*} last_commit_ts 最后一个修改过表的事务结束时的时间戳
+ */
+bool SmManager::get_data_version(int tab_id, uint64_t* version, timestamp_t* last_commit_ts) {
+    std::scoped_lock lock{handles_latch_};
+    auto pos = handles_.find(tab_id);
+    if (pos == handles_.end()) {
+        return false;
+    }
+    *version = pos->second.data_version.load();
+    *last_commit_ts = pos->second.last_commit_ts.load();
+    return true;
+}
+
+/**
+ * @description: 修改过表的事务提交或回滚时记录结束的时间戳并递增表中数据的版本。
+ *               在事务开始之后、结束之前读取的快照看不到这次修改，结果缓存据此拒绝缓存这样的结果
+ * @param {int} tab_id 表的编号
+ * @param {timestamp_t} commit_ts 事务结束时分配的时间戳
+ */
+void SmManager::mark_table_committed(int tab_id, timestamp_t commit_ts) {
+    std::scoped_lock lock{handles_latch_};
+    auto pos = handles_.find(tab_id);
+    if (pos != handles_.end()) {
+        pos->second.last_commit_ts.store(commit_ts);
+        pos->second.bump_data_version();
+    }
+}
+
+/**
+ * @description: 打开数据文件或索引文件所属的表，缓冲池预热按文件名读入上次记录的页面时使用
+ * @return {int} 文件打开后的fd，不属于当前数据库中任何表的文件返回-1
+ * @param {string&} file_name 表的数据文件名或索引文件名
+ */
+int SmManager::open_file_by_name(const std::string& file_name) {
+    for (auto &entry : db_.tabs_) {
+        const TabMeta &tab = entry.second;
+        bool owns = tab.name == file_name;
+        for (size_t i = 0; !owns && i < tab.indexes.size(); i++) {
+            owns = ix_manager_->get_index_name(tab.name, tab.indexes[i].cols) == file_name;
+        }
+        if (owns) {
+            get_table_handle(tab.id);
+            return disk_manager_->find_file_fd(file_name);
+        }
+    }
+    return -1;
 }
 
 /**
  * @description: 关闭数据库并把数据落盘
  */
 void SmManager::close_db() {
+    // 关闭文件之前记录缓冲池中的页面，重启后据此预热缓冲池
+    if (ENABLE_BUFFER_POOL_WARMUP && !read_only_) {
+        BufferPoolWarmer(buffer_pool_manager_, disk_manager_).dump(BUFFER_POOL_DUMP_NAME);
+    }
+    std::unique_lock lock{handles_latch_};
+    handles_.clear();
     for (auto &entry : ihs_) {
         ix_manager_->close_index(entry.second.get());
     }
     ihs_.clear();
+    for (auto &entry : hash_ihs_) {
+        ix_manager_->close_index(entry.second.get());
+    }
+    hash_ihs_.clear();
     for (auto &entry : fhs_) {
         rm_manager_->close_file(entry.second.get());
     }
     fhs_.clear();
-    flush_meta();
+    lock.unlock();
+    schema_version_++;
+    if (!read_only_) {
+        flush_meta();
+    }
+    read_only_ = false;
+    catalog_.close();
+    std::lock_guard<std::mutex> guard(stats_latch_);
+    stats_changed_.clear();
 }
 
 /**
- * @description: 显示所有的表,通过测试需要将其结果写入到output.txt,详情看题目文档
+ * @description: 显示所有的表,通过测试需要将其结果写入到结果日志output.txt,详情看题目文档
  * @param {Context*} context 
  */
 void SmManager::show_tables(Context* context) {
-    std::fstream outfile;
-    outfile.open("output.txt", std::ios::out | std::ios::app);
-    outfile << "| Tables |\n";
+    std::string log_text = "| Tables |\n";
     RecordPrinter printer(1);
     printer.print_separator(context);
     printer.print_record({"Tables"}, context);
     printer.print_separator(context);
     for (auto &entry : db_.tabs_) {
         auto &tab = entry.second;
+        if (tab.parent_id >= 0) {
+            continue;
+        }
         printer.print_record({tab.name}, context);
-        outfile << "| " << tab.name << " |\n";
+        log_text += "| " + tab.name + " |\n";
     }
     printer.print_separator(context);
-    outfile.close();
+    if (context->result_log_ != nullptr) {
+        context->result_log_->append(std::move(log_text));
+    }
 }
 
 /**
@@ -142,7 +356,8 @@ void SmManager::desc_table(const std::string& tab_name, Context* context) {
     printer.print_record(captions, context);
     printer.print_separator(context);
     for (auto &col : tab.cols) {
-        std::vector<std::string> field_info = {col.name, coltype2str(col.type), col.index ? "YES" : "NO"};
+        std::string type = col.var_len ? "VARCHAR" : coltype2str(col.type);
+        std::vector<std::string> field_info = {col.name, type, col.index ? "YES" : "NO"};
         printer.print_record(field_info, context);
     }
     printer.print_separator(context);
@@ -153,8 +368,11 @@ void SmManager::desc_table(const std::string& tab_name, Context* context) {
  * @param {string&} tab_name 表的名称
  * @param {vector<ColDef>&} col_defs 表的字段
  * @param {Context*} context 
+ * @param {TableLayout} layout 页面布局，PAX格式中每个字段一个minipage，压缩时按字段类型选择minipage的编码方式
+ * @param {PartitionSpec&} partition 分区方式，不分区时kind为NONE。partitions只给出分区数，各分区的表在这里创建并分配编号
  */
-void SmManager::create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context) {
+void SmManager::create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context,
+                             TableLayout layout, const PartitionSpec& partition) {
     if (db_.is_table(tab_name)) {
         throw TableExistsError(tab_name);
     }
@@ -167,15 +385,104 @@ void SmManager::create_table(const std::string& tab_name, const std::vector<ColD
                        .type = col_def.type,
                        .len = col_def.len,
                        .offset = curr_offset,
-                       .index = false};
+                       .index = false,
+                       .var_len = col_def.var_len};
         curr_offset += col_def.len;
         tab.cols.push_back(col);
     }
-    int record_size = curr_offset;  
-    rm_manager_->create_file(tab_name, record_size);
-    db_.tabs_[tab_name] = tab;
-    fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
-    flush_meta();
+    if (partition.kind != PartitionKind::NONE) {
+        check_partition(tab, partition);
+    }
+    tab.id = db_.next_tab_id_++;
+    create_table_file(tab, layout);
+    // 分区的字段仍属于分区表，扫描分区输出的记录与扫描分区表相同
+    std::vector<TabMeta> partitions;
+    if (partition.kind != PartitionKind::NONE) {
+        tab.partition = partition;
+        tab.partition.partitions.clear();
+        for (size_t i = 0; i < partition.partitions.size(); i++) {
+            TabMeta part;
+            part.name = tab_name + "#p" + std::to_string(i);
+            part.id = db_.next_tab_id_++;
+            part.cols = tab.cols;
+            part.parent_id = tab.id;
+            create_table_file(part, layout);
+            tab.partition.partitions.push_back(part.id);
+            partitions.push_back(std::move(part));
+        }
+    }
+    TabMeta &meta = db_.add_table(tab);
+    for (auto &part : partitions) {
+        db_.add_table(part);
+    }
+    {
+        std::scoped_lock lock{handles_latch_};
+        open_table(meta);
+    }
+    schema_version_++;
+    catalog_.set_next_tab_id(db_.next_tab_id_);
+    persist_table(tab);
+    for (auto &part : partitions) {
+        persist_table(part);
+    }
+}
+
+// 检查分区方式：分区字段存在，分区数在1到MAX_PARTITIONS之间，RANGE分区的上界与字段等长且严格递增
+void SmManager::check_partition(const TabMeta& tab, const PartitionSpec& partition) {
+    auto &col = *tab.get_col(partition.col_name);
+    if (partition.partitions.empty() || partition.partitions.size() > MAX_PARTITIONS) {
+        throw InvalidPartitionError("table " + tab.name + " has " + std::to_string(partition.partitions.size()) +
+                                    " partitions");
+    }
+    if (partition.kind == PartitionKind::RANGE) {
+        if (partition.bounds.size() + 1 != partition.partitions.size()) {
+            throw InvalidPartitionError("range partitions need one bound less than partitions");
+        }
+        for (size_t i = 0; i < partition.bounds.size(); i++) {
+            if (partition.bounds[i].size() != static_cast<size_t>(col.len)) {
+                throw InvalidPartitionError("bound of column " + col.name + " has wrong length");
+            }
+            if (i > 0 && ix_compare(partition.bounds[i - 1].data(), partition.bounds[i].data(), col.type, col.len) >= 0) {
+                throw InvalidPartitionError("range bounds must be strictly increasing");
+            }
+        }
+    }
+}
+
+// 按页面布局创建表的数据文件
+void SmManager::create_table_file(const TabMeta& tab, TableLayout layout) {
+    if (layout == TableLayout::LSM) {
+        int record_size = 0;
+        for (auto &col : tab.cols) {
+            record_size += col.len;
+        }
+        rm_manager_->create_lsm_file(tab.name, record_size);
+        return;
+    }
+    int record_size = 0;
+    // 含有VARCHAR字段的表使用slotted page，字段按实际长度存储；PAX格式中VARCHAR按定长存储
+    // 4字节的INT和FLOAT字段记录每个页面的最小值和最大值，顺序扫描据此跳过页面
+    std::vector<RmVarField> var_fields;
+    std::vector<RmMinipage> minipages;
+    std::vector<RmZoneColumn> zone_columns;
+    for (auto &col : tab.cols) {
+        record_size += col.len;
+        if ((col.type == TYPE_INT || col.type == TYPE_FLOAT) && col.len == sizeof(int32_t)) {
+            zone_columns.push_back(RmZoneColumn{col.offset, col.type});
+        }
+        if (layout == TableLayout::PAX || layout == TableLayout::PAX_COMPRESSED) {
+            RmMinipage mp{static_cast<uint16_t>(col.offset), static_cast<uint16_t>(col.len)};
+            if (layout == TableLayout::PAX_COMPRESSED && col.type == TYPE_INT && col.len == sizeof(int32_t)) {
+                mp.encoding = RM_ENCODING_FOR;
+            } else if (layout == TableLayout::PAX_COMPRESSED && col.type == TYPE_STRING) {
+                mp.encoding = RM_ENCODING_DICT;
+            }
+            minipages.push_back(mp);
+        } else if (col.var_len) {
+            var_fields.push_back(RmVarField{static_cast<uint16_t>(col.offset), static_cast<uint16_t>(col.len)});
+        }
+    }
+    rm_manager_->create_file(tab.name, record_size, var_fields, minipages, zone_columns);
 }
 
 /**
@@ -187,24 +494,26 @@ void SmManager::drop_table(const std::string& tab_name, Context* context) {
     if (!db_.is_table(tab_name)) {
         throw TableNotFoundError(tab_name);
     }
+    for (int part_id : db_.get_table(tab_name).partition.partitions) {
+        drop_table(db_.get_table_by_id(part_id)->name, context);
+    }
+    std::unique_lock lock{handles_latch_};
     if (fhs_.count(tab_name)) {
         rm_manager_->close_file(fhs_.at(tab_name).get());
         fhs_.erase(tab_name);
     }
     auto &tab = db_.get_table(tab_name);
     for (auto &index : tab.indexes) {
-        std::vector<std::string> col_names;
-        for (auto &c : index.cols) col_names.push_back(c.name);
-        auto ix_name = ix_manager_->get_index_name(tab_name, index.cols);
-        if (ihs_.count(ix_name)) {
-            ix_manager_->close_index(ihs_.at(ix_name).get());
-            ihs_.erase(ix_name);
-        }
-        ix_manager_->destroy_index(tab_name, col_names);
+        close_index(tab_name, index);
+        ix_manager_->destroy_index(tab_name, index.cols);
     }
     rm_manager_->destroy_file(tab_name);
-    db_.tabs_.erase(tab_name);
-    flush_meta();
+    int tab_id = tab.id;
+    handles_.erase(tab_id);
+    lock.unlock();
+    db_.remove_table(tab_name);
+    schema_version_++;
+    catalog_.remove_table(tab_id);
 }
 
 /**
@@ -212,12 +521,17 @@ void SmManager::drop_table(const std::string& tab_name, Context* context) {
  * @param {string&} tab_name 表的名称
  * @param {vector<string>&} col_names 索引包含的字段名称
  * @param {Context*} context
+ * @param {IndexType} type 索引的类型
  */
-void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
+void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context,
+                             IndexType type) {
     TabMeta &tab = db_.get_table(tab_name);
     if (tab.is_index(col_names)) {
         throw IndexExistsError(tab_name, col_names);
     }
+    // 先按原来的索引打开表，新的索引文件由build_index()创建
+    std::unique_lock lock{handles_latch_};
+    open_table(tab);
     std::vector<ColMeta> cols;
     int tot_len = 0;
     for (auto &name : col_names) {
@@ -226,11 +540,96 @@ void SmManager::create_index(const std::string& tab_name, const std::vector<std:
         tot_len += it->len;
         it->index = true;
     }
-    IndexMeta meta{tab_name, tot_len, static_cast<int>(cols.size()), cols};
+    IndexMeta meta{tab_name, tot_len, static_cast<int>(cols.size()), cols, tab.next_index_id++, type};
     tab.indexes.push_back(meta);
-    ix_manager_->create_index(tab_name, cols);
-    ihs_[ix_manager_->get_index_name(tab_name, cols)] = ix_manager_->open_index(tab_name, cols);
-    flush_meta();
+    build_index(tab_name, meta);
+    open_handle(tab);
+    lock.unlock();
+    schema_version_++;
+    persist_table(tab);
+    // 分区表上的索引在每个分区上各建一个，分区与分区表的索引总是一起创建和删除，编号相同
+    for (int part_id : tab.partition.partitions) {
+        create_index(db_.get_table_by_id(part_id)->name, col_names, context, type);
+    }
+}
+
+/**
+ * @description: 用表中当前的记录重新构建表上的所有索引。索引的修改不写日志，崩溃恢复重做表的日志后调用
+ * @param {string&} tab_name 表名称
+ */
+void SmManager::rebuild_indexes(const std::string& tab_name) {
+    TabMeta &tab = db_.get_table(tab_name);
+    std::unique_lock lock{handles_latch_};
+    open_table(tab);
+    for (auto &index : tab.indexes) {
+        close_index(tab_name, index);
+        ix_manager_->destroy_index(tab_name, index.cols);
+        build_index(tab_name, index);
+    }
+    open_handle(tab);
+    lock.unlock();
+    schema_version_++;
+}
+
+// 创建并打开索引文件，用表中已有的记录构建索引。调用者持有handles_latch_，表已经打开
+void SmManager::build_index(const std::string& tab_name, const IndexMeta& index) {
+    RmFileHandle *fh = fhs_.at(tab_name).get();
+    auto ix_name = ix_manager_->get_index_name(tab_name, index.cols);
+    if (index.type == IndexType::HASH) {
+        ix_manager_->create_hash_index(tab_name, index.cols);
+        auto &ih = hash_ihs_[ix_name] = ix_manager_->open_hash_index(tab_name, index.cols);
+        bulk_load_index(fh, ih.get(), index);
+    } else {
+        ix_manager_->create_index(tab_name, index.cols);
+        auto &ih = ihs_[ix_name] = ix_manager_->open_index(tab_name, index.cols);
+        bulk_load_index(fh, ih.get(), index);
+        if (ENABLE_INDEX_CHANGE_BUFFER) {
+            ih->enable_change_buffer(IX_CHANGE_BUFFER_CAPACITY);
+        }
+    }
+}
+
+// 表中已有的记录排序后自底向上批量构建索引，而不是逐条insert_entry
+void SmManager::bulk_load_index(RmFileHandle* fh, IxIndexHandle* ih, const IndexMeta& index) {
+    IxBulkLoader loader(ih);
+    std::vector<char> key(index.col_tot_len);
+    for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+        const char *record = scan.record();
+        int offset = 0;
+        for (auto &col : index.cols) {
+            memcpy(key.data() + offset, record + col.offset, col.len);
+            offset += col.len;
+        }
+        loader.add(key.data(), scan.rid());
+    }
+    loader.finish();
+}
+
+// 哈希索引没有顺序，表中已有的记录分批插入，每批按hash值的顺序插入使同一个桶的key相邻
+void SmManager::bulk_load_index(RmFileHandle* fh, IxHashIndexHandle* ih, const IndexMeta& index) {
+    constexpr size_t BATCH_SIZE = 4096;
+    std::vector<char> keys;
+    std::vector<Rid> rids;
+    auto flush = [&]() {
+        std::vector<const char *> key_ptrs;
+        for (size_t i = 0; i < rids.size(); i++) {
+            key_ptrs.push_back(keys.data() + i * index.col_tot_len);
+        }
+        ih->insert_entries(key_ptrs, rids, nullptr);
+        keys.clear();
+        rids.clear();
+    };
+    for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+        const char *record = scan.record();
+        for (auto &col : index.cols) {
+            keys.insert(keys.end(), record + col.offset, record + col.offset + col.len);
+        }
+        rids.push_back(scan.rid());
+        if (rids.size() == BATCH_SIZE) {
+            flush();
+        }
+    }
+    flush();
 }
 
 /**
@@ -245,14 +644,20 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<std::s
     for (auto &name : col_names) {
         tab.get_col(name)->index = false;
     }
-    auto ix_name = ix_manager_->get_index_name(tab_name, it_meta->cols);
-    if (ihs_.count(ix_name)) {
-        ix_manager_->close_index(ihs_.at(ix_name).get());
-        ihs_.erase(ix_name);
-    }
+    std::unique_lock lock{handles_latch_};
+    close_index(tab_name, *it_meta);
     tab.indexes.erase(it_meta);
     ix_manager_->destroy_index(tab_name, col_names);
-    flush_meta();
+    // 没有打开的表在第一次使用时按新的元数据打开
+    if (handles_.count(tab.id)) {
+        open_handle(tab);
+    }
+    lock.unlock();
+    schema_version_++;
+    persist_table(tab);
+    for (int part_id : tab.partition.partitions) {
+        drop_index(db_.get_table_by_id(part_id)->name, col_names, context);
+    }
 }
 
 /**
@@ -267,90 +672,396 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<ColMet
     drop_index(tab_name, names, context);
 }
 
-void SmManager::rollback_insert(const std::string &tab_name, const Rid &rid, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    for (size_t col = 0; col < tab.cols.size(); col++)
-        if (tab.cols[col].index)
-            //ihs_.at(get_ix_manager()->get_index_name(tab_name, col)).get()->delete_entry(file_handle->get_record(rid, context)->data + tab.cols[col].offset, nullptr);
-    fhs_.at(tab_name).get()->delete_record(rid, context);
+/**
+ * @description: 收集表的统计信息：精确统计记录数，抽样STATS_SAMPLE_PAGES个页面的记录，
+ *               为每个字段估计NDV并构建最小/最大值和等深直方图，之后写入db.meta。
+ *               分区表按各分区的页面数的比例从每个分区抽样，统计信息只保存在分区表上
+ * @param {string&} tab_name 表名称
+ * @param {Context*} context
+ */
+void SmManager::analyze_table(const std::string& tab_name, Context* context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    std::vector<RmFileHandle *> files;
+    for (int part_id : tab.partition.partitions) {
+        files.push_back(get_table_handle(part_id).fh);
+    }
+    if (files.empty()) {
+        files.push_back(get_table_handle(tab.id).fh);
+    }
+    auto stats = std::make_shared<TableStats>();
+    int64_t total_pages = 0;
+    for (auto fh : files) {
+        stats->row_count += static_cast<int64_t>(fh->count_records());
+        total_pages += fh->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
+    }
+    std::vector<char> sample;
+    std::vector<char> file_sample;
+    size_t n = 0;
+    for (auto fh : files) {
+        int64_t data_pages = fh->get_file_hdr().num_pages - RM_FIRST_RECORD_PAGE;
+        int64_t pages = total_pages == 0 ? STATS_SAMPLE_PAGES
+                                         : (STATS_SAMPLE_PAGES * data_pages + total_pages - 1) / total_pages;
+        n += fh->sample_records(static_cast<int>(pages), file_sample);
+        sample.insert(sample.end(), file_sample.begin(), file_sample.end());
+    }
+    size_t record_size = files[0]->get_file_hdr().record_size;
+    double scale = n == 0 ? 1 : static_cast<double>(stats->row_count) / n;
+    stats->cols.resize(tab.cols.size());
+    std::vector<const char *> values(n);
+    for (size_t c = 0; c < tab.cols.size(); c++) {
+        auto &col = tab.cols[c];
+        auto &col_stats = stats->cols[c];
+        for (size_t i = 0; i < n; i++) {
+            values[i] = sample.data() + i * record_size + col.offset;
+            col_stats.hll.add(stats_hash(values[i], col.type, col.len));
+        }
+        std::sort(values.begin(), values.end(), [&](const char *a, const char *b) {
+            return ix_compare(a, b, col.type, col.len) < 0;
+        });
+        size_t distinct = 0;
+        for (size_t i = 0; i < n; i++) {
+            distinct += i == 0 || ix_compare(values[i - 1], values[i], col.type, col.len) != 0;
+        }
+        col_stats.build(values, col.type, col.len, static_cast<double>(distinct), scale);
+    }
+    {
+        std::lock_guard<std::mutex> guard(stats_latch_);
+        tab.stats = std::move(stats);
+    }
+    schema_version_++;
+    persist_table(tab);
+}
+
+/**
+ * @description: 整理表的数据文件：把文件末尾页面中的记录移动到前面有空闲空间的页面，之后截掉末尾的空页面，
+ *               被截掉的页号由之后新分配的页面复用，顺序扫描也不再读取它们。每次移动像普通的插入和删除一样写日志，
+ *               移动改变了记录号，完成后重建表上的所有索引。分区表逐个整理每个分区。调用者保证表上没有并发的事务。
+ *               LSM表合并全部sorted run并丢弃删除标记，记录号不变
+ * @return {int} 截掉的页面数，LSM表为释放的sorted run页面数
+ * @param {string&} tab_name 表名称
+ * @param {Context*} context
+ */
+int SmManager::vacuum_table(const std::string& tab_name, Context* context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    if (tab.is_partitioned()) {
+        int released = 0;
+        for (int part_id : tab.partition.partitions) {
+            released += vacuum_table(db_.get_table_by_id(part_id)->name, context);
+        }
+        return released;
+    }
+    RmFileHandle *fh = get_table_handle(tab.id).fh;
+    if (fh->lsm() != nullptr) {
+        return fh->truncate();
+    }
+    // 快照仍可能按原来的记录号读取旧版本，这时不能移动记录
+    VersionStore *version_store = context == nullptr ? nullptr : context->version_store_;
+    if (version_store != nullptr) {
+        version_store->collect_garbage();
+        if (version_store->has_versions(fh->GetFd())) {
+            throw TableInUseError(tab_name);
+        }
+    }
+    bool logging = context != nullptr && context->logging();
+    int dest = RM_FIRST_RECORD_PAGE;
+    for (int src = fh->get_file_hdr().num_pages - 1; dest < src; src--) {
+        std::vector<Rid> rids;
+        {
+            RmPageHandle page_handle = fh->fetch_page_handle(src);
+            int n = fh->get_file_hdr().num_records_per_page;
+            for (int slot = page_handle.next_record(-1); slot < n; slot = page_handle.next_record(slot)) {
+                rids.push_back(Rid{src, slot});
+            }
+            buffer_pool_manager_->unpin_page(page_handle.page->get_page_id(), false);
+        }
+        for (auto &rid : rids) {
+            auto record = fh->get_record(rid, context);
+            int slot = -1;
+            while (dest < src && (slot = fh->find_free_slot(dest, record->data)) == -1) {
+                dest++;
+            }
+            if (dest >= src) {
+                break;
+            }
+            Rid new_rid{dest, slot};
+            lsn_t lsn = INVALID_LSN;
+            if (logging) {
+                InsertLogRecord log_record(context->txn_->get_transaction_id(), tab.id, new_rid, record->data,
+                                           record->size);
+                lsn = context->log_mgr_->append_txn_log(context->txn_, &log_record);
+            }
+            fh->insert_record(new_rid, record->data);
+            if (lsn != INVALID_LSN) {
+                fh->set_page_lsn(new_rid.page_no, lsn);
+            }
+            if (logging) {
+                DeleteLogRecord log_record(context->txn_->get_transaction_id(), tab.id, rid, record->data,
+                                           record->size);
+                lsn = context->log_mgr_->append_txn_log(context->txn_, &log_record);
+            }
+            fh->delete_record(rid, context);
+            if (lsn != INVALID_LSN) {
+                fh->set_page_lsn(rid.page_no, lsn);
+            }
+        }
+    }
+    int released = fh->truncate();
+    get_table_handle(tab.id).bump_data_version();
+    rebuild_indexes(tab_name);
+    return released;
+}
+
+/**
+ * @description: 从CSV文件批量导入记录：并行解析为定长记录后按顺序填满数据页。
+ *               导入前表为空时各B+树索引自底向上批量构建，否则(以及哈希索引)每个索引的新key排序后批量插入
+ * @return {size_t} 导入的记录数
+ * @param {string&} tab_name 表名称
+ * @param {string&} file_name CSV文件路径，相对路径相对于数据库目录
+ * @param {Context*} context
+ */
+size_t SmManager::load_table(const std::string& tab_name, const std::string& file_name, Context* context) {
+    const TableHandle &handle = get_table_handle(tab_name);
+    const TabMeta &tab = *handle.tab;
+    int record_size = handle.fh->get_file_hdr().record_size;
+    // 先解析完整个文件，格式错误时表不会被修改
+    TableLoader loader(tab, record_size);
+    std::vector<std::vector<char>> chunks = loader.load_file(file_name);
+    if (!tab.is_partitioned()) {
+        return load_records(handle, chunks, context);
+    }
+    // 分区表按分区字段把记录分发到各个分区，每个分区的记录放在一块中导入
+    std::vector<std::vector<std::vector<char>>> part_chunks(tab.partition.partitions.size(),
+                                                            std::vector<std::vector<char>>(1));
+    for (auto &chunk : chunks) {
+        for (size_t offset = 0; offset < chunk.size(); offset += record_size) {
+            auto &dest = part_chunks[partition_of_record(tab, chunk.data() + offset)][0];
+            dest.insert(dest.end(), chunk.data() + offset, chunk.data() + offset + record_size);
+        }
+        std::vector<char>().swap(chunk);
+    }
+    size_t num_rows = 0;
+    for (size_t i = 0; i < part_chunks.size(); i++) {
+        if (!part_chunks[i][0].empty()) {
+            num_rows += load_records(get_table_handle(tab.partition.partitions[i]), part_chunks[i], context);
+        }
+    }
+    return num_rows;
 }
 
-void SmManager::rollback_delete(const std::string &tab_name, const RmRecord &record, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    for (size_t col = 0; col < tab.cols.size(); col++)
-        if (tab.cols[col].index){
-            //ihs_.at(get_ix_manager()->get_index_name(tab_name, col)).get()->insert_entry(record.data + tab.cols[col].offset, file_handle->insert_record(record.data, context), context->txn_);
+// 把解析好的记录按顺序写入数据页并维护各个索引
+size_t SmManager::load_records(const TableHandle& handle, std::vector<std::vector<char>>& chunks,
+                               Context* context) {
+    const TabMeta &tab = *handle.tab;
+    RmFileHandle *fh = handle.fh;
+    int record_size = fh->get_file_hdr().record_size;
+
+    bool bulk_build = fh->count_records() == 0;
+    std::vector<std::unique_ptr<IxBulkLoader>> bulk_loaders;    // 不批量构建的索引为nullptr
+    std::vector<std::vector<char>> keys(tab.indexes.size());
+    std::vector<std::vector<Rid>> rids(tab.indexes.size());
+    for (auto &index : handle.indexes) {
+        bool bulk = bulk_build && index.ih != nullptr;
+        bulk_loaders.push_back(bulk ? std::make_unique<IxBulkLoader>(index.ih) : nullptr);
+    }
+
+    size_t num_rows = 0;
+    std::vector<char *> records;
+    for (auto &chunk : chunks) {
+        records.clear();
+        for (size_t offset = 0; offset < chunk.size(); offset += record_size) {
+            records.push_back(chunk.data() + offset);
+        }
+        std::vector<Rid> chunk_rids = fh->insert_records(records, context);
+        for (size_t r = 0; r < records.size(); r++) {
+            update_stats(tab, nullptr, records[r]);
+            for (size_t i = 0; i < tab.indexes.size(); i++) {
+                auto &index = tab.indexes[i];
+                size_t key_offset = keys[i].size();
+                keys[i].resize(key_offset + index.col_tot_len);
+                char *key = keys[i].data() + key_offset;
+                for (auto &col : index.cols) {
+                    memcpy(key, records[r] + col.offset, col.len);
+                    key += col.len;
+                }
+                if (bulk_loaders[i] != nullptr) {
+                    bulk_loaders[i]->add(keys[i].data() + key_offset, chunk_rids[r]);
+                    keys[i].resize(key_offset);
+                } else {
+                    rids[i].push_back(chunk_rids[r]);
+                }
             }
+        }
+        num_rows += records.size();
+    }
+
+    for (size_t i = 0; i < tab.indexes.size(); i++) {
+        if (bulk_loaders[i] != nullptr) {
+            bulk_loaders[i]->finish();
+            continue;
+        }
+        std::vector<const char *> key_ptrs;
+        key_ptrs.reserve(rids[i].size());
+        for (size_t k = 0; k < rids[i].size(); k++) {
+            key_ptrs.push_back(keys[i].data() + k * tab.indexes[i].col_tot_len);
+        }
+        handle.indexes[i].insert_entries(key_ptrs, rids[i], context->txn_);
+    }
+    handle.bump_data_version();
+    return num_rows;
 }
-void SmManager::rollback_update(const std::string &tab_name, const Rid &rid, const RmRecord &record, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    for (size_t col = 0; col < tab.cols.size(); col++)
-        if (tab.cols[col].index)
-            //ihs_.at(get_ix_manager()->get_index_name(tab_name, col)).get()->delete_entry(file_handle->get_record(rid, context)->data + tab.cols[col].offset, nullptr);
-    fhs_.at(tab_name).get()->update_record(rid, record.data, context);
-    for (size_t col = 0; col < tab.cols.size(); col++)
-        if (tab.cols[col].index){
-            //ihs_.at(get_ix_manager()->get_index_name(tab_name, col)).get()->insert_entry(record.data + tab.cols[col].offset, rid, context->txn_);
-        }
-}
-
-void SmManager::rollback_insert(const std::string &tab_name, const Rid &rid, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    auto record = file_handle->get_record(rid, context);
-    for (size_t col = 0; col < tab.cols.size(); col++)
-    {
-        if (tab.cols[col].index)
-        {
-            auto &index_handle = ihs_.at(get_ix_manager()->get_index_name(tab_name, {tab.cols[col].name}));
-            index_handle->delete_entry(record->data + tab.cols[col].offset,context->txn_);
+
+/**
+ * @description: DML之后增量维护表的统计信息，没有收集过统计信息的表不需要维护
+ * @param {TabMeta&} tab 表的元数据
+ * @param {char*} old_record 删除或更新前的记录，插入时为nullptr
+ * @param {char*} new_record 插入或更新后的记录，删除时为nullptr
+ */
+void SmManager::update_stats(const TabMeta& tab, const char* old_record, const char* new_record) {
+    // 分区中的修改维护分区表的统计信息，分区的记录格式与分区表相同
+    const TabMeta &owner = tab.parent_id >= 0 ? *db_.get_table_by_id(tab.parent_id) : tab;
+    std::lock_guard<std::mutex> guard(stats_latch_);
+    TableStats *stats = owner.stats.get();
+    if (stats == nullptr) {
+        return;
+    }
+    stats_changed_.insert(owner.id);
+    stats->row_count += (new_record != nullptr) - (old_record != nullptr);
+    for (size_t c = 0; c < tab.cols.size(); c++) {
+        auto &col = tab.cols[c];
+        if (old_record != nullptr && new_record != nullptr &&
+            memcmp(old_record + col.offset, new_record + col.offset, col.len) == 0) {
+            continue;
+        }
+        if (old_record != nullptr) {
+            stats->cols[c].remove(old_record + col.offset, col.type, col.len);
+        }
+        if (new_record != nullptr) {
+            stats->cols[c].add(new_record + col.offset, col.type, col.len);
         }
     }
-    file_handle->delete_record(rid, context);
 }
 
-void SmManager::rollback_delete(const std::string &tab_name, const RmRecord &record, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    Rid rid = file_handle->insert_record(record.data, context);
-    for (size_t col = 0; col < tab.cols.size(); col++)
+/**
+ * @description: 回滚一次插入：删除插入的记录和它的索引项
+ * @param {UndoRecord&} undo 插入对应的undo记录
+ * @param {Context*} context 回滚的事务的上下文，回滚本身像普通的修改一样写日志、登记版本
+ */
+void SmManager::rollback_insert(const UndoRecord &undo, Context *context) {
+    auto handle = handles_.find(undo.table_id);
+    if (handle == handles_.end()) {
+        return;
+    }
+    const TabMeta *tab = handle->second.tab;
+    RmFileHandle *fh = handle->second.fh;
+    auto record = fh->get_record(undo.rid, context);
     {
-        if (tab.cols[col].index)
-        {
-            auto &index_handle = ihs_.at(get_ix_manager()->get_index_name(tab_name, {tab.cols[col].name}));
-            index_handle->insert_entry(record.data + tab.cols[col].offset, rid, context->txn_);
+        VersionStore::Writer versions(context->version_store_, context->txn_, tab->id, fh->GetFd(), record->size);
+        versions.remove(undo.rid, record->data);
+        lsn_t lsn = INVALID_LSN;
+        if (context->logging()) {
+            DeleteLogRecord log_record(context->txn_->get_transaction_id(), tab->id, undo.rid, record->data,
+                                       record->size);
+            lsn = context->log_mgr_->append_txn_log(context->txn_, &log_record);
+        }
+        fh->delete_record(undo.rid, context);
+        if (lsn != INVALID_LSN) {
+            fh->set_page_lsn(undo.rid.page_no, lsn);
         }
     }
+    update_stats(*tab, record->data, nullptr);
+    rollback_indexes(handle->second, record->data, nullptr, undo.rid, context);
 }
 
-void SmManager::rollback_update(const std::string &tab_name, const Rid &rid, const RmRecord &record, Context *context)
-{
-    auto tab = db_.get_table(tab_name);
-    auto file_handle = fhs_.at(tab_name).get();
-    auto old_record = file_handle->get_record(rid, context);
-    for (size_t col = 0; col < tab.cols.size(); col++)
+/**
+ * @description: 回滚一次删除：把记录放回原来的位置，原来的位置(或slotted page中原来的空间)已经被其他事务占用时插入到新的位置
+ * @param {UndoRecord&} undo 删除对应的undo记录，保存了整条记录
+ * @param {Context*} context 回滚的事务的上下文
+ */
+void SmManager::rollback_delete(const UndoRecord &undo, Context *context) {
+    auto handle = handles_.find(undo.table_id);
+    if (handle == handles_.end()) {
+        return;
+    }
+    const TabMeta *tab = handle->second.tab;
+    RmFileHandle *fh = handle->second.fh;
+    char *record = context->arena_.allocate(undo.len);
+    memcpy(record, undo.before(), undo.len);
+    Rid rid = undo.rid;
     {
-        if (tab.cols[col].index)
-        {
-            auto &index_handle = ihs_.at(get_ix_manager()->get_index_name(tab_name, {tab.cols[col].name}));
-            index_handle->delete_entry(old_record->data + tab.cols[col].offset, context->txn_);
+        VersionStore::Writer versions(context->version_store_, context->txn_, tab->id, fh->GetFd(), undo.len);
+        if (!fh->can_insert_at(rid, record)) {
+            rid = fh->insert_record(record, context);
+        } else {
+            fh->insert_record(rid, record);
+        }
+        versions.insert(rid);
+        if (context->logging()) {
+            InsertLogRecord log_record(context->txn_->get_transaction_id(), tab->id, rid, record, undo.len);
+            fh->set_page_lsn(rid.page_no, context->log_mgr_->append_txn_log(context->txn_, &log_record));
         }
     }
-    file_handle->update_record(rid, record.data, context);
-    for (size_t col = 0; col < tab.cols.size(); col++)
+    update_stats(*tab, nullptr, record);
+    rollback_indexes(handle->second, nullptr, record, rid, context);
+}
+
+/**
+ * @description: 回滚一次更新：把undo记录中修改前的字节写回记录
+ * @param {UndoRecord&} undo 更新对应的undo记录，只保存了修改过的字节区间
+ * @param {Context*} context 回滚的事务的上下文
+ */
+void SmManager::rollback_update(const UndoRecord &undo, Context *context) {
+    auto handle = handles_.find(undo.table_id);
+    if (handle == handles_.end()) {
+        return;
+    }
+    const TabMeta *tab = handle->second.tab;
+    RmFileHandle *fh = handle->second.fh;
+    auto record = fh->get_record(undo.rid, context);
+    char *restored = context->arena_.allocate(record->size);
+    memcpy(restored, record->data, record->size);
+    memcpy(restored + undo.offset, undo.before(), undo.len);
     {
-        if (tab.cols[col].index)
-        {
-            auto &index_handle = ihs_.at(get_ix_manager()->get_index_name(tab_name, {tab.cols[col].name}));
-            index_handle->insert_entry(record.data + tab.cols[col].offset, rid, context->txn_);
+        VersionStore::Writer versions(context->version_store_, context->txn_, tab->id, fh->GetFd(), record->size);
+        versions.update(undo.rid, record->data, restored);
+        lsn_t lsn = INVALID_LSN;
+        if (context->logging()) {
+            UpdateLogRecord log_record(context->txn_->get_transaction_id(), tab->id, undo.rid, record->data,
+                                       restored, record->size);
+            lsn = context->log_mgr_->append_txn_log(context->txn_, &log_record);
+        }
+        fh->update_record(undo.rid, restored, context);
+        if (lsn != INVALID_LSN) {
+            fh->set_page_lsn(undo.rid.page_no, lsn);
+        }
+    }
+    update_stats(*tab, record->data, restored);
+    rollback_indexes(handle->second, record->data, restored, undo.rid, context);
+}
+
+// 记录从old_record变为new_record后修改表上的各个索引，为空表示记录不存在，key没有变化的索引不做修改
+void SmManager::rollback_indexes(const TableHandle &handle, const char *old_record, const char *new_record,
+                                 const Rid &rid, Context *context) {
+    for (auto &index_handle : handle.indexes) {
+        const IndexMeta &index = *index_handle.meta;
+        auto make_key = [&](const char *record) {
+            char *key = context->arena_.allocate(index.col_tot_len);
+            int offset = 0;
+            for (auto &col : index.cols) {
+                memcpy(key + offset, record + col.offset, col.len);
+                offset += col.len;
+            }
+            return key;
+        };
+        const char *old_key = old_record == nullptr ? nullptr : make_key(old_record);
+        const char *new_key = new_record == nullptr ? nullptr : make_key(new_record);
+        if (old_key != nullptr && new_key != nullptr && memcmp(old_key, new_key, index.col_tot_len) == 0) {
+            continue;
+        }
+        if (old_key != nullptr) {
+            index_handle.delete_entry(old_key, context->txn_);
+        }
+        if (new_key != nullptr) {
+            index_handle.insert_entry(new_key, rid, context->txn_);
         }
     }
-}
\ No newline at end of file
+}
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+
 #include "index/ix.h"
 #include "record/rm_file_handle.h"
 #include "sm_defs.h"
+#include "sm_catalog.h"
 #include "sm_meta.h"
 #include "common/context.h"
 
@@ -12,19 +17,106 @@ struct ColDef {
     std::string name;  // Column name
     ColType type;      // Type of column
     int len;           // Length of column
+    bool var_len = false;  // VARCHAR: stored with its actual length
+};
+
+/* 表数据文件的页面布局：ROW按行存放记录，PAX在每个页面中按列存放记录，适合只读取少数字段的分析型扫描；
+   PAX_COMPRESSED在PAX的基础上，页面被淘汰出缓冲池后按列压缩保存在压缩页缓存中(整数列frame-of-reference，字符串列字典)，
+   适合很大、大部分冷的表；LSM不使用数据页，写入进入memtable后批量写成有序的sorted run(见RmLsmTree)，适合以追加为主的写密集表 */
+enum class TableLayout { ROW, PAX, PAX_COMPRESSED, LSM };
+
+/* 打开的索引：索引的元数据和索引文件句柄，B+树索引的ih不为空，哈希索引的hash不为空 */
+struct IndexHandle {
+    const IndexMeta *meta;
+    IxIndexHandle *ih;
+    IxHashIndexHandle *hash = nullptr;
+
+    // 两种索引都支持的等值查找和修改，按索引的类型转发
+    int get_values_batch(const std::vector<const char *> &keys, std::vector<std::vector<Rid>> *results,
+                         Transaction *txn) const {
+        return hash != nullptr ? hash->get_values_batch(keys, results, txn) : ih->get_values_batch(keys, results, txn);
+    }
+
+    void insert_entry(const char *key, const Rid &rid, Transaction *txn) const {
+        if (hash != nullptr) {
+            hash->insert_entry(key, rid, txn);
+        } else {
+            ih->insert_entry(key, rid, txn);
+        }
+    }
+
+    void delete_entry(const char *key, Transaction *txn) const {
+        if (hash != nullptr) {
+            hash->delete_entry(key, txn);
+        } else {
+            ih->delete_entry(key, txn);
+        }
+    }
+
+    void insert_entries(const std::vector<const char *> &keys, const std::vector<Rid> &rids, Transaction *txn) const {
+        if (hash != nullptr) {
+            hash->insert_entries(keys, rids, txn);
+        } else {
+            ih->insert_entries(keys, rids, txn);
+        }
+    }
+
+    void delete_entries(const std::vector<const char *> &keys, Transaction *txn) const {
+        if (hash != nullptr) {
+            hash->delete_entries(keys, txn);
+        } else {
+            ih->delete_entries(keys, txn);
+        }
+    }
+};
+
+/*
+TableHandle是一张表在当前数据库中打开的句柄：表的元数据、数据文件和每个索引的文件
+执行计划生成时按表和索引的编号解析一次，执行器直接使用其中的指针，逐行执行时不再拼接索引名或查找哈希表。
+打开数据库时不打开任何表，表第一次被使用时才打开它的文件并生成句柄，启动时间与表的数量无关。
+DDL修改表之后由SmManager原地更新，同时递增schema_version_，缓存的执行计划随之失效
+*/
+struct TableHandle {
+    const TabMeta *tab;
+    RmFileHandle *fh;
+    std::vector<IndexHandle> indexes;   // 与tab->indexes一一对应
+    // 表中数据的版本，写入表的语句和修改过表的事务结束时递增，结果缓存据此判断缓存的结果是否失效
+    mutable std::atomic<uint64_t> data_version{0};
+    mutable std::atomic<timestamp_t> last_commit_ts{0};    // 最后一个修改过表的事务结束时的时间戳
+
+    void bump_data_version() const { data_version.fetch_add(1); }
+
+    /* 获取指定编号的索引 */
+    const IndexHandle &get_index(int index_id) const {
+        for (auto &index : indexes) {
+            if (index.meta->id == index_id) {
+                return index;
+            }
+        }
+        throw InternalError("TableHandle::get_index: index " + std::to_string(index_id) + " not found");
+    }
 };
 
 /* 系统管理器，负责元数据管理和DDL语句的执行 */
 class SmManager {
    public:
     DbMeta db_;             // 当前打开的数据库的元数据
-    std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;    // file name -> record file handle, 当前数据库中每张表的数据文件
-    std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;   // file name -> index file handle, 当前数据库中每个索引的文件
+    std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;    // file name -> record file handle, 已经打开的表的数据文件
+    std::unordered_map<std::string, std::shared_ptr<IxIndexHandle>> ihs_;   // file name -> index file handle, 已经打开的表的B+树索引文件，
+                                                                            // 后台合并修改缓冲时在handles_latch_之外持有句柄
+    std::unordered_map<std::string, std::unique_ptr<IxHashIndexHandle>> hash_ihs_;     // file name -> 已经打开的表的哈希索引文件
+    std::mutex stats_latch_;    // 保护所有表的TableStats，DML增量维护和优化器读取统计信息时持有
+    std::atomic<uint64_t> schema_version_{0};   // 表、索引或统计信息每次变化时递增，缓存的执行计划据此判断是否失效
    private:
     DiskManager* disk_manager_;
     BufferPoolManager* buffer_pool_manager_;
     RmManager* rm_manager_;
     IxManager* ix_manager_;
+    Catalog catalog_;       // 当前打开的数据库的目录文件db.meta，DDL只重写被修改的表
+    std::unordered_set<int> stats_changed_;     // DML增量维护过统计信息、还没有写入目录的表，由stats_latch_保护
+    std::mutex handles_latch_;  // 保护fhs_、ihs_、hash_ihs_和handles_，表第一次被使用时可能由多个会话并发打开
+    std::unordered_map<int, TableHandle> handles_;  // 表的编号 -> 打开的句柄，只包含已经打开的表，元素的地址在表被删除之前不变
+    bool read_only_ = false;    // 数据库以只读方式打开，表的数据文件和索引文件映射到内存读取，关闭时不写回任何内容
 
    public:
     SmManager(DiskManager* disk_manager, BufferPoolManager* buffer_pool_manager, RmManager* rm_manager,
@@ -48,7 +140,9 @@ class SmManager {
 
     void drop_db(const std::string& db_name);
 
-    void open_db(const std::string& db_name);
+    void open_db(const std::string& db_name, bool read_only = false);
+
+    bool is_read_only() const { return read_only_; }
 
     void close_db();
 
@@ -58,19 +152,76 @@ class SmManager {
 
     void desc_table(const std::string& tab_name, Context* context);
 
-    void create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context);
+    void create_table(const std::string& tab_name, const std::vector<ColDef>& col_defs, Context* context,
+                      TableLayout layout = TableLayout::ROW, const PartitionSpec& partition = PartitionSpec());
 
     void drop_table(const std::string& tab_name, Context* context);
 
-    void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
+    void create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context,
+                      IndexType type = IndexType::BTREE);
 
     void drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
     
     void drop_index(const std::string& tab_name, const std::vector<ColMeta>& col_names, Context* context);
+
+    void analyze_table(const std::string& tab_name, Context* context);
+
+    void rebuild_indexes(const std::string& tab_name);
+
+    int vacuum_table(const std::string& tab_name, Context* context);
+
+    size_t load_table(const std::string& tab_name, const std::string& file_name, Context* context);
+
+    /**
+     * @description: 获取表打开的句柄，表还没有打开时先打开它的数据文件和索引文件，返回的引用在表被删除之前有效
+     */
+    const TableHandle& get_table_handle(int tab_id);
+
+    const TableHandle& get_table_handle(const std::string& tab_name) { return get_table_handle(db_.get_table(tab_name).id); }
+
+    std::vector<const TableHandle*> get_partitions(const TabMeta& tab, const std::vector<Condition>& conds);
+
+    std::vector<const TableHandle*> get_open_tables();
+
+    size_t merge_index_changes(size_t min_changes);
+
+    int open_file_by_name(const std::string& file_name);
+
+    bool get_data_version(int tab_id, uint64_t* version, timestamp_t* last_commit_ts);
+
+    void mark_table_committed(int tab_id, timestamp_t commit_ts);
+
+    void update_stats(const TabMeta& tab, const char* old_record, const char* new_record);
     
-    void rollback_insert(const std::string &tab_name, const Rid &rid, Context *context);
+    void rollback_insert(const UndoRecord &undo, Context *context);
+
+    void rollback_delete(const UndoRecord &undo, Context *context);
+
+    void rollback_update(const UndoRecord &undo, Context *context);
+
+   private:
+    void persist_table(const TabMeta& tab);
+
+    void check_partition(const TabMeta& tab, const PartitionSpec& partition);
+
+    void create_table_file(const TabMeta& tab, TableLayout layout);
+
+    size_t load_records(const TableHandle& handle, std::vector<std::vector<char>>& chunks, Context* context);
+
+    TableHandle& open_table(const TabMeta& tab);
+
+    void open_handle(const TabMeta& tab);
+
+    void open_index(const std::string& tab_name, const IndexMeta& index);
+
+    void close_index(const std::string& tab_name, const IndexMeta& index);
+
+    void build_index(const std::string& tab_name, const IndexMeta& index);
+
+    void bulk_load_index(RmFileHandle* fh, IxIndexHandle* ih, const IndexMeta& index);
 
-    void rollback_delete(const std::string &tab_name, const RmRecord &record, Context *context);
+    void bulk_load_index(RmFileHandle* fh, IxHashIndexHandle* ih, const IndexMeta& index);
 
-    void rollback_update(const std::string &tab_name, const Rid &rid, const RmRecord &record, Context *context);
+    void rollback_indexes(const TableHandle &handle, const char *old_record, const char *new_record, const Rid &rid,
+                          Context *context);
 };
\ No newline at end of file
@@ -1,13 +1,16 @@
 #pragma once
 
 #include <algorithm>
-#include <iostream>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "errors.h"
+#include "sm_codec.h"
 #include "sm_defs.h"
+#include "sm_stats.h"
 
 /* 字段元数据 */
 struct ColMeta {
@@ -17,57 +20,129 @@ struct ColMeta {
     int len;                // 字段长度
     int offset;             // 字段位于记录中的偏移量
     bool index;             /** unused */
+    bool var_len = false;   // VARCHAR字段：记录中仍占len字节，数据文件中按实际长度存储
 
-    friend std::ostream &operator<<(std::ostream &os, const ColMeta &col) {
-        // ColMeta中有各个基本类型的变量，然后调用重载的这些变量的操作符<<（具体实现逻辑在defs.h）
-        return os << col.tab_name << ' ' << col.name << ' ' << col.type << ' ' << col.len << ' ' << col.offset << ' '
-                  << col.index;
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put_string(tab_name);
+        encoder.put_string(name);
+        encoder.put(type);
+        encoder.put(len);
+        encoder.put(offset);
+        encoder.put(index);
+        encoder.put(var_len);
     }
 
-    friend std::istream &operator>>(std::istream &is, ColMeta &col) {
-        return is >> col.tab_name >> col.name >> col.type >> col.len >> col.offset >> col.index;
+    void decode(CatalogDecoder &decoder) {
+        tab_name = decoder.get_string();
+        name = decoder.get_string();
+        type = decoder.get<ColType>();
+        len = decoder.get<int>();
+        offset = decoder.get<int>();
+        index = decoder.get<bool>();
+        var_len = decoder.get<bool>();
     }
 };
 
+/* 索引的类型：B+树支持等值和范围查找并按key有序扫描；哈希索引只支持覆盖全部索引字段的等值查找 */
+enum class IndexType { BTREE, HASH };
+
 /* 索引元数据 */
 struct IndexMeta {
     std::string tab_name;           // 索引所属表名称
     int col_tot_len;                // 索引字段长度总和
     int col_num;                    // 索引字段数量
     std::vector<ColMeta> cols;      // 索引包含的字段
+    int id = -1;                    // 索引在表内的编号，创建后不变，执行计划用它引用索引
+    IndexType type = IndexType::BTREE;  // 索引的类型
 
-    friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
-        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num;
-        for(auto& col: index.cols) {
-            os << "\n" << col;
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put_string(tab_name);
+        encoder.put(id);
+        encoder.put(col_tot_len);
+        encoder.put(col_num);
+        for (auto &col : cols) {
+            col.encode(encoder);
         }
-        return os;
+        encoder.put(type);
     }
 
-    friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
-        is >> index.tab_name >> index.col_tot_len >> index.col_num;
-        for(int i = 0; i < index.col_num; ++i) {
-            ColMeta col;
-            is >> col;
-            index.cols.push_back(col);
+    void decode(CatalogDecoder &decoder) {
+        tab_name = decoder.get_string();
+        id = decoder.get<int>();
+        col_tot_len = decoder.get<int>();
+        col_num = decoder.get<int>();
+        cols.resize(col_num);
+        for (auto &col : cols) {
+            col.decode(decoder);
+        }
+        type = decoder.get<IndexType>();
+    }
+};
+
+/* 表的分区方式：RANGE按分区字段的值所在的区间，HASH按分区字段的值的哈希 */
+enum class PartitionKind { NONE, RANGE, HASH };
+
+/* 分区表的分区信息。每个分区是一张单独的表，有自己的数据文件和索引文件，
+   分区的表名为分区表名加"#p"和分区的序号，SQL中不能直接引用 */
+struct PartitionSpec {
+    PartitionKind kind = PartitionKind::NONE;
+    std::string col_name;               // 分区字段
+    std::vector<std::string> bounds;    // RANGE时前n-1个分区的上界(不含)，按分区字段的格式编码，升序
+    std::vector<int> partitions;        // 各分区的表的编号
+
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put(kind);
+        encoder.put_string(col_name);
+        encoder.put(static_cast<uint32_t>(bounds.size()));
+        for (auto &bound : bounds) {
+            encoder.put_string(bound);
+        }
+        encoder.put(static_cast<uint32_t>(partitions.size()));
+        for (int tab_id : partitions) {
+            encoder.put(tab_id);
+        }
+    }
+
+    void decode(CatalogDecoder &decoder) {
+        kind = decoder.get<PartitionKind>();
+        col_name = decoder.get_string();
+        bounds.resize(decoder.get<uint32_t>());
+        for (auto &bound : bounds) {
+            bound = decoder.get_string();
+        }
+        partitions.resize(decoder.get<uint32_t>());
+        for (auto &tab_id : partitions) {
+            tab_id = decoder.get<int>();
         }
-        return is;
     }
 };
 
 /* 表元数据 */
 struct TabMeta {
     std::string name;                   // 表名称
+    int id = -1;                        // 表的编号，创建后不变，日志中用它代替表名
     std::vector<ColMeta> cols;          // 表包含的字段
     std::vector<IndexMeta> indexes;     // 表上建立的索引
+    int next_index_id = 0;              // 下一个新建的索引的编号
+    std::shared_ptr<TableStats> stats;  // ANALYZE收集的统计信息，没有收集时为空；所有副本共享，读写需持有SmManager::stats_latch_
+    PartitionSpec partition;            // 分区表的分区信息，分区表本身的数据文件始终为空
+    int parent_id = -1;                 // 分区所属的分区表的编号，不是分区时为-1
 
     TabMeta(){}
 
     TabMeta(const TabMeta &other) {
         name = other.name;
+        id = other.id;
         for(auto col : other.cols) cols.push_back(col);
+        indexes = other.indexes;
+        next_index_id = other.next_index_id;
+        stats = other.stats;
+        partition = other.partition;
+        parent_id = other.parent_id;
     }
 
+    bool is_partitioned() const { return partition.kind != PartitionKind::NONE; }
+
     /* 判断当前表中是否存在名为col_name的字段 */
     bool is_col(const std::string &col_name) const {
         auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) { return col.name == col_name; });
@@ -105,6 +180,10 @@ struct TabMeta {
         throw IndexNotFoundError(name, col_names);
     }
 
+    std::vector<IndexMeta>::const_iterator get_index_meta(const std::vector<std::string>& col_names) const {
+        return const_cast<TabMeta *>(this)->get_index_meta(col_names);
+    }
+
     /* 根据字段名称获取字段元数据 */
     std::vector<ColMeta>::iterator get_col(const std::string &col_name) {
         auto pos = std::find_if(cols.begin(), cols.end(), [&](const ColMeta &col) { return col.name == col_name; });
@@ -114,82 +193,114 @@ struct TabMeta {
         return pos;
     }
 
-    friend std::ostream &operator<<(std::ostream &os, const TabMeta &tab) {
-        os << tab.name << '\n' << tab.cols.size() << '\n';
-        for (auto &col : tab.cols) {
-            os << col << '\n';  // col是ColMeta类型，然后调用重载的ColMeta的操作符<<
+    std::vector<ColMeta>::const_iterator get_col(const std::string &col_name) const {
+        return const_cast<TabMeta *>(this)->get_col(col_name);
+    }
+
+    /* 编码为目录中的一条记录，stats需由调用者持有SmManager::stats_latch_ */
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put_string(name);
+        encoder.put(id);
+        encoder.put(next_index_id);
+        encoder.put(static_cast<uint32_t>(cols.size()));
+        for (auto &col : cols) {
+            col.encode(encoder);
         }
-        os << tab.indexes.size() << "\n";
-        for (auto &index : tab.indexes) {
-            os << index << "\n";
+        encoder.put(static_cast<uint32_t>(indexes.size()));
+        for (auto &index : indexes) {
+            index.encode(encoder);
         }
-        return os;
+        encoder.put(stats != nullptr);
+        if (stats != nullptr) {
+            stats->encode(encoder);
+        }
+        partition.encode(encoder);
+        encoder.put(parent_id);
     }
 
-    friend std::istream &operator>>(std::istream &is, TabMeta &tab) {
-        size_t n;
-        is >> tab.name >> n;
-        for (size_t i = 0; i < n; i++) {
-            ColMeta col;
-            is >> col;
-            tab.cols.push_back(col);
+    void decode(CatalogDecoder &decoder) {
+        name = decoder.get_string();
+        id = decoder.get<int>();
+        next_index_id = decoder.get<int>();
+        cols.resize(decoder.get<uint32_t>());
+        for (auto &col : cols) {
+            col.decode(decoder);
+        }
+        indexes.resize(decoder.get<uint32_t>());
+        for (auto &index : indexes) {
+            index.decode(decoder);
         }
-        is >> n;
-        for(size_t i = 0; i < n; ++i) {
-            IndexMeta index;
-            is >> index;
-            tab.indexes.push_back(index);
+        if (decoder.get<bool>()) {
+            stats = std::make_shared<TableStats>();
+            stats->decode(decoder);
+        }
+        // 加入分区之前写入的目录中没有分区信息
+        if (!decoder.at_end()) {
+            partition.decode(decoder);
+            parent_id = decoder.get<int>();
         }
-        return is;
     }
 };
 
-// 注意重载了操作符 << 和 >>，这需要更底层同样重载TabMeta、ColMeta的操作符 << 和 >>
-/* 数据库元数据 */
+/* 数据库元数据，表按名称有序保存，另有按名称和编号的哈希索引 */
 class DbMeta {
     friend class SmManager;
 
    private:
     std::string name_;                      // 数据库名称
-    std::map<std::string, TabMeta> tabs_;   // 数据库中包含的表
+    std::map<std::string, TabMeta> tabs_;   // 数据库中包含的表，SHOW TABLES按名称顺序输出
+    std::unordered_map<std::string, TabMeta *> names_;  // 表名 -> tabs_中的元数据
+    std::unordered_map<int, TabMeta *> ids_;            // 表的编号 -> tabs_中的元数据
+    int next_tab_id_ = 0;                   // 下一张新建的表的编号
 
    public:
-    // DbMeta(std::string name) : name_(name) {}
+    DbMeta() = default;
+
+    DbMeta(const DbMeta &) = delete;
+    DbMeta &operator=(const DbMeta &) = delete;
 
     /* 判断数据库中是否存在指定名称的表 */
-    bool is_table(const std::string &tab_name) const { return tabs_.find(tab_name) != tabs_.end(); }
+    bool is_table(const std::string &tab_name) const { return names_.find(tab_name) != names_.end(); }
 
-    void SetTabMeta(const std::string &tab_name, const TabMeta &meta) {
-        tabs_[tab_name] = meta;
+    /* 加入一张表，已经存在同名的表时覆盖 */
+    TabMeta &add_table(const TabMeta &meta) {
+        remove_table(meta.name);
+        TabMeta &tab = tabs_[meta.name];
+        tab = meta;
+        names_[tab.name] = &tab;
+        ids_[tab.id] = &tab;
+        return tab;
     }
 
-    /* 获取指定名称表的元数据 */
-    TabMeta &get_table(const std::string &tab_name) {
+    void remove_table(const std::string &tab_name) {
         auto pos = tabs_.find(tab_name);
         if (pos == tabs_.end()) {
-            throw TableNotFoundError(tab_name);
+            return;
         }
+        names_.erase(tab_name);
+        ids_.erase(pos->second.id);
+        tabs_.erase(pos);
+    }
 
-        return pos->second;
+    void clear() {
+        tabs_.clear();
+        names_.clear();
+        ids_.clear();
+        next_tab_id_ = 0;
     }
 
-    // 重载操作符 <<
-    friend std::ostream &operator<<(std::ostream &os, const DbMeta &db_meta) {
-        os << db_meta.name_ << '\n' << db_meta.tabs_.size() << '\n';
-        for (auto &entry : db_meta.tabs_) {
-            os << entry.second << '\n';
+    /* 获取指定名称表的元数据 */
+    TabMeta &get_table(const std::string &tab_name) {
+        auto pos = names_.find(tab_name);
+        if (pos == names_.end()) {
+            throw TableNotFoundError(tab_name);
         }
-        return os;
+        return *pos->second;
     }
 
-    friend std::istream &operator>>(std::istream &is, DbMeta &db_meta) {
-        size_t n;
-        is >> db_meta.name_ >> n;
-        for (size_t i = 0; i < n; i++) {
-            TabMeta tab;
-            is >> tab;
-            db_meta.tabs_[tab.name] = tab;
-        }
-        return is;
+    /* 获取指定编号的表的元数据，表不存在时返回nullptr */
+    TabMeta *get_table_by_id(int tab_id) {
+        auto pos = ids_.find(tab_id);
+        return pos == ids_.end() ? nullptr : pos->second;
     }
 };
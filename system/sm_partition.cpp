@@ -0,0 +1,113 @@
+#include "sm_partition.h"
+
+#include <algorithm>
+
+#include "index/ix_compare.h"
+
+namespace {
+
+// 分区字段的值的哈希，分区数变化时所有记录都需要重新分布，因此哈希函数不能改变
+uint64_t partition_hash(const char *key, const ColMeta &col) {
+    float zero = 0;
+    if (col.type == TYPE_FLOAT && *reinterpret_cast<const float *>(key) == 0) {
+        key = reinterpret_cast<const char *>(&zero);
+    }
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < col.len; i++) {
+        h = (h ^ static_cast<unsigned char>(key[i])) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+// RANGE分区中小于key(or_equal时小于等于key)的上界的个数
+int count_bounds(const TabMeta &tab, const ColMeta &col, const char *key, bool or_equal) {
+    auto &bounds = tab.partition.bounds;
+    auto pos = std::partition_point(bounds.begin(), bounds.end(), [&](const std::string &bound) {
+        int cmp = ix_compare(bound.data(), key, col.type, col.len);
+        return cmp < 0 || (or_equal && cmp == 0);
+    });
+    return static_cast<int>(pos - bounds.begin());
+}
+
+}  // namespace
+
+/**
+ * @description: 分区字段的值所在的分区
+ * @return {int} 分区在tab.partition.partitions中的下标
+ * @param {TabMeta&} tab 分区表的元数据
+ * @param {char*} key 分区字段的值，按字段的格式编码
+ */
+int partition_of(const TabMeta &tab, const char *key) {
+    auto &col = *tab.get_col(tab.partition.col_name);
+    if (tab.partition.kind == PartitionKind::HASH) {
+        return static_cast<int>(partition_hash(key, col) % tab.partition.partitions.size());
+    }
+    return count_bounds(tab, col, key, true);
+}
+
+/**
+ * @description: 记录所在的分区，插入和导入时按它把记录分发到各个分区
+ * @return {int} 分区在tab.partition.partitions中的下标
+ * @param {TabMeta&} tab 分区表的元数据
+ * @param {char*} record 分区表格式的记录
+ */
+int partition_of_record(const TabMeta &tab, const char *record) {
+    return partition_of(tab, record + tab.get_col(tab.partition.col_name)->offset);
+}
+
+/**
+ * @description: 按扫描的条件剪掉不可能包含满足条件的记录的分区
+ * @return {vector<int>} 剩下的分区在tab.partition.partitions中的下标，升序，没有分区能满足条件时为空
+ * @param {TabMeta&} tab 分区表的元数据
+ * @param {vector<Condition>&} conds 扫描的条件
+ */
+std::vector<int> prune_partitions(const TabMeta &tab, const std::vector<Condition> &conds) {
+    auto &col = *tab.get_col(tab.partition.col_name);
+    int num_partitions = static_cast<int>(tab.partition.partitions.size());
+    int lo = 0;
+    int hi = num_partitions - 1;
+    int hash_partition = -1;
+    for (auto &cond : conds) {
+        if (!cond.is_rhs_val || cond.rhs_val.param >= 0 || cond.rhs_val.raw == nullptr ||
+            cond.rhs_val.type != col.type || cond.lhs_col.tab_name != tab.name ||
+            cond.lhs_col.col_name != col.name || cond.op == OP_NE) {
+            continue;
+        }
+        const char *key = cond.rhs_val.raw->data;
+        if (tab.partition.kind == PartitionKind::HASH) {
+            if (cond.op != OP_EQ) {
+                continue;
+            }
+            int p = partition_of(tab, key);
+            if (hash_partition != -1 && hash_partition != p) {
+                return {};
+            }
+            hash_partition = p;
+            continue;
+        }
+        // 分区i中的值不小于第i-1个上界且小于第i个上界
+        switch (cond.op) {
+            case OP_EQ:
+                lo = std::max(lo, count_bounds(tab, col, key, true));
+                hi = std::min(hi, count_bounds(tab, col, key, true));
+                break;
+            case OP_LT: hi = std::min(hi, count_bounds(tab, col, key, false)); break;
+            case OP_LE: hi = std::min(hi, count_bounds(tab, col, key, true)); break;
+            case OP_GT:
+            case OP_GE: lo = std::max(lo, count_bounds(tab, col, key, true)); break;
+            default: break;
+        }
+    }
+    if (hash_partition != -1) {
+        return {hash_partition};
+    }
+    std::vector<int> result;
+    for (int p = lo; p <= hi; p++) {
+        result.push_back(p);
+    }
+    return result;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include "common/common.h"
+#include "sm_meta.h"
+
+/*
+分区表的路由和分区剪枝
+1. RANGE分区：前n-1个分区各有一个上界(不含)，分区i保存[bounds[i-1], bounds[i])内的值，最后一个分区没有上界
+2. HASH分区：分区字段的值按字段的格式哈希后对分区数取模，与哈希索引相同，FLOAT的+0和-0哈希相同
+3. 剪枝只使用分区字段与常量比较的条件，条件之间为AND，结果为各条件可能满足的分区的交集；
+   与参数$n比较的条件在绑定参数之后才能使用
+*/
+
+int partition_of(const TabMeta &tab, const char *key);
+
+int partition_of_record(const TabMeta &tab, const char *record);
+
+std::vector<int> prune_partitions(const TabMeta &tab, const std::vector<Condition> &conds);
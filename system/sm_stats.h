@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "index/ix_compare.h"
+#include "sm_codec.h"
+#include "sm_defs.h"
+
+/*
+表和字段的统计信息，由ANALYZE语句收集，和对应的TabMeta一起保存在db.meta中，供查询优化估计选择率
+1. 每个字段保存NDV(不同值的个数，用HyperLogLog估计)、最小/最大值和等深直方图
+2. 直方图每个桶记录桶内最大值(上界)和桶内记录数，相邻桶的上界递增，第一个桶的下界为最小值
+3. 插入/删除/更新记录时增量维护：记录数增减，最小/最大值只会扩大，新值加入HyperLogLog，所在桶的记录数增减；
+   删除不会减小NDV，因此统计信息会逐渐偏离，重新ANALYZE即可得到准确的统计信息
+字段值统一用原始字节(长度为字段长度)保存
+*/
+
+/**
+ * @description: 字段值的64位hash，-0.0与0.0的hash相同
+ * @param {char*} val 字段值
+ * @param {ColType} type 字段类型
+ * @param {int} len 字段长度
+ */
+inline uint64_t stats_hash(const char *val, ColType type, int len) {
+    float zero = 0;
+    if (type == TYPE_FLOAT && *reinterpret_cast<const float *>(val) == 0) {
+        val = reinterpret_cast<const char *>(&zero);
+    }
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < len; i++) {
+        h = (h ^ static_cast<unsigned char>(val[i])) * 0x100000001b3ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+/* HyperLogLog基数估计，2^STATS_HLL_PRECISION个寄存器，标准误差约为1.04/sqrt(寄存器数)
+   寄存器变化时增量维护调和平均所需的和，估计值的计算为O(1) */
+class HyperLogLog {
+   private:
+    static constexpr int NUM_REGISTERS = 1 << STATS_HLL_PRECISION;
+
+    std::vector<uint8_t> regs_;
+    double sum_ = NUM_REGISTERS;                // 所有寄存器的2^-reg之和
+    int zeros_ = NUM_REGISTERS;                 // 值为0的寄存器个数
+
+   public:
+    HyperLogLog() : regs_(NUM_REGISTERS, 0) {}
+
+    void add(uint64_t hash) {
+        size_t idx = hash >> (64 - STATS_HLL_PRECISION);
+        // 剩余的位中第一个1的位置，最后补一个1保证rank有上界
+        uint64_t rest = (hash << STATS_HLL_PRECISION) | (1ULL << (STATS_HLL_PRECISION - 1));
+        uint8_t rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+        if (rank > regs_[idx]) {
+            sum_ += std::ldexp(1.0, -rank) - std::ldexp(1.0, -regs_[idx]);
+            zeros_ -= regs_[idx] == 0;
+            regs_[idx] = rank;
+        }
+    }
+
+    // 估计加入过的不同hash值的个数，基数较小时使用线性计数修正
+    double estimate() const {
+        double m = NUM_REGISTERS;
+        double e = 0.7213 / (1 + 1.079 / m) * m * m / sum_;
+        if (e <= 2.5 * m && zeros_ != 0) {
+            e = m * std::log(m / zeros_);
+        }
+        return e;
+    }
+
+    void encode(CatalogEncoder &encoder) const { encoder.put_string(std::string(regs_.begin(), regs_.end())); }
+
+    void decode(CatalogDecoder &decoder) {
+        std::string raw = decoder.get_string();
+        if (raw.size() == regs_.size()) {
+            regs_.assign(raw.begin(), raw.end());
+        }
+        sum_ = 0;
+        zeros_ = 0;
+        for (auto reg : regs_) {
+            sum_ += std::ldexp(1.0, -reg);
+            zeros_ += reg == 0;
+        }
+    }
+};
+
+/* 单个字段的统计信息 */
+struct ColumnStats {
+    double ndv = 0;                     // 不同值的个数的估计
+    double ndv_scale = 1;               // ndv与hll的估计值之比，抽样时大于1
+    std::string min;                    // 最小值，表为空时为空串
+    std::string max;                    // 最大值
+    std::vector<std::string> bounds;    // 直方图每个桶的上界
+    std::vector<double> counts;         // 直方图每个桶的记录数
+    HyperLogLog hll;
+
+    /**
+     * @description: 由排序后的抽样值构建统计信息，调用前hll中应已加入全部抽样值
+     * @param {vector<const char*>&} sorted 按ix_compare升序排列的抽样值
+     * @param {ColType} type 字段类型
+     * @param {int} len 字段长度
+     * @param {double} distinct 抽样值中不同值的个数
+     * @param {double} scale 每个抽样值代表的记录数
+     */
+    void build(const std::vector<const char *> &sorted, ColType type, int len, double distinct, double scale) {
+        bounds.clear();
+        counts.clear();
+        size_t n = sorted.size();
+        // 抽样值几乎都不相同时，认为未抽到的记录的值也不相同，按比例放大；否则认为抽样已经见过大部分的值
+        double hll_ndv = hll.estimate();
+        ndv = distinct >= 0.9 * n ? distinct * scale : distinct;
+        ndv_scale = hll_ndv > 0 ? ndv / hll_ndv : 1;
+        if (n == 0) {
+            min.clear();
+            max.clear();
+            return;
+        }
+        min.assign(sorted.front(), len);
+        max.assign(sorted.back(), len);
+        size_t buckets = std::min(STATS_HISTOGRAM_BUCKETS, n);
+        size_t begin = 0;
+        for (size_t b = 0; b < buckets; b++) {
+            size_t end = (b + 1) * n / buckets;
+            // 上界相同的桶合并，重复值不会跨越多个桶
+            if (!bounds.empty() && ix_compare(bounds.back().data(), sorted[end - 1], type, len) == 0) {
+                counts.back() += (end - begin) * scale;
+            } else {
+                bounds.emplace_back(sorted[end - 1], len);
+                counts.push_back((end - begin) * scale);
+            }
+            begin = end;
+        }
+    }
+
+    // 插入一个值
+    void add(const char *val, ColType type, int len) {
+        hll.add(stats_hash(val, type, len));
+        ndv = std::max(ndv, hll.estimate() * ndv_scale);
+        if (min.empty() || ix_compare(val, min.data(), type, len) < 0) {
+            min.assign(val, len);
+        }
+        if (max.empty() || ix_compare(val, max.data(), type, len) > 0) {
+            max.assign(val, len);
+        }
+        size_t b = bucket(val, type, len);
+        if (b == bounds.size()) {
+            if (bounds.empty()) {
+                bounds.emplace_back(val, len);
+                counts.push_back(0);
+            }
+            b = bounds.size() - 1;
+            bounds[b].assign(val, len);
+        }
+        counts[b] += 1;
+    }
+
+    // 删除一个值，NDV和最小/最大值不变
+    void remove(const char *val, ColType type, int len) {
+        if (!bounds.empty()) {
+            size_t b = std::min(bucket(val, type, len), bounds.size() - 1);
+            counts[b] = std::max(0.0, counts[b] - 1);
+        }
+    }
+
+    // 等于val的记录在表中所占的比例，val超出[min, max]时为0
+    double eq_fraction(const char *val, ColType type, int len) const {
+        if (min.empty() || ix_compare(val, min.data(), type, len) < 0 || ix_compare(val, max.data(), type, len) > 0) {
+            return 0;
+        }
+        return 1 / std::max(ndv, 1.0);
+    }
+
+    // 小于val的记录在表中所占的比例，数值类型在桶内线性插值，字符串按桶内一半估计
+    double less_fraction(const char *val, ColType type, int len) const {
+        double total = 0;
+        for (auto count : counts) {
+            total += count;
+        }
+        if (total <= 0 || ix_compare(val, min.data(), type, len) <= 0) {
+            return 0;
+        }
+        if (ix_compare(val, max.data(), type, len) > 0) {
+            return 1;
+        }
+        double less = 0;
+        const char *lower = min.data();
+        for (size_t b = 0; b < bounds.size(); b++) {
+            if (ix_compare(val, bounds[b].data(), type, len) > 0) {
+                less += counts[b];
+                lower = bounds[b].data();
+                continue;
+            }
+            less += counts[b] * interpolate(lower, bounds[b].data(), val, type);
+            break;
+        }
+        return std::min(1.0, less / total);
+    }
+
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put(ndv);
+        encoder.put(ndv_scale);
+        encoder.put_string(min);
+        encoder.put_string(max);
+        encoder.put(static_cast<uint32_t>(bounds.size()));
+        for (size_t b = 0; b < bounds.size(); b++) {
+            encoder.put_string(bounds[b]);
+            encoder.put(counts[b]);
+        }
+        hll.encode(encoder);
+    }
+
+    void decode(CatalogDecoder &decoder) {
+        ndv = decoder.get<double>();
+        ndv_scale = decoder.get<double>();
+        min = decoder.get_string();
+        max = decoder.get_string();
+        uint32_t n = decoder.get<uint32_t>();
+        bounds.resize(n);
+        counts.resize(n);
+        for (size_t b = 0; b < n; b++) {
+            bounds[b] = decoder.get_string();
+            counts[b] = decoder.get<double>();
+        }
+        hll.decode(decoder);
+    }
+
+   private:
+    // 第一个上界不小于val的桶，val大于所有上界时返回桶数
+    size_t bucket(const char *val, ColType type, int len) const {
+        auto it = std::partition_point(bounds.begin(), bounds.end(), [&](const std::string &bound) {
+            return ix_compare(bound.data(), val, type, len) < 0;
+        });
+        return it - bounds.begin();
+    }
+
+    // val在(lower, upper]中的相对位置
+    static double interpolate(const char *lower, const char *upper, const char *val, ColType type) {
+        double lo, hi, v;
+        if (type == TYPE_INT) {
+            lo = *reinterpret_cast<const int *>(lower);
+            hi = *reinterpret_cast<const int *>(upper);
+            v = *reinterpret_cast<const int *>(val);
+        } else if (type == TYPE_FLOAT) {
+            lo = *reinterpret_cast<const float *>(lower);
+            hi = *reinterpret_cast<const float *>(upper);
+            v = *reinterpret_cast<const float *>(val);
+        } else {
+            return 0.5;
+        }
+        return hi > lo ? std::min(1.0, std::max(0.0, (v - lo) / (hi - lo))) : 0.5;
+    }
+};
+
+/* 表的统计信息，cols与TabMeta::cols一一对应 */
+struct TableStats {
+    int64_t row_count = 0;
+    std::vector<ColumnStats> cols;
+
+    void encode(CatalogEncoder &encoder) const {
+        encoder.put(row_count);
+        encoder.put(static_cast<uint32_t>(cols.size()));
+        for (auto &col : cols) {
+            col.encode(encoder);
+        }
+    }
+
+    void decode(CatalogDecoder &decoder) {
+        row_count = decoder.get<int64_t>();
+        cols.resize(decoder.get<uint32_t>());
+        for (auto &col : cols) {
+            col.decode(decoder);
+        }
+    }
+};
@@ -0,0 +1,220 @@
+#include "table_loader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <thread>
+
+#include "errors.h"
+
+namespace {
+
+// 解析某一行时出错，行号在parse_chunk中补上
+struct LineError {
+    std::string msg;
+};
+
+// 去掉未加引号的字段首尾的空白
+std::string trim(const char *begin, const char *end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        begin++;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    return std::string(begin, end);
+}
+
+}  // namespace
+
+TableLoader::TableLoader(const TabMeta &tab, int record_size, size_t num_threads)
+    : cols_(tab.cols), record_size_(record_size), file_name_(tab.name) {
+    num_threads_ = num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * @description: 解析CSV文件，文件通过mmap只读映射，解析完成后解除映射
+ * @return {vector<vector<char>>} 各块解析得到的记录，按文件中的顺序排列，每块中的记录连续存放
+ * @param {string&} file_name 文件路径，相对路径相对于数据库目录
+ */
+std::vector<std::vector<char>> TableLoader::load_file(const std::string &file_name) {
+    file_name_ = file_name;
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw FileNotFoundError(file_name);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw UnixError();
+    }
+    size_t len = static_cast<size_t>(st.st_size);
+    if (len == 0) {
+        close(fd);
+        return {};
+    }
+    void *data = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw UnixError();
+    }
+    madvise(data, len, MADV_SEQUENTIAL);
+    try {
+        auto chunks = parse(static_cast<const char *>(data), len);
+        munmap(data, len);
+        return chunks;
+    } catch (...) {
+        munmap(data, len);
+        throw;
+    }
+}
+
+/**
+ * @description: 把数据按行边界切分为若干块并行解析，每块不小于LOAD_MIN_CHUNK_SIZE
+ * @return {vector<vector<char>>} 各块解析得到的记录，按数据中的顺序排列
+ * @param {char*} data CSV数据
+ * @param {size_t} len 数据的长度
+ */
+std::vector<std::vector<char>> TableLoader::parse(const char *data, size_t len) {
+    size_t num_chunks = std::clamp<size_t>(len / LOAD_MIN_CHUNK_SIZE, 1, num_threads_);
+    std::vector<const char *> bounds = {data};
+    for (size_t i = 1; i < num_chunks; i++) {
+        const char *pos = std::max(data + len * i / num_chunks, bounds.back());
+        const char *eol = static_cast<const char *>(memchr(pos, '\n', data + len - pos));
+        bounds.push_back(eol == nullptr ? data + len : eol + 1);
+    }
+    bounds.push_back(data + len);
+
+    std::vector<std::vector<char>> chunks(num_chunks);
+    std::vector<std::exception_ptr> errors(num_chunks);
+    auto work = [&](size_t i) {
+        try {
+            parse_chunk(data, bounds[i], bounds[i + 1], chunks[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_chunks; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    // 报告文件中最靠前的错误
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return chunks;
+}
+
+// 解析[begin, end)中的所有行，出错时统计从data开始的换行数得到行号
+void TableLoader::parse_chunk(const char *data, const char *begin, const char *end, std::vector<char> &records) const {
+    records.reserve(end - begin);
+    const char *line = begin;
+    while (line < end) {
+        const char *eol = static_cast<const char *>(memchr(line, '\n', end - line));
+        const char *line_end = eol == nullptr ? end : eol;
+        const char *content_end = line_end > line && line_end[-1] == '\r' ? line_end - 1 : line_end;
+        if (content_end > line) {
+            size_t offset = records.size();
+            records.resize(offset + record_size_);
+            try {
+                parse_line(line, content_end, records.data() + offset);
+            } catch (LineError &e) {
+                size_t line_no = 1 + std::count(data, line, '\n');
+                throw LoadDataError(file_name_, line_no, e.msg);
+            }
+        }
+        line = line_end + 1;
+    }
+}
+
+// 把一行拆分为字段，依次转换后写入record
+void TableLoader::parse_line(const char *begin, const char *end, char *record) const {
+    memset(record, 0, record_size_);
+    const char *pos = begin;
+    std::string field;
+    for (size_t i = 0; i < cols_.size(); i++) {
+        if (pos > end) {
+            throw LineError{"expected " + std::to_string(cols_.size()) + " fields, got " + std::to_string(i)};
+        }
+        const char *p = pos;
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        if (p < end && *p == '"') {
+            field.clear();
+            p++;
+            while (true) {
+                if (p >= end) {
+                    throw LineError{"unterminated quoted field"};
+                }
+                if (*p == '"') {
+                    if (p + 1 < end && p[1] == '"') {
+                        field.push_back('"');
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    break;
+                }
+                field.push_back(*p++);
+            }
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            if (p < end && *p != ',') {
+                throw LineError{"unexpected character after quoted field"};
+            }
+        } else {
+            p = static_cast<const char *>(memchr(pos, ',', end - pos));
+            if (p == nullptr) {
+                p = end;
+            }
+            field = trim(pos, p);
+        }
+        parse_field(cols_[i], field, record + cols_[i].offset);
+        pos = p + 1;
+    }
+    if (pos <= end) {
+        throw LineError{"expected " + std::to_string(cols_.size()) + " fields, got more"};
+    }
+}
+
+// 按字段类型转换一个字段的文本
+void TableLoader::parse_field(const ColMeta &col, const std::string &field, char *dest) const {
+    const char *str = field.c_str();
+    char *str_end = nullptr;
+    errno = 0;
+    if (col.type == TYPE_INT) {
+        long val = std::strtol(str, &str_end, 10);
+        if (field.empty() || *str_end != '\0' || errno == ERANGE || val < INT_MIN || val > INT_MAX) {
+            throw LineError{"invalid int value '" + field + "' for column " + col.name};
+        }
+        int int_val = static_cast<int>(val);
+        memcpy(dest, &int_val, sizeof(int));
+    } else if (col.type == TYPE_FLOAT) {
+        float val = std::strtof(str, &str_end);
+        if (field.empty() || *str_end != '\0' || errno == ERANGE) {
+            throw LineError{"invalid float value '" + field + "' for column " + col.name};
+        }
+        memcpy(dest, &val, sizeof(float));
+    } else {
+        if (field.size() > static_cast<size_t>(col.len)) {
+            throw LineError{"string too long for column " + col.name};
+        }
+        memcpy(dest, field.data(), field.size());
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "sm_meta.h"
+
+/*
+TableLoader把COPY导入的CSV文件解析为表的定长记录
+1. 文件通过mmap映射到内存，按行边界切分为若干块，每块由一个线程独立解析
+2. 每行的字段以逗号分隔，字段可以用双引号括起，引号内的""表示一个双引号，字段中不能包含换行；空行被忽略
+3. 字段按TabMeta::cols的顺序和类型转换后写入记录中各字段的offset处，字符串不足字段长度的部分补0
+解析出错时不返回任何记录，错误信息包含出错的行号
+*/
+class TableLoader {
+   public:
+    TableLoader(const TabMeta &tab, int record_size, size_t num_threads = LOAD_PARSE_THREADS);
+
+    std::vector<std::vector<char>> load_file(const std::string &file_name);
+
+    std::vector<std::vector<char>> parse(const char *data, size_t len);
+
+   private:
+    void parse_chunk(const char *data, const char *begin, const char *end, std::vector<char> &records) const;
+
+    void parse_line(const char *begin, const char *end, char *record) const;
+
+    void parse_field(const ColMeta &col, const std::string &field, char *dest) const;
+
+    std::vector<ColMeta> cols_;
+    int record_size_;
+    size_t num_threads_;
+    std::string file_name_;     // 出错时报告的文件名
+};
@@ -0,0 +1,51 @@
+#include "common/bloom_filter.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 加入的key都能查到；没有加入的key按每个key 10位的大小误判率在2%以内，序列化之后结果相同
+ */
+TEST(BloomFilterTest, FalsePositiveRate) {
+    std::mt19937_64 rng(42);
+    for (size_t n : {size_t(1), size_t(100), size_t(100000)}) {
+        BloomFilter bloom(n, 10);
+        std::vector<uint64_t> keys(n);
+        for (auto &key : keys) {
+            key = rng();
+            bloom.add(key);
+        }
+        EXPECT_EQ(bloom.size_bytes() % BloomFilter::BLOCK_BYTES, 0u);
+        BloomFilter copy(bloom.data(), bloom.size_bytes());
+        for (auto key : keys) {
+            ASSERT_TRUE(bloom.may_contain(key));
+            ASSERT_TRUE(copy.may_contain(key));
+        }
+        size_t false_positives = 0;
+        constexpr size_t probes = 100000;
+        for (size_t i = 0; i < probes; i++) {
+            uint64_t key = rng();
+            bool found = bloom.may_contain(key);
+            ASSERT_EQ(copy.may_contain(key), found);
+            false_positives += found;
+        }
+        EXPECT_LT(false_positives, probes * 2 / 100) << "n=" << n;
+    }
+}
+
+/**
+ * @brief 连续的整数key经过hash_u64后均匀落在各个块中，误判率与随机key相同
+ */
+TEST(BloomFilterTest, SequentialKeys) {
+    constexpr uint64_t n = 50000;
+    BloomFilter bloom(n, 10);
+    for (uint64_t key = 0; key < n; key++) {
+        bloom.add(key);
+    }
+    size_t false_positives = 0;
+    for (uint64_t key = n; key < 2 * n; key++) {
+        false_positives += bloom.may_contain(key);
+    }
+    EXPECT_LT(false_positives, n * 2 / 100);
+}
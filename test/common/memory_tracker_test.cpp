@@ -0,0 +1,98 @@
+#include "common/memory_tracker.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common/arena.h"
+#include "gtest/gtest.h"
+
+/**
+ * @brief 不超过上限时申请成功并记录峰值；超过上限时try_consume()返回false且不改变占用，consume()抛出异常
+ */
+TEST(MemoryTrackerTest, Limit) {
+    MemoryTracker tracker(1000);
+    EXPECT_TRUE(tracker.try_consume(600));
+    EXPECT_TRUE(tracker.try_consume(400));
+    EXPECT_FALSE(tracker.try_consume(1));
+    EXPECT_EQ(tracker.used(), 1000u);
+    EXPECT_EQ(tracker.available(), 0u);
+    EXPECT_THROW(tracker.consume(1), QueryMemoryLimitError);
+    tracker.release(700);
+    EXPECT_EQ(tracker.used(), 300u);
+    EXPECT_EQ(tracker.available(), 700u);
+    EXPECT_EQ(tracker.peak(), 1000u);
+
+    // 上限为0表示不限制
+    tracker.set_limit(0);
+    EXPECT_TRUE(tracker.try_consume(SIZE_MAX / 2));
+    EXPECT_EQ(tracker.available(), SIZE_MAX);
+}
+
+/**
+ * @brief 多个线程同时申请时合计不超过上限
+ */
+TEST(MemoryTrackerTest, ConcurrentConsume) {
+    constexpr size_t limit = 100000;
+    MemoryTracker tracker(limit);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> granted{0};
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 10000; i++) {
+                if (tracker.try_consume(7)) {
+                    granted += 7;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(tracker.used(), granted.load());
+    EXPECT_LE(tracker.used(), limit);
+    EXPECT_GT(tracker.used(), limit - 7);
+}
+
+/**
+ * @brief MemoryReservation扩大时向tracker申请差值，缩小和析构时归还；没有tracker时任何调整都成功
+ */
+TEST(MemoryTrackerTest, Reservation) {
+    MemoryTracker tracker(1000);
+    {
+        MemoryReservation reservation(&tracker);
+        EXPECT_TRUE(reservation.try_resize(800));
+        EXPECT_FALSE(reservation.try_resize(1200));
+        EXPECT_EQ(reservation.bytes(), 800u);
+        EXPECT_THROW(reservation.resize(1001), QueryMemoryLimitError);
+        EXPECT_EQ(tracker.used(), 800u);
+        reservation.resize(300);
+        EXPECT_EQ(tracker.used(), 300u);
+        EXPECT_EQ(reservation.available(), 700u);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+
+    MemoryReservation untracked;
+    EXPECT_TRUE(untracked.try_resize(SIZE_MAX));
+    EXPECT_EQ(untracked.available(), SIZE_MAX);
+}
+
+/**
+ * @brief Arena申请的块记在tracker上，reset()和析构时归还；超过上限时allocate()抛出异常
+ */
+TEST(MemoryTrackerTest, ArenaBlocks) {
+    MemoryTracker tracker(4096);
+    {
+        Arena arena(1024, &tracker);
+        arena.allocate(100);
+        EXPECT_EQ(tracker.used(), 1024u);
+        arena.allocate(2000);
+        EXPECT_EQ(tracker.used(), 1024u + 2000u);
+        EXPECT_THROW(arena.allocate(2000), QueryMemoryLimitError);
+        EXPECT_EQ(tracker.used(), arena.memory_usage());
+        arena.reset();
+        EXPECT_EQ(tracker.used(), 0u);
+        arena.allocate(8);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+}
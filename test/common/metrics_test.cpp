@@ -0,0 +1,70 @@
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/metrics.h"
+
+// 多个线程写入不同的分片，读取时所有写入都被计入
+TEST(MetricsTest, CounterSumsShards) {
+    Counter counter("test_counter", "help");
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; t++) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; i++) {
+                counter.add();
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    counter.add(5);
+    EXPECT_EQ(counter.value(), 80005);
+}
+
+// 观测值落入以2的幂微秒为上界的桶，分位数取桶的上界
+TEST(MetricsTest, HistogramBucketsAndQuantiles) {
+    EXPECT_EQ(Histogram::bucket_of(0), 0);
+    EXPECT_EQ(Histogram::bucket_of(1000), 0);
+    EXPECT_EQ(Histogram::bucket_of(1001), 1);
+    EXPECT_EQ(Histogram::bucket_of(3000), 2);
+    EXPECT_EQ(Histogram::bucket_of(4001), 3);
+    EXPECT_EQ(Histogram::bucket_of(UINT64_MAX / 2), Histogram::HISTOGRAM_BUCKETS - 1);
+
+    Histogram histogram("test_latency", "help");
+    EXPECT_EQ(histogram.snapshot().quantile_us(0.5), 0);
+    for (int i = 0; i < 98; i++) {
+        histogram.observe_ns(3000);     // <= 4us
+    }
+    histogram.observe_ns(100000);       // <= 128us
+    histogram.observe_ns(1000000);      // <= 1024us
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 100);
+    EXPECT_EQ(snapshot.sum_ns, 98 * 3000 + 100000 + 1000000);
+    EXPECT_EQ(snapshot.quantile_us(0.5), 4);
+    EXPECT_EQ(snapshot.quantile_us(0.99), 128);
+    EXPECT_EQ(snapshot.quantile_us(1), 1024);
+}
+
+// Prometheus文本中计数器以_total结尾，直方图的桶是累计的，最后是+Inf、_sum和_count
+TEST(MetricsTest, PrometheusFormat) {
+    EngineMetrics &metrics = EngineMetrics::get();
+    uint64_t waits = metrics.lock_waits.value();
+    metrics.lock_waits.add(2);
+    uint64_t fsyncs = metrics.wal_fsync_latency.snapshot().count;
+    metrics.wal_fsync_latency.observe_ns(1500);
+    std::string text = metrics.format_prometheus();
+    EXPECT_NE(text.find("# TYPE unibase_lock_waits_total counter\nunibase_lock_waits_total " +
+                        std::to_string(waits + 2) + "\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("# TYPE unibase_wal_fsync_latency_seconds histogram\n"), std::string::npos);
+    EXPECT_NE(text.find("unibase_wal_fsync_latency_seconds_bucket{le=\"+Inf\"} " + std::to_string(fsyncs + 1) + "\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("unibase_wal_fsync_latency_seconds_count " + std::to_string(fsyncs + 1) + "\n"),
+              std::string::npos);
+
+    auto lines = metrics.format_text();
+    ASSERT_FALSE(lines.empty());
+    EXPECT_EQ(lines[0].rfind("buffer_pool_hits", 0), 0);
+}
@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "common/result_log.h"
+
+static const std::string TEST_RESULT_LOG = "result_log_test.txt";
+
+static std::string read_file(const std::string &file_name) {
+    std::ifstream in(file_name);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+class ResultLogTest : public ::testing::Test {
+   protected:
+    void SetUp() override { std::remove(TEST_RESULT_LOG.c_str()); }
+
+    void TearDown() override { std::remove(TEST_RESULT_LOG.c_str()); }
+};
+
+// 文本按提交的顺序追加到文件中，没有启动后台线程时由stop()写入
+TEST_F(ResultLogTest, KeepsSubmitOrder) {
+    {
+        std::ofstream out(TEST_RESULT_LOG);
+        out << "old\n";
+    }
+    ResultLog log(TEST_RESULT_LOG);
+    log.append("| a |\n");
+    log.append("");
+    log.append("| 1 |\n");
+    log.append("failure\n");
+    EXPECT_EQ(read_file(TEST_RESULT_LOG), "old\n");
+    log.stop();
+    EXPECT_EQ(read_file(TEST_RESULT_LOG), "old\n| a |\n| 1 |\nfailure\n");
+    EXPECT_EQ(log.num_written(), 3);
+}
+
+// 后台线程定期写入，多个线程同时提交时每段文本完整写入，同一线程提交的文本保持顺序
+TEST_F(ResultLogTest, ConcurrentAppend) {
+    const int num_threads = 4;
+    const int num_texts = 1000;
+    ResultLog log(TEST_RESULT_LOG, std::chrono::milliseconds(1));
+    log.start();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&log, t] {
+            for (int i = 0; i < num_texts; i++) {
+                log.append(std::to_string(t) + " " + std::to_string(i) + "\n");
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    log.stop();
+    EXPECT_EQ(log.num_written(), num_threads * num_texts);
+
+    std::ifstream in(TEST_RESULT_LOG);
+    std::vector<int> next(num_threads, 0);
+    int t, i;
+    while (in >> t >> i) {
+        ASSERT_EQ(i, next[t]);
+        next[t]++;
+    }
+    for (int n : next) {
+        EXPECT_EQ(n, num_texts);
+    }
+}
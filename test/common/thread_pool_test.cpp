@@ -0,0 +1,66 @@
+#include <atomic>
+
+#include "gtest/gtest.h"
+
+#include "common/thread_pool.h"
+
+// 所有提交的任务都会被执行，stop()等待已提交的任务执行完
+TEST(ThreadPoolTest, RunsAllTasks) {
+    std::atomic<int> sum{0};
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (int i = 1; i <= 1000; i++) {
+        pool.submit([&sum, i] { sum += i; });
+    }
+    pool.stop();
+    EXPECT_EQ(sum.load(), 500500);
+    EXPECT_EQ(pool.size(), 0);
+}
+
+// 任务在多个线程上并发执行
+TEST(ThreadPoolTest, RunsConcurrently) {
+    ThreadPool pool(2);
+    std::mutex latch;
+    std::condition_variable cv;
+    int arrived = 0;
+    for (int i = 0; i < 2; i++) {
+        pool.submit([&] {
+            std::unique_lock<std::mutex> lock(latch);
+            arrived++;
+            cv.notify_all();
+            // 两个任务都开始执行后才能结束，只有一个线程时会一直等待
+            cv.wait(lock, [&] { return arrived == 2; });
+        });
+    }
+    pool.stop();
+    EXPECT_EQ(arrived, 2);
+}
+
+// numa_spread的线程被限制在某个结点的CPU上，单结点的系统上不限制
+TEST(ThreadPoolTest, NumaSpread) {
+    const NumaTopology &topology = NumaTopology::get();
+    ASSERT_GE(topology.num_nodes(), 1u);
+    std::mutex latch;
+    std::vector<int> num_cpus;
+    ThreadPool pool(4, true);
+    for (int i = 0; i < 16; i++) {
+        pool.submit([&] {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            std::lock_guard<std::mutex> guard(latch);
+            num_cpus.push_back(CPU_COUNT(&set));
+        });
+    }
+    pool.stop();
+    ASSERT_EQ(num_cpus.size(), 16u);
+    if (topology.num_nodes() > 1) {
+        for (int n : num_cpus) {
+            bool on_one_node = false;
+            for (size_t node = 0; node < topology.num_nodes(); node++) {
+                on_one_node |= n == static_cast<int>(topology.cpus(node).size());
+            }
+            EXPECT_TRUE(on_one_node);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "common/trace.h"
+
+// 环形缓冲区写满后覆盖最旧的span，导出时按记录的先后顺序输出，最旧的位置可能正在被覆盖，不输出
+TEST(TraceTest, RingKeepsLatestSpans) {
+    auto ring = std::make_unique<TraceRing>(1);
+    for (uint64_t i = 0; i < 10; i++) {
+        ring->record({"span", "i", i, i * 1000, 500});
+    }
+    EXPECT_EQ(ring->snapshot().size(), 10);
+    for (uint64_t i = 10; i < TRACE_RING_SIZE + 10; i++) {
+        ring->record({"span", "i", i, i * 1000, 500});
+    }
+    auto spans = ring->snapshot();
+    ASSERT_EQ(spans.size(), TRACE_RING_SIZE - 1);
+    EXPECT_EQ(spans.front().arg, 11);
+    EXPECT_EQ(spans.back().arg, TRACE_RING_SIZE + 9);
+}
+
+// 每个线程写入自己的缓冲区，导出的JSON中每个span是一个带线程编号和参数的"X"事件
+TEST(TraceTest, ChromeJsonIncludesAllThreads) {
+    TraceLog &log = TraceLog::get();
+    log.local().record({"main_span", "page_no", 7, 2000, 1500});
+    std::thread([&log] { log.local().record({"worker_span", nullptr, 0, 3000, 250}); }).join();
+
+    std::string json = log.format_chrome_json();
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0);
+    EXPECT_EQ(json.substr(json.size() - 2), "]}");
+    EXPECT_NE(json.find("\"name\":\"main_span\",\"cat\":\"unibase\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":2.000,"
+                        "\"dur\":1.500,\"args\":{\"page_no\":7}}"),
+              std::string::npos)
+        << json;
+    EXPECT_NE(json.find("\"name\":\"worker_span\",\"cat\":\"unibase\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":3.000,"
+                        "\"dur\":0.250}"),
+              std::string::npos)
+        << json;
+}
@@ -0,0 +1,292 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/execution_sort.h"
+#include "execution/executor_index_scan.h"
+#include "execution/executor_nestedloop_join.h"
+#include "execution/executor_projection.h"
+#include "execution/executor_seq_scan.h"
+
+namespace {
+
+const std::string DB_NAME = "batch_executor_test_db";
+
+// 表的记录为(a INT, b INT, c CHAR(8))，a有重复值，b为插入顺序
+constexpr int RECORD_SIZE = 16;
+
+using Rows = std::vector<std::string>;
+
+Condition ValueCondition(const std::string &tab, const std::string &col, CompOp op, int v) {
+    Condition cond;
+    cond.lhs_col = TabCol{tab, col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_int(v);
+    cond.rhs_val.init_raw(sizeof(int));
+    return cond;
+}
+
+// 逐条执行的结果
+Rows RowPath(AbstractExecutor *exec) {
+    Rows rows;
+    for (exec->beginTuple(); !exec->is_end(); exec->nextTuple()) {
+        rows.emplace_back(exec->Next()->data, exec->tupleLen());
+    }
+    return rows;
+}
+
+// 用容量为capacity的批次批量执行的结果，每个批次非空且不超过容量
+Rows BatchPath(AbstractExecutor *exec, size_t capacity) {
+    Rows rows;
+    RowBatch batch(capacity);
+    for (exec->beginBatch(); exec->NextBatch(batch);) {
+        EXPECT_FALSE(batch.empty());
+        EXPECT_LE(batch.size(), batch.capacity());
+        EXPECT_EQ(batch.tuple_len(), exec->tupleLen());
+        for (size_t i = 0; i < batch.size(); i++) {
+            rows.emplace_back(batch.row(i), exec->tupleLen());
+        }
+    }
+    // 执行完毕后再次调用仍然返回false
+    EXPECT_FALSE(exec->NextBatch(batch));
+    return rows;
+}
+
+// 第i条记录(i % num_keys, i, "s<i>")
+std::string MakeRecord(int i, int num_keys) {
+    char rec[RECORD_SIZE] = {};
+    int a = i % num_keys;
+    memcpy(rec, &a, sizeof(int));
+    memcpy(rec + 4, &i, sizeof(int));
+    snprintf(rec + 8, 8, "s%d", i);
+    return std::string(rec, RECORD_SIZE);
+}
+
+Rows Sorted(Rows rows) {
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+// 测试用的批次容量：每批一行、不整除表中记录数的小批次和默认大小
+const std::vector<size_t> CAPACITIES = {1, 7, ROW_BATCH_SIZE};
+
+class BatchExecutorTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    /**
+     * @description: 建表并插入num_rows条记录MakeRecord(i, num_keys)，之后在(a, b)上建索引
+     */
+    void create_table(const std::string &tab_name, int num_rows, int num_keys = 97) {
+        sm_manager_->create_table(tab_name, {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_STRING, 8}}, nullptr);
+        RmFileHandle *fh = sm_manager_->get_table_handle(tab_name).fh;
+        for (int i = 0; i < num_rows; i++) {
+            fh->insert_record(MakeRecord(i, num_keys).data(), &context_);
+        }
+        sm_manager_->create_index(tab_name, {"a", "b"}, nullptr);
+    }
+
+    std::unique_ptr<AbstractExecutor> seq_scan(const std::string &tab_name, std::vector<Condition> conds = {},
+                                               const std::vector<std::string> &proj_cols = {}) {
+        return std::make_unique<SeqScanExecutor>(sm_manager_.get(), sm_manager_->get_table_handle(tab_name),
+                                                 std::move(conds), &context_, proj_cols);
+    }
+
+    std::unique_ptr<AbstractExecutor> index_scan(const std::string &tab_name, std::vector<Condition> conds,
+                                                 bool is_desc = false, const std::vector<std::string> &proj_cols = {},
+                                                 bool index_only = false) {
+        auto &table = sm_manager_->get_table_handle(tab_name);
+        int index_id = table.tab->get_index_meta({"a", "b"})->id;
+        return std::make_unique<IndexScanExecutor>(sm_manager_.get(), table, std::move(conds), index_id, &context_,
+                                                   is_desc, proj_cols, index_only);
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    Context context_{nullptr, nullptr, nullptr};
+};
+
+// 记录数为0、恰好一批、跨越批次边界、以及足够大可以并行扫描的表
+const std::vector<int> TABLE_SIZES = {0, static_cast<int>(ROW_BATCH_SIZE), 2 * static_cast<int>(ROW_BATCH_SIZE) + 17,
+                                      30000};
+
+}  // namespace
+
+/**
+ * @brief 顺序扫描在各种条件、投影和批次容量下批量输出的记录与逐条输出的相同(并行扫描不保持顺序，按集合比较)
+ */
+TEST_F(BatchExecutorTest, SeqScanMatchesTuplePath) {
+    for (int num_rows : TABLE_SIZES) {
+        std::string tab_name = "t" + std::to_string(num_rows);
+        create_table(tab_name, num_rows);
+        std::vector<std::vector<Condition>> cond_sets = {
+            {},
+            {ValueCondition(tab_name, "a", OP_LT, 40)},
+            {ValueCondition(tab_name, "a", OP_EQ, 3), ValueCondition(tab_name, "b", OP_GE, 500)},
+            {ValueCondition(tab_name, "a", OP_GT, 1000)},
+        };
+        for (auto &conds : cond_sets) {
+            for (auto &proj : std::vector<std::vector<std::string>>{{}, {"c", "a"}}) {
+                auto expected = RowPath(seq_scan(tab_name, conds, proj).get());
+                if (conds.empty()) {
+                    ASSERT_EQ(expected.size(), static_cast<size_t>(num_rows));
+                }
+                for (size_t capacity : CAPACITIES) {
+                    ASSERT_EQ(Sorted(BatchPath(seq_scan(tab_name, conds, proj).get(), capacity)), Sorted(expected))
+                        << tab_name << " conds=" << conds.size() << " proj=" << proj.size() << " capacity=" << capacity;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief 索引扫描批量输出的记录及其顺序与逐条输出的相同，包括逆序扫描和只读取索引的扫描
+ */
+TEST_F(BatchExecutorTest, IndexScanMatchesTuplePath) {
+    int num_rows = 2 * static_cast<int>(ROW_BATCH_SIZE) + 17;
+    create_table("t", num_rows);
+    std::vector<std::vector<Condition>> cond_sets = {
+        {},
+        {ValueCondition("t", "a", OP_EQ, 3)},
+        {ValueCondition("t", "a", OP_GE, 90)},
+        {ValueCondition("t", "a", OP_EQ, 5), ValueCondition("t", "b", OP_GT, 1000)},
+        {ValueCondition("t", "a", OP_EQ, 500)},
+    };
+    for (auto &conds : cond_sets) {
+        for (bool is_desc : {false, true}) {
+            auto expected = RowPath(index_scan("t", conds, is_desc).get());
+            if (conds.empty()) {
+                ASSERT_EQ(expected.size(), static_cast<size_t>(num_rows));
+            }
+            auto expected_index_only = RowPath(index_scan("t", conds, is_desc, {"b", "a"}, true).get());
+            ASSERT_EQ(expected_index_only.size(), expected.size());
+            for (size_t capacity : CAPACITIES) {
+                ASSERT_EQ(BatchPath(index_scan("t", conds, is_desc).get(), capacity), expected)
+                    << "conds=" << conds.size() << " desc=" << is_desc << " capacity=" << capacity;
+                ASSERT_EQ(BatchPath(index_scan("t", conds, is_desc, {"b", "a"}, true).get(), capacity),
+                          expected_index_only);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 投影批量输出的记录与逐条输出的相同，儿子节点的批次大于输出批次的容量时分多次输出
+ */
+TEST_F(BatchExecutorTest, ProjectionMatchesTuplePath) {
+    for (int num_rows : {0, 2 * static_cast<int>(ROW_BATCH_SIZE) + 17}) {
+        std::string tab_name = "t" + std::to_string(num_rows);
+        create_table(tab_name, num_rows);
+        auto make = [&] {
+            return std::make_unique<ProjectionExecutor>(
+                seq_scan(tab_name, {ValueCondition(tab_name, "a", OP_NE, 7)}),
+                std::vector<TabCol>{{tab_name, "c"}, {tab_name, "a"}});
+        };
+        auto expected = RowPath(make().get());
+        for (size_t capacity : CAPACITIES) {
+            ASSERT_EQ(BatchPath(make().get(), capacity), expected) << tab_name << " capacity=" << capacity;
+        }
+    }
+}
+
+/**
+ * @brief 块嵌套循环连接的结果与逐对比较左右表记录得到的相同。内表每个key有多条记录，
+ *        输出批次容量为7时批次在一条外表记录的匹配中途装满；左表块很小时分多块重新扫描内表；任一侧为空时没有输出
+ */
+TEST_F(BatchExecutorTest, NestedLoopJoinMatchesTuplePath) {
+    create_table("l", 300, 50);
+    create_table("r", 40, 10);
+    create_table("e", 0);
+    std::vector<Condition> key_eq = {Condition{{"l", "a"}, OP_EQ, false, {"r", "a"}, {}}};
+
+    // 按定义直接计算的连接结果
+    Rows expected;
+    for (int i = 0; i < 300; i++) {
+        for (int j = 0; j < 40; j++) {
+            if (i % 50 == j % 10) {
+                expected.push_back(MakeRecord(i, 50) + MakeRecord(j, 10));
+            }
+        }
+    }
+    ASSERT_EQ(expected.size(), 300u / 50 * 10 * 4);
+
+    for (size_t block_size : {size_t(NESTED_LOOP_JOIN_BLOCK_PAGES * PAGE_SIZE), size_t(64)}) {
+        auto make = [&](const std::string &left, const std::string &right, std::vector<Condition> conds) {
+            return std::make_unique<NestedLoopJoinExecutor>(seq_scan(left), seq_scan(right), std::move(conds),
+                                                            block_size);
+        };
+        ASSERT_EQ(Sorted(RowPath(make("l", "r", key_eq).get())), Sorted(expected));
+        for (size_t capacity : CAPACITIES) {
+            ASSERT_EQ(Sorted(BatchPath(make("l", "r", key_eq).get(), capacity)), Sorted(expected))
+                << "block_size=" << block_size << " capacity=" << capacity;
+            // 没有连接条件时每条外表记录与内表的全部40条记录连接
+            ASSERT_EQ(BatchPath(make("l", "r", {}).get(), capacity).size(), 300u * 40);
+            ASSERT_TRUE(BatchPath(make("e", "r", {}).get(), capacity).empty());
+            ASSERT_TRUE(BatchPath(make("l", "e", {}).get(), capacity).empty());
+        }
+        ASSERT_TRUE(RowPath(make("e", "r", {}).get()).empty());
+        ASSERT_TRUE(RowPath(make("l", "e", {}).get()).empty());
+    }
+}
+
+/**
+ * @brief 排序批量输出的记录及其顺序与逐条输出的相同，包括空输入、内存中排序、分段写入临时文件后归并以及top-N
+ */
+TEST_F(BatchExecutorTest, SortMatchesTuplePath) {
+    int num_rows = 2 * static_cast<int>(ROW_BATCH_SIZE) + 17;
+    create_table("t", num_rows);
+    create_table("e", 0);
+    std::vector<TabCol> keys = {{"t", "a"}, {"t", "c"}};
+    for (size_t budget : {SORT_MEMORY_BUDGET, size_t(4096)}) {
+        for (size_t limit : {SIZE_MAX, size_t(100)}) {
+            auto make = [&] {
+                return std::make_unique<SortExecutor>(seq_scan("t"), keys, std::vector<bool>{true, false}, budget,
+                                                      limit);
+            };
+            auto expected = RowPath(make().get());
+            ASSERT_EQ(expected.size(), std::min<size_t>(num_rows, limit));
+            // a降序，a相同时c升序
+            for (size_t i = 1; i < expected.size(); i++) {
+                int prev_a, a;
+                memcpy(&prev_a, expected[i - 1].data(), sizeof(int));
+                memcpy(&a, expected[i].data(), sizeof(int));
+                ASSERT_TRUE(prev_a > a || (prev_a == a && expected[i - 1].substr(8) <= expected[i].substr(8)));
+            }
+            for (size_t capacity : CAPACITIES) {
+                ASSERT_EQ(BatchPath(make().get(), capacity), expected)
+                    << "budget=" << budget << " limit=" << limit << " capacity=" << capacity;
+            }
+        }
+    }
+    for (size_t capacity : CAPACITIES) {
+        SortExecutor sort(seq_scan("e"), {{"e", "a"}}, {false});
+        ASSERT_TRUE(BatchPath(&sort, capacity).empty());
+    }
+}
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#define private public
+#include "execution/execution_projector.h"
+#undef private  // for use private variables in ColumnProjector
+
+static std::vector<ColMeta> TableCols() {
+    return {{"t", "a", TYPE_INT, 4, 0, false},
+            {"t", "b", TYPE_STRING, 8, 4, false},
+            {"t", "c", TYPE_FLOAT, 4, 12, false},
+            {"t", "d", TYPE_INT, 4, 16, false}};
+}
+
+/**
+ * @brief 只保留需要的字段，输出字段按原顺序紧密排列，相邻字段合并为一次复制
+ */
+TEST(ColumnProjectorTest, KeepsRequiredColumns) {
+    ColumnProjector projector(TableCols(), {"d", "b", "c"});
+    EXPECT_FALSE(projector.identity());
+    ASSERT_EQ(projector.cols().size(), 3u);
+    EXPECT_EQ(projector.cols()[0].name, "b");
+    EXPECT_EQ(projector.cols()[0].offset, 0);
+    EXPECT_EQ(projector.cols()[1].offset, 8);
+    EXPECT_EQ(projector.cols()[2].offset, 12);
+    EXPECT_EQ(projector.len(), 16u);
+    EXPECT_EQ(projector.runs_.size(), 1u);
+
+    char rec[20];
+    for (int i = 0; i < 20; i++) {
+        rec[i] = static_cast<char>(i);
+    }
+    char out[16];
+    projector.project(rec, out);
+    EXPECT_EQ(memcmp(out, rec + 4, 16), 0);
+
+    ColumnProjector gap(TableCols(), {"a", "c"});
+    EXPECT_EQ(gap.runs_.size(), 2u);
+    gap.project(rec, out);
+    EXPECT_EQ(memcmp(out, rec, 4), 0);
+    EXPECT_EQ(memcmp(out + 4, rec + 12, 4), 0);
+}
+
+/**
+ * @brief 不指定字段或者指定了全部字段时输出完整的记录
+ */
+TEST(ColumnProjectorTest, Identity) {
+    ColumnProjector all(TableCols(), {});
+    EXPECT_TRUE(all.identity());
+    EXPECT_EQ(all.len(), 20u);
+    EXPECT_EQ(all.runs_.size(), 1u);
+    EXPECT_TRUE(ColumnProjector(TableCols(), {"a", "b", "c", "d"}).identity());
+}
@@ -0,0 +1,137 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/executor_delete.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_update.h"
+#include "transaction/transaction_manager.h"
+
+namespace {
+
+const std::string DB_NAME = "dml_lock_test_db";
+
+// 表t的第i条记录为(i, i)，行数超过升级阈值
+constexpr int ROWS = static_cast<int>(LOCK_ESCALATION_THRESHOLD) + 10;
+
+Value IntValue(int v) {
+    Value value;
+    value.set_int(v);
+    return value;
+}
+
+/*
+INSERT/UPDATE/DELETE算子通过语句的Context加锁：表上的意向写锁和修改的记录上的排他锁，
+一张表上的行级锁超过LOCK_ESCALATION_THRESHOLD时升级为表级锁
+*/
+class DmlLockTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+        sm_manager_->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}}, nullptr);
+        Context context(nullptr, nullptr, nullptr);
+        for (int i = 0; i < ROWS; i++) {
+            int rec[2] = {i, i};
+            rids_.push_back(table().fh->insert_record(reinterpret_cast<char *>(rec), &context));
+        }
+        txn_manager_ = std::make_unique<TransactionManager>(&lock_manager_, sm_manager_.get());
+    }
+
+    void TearDown() override {
+        txn_manager_.reset();
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    const TableHandle &table() { return sm_manager_->get_table_handle("t"); }
+
+    int fd() { return table().fh->GetFd(); }
+
+    int b_of(const Rid &rid) {
+        Context context(nullptr, nullptr, nullptr);
+        auto rec = table().fh->get_record(rid, &context);
+        return *reinterpret_cast<int *>(rec->data + sizeof(int));
+    }
+
+    void update(Transaction *txn, std::vector<Rid> rids, int b) {
+        Context context(&lock_manager_, nullptr, txn);
+        UpdateExecutor(sm_manager_.get(), table(), {{{"t", "b"}, IntValue(b)}}, {}, std::move(rids), &context).Next();
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    LockManager lock_manager_;
+    std::unique_ptr<TransactionManager> txn_manager_;
+    std::vector<Rid> rids_;
+};
+
+}  // namespace
+
+/**
+ * @brief 修改少量记录时持有行级锁，其他事务可以修改同一张表上的其他记录，修改同一条记录的年轻事务回滚
+ */
+TEST_F(DmlLockTest, RowLocks) {
+    Transaction *old_txn = txn_manager_->begin(nullptr, nullptr);
+    Transaction *young_txn = txn_manager_->begin(nullptr, nullptr);
+    update(old_txn, {rids_[0], rids_[1]}, -1);
+    EXPECT_EQ(old_txn->get_lock_set()->size(), 3u);
+    EXPECT_EQ(old_txn->get_lock_set()->count(LockDataId(fd(), rids_[0], LockDataType::RECORD)), 1u);
+
+    update(young_txn, {rids_[2]}, -2);
+    EXPECT_THROW(update(young_txn, {rids_[3], rids_[1]}, -3), TransactionAbortException);
+    // 加锁在修改之前完成，失败的语句没有修改任何记录
+    EXPECT_EQ(b_of(rids_[3]), 3);
+    txn_manager_->abort(young_txn, nullptr);
+    EXPECT_EQ(b_of(rids_[2]), 2);
+
+    // 插入的记录同样加排他锁
+    Context context(&lock_manager_, nullptr, old_txn);
+    InsertExecutor insert(sm_manager_.get(), table(), {IntValue(-1), IntValue(-1)}, &context);
+    insert.Next();
+    EXPECT_EQ(old_txn->get_lock_set()->count(LockDataId(fd(), insert.rid(), LockDataType::RECORD)), 1u);
+    txn_manager_->commit(old_txn, nullptr);
+    EXPECT_EQ(b_of(rids_[1]), -1);
+}
+
+/**
+ * @brief 一条UPDATE修改的记录超过升级阈值时，事务在表上只持有一个表级排他锁，其他事务无法再修改该表，
+ *        提交之后表级锁被释放
+ */
+TEST_F(DmlLockTest, EscalatesLargeUpdate) {
+    Transaction *writer = txn_manager_->begin(nullptr, nullptr);
+    Transaction *other = txn_manager_->begin(nullptr, nullptr);
+    update(writer, rids_, -1);
+    EXPECT_TRUE(writer->get_table_row_locks()[fd()].escalated);
+    EXPECT_TRUE(writer->get_table_row_locks()[fd()].escalated_exclusive);
+    EXPECT_EQ(writer->get_lock_set()->size(), 1u);
+    EXPECT_EQ(writer->get_lock_set()->count(LockDataId(fd(), LockDataType::TABLE)), 1u);
+
+    Context context(&lock_manager_, nullptr, other);
+    EXPECT_THROW(DeleteExecutor(sm_manager_.get(), table(), {}, {rids_[0]}, &context).Next(),
+                 TransactionAbortException);
+    txn_manager_->abort(other, nullptr);
+    txn_manager_->commit(writer, nullptr);
+
+    Transaction *later = txn_manager_->begin(nullptr, nullptr);
+    update(later, {rids_[0]}, 7);
+    txn_manager_->commit(later, nullptr);
+    EXPECT_EQ(b_of(rids_[0]), 7);
+    EXPECT_EQ(b_of(rids_[ROWS - 1]), -1);
+}
@@ -0,0 +1,94 @@
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/executor_nestedloop_join.h"
+#include "execution/explain.h"
+
+/**
+ * @brief 从内存中的记录读取的算子，记录为(int key)
+ */
+class KeyExecutor : public AbstractExecutor {
+   public:
+    KeyExecutor(const std::string &tab_name, std::vector<int> keys) : keys_(std::move(keys)) {
+        cols_ = {{tab_name, "key", TYPE_INT, sizeof(int), 0, false}};
+    }
+
+    size_t tupleLen() const override { return sizeof(int); }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    std::string getType() override { return "KeyExecutor"; }
+
+    void beginTuple() override { pos_ = 0; }
+
+    void nextTuple() override { pos_++; }
+
+    bool is_end() const override { return pos_ >= keys_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(tupleLen());
+        memcpy(rec->data, &keys_[pos_], sizeof(int));
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    std::vector<ColMeta> cols_;
+    std::vector<int> keys_;
+    size_t pos_ = 0;
+};
+
+static bool Contains(const std::string &line, const std::string &str) { return line.find(str) != std::string::npos; }
+
+/**
+ * @brief EXPLAIN只输出计划树，节点按先序缩进，条件和limit等写在节点下面
+ */
+TEST(ExplainTest, DescribePlan) {
+    Condition cond{{"l", "key"}, OP_EQ, false, {"r", "key"}, {}};
+    auto left = std::make_shared<LimitPlan>(T_Limit, nullptr, 5);
+    auto right = std::make_shared<SortPlan>(T_Sort, nullptr, std::vector<TabCol>{{"r", "key"}}, std::vector<bool>{true});
+    auto join = std::make_shared<JoinPlan>(T_NestLoop, left, right, std::vector<Condition>{cond});
+
+    ExplainStats stats(join, false);
+    auto lines = stats.format();
+    ASSERT_EQ(lines.size(), 6);
+    EXPECT_EQ(lines[0], "Nested Loop Join");
+    EXPECT_EQ(lines[1], "  Join Cond: l.key = r.key");
+    EXPECT_EQ(lines[2], "  ->  Limit");
+    EXPECT_EQ(lines[3], "        Limit: 5");
+    EXPECT_EQ(lines[4], "  ->  Sort");
+    EXPECT_EQ(lines[5], "        Sort Key: r.key DESC");
+}
+
+/**
+ * @brief EXPLAIN ANALYZE统计每个算子的输出行数和执行次数，连接的输出行数与实际返回的记录数一致
+ */
+TEST(ExplainTest, AnalyzeCountsRowsAndLoops) {
+    Condition cond{{"l", "key"}, OP_EQ, false, {"r", "key"}, {}};
+    auto left = std::make_shared<LimitPlan>(T_Limit, nullptr, 5);
+    auto right = std::make_shared<LimitPlan>(T_Limit, nullptr, 5);
+    auto join = std::make_shared<JoinPlan>(T_NestLoop, left, right, std::vector<Condition>{cond});
+
+    ExplainStats stats(join, true);
+    auto exec = stats.instrument(
+        join.get(), std::make_unique<NestedLoopJoinExecutor>(
+                        stats.instrument(left.get(), std::make_unique<KeyExecutor>("l", std::vector<int>{1, 2, 3})),
+                        stats.instrument(right.get(), std::make_unique<KeyExecutor>("r", std::vector<int>{2, 3, 3, 4})),
+                        std::vector<Condition>{cond}));
+    EXPECT_EQ(exec->getType(), "NestedLoopJoinExecutor");
+    size_t num_rows = 0;
+    RowBatch batch;
+    for (exec->beginBatch(); exec->NextBatch(batch);) {
+        num_rows += batch.size();
+    }
+    ASSERT_EQ(num_rows, 3);
+
+    auto lines = stats.format(1000000);
+    ASSERT_EQ(lines.size(), 7);
+    EXPECT_TRUE(Contains(lines[0], "Nested Loop Join (actual rows=3 loops=1 ")) << lines[0];
+    EXPECT_TRUE(Contains(lines[2], "(actual rows=3 loops=1 ")) << lines[2];
+    EXPECT_TRUE(Contains(lines[4], "pages=0 hits=0)")) << lines[4];
+    EXPECT_EQ(lines[6], "Execution Time: 1.000 ms");
+}
@@ -0,0 +1,88 @@
+#include "execution/execution_filter_kernels.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "index/ix_compare.h"
+
+static bool EvalOp(int cmp, CompOp op) {
+    switch (op) {
+        case OP_EQ: return cmp == 0;
+        case OP_NE: return cmp != 0;
+        case OP_LT: return cmp < 0;
+        case OP_GT: return cmp > 0;
+        case OP_LE: return cmp <= 0;
+        default: return cmp >= 0;
+    }
+}
+
+/**
+ * @brief 用ix_compare逐行校验过滤内核，记录中字段前后各有填充字节，行数覆盖不足8行、不足64行和跨多个字的情况，
+ *        输入位图随机置位，检查内核只清除位图中的位。packed为true时字段紧密排列，与PAX页面的minipage相同
+ */
+void CheckFilterKernels(ColType type, int len, bool avx2, bool packed = false) {
+    std::default_random_engine rng(2023);
+    std::uniform_int_distribution<int> dist(-20, 20);
+    const int offset = packed ? 0 : 3;
+    const size_t stride = packed ? len : offset + len + 5;
+    for (size_t n : {0, 1, 7, 8, 9, 63, 64, 65, 200, 1024}) {
+        std::vector<char> rows(n * stride);
+        for (size_t i = 0; i < n; i++) {
+            char *col = rows.data() + i * stride + offset;
+            int v = dist(rng);
+            if (type == TYPE_INT) {
+                memcpy(col, &v, sizeof(int));
+            } else if (type == TYPE_FLOAT) {
+                float f = static_cast<float>(v) / 2;
+                memcpy(col, &f, sizeof(float));
+            } else {
+                memset(col, 'a' + (v + 20) % 4, len);
+                col[len - 1] = static_cast<char>('a' + (v + 40) % 3);
+            }
+        }
+        std::vector<uint64_t> input((n + 63) / 64);
+        for (auto &word : input) {
+            word = (static_cast<uint64_t>(rng()) << 32) ^ rng();
+        }
+        if (n % 64 != 0) {
+            input.back() &= (1ULL << (n % 64)) - 1;
+        }
+        // 常量取自表中的某一行，保证EQ条件有满足的行
+        std::vector<char> zero(len, 0);
+        const char *value = n == 0 ? zero.data() : rows.data() + (n / 2) * stride + offset;
+        for (CompOp op : {OP_EQ, OP_NE, OP_LT, OP_GT, OP_LE, OP_GE}) {
+            std::vector<uint64_t> bits = input;
+            filter_kernel(type, op, avx2)(rows.data() + offset, stride, n, value, len, bits.data());
+            for (size_t i = 0; i < n; i++) {
+                bool selected = input[i / 64] >> (i % 64) & 1;
+                bool expected =
+                    selected && EvalOp(ix_compare(rows.data() + i * stride + offset, value, type, len), op);
+                ASSERT_EQ(static_cast<bool>(bits[i / 64] >> (i % 64) & 1), expected)
+                    << "type=" << type << " op=" << op << " n=" << n << " i=" << i;
+            }
+        }
+    }
+}
+
+TEST(FilterKernelsTest, IntTest) {
+    CheckFilterKernels(TYPE_INT, sizeof(int), false);
+    CheckFilterKernels(TYPE_INT, sizeof(int), false, true);
+    if (ix_cpu_has_avx2()) {
+        CheckFilterKernels(TYPE_INT, sizeof(int), true);
+        CheckFilterKernels(TYPE_INT, sizeof(int), true, true);
+    }
+}
+
+TEST(FilterKernelsTest, FloatTest) {
+    CheckFilterKernels(TYPE_FLOAT, sizeof(float), false);
+    CheckFilterKernels(TYPE_FLOAT, sizeof(float), false, true);
+    if (ix_cpu_has_avx2()) {
+        CheckFilterKernels(TYPE_FLOAT, sizeof(float), true);
+        CheckFilterKernels(TYPE_FLOAT, sizeof(float), true, true);
+    }
+}
+
+TEST(FilterKernelsTest, StringTest) {
+    CheckFilterKernels(TYPE_STRING, 6, false);
+}
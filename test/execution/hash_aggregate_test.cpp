@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "execution/executor_hash_aggregate.h"
+#include "execution/executor_stream_aggregate.h"
+#undef private  // for use private variables in HashAggregateExecutor and StreamAggregateExecutor
+
+/**
+ * @brief 从内存中的记录读取的算子，记录为(int key, int val, float f)
+ */
+class RowsExecutor : public AbstractExecutor {
+   public:
+    struct Row {
+        int key;
+        int val;
+        float f;
+    };
+
+    explicit RowsExecutor(std::vector<Row> rows) : rows_(std::move(rows)) {
+        cols_ = {{"t", "key", TYPE_INT, sizeof(int), 0, false},
+                 {"t", "val", TYPE_INT, sizeof(int), 4, false},
+                 {"t", "f", TYPE_FLOAT, sizeof(float), 8, false}};
+    }
+
+    size_t tupleLen() const override { return sizeof(Row); }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override { pos_ = 0; }
+
+    void nextTuple() override { pos_++; }
+
+    bool is_end() const override { return pos_ >= rows_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(tupleLen());
+        memcpy(rec->data, &rows_[pos_], sizeof(Row));
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    std::vector<ColMeta> cols_;
+    std::vector<Row> rows_;
+    size_t pos_ = 0;
+};
+
+static std::vector<RowsExecutor::Row> RandomRows(size_t n, int max_key) {
+    std::default_random_engine rng(n);
+    std::uniform_int_distribution<int> key_dist(0, max_key);
+    std::uniform_int_distribution<int> val_dist(-1000, 1000);
+    std::vector<RowsExecutor::Row> rows;
+    for (size_t i = 0; i < n; i++) {
+        int val = val_dist(rng);
+        rows.push_back({key_dist(rng), val, val / 4.0f});
+    }
+    return rows;
+}
+
+static AggExpr Agg(AggType type, const std::string &col, const std::string &output) {
+    return {type, {"t", col}, {"", output}};
+}
+
+// 每组的COUNT(*)、SUM(val)、MIN(val)、MAX(val)、AVG(f)
+struct Expected {
+    int count = 0;
+    int64_t sum = 0;
+    int min = INT32_MAX;
+    int max = INT32_MIN;
+    double fsum = 0;
+};
+
+static std::vector<AggExpr> AllAggs() {
+    return {Agg(AGG_COUNT, "*", "COUNT(*)"), Agg(AGG_SUM, "val", "SUM(t.val)"), Agg(AGG_MIN, "val", "MIN(t.val)"),
+            Agg(AGG_MAX, "val", "MAX(t.val)"), Agg(AGG_AVG, "f", "AVG(t.f)")};
+}
+
+static std::map<int, Expected> GroupByKey(const std::vector<RowsExecutor::Row> &rows) {
+    std::map<int, Expected> groups;
+    for (auto &row : rows) {
+        auto &g = groups[row.key];
+        g.count++;
+        g.sum += row.val;
+        g.min = std::min(g.min, row.val);
+        g.max = std::max(g.max, row.val);
+        g.fsum += row.f;
+    }
+    return groups;
+}
+
+// 批量读出聚合结果，输出记录为(key, COUNT, SUM, MIN, MAX, AVG)
+static void CheckGroups(AbstractExecutor *agg, const std::map<int, Expected> &expected) {
+    ASSERT_EQ(agg->tupleLen(), 6 * sizeof(int));
+    std::map<int, std::vector<char>> res;
+    RowBatch batch;
+    for (agg->beginBatch(); agg->NextBatch(batch);) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            int key = *reinterpret_cast<const int *>(batch.row(i));
+            ASSERT_EQ(res.count(key), 0u) << "duplicate group " << key;
+            res[key].assign(batch.row(i), batch.row(i) + agg->tupleLen());
+        }
+    }
+    ASSERT_EQ(res.size(), expected.size());
+    for (auto &[key, g] : expected) {
+        const int *out = reinterpret_cast<const int *>(res[key].data());
+        EXPECT_EQ(out[1], g.count);
+        EXPECT_EQ(out[2], g.sum);
+        EXPECT_EQ(out[3], g.min);
+        EXPECT_EQ(out[4], g.max);
+        EXPECT_FLOAT_EQ(*reinterpret_cast<const float *>(out + 5), static_cast<float>(g.fsum / g.count));
+    }
+}
+
+/**
+ * @brief 按key分组的各个聚合结果与std::map相同；内存预算很小时写入分区后聚合的结果也相同
+ */
+TEST(HashAggregateTest, GroupByMatchesMap) {
+    auto rows = RandomRows(20000, 3000);
+    auto expected = GroupByKey(rows);
+    for (size_t budget : {HASH_AGG_MEMORY_BUDGET, size_t(4 * 1024)}) {
+        HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "key"}}, AllAggs(), budget);
+        CheckGroups(&agg, expected);
+        EXPECT_EQ(agg.spilled_, budget != HASH_AGG_MEMORY_BUDGET);
+        // 再次执行得到相同的结果
+        CheckGroups(&agg, expected);
+    }
+}
+
+/**
+ * @brief 分组超过语句的内存上限时与超过预算一样写入分区，结果不变；
+ *        上限小到放不下一个分区的分组时抛出QueryMemoryLimitError，析构后归还全部内存
+ */
+TEST(HashAggregateTest, QueryMemoryLimit) {
+    auto rows = RandomRows(20000, 3000);
+    auto expected = GroupByKey(rows);
+    MemoryTracker tracker(32 * 1024);
+    {
+        HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "key"}}, AllAggs(),
+                                  HASH_AGG_MEMORY_BUDGET, &tracker);
+        CheckGroups(&agg, expected);
+        EXPECT_TRUE(agg.spilled_);
+        EXPECT_LE(tracker.peak(), tracker.limit());
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+
+    tracker.set_limit(512);
+    {
+        HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "key"}}, AllAggs(),
+                                  HASH_AGG_MEMORY_BUDGET, &tracker);
+        EXPECT_THROW(CheckGroups(&agg, expected), QueryMemoryLimitError);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+}
+
+/**
+ * @brief 输出字段的名称、类型和偏移
+ */
+TEST(HashAggregateTest, OutputColumns) {
+    HashAggregateExecutor agg(std::make_unique<RowsExecutor>(RandomRows(10, 3)), {{"t", "key"}}, AllAggs());
+    auto &cols = agg.cols();
+    ASSERT_EQ(cols.size(), 6u);
+    EXPECT_EQ(cols[0].tab_name, "t");
+    EXPECT_EQ(cols[0].name, "key");
+    std::vector<ColType> types = {TYPE_INT, TYPE_INT, TYPE_INT, TYPE_INT, TYPE_INT, TYPE_FLOAT};
+    for (size_t i = 0; i < cols.size(); i++) {
+        EXPECT_EQ(cols[i].type, types[i]);
+        EXPECT_EQ(cols[i].offset, static_cast<int>(i * sizeof(int)));
+    }
+    EXPECT_EQ(cols[2].tab_name, "");
+    EXPECT_EQ(cols[2].name, "SUM(t.val)");
+    EXPECT_EQ(agg.get_col_offset({"", "AVG(t.f)"}).offset, 5 * static_cast<int>(sizeof(int)));
+}
+
+/**
+ * @brief 没有分组字段时输出一条记录，空输入也输出一条COUNT为0的记录；逐条执行与批量执行结果相同
+ */
+TEST(HashAggregateTest, GlobalAggregate) {
+    std::vector<AggExpr> aggs = {Agg(AGG_COUNT, "*", "COUNT(*)"), Agg(AGG_SUM, "f", "SUM(t.f)"),
+                                 Agg(AGG_MAX, "key", "MAX(t.key)")};
+    auto rows = RandomRows(5000, 100);
+    double fsum = 0;
+    int max_key = INT32_MIN;
+    for (auto &row : rows) {
+        fsum += row.f;
+        max_key = std::max(max_key, row.key);
+    }
+    HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {}, aggs);
+    agg.beginTuple();
+    ASSERT_FALSE(agg.is_end());
+    auto rec = agg.Next();
+    EXPECT_EQ(*reinterpret_cast<int *>(rec->data), 5000);
+    EXPECT_FLOAT_EQ(*reinterpret_cast<float *>(rec->data + 4), static_cast<float>(fsum));
+    EXPECT_EQ(*reinterpret_cast<int *>(rec->data + 8), max_key);
+    agg.nextTuple();
+    EXPECT_TRUE(agg.is_end());
+
+    HashAggregateExecutor empty(std::make_unique<RowsExecutor>(std::vector<RowsExecutor::Row>{}), {}, aggs);
+    empty.beginTuple();
+    ASSERT_FALSE(empty.is_end());
+    EXPECT_EQ(*reinterpret_cast<int *>(empty.Next()->data), 0);
+    empty.nextTuple();
+    EXPECT_TRUE(empty.is_end());
+
+    // 有分组字段时空输入没有输出
+    HashAggregateExecutor grouped(std::make_unique<RowsExecutor>(std::vector<RowsExecutor::Row>{}),
+                                  {{"t", "key"}}, aggs);
+    grouped.beginTuple();
+    EXPECT_TRUE(grouped.is_end());
+}
+
+/**
+ * @brief 多个分组字段
+ */
+TEST(HashAggregateTest, MultipleGroupColumns) {
+    auto rows = RandomRows(3000, 20);
+    for (auto &row : rows) {
+        row.val = (row.val % 3 + 3) % 3;
+    }
+    std::map<std::pair<int, int>, int> expected;
+    for (auto &row : rows) {
+        expected[{row.val, row.key}]++;
+    }
+    HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "val"}, {"t", "key"}},
+                              {Agg(AGG_COUNT, "key", "COUNT(t.key)")}, 256);
+    std::map<std::pair<int, int>, int> res;
+    for (agg.beginTuple(); !agg.is_end(); agg.nextTuple()) {
+        auto rec = agg.Next();
+        const int *out = reinterpret_cast<const int *>(rec->data);
+        res[{out[0], out[1]}] += out[2];
+    }
+    EXPECT_EQ(res, expected);
+    EXPECT_TRUE(agg.spilled_);
+}
+
+/**
+ * @brief 输入分为几部分分别聚合到各自的hash表中，合并后的结果与整体聚合相同，并行扫描的聚合按这种方式计算
+ */
+TEST(HashAggregateTest, MergePartialTables) {
+    auto rows = RandomRows(20000, 3000);
+    auto expected = GroupByKey(rows);
+    HashAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "key"}}, AllAggs());
+    const size_t num_parts = 3;
+    std::vector<AggregateHashTable> parts(num_parts, AggregateHashTable(&agg.aggs_));
+    for (size_t i = 0; i < rows.size(); i++) {
+        uint64_t h;
+        ASSERT_TRUE(parts[i % num_parts].aggregate_row(reinterpret_cast<const char *>(&rows[i]), true, &h));
+    }
+    AggregateHashTable merged(&agg.aggs_);
+    for (auto &part : parts) {
+        merged.merge(part);
+    }
+    ASSERT_EQ(merged.size(), expected.size());
+    std::vector<char> out(agg.tupleLen());
+    for (size_t g = 0; g < merged.size(); g++) {
+        agg.aggs_.finalize(merged.group(g), out.data());
+        const int *res = reinterpret_cast<const int *>(out.data());
+        auto &e = expected.at(res[0]);
+        EXPECT_EQ(res[1], e.count);
+        EXPECT_EQ(res[2], e.sum);
+        EXPECT_EQ(res[3], e.min);
+        EXPECT_EQ(res[4], e.max);
+        EXPECT_FLOAT_EQ(*reinterpret_cast<const float *>(res + 5), static_cast<float>(e.fsum / e.count));
+    }
+}
+
+/**
+ * @brief 输入按key有序时流式聚合的结果与std::map相同，按输入顺序输出分组；没有分组字段时空输入也输出一条记录
+ */
+TEST(StreamAggregateTest, SortedInput) {
+    auto rows = RandomRows(20000, 3000);
+    std::stable_sort(rows.begin(), rows.end(), [](auto &a, auto &b) { return a.key < b.key; });
+    auto expected = GroupByKey(rows);
+    StreamAggregateExecutor agg(std::make_unique<RowsExecutor>(rows), {{"t", "key"}}, AllAggs());
+    CheckGroups(&agg, expected);
+    // 逐条执行时分组按key升序输出
+    std::vector<int> keys;
+    for (agg.beginTuple(); !agg.is_end(); agg.nextTuple()) {
+        keys.push_back(*reinterpret_cast<int *>(agg.Next()->data));
+    }
+    ASSERT_EQ(keys.size(), expected.size());
+    EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+
+    StreamAggregateExecutor empty(std::make_unique<RowsExecutor>(std::vector<RowsExecutor::Row>{}), {},
+                                  {Agg(AGG_COUNT, "*", "COUNT(*)")});
+    empty.beginTuple();
+    ASSERT_FALSE(empty.is_end());
+    EXPECT_EQ(*reinterpret_cast<int *>(empty.Next()->data), 0);
+    empty.nextTuple();
+    EXPECT_TRUE(empty.is_end());
+}
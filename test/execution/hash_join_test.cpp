@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "execution/executor_hash_join.h"
+#include "execution/executor_merge_join.h"
+#include "execution/executor_nestedloop_join.h"
+#undef private  // for use private variables in join executors
+
+/**
+ * @brief 从内存中的记录读取的算子，记录为(int key, int val)
+ */
+class VectorExecutor : public AbstractExecutor {
+   public:
+    VectorExecutor(const std::string &tab_name, std::vector<std::pair<int, int>> rows) : rows_(std::move(rows)) {
+        cols_ = {{tab_name, "key", TYPE_INT, sizeof(int), 0, false}, {tab_name, "val", TYPE_INT, sizeof(int), 4, false}};
+    }
+
+    size_t tupleLen() const override { return 2 * sizeof(int); }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override {
+        pos_ = 0;
+        scans_++;
+    }
+
+    void nextTuple() override { pos_++; }
+
+    bool is_end() const override { return pos_ >= rows_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(tupleLen());
+        memcpy(rec->data, &rows_[pos_].first, sizeof(int));
+        memcpy(rec->data + sizeof(int), &rows_[pos_].second, sizeof(int));
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    std::vector<ColMeta> cols_;
+    std::vector<std::pair<int, int>> rows_;
+    size_t pos_ = 0;
+
+   public:
+    int scans_ = 0;  // beginTuple()的调用次数
+};
+
+/**
+ * @brief 接受运行时过滤器的VectorExecutor，批量输出时丢弃过滤器判定没有匹配的记录
+ */
+class FilteredVectorExecutor : public VectorExecutor {
+   public:
+    using VectorExecutor::VectorExecutor;
+
+    bool push_runtime_filter(std::shared_ptr<const RuntimeFilter> filter) override {
+        filter_ = std::move(filter);
+        pushes_ += filter_ != nullptr;
+        return true;
+    }
+
+    bool NextBatch(RowBatch &batch) override {
+        while (VectorExecutor::NextBatch(batch)) {
+            if (filter_ != nullptr) {
+                filter_->filter(batch);
+            }
+            if (!batch.empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::shared_ptr<const RuntimeFilter> filter_;
+    int pushes_ = 0;    // 收到的过滤器个数
+};
+
+static std::vector<std::pair<int, int>> RandomRows(std::default_random_engine &rng, size_t n, int max_key) {
+    std::uniform_int_distribution<int> dist(0, max_key);
+    std::vector<std::pair<int, int>> rows;
+    for (size_t i = 0; i < n; i++) {
+        rows.emplace_back(dist(rng), static_cast<int>(i));
+    }
+    return rows;
+}
+
+// 批量执行并把连接结果整理为有序的(左val, 右val)
+static std::vector<std::pair<int, int>> Collect(AbstractExecutor *exec) {
+    std::vector<std::pair<int, int>> res;
+    RowBatch batch;
+    for (exec->beginBatch(); exec->NextBatch(batch);) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            int left_val, right_val;
+            memcpy(&left_val, batch.row(i) + 4, sizeof(int));
+            memcpy(&right_val, batch.row(i) + 12, sizeof(int));
+            res.emplace_back(left_val, right_val);
+        }
+    }
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+static std::vector<Condition> KeyCondition(CompOp val_op) {
+    Condition key_eq{{"l", "key"}, OP_EQ, false, {"r", "key"}, {}};
+    Condition val_cmp{{"r", "val"}, val_op, false, {"l", "val"}, {}};
+    return {key_eq, val_cmp};
+}
+
+/**
+ * @brief 与块嵌套循环连接比较结果，内存预算足够时在内存中连接，预算很小时写入分区连接；
+ *        左右两侧分别作为较小的一侧，连接条件的字段可以写在任意一侧，并带有一个非等值条件
+ */
+TEST(HashJoinTest, MatchesNestedLoopJoin) {
+    std::default_random_engine rng(2023);
+    for (size_t budget : {HASH_JOIN_MEMORY_BUDGET, size_t(256)}) {
+        for (auto sizes : {std::make_pair(300, 3000), std::make_pair(3000, 300), std::make_pair(0, 100)}) {
+            auto left_rows = RandomRows(rng, sizes.first, 200);
+            auto right_rows = RandomRows(rng, sizes.second, 200);
+            HashJoinExecutor hash_join(std::make_unique<VectorExecutor>("l", left_rows),
+                                       std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_GT),
+                                       budget);
+            NestedLoopJoinExecutor nested_loop(std::make_unique<VectorExecutor>("l", left_rows),
+                                               std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_GT));
+            auto expected = Collect(&nested_loop);
+            ASSERT_EQ(Collect(&hash_join), expected) << "budget=" << budget << " left=" << sizes.first;
+            ASSERT_EQ(hash_join.spilled_, budget != HASH_JOIN_MEMORY_BUDGET && sizes.first != 0);
+        }
+    }
+}
+
+/**
+ * @brief 读入的记录超过语句的内存上限时与超过预算一样写入分区，结果不变；
+ *        上限小到放不下一个分区的hash表时抛出QueryMemoryLimitError，析构后归还全部内存
+ */
+TEST(HashJoinTest, QueryMemoryLimit) {
+    std::default_random_engine rng(2025);
+    auto left_rows = RandomRows(rng, 3000, 200);
+    auto right_rows = RandomRows(rng, 3000, 200);
+    NestedLoopJoinExecutor nested_loop(std::make_unique<VectorExecutor>("l", left_rows),
+                                       std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_GT));
+    auto expected = Collect(&nested_loop);
+    MemoryTracker tracker(16 * 1024);
+    {
+        HashJoinExecutor hash_join(std::make_unique<VectorExecutor>("l", left_rows),
+                                   std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_GT),
+                                   HASH_JOIN_MEMORY_BUDGET, &tracker);
+        ASSERT_EQ(Collect(&hash_join), expected);
+        EXPECT_TRUE(hash_join.spilled_);
+        EXPECT_LE(tracker.peak(), tracker.limit());
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+
+    tracker.set_limit(1024);
+    {
+        HashJoinExecutor hash_join(std::make_unique<VectorExecutor>("l", left_rows),
+                                   std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_GT),
+                                   HASH_JOIN_MEMORY_BUDGET, &tracker);
+        EXPECT_THROW(Collect(&hash_join), QueryMemoryLimitError);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+}
+
+/**
+ * @brief 逐条执行的结果与批量执行相同
+ */
+TEST(HashJoinTest, TupleInterface) {
+    std::default_random_engine rng(2024);
+    auto left_rows = RandomRows(rng, 2000, 50);
+    auto right_rows = RandomRows(rng, 100, 50);
+    HashJoinExecutor hash_join(std::make_unique<VectorExecutor>("l", left_rows),
+                               std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_NE));
+    auto expected = Collect(&hash_join);
+    std::vector<std::pair<int, int>> res;
+    for (hash_join.beginTuple(); !hash_join.is_end(); hash_join.nextTuple()) {
+        auto rec = hash_join.Next();
+        res.emplace_back(*reinterpret_cast<int *>(rec->data + 4), *reinterpret_cast<int *>(rec->data + 12));
+    }
+    std::sort(res.begin(), res.end());
+    EXPECT_GT(res.size(), 2000u);
+    EXPECT_EQ(res, expected);
+}
+
+/**
+ * @brief build侧较小时生成运行时过滤器下推到probe侧，probe侧大部分没有匹配的记录在输出前被丢弃，连接结果不变；
+ *        重新执行时撤销旧的过滤器再下推新的，写入分区的连接不下推
+ */
+TEST(HashJoinTest, RuntimeFilter) {
+    std::default_random_engine rng(2026);
+    auto left_rows = RandomRows(rng, 50, 100000);
+    auto right_rows = RandomRows(rng, 20000, 100000);
+    // 保证有匹配的记录
+    for (size_t i = 0; i < left_rows.size(); i++) {
+        right_rows[i * 100].first = left_rows[i].first;
+    }
+    auto right = std::make_unique<FilteredVectorExecutor>("r", right_rows);
+    FilteredVectorExecutor *right_ptr = right.get();
+    HashJoinExecutor hash_join(std::make_unique<FilteredVectorExecutor>("l", left_rows), std::move(right),
+                               KeyCondition(OP_NE));
+    NestedLoopJoinExecutor nested_loop(std::make_unique<VectorExecutor>("l", left_rows),
+                                       std::make_unique<VectorExecutor>("r", right_rows), KeyCondition(OP_NE));
+    auto expected = Collect(&nested_loop);
+    EXPECT_GE(expected.size(), left_rows.size());
+    for (int round = 1; round <= 2; round++) {
+        uint64_t drops = EngineMetrics::get().join_filter_drops.value();
+        ASSERT_EQ(Collect(&hash_join), expected);
+        EXPECT_TRUE(hash_join.build_left_);
+        EXPECT_EQ(right_ptr->pushes_, round);
+        // 建立hash表之前读入的probe侧记录没有经过过滤器
+        EXPECT_GT(EngineMetrics::get().join_filter_drops.value() - drops, right_rows.size() / 2);
+    }
+
+    HashJoinExecutor spilled(std::make_unique<FilteredVectorExecutor>("l", right_rows),
+                             std::make_unique<FilteredVectorExecutor>("r", right_rows), KeyCondition(OP_NE), 256);
+    Collect(&spilled);
+    EXPECT_TRUE(spilled.spilled_);
+    EXPECT_EQ(static_cast<FilteredVectorExecutor *>(spilled.right_.get())->filter_, nullptr);
+}
+
+/**
+ * @brief 左表块很小(每块一个批次)时与一整块缓存全部左表记录时结果相同，逐条执行与批量执行结果相同，
+ *        并且右表只在每个左表块开始时重新扫描
+ */
+TEST(NestedLoopJoinTest, BlockSizes) {
+    std::default_random_engine rng(2025);
+    auto left_rows = RandomRows(rng, 5000, 300);
+    auto right_rows = RandomRows(rng, 700, 300);
+    auto right = std::make_unique<VectorExecutor>("r", right_rows);
+    VectorExecutor *right_ptr = right.get();
+    NestedLoopJoinExecutor one_block(std::make_unique<VectorExecutor>("l", left_rows), std::move(right),
+                                     KeyCondition(OP_LT));
+    auto expected = Collect(&one_block);
+    EXPECT_EQ(right_ptr->scans_, 1);
+    EXPECT_FALSE(expected.empty());
+
+    right = std::make_unique<VectorExecutor>("r", right_rows);
+    right_ptr = right.get();
+    NestedLoopJoinExecutor small_blocks(std::make_unique<VectorExecutor>("l", left_rows), std::move(right),
+                                        KeyCondition(OP_LT), 1);
+    EXPECT_EQ(Collect(&small_blocks), expected);
+    EXPECT_EQ(right_ptr->scans_, static_cast<int>((left_rows.size() + ROW_BATCH_SIZE - 1) / ROW_BATCH_SIZE));
+
+    std::vector<std::pair<int, int>> res;
+    for (small_blocks.beginTuple(); !small_blocks.is_end(); small_blocks.nextTuple()) {
+        auto rec = small_blocks.Next();
+        res.emplace_back(*reinterpret_cast<int *>(rec->data + 4), *reinterpret_cast<int *>(rec->data + 12));
+    }
+    std::sort(res.begin(), res.end());
+    EXPECT_EQ(res, expected);
+}
+
+/**
+ * @brief 两侧按key升序输入时，各运算符的归并条件(另带一个非等值条件)与块嵌套循环连接结果相同，
+ *        等值连接时右表缓冲区只保留少量记录
+ */
+TEST(MergeJoinTest, MatchesNestedLoopJoin) {
+    std::default_random_engine rng(2026);
+    for (CompOp op : {OP_EQ, OP_LT, OP_LE, OP_GT, OP_GE}) {
+        for (auto sizes : {std::make_pair(400, 3000), std::make_pair(3000, 400), std::make_pair(0, 100),
+                           std::make_pair(100, 0)}) {
+            auto left_rows = RandomRows(rng, sizes.first, op == OP_EQ ? 2000 : 200);
+            auto right_rows = RandomRows(rng, sizes.second, op == OP_EQ ? 2000 : 200);
+            std::sort(left_rows.begin(), left_rows.end());
+            std::sort(right_rows.begin(), right_rows.end());
+            std::vector<Condition> conds = {{{"l", "key"}, op, false, {"r", "key"}, {}},
+                                            {{"r", "val"}, OP_NE, false, {"l", "val"}, {}}};
+            MergeJoinExecutor merge_join(std::make_unique<VectorExecutor>("l", left_rows),
+                                         std::make_unique<VectorExecutor>("r", right_rows), conds);
+            NestedLoopJoinExecutor nested_loop(std::make_unique<VectorExecutor>("l", left_rows),
+                                               std::make_unique<VectorExecutor>("r", right_rows), conds);
+            auto expected = Collect(&nested_loop);
+            ASSERT_EQ(Collect(&merge_join), expected) << "op=" << op << " left=" << sizes.first;
+            if (op == OP_EQ) {
+                EXPECT_LE(merge_join.right_count_, 3 * ROW_BATCH_SIZE);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 逐条执行的结果与批量执行相同
+ */
+TEST(MergeJoinTest, TupleInterface) {
+    std::default_random_engine rng(2027);
+    auto left_rows = RandomRows(rng, 2000, 50);
+    auto right_rows = RandomRows(rng, 300, 50);
+    std::sort(left_rows.begin(), left_rows.end());
+    std::sort(right_rows.begin(), right_rows.end());
+    MergeJoinExecutor merge_join(std::make_unique<VectorExecutor>("l", left_rows),
+                                 std::make_unique<VectorExecutor>("r", right_rows),
+                                 {{{"l", "key"}, OP_EQ, false, {"r", "key"}, {}}});
+    auto expected = Collect(&merge_join);
+    std::vector<std::pair<int, int>> res;
+    for (merge_join.beginTuple(); !merge_join.is_end(); merge_join.nextTuple()) {
+        auto rec = merge_join.Next();
+        res.emplace_back(*reinterpret_cast<int *>(rec->data + 4), *reinterpret_cast<int *>(rec->data + 12));
+    }
+    std::sort(res.begin(), res.end());
+    EXPECT_GT(res.size(), 2000u);
+    EXPECT_EQ(res, expected);
+}
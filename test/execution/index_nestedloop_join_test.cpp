@@ -0,0 +1,211 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/executor_index_nestedloop_join.h"
+#include "execution/executor_nestedloop_join.h"
+#include "execution/executor_seq_scan.h"
+
+namespace {
+
+const std::string DB_NAME = "index_nestedloop_join_test_db";
+
+// 表的记录为(a INT, b INT, c CHAR(8))
+constexpr int RECORD_SIZE = 16;
+
+// 外表l的第i条记录为((i + 10) % 15, i, "l<i>")，第0条记录的a在内表中没有匹配
+constexpr int OUTER_ROWS = 300;
+// 内表r的第j条记录为(j % 10, j, "r<j>")，每个a有4条记录
+constexpr int INNER_ROWS = 40;
+
+using Rows = std::vector<std::string>;
+
+std::string MakeRecord(int a, int b, const std::string &c) {
+    char rec[RECORD_SIZE] = {};
+    memcpy(rec, &a, sizeof(int));
+    memcpy(rec + 4, &b, sizeof(int));
+    snprintf(rec + 8, 8, "%s", c.c_str());
+    return std::string(rec, RECORD_SIZE);
+}
+
+std::string OuterRecord(int i) { return MakeRecord((i + 10) % 15, i, "l" + std::to_string(i)); }
+
+std::string InnerRecord(int j) { return MakeRecord(j % 10, j, "r" + std::to_string(j)); }
+
+Condition ColCondition(const std::string &lhs, CompOp op, const std::string &rhs) {
+    return Condition{{"l", lhs}, op, false, {"r", rhs}, {}};
+}
+
+Condition ValueCondition(const std::string &tab, const std::string &col, CompOp op, int v) {
+    Condition cond;
+    cond.lhs_col = TabCol{tab, col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_int(v);
+    cond.rhs_val.init_raw(sizeof(int));
+    return cond;
+}
+
+Rows RowPath(AbstractExecutor *exec) {
+    Rows rows;
+    for (exec->beginTuple(); !exec->is_end(); exec->nextTuple()) {
+        rows.emplace_back(exec->Next()->data, exec->tupleLen());
+    }
+    return rows;
+}
+
+Rows BatchPath(AbstractExecutor *exec, size_t capacity) {
+    Rows rows;
+    RowBatch batch(capacity);
+    for (exec->beginBatch(); exec->NextBatch(batch);) {
+        EXPECT_LE(batch.size(), batch.capacity());
+        for (size_t i = 0; i < batch.size(); i++) {
+            rows.emplace_back(batch.row(i), exec->tupleLen());
+        }
+    }
+    return rows;
+}
+
+Rows Sorted(Rows rows) {
+    std::sort(rows.begin(), rows.end());
+    return rows;
+}
+
+class IndexNestedLoopJoinTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+
+        std::vector<ColDef> col_defs = {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_STRING, 8}};
+        sm_manager_->create_table("l", col_defs, nullptr);
+        sm_manager_->create_table("r", col_defs, nullptr);
+        for (int i = 0; i < OUTER_ROWS; i++) {
+            sm_manager_->get_table_handle("l").fh->insert_record(OuterRecord(i).data(), &context_);
+        }
+        for (int j = 0; j < INNER_ROWS; j++) {
+            sm_manager_->get_table_handle("r").fh->insert_record(InnerRecord(j).data(), &context_);
+        }
+        // 内表的复合索引，只有a上的连接条件时按前缀查找
+        sm_manager_->create_index("r", {"a", "b"}, nullptr);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    std::unique_ptr<AbstractExecutor> seq_scan(const std::string &tab_name) {
+        return std::make_unique<SeqScanExecutor>(sm_manager_.get(), sm_manager_->get_table_handle(tab_name),
+                                                 std::vector<Condition>{}, &context_);
+    }
+
+    std::unique_ptr<AbstractExecutor> index_join(std::vector<Condition> conds, std::vector<Condition> inner_conds = {}) {
+        auto &table = sm_manager_->get_table_handle("r");
+        int index_id = table.tab->get_index_meta({"a", "b"})->id;
+        return std::make_unique<IndexNestedLoopJoinExecutor>(sm_manager_.get(), seq_scan("l"), table,
+                                                             std::move(inner_conds), index_id, std::move(conds),
+                                                             &context_);
+    }
+
+    // 与块嵌套循环连接比较，并检查逐条执行和各种容量的批量执行结果相同
+    void check(const std::vector<Condition> &conds, const std::vector<Condition> &inner_conds, size_t expected_rows) {
+        std::vector<Condition> all_conds = conds;
+        all_conds.insert(all_conds.end(), inner_conds.begin(), inner_conds.end());
+        NestedLoopJoinExecutor nested_loop(seq_scan("l"), seq_scan("r"), all_conds);
+        auto expected = Sorted(RowPath(&nested_loop));
+        ASSERT_EQ(expected.size(), expected_rows);
+        ASSERT_EQ(Sorted(RowPath(index_join(conds, inner_conds).get())), expected);
+        for (size_t capacity : {size_t(1), size_t(3), ROW_BATCH_SIZE}) {
+            ASSERT_EQ(Sorted(BatchPath(index_join(conds, inner_conds).get(), capacity)), expected)
+                << "capacity=" << capacity;
+        }
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    Context context_{nullptr, nullptr, nullptr};
+};
+
+}  // namespace
+
+/**
+ * @brief 只有索引第一个字段上的连接条件时按前缀查找：内表每个key有4条记录，全部输出；
+ *        外表中a为10~14的记录(包括第一条)没有匹配，不输出
+ */
+TEST_F(IndexNestedLoopJoinTest, PrefixProbeWithDuplicateKeys) {
+    auto join = index_join({ColCondition("a", OP_EQ, "a")});
+    auto rows = RowPath(join.get());
+    // 每个外表key在[0, 10)内的记录匹配4条内表记录
+    ASSERT_EQ(rows.size(), static_cast<size_t>(OUTER_ROWS / 15 * 10 * 4));
+    for (auto &row : rows) {
+        int outer_b, inner_a, inner_b;
+        memcpy(&outer_b, row.data() + 4, sizeof(int));
+        memcpy(&inner_a, row.data() + RECORD_SIZE, sizeof(int));
+        memcpy(&inner_b, row.data() + RECORD_SIZE + 4, sizeof(int));
+        ASSERT_EQ(row.substr(0, RECORD_SIZE), OuterRecord(outer_b));
+        ASSERT_EQ(row.substr(RECORD_SIZE), InnerRecord(inner_b));
+        ASSERT_LT(inner_a, 10);
+    }
+    check({ColCondition("a", OP_EQ, "a")}, {}, OUTER_ROWS / 15 * 10 * 4);
+}
+
+/**
+ * @brief 连接条件覆盖全部索引字段时批量查找整批key，外表记录最多匹配一条内表记录
+ */
+TEST_F(IndexNestedLoopJoinTest, FullKeyProbe) {
+    // l.b = r.b只对b < 40有匹配，且需要(i + 10) % 15 == i % 10
+    size_t expected = 0;
+    for (int i = 0; i < INNER_ROWS; i++) {
+        expected += (i + 10) % 15 == i % 10;
+    }
+    ASSERT_GT(expected, 0u);
+    check({ColCondition("a", OP_EQ, "a"), ColCondition("b", OP_EQ, "b")}, {}, expected);
+}
+
+/**
+ * @brief 不用于查找的连接条件和内表自身的扫描条件在连接后的记录上求值
+ */
+TEST_F(IndexNestedLoopJoinTest, ResidualConditions) {
+    std::vector<Condition> conds = {ColCondition("a", OP_EQ, "a"), ColCondition("b", OP_LT, "b")};
+    std::vector<Condition> inner_conds = {ValueCondition("r", "b", OP_GE, 20)};
+    size_t expected = 0;
+    for (int i = 0; i < OUTER_ROWS; i++) {
+        for (int j = 20; j < INNER_ROWS; j++) {
+            expected += (i + 10) % 15 == j % 10 && i < j;
+        }
+    }
+    ASSERT_GT(expected, 0u);
+    check(conds, inner_conds, expected);
+}
+
+/**
+ * @brief 外表为空，或者所有外表记录都没有匹配时没有输出
+ */
+TEST_F(IndexNestedLoopJoinTest, NoMatches) {
+    check({ColCondition("a", OP_EQ, "a")}, {ValueCondition("r", "a", OP_GT, 100)}, 0);
+    sm_manager_->create_table("e", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_STRING, 8}}, nullptr);
+    auto &table = sm_manager_->get_table_handle("r");
+    IndexNestedLoopJoinExecutor join(sm_manager_.get(), seq_scan("e"), table, {},
+                                     table.tab->get_index_meta({"a", "b"})->id,
+                                     {Condition{{"e", "a"}, OP_EQ, false, {"r", "a"}, {}}}, &context_);
+    ASSERT_TRUE(RowPath(&join).empty());
+    ASSERT_TRUE(BatchPath(&join, ROW_BATCH_SIZE).empty());
+}
@@ -0,0 +1,174 @@
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/execution_pax_scan.h"
+
+namespace {
+
+// 表t(a INT, b CHAR(8), c FLOAT, d INT)，每个字段一个minipage
+std::vector<ColMeta> TableCols() {
+    return {{"t", "a", TYPE_INT, 4, 0, false},
+            {"t", "b", TYPE_STRING, 8, 4, false},
+            {"t", "c", TYPE_FLOAT, 4, 12, false},
+            {"t", "d", TYPE_INT, 4, 16, false}};
+}
+
+constexpr int RECORD_SIZE = 20;
+
+Condition ValueCondition(const std::string &col, CompOp op, int v) {
+    Condition cond;
+    cond.lhs_col = TabCol{"t", col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_int(v);
+    cond.rhs_val.init_raw(sizeof(int));
+    return cond;
+}
+
+Condition ValueCondition(const std::string &col, CompOp op, float v) {
+    Condition cond;
+    cond.lhs_col = TabCol{"t", col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_float(v);
+    cond.rhs_val.init_raw(sizeof(float));
+    return cond;
+}
+
+// 按rid排序的输出记录
+using Rows = std::map<std::pair<int, int>, std::string>;
+
+Condition ValueCondition(const std::string &col, CompOp op, const std::string &v) {
+    Condition cond;
+    cond.lhs_col = TabCol{"t", col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_str(v);
+    cond.rhs_val.init_raw(8);
+    return cond;
+}
+
+// 用PaxBatchScan扫描整张表，压缩页缓存中的页面直接读取编码结果
+Rows PaxScan(const RmFileHandle *file_handle, ConditionFilter filter, const ColumnProjector &projector) {
+    Rows rows;
+    RmScan scan(file_handle, RM_FIRST_RECORD_PAGE, -1, true);
+    PaxBatchScan pax(&scan, RECORD_SIZE);
+    RowBatch batch(100);
+    while (pax.next(filter, projector, batch)) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto key = std::make_pair(batch.rid(i).page_no, batch.rid(i).slot_no);
+            EXPECT_EQ(rows.count(key), 0u);
+            rows[key] = std::string(batch.row(i), projector.len());
+        }
+    }
+    return rows;
+}
+
+// 逐条读取记录、求值条件再投影，作为期望的结果
+Rows RowScan(const RmFileHandle *file_handle, const ConditionFilter &filter, const ColumnProjector &projector) {
+    Rows rows;
+    std::vector<char> out(projector.len());
+    for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+        if (filter.eval(scan.record())) {
+            projector.project(scan.record(), out.data());
+            rows[std::make_pair(scan.rid().page_no, scan.rid().slot_no)] = std::string(out.data(), out.size());
+        }
+    }
+    return rows;
+}
+
+/**
+ * @description: 建表、插入并删除部分记录后，对各组条件和投影比较PaxBatchScan与逐条求值的结果
+ * @param {bool} compressed 是否压缩：a、d使用frame-of-reference，b使用字典，缓冲池很小，大部分页面在压缩页缓存中
+ */
+void CheckMatchesRowScan(bool compressed) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager =
+        std::make_unique<BufferPoolManager>(compressed ? 8 : BUFFER_POOL_SIZE, disk_manager.get(), 1);
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    std::string filename = "pax_scan.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    std::vector<RmMinipage> minipages;
+    for (auto &col : TableCols()) {
+        RmMinipage mp{static_cast<uint16_t>(col.offset), static_cast<uint16_t>(col.len)};
+        if (compressed && col.type != TYPE_FLOAT) {
+            mp.encoding = col.type == TYPE_INT ? RM_ENCODING_FOR : RM_ENCODING_DICT;
+        }
+        minipages.push_back(mp);
+    }
+    rm_manager->create_file(filename, RECORD_SIZE, {}, minipages);
+    auto file_handle = rm_manager->open_file(filename);
+    Context context(nullptr, nullptr, nullptr);
+
+    std::default_random_engine rng(11);
+    std::uniform_int_distribution<int> dist(0, 99);
+    std::vector<Rid> rids;
+    for (int i = 0; i < 5000; i++) {
+        char rec[RECORD_SIZE] = {};
+        int a = dist(rng), d = dist(rng);
+        float c = static_cast<float>(dist(rng)) / 4;
+        memcpy(rec, &a, 4);
+        // 压缩时b只有少数几种取值，字典编码才有效
+        snprintf(rec + 4, 8, "s%06d", compressed ? i % 6 : i);
+        memcpy(rec + 12, &c, 4);
+        memcpy(rec + 16, &d, 4);
+        rids.push_back(file_handle->insert_record(rec, &context));
+    }
+    for (size_t i = 0; i < rids.size(); i += 3) {
+        file_handle->delete_record(rids[i], &context);
+    }
+    ASSERT_GT(file_handle->get_file_hdr().num_pages, 5);
+    if (compressed) {
+        ASSERT_GT(buffer_pool_manager->get_compressed_bytes(), 0u);
+    }
+
+    auto cols = TableCols();
+    std::vector<std::vector<Condition>> cond_sets = {
+        {},
+        {ValueCondition("a", OP_LT, 30)},
+        {ValueCondition("a", OP_GE, 10), ValueCondition("c", OP_LT, 12.5f)},
+        {ValueCondition("d", OP_EQ, 1000)},
+        {ValueCondition("d", OP_GT, -5)},
+        {ValueCondition("b", OP_EQ, std::string("s000004"))},
+        {ValueCondition("b", OP_LE, std::string("s000002")), ValueCondition("d", OP_NE, 7)},
+    };
+    // 字段与字段比较的条件需要完整的记录
+    Condition residual;
+    residual.lhs_col = TabCol{"t", "a"};
+    residual.op = OP_GT;
+    residual.is_rhs_val = false;
+    residual.rhs_col = TabCol{"t", "d"};
+    cond_sets.push_back({ValueCondition("c", OP_GE, 5.0f), residual});
+
+    for (auto &conds : cond_sets) {
+        ConditionFilter filter(cols, conds);
+        for (auto &proj : std::vector<std::vector<std::string>>{{}, {"d", "b"}, {"c"}}) {
+            ColumnProjector projector(cols, proj);
+            Rows actual = PaxScan(file_handle.get(), filter, projector);
+            Rows expected = RowScan(file_handle.get(), filter, projector);
+            EXPECT_EQ(actual, expected) << "conds=" << conds.size() << " proj=" << proj.size();
+        }
+    }
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+}  // namespace
+
+/**
+ * @brief PAX格式的表按页面扫描：直接在minipage上过滤、只取出需要的字段，结果与逐条求值相同；
+ *        批次小于页面中满足条件的记录数时，页面中剩余的记录在之后的批次中输出
+ */
+TEST(PaxScanTest, MatchesRowScan) { CheckMatchesRowScan(false); }
+
+/**
+ * @brief 压缩的PAX表：压缩页缓存中的页面在编码后的数据上过滤，常量超出页面取值范围的条件整页求值，
+ *        结果与解码后逐条求值相同
+ */
+TEST(PaxScanTest, CompressedMatchesRowScan) { CheckMatchesRowScan(true); }
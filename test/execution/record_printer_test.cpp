@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include "record_printer.h"
+
+// 支持流式发送时，结果写满缓冲区后按完整的行发送，不会被截断
+TEST(RecordPrinterTest, StreamsWithoutTruncation) {
+    char data_send[BUFFER_LENGTH];
+    int offset = 0;
+    Context context(nullptr, nullptr, nullptr, data_send, &offset);
+    std::vector<std::string> frames;
+    context.send_result_ = [&frames](const char *data, size_t len) { frames.emplace_back(data, len); };
+
+    RecordPrinter printer(2);
+    size_t num_rec = 1000;
+    for (size_t i = 0; i < num_rec; i++) {
+        printer.print_record({std::to_string(i), "x"}, &context);
+    }
+    RecordPrinter::print_record_count(num_rec, &context);
+    context.flush_result();
+
+    EXPECT_FALSE(context.ellipsis_);
+    EXPECT_GT(frames.size(), 1);
+    std::string result;
+    for (auto &frame : frames) {
+        EXPECT_LE(frame.size(), BUFFER_LENGTH);
+        EXPECT_EQ(frame.back(), '\n');
+        result += frame;
+    }
+    EXPECT_EQ(std::count(result.begin(), result.end(), '\n'), num_rec + 1);
+    EXPECT_NE(result.find("Total record(s): 1000"), std::string::npos);
+}
+
+// 不支持流式发送时，超出缓冲区的结果被截断并输出省略号
+TEST(RecordPrinterTest, TruncatesWithoutStreaming) {
+    char data_send[BUFFER_LENGTH];
+    int offset = 0;
+    Context context(nullptr, nullptr, nullptr, data_send, &offset);
+
+    RecordPrinter printer(2);
+    for (size_t i = 0; i < 1000; i++) {
+        printer.print_record({std::to_string(i), "x"}, &context);
+    }
+    RecordPrinter::print_record_count(1000, &context);
+
+    EXPECT_TRUE(context.ellipsis_);
+    EXPECT_LT(offset, BUFFER_LENGTH);
+    EXPECT_NE(std::string(data_send, offset).find("... ..."), std::string::npos);
+}
+
+// 二进制结果：表头、每条记录的小端序值和以长度为前缀的字符串、记录数
+TEST(RecordPrinterTest, BinaryFormat) {
+    char data_send[BUFFER_LENGTH];
+    int offset = 0;
+    Context context(nullptr, nullptr, nullptr, data_send, &offset);
+    std::string result;
+    context.send_result_ = [&result](const char *data, size_t len) { result.append(data, len); };
+
+    std::vector<ColMeta> cols = {{.tab_name = "t", .name = "a", .type = TYPE_INT, .len = 4, .offset = 0},
+                                 {.tab_name = "t", .name = "b", .type = TYPE_FLOAT, .len = 4, .offset = 4},
+                                 {.tab_name = "t", .name = "c", .type = TYPE_STRING, .len = 8, .offset = 8}};
+    BinaryRecordPrinter printer(cols);
+    printer.print_header({"a", "b", "c"}, &context);
+    char tuple[16] = {};
+    int a = -2;
+    float b = 1.5;
+    memcpy(tuple, &a, 4);
+    memcpy(tuple + 4, &b, 4);
+    memcpy(tuple + 8, "xyz", 3);
+    printer.print_record(tuple, &context);
+    printer.print_footer(1, &context);
+    context.flush_result();
+
+    std::string expected;
+    expected += '\xB1';
+    expected += std::string("\x03\x00\x00\x00", 4);
+    for (int i = 0; i < 3; i++) {
+        expected += static_cast<char>(cols[i].type);
+        expected += std::string("\x01\x00\x00\x00", 4) + cols[i].name;
+    }
+    expected += '\x01';
+    expected += std::string("\xFE\xFF\xFF\xFF", 4);
+    expected += std::string("\x00\x00\xC0\x3F", 4);
+    expected += std::string("\x03\x00\x00\x00", 4) + "xyz";
+    expected += '\x00';
+    expected += std::string("\x01\x00\x00\x00\x00\x00\x00\x00", 8);
+    EXPECT_EQ(result, expected);
+}
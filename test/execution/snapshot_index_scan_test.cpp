@@ -0,0 +1,222 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/executor_count_star.h"
+#include "execution/executor_delete.h"
+#include "execution/executor_index_nestedloop_join.h"
+#include "execution/executor_index_scan.h"
+#include "execution/executor_insert.h"
+#include "execution/executor_seq_scan.h"
+#include "execution/executor_update.h"
+
+namespace {
+
+const std::string DB_NAME = "snapshot_index_scan_test_db";
+
+// 表t的第i条记录为(2 * i, i)，a上有索引
+constexpr int ROWS = 200;
+
+using Rows = std::vector<std::pair<int, int>>;
+
+Condition ValueCondition(const std::string &col, CompOp op, int v) {
+    Condition cond;
+    cond.lhs_col = TabCol{"t", col};
+    cond.op = op;
+    cond.is_rhs_val = true;
+    cond.rhs_val.set_int(v);
+    cond.rhs_val.init_raw(sizeof(int));
+    return cond;
+}
+
+Value IntValue(int v) {
+    Value value;
+    value.set_int(v);
+    return value;
+}
+
+// 快照中表t的记录，a在[lo, hi]中，按a排序
+Rows Original(int lo, int hi) {
+    Rows rows;
+    for (int i = 0; i < ROWS; i++) {
+        if (2 * i >= lo && 2 * i <= hi) {
+            rows.emplace_back(2 * i, i);
+        }
+    }
+    return rows;
+}
+
+Rows Collect(AbstractExecutor *exec, size_t offset = 0) {
+    Rows rows;
+    for (exec->beginTuple(); !exec->is_end(); exec->nextTuple()) {
+        auto rec = exec->Next();
+        int a, b;
+        memcpy(&a, rec->data + offset, sizeof(int));
+        memcpy(&b, rec->data + offset + sizeof(int), sizeof(int));
+        rows.emplace_back(a, b);
+    }
+    return rows;
+}
+
+/*
+读取者的快照开始之后，另一个尚未提交的事务删除记录、修改索引key、只修改其他字段并插入记录，
+修改通过DML算子写入堆表、索引和VersionStore。通过索引访问表的算子仍然输出快照中的记录
+*/
+class SnapshotIndexScanTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+
+        std::vector<ColDef> col_defs = {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}};
+        sm_manager_->create_table("t", col_defs, nullptr);
+        sm_manager_->create_table("o", col_defs, nullptr);
+        Context context(nullptr, nullptr, nullptr);
+        for (int i = 0; i < ROWS; i++) {
+            int rec[2] = {2 * i, i};
+            rids_.push_back(table().fh->insert_record(reinterpret_cast<char *>(rec), &context));
+        }
+        sm_manager_->create_index("t", {"a"}, nullptr);
+
+        store_.open_snapshot(10);
+        reader_.set_start_ts(10);
+        reader_context_.version_store_ = &store_;
+        reader_context_.snapshot_read_ = true;
+        writer_context_.version_store_ = &store_;
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    const TableHandle &table() { return sm_manager_->get_table_handle("t"); }
+
+    int index_id() { return table().tab->get_index_meta({"a"})->id; }
+
+    // 写入者删除a=10，把a=20改为1001、a=30改为31，把a=40的b改为-1，并插入(11, -1)
+    void write() {
+        DeleteExecutor(sm_manager_.get(), table(), {}, {rids_[5]}, &writer_context_).Next();
+        UpdateExecutor(sm_manager_.get(), table(), {{{"t", "a"}, IntValue(1001)}}, {}, {rids_[10]},
+                       &writer_context_).Next();
+        UpdateExecutor(sm_manager_.get(), table(), {{{"t", "a"}, IntValue(31)}}, {}, {rids_[15]},
+                       &writer_context_).Next();
+        UpdateExecutor(sm_manager_.get(), table(), {{{"t", "b"}, IntValue(-1)}}, {}, {rids_[20]},
+                       &writer_context_).Next();
+        InsertExecutor(sm_manager_.get(), table(), {IntValue(11), IntValue(-1)}, &writer_context_).Next();
+    }
+
+    Rows index_scan(std::vector<Condition> conds, bool is_desc = false) {
+        IndexScanExecutor scan(sm_manager_.get(), table(), std::move(conds), index_id(), &reader_context_, is_desc);
+        return Collect(&scan);
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::vector<Rid> rids_;
+    VersionStore store_{false};
+    Transaction reader_{1};
+    Transaction writer_{2};
+    Context reader_context_{nullptr, nullptr, &reader_};
+    Context writer_context_{nullptr, nullptr, &writer_};
+};
+
+}  // namespace
+
+/**
+ * @brief 索引扫描按索引顺序输出快照中的记录，包括快照之后被删除和修改了key的记录，不输出之后插入的记录
+ */
+TEST_F(SnapshotIndexScanTest, IndexScan) {
+    write();
+    ASSERT_EQ(index_scan({}), Original(0, 2 * ROWS));
+    ASSERT_EQ(index_scan({ValueCondition("a", OP_GE, 10), ValueCondition("a", OP_LE, 40)}), Original(10, 40));
+
+    Rows desc = Original(0, 60);
+    std::reverse(desc.begin(), desc.end());
+    ASSERT_EQ(index_scan({ValueCondition("a", OP_LE, 60)}, true), desc);
+
+    // index-only模式只输出索引字段
+    IndexScanExecutor index_only(sm_manager_.get(), table(), {ValueCondition("a", OP_GE, 100)}, index_id(),
+                                 &reader_context_, false, {"a"}, true);
+    std::vector<int> keys;
+    for (index_only.beginTuple(); !index_only.is_end(); index_only.nextTuple()) {
+        int a;
+        memcpy(&a, index_only.Next()->data, sizeof(int));
+        keys.push_back(a);
+    }
+    std::vector<int> expected;
+    for (auto &row : Original(100, 2 * ROWS)) {
+        expected.push_back(row.first);
+    }
+    ASSERT_EQ(keys, expected);
+}
+
+/**
+ * @brief 写入者提交后开始的快照通过索引读到修改后的记录
+ */
+TEST_F(SnapshotIndexScanTest, LaterSnapshotSeesCommittedWrites) {
+    write();
+    store_.seal(&writer_, 20);
+    Transaction later(3);
+    later.set_start_ts(30);
+    reader_context_.txn_ = &later;
+    ASSERT_EQ(index_scan({ValueCondition("a", OP_GE, 10), ValueCondition("a", OP_LE, 40)}),
+              Rows({{11, -1}, {12, 6}, {14, 7}, {16, 8}, {18, 9}, {22, 11}, {24, 12}, {26, 13}, {28, 14},
+                    {31, 15}, {32, 16}, {34, 17}, {36, 18}, {38, 19}, {40, -1}}));
+    ASSERT_EQ(index_scan({ValueCondition("a", OP_EQ, 1001)}), Rows({{1001, 10}}));
+}
+
+/**
+ * @brief 索引嵌套循环连接按快照中的连接字段匹配内表记录
+ */
+TEST_F(SnapshotIndexScanTest, IndexNestedLoopJoin) {
+    Context context(nullptr, nullptr, nullptr);
+    for (int a : {10, 11, 20, 30, 31, 40, 1001}) {
+        int rec[2] = {a, 0};
+        sm_manager_->get_table_handle("o").fh->insert_record(reinterpret_cast<char *>(rec), &context);
+    }
+    write();
+    auto outer = std::make_unique<SeqScanExecutor>(sm_manager_.get(), sm_manager_->get_table_handle("o"),
+                                                   std::vector<Condition>{}, &reader_context_);
+    Condition cond{{"o", "a"}, OP_EQ, false, {"t", "a"}, {}};
+    IndexNestedLoopJoinExecutor join(sm_manager_.get(), std::move(outer), table(), {}, index_id(), {cond},
+                                     &reader_context_);
+    ASSERT_EQ(Collect(&join, 2 * sizeof(int)), Rows({{10, 5}, {20, 10}, {30, 15}, {40, 20}}));
+}
+
+/**
+ * @brief COUNT(*)按快照计数，不包含快照之后插入的记录，包含之后删除的记录
+ */
+TEST_F(SnapshotIndexScanTest, CountStar) {
+    write();
+    DeleteExecutor(sm_manager_.get(), table(), {}, {rids_[0], rids_[1]}, &writer_context_).Next();
+    std::vector<AggExpr> aggs = {{AGG_COUNT, {"t", "*"}, {"", "COUNT(*)"}}};
+    CountStarExecutor count(sm_manager_.get(), table(), aggs, &reader_context_);
+    count.beginTuple();
+    int n;
+    memcpy(&n, count.Next()->data, sizeof(int));
+    ASSERT_EQ(n, ROWS);
+
+    CountStarExecutor latest(sm_manager_.get(), table(), aggs, &writer_context_);
+    latest.beginTuple();
+    memcpy(&n, latest.Next()->data, sizeof(int));
+    ASSERT_EQ(n, ROWS - 2);
+}
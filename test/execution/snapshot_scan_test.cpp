@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "execution/execution_snapshot.h"
+
+/**
+ * @brief 快照扫描期间其他事务在扫描位置前后插入、更新、删除记录，快照中的每条记录恰好输出一次
+ */
+TEST(SnapshotScanTest, ConcurrentWriters) {
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    std::string filename = "snapshot_scan.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, sizeof(int));
+    auto file_handle = rm_manager->open_file(filename);
+    Context context(nullptr, nullptr, nullptr);
+
+    std::vector<Rid> rids;
+    for (int i = 0; i < 20000; i++) {
+        rids.push_back(file_handle->insert_record(reinterpret_cast<char *>(&i), &context));
+    }
+    ASSERT_GT(file_handle->get_file_hdr().num_pages, 10);
+
+    VersionStore store(false);
+    Transaction reader(1), writer(2);
+    store.open_snapshot(10);
+    VersionStore::Snapshot snapshot{reader.get_transaction_id(), 10};
+    SnapshotScan snapshot_scan(store.get_table(file_handle->GetFd()), snapshot, sizeof(int));
+
+    std::default_random_engine rng(7);
+    std::uniform_int_distribution<size_t> pick(0, rids.size() - 1);
+    std::vector<bool> deleted(rids.size(), false);
+    std::map<int, int> seen;
+    RmScan scan(file_handle.get());
+    snapshot_scan.begin(RM_FIRST_RECORD_PAGE);
+    RowBatch batch(64);
+    bool more = true;
+    while (more) {
+        batch.reset(sizeof(int));
+        more = snapshot_scan.fill(scan, batch);
+        for (size_t i = 0; i < batch.size(); i++) {
+            int v;
+            memcpy(&v, batch.row(i), sizeof(v));
+            seen[v]++;
+        }
+        // 在整张表上随机修改，包括扫描已经经过和尚未到达的页面
+        VersionStore::Writer versions(&store, &writer, 0, file_handle->GetFd(), sizeof(int));
+        for (int k = 0; k < 8; k++) {
+            size_t i = pick(rng);
+            if (deleted[i]) {
+                continue;
+            }
+            auto rec = file_handle->get_record(rids[i], &context);
+            if (k % 2 == 0) {
+                versions.remove(rids[i], rec->data);
+                file_handle->delete_record(rids[i], &context);
+                deleted[i] = true;
+            } else {
+                int v = -1;
+                versions.update(rids[i], rec->data, reinterpret_cast<char *>(&v));
+                file_handle->update_record(rids[i], reinterpret_cast<char *>(&v), &context);
+            }
+        }
+        int v = -2;
+        versions.insert(file_handle->insert_record(reinterpret_cast<char *>(&v), &context));
+    }
+
+    ASSERT_EQ(seen.size(), rids.size());
+    for (int i = 0; i < static_cast<int>(rids.size()); i++) {
+        ASSERT_EQ(seen[i], 1) << i;
+    }
+    ASSERT_GT(std::count(deleted.begin(), deleted.end(), true), 0);
+}
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "execution/execution_sort.h"
+#include "execution/executor_limit.h"
+#undef private  // for use private variables in SortExecutor
+
+/**
+ * @brief 从内存中的记录读取的算子，记录为(int key, int val)
+ */
+class VectorExecutor : public AbstractExecutor {
+   public:
+    explicit VectorExecutor(std::vector<std::pair<int, int>> rows) : rows_(std::move(rows)) {
+        cols_ = {{"t", "key", TYPE_INT, sizeof(int), 0, false}, {"t", "val", TYPE_INT, sizeof(int), 4, false}};
+    }
+
+    size_t tupleLen() const override { return 2 * sizeof(int); }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override { pos_ = 0; }
+
+    void nextTuple() override { pos_++; }
+
+    bool is_end() const override { return pos_ >= rows_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(tupleLen());
+        memcpy(rec->data, &rows_[pos_].first, sizeof(int));
+        memcpy(rec->data + sizeof(int), &rows_[pos_].second, sizeof(int));
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    std::vector<ColMeta> cols_;
+    std::vector<std::pair<int, int>> rows_;
+    size_t pos_ = 0;
+};
+
+static std::vector<std::pair<int, int>> RandomRows(size_t n, int max_key) {
+    std::default_random_engine rng(n);
+    std::uniform_int_distribution<int> dist(0, max_key);
+    std::vector<std::pair<int, int>> rows;
+    for (size_t i = 0; i < n; i++) {
+        rows.emplace_back(dist(rng), static_cast<int>(i));
+    }
+    return rows;
+}
+
+// 逐条读出排序结果
+static std::vector<std::pair<int, int>> Collect(SortExecutor *sort) {
+    std::vector<std::pair<int, int>> res;
+    for (sort->beginTuple(); !sort->is_end(); sort->nextTuple()) {
+        auto rec = sort->Next();
+        res.emplace_back(*reinterpret_cast<int *>(rec->data), *reinterpret_cast<int *>(rec->data + 4));
+    }
+    return res;
+}
+
+/**
+ * @brief 多个排序键分别为ASC/DESC，内存排序和写入很多个有序段的外部排序结果都与std::stable_sort相同
+ */
+TEST(SortTest, MultipleKeys) {
+    auto rows = RandomRows(20000, 100);
+    auto expected = rows;
+    std::stable_sort(expected.begin(), expected.end(), [](auto &a, auto &b) {
+        return a.first != b.first ? a.first < b.first : a.second > b.second;
+    });
+    for (size_t budget : {SORT_MEMORY_BUDGET, size_t(8 * 1000), size_t(1)}) {
+        SortExecutor sort(std::make_unique<VectorExecutor>(rows), {{"t", "key"}, {"t", "val"}}, {false, true},
+                          budget);
+        ASSERT_EQ(Collect(&sort), expected) << "budget=" << budget;
+        EXPECT_EQ(sort.spilled_, budget != SORT_MEMORY_BUDGET);
+        // 再次执行得到相同的结果
+        ASSERT_EQ(Collect(&sort), expected) << "budget=" << budget;
+    }
+}
+
+/**
+ * @brief 只按key降序排序时外部排序也保持key相同的记录的输入顺序；批量执行与逐条执行结果相同
+ */
+TEST(SortTest, StableExternalSort) {
+    auto rows = RandomRows(5000, 10);
+    auto expected = rows;
+    std::stable_sort(expected.begin(), expected.end(), [](auto &a, auto &b) { return a.first > b.first; });
+    SortExecutor sort(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {true}, 8 * 300);
+    ASSERT_EQ(Collect(&sort), expected);
+    // 每读入一个批次就超过预算，每个批次写成一个有序段
+    EXPECT_EQ(sort.runs_.size(), (rows.size() + ROW_BATCH_SIZE - 1) / ROW_BATCH_SIZE);
+
+    std::vector<std::pair<int, int>> res;
+    RowBatch batch;
+    for (sort.beginBatch(); sort.NextBatch(batch);) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            res.emplace_back(*reinterpret_cast<const int *>(batch.row(i)),
+                             *reinterpret_cast<const int *>(batch.row(i) + 4));
+        }
+    }
+    EXPECT_EQ(res, expected);
+
+    SortExecutor empty(std::make_unique<VectorExecutor>(std::vector<std::pair<int, int>>()), {{"t", "key"}}, {true}, 1);
+    EXPECT_TRUE(Collect(&empty).empty());
+}
+
+/**
+ * @brief LIMIT的结果是完整排序结果的前N条：N条记录放得进内存预算时使用top-N模式，否则排序后截断
+ */
+TEST(SortTest, TopN) {
+    auto rows = RandomRows(10000, 300);
+    auto expected = rows;
+    std::stable_sort(expected.begin(), expected.end(), [](auto &a, auto &b) { return a.first > b.first; });
+    for (size_t limit : {size_t(0), size_t(1), size_t(20), size_t(5000), size_t(20000)}) {
+        auto prefix = std::vector<std::pair<int, int>>(expected.begin(),
+                                                       expected.begin() + std::min(limit, expected.size()));
+        SortExecutor top_n(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {true}, SORT_MEMORY_BUDGET, limit);
+        ASSERT_EQ(Collect(&top_n), prefix) << "limit=" << limit;
+        EXPECT_FALSE(top_n.spilled_);
+        EXPECT_LE(top_n.tuples_.size(), limit * 8);
+
+        SortExecutor external(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {true}, 8 * 1000, limit);
+        ASSERT_EQ(Collect(&external), prefix) << "limit=" << limit;
+    }
+}
+
+/**
+ * @brief 缓存的记录超过语句的内存上限时与超过预算一样写入有序段，结果不变；
+ *        上限小到连归并各段的缓冲区也放不下时抛出QueryMemoryLimitError，析构后归还全部内存
+ */
+TEST(SortTest, QueryMemoryLimit) {
+    auto rows = RandomRows(20000, 100);
+    auto expected = rows;
+    std::stable_sort(expected.begin(), expected.end(), [](auto &a, auto &b) { return a.first < b.first; });
+    MemoryTracker tracker(256 * 1024);
+    {
+        SortExecutor sort(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {false}, SORT_MEMORY_BUDGET,
+                          SIZE_MAX, &tracker);
+        ASSERT_EQ(Collect(&sort), expected);
+        EXPECT_TRUE(sort.spilled_);
+        EXPECT_GT(sort.runs_.size(), 1u);
+        EXPECT_LE(tracker.peak(), tracker.limit());
+
+        // LIMIT的top-N堆放不进上限时改为外部排序
+        SortExecutor top_n(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {false}, SORT_MEMORY_BUDGET,
+                           15000, &tracker);
+        auto prefix = std::vector<std::pair<int, int>>(expected.begin(), expected.begin() + 15000);
+        ASSERT_EQ(Collect(&top_n), prefix);
+        EXPECT_TRUE(top_n.spilled_);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+
+    tracker.set_limit(16 * 1024);
+    {
+        SortExecutor sort(std::make_unique<VectorExecutor>(rows), {{"t", "key"}}, {false}, SORT_MEMORY_BUDGET,
+                          SIZE_MAX, &tracker);
+        EXPECT_THROW(Collect(&sort), QueryMemoryLimitError);
+    }
+    EXPECT_EQ(tracker.used(), 0u);
+}
+
+/**
+ * @brief LimitExecutor逐条执行和批量执行都只返回前N条记录
+ */
+TEST(LimitTest, FirstRows) {
+    auto rows = RandomRows(3000, 100);
+    for (size_t limit : {size_t(0), size_t(10), size_t(1500), size_t(5000)}) {
+        auto prefix = std::vector<std::pair<int, int>>(rows.begin(), rows.begin() + std::min(limit, rows.size()));
+        LimitExecutor limit_exec(std::make_unique<VectorExecutor>(rows), limit);
+        std::vector<std::pair<int, int>> res;
+        for (limit_exec.beginTuple(); !limit_exec.is_end(); limit_exec.nextTuple()) {
+            auto rec = limit_exec.Next();
+            res.emplace_back(*reinterpret_cast<int *>(rec->data), *reinterpret_cast<int *>(rec->data + 4));
+        }
+        EXPECT_EQ(res, prefix) << "limit=" << limit;
+
+        res.clear();
+        RowBatch batch;
+        for (limit_exec.beginBatch(); limit_exec.NextBatch(batch);) {
+            for (size_t i = 0; i < batch.size(); i++) {
+                res.emplace_back(*reinterpret_cast<const int *>(batch.row(i)),
+                                 *reinterpret_cast<const int *>(batch.row(i) + 4));
+            }
+        }
+        EXPECT_EQ(res, prefix) << "limit=" << limit;
+    }
+}
+
+/**
+ * @brief 规范化键的memcmp顺序与ix_compare逐键比较的顺序相同，包括负数、-0.0和DESC的键
+ */
+TEST(SortKeyTest, EncodingPreservesOrder) {
+    std::default_random_engine rng(33);
+    std::uniform_int_distribution<int> ints(INT32_MIN, INT32_MAX);
+    std::uniform_real_distribution<float> floats(-1e6, 1e6);
+    std::uniform_int_distribution<int> chars(0, 255);
+    // 记录为(int, float, char(3))
+    std::vector<SortKeyPart> parts = {{0, TYPE_INT, 4, false}, {4, TYPE_FLOAT, 4, true}, {8, TYPE_STRING, 3, false}};
+    std::vector<std::vector<char>> recs;
+    for (int i = 0; i < 400; i++) {
+        std::vector<char> rec(11);
+        int v = i % 4 == 0 ? i % 3 - 1 : ints(rng);
+        float f = i % 5 == 0 ? (i % 2 ? -0.0f : 0.0f) : floats(rng);
+        memcpy(rec.data(), &v, 4);
+        memcpy(rec.data() + 4, &f, 4);
+        for (int c = 0; c < 3; c++) {
+            rec[8 + c] = static_cast<char>(i % 7 == 0 ? 'a' : chars(rng));
+        }
+        recs.push_back(rec);
+    }
+    auto expect_cmp = [&](const char *a, const char *b) {
+        for (auto &part : parts) {
+            int cmp = ix_compare(a + part.offset, b + part.offset, part.type, part.len);
+            if (cmp != 0) {
+                return part.is_desc ? -cmp : cmp;
+            }
+        }
+        return 0;
+    };
+    auto sign = [](int x) { return (x > 0) - (x < 0); };
+    char ka[11], kb[11];
+    for (auto &a : recs) {
+        for (auto &b : recs) {
+            encode_sort_key(a.data(), parts, ka);
+            encode_sort_key(b.data(), parts, kb);
+            ASSERT_EQ(sign(memcmp(ka, kb, 11)), sign(expect_cmp(a.data(), b.data())));
+        }
+    }
+}
+
+/**
+ * @brief 基数排序与memcmp稳定排序的结果相同，并且键相同时保持原有顺序
+ */
+TEST(SortKeyTest, RadixMatchesComparisonSort) {
+    std::default_random_engine rng(34);
+    for (size_t key_len : {size_t(1), size_t(4), size_t(9), SORT_RADIX_MAX_KEY_BYTES}) {
+        std::uniform_int_distribution<int> bytes(0, key_len == 1 ? 255 : 3);
+        size_t n = 5000;
+        std::vector<char> keys(n * key_len);
+        for (auto &c : keys) {
+            c = static_cast<char>(bytes(rng));
+        }
+        std::vector<size_t> radix;
+        sort_keys_radix(keys.data(), n, key_len, radix);
+        std::vector<size_t> expected(n);
+        for (size_t i = 0; i < n; i++) {
+            expected[i] = i;
+        }
+        std::stable_sort(expected.begin(), expected.end(), [&](size_t a, size_t b) {
+            return memcmp(keys.data() + a * key_len, keys.data() + b * key_len, key_len) < 0;
+        });
+        EXPECT_EQ(radix, expected) << "key_len=" << key_len;
+    }
+}
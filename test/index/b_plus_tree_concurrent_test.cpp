@@ -1,7 +1,9 @@
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
 #include <random>  // for std::default_random_engine
+#include <set>
 #include <thread>  // NOLINT
 
 #include "gtest/gtest.h"
@@ -220,14 +222,26 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
     }
 
     /**
-     * @brief dfs遍历整个树，检查孩子结点的第一个和最后一个key是否正确
+     * @brief dfs遍历整个树，检查父结点指针和分隔key：内部结点的第i个key(i > 0)大于第i-1个孩子子树中的所有key，
+     * 且不大于第i个孩子子树中的所有key
      *
      * @param ih 树
      * @param now_page_no 当前遍历到的结点
+     * @param lower 子树中所有key的下界(包含)，为空表示没有下界
+     * @param upper 子树中所有key的上界(不包含)，为空表示没有上界
      */
-    void check_tree(const IxIndexHandle *ih, int now_page_no) {
+    void check_tree(const IxIndexHandle *ih, int now_page_no, const int *lower = nullptr,
+                    const int *upper = nullptr) {
         IxNodeHandle *node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
+            for (int i = 0; i < node->get_size(); i++) {
+                if (lower != nullptr) {
+                    ASSERT_GE(node->key_at(i), *lower);
+                }
+                if (upper != nullptr) {
+                    ASSERT_LT(node->key_at(i), *upper);
+                }
+            }
             buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
@@ -235,22 +249,13 @@ class BPlusTreeConcurrentTest : public ::testing::Test {
             IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
-            // check first key
-            int node_key = node->key_at(i);  // node的第i个key
-            int child_first_key = child->key_at(0);
-            int child_last_key = child->key_at(child->get_size() - 1);
-            if (i != 0) {
-                // 除了第0个key之外，node的第i个key与其第i个孩子的第0个key的值相同
-                ASSERT_EQ(node_key, child_first_key);
-            }
-            if (i + 1 < node->get_size()) {
-                // 满足制约大小关系
-                ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
-            }
-
             buffer_pool_manager_->unpin_page(child->get_page_id(), false);
 
-            check_tree(ih, node->value_at(i));  // 递归子树
+            // 第i个孩子子树中的key位于[key_at(i), key_at(i + 1))，第0个key为空，两端沿用node的上下界
+            int child_lower = node->key_at(i);
+            int child_upper = i + 1 < node->get_size() ? node->key_at(i + 1) : 0;
+            check_tree(ih, node->value_at(i), i == 0 ? lower : &child_lower,
+                       i + 1 < node->get_size() ? &child_upper : upper);  // 递归子树
         }
         buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
@@ -462,4 +467,93 @@ TEST_F(BPlusTreeConcurrentTest, MixScaleTest) {
         scan.next();
     }
     EXPECT_EQ(size, keys.size() - delete_keys.size());
-}
\ No newline at end of file
+}
+/**
+ * @brief concurrent lookups, inserts and deletes on disjoint key sets
+ * 偶数key在整个测试期间都存在，读线程不断查找它们；写线程同时插入和删除奇数key，
+ * 结束后奇数key中只剩下未被删除的部分
+ */
+/**
+ * @brief 读线程查找固定存在的偶数key，同时一个线程插入、一个线程删除奇数key
+ *
+ * @param optimistic 读线程是否使用乐观读
+ */
+void ReadWriteScale(IxIndexHandle *ih, BufferPoolManager *bpm, bool optimistic) {
+    const int64_t scale = 10000;
+    const int thread_num = 8;
+    const int order = 15;  // 小阶数使结点频繁分裂和合并
+
+    assert(order > 2 && order <= ih->file_hdr_->btree_order_);
+    ih->file_hdr_->btree_order_ = order;
+    ih->set_optimistic_read(optimistic);
+
+    std::vector<int64_t> even_keys;
+    std::vector<int64_t> odd_keys;
+    for (int64_t key = 1; key <= scale; key++) {
+        (key % 2 == 0 ? even_keys : odd_keys).push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(even_keys.begin(), even_keys.end(), rng);
+    std::shuffle(odd_keys.begin(), odd_keys.end(), rng);
+    LaunchParallelTest(thread_num, InsertHelper, ih, even_keys);
+
+    std::vector<int64_t> deleted_keys(odd_keys.begin(), odd_keys.begin() + odd_keys.size() / 2);
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_num / 2; i++) {
+        threads.emplace_back([&, i] {
+            Transaction transaction(i);
+            std::vector<Rid> rids;
+            while (!stop) {
+                for (size_t j = i; j < even_keys.size(); j += thread_num) {
+                    rids.clear();
+                    EXPECT_TRUE(ih->get_value((const char *)&even_keys[j], &rids, &transaction));
+                    ASSERT_EQ(rids.size(), 1);
+                    EXPECT_EQ(rids[0].slot_no, even_keys[j]);
+                }
+            }
+        });
+    }
+    std::thread inserter([&] {
+        Transaction transaction(thread_num);
+        for (auto key : odd_keys) {
+            Rid rid = {.page_no = 0, .slot_no = static_cast<int32_t>(key)};
+            ih->insert_entry((const char *)&key, rid, &transaction);
+        }
+    });
+    std::thread deleter([&] {
+        Transaction transaction(thread_num + 1);
+        // 与插入线程并发，待删除的key可能尚未插入，重复尝试直到删除成功
+        for (auto key : deleted_keys) {
+            while (!ih->delete_entry((const char *)&key, &transaction)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    inserter.join();
+    deleter.join();
+    stop = true;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::set<int64_t> expected(even_keys.begin(), even_keys.end());
+    expected.insert(odd_keys.begin() + odd_keys.size() / 2, odd_keys.end());
+    auto it = expected.begin();
+    IxScan scan(ih, ih->leaf_begin(), ih->leaf_end(), bpm);
+    while (!scan.is_end()) {
+        ASSERT_NE(it, expected.end());
+        EXPECT_EQ(scan.rid().slot_no, *it);
+        it++;
+        scan.next();
+    }
+    EXPECT_EQ(it, expected.end());
+}
+
+TEST_F(BPlusTreeConcurrentTest, ReadWriteScaleTest) {
+    ReadWriteScale(ih_.get(), buffer_pool_manager_.get(), false);
+}
+
+TEST_F(BPlusTreeConcurrentTest, OptimisticReadWriteScaleTest) {
+    ReadWriteScale(ih_.get(), buffer_pool_manager_.get(), true);
+}
@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <cstdio>
+#include <map>
 #include <random>  // for std::default_random_engine
 
 #include "gtest/gtest.h"
@@ -218,14 +219,26 @@ class BPlusTreeTests : public ::testing::Test {
     }
 
     /**
-     * @brief dfs遍历整个树，检查孩子结点的第一个和最后一个key是否正确
+     * @brief dfs遍历整个树，检查父结点指针和分隔key：内部结点的第i个key(i > 0)大于第i-1个孩子子树中的所有key，
+     * 且不大于第i个孩子子树中的所有key
      *
      * @param ih 树
      * @param now_page_no 当前遍历到的结点
+     * @param lower 子树中所有key的下界(包含)，为空表示没有下界
+     * @param upper 子树中所有key的上界(不包含)，为空表示没有上界
      */
-    void check_tree(const IxIndexHandle *ih, int now_page_no) {
+    void check_tree(const IxIndexHandle *ih, int now_page_no, const int *lower = nullptr,
+                    const int *upper = nullptr) {
         IxNodeHandle *node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
+            for (int i = 0; i < node->get_size(); i++) {
+                if (lower != nullptr) {
+                    ASSERT_GE(node->key_at(i), *lower);
+                }
+                if (upper != nullptr) {
+                    ASSERT_LT(node->key_at(i), *upper);
+                }
+            }
             buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
@@ -233,22 +246,13 @@ class BPlusTreeTests : public ::testing::Test {
             IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
-            // check first key
-            int node_key = node->key_at(i);  // node的第i个key
-            int child_first_key = child->key_at(0);
-            int child_last_key = child->key_at(child->get_size() - 1);
-            if (i != 0) {
-                // 除了第0个key之外，node的第i个key与其第i个孩子的第0个key的值相同
-                ASSERT_EQ(node_key, child_first_key);
-            }
-            if (i + 1 < node->get_size()) {
-                // 满足制约大小关系
-                ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
-            }
-
             buffer_pool_manager_->unpin_page(child->get_page_id(), false);
 
-            check_tree(ih, node->value_at(i));  // 递归子树
+            // 第i个孩子子树中的key位于[key_at(i), key_at(i + 1))，第0个key为空，两端沿用node的上下界
+            int child_lower = node->key_at(i);
+            int child_upper = i + 1 < node->get_size() ? node->key_at(i + 1) : 0;
+            check_tree(ih, node->value_at(i), i == 0 ? lower : &child_lower,
+                       i + 1 < node->get_size() ? &child_upper : upper);  // 递归子树
         }
         buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
@@ -429,6 +433,47 @@ TEST_F(BPlusTreeTests, InsertAndDeleteTest2) {
     }
 }
 
+/**
+ * @brief 删除后合并释放的结点进入空闲页链表，重新打开索引后之后的插入复用它们，索引文件不再增长
+ */
+TEST_F(BPlusTreeTests, ReuseFreedPagesTest) {
+    const int order = 4;
+    const int scale = 300;
+    ih_->file_hdr_->btree_order_ = order;
+
+    auto insert_all = [&](int from, int to) {
+        for (int key = from; key < to; key++) {
+            Rid rid = {.page_no = 0, .slot_no = key};
+            ASSERT_NE(ih_->insert_entry((const char *)&key, rid, txn_.get()), IX_NO_PAGE);
+        }
+    };
+    insert_all(0, scale);
+    int num_pages = ih_->file_hdr_->num_pages_;
+    EXPECT_EQ(ih_->file_hdr_->first_free_page_no_, IX_NO_PAGE);
+
+    // 只保留最前面的几个key，大部分结点被合并释放
+    for (int key = 10; key < scale; key++) {
+        ASSERT_TRUE(ih_->delete_entry((const char *)&key, txn_.get()));
+    }
+    EXPECT_NE(ih_->file_hdr_->first_free_page_no_, IX_NO_PAGE);
+    EXPECT_EQ(ih_->file_hdr_->num_pages_, num_pages);
+
+    // 空闲页链表随文件头写回磁盘
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
+    ih_->file_hdr_->btree_order_ = order;
+    EXPECT_NE(ih_->file_hdr_->first_free_page_no_, IX_NO_PAGE);
+
+    insert_all(10, scale);
+    EXPECT_EQ(ih_->file_hdr_->num_pages_, num_pages);
+    for (int key = 0; key < scale; key++) {
+        std::vector<Rid> rids;
+        ASSERT_TRUE(ih_->get_value((const char *)&key, &rids, txn_.get()));
+        ASSERT_EQ(rids.size(), 1u);
+        EXPECT_EQ(rids[0].slot_no, key);
+    }
+}
+
 /**
  * @brief 随机插入和删除多个键值对
  * 
@@ -491,4 +536,105 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
     }
     std::cout << "Insert keys count: " << add_cnt << '\n' << "Delete keys count: " << del_cnt << '\n';
     check_all(ih_.get(), mock);
-}
\ No newline at end of file
+}
+/**
+ * @brief 开启修改缓冲后，叶子不在缓冲池中的插入和删除先被缓存，查找key或开始范围扫描时写入索引，
+ * 结果与直接修改相同；缓存的修改达到容量时由写入者全部写入
+ */
+TEST_F(BPlusTreeTests, ChangeBufferTest) {
+    const int order = 8;
+    const int scale = 400;
+    const size_t capacity = 64;
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::map<int, Rid> mock;
+    for (int key = 0; key < scale; key++) {
+        Rid rid = {.page_no = 0, .slot_no = key};
+        ih_->insert_entry((const char *)&key, rid, txn_.get());
+        mock[key] = rid;
+    }
+    ih_->enable_change_buffer(capacity);
+    // 写回并淘汰索引的所有页面，之后的修改都落在不在缓冲池中的叶子上
+    auto evict_index = [&]() {
+        buffer_pool_manager_->flush_all_pages(ih_->fd_);
+        for (int page_no = 0; page_no < ih_->file_hdr_->num_pages_; page_no++) {
+            buffer_pool_manager_->delete_page(PageId{ih_->fd_, page_no});
+        }
+    };
+    evict_index();
+
+    // 删除后重新插入的key换成新的rid，已经存在的key再次插入不起作用
+    int key = 7;
+    ih_->delete_entry((const char *)&key, txn_.get());
+    Rid new_rid = {.page_no = 1, .slot_no = key};
+    ih_->insert_entry((const char *)&key, new_rid, txn_.get());
+    mock[key] = new_rid;
+    key = 8;
+    ih_->insert_entry((const char *)&key, Rid{.page_no = 2, .slot_no = key}, txn_.get());
+    for (key = 100; key < 130; key += 2) {
+        ih_->delete_entry((const char *)&key, txn_.get());
+        mock.erase(key);
+    }
+    EXPECT_EQ(ih_->get_num_buffered(), 17u);
+
+    // 查找只写入这个key上缓存的修改
+    std::vector<Rid> rids;
+    key = 7;
+    ASSERT_TRUE(ih_->get_value((const char *)&key, &rids, txn_.get()));
+    ASSERT_EQ(rids.size(), 1u);
+    EXPECT_EQ(rids[0], new_rid);
+    EXPECT_EQ(ih_->get_num_buffered(), 16u);
+    rids.clear();
+    key = 100;
+    EXPECT_FALSE(ih_->get_value((const char *)&key, &rids, txn_.get()));
+    EXPECT_EQ(ih_->get_num_buffered(), 15u);
+
+    // 范围扫描之前写入全部修改
+    auto check_scan = [&]() {
+        IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+        EXPECT_EQ(ih_->get_num_buffered(), 0u);
+        auto it = mock.begin();
+        for (; !scan.is_end(); scan.next(), it++) {
+            ASSERT_NE(it, mock.end());
+            ASSERT_EQ(scan.rid(), it->second);
+        }
+        EXPECT_EQ(it, mock.end());
+    };
+    check_scan();
+
+    // 批量修改同样被缓存，数量达到容量时全部写入
+    evict_index();
+    std::vector<int> keys;
+    std::vector<const char *> key_ptrs;
+    std::vector<Rid> insert_rids;
+    for (key = scale; key < scale + 200; key++) {
+        keys.push_back(key);
+    }
+    for (auto &k : keys) {
+        key_ptrs.push_back((const char *)&k);
+        insert_rids.push_back(Rid{.page_no = 3, .slot_no = k});
+        mock[k] = insert_rids.back();
+    }
+    for (size_t i = 0; i < key_ptrs.size(); i += 10) {
+        std::vector<const char *> batch_keys(key_ptrs.begin() + i, key_ptrs.begin() + i + 10);
+        std::vector<Rid> batch_rids(insert_rids.begin() + i, insert_rids.begin() + i + 10);
+        ih_->insert_entries(batch_keys, batch_rids, txn_.get());
+        EXPECT_LT(ih_->get_num_buffered(), capacity);
+    }
+    for (key = 200; key < 260; key++) {
+        ih_->delete_entry((const char *)&key, txn_.get());
+        mock.erase(key);
+        EXPECT_LT(ih_->get_num_buffered(), capacity);
+    }
+    check_scan();
+
+    // 关闭索引之前写入缓存的修改
+    evict_index();
+    key = 0;
+    ih_->delete_entry((const char *)&key, txn_.get());
+    mock.erase(key);
+    EXPECT_EQ(ih_->get_num_buffered(), 1u);
+    ix_manager_->close_index(ih_.get());
+    ih_ = ix_manager_->open_index(TEST_FILE_NAME, TEST_COL);
+    check_scan();
+}
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <cstdio>
+#include <functional>
+#include <numeric>
 #include <random>  // for std::default_random_engine
 
 #include "gtest/gtest.h"
@@ -218,14 +220,26 @@ class BPlusTreeTests : public ::testing::Test {
     }
 
     /**
-     * @brief dfs遍历整个树，检查孩子结点的第一个和最后一个key是否正确
+     * @brief dfs遍历整个树，检查父结点指针和分隔key：内部结点的第i个key(i > 0)大于第i-1个孩子子树中的所有key，
+     * 且不大于第i个孩子子树中的所有key
      *
      * @param ih 树
      * @param now_page_no 当前遍历到的结点
+     * @param lower 子树中所有key的下界(包含)，为空表示没有下界
+     * @param upper 子树中所有key的上界(不包含)，为空表示没有上界
      */
-    void check_tree(const IxIndexHandle *ih, int now_page_no) {
+    void check_tree(const IxIndexHandle *ih, int now_page_no, const int *lower = nullptr,
+                    const int *upper = nullptr) {
         IxNodeHandle *node = ih->fetch_node(now_page_no);
         if (node->is_leaf_page()) {
+            for (int i = 0; i < node->get_size(); i++) {
+                if (lower != nullptr) {
+                    ASSERT_GE(node->key_at(i), *lower);
+                }
+                if (upper != nullptr) {
+                    ASSERT_LT(node->key_at(i), *upper);
+                }
+            }
             buffer_pool_manager_->unpin_page(node->get_page_id(), false);
             return;
         }
@@ -233,22 +247,13 @@ class BPlusTreeTests : public ::testing::Test {
             IxNodeHandle *child = ih->fetch_node(node->value_at(i));  // 第i个孩子
             // check parent
             assert(child->get_parent_page_no() == now_page_no);
-            // check first key
-            int node_key = node->key_at(i);  // node的第i个key
-            int child_first_key = child->key_at(0);
-            int child_last_key = child->key_at(child->get_size() - 1);
-            if (i != 0) {
-                // 除了第0个key之外，node的第i个key与其第i个孩子的第0个key的值相同
-                ASSERT_EQ(node_key, child_first_key);
-            }
-            if (i + 1 < node->get_size()) {
-                // 满足制约大小关系
-                ASSERT_LT(child_last_key, node->key_at(i + 1));  // child_last_key < node->KeyAt(i + 1)
-            }
-
             buffer_pool_manager_->unpin_page(child->get_page_id(), false);
 
-            check_tree(ih, node->value_at(i));  // 递归子树
+            // 第i个孩子子树中的key位于[key_at(i), key_at(i + 1))，第0个key为空，两端沿用node的上下界
+            int child_lower = node->key_at(i);
+            int child_upper = i + 1 < node->get_size() ? node->key_at(i + 1) : 0;
+            check_tree(ih, node->value_at(i), i == 0 ? lower : &child_lower,
+                       i + 1 < node->get_size() ? &child_upper : upper);  // 递归子树
         }
         buffer_pool_manager_->unpin_page(node->get_page_id(), false);
     }
@@ -408,8 +413,333 @@ TEST_F(BPlusTreeTests, LargeScaleTest) {
         Rid rid = scan.rid();
         EXPECT_EQ(rid.page_no, insert_page_no);
         EXPECT_EQ(rid.slot_no, insert_slot_no);
+        // entry()同时取出叶子结点中的key，供index-only scan使用
+        int key = 0;
+        EXPECT_EQ(scan.entry(reinterpret_cast<char *>(&key)), rid);
+        EXPECT_EQ(key, static_cast<int>(current_key));
         current_key++;
         scan.next();
     }
     EXPECT_EQ(current_key, keys.size() + 1);
-}
\ No newline at end of file
+}
+/**
+ * @brief 乱序添加1~scale的偶数，用较小的排序缓冲区触发外部排序，批量构建后校验查找、扫描，
+ *        并在批量构建的树上继续插入奇数
+ */
+TEST_F(BPlusTreeTests, BulkLoadTest) {
+    const int32_t scale = 20000;
+    const int order = 10;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::vector<int32_t> keys;
+    for (int32_t key = 2; key <= scale; key += 2) {
+        keys.push_back(key);
+    }
+    auto rng = std::default_random_engine{};
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    IxBulkLoader loader(ih_.get(), 0.7, 4096 * sizeof(Rid));
+    for (auto key : keys) {
+        loader.add((const char *)&key, Rid{.page_no = 0, .slot_no = key});
+    }
+    loader.finish();
+    EXPECT_GT(loader.num_runs(), 1);
+    check_tree(ih_.get(), ih_->file_hdr_->root_page_);
+
+    std::vector<Rid> rids;
+    for (auto key : keys) {
+        rids.clear();
+        EXPECT_TRUE(ih_->get_value((const char *)&key, &rids, txn_.get()));
+        ASSERT_EQ(rids.size(), 1);
+        EXPECT_EQ(rids[0].slot_no, key);
+    }
+
+    for (int32_t key = 1; key <= scale; key += 2) {
+        ASSERT_TRUE(ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, txn_.get()));
+    }
+    check_tree(ih_.get(), ih_->file_hdr_->root_page_);
+    int32_t expected = 1;
+    IxScan scan(ih_.get(), ih_->leaf_begin(), ih_->leaf_end(), buffer_pool_manager_.get());
+    while (!scan.is_end()) {
+        EXPECT_EQ(scan.rid().slot_no, expected);
+        expected++;
+        scan.next();
+    }
+    EXPECT_EQ(expected, scale + 1);
+}
+
+/**
+ * @brief 批量查找乱序、重复以及不存在的key，结果与逐个调用get_value相同
+ */
+TEST_F(BPlusTreeTests, BatchGetValueTest) {
+    const int32_t scale = 10000;
+    const int order = 50;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    for (int32_t key = 2; key <= scale; key += 2) {
+        ASSERT_TRUE(ih_->insert_entry((const char *)&key, Rid{.page_no = 0, .slot_no = key}, txn_.get()));
+    }
+
+    std::default_random_engine rng;
+    std::uniform_int_distribution<int32_t> dist(0, scale + 10);
+    std::vector<int32_t> probes(3000);
+    for (auto &key : probes) {
+        key = dist(rng);
+    }
+    // 连续的一段key，大部分落在同一个叶子或相邻叶子中
+    for (int32_t key = 4000; key < 4500; key++) {
+        probes.push_back(key);
+    }
+    std::vector<const char *> keys;
+    for (auto &key : probes) {
+        keys.push_back((const char *)&key);
+    }
+
+    std::vector<std::vector<Rid>> results;
+    int found = ih_->get_values_batch(keys, &results, txn_.get());
+    ASSERT_EQ(results.size(), probes.size());
+    int expected_found = 0;
+    for (size_t i = 0; i < probes.size(); i++) {
+        std::vector<Rid> rids;
+        bool exists = ih_->get_value(keys[i], &rids, txn_.get());
+        expected_found += exists;
+        EXPECT_EQ(results[i], rids) << "key=" << probes[i];
+        EXPECT_EQ(exists, probes[i] % 2 == 0 && probes[i] > 0 && probes[i] <= scale);
+    }
+    EXPECT_EQ(found, expected_found);
+}
+
+/**
+ * @brief 批量插入和批量删除乱序的key，结果应与逐条插入删除一致
+ */
+TEST_F(BPlusTreeTests, BatchInsertDeleteTest) {
+    const int32_t scale = 10000;
+    const int order = 50;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    std::vector<int32_t> data(scale);
+    for (int32_t i = 0; i < scale; i++) {
+        data[i] = i + 1;
+    }
+    std::shuffle(data.begin(), data.end(), std::default_random_engine(7));
+
+    std::multimap<int, Rid> mock;
+    std::vector<const char *> keys;
+    std::vector<Rid> rids;
+    for (auto &key : data) {
+        Rid rid = {.page_no = key, .slot_no = key};
+        keys.push_back((const char *)&key);
+        rids.push_back(rid);
+        mock.insert({key, rid});
+    }
+    ih_->insert_entries(keys, rids, txn_.get());
+    check_all(ih_.get(), mock);
+
+    // 删除所有奇数key，其中混入一些不存在的key
+    std::vector<int32_t> victims;
+    for (auto &key : data) {
+        if (key % 2 == 1) {
+            victims.push_back(key);
+            mock.erase(key);
+        }
+    }
+    victims.push_back(scale + 1);
+    victims.push_back(scale + 3);
+    std::vector<const char *> delete_keys;
+    for (auto &key : victims) {
+        delete_keys.push_back((const char *)&key);
+    }
+    int deleted = ih_->delete_entries(delete_keys, txn_.get());
+    EXPECT_EQ(deleted, scale / 2);
+    check_all(ih_.get(), mock);
+}
+
+/**
+ * @brief 逆序扫描和带limit的扫描，结果应与正序扫描的结果逆序/前缀一致
+ */
+TEST_F(BPlusTreeTests, ReverseScanTest) {
+    const int32_t scale = 10000;
+    const int order = 50;
+
+    assert(order > 2 && order <= ih_->file_hdr_->btree_order_);
+    ih_->file_hdr_->btree_order_ = order;
+
+    for (int32_t key = 1; key <= scale; key++) {
+        ASSERT_TRUE(ih_->insert_entry((const char *)&key, Rid{.page_no = key, .slot_no = key}, txn_.get()));
+    }
+
+    auto collect = [&](const Iid &lower, const Iid &upper, bool reverse, size_t limit) {
+        std::vector<int32_t> keys;
+        IxScan scan(ih_.get(), lower, upper, buffer_pool_manager_.get(), reverse, limit);
+        for (; !scan.is_end(); scan.next()) {
+            keys.push_back(scan.rid().slot_no);
+        }
+        return keys;
+    };
+
+    // 全表逆序
+    auto forward = collect(ih_->leaf_begin(), ih_->leaf_end(), false, IxScan::NO_LIMIT);
+    auto backward = collect(ih_->leaf_begin(), ih_->leaf_end(), true, IxScan::NO_LIMIT);
+    ASSERT_EQ(forward.size(), static_cast<size_t>(scale));
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(forward, backward);
+
+    // 区间[lo, hi]的逆序和limit
+    std::default_random_engine rng;
+    std::uniform_int_distribution<int32_t> dist(1, scale);
+    for (int round = 0; round < 100; round++) {
+        int32_t lo = dist(rng);
+        int32_t hi = dist(rng);
+        if (lo > hi) {
+            std::swap(lo, hi);
+        }
+        Iid lower = ih_->lower_bound((const char *)&lo);
+        Iid upper = ih_->upper_bound((const char *)&hi);
+        auto keys = collect(lower, upper, true, IxScan::NO_LIMIT);
+        ASSERT_EQ(keys.size(), static_cast<size_t>(hi - lo + 1));
+        for (size_t i = 0; i < keys.size(); i++) {
+            EXPECT_EQ(keys[i], hi - static_cast<int32_t>(i));
+        }
+        size_t limit = round % 7;
+        auto limited = collect(lower, upper, true, limit);
+        EXPECT_EQ(limited, std::vector<int32_t>(keys.begin(), keys.begin() + std::min(limit, keys.size())));
+        limited = collect(lower, upper, false, limit);
+        ASSERT_EQ(limited.size(), std::min(limit, keys.size()));
+        for (size_t i = 0; i < limited.size(); i++) {
+            EXPECT_EQ(limited[i], lo + static_cast<int32_t>(i));
+        }
+    }
+    // 空区间
+    int32_t key = scale / 2;
+    Iid iid = ih_->lower_bound((const char *)&key);
+    EXPECT_TRUE(collect(iid, iid, true, IxScan::NO_LIMIT).empty());
+}
+
+/**
+ * @brief CHAR(64)的key有很长的公共前缀，只有中间的序号不同：内部结点存放去掉公共前缀、截断到序号中第一个不同字节的分隔key，
+ *        扇出超过按完整key计算的btree_order。乱序插入后删除大部分key，检查查找、扫描和各层分隔key的大小关系
+ */
+TEST_F(BPlusTreeTests, StringKeySeparatorTest) {
+    const int key_len = 64;
+    const int scale = 20000;
+    const std::string url_prefix = "https://example.com/users/";
+    sm_->create_table("table2", {{"name", TYPE_STRING, key_len}}, nullptr);
+    sm_->create_index("table2", {"name"}, nullptr);
+    auto ih = ix_manager_->open_index("table2", std::vector<std::string>{"name"});
+    const std::vector<ColType> &col_types = ih->file_hdr_->col_types_;
+    const std::vector<int> &col_lens = ih->file_hdr_->col_lens_;
+    auto make_key = [&](int id) {
+        std::string key(key_len, '\0');
+        snprintf(key.data(), key_len, "%s%08d/profile", url_prefix.c_str(), id);
+        return key;
+    };
+
+    // 遍历整棵树：叶子中的key位于父结点给出的[lower, upper)内，lower为空表示没有下界，upper为空表示没有上界
+    int max_children = 0;
+    int max_prefix_len = 0;
+    std::function<void(page_id_t, const std::string &, const std::string &)> check_node =
+        [&](page_id_t page_no, const std::string &lower, const std::string &upper) {
+            IxNodeHandle *node = ih->fetch_node(page_no);
+            if (node->is_leaf_page()) {
+                for (int i = 0; i < node->get_size(); i++) {
+                    const char *key = node->get_key(i);
+                    EXPECT_GE(ix_compare_separator(key, lower.data(), lower.size(), col_types, col_lens), 0);
+                    if (!upper.empty()) {
+                        EXPECT_LT(ix_compare_separator(key, upper.data(), upper.size(), col_types, col_lens), 0);
+                    }
+                }
+            } else {
+                max_children = std::max(max_children, node->get_size());
+                max_prefix_len = std::max(max_prefix_len, node->get_prefix_len());
+                for (int i = 0; i < node->get_size(); i++) {
+                    std::string child_lower = i == 0 ? lower : node->separator_at(i);
+                    std::string child_upper = i + 1 < node->get_size() ? node->separator_at(i + 1) : upper;
+                    if (i > 0) {
+                        EXPECT_LT(child_lower.size(), static_cast<size_t>(key_len));
+                    }
+                    check_node(node->value_at(i), child_lower, child_upper);
+                }
+            }
+            buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+            delete node;
+        };
+    auto check_keys = [&](const std::vector<int> &ids) {
+        std::vector<Rid> rids;
+        for (int id : ids) {
+            rids.clear();
+            ASSERT_TRUE(ih->get_value(make_key(id).data(), &rids, txn_.get())) << id;
+            ASSERT_EQ(rids[0].slot_no, id);
+        }
+        std::vector<int> sorted = ids;
+        std::sort(sorted.begin(), sorted.end());
+        auto it = sorted.begin();
+        IxScan scan(ih.get(), ih->leaf_begin(), ih->leaf_end(), buffer_pool_manager_.get());
+        for (; !scan.is_end() && it != sorted.end(); scan.next(), it++) {
+            ASSERT_EQ(scan.rid().slot_no, *it);
+        }
+        ASSERT_TRUE(scan.is_end());
+        ASSERT_EQ(it, sorted.end());
+        check_node(ih->file_hdr_->root_page_, std::string(), std::string());
+    };
+
+    std::vector<int> ids(scale);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::default_random_engine rng;
+    std::shuffle(ids.begin(), ids.end(), rng);
+    for (int id : ids) {
+        ih->insert_entry(make_key(id).data(), Rid{.page_no = 0, .slot_no = id}, txn_.get());
+    }
+    check_keys(ids);
+    EXPECT_GT(max_children, ih->file_hdr_->btree_order_ + 1);
+    EXPECT_GE(max_prefix_len, static_cast<int>(url_prefix.size()));
+
+    // 删除3/4的key，触发内部结点的合并和重分配
+    std::vector<int> remaining;
+    std::shuffle(ids.begin(), ids.end(), rng);
+    for (int id : ids) {
+        if (id % 4 == 0) {
+            remaining.push_back(id);
+        } else {
+            ASSERT_TRUE(ih->delete_entry(make_key(id).data(), txn_.get()));
+        }
+    }
+    std::vector<Rid> rids;
+    EXPECT_FALSE(ih->get_value(make_key(1).data(), &rids, txn_.get()));
+    check_keys(remaining);
+    ix_manager_->close_index(ih.get());
+}
+
+/**
+ * @brief 索引文件头记录格式版本，打开加入版本之前创建的文件或者版本不同的文件时报错，不按当前格式读取结点
+ */
+TEST_F(BPlusTreeTests, FormatVersionTest) {
+    std::vector<ColMeta> cols = {sm_->db_.get_table(TEST_FILE_NAME).cols[1]};
+    ix_manager_->create_index(TEST_FILE_NAME, cols);
+    auto ih = ix_manager_->open_index(TEST_FILE_NAME, cols);
+    EXPECT_EQ(ih->file_hdr_->format_version_, IX_FILE_FORMAT_VERSION);
+    ix_manager_->close_index(ih.get());
+
+    std::string ix_name = ix_manager_->get_index_name(TEST_FILE_NAME, cols);
+    char hdr[PAGE_SIZE];
+    auto rewrite_hdr = [&](const std::function<void()> &modify) {
+        int fd = disk_manager_->open_file(ix_name);
+        disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, hdr, PAGE_SIZE);
+        modify();
+        disk_manager_->write_page(fd, IX_FILE_HDR_PAGE, hdr, PAGE_SIZE);
+        disk_manager_->close_file(fd);
+    };
+
+    // 版本号不同
+    rewrite_hdr([&] { reinterpret_cast<int *>(hdr)[1] = IX_FILE_FORMAT_VERSION + 1; });
+    EXPECT_THROW(ix_manager_->open_index(TEST_FILE_NAME, cols), IndexFormatError);
+
+    // 加入版本之前的文件头没有magic和版本号，从tot_len_开始
+    rewrite_hdr([&] { memmove(hdr, hdr + 2 * sizeof(int), PAGE_SIZE - 2 * sizeof(int)); });
+    EXPECT_THROW(ix_manager_->open_index(TEST_FILE_NAME, cols), IndexFormatError);
+}
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "index/ix.h"
+
+const std::string TEST_FILE_NAME = "hash_index_test";       // 索引文件名为hash_index_test_k.idx
+
+class HashIndexTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<IxHashIndexHandle> ih_;
+    std::vector<ColMeta> cols_ = {{TEST_FILE_NAME, "k", TYPE_INT, 4, 0, true}};
+
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(64, disk_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        if (ix_manager_->exists(TEST_FILE_NAME, cols_)) {
+            ix_manager_->destroy_index(TEST_FILE_NAME, cols_);
+        }
+        ix_manager_->create_hash_index(TEST_FILE_NAME, cols_);
+        ih_ = ix_manager_->open_hash_index(TEST_FILE_NAME, cols_);
+    }
+
+    void TearDown() override {
+        if (ih_ != nullptr) {
+            ix_manager_->close_index(ih_.get());
+        }
+        ix_manager_->destroy_index(TEST_FILE_NAME, cols_);
+    }
+
+    void Reopen() {
+        ix_manager_->close_index(ih_.get());
+        ih_ = ix_manager_->open_hash_index(TEST_FILE_NAME, cols_);
+    }
+
+    // key对应的rid，不存在时返回nullopt
+    std::optional<Rid> Lookup(int key) {
+        std::vector<Rid> result;
+        if (!ih_->get_value(reinterpret_cast<const char *>(&key), &result, nullptr)) {
+            return std::nullopt;
+        }
+        EXPECT_EQ(result.size(), 1u);
+        return result[0];
+    }
+};
+
+/**
+ * @brief 插入足够多的key使桶多次分裂、目录多次翻倍，所有key仍能查到；重复插入不修改；
+ *        删除一半key后只能查到另一半，关闭并重新打开后目录和桶保持不变
+ */
+TEST_F(HashIndexTest, InsertLookupDelete) {
+    const int n = 20000;
+    std::vector<int> keys(n);
+    for (int i = 0; i < n; i++) {
+        keys[i] = i * 7 - n;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::default_random_engine(3));
+    for (int key : keys) {
+        ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, key & 0xff}, nullptr);
+    }
+    EXPECT_GT(ih_->global_depth(), 4);
+    int dup = keys[0];
+    ih_->insert_entry(reinterpret_cast<const char *>(&dup), Rid{-1, -1}, nullptr);
+    for (int key : keys) {
+        auto rid = Lookup(key);
+        ASSERT_TRUE(rid.has_value()) << key;
+        EXPECT_EQ(rid->page_no, key);
+        EXPECT_EQ(rid->slot_no, key & 0xff);
+    }
+    EXPECT_FALSE(Lookup(1).has_value());
+
+    for (int i = 0; i < n; i += 2) {
+        EXPECT_TRUE(ih_->delete_entry(reinterpret_cast<const char *>(&keys[i]), nullptr));
+    }
+    EXPECT_FALSE(ih_->delete_entry(reinterpret_cast<const char *>(&keys[0]), nullptr));
+    int depth = ih_->global_depth();
+    Reopen();
+    EXPECT_EQ(ih_->global_depth(), depth);
+    for (int i = 0; i < n; i++) {
+        EXPECT_EQ(Lookup(keys[i]).has_value(), i % 2 == 1) << keys[i];
+    }
+}
+
+/**
+ * @brief 批量插入、查找和删除与逐条操作的结果相同，批量查找对不存在的key返回空结果
+ */
+TEST_F(HashIndexTest, BatchOperations) {
+    const int n = 5000;
+    std::vector<int> keys(n);
+    std::vector<const char *> key_ptrs;
+    std::vector<Rid> rids;
+    for (int i = 0; i < n; i++) {
+        keys[i] = n - i;
+    }
+    for (int i = 0; i < n; i++) {
+        key_ptrs.push_back(reinterpret_cast<const char *>(&keys[i]));
+        rids.push_back(Rid{keys[i], 1});
+    }
+    ih_->insert_entries(key_ptrs, rids, nullptr);
+
+    int missing = -5;
+    std::vector<const char *> probes = {key_ptrs[10], reinterpret_cast<const char *>(&missing), key_ptrs[4000]};
+    std::vector<std::vector<Rid>> results;
+    EXPECT_EQ(ih_->get_values_batch(probes, &results, nullptr), 2);
+    ASSERT_EQ(results.size(), 3u);
+    ASSERT_EQ(results[0].size(), 1u);
+    EXPECT_EQ(results[0][0].page_no, keys[10]);
+    EXPECT_TRUE(results[1].empty());
+    ASSERT_EQ(results[2].size(), 1u);
+    EXPECT_EQ(results[2][0].page_no, keys[4000]);
+
+    std::vector<const char *> deleted(key_ptrs.begin(), key_ptrs.begin() + n / 2);
+    deleted.push_back(reinterpret_cast<const char *>(&missing));
+    EXPECT_EQ(ih_->delete_entries(deleted, nullptr), n / 2);
+    for (int i = 0; i < n; i++) {
+        EXPECT_EQ(Lookup(keys[i]).has_value(), i >= n / 2);
+    }
+}
+
+/**
+ * @brief 多个线程同时插入不相交的key并触发并发的桶分裂和目录翻倍，同时有线程反复查找已经插入的key；
+ *        结束后所有key都能查到
+ */
+TEST_F(HashIndexTest, ConcurrentInsertAndLookup) {
+    const int num_threads = 4;
+    const int per_thread = 8000;
+    std::atomic<bool> done{false};
+    std::atomic<int> inserted{0};           // 线程0已经插入的key的数量
+    std::atomic<int> lookup_errors{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; t++) {
+        writers.emplace_back([&, t]() {
+            for (int i = 0; i < per_thread; i++) {
+                int key = i * num_threads + t;
+                ih_->insert_entry(reinterpret_cast<const char *>(&key), Rid{key, t}, nullptr);
+                if (t == 0) {
+                    inserted = i + 1;
+                }
+            }
+        });
+    }
+    // 线程0已经插入的key在其他线程并发分裂桶时也一定能查到
+    std::thread reader([&]() {
+        std::default_random_engine rng(5);
+        while (!done.load()) {
+            int n = inserted.load();
+            if (n == 0) {
+                continue;
+            }
+            int key = std::uniform_int_distribution<int>(0, n - 1)(rng) * num_threads;
+            std::vector<Rid> result;
+            if (!ih_->get_value(reinterpret_cast<const char *>(&key), &result, nullptr) || result.size() != 1 ||
+                result[0].page_no != key) {
+                lookup_errors++;
+            }
+        }
+    });
+    for (auto &writer : writers) {
+        writer.join();
+    }
+    done = true;
+    reader.join();
+    EXPECT_EQ(lookup_errors.load(), 0);
+    for (int key = 0; key < num_threads * per_thread; key++) {
+        auto rid = Lookup(key);
+        ASSERT_TRUE(rid.has_value()) << key;
+        EXPECT_EQ(rid->page_no, key);
+        EXPECT_EQ(rid->slot_no, key % num_threads);
+    }
+}
@@ -0,0 +1,135 @@
+#include "index/ix_compare.h"
+
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 随机生成key，取值范围很小，使各字段经常相等，覆盖后续字段参与比较的情况
+ */
+void GenKey(std::default_random_engine &rng, const std::vector<ColType> &col_types, const std::vector<int> &col_lens,
+            std::vector<char> &key) {
+    std::uniform_int_distribution<int> dist(-3, 3);
+    int offset = 0;
+    for (size_t i = 0; i < col_types.size(); i++) {
+        if (col_types[i] == TYPE_INT) {
+            *reinterpret_cast<int *>(key.data() + offset) = dist(rng);
+        } else if (col_types[i] == TYPE_FLOAT) {
+            *reinterpret_cast<float *>(key.data() + offset) = dist(rng) / 2.0f;
+        } else {
+            for (int j = 0; j < col_lens[i]; j++) {
+                key[offset + j] = static_cast<char>('a' + dist(rng) + 3);
+            }
+        }
+        offset += col_lens[i];
+    }
+}
+
+int TotalLen(const std::vector<int> &col_lens) {
+    int tot_len = 0;
+    for (int len : col_lens) {
+        tot_len += len;
+    }
+    return tot_len;
+}
+
+int Sign(int x) { return (x > 0) - (x < 0); }
+
+/**
+ * @brief 随机生成key，校验特化的比较器与通用的ix_compare结果符号一致
+ */
+void CheckComparator(const std::vector<ColType> &col_types, const std::vector<int> &col_lens) {
+    int tot_len = TotalLen(col_lens);
+    IxKeyComparator cmp(col_types, col_lens);
+    std::default_random_engine rng(2023);
+    std::vector<char> a(tot_len), b(tot_len);
+    for (int i = 0; i < 10000; i++) {
+        GenKey(rng, col_types, col_lens, a);
+        GenKey(rng, col_types, col_lens, b);
+        int expected = ix_compare(a.data(), b.data(), col_types, col_lens);
+        int actual = cmp(a.data(), b.data());
+        ASSERT_EQ(Sign(expected), Sign(actual));
+    }
+}
+
+/**
+ * @brief 随机生成两个不相等的key left < right，校验最短分隔key大于left且不大于right，再短一个比较单位就不大于left；
+ *        公共前缀之后的部分决定两者的大小
+ */
+void CheckSeparator(const std::vector<ColType> &col_types, const std::vector<int> &col_lens) {
+    int tot_len = TotalLen(col_lens);
+    std::default_random_engine rng(2024);
+    std::vector<char> left(tot_len), right(tot_len);
+    for (int i = 0; i < 10000; i++) {
+        GenKey(rng, col_types, col_lens, left);
+        GenKey(rng, col_types, col_lens, right);
+        int res = ix_compare(left.data(), right.data(), col_types, col_lens);
+        if (res == 0) {
+            continue;
+        }
+        if (res > 0) {
+            std::swap(left, right);
+        }
+        int len = ix_separator_len(left.data(), right.data(), col_types, col_lens);
+        ASSERT_GT(len, 0);
+        ASSERT_LT(ix_compare_separator(left.data(), right.data(), len, col_types, col_lens), 0);
+        ASSERT_GE(ix_compare_separator(right.data(), right.data(), len, col_types, col_lens), 0);
+        // 去掉最后一个比较单位：TYPE_STRING字段的一个字节，或其他类型的整个字段
+        int col = 0;
+        int col_start = 0;
+        while (col_start + col_lens[col] < len) {
+            col_start += col_lens[col++];
+        }
+        int shorter = col_types[col] == TYPE_STRING ? len - 1 : col_start;
+        ASSERT_GE(ix_compare_separator(left.data(), right.data(), shorter, col_types, col_lens), 0);
+
+        int prefix = ix_common_prefix(left.data(), tot_len, right.data(), tot_len, col_types, col_lens);
+        ASSERT_LT(prefix, len);
+        ASSERT_EQ(ix_compare_range(left.data(), right.data(), 0, prefix, col_types, col_lens), 0);
+        ASSERT_LT(ix_compare_range(left.data(), right.data() + prefix, prefix, tot_len, col_types, col_lens), 0);
+    }
+}
+
+TEST(IxKeyComparatorTest, ShapeTest) {
+    CheckComparator({TYPE_INT}, {4});
+    CheckComparator({TYPE_INT, TYPE_INT}, {4, 4});
+    CheckComparator({TYPE_STRING}, {3});
+    CheckComparator({TYPE_INT, TYPE_STRING}, {4, 2});
+    CheckComparator({TYPE_FLOAT, TYPE_INT, TYPE_STRING}, {4, 4, 2});
+}
+
+TEST(IxKeyComparatorTest, SeparatorTest) {
+    CheckSeparator({TYPE_INT}, {4});
+    CheckSeparator({TYPE_STRING}, {3});
+    CheckSeparator({TYPE_INT, TYPE_STRING}, {4, 2});
+    CheckSeparator({TYPE_STRING, TYPE_FLOAT, TYPE_STRING}, {3, 4, 2});
+}
+
+/**
+ * @brief 分隔key截断在TYPE_STRING字段内部，公共前缀只包含相等的完整字段和字符串中相等的字节
+ */
+TEST(IxKeyComparatorTest, SeparatorExampleTest) {
+    std::vector<ColType> col_types = {TYPE_STRING, TYPE_INT};
+    std::vector<int> col_lens = {8, 4};
+    char left[12] = "user0012";
+    char right[12] = "user0107";
+    int left_id = 7;
+    int right_id = 3;
+    memcpy(left + 8, &left_id, sizeof(int));
+    memcpy(right + 8, &right_id, sizeof(int));
+    EXPECT_EQ(ix_separator_len(left, right, col_types, col_lens), 6);
+    EXPECT_EQ(ix_common_prefix(left, 12, right, 12, col_types, col_lens), 5);
+    EXPECT_EQ(ix_common_prefix(left, 3, right, 12, col_types, col_lens), 3);
+    // "user01"不大于right，大于left和所有以"user00"开头的key
+    EXPECT_GT(ix_compare_separator(right, right, 6, col_types, col_lens), 0);
+    EXPECT_LT(ix_compare_separator(left, right, 6, col_types, col_lens), 0);
+
+    // 字符串相同时在整数字段之后截断，整数字段不截断
+    memcpy(right, left, 8);
+    EXPECT_EQ(ix_separator_len(right, left, col_types, col_lens), 12);
+    EXPECT_EQ(ix_common_prefix(left, 12, right, 12, col_types, col_lens), 8);
+    EXPECT_EQ(ix_compare_separator(left, left, 12, col_types, col_lens), 0);
+}
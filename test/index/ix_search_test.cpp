@@ -0,0 +1,44 @@
+#include "index/ix_search.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 用std::lower_bound/std::upper_bound校验查找内核，数组包含重复key，target覆盖数组范围之外的值
+ */
+template <typename T>
+void CheckSearchKernels(bool avx2) {
+    std::default_random_engine rng(2023);
+    std::uniform_int_distribution<int> dist(-200, 200);
+    for (int n = 0; n <= 600; n += (n < 80 ? 1 : 37)) {
+        std::vector<T> keys(n);
+        for (auto &key : keys) {
+            key = static_cast<T>(dist(rng)) / 2;
+        }
+        std::sort(keys.begin(), keys.end());
+        for (int v = -210; v <= 210; v += 3) {
+            T target = static_cast<T>(v) / 2;
+            int lower = std::lower_bound(keys.begin(), keys.end(), target) - keys.begin();
+            int upper = std::upper_bound(keys.begin(), keys.end(), target) - keys.begin();
+            ASSERT_EQ((ix_search_keys<T, false>(keys.data(), n, target, avx2)), lower) << "n=" << n << " v=" << v;
+            ASSERT_EQ((ix_search_keys<T, true>(keys.data(), n, target, avx2)), upper) << "n=" << n << " v=" << v;
+        }
+    }
+}
+
+TEST(IxSearchTest, IntTest) {
+    CheckSearchKernels<int32_t>(false);
+    if (ix_cpu_has_avx2()) {
+        CheckSearchKernels<int32_t>(true);
+    }
+}
+
+TEST(IxSearchTest, FloatTest) {
+    CheckSearchKernels<float>(false);
+    if (ix_cpu_has_avx2()) {
+        CheckSearchKernels<float>(true);
+    }
+}
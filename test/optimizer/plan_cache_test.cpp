@@ -0,0 +1,22 @@
+#include "gtest/gtest.h"
+
+#include "optimizer/plan_cache.h"
+
+// 字符串常量之外的空白合并为一个空格，结尾的分号被去掉
+TEST(PlanCacheTest, Normalize) {
+    EXPECT_EQ(PlanCache::normalize("select *  from\ttb\nwhere a = 1;"), "select * from tb where a = 1");
+    EXPECT_EQ(PlanCache::normalize("  select * from tb ;  "), "select * from tb");
+    EXPECT_EQ(PlanCache::normalize("select * from tb where c = 'a  b';"), "select * from tb where c = 'a  b'");
+    // 表名和字段名区分大小写
+    EXPECT_NE(PlanCache::normalize("select * from TB;"), PlanCache::normalize("select * from tb;"));
+}
+
+// 以不同名字PREPARE的相同语句得到相同的key
+TEST(PlanCacheTest, PrepareKey) {
+    EXPECT_EQ(PlanCache::prepare_key("prepare q1 as select * from tb where a = $1;"),
+              "select * from tb where a = $1");
+    EXPECT_EQ(PlanCache::prepare_key("PREPARE q2\nAS  select * from tb where a = $1"),
+              PlanCache::prepare_key("prepare q1 as select * from tb where a = $1;"));
+    EXPECT_NE(PlanCache::prepare_key("prepare q as select * from tb where a = $1;"),
+              PlanCache::prepare_key("prepare q as select * from tb where b = $1;"));
+}
@@ -0,0 +1,182 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "analyze/analyze.h"
+#include "optimizer/planner.h"
+
+namespace {
+
+const std::string DB_NAME = "planner_test_db";
+
+using ColList = std::vector<std::shared_ptr<ast::Col>>;
+using CondList = std::vector<std::shared_ptr<ast::BinaryExpr>>;
+
+std::shared_ptr<ast::BinaryExpr> ValueCond(const std::string &tab, const std::string &col, ast::SvCompOp op, int v) {
+    return std::make_shared<ast::BinaryExpr>(std::make_shared<ast::Col>(tab, col), op, std::make_shared<ast::IntLit>(v));
+}
+
+std::shared_ptr<ast::BinaryExpr> JoinCond(const std::string &lhs_tab, const std::string &lhs_col,
+                                          const std::string &rhs_tab, const std::string &rhs_col) {
+    return std::make_shared<ast::BinaryExpr>(std::make_shared<ast::Col>(lhs_tab, lhs_col), ast::SV_OP_EQ,
+                                             std::make_shared<ast::Col>(rhs_tab, rhs_col));
+}
+
+// 计划中的全部扫描的表
+void CollectTables(const std::shared_ptr<Plan> &plan, std::set<std::string> &tables) {
+    if (auto x = std::dynamic_pointer_cast<ScanPlan>(plan)) {
+        tables.insert(x->tab_name_);
+    } else if (auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
+        CollectTables(x->left_, tables);
+        CollectTables(x->right_, tables);
+    }
+}
+
+std::set<std::string> Tables(const std::shared_ptr<Plan> &plan) {
+    std::set<std::string> tables;
+    CollectTables(plan, tables);
+    return tables;
+}
+
+class PlannerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    /**
+     * @description: 建表(a INT, b INT, c INT)并插入num_rows条记录，第i条记录为(i % a_keys, i % b_keys, i)，
+     *               之后ANALYZE收集统计信息
+     */
+    void create_table(const std::string &tab_name, int num_rows, int a_keys, int b_keys) {
+        sm_manager_->create_table(tab_name, {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_INT, 4}}, nullptr);
+        RmFileHandle *fh = sm_manager_->get_table_handle(tab_name).fh;
+        for (int i = 0; i < num_rows; i++) {
+            int rec[3] = {i % a_keys, i % b_keys, i};
+            fh->insert_record(reinterpret_cast<char *>(rec), &context_);
+        }
+        sm_manager_->analyze_table(tab_name, &context_);
+    }
+
+    // 生成SELECT * FROM tabs WHERE conds的计划，返回投影之下的计划
+    std::shared_ptr<Plan> plan_select(const std::vector<std::string> &tabs, CondList conds) {
+        auto stmt = std::make_shared<ast::SelectStmt>(ColList{}, tabs, std::move(conds), ColList{},
+                                                      std::vector<std::shared_ptr<ast::OrderBy>>{});
+        Analyze analyze(sm_manager_.get());
+        Planner planner(sm_manager_.get());
+        auto plan = planner.do_planner(analyze.do_analyze(stmt), &context_);
+        auto select = std::dynamic_pointer_cast<DMLPlan>(plan);
+        EXPECT_NE(select, nullptr);
+        auto projection = std::dynamic_pointer_cast<ProjectionPlan>(select->subplan_);
+        EXPECT_NE(projection, nullptr);
+        return projection->subplan_;
+    }
+
+    // 单表查询选择的访问路径
+    std::shared_ptr<ScanPlan> plan_scan(const std::string &tab_name, CondList conds) {
+        auto scan = std::dynamic_pointer_cast<ScanPlan>(plan_select({tab_name}, std::move(conds)));
+        EXPECT_NE(scan, nullptr);
+        return scan;
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    Context context_{nullptr, nullptr, nullptr};
+};
+
+}  // namespace
+
+/**
+ * @brief 链式连接big-mid-small按FROM的顺序应先连接big和mid(10000条中间结果)，
+ *        按代价应先连接mid和small(100条中间结果)，big最后连接
+ */
+TEST_F(PlannerTest, JoinOrderFollowsEstimatedCost) {
+    create_table("big", 10000, 1000, 1000);
+    create_table("mid", 1000, 1000, 100);
+    create_table("small", 10, 10, 10);
+    CondList conds = {JoinCond("big", "a", "mid", "a"), JoinCond("mid", "b", "small", "b")};
+    auto root = std::dynamic_pointer_cast<JoinPlan>(plan_select({"big", "mid", "small"}, conds));
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(Tables(root), (std::set<std::string>{"big", "mid", "small"}));
+    auto left = Tables(root->left_);
+    auto right = Tables(root->right_);
+    auto inner_join = left.count("big") != 0 ? right : left;
+    EXPECT_EQ(inner_join, (std::set<std::string>{"mid", "small"}));
+    EXPECT_NE(std::dynamic_pointer_cast<JoinPlan>(left.count("big") != 0 ? root->right_ : root->left_), nullptr);
+
+    // 表的顺序不影响选择的连接顺序
+    root = std::dynamic_pointer_cast<JoinPlan>(plan_select({"small", "big", "mid"}, conds));
+    ASSERT_NE(root, nullptr);
+    left = Tables(root->left_);
+    right = Tables(root->right_);
+    EXPECT_EQ(left.count("big") != 0 ? right : left, (std::set<std::string>{"mid", "small"}));
+}
+
+/**
+ * @brief 没有连接条件的两个表只有在子集内不存在有条件的划分时才做笛卡尔积：
+ *        big-mid-small中small与big之间没有条件，不先连接它们
+ */
+TEST_F(PlannerTest, JoinOrderAvoidsCrossProduct) {
+    create_table("big", 10000, 1000, 1000);
+    create_table("mid", 1000, 1000, 100);
+    create_table("small", 10, 10, 10);
+    CondList conds = {JoinCond("big", "a", "mid", "a"), JoinCond("mid", "b", "small", "b")};
+    auto root = std::dynamic_pointer_cast<JoinPlan>(plan_select({"big", "small", "mid"}, conds));
+    ASSERT_NE(root, nullptr);
+    for (auto &child : {root->left_, root->right_}) {
+        EXPECT_NE(Tables(child), (std::set<std::string>{"big", "small"}));
+    }
+}
+
+/**
+ * @brief 按统计信息估计选择率后比较代价：选择性高的条件使用索引扫描，
+ *        匹配大部分记录的条件、没有条件或条件不在索引字段上时使用顺序扫描
+ */
+TEST_F(PlannerTest, IndexVersusSeqScan) {
+    create_table("t", 10000, 10000, 2);
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    sm_manager_->analyze_table("t", &context_);
+
+    auto scan = plan_scan("t", {ValueCond("t", "a", ast::SV_OP_EQ, 5)});
+    EXPECT_EQ(scan->tag, T_IndexScan);
+    EXPECT_EQ(scan->index_col_names_, std::vector<std::string>{"a"});
+
+    EXPECT_EQ(plan_scan("t", {ValueCond("t", "a", ast::SV_OP_LT, 20)})->tag, T_IndexScan);
+    EXPECT_EQ(plan_scan("t", {ValueCond("t", "a", ast::SV_OP_GT, 10)})->tag, T_SeqScan);
+    EXPECT_EQ(plan_scan("t", {ValueCond("t", "a", ast::SV_OP_NE, 5)})->tag, T_SeqScan);
+    EXPECT_EQ(plan_scan("t", {})->tag, T_SeqScan);
+    // b上的条件不能使用a上的索引
+    EXPECT_EQ(plan_scan("t", {ValueCond("t", "b", ast::SV_OP_EQ, 1)})->tag, T_SeqScan);
+
+    // b上的索引：b只有2种取值，等值条件匹配一半的记录，逐条取回记录比顺序扫描代价更高
+    sm_manager_->create_index("t", {"b"}, nullptr);
+    sm_manager_->analyze_table("t", &context_);
+    EXPECT_EQ(plan_scan("t", {ValueCond("t", "b", ast::SV_OP_EQ, 1)})->tag, T_SeqScan);
+    // 两个索引都可用时选择代价较小的a上的索引
+    scan = plan_scan("t", {ValueCond("t", "b", ast::SV_OP_EQ, 1), ValueCond("t", "a", ast::SV_OP_EQ, 13)});
+    EXPECT_EQ(scan->tag, T_IndexScan);
+    EXPECT_EQ(scan->index_col_names_, std::vector<std::string>{"a"});
+}
@@ -0,0 +1,141 @@
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include "gtest/gtest.h"
+#include "optimizer/result_cache.h"
+#include "record/rm.h"
+
+namespace {
+
+const std::string DB_NAME = "result_cache_test_db";
+
+class ResultCacheTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+        sm_manager_->create_table("t", {{"a", TYPE_INT, 4}}, nullptr);
+        sm_manager_->create_table("s", {{"a", TYPE_INT, 4}}, nullptr);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    // select * from t, s的计划
+    std::shared_ptr<Plan> select_plan() {
+        auto t = std::make_shared<ScanPlan>(T_SeqScan, sm_manager_.get(), "t", std::vector<Condition>(),
+                                            std::vector<std::string>());
+        auto s = std::make_shared<ScanPlan>(T_SeqScan, sm_manager_.get(), "s", std::vector<Condition>(),
+                                            std::vector<std::string>());
+        auto join = std::make_shared<JoinPlan>(T_NestLoop, t, s, std::vector<Condition>());
+        auto projection = std::make_shared<ProjectionPlan>(T_Projection, join, std::vector<TabCol>());
+        return std::make_shared<DMLPlan>(T_select, projection, std::string(), std::vector<Value>(),
+                                         std::vector<Condition>(), std::vector<SetClause>());
+    }
+
+    // 执行select之后保存结果
+    bool insert(ResultCache &cache, const std::string &key, timestamp_t start_ts) {
+        auto entry = std::make_shared<CachedResult>();
+        EXPECT_TRUE(cache.prepare(select_plan(), sm_manager_->schema_version_, entry.get()));
+        entry->key = key;
+        entry->frames = "frames of " + key;
+        entry->log_text = "log of " + key;
+        return cache.insert(std::move(entry), start_ts);
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+};
+
+}  // namespace
+
+// 参数的值和结果的格式不同时key不同
+TEST(ResultCacheKeyTest, MakeKey) {
+    Value one, two, str;
+    one.set_int(1);
+    two.set_int(2);
+    str.set_str("1");
+    std::string sql = "select * from t where a = $1";
+    EXPECT_EQ(ResultCache::make_key(sql, {one}, false), ResultCache::make_key(sql, {one}, false));
+    EXPECT_NE(ResultCache::make_key(sql, {one}, false), ResultCache::make_key(sql, {two}, false));
+    EXPECT_NE(ResultCache::make_key(sql, {one}, false), ResultCache::make_key(sql, {str}, false));
+    EXPECT_NE(ResultCache::make_key(sql, {one}, false), ResultCache::make_key(sql, {one}, true));
+    EXPECT_NE(ResultCache::make_key(sql, {}, false), ResultCache::make_key(sql, {one}, false));
+}
+
+// 只缓存select，读取的任何一张表中的数据或schema变化后缓存的结果失效
+TEST_F(ResultCacheTest, InvalidatedByTableVersions) {
+    ResultCache cache(sm_manager_.get());
+    CachedResult entry;
+    auto insert_plan = std::make_shared<DMLPlan>(T_Insert, nullptr, "t", std::vector<Value>(),
+                                                 std::vector<Condition>(), std::vector<SetClause>());
+    EXPECT_FALSE(cache.prepare(insert_plan, sm_manager_->schema_version_, &entry));
+
+    ASSERT_TRUE(insert(cache, "q", 1));
+    auto hit = cache.lookup("q");
+    ASSERT_NE(hit, nullptr);
+    EXPECT_EQ(hit->frames, "frames of q");
+    EXPECT_EQ(hit->log_text, "log of q");
+    EXPECT_EQ(hit->tables.size(), 2u);
+    EXPECT_EQ(cache.lookup("other"), nullptr);
+
+    // 写入s使结果失效，失效的结果被丢弃
+    sm_manager_->get_table_handle("s").bump_data_version();
+    EXPECT_EQ(cache.lookup("q"), nullptr);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.bytes(), 0u);
+
+    ASSERT_TRUE(insert(cache, "q", 1));
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    EXPECT_EQ(cache.lookup("q"), nullptr);
+}
+
+// 执行期间数据发生变化，或者快照开始之后有修改过表的事务结束时，结果不被保存
+TEST_F(ResultCacheTest, RejectsStaleResults) {
+    ResultCache cache(sm_manager_.get());
+    auto entry = std::make_shared<CachedResult>();
+    ASSERT_TRUE(cache.prepare(select_plan(), sm_manager_->schema_version_, entry.get()));
+    entry->key = "q";
+    sm_manager_->get_table_handle("t").bump_data_version();
+    EXPECT_FALSE(cache.insert(entry, 1));
+
+    int t_id = sm_manager_->db_.get_table("t").id;
+    sm_manager_->mark_table_committed(t_id, 10);
+    EXPECT_FALSE(insert(cache, "q", 10));
+    EXPECT_TRUE(insert(cache, "q", 11));
+    EXPECT_NE(cache.lookup("q"), nullptr);
+}
+
+// 超过容量时淘汰最久未使用的结果
+TEST_F(ResultCacheTest, EvictsLeastRecentlyUsed) {
+    size_t entry_bytes;
+    {
+        ResultCache probe(sm_manager_.get());
+        ASSERT_TRUE(insert(probe, "q1", 1));
+        entry_bytes = probe.bytes();
+    }
+    ResultCache cache(sm_manager_.get(), entry_bytes * 2);
+    ASSERT_TRUE(insert(cache, "q1", 1));
+    ASSERT_TRUE(insert(cache, "q2", 1));
+    EXPECT_NE(cache.lookup("q1"), nullptr);
+    ASSERT_TRUE(insert(cache, "q3", 1));
+    EXPECT_EQ(cache.size(), 2u);
+    EXPECT_NE(cache.lookup("q1"), nullptr);
+    EXPECT_EQ(cache.lookup("q2"), nullptr);
+    EXPECT_NE(cache.lookup("q3"), nullptr);
+}
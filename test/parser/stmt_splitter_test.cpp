@@ -0,0 +1,100 @@
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "parser/stmt_splitter.h"
+
+static size_t split(const std::string &request, std::vector<std::string> &stmts) {
+    return split_statements(request.c_str(), request.size(), stmts);
+}
+
+// 一次请求中的多条语句按顺序拆分，空白和空语句被忽略
+TEST(StmtSplitterTest, SplitsPipelinedStatements) {
+    std::string request = "insert into t values (1);\n insert into t values (2);;  select * from t;\n";
+    std::vector<std::string> stmts;
+    EXPECT_EQ(split(request, stmts), request.size() - 1);
+    ASSERT_EQ(stmts.size(), 3);
+    EXPECT_EQ(stmts[0], "insert into t values (1);");
+    EXPECT_EQ(stmts[1], "insert into t values (2);");
+    EXPECT_EQ(stmts[2], "select * from t;");
+}
+
+// 字符串常量和注释中的分号不结束语句
+TEST(StmtSplitterTest, IgnoresQuotedSemicolons) {
+    std::string request = "insert into t values ('a;b'); -- c;d\nselect /* e;f */ * from t;";
+    std::vector<std::string> stmts;
+    EXPECT_EQ(split(request, stmts), request.size());
+    ASSERT_EQ(stmts.size(), 2);
+    EXPECT_EQ(stmts[0], "insert into t values ('a;b');");
+    EXPECT_EQ(stmts[1], "-- c;d\nselect /* e;f */ * from t;");
+}
+
+// 最后一个分号之后的内容不属于任何语句，没有分号时不拆分出语句
+TEST(StmtSplitterTest, LeavesIncompleteTail) {
+    std::vector<std::string> stmts;
+    std::string request = "delete from t; insert into t values ('x;";
+    EXPECT_EQ(split(request, stmts), strlen("delete from t;"));
+    ASSERT_EQ(stmts.size(), 1);
+    EXPECT_EQ(stmts[0], "delete from t;");
+
+    stmts.clear();
+    EXPECT_EQ(split("exit", stmts), 0);
+    EXPECT_TRUE(stmts.empty());
+}
+
+// 向缓冲区写入一次读取的数据，取出其中完整的语句
+static bool feed(RequestBuffer &buffer, const std::string &data, std::vector<std::string> &stmts) {
+    EXPECT_LE(data.size(), buffer.space_left());
+    memcpy(buffer.space(), data.data(), data.size());
+    return buffer.consume(data.size(), stmts);
+}
+
+// 一条语句被分在两次读取中，前一次读取中不完整的部分与下一次读取的数据拼接后执行
+TEST(StmtSplitterTest, JoinsStatementAcrossReads) {
+    RequestBuffer buffer(64);
+    std::vector<std::string> stmts;
+    EXPECT_FALSE(feed(buffer, "insert into t values (1); insert into t val", stmts));
+    ASSERT_EQ(stmts.size(), 1);
+    EXPECT_EQ(stmts[0], "insert into t values (1);");
+    EXPECT_EQ(buffer.space_left(), 64 - strlen(" insert into t val"));
+
+    stmts.clear();
+    EXPECT_FALSE(feed(buffer, "ues ('a;", stmts));
+    EXPECT_TRUE(stmts.empty());
+    EXPECT_FALSE(feed(buffer, "b'); select * from t;", stmts));
+    ASSERT_EQ(stmts.size(), 2);
+    EXPECT_EQ(stmts[0], "insert into t values ('a;b');");
+    EXPECT_EQ(stmts[1], "select * from t;");
+    EXPECT_EQ(buffer.space_left(), 64);
+
+    // 没有分号的请求作为一条完整的语句
+    stmts.clear();
+    EXPECT_FALSE(feed(buffer, "exit", stmts));
+    ASSERT_EQ(stmts.size(), 1);
+    EXPECT_EQ(stmts[0], "exit");
+}
+
+// 超过缓冲区的语句不执行任何部分，它剩余的部分被丢弃，之后的语句照常执行
+TEST(StmtSplitterTest, RejectsStatementLargerThanBuffer) {
+    RequestBuffer buffer(16);
+    std::vector<std::string> stmts;
+    EXPECT_FALSE(feed(buffer, "delete from t; s", stmts));
+    ASSERT_EQ(stmts.size(), 1);
+    stmts.clear();
+    EXPECT_TRUE(feed(buffer, "elect * from t", stmts));
+    EXPECT_TRUE(stmts.empty());
+    EXPECT_FALSE(feed(buffer, " where a = 1 and", stmts));
+    EXPECT_FALSE(feed(buffer, " b", stmts));
+    EXPECT_FALSE(feed(buffer, " = 2; drop t;", stmts));
+    ASSERT_EQ(stmts.size(), 1);
+    EXPECT_EQ(stmts[0], "drop t;");
+
+    // 没有分号的请求丢弃到请求结束
+    stmts.clear();
+    EXPECT_TRUE(feed(buffer, "select * from tt", stmts));
+    EXPECT_FALSE(feed(buffer, "where a = 1", stmts));
+    EXPECT_TRUE(stmts.empty());
+    EXPECT_FALSE(feed(buffer, "exit", stmts));
+    ASSERT_EQ(stmts.size(), 1);
+    EXPECT_EQ(stmts[0], "exit");
+}
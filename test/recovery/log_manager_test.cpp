@@ -0,0 +1,130 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "recovery/log_manager.h"
+#include "transaction/transaction.h"
+
+namespace {
+
+// 读取日志文件，检查lsn从0开始连续，返回日志记录数
+int check_log_file(DiskManager *disk_manager) {
+    std::vector<char> data(disk_manager->get_file_size(LOG_FILE_NAME));
+    disk_manager->read_log(data.data(), data.size(), 0);
+    int offset = 0;
+    lsn_t expected = 0;
+    while (offset < static_cast<int>(data.size())) {
+        LogRecord record;
+        record.deserialize(data.data() + offset);
+        EXPECT_EQ(record.lsn_, expected++);
+        offset += record.log_tot_len_;
+    }
+    return expected;
+}
+
+std::unique_ptr<DiskManager> create_log_file() {
+    auto disk_manager = std::make_unique<DiskManager>();
+    if (disk_manager->is_file(LOG_FILE_NAME)) {
+        disk_manager->destroy_file(LOG_FILE_NAME);
+    }
+    disk_manager->create_file(LOG_FILE_NAME);
+    return disk_manager;
+}
+
+}  // namespace
+
+/**
+ * @brief 多个事务并发写日志并等待持久化，返回时自己的日志已经持久化，日志文件按LSN顺序包含所有记录
+ */
+TEST(LogManagerTest, GroupCommit) {
+    auto disk_manager = create_log_file();
+
+    constexpr int num_threads = 8;
+    constexpr int txns_per_thread = 50;
+    {
+        LogManager log_manager(disk_manager.get());
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < txns_per_thread; i++) {
+                    Transaction txn(t * txns_per_thread + i);
+                    CommitLogRecord commit_record(txn.get_transaction_id());
+                    lsn_t lsn = log_manager.append_txn_log(&txn, &commit_record);
+                    log_manager.wait_for_persist(lsn);
+                    ASSERT_GE(log_manager.get_persist_lsn(), lsn);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // 每个事务写入begin和commit两条记录
+    ASSERT_EQ(check_log_file(disk_manager.get()), num_threads * txns_per_thread * 2);
+}
+
+/**
+ * @brief 并发写入的日志超过多个缓冲区的大小，缓冲区切换时日志不丢失、不重叠，lsn连续
+ */
+TEST(LogManagerTest, RotateBuffers) {
+    auto disk_manager = create_log_file();
+
+    constexpr int num_threads = 8;
+    constexpr int records_per_thread = 1000;
+    std::string value(2000, 'x');
+    {
+        LogManager log_manager(disk_manager.get());
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                Transaction txn(t);
+                for (int i = 0; i < records_per_thread; i++) {
+                    Rid rid{i, t};
+                    InsertLogRecord insert_record(txn.get_transaction_id(), 0, rid, value.data(), value.size());
+                    log_manager.append_txn_log(&txn, &insert_record);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        log_manager.flush_log_to_disk();
+    }
+    ASSERT_GT(disk_manager->get_file_size(LOG_FILE_NAME), 2 * LOG_BUFFER_SIZE);
+    // 每个事务多写入一条begin记录
+    ASSERT_EQ(check_log_file(disk_manager.get()), num_threads * (records_per_thread + 1));
+}
+
+/**
+ * @brief update日志只记录变化的字节区间，相距很近的区间合并，序列化后仍能重做和撤销
+ */
+TEST(LogManagerTest, UpdateDiffs) {
+    std::string old_value(200, 'a');
+    std::string new_value = old_value;
+    new_value[3] = 'b';
+    new_value[6] = 'b';     // 与上一个区间相距2字节，合并
+    new_value.replace(100, 8, "bbbbbbbb");
+    new_value[199] = 'b';
+
+    UpdateLogRecord update_record(1, 7, Rid{2, 3}, old_value.data(), new_value.data(), old_value.size());
+    ASSERT_EQ(update_record.num_diffs_, 3);
+    ASSERT_LT(update_record.log_tot_len_, old_value.size());
+
+    std::vector<char> buf(update_record.log_tot_len_);
+    update_record.lsn_ = 5;
+    update_record.serialize(buf.data());
+    UpdateLogRecord read_record;
+    read_record.deserialize(buf.data());
+    ASSERT_EQ(read_record.log_type_, LogType::UPDATE);
+    ASSERT_EQ(read_record.lsn_, 5);
+    ASSERT_EQ(read_record.table_id_, 7);
+    ASSERT_EQ(read_record.rid_, (Rid{2, 3}));
+
+    std::string slot = old_value;
+    read_record.redo(slot.data());
+    ASSERT_EQ(slot, new_value);
+    read_record.undo(slot.data());
+    ASSERT_EQ(slot, old_value);
+}
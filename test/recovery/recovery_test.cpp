@@ -0,0 +1,355 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "record/rm.h"
+#include "recovery/log_recovery.h"
+#include "transaction/transaction.h"
+#include "transaction/transaction_manager.h"
+
+namespace {
+
+const std::string DB_NAME = "recovery_test_db";
+constexpr int MAX_KEY = 4000;   // 测试中出现的最大键值
+
+// 一次运行中的存储层和系统管理器，析构时不写回缓冲池，模拟崩溃
+struct Instance {
+    std::unique_ptr<DiskManager> disk_manager = std::make_unique<DiskManager>();
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager =
+        std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    std::unique_ptr<RmManager> rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    std::unique_ptr<IxManager> ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    std::unique_ptr<SmManager> sm_manager = std::make_unique<SmManager>(
+        disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    std::unique_ptr<LogManager> log_manager;
+
+    // 打开数据库并完成恢复，undo结束后返回
+    size_t open_and_recover() {
+        sm_manager->open_db(DB_NAME);
+        log_manager = std::make_unique<LogManager>(disk_manager.get());
+        RecoveryManager recovery(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get(), log_manager.get());
+        recovery.analyze();
+        recovery.redo();
+        recovery.undo();
+        recovery.wait_for_undo({});
+        return recovery.get_num_redone();
+    }
+
+    // 创建数据库和带索引的表t(a, b)
+    void create(TableLayout layout = TableLayout::ROW) {
+        if (system(("rm -rf " + DB_NAME).c_str()) != 0) {
+            throw UnixError();
+        }
+        sm_manager->create_db(DB_NAME);
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+        sm_manager->open_db(DB_NAME);
+        sm_manager->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}}, nullptr, layout);
+        sm_manager->create_index("t", {"a"}, nullptr);
+        log_manager = std::make_unique<LogManager>(disk_manager.get());
+    }
+
+    // 崩溃：日志已经写入的部分保留，缓冲池中的页面丢失
+    void crash() {
+        log_manager.reset();
+        if (chdir("..") < 0) {
+            throw UnixError();
+        }
+    }
+
+    RmFileHandle *table() { return sm_manager->get_table_handle("t").fh; }
+
+    IxIndexHandle *index() { return sm_manager->get_table_handle("t").indexes[0].ih; }
+};
+
+// 像DML执行器一样先写日志再推进page_lsn
+class Writer {
+   public:
+    Writer(Instance *instance, txn_id_t txn_id) : instance_(instance), txn_(txn_id) {}
+
+    Rid insert(int a, int b) {
+        int record[2] = {a, b};
+        Rid rid = instance_->table()->insert_record(reinterpret_cast<char *>(record), nullptr);
+        InsertLogRecord log_record(txn_.get_transaction_id(), table_id(), rid, reinterpret_cast<char *>(record),
+                                   sizeof(record));
+        instance_->table()->set_page_lsn(rid.page_no, instance_->log_manager->append_txn_log(&txn_, &log_record));
+        return rid;
+    }
+
+    void update(const Rid &rid, int b) {
+        auto old_record = instance_->table()->get_record(rid, nullptr);
+        int record[2] = {*reinterpret_cast<int *>(old_record->data), b};
+        UpdateLogRecord log_record(txn_.get_transaction_id(), table_id(), rid, old_record->data,
+                                   reinterpret_cast<char *>(record), sizeof(record));
+        lsn_t lsn = instance_->log_manager->append_txn_log(&txn_, &log_record);
+        instance_->table()->update_record(rid, reinterpret_cast<char *>(record), nullptr);
+        instance_->table()->set_page_lsn(rid.page_no, lsn);
+    }
+
+    void remove(const Rid &rid) {
+        auto old_record = instance_->table()->get_record(rid, nullptr);
+        DeleteLogRecord log_record(txn_.get_transaction_id(), table_id(), rid, old_record->data, old_record->size);
+        lsn_t lsn = instance_->log_manager->append_txn_log(&txn_, &log_record);
+        instance_->table()->delete_record(rid, nullptr);
+        instance_->table()->set_page_lsn(rid.page_no, lsn);
+    }
+
+    void commit() {
+        CommitLogRecord log_record(txn_.get_transaction_id());
+        instance_->log_manager->wait_for_persist(instance_->log_manager->append_txn_log(&txn_, &log_record));
+    }
+
+   private:
+    int table_id() { return instance_->sm_manager->db_.get_table("t").id; }
+
+    Instance *instance_;
+    Transaction txn_;
+};
+
+// 表中恰好有a为[0, n)、b等于a的记录，索引与表一致
+void check_table(Instance *instance, int n) {
+    std::vector<int> seen(n, 0);
+    size_t count = 0;
+    for (RmScan scan(instance->table()); !scan.is_end(); scan.next()) {
+        const int *record = reinterpret_cast<const int *>(scan.record());
+        ASSERT_GE(record[0], 0);
+        ASSERT_LT(record[0], n);
+        ASSERT_EQ(record[1], record[0]);
+        seen[record[0]]++;
+        count++;
+    }
+    ASSERT_EQ(count, static_cast<size_t>(n));
+    Transaction txn(INVALID_TXN_ID);
+    for (int a = 0; a < MAX_KEY; a++) {
+        std::vector<Rid> rids;
+        bool found = instance->index()->get_value(reinterpret_cast<const char *>(&a), &rids, &txn);
+        ASSERT_EQ(found, a < n) << a;
+    }
+}
+
+}  // namespace
+
+/**
+ * @brief 已提交事务的修改在页面丢失后被重做，未提交事务的插入、更新、删除被撤销，
+ *        恢复之后再次崩溃仍然得到相同的结果
+ */
+TEST(RecoveryTest, RedoCommittedUndoLosers) {
+    constexpr int num_committed = 2000;
+    {
+        Instance instance;
+        instance.create();
+
+        Writer committed(&instance, 1);
+        std::vector<Rid> rids;
+        for (int a = 0; a < num_committed; a++) {
+            rids.push_back(committed.insert(a, a));
+        }
+        committed.commit();
+        // 一部分页面在崩溃前已经写回，重做时按page_lsn跳过
+        instance.buffer_pool_manager->flush_page(PageId{instance.table()->GetFd(), rids[0].page_no});
+
+        Writer loser(&instance, 2);
+        for (int a = num_committed; a < num_committed + 100; a++) {
+            loser.insert(a, a);
+        }
+        for (int i = 0; i < 50; i++) {
+            loser.update(rids[i], -1);
+            loser.remove(rids[num_committed - 1 - i]);
+        }
+        instance.log_manager->flush_log_to_disk();
+        instance.crash();
+    }
+    {
+        Instance instance;
+        ASSERT_GT(instance.open_and_recover(), 0u);
+        check_table(&instance, num_committed);
+        instance.crash();
+    }
+    {
+        Instance instance;
+        instance.open_and_recover();
+        check_table(&instance, num_committed);
+        instance.sm_manager->close_db();
+    }
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+}
+
+/**
+ * @brief 后台undo仍在以失败事务的ID写日志时开始的新事务分配到更大的ID，它的提交不会被当作失败事务的提交，
+ *        再次崩溃后失败事务的修改仍然被撤销，新事务的修改被重做
+ */
+TEST(RecoveryTest, NewTxnDuringUndo) {
+    constexpr int num_committed = 100;
+    constexpr int num_loser = 2000;
+    constexpr int num_new = 50;
+    constexpr txn_id_t loser_id = 7;
+    {
+        Instance instance;
+        instance.create();
+        Writer committed(&instance, 1);
+        for (int a = 0; a < num_committed; a++) {
+            committed.insert(a, a);
+        }
+        committed.commit();
+        Writer loser(&instance, loser_id);
+        for (int a = num_committed + num_new; a < num_committed + num_new + num_loser; a++) {
+            loser.insert(a, a);
+        }
+        instance.log_manager->flush_log_to_disk();
+        instance.crash();
+    }
+    {
+        Instance instance;
+        instance.sm_manager->open_db(DB_NAME);
+        instance.log_manager = std::make_unique<LogManager>(instance.disk_manager.get());
+        RecoveryManager recovery(instance.disk_manager.get(), instance.buffer_pool_manager.get(),
+                                 instance.sm_manager.get(), instance.log_manager.get());
+        LockManager lock_manager;
+        TransactionManager txn_manager(&lock_manager, instance.sm_manager.get());
+        recovery.analyze();
+        txn_manager.set_next_txn_id(recovery.get_next_txn_id());
+        recovery.redo();
+        recovery.undo();
+
+        Transaction *txn = txn_manager.begin(nullptr, instance.log_manager.get());
+        ASSERT_GT(txn->get_transaction_id(), loser_id);
+        Writer writer(&instance, txn->get_transaction_id());
+        for (int a = num_committed; a < num_committed + num_new; a++) {
+            writer.insert(a, a);
+        }
+        writer.commit();
+        // Writer不维护索引，表和索引在下次恢复时检查
+        recovery.wait_for_undo({});
+        instance.log_manager->flush_log_to_disk();
+        instance.crash();
+    }
+    {
+        Instance instance;
+        instance.open_and_recover();
+        check_table(&instance, num_committed + num_new);
+        instance.sm_manager->close_db();
+    }
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+}
+
+/**
+ * @description: 检查点之后日志被截断，只保留仍在进行的事务的日志；重启时检查点之前已经落盘的修改不再重做，
+ *               文件头过时的表按文件大小恢复页面数并重建索引
+ */
+TEST(RecoveryTest, CheckpointTruncatesLog) {
+    constexpr int num_before = 1000;
+    constexpr int num_after = 100;
+    constexpr int num_loser = 20;
+    {
+        Instance instance;
+        instance.create();
+        RecoveryManager recovery(instance.disk_manager.get(), instance.buffer_pool_manager.get(),
+                                 instance.sm_manager.get(), instance.log_manager.get());
+
+        Writer before(&instance, 1);
+        for (int a = 0; a < num_before; a++) {
+            before.insert(a, a);
+        }
+        before.commit();
+        Writer loser(&instance, 2);
+        for (int a = 3000; a < 3000 + num_loser / 2; a++) {
+            loser.insert(a, a);
+        }
+        instance.log_manager->flush_log_to_disk();
+        int log_size = instance.disk_manager->get_file_size(LOG_FILE_NAME);
+        instance.buffer_pool_manager->flush_all_dirty_pages();
+        recovery.checkpoint();
+        // 事务1的日志被丢弃，失败事务的日志保留到它结束
+        ASSERT_LT(instance.disk_manager->get_file_size(LOG_FILE_NAME), log_size / 10);
+        ASSERT_NE(instance.disk_manager->read_master_record(), INVALID_LSN);
+
+        Writer after(&instance, 3);
+        for (int a = num_before; a < num_before + num_after; a++) {
+            after.insert(a, a);
+        }
+        after.commit();
+        for (int a = 3000 + num_loser / 2; a < 3000 + num_loser; a++) {
+            loser.insert(a, a);
+        }
+        instance.log_manager->flush_log_to_disk();
+        instance.crash();
+    }
+    {
+        Instance instance;
+        size_t num_redone = instance.open_and_recover();
+        ASSERT_GE(num_redone, static_cast<size_t>(num_after));
+        ASSERT_LE(num_redone, static_cast<size_t>(num_after + num_loser));
+        check_table(&instance, num_before + num_after);
+        instance.sm_manager->close_db();
+    }
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+}
+
+/**
+ * @description: LSM表：memtable中的修改在崩溃时丢失，从检查点记录的memtable的recLSN开始重做，
+ *               已经写成sorted run的修改不受影响，失败事务的修改被撤销
+ */
+TEST(RecoveryTest, LsmTableRedo) {
+    constexpr int num_flushed = 1000;
+    constexpr int num_memtable = 500;
+    constexpr int num_after = 200;
+    constexpr int n = num_flushed + num_memtable + num_after;
+    {
+        Instance instance;
+        instance.create(TableLayout::LSM);
+        ASSERT_NE(instance.table()->lsm(), nullptr);
+        RecoveryManager recovery(instance.disk_manager.get(), instance.buffer_pool_manager.get(),
+                                 instance.sm_manager.get(), instance.log_manager.get());
+
+        Writer first(&instance, 1);
+        std::vector<Rid> rids;
+        for (int a = 0; a < num_flushed; a++) {
+            rids.push_back(first.insert(a, a));
+        }
+        first.commit();
+        instance.table()->lsm()->flush();
+        Writer second(&instance, 2);
+        for (int a = num_flushed; a < num_flushed + num_memtable; a++) {
+            rids.push_back(second.insert(a, a));
+        }
+        second.commit();
+        // 检查点不写出memtable，之前的日志中第二个事务的部分仍需保留
+        instance.buffer_pool_manager->flush_all_dirty_pages();
+        recovery.checkpoint();
+        ASSERT_NE(instance.table()->memtable_rec_lsn(), INVALID_LSN);
+
+        Writer third(&instance, 3);
+        for (int a = num_flushed + num_memtable; a < n; a++) {
+            third.insert(a, a);
+        }
+        third.commit();
+        Writer loser(&instance, 4);
+        for (int a = n; a < n + 50; a++) {
+            loser.insert(a, a);
+        }
+        for (int i = 0; i < 50; i++) {
+            loser.update(rids[i], -1);
+            loser.remove(rids[num_flushed + i]);
+        }
+        instance.log_manager->flush_log_to_disk();
+        instance.crash();
+    }
+    {
+        Instance instance;
+        ASSERT_GE(instance.open_and_recover(), static_cast<size_t>(num_memtable + num_after));
+        check_table(&instance, n);
+        instance.crash();
+    }
+    {
+        Instance instance;
+        instance.open_and_recover();
+        check_table(&instance, n);
+        ASSERT_EQ(instance.table()->count_records(), static_cast<size_t>(n));
+        instance.sm_manager->close_db();
+    }
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+}
@@ -0,0 +1,40 @@
+#include "record/bitmap.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 用逐位判断的结果校验按字查找和计数，长度覆盖不足一个字节、一个字以及跨多个字的情况
+ */
+TEST(BitmapTest, WordScanTest) {
+    std::default_random_engine rng(2023);
+    for (int max_n = 1; max_n <= 300; max_n++) {
+        for (int density : {0, 3, 50, 97, 100}) {
+            int size = (max_n + BITMAP_WIDTH - 1) / BITMAP_WIDTH;
+            // bitmap末尾之后的字节填满1，按字读取不能越界读到它们
+            std::vector<char> buf(size + 8, static_cast<char>(0xff));
+            char *bm = buf.data();
+            Bitmap::init(bm, size);
+            int expected_count = 0;
+            for (int i = 0; i < max_n; i++) {
+                if (static_cast<int>(rng() % 100) < density) {
+                    Bitmap::set(bm, i);
+                    expected_count++;
+                }
+            }
+            EXPECT_EQ(Bitmap::count(bm, max_n), expected_count);
+            for (bool bit : {false, true}) {
+                for (int curr = -1; curr < max_n; curr++) {
+                    int expected = curr + 1;
+                    while (expected < max_n && Bitmap::is_set(bm, expected) != bit) {
+                        expected++;
+                    }
+                    ASSERT_EQ(Bitmap::next_bit(bit, bm, max_n, curr), expected)
+                        << "max_n=" << max_n << " bit=" << bit << " curr=" << curr;
+                }
+            }
+        }
+    }
+}
@@ -1,8 +1,11 @@
 #include "storage/buffer_pool_manager.h"
+#include "storage/buffer_pool_warmer.h"
+#include "storage/page_flusher.h"
 
 #include <cassert>
 #include <cstring>
 #include <ctime>
+#include <fstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -427,3 +430,299 @@ TEST_F(BufferPoolManagerTest, ConcurrencyTest) {
 
     disk_manager_->close_file(fd);
 }
+
+/**
+ * @brief 分片缓冲池测试（单文件）：页面按PageId分散到各分片，淘汰后重新读取的数据应与写入时一致
+ * @note 生成测试文件sharded_test
+ */
+TEST_F(BufferPoolManagerTest, ShardedTest) {
+    const std::string filename = "sharded_test";
+    const size_t buffer_pool_size = 64;
+    const size_t num_instances = 4;
+    const int num_pages = 512;
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get(), num_instances);
+    EXPECT_EQ(bpm->get_num_instances(), num_instances);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    // 新建远多于缓冲池容量的页面，每页写入自己的页号后unpin，迫使各分片发生淘汰
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(page_id.page_no, i);
+        memcpy(page->get_data(), &i, sizeof(int));
+        EXPECT_TRUE(bpm->unpin_page(page_id, true));
+    }
+
+    for (int i = 0; i < num_pages; i++) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(*reinterpret_cast<int *>(page->get_data()), i);
+        EXPECT_TRUE(bpm->unpin_page(page->get_page_id(), false));
+    }
+
+    bpm->flush_all_pages(fd);
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*reinterpret_cast<int *>(buf), i);
+    }
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 后台刷脏测试：刷脏后磁盘数据与缓冲池一致，且页面不再是脏页
+ * @note 生成测试文件flusher_test
+ */
+TEST_F(BufferPoolManagerTest, FlusherTest) {
+    const std::string filename = "flusher_test";
+    const size_t buffer_pool_size = 64;
+    const int num_pages = 32;
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get());
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+
+    std::vector<Page *> pages;
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(page, nullptr);
+        memcpy(page->get_data(), &i, sizeof(int));
+        pages.push_back(page);
+    }
+    // 前一半页面unpin，后一半仍被pin住
+    for (int i = 0; i < num_pages / 2; i++) {
+        EXPECT_TRUE(bpm->unpin_page(pages[i]->get_page_id(), true));
+    }
+
+    // 后台刷脏只写回未被pin住的页面，并且只写到脏页比例不超过目标为止
+    EXPECT_EQ(bpm->flush_dirty_pages(0.0, buffer_pool_size), num_pages / 2);
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_EQ(pages[i]->is_dirty(), i >= num_pages / 2);
+    }
+    EXPECT_EQ(bpm->flush_dirty_pages(0.0, buffer_pool_size), 0);
+
+    // 检查点写回其余所有脏页
+    PageFlusher flusher(bpm.get());
+    int num_hooks = 0;
+    flusher.set_checkpoint_hook([&] { num_hooks++; });
+    flusher.checkpoint();
+    EXPECT_EQ(flusher.get_pages_flushed(), num_pages / 2);
+    EXPECT_EQ(num_hooks, 1);
+
+    char buf[PAGE_SIZE];
+    for (int i = 0; i < num_pages; i++) {
+        EXPECT_FALSE(pages[i]->is_dirty());
+        disk_manager_->read_page(fd, i, buf, PAGE_SIZE);
+        EXPECT_EQ(*reinterpret_cast<int *>(buf), i);
+    }
+
+    // 后台线程可以正常启动和停止
+    flusher.start();
+    flusher.stop();
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试预读：预读的页面不被pin住、数据正确，且一次不会占满分片
+ * @note lab1 附加
+ */
+TEST_F(BufferPoolManagerTest, PrefetchTest) {
+    const std::string filename = "prefetch_test";
+    const size_t buffer_pool_size = 64;
+    const int num_pages = 128;
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    char buf[PAGE_SIZE] = {0};
+    for (int i = 0; i < num_pages; i++) {
+        memcpy(buf, &i, sizeof(int));
+        disk_manager_->write_page(fd, i, buf, PAGE_SIZE);
+    }
+
+    for (size_t num_instances : {1, 4}) {
+        auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get(), num_instances);
+        // 每个分片一次至多预读其1/4的帧
+        EXPECT_EQ(bpm->prefetch_pages(fd, 0, num_pages), buffer_pool_size / 4);
+        // 已在缓冲池中的页面不会被重复读入
+        EXPECT_EQ(bpm->prefetch_pages(fd, 0, 4), 0);
+
+        for (int i = 0; i < num_pages; i++) {
+            Page *page = bpm->fetch_page(PageId{fd, i});
+            ASSERT_NE(page, nullptr);
+            EXPECT_EQ(*reinterpret_cast<int *>(page->get_data()), i);
+            EXPECT_EQ(page->get_pin_count(), 1);
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(page->get_data()) % PAGE_SIZE, 0);
+            EXPECT_TRUE(bpm->unpin_page(page->get_page_id(), false));
+        }
+    }
+
+    // 预读的页面未被pin住，之后的访问可以占用缓冲池中的所有帧
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get(), 1);
+    EXPECT_EQ(bpm->prefetch_pages(fd, 0, num_pages), buffer_pool_size / 4);
+    for (int i = num_pages - static_cast<int>(buffer_pool_size); i < num_pages; i++) {
+        EXPECT_NE(bpm->fetch_page(PageId{fd, i}), nullptr);
+    }
+    EXPECT_EQ(bpm->fetch_page(PageId{fd, 0}), nullptr);
+
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 测试缓冲池预热：dump按最近访问从新到旧记录页面，新的缓冲池load之后这些页面都能命中，
+ *        空闲帧不够时只读入能放下的页面
+ * @note lab1 附加
+ */
+TEST_F(BufferPoolManagerTest, WarmUpTest) {
+    const std::string filename = "warm_up_test";
+    const std::string dump_name = "warm_up_test.dump";
+    const int num_pages = 128;
+
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    char buf[PAGE_SIZE] = {0};
+    for (int i = 0; i < num_pages; i++) {
+        memcpy(buf, &i, sizeof(int));
+        disk_manager_->write_page(fd, i, buf, PAGE_SIZE);
+    }
+    disk_manager_->set_fd2pageno(fd, num_pages);
+
+    {
+        auto bpm = std::make_unique<BufferPoolManager>(64, disk_manager_.get(), 1);
+        for (int i = 10; i < 30; i++) {
+            Page *page = bpm->fetch_page(PageId{fd, i});
+            ASSERT_NE(page, nullptr);
+            bpm->unpin_page(page->get_page_id(), false);
+        }
+        EXPECT_EQ(BufferPoolWarmer(bpm.get(), disk_manager_.get()).dump(dump_name), 20);
+        std::ifstream in(dump_name);
+        std::string name;
+        int page_no;
+        ASSERT_TRUE(static_cast<bool>(in >> name >> page_no));
+        EXPECT_EQ(name, filename);
+        EXPECT_EQ(page_no, 29);
+    }
+
+    auto bpm = std::make_unique<BufferPoolManager>(64, disk_manager_.get(), 4);
+    BufferPoolWarmer warmer(bpm.get(), disk_manager_.get());
+    EXPECT_EQ(warmer.load(dump_name), 20);
+    EXPECT_EQ(warmer.get_pages_loaded(), 20);
+    uint64_t hits = PageAccessCounter::local().hits;
+    for (int i = 10; i < 30; i++) {
+        Page *page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(*reinterpret_cast<int *>(page->get_data()), i);
+        bpm->unpin_page(page->get_page_id(), false);
+    }
+    EXPECT_EQ(PageAccessCounter::local().hits - hits, 20);
+
+    // 预热只使用空闲帧，不淘汰已经缓存的页面
+    auto small_bpm = std::make_unique<BufferPoolManager>(16, disk_manager_.get(), 1);
+    Page *page = small_bpm->fetch_page(PageId{fd, 100});
+    ASSERT_NE(page, nullptr);
+    small_bpm->unpin_page(page->get_page_id(), false);
+    EXPECT_EQ(BufferPoolWarmer(small_bpm.get(), disk_manager_.get()).load(dump_name), 15);
+    hits = PageAccessCounter::local().hits;
+    page = small_bpm->fetch_page(PageId{fd, 100});
+    ASSERT_NE(page, nullptr);
+    small_bpm->unpin_page(page->get_page_id(), false);
+    EXPECT_EQ(PageAccessCounter::local().hits - hits, 1);
+
+    disk_manager_->close_file(fd);
+}
+
+namespace {
+
+// 只保留页面的前64字节，其余字节不全为0的页面不压缩
+class PrefixCodec : public PageCodec {
+   public:
+    static constexpr size_t PREFIX = 64;
+
+    bool encode(page_id_t page_no, const char *page, std::string *out) const override {
+        for (size_t i = PREFIX; i < PAGE_SIZE; i++) {
+            if (page[i] != 0) {
+                return false;
+            }
+        }
+        out->assign(page, PREFIX);
+        return true;
+    }
+
+    void decode(const std::string &data, char *page) const override {
+        memset(page, 0, PAGE_SIZE);
+        memcpy(page, data.data(), data.size());
+    }
+};
+
+}  // namespace
+
+/**
+ * @brief 压缩页缓存测试：被淘汰的页面编码后保存，缺页时从编码结果解码而不读磁盘，读入后从缓存中移除；
+ *        缓存按字节数上限丢弃最早进入的页面，预读跳过缓存中的页面，注销编解码器后缓存被清空
+ * @note 生成测试文件compressed_cache_test
+ */
+TEST_F(BufferPoolManagerTest, CompressedCacheTest) {
+    const std::string filename = "compressed_cache_test";
+    const size_t buffer_pool_size = 16;
+    const int num_pages = 100;
+    const int cached_pages = 40;
+
+    auto bpm = std::make_unique<BufferPoolManager>(buffer_pool_size, disk_manager_.get(), 1,
+                                                   cached_pages * PrefixCodec::PREFIX);
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    bpm->set_page_codec(fd, std::make_shared<PrefixCodec>());
+
+    // 页面7在前64字节之外还有数据，不能压缩
+    for (int i = 0; i < num_pages; i++) {
+        PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        Page *page = bpm->new_page(&page_id);
+        ASSERT_NE(page, nullptr);
+        memcpy(page->get_data(), &i, sizeof(int));
+        if (i == 7) {
+            page->get_data()[PAGE_SIZE - 1] = 1;
+        }
+        EXPECT_TRUE(bpm->unpin_page(page_id, true));
+    }
+    // 前num_pages - buffer_pool_size个页面被依次淘汰，缓存中只剩最后进入的cached_pages个
+    int evicted = num_pages - static_cast<int>(buffer_pool_size);
+    EXPECT_EQ(bpm->get_compressed_bytes(), cached_pages * PrefixCodec::PREFIX);
+    for (int i = 0; i < num_pages; i++) {
+        bool cached = i >= evicted - cached_pages && i < evicted;
+        EXPECT_EQ(bpm->get_compressed_page(PageId{fd, i}) != nullptr, cached) << i;
+    }
+    EXPECT_EQ(bpm->get_compressed_page(PageId{fd, 7}), nullptr);
+
+    // 缓存中的页面不从磁盘读取：磁盘上的内容被改掉后读到的仍是缓存中的数据
+    int target = evicted - 1;
+    char garbage[PAGE_SIZE];
+    memset(garbage, 0x5a, PAGE_SIZE);
+    disk_manager_->write_page(fd, target, garbage, PAGE_SIZE);
+    EXPECT_EQ(bpm->prefetch_pages(fd, target, 1), 0u);
+    Page *page = bpm->fetch_page(PageId{fd, target});
+    ASSERT_NE(page, nullptr);
+    EXPECT_EQ(*reinterpret_cast<int *>(page->get_data()), target);
+    EXPECT_EQ(page->get_data()[PAGE_SIZE - 1], 0);
+    EXPECT_EQ(bpm->get_compressed_page(PageId{fd, target}), nullptr);
+    EXPECT_TRUE(bpm->unpin_page(page->get_page_id(), true));
+
+    // 不在缓存中的页面从磁盘读取
+    for (int i = 0; i < num_pages; i++) {
+        page = bpm->fetch_page(PageId{fd, i});
+        ASSERT_NE(page, nullptr);
+        EXPECT_EQ(*reinterpret_cast<int *>(page->get_data()), i);
+        EXPECT_EQ(page->get_data()[PAGE_SIZE - 1], i == 7 ? 1 : 0);
+        EXPECT_TRUE(bpm->unpin_page(page->get_page_id(), false));
+    }
+    EXPECT_LE(bpm->get_compressed_bytes(), cached_pages * PrefixCodec::PREFIX);
+
+    bpm->flush_all_pages(fd);
+    bpm->set_page_codec(fd, nullptr);
+    EXPECT_EQ(bpm->get_compressed_bytes(), 0u);
+    disk_manager_->close_file(fd);
+}
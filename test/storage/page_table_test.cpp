@@ -0,0 +1,120 @@
+#include "storage/page_table.h"
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 测试PageTable的插入、查找和删除，包括旧PageIdHash会冲突的页号
+ */
+TEST(PageTableTest, SimpleTest) {
+    const int num_frames = 1024;
+    PageTable page_table(num_frames);
+
+    // (fd << 16) | page_no 下 {0, 65536} 与 {1, 0} 冲突
+    page_table.insert(PageId{0, 65536}, 1);
+    page_table.insert(PageId{1, 0}, 2);
+    frame_id_t fid;
+    ASSERT_TRUE(page_table.find(PageId{0, 65536}, &fid));
+    EXPECT_EQ(fid, 1);
+    ASSERT_TRUE(page_table.find(PageId{1, 0}, &fid));
+    EXPECT_EQ(fid, 2);
+    EXPECT_FALSE(page_table.find(PageId{0, 0}, &fid));
+
+    // 更新已有的映射不增加表项
+    page_table.insert(PageId{1, 0}, 3);
+    ASSERT_TRUE(page_table.find(PageId{1, 0}, &fid));
+    EXPECT_EQ(fid, 3);
+    EXPECT_EQ(page_table.size(), 2);
+
+    EXPECT_TRUE(page_table.erase(PageId{0, 65536}));
+    EXPECT_FALSE(page_table.erase(PageId{0, 65536}));
+    EXPECT_FALSE(page_table.find(PageId{0, 65536}, &fid));
+    ASSERT_TRUE(page_table.find(PageId{1, 0}, &fid));
+    EXPECT_EQ(fid, 3);
+    EXPECT_EQ(page_table.size(), 1);
+}
+
+/**
+ * @brief 随机插入和删除，与std::unordered_map对比，覆盖向后移动删除的各种探测链
+ */
+TEST(PageTableTest, RandomTest) {
+    const int num_frames = 512;
+    PageTable page_table(num_frames);
+    std::unordered_map<PageId, frame_id_t, PageIdHash> expected;
+    std::mt19937 rng(0);
+
+    for (int round = 0; round < 100000; round++) {
+        PageId page_id{static_cast<int>(rng() % 4), static_cast<page_id_t>(rng() % 2048)};
+        if (expected.count(page_id) || expected.size() == num_frames) {
+            EXPECT_EQ(page_table.erase(page_id), expected.erase(page_id) == 1);
+        } else {
+            frame_id_t fid = static_cast<frame_id_t>(rng() % num_frames);
+            page_table.insert(page_id, fid);
+            expected[page_id] = fid;
+        }
+    }
+    EXPECT_EQ(page_table.size(), expected.size());
+    for (int fd = 0; fd < 4; fd++) {
+        for (page_id_t page_no = 0; page_no < 2048; page_no++) {
+            PageId page_id{fd, page_no};
+            frame_id_t fid;
+            auto it = expected.find(page_id);
+            ASSERT_EQ(page_table.find(page_id, &fid), it != expected.end());
+            if (it != expected.end()) {
+                EXPECT_EQ(fid, it->second);
+            }
+        }
+    }
+}
+
+/**
+ * @brief 单个写者更新时并发无锁读：从不被删除的表项必须始终能查到且帧号正确
+ */
+TEST(PageTableTest, ConcurrentReadTest) {
+    const int num_frames = 256;
+    const int num_stable = 64;
+    PageTable page_table(num_frames);
+    for (int i = 0; i < num_stable; i++) {
+        page_table.insert(PageId{0, i}, i);
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> misses{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            while (!stop) {
+                for (int i = 0; i < num_stable; i++) {
+                    frame_id_t fid = INVALID_FRAME_ID;
+                    // 无锁查找可能暂时找不到被移动的表项，但找到时帧号一定是写入过的值
+                    if (page_table.find(PageId{0, i}, &fid)) {
+                        EXPECT_EQ(fid, i);
+                    } else {
+                        misses++;
+                    }
+                }
+            }
+        });
+    }
+    std::mt19937 rng(0);
+    for (int round = 0; round < 200000; round++) {
+        PageId page_id{1, static_cast<page_id_t>(rng() % 128)};
+        if (!page_table.erase(page_id)) {
+            page_table.insert(page_id, num_stable);
+        }
+    }
+    stop = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    frame_id_t fid;
+    for (int i = 0; i < num_stable; i++) {
+        ASSERT_TRUE(page_table.find(PageId{0, i}, &fid));
+        EXPECT_EQ(fid, i);
+    }
+}
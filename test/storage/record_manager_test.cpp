@@ -10,6 +10,7 @@
 #include <iostream>
 #include <unordered_map>
 
+#include "common/arena.h"
 #include "gtest/gtest.h"
 #define BUFFER_LENGTH 8192
 
@@ -38,6 +39,9 @@ void check_equal(const RmFileHandle *file_handle,
         auto mock_buf = (char *)entry.second.c_str();
         auto rec = file_handle->get_record(rid, context);
         assert(memcmp(mock_buf, rec->data, file_handle->file_hdr_.record_size) == 0);
+        auto view = file_handle->get_record_view(rid);
+        assert(view.size() == file_handle->file_hdr_.record_size);
+        assert(memcmp(mock_buf, view.data(), view.size()) == 0);
     }
     // Randomly get record
     for (int i = 0; i < 10; i++) {
@@ -53,9 +57,11 @@ void check_equal(const RmFileHandle *file_handle,
         assert(mock.count(scan.rid()) > 0);
         auto rec = file_handle->get_record(scan.rid(), context);
         assert(memcmp(rec->data, mock.at(scan.rid()).c_str(), file_handle->file_hdr_.record_size) == 0);
+        assert(memcmp(scan.record(), rec->data, file_handle->file_hdr_.record_size) == 0);
         num_records++;
     }
     assert(num_records == mock.size());
+    assert(file_handle->count_records() == mock.size());
 }
 
 // std::cout can call this, for example: std::cout << rid
@@ -223,4 +229,845 @@ TEST(RecordManagerTest, MultipleFilesTest) {
         std::string filename = filenames[i];
         rm_manager->destroy_file(filename);
     }
-}
\ No newline at end of file
+}
+/**
+ * @brief 测试free space map：删除记录后的空闲slot被重新使用，且重新打开文件后仍然有效
+ */
+TEST(RecordManagerTest, FreeSpaceMapTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "fsm.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 256);
+    auto file_handle = rm_manager->open_file(filename);
+    int per_page = file_handle->file_hdr_.num_records_per_page;
+
+    // 写满5个页面
+    char write_buf[PAGE_SIZE];
+    std::vector<Rid> rids;
+    for (int i = 0; i < per_page * 5; i++) {
+        rand_buf(file_handle->file_hdr_.record_size, write_buf);
+        rids.push_back(file_handle->insert_record(write_buf, context));
+    }
+    ASSERT_EQ(file_handle->file_hdr_.num_pages, 6);
+    ASSERT_EQ(file_handle->fsm_.num_free_pages(), 0);
+
+    // 在第2、4页各空出一个slot
+    Rid hole1 = rids[per_page + 3];
+    Rid hole2 = rids[per_page * 3 + 7];
+    file_handle->delete_record(hole1, context);
+    file_handle->delete_record(hole2, context);
+    ASSERT_EQ(file_handle->fsm_.num_free_pages(), 2);
+
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    ASSERT_EQ(file_handle->fsm_.num_free_pages(), 2);
+
+    std::vector<Rid> reused;
+    for (int i = 0; i < 2; i++) {
+        rand_buf(file_handle->file_hdr_.record_size, write_buf);
+        Rid rid = file_handle->insert_record(write_buf, context);
+        EXPECT_TRUE(rid_equal_t()(rid, hole1) || rid_equal_t()(rid, hole2)) << rid;
+        reused.push_back(rid);
+    }
+    EXPECT_FALSE(rid_equal_t()(reused[0], reused[1]));
+    EXPECT_EQ(file_handle->fsm_.num_free_pages(), 0);
+
+    // 没有空闲slot时分配新页面
+    Rid rid = file_handle->insert_record(write_buf, context);
+    EXPECT_EQ(rid.page_no, 6);
+    EXPECT_EQ(file_handle->file_hdr_.num_pages, 7);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试批量插入：先填满已有页面的空闲slot，再按顺序填满新页面，结果与逐条插入相同
+ */
+TEST(RecordManagerTest, InsertRecordsTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "insert_records.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 256);
+    auto file_handle = rm_manager->open_file(filename);
+    int record_size = file_handle->file_hdr_.record_size;
+    int per_page = file_handle->file_hdr_.num_records_per_page;
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    char write_buf[PAGE_SIZE];
+    // 第一个页面中先插入3条记录并空出一个slot
+    std::vector<Rid> rids;
+    for (int i = 0; i < 3; i++) {
+        rand_buf(record_size, write_buf);
+        rids.push_back(file_handle->insert_record(write_buf, context));
+        mock[rids.back()] = std::string(write_buf, record_size);
+    }
+    file_handle->delete_record(rids[1], context);
+    mock.erase(rids[1]);
+
+    std::vector<std::string> rows(per_page * 2);
+    std::vector<char *> bufs;
+    for (auto &row : rows) {
+        row.resize(record_size);
+        rand_buf(record_size, row.data());
+        bufs.push_back(row.data());
+    }
+    std::vector<Rid> inserted = file_handle->insert_records(bufs, context);
+    ASSERT_EQ(inserted.size(), bufs.size());
+    EXPECT_TRUE(rid_equal_t()(inserted[0], rids[1]));
+    EXPECT_EQ(inserted[1].page_no, 1);
+    EXPECT_EQ(inserted[1].slot_no, 3);
+    EXPECT_EQ(inserted.back().page_no, 3);
+    EXPECT_EQ(file_handle->file_hdr_.num_pages, 4);
+    for (size_t i = 0; i < inserted.size(); i++) {
+        ASSERT_EQ(mock.count(inserted[i]), 0);
+        mock[inserted[i]] = rows[i];
+    }
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试按页面范围扫描：把数据页切分为若干段分别扫描，结果恰好是整个文件扫描的结果，且每条记录位于所在段内
+ */
+TEST(RecordManagerTest, RangeScanTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "range_scan.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, 64);
+    auto file_handle = rm_manager->open_file(filename);
+    int record_size = file_handle->file_hdr_.record_size;
+    char write_buf[PAGE_SIZE];
+    std::vector<Rid> rids;
+    for (int i = 0; i < 5000; i++) {
+        rand_buf(record_size, write_buf);
+        rids.push_back(file_handle->insert_record(write_buf, context));
+    }
+    // 删除一部分记录，使一些页面中间出现空slot
+    for (size_t i = 0; i < rids.size(); i += 3) {
+        file_handle->delete_record(rids[i], context);
+    }
+
+    uint64_t rows_before = PageAccessCounter::local().rows;
+    std::vector<Rid> full;
+    for (RmScan scan(file_handle.get()); !scan.is_end(); scan.next()) {
+        full.push_back(scan.rid());
+    }
+    // 扫描读到的记录计入当前线程的PageAccessCounter
+    EXPECT_EQ(PageAccessCounter::local().rows - rows_before, full.size());
+    int num_pages = file_handle->file_hdr_.num_pages;
+    ASSERT_GT(num_pages, 10);
+    std::vector<Rid> ranged;
+    for (int start = RM_FIRST_RECORD_PAGE; start < num_pages; start += 3) {
+        // 最后一段的结束页号超出文件，超出的部分被忽略
+        for (RmScan scan(file_handle.get(), start, start + 3); !scan.is_end(); scan.next()) {
+            ASSERT_GE(scan.rid().page_no, start);
+            ASSERT_LT(scan.rid().page_no, start + 3);
+            ASSERT_EQ(memcmp(scan.record(), file_handle->get_record(scan.rid(), context)->data, record_size), 0);
+            ranged.push_back(scan.rid());
+        }
+    }
+    ASSERT_EQ(ranged.size(), full.size());
+    for (size_t i = 0; i < full.size(); i++) {
+        EXPECT_TRUE(rid_equal_t()(ranged[i], full[i]));
+    }
+    // 空范围
+    EXPECT_TRUE(RmScan(file_handle.get(), num_pages, num_pages + 1).is_end());
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+// 用zone map条件扫描，返回满足pred的记录数，并检查扫描到的记录与不跳过页面的扫描相同
+template <typename Pred>
+size_t zone_scan(const RmFileHandle *file_handle, const std::vector<RmZoneCondition> &conds, Pred pred,
+                 size_t *skipped) {
+    size_t expected = 0;
+    for (RmScan scan(file_handle); !scan.is_end(); scan.next()) {
+        expected += pred(scan.record());
+    }
+    size_t matched = 0;
+    RmScan scan(file_handle, RM_FIRST_RECORD_PAGE, -1, false, conds);
+    for (; !scan.is_end(); scan.next()) {
+        matched += pred(scan.record());
+    }
+    EXPECT_EQ(matched, expected);
+    *skipped = scan.num_skipped_pages();
+    return matched;
+}
+
+/**
+ * @brief 测试zone map：插入和更新记录时扩大页面的范围，扫描跳过范围不满足条件的页面，结果与完整扫描相同；
+ *        关闭后重新打开仍然有效，未正常关闭时页面的范围未知，重建后恢复
+ */
+TEST(RecordManagerTest, ZoneMapTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "zone_map.txt";
+    if (disk_manager->is_file(filename)) {
+        rm_manager->destroy_file(filename);
+    }
+    // 记录为(a INT, c FLOAT, 8字节其他数据)，a随插入顺序递增
+    constexpr int record_size = 16;
+    rm_manager->create_file(filename, record_size, {}, {}, {{0, TYPE_INT}, {4, TYPE_FLOAT}});
+    EXPECT_THROW(rm_manager->create_file("zone_map_bad.txt", record_size, {}, {}, {{14, TYPE_INT}}),
+                 InternalError);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_EQ(file_handle->zone_map().columns().size(), 2u);
+    std::vector<Rid> rids;
+    for (int i = 0; i < 5000; i++) {
+        char buf[record_size] = {};
+        float c = static_cast<float>(i % 100) / 2;
+        memcpy(buf, &i, sizeof(i));
+        memcpy(buf + 4, &c, sizeof(c));
+        rids.push_back(file_handle->insert_record(buf, context));
+    }
+    int num_pages = file_handle->file_hdr_.num_pages;
+    ASSERT_GT(num_pages, 10);
+    auto a_of = [](const char *rec) { return *reinterpret_cast<const int *>(rec); };
+    auto c_of = [](const char *rec) { return *reinterpret_cast<const float *>(rec + 4); };
+
+    size_t skipped;
+    EXPECT_EQ(zone_scan(file_handle.get(), {{0, OP_GE, 4500}}, [&](const char *r) { return a_of(r) >= 4500; },
+                        &skipped),
+              500u);
+    EXPECT_GT(skipped, static_cast<size_t>(num_pages) / 2);
+    EXPECT_EQ(zone_scan(file_handle.get(), {{0, OP_EQ, 1234}}, [&](const char *r) { return a_of(r) == 1234; },
+                        &skipped),
+              1u);
+    EXPECT_EQ(skipped, static_cast<size_t>(num_pages - 2));
+    EXPECT_EQ(zone_scan(file_handle.get(), {{1, OP_GT, 60}}, [&](const char *r) { return c_of(r) > 60; }, &skipped),
+              0u);
+    EXPECT_EQ(skipped, static_cast<size_t>(num_pages - 1));
+    // 两个条件同时满足的页面才会被读取
+    zone_scan(file_handle.get(), {{0, OP_LT, 100}, {1, OP_LE, 10}},
+              [&](const char *r) { return a_of(r) < 100 && c_of(r) <= 10; }, &skipped);
+    EXPECT_EQ(skipped, static_cast<size_t>(num_pages - 2));
+
+    // 更新第一个页面中的记录后该页面的范围扩大；删除记录不缩小范围
+    char buf[record_size] = {};
+    int big = 100000;
+    memcpy(buf, &big, sizeof(big));
+    file_handle->update_record(rids[0], buf, context);
+    file_handle->delete_record(rids.back(), context);
+    EXPECT_EQ(zone_scan(file_handle.get(), {{0, OP_GE, 4500}}, [&](const char *r) { return a_of(r) >= 4500; },
+                        &skipped),
+              500u);
+
+    // 正常关闭后重新打开，zone map仍然有效
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    EXPECT_EQ(zone_scan(file_handle.get(), {{0, OP_GT, 99999}}, [&](const char *r) { return a_of(r) > 99999; },
+                        &skipped),
+              1u);
+    EXPECT_EQ(skipped, static_cast<size_t>(num_pages - 2));
+
+    // 不关闭而再次打开，相当于崩溃后重启：所有页面的范围未知，重建之后恢复
+    auto reopened = rm_manager->open_file(filename);
+    zone_scan(reopened.get(), {{0, OP_GT, 99999}}, [&](const char *r) { return a_of(r) > 99999; }, &skipped);
+    EXPECT_EQ(skipped, 0u);
+    reopened->rebuild_free_space();
+    zone_scan(reopened.get(), {{0, OP_GT, 99999}}, [&](const char *r) { return a_of(r) > 99999; }, &skipped);
+    EXPECT_EQ(skipped, static_cast<size_t>(num_pages - 2));
+
+    rm_manager->close_file(reopened.get());
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(RmZoneMap::file_name(filename)));
+}
+
+/**
+ * @brief 测试RmRecord的移动语义以及从Arena中分配记录
+ */
+TEST(RecordManagerTest, RecordArenaTest) {
+    Arena arena(1024);
+    std::vector<RmRecord> records;
+    for (int i = 0; i < 100; i++) {
+        RmRecord rec(64, &arena);
+        memset(rec.data, i, rec.size);
+        records.push_back(std::move(rec));
+        EXPECT_EQ(rec.data, nullptr);
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(records[i].size, 64);
+        for (int j = 0; j < 64; j++) {
+            ASSERT_EQ(records[i].data[j], static_cast<char>(i));
+        }
+    }
+    EXPECT_GE(arena.memory_usage(), 100u * 64);
+
+    // 移动赋值释放原有的缓冲区，Deserialize在大小不变时复用缓冲区
+    RmRecord owned(16, "0123456789abcdef");
+    owned = RmRecord(8, "abcdefgh");
+    EXPECT_EQ(memcmp(owned.data, "abcdefgh", 8), 0);
+    char buf[sizeof(int) + 8];
+    int size = 8;
+    memcpy(buf, &size, sizeof(int));
+    memcpy(buf + sizeof(int), "hgfedcba", 8);
+    char *data = owned.data;
+    owned.Deserialize(buf);
+    EXPECT_EQ(owned.data, data);
+    EXPECT_EQ(memcmp(owned.data, "hgfedcba", 8), 0);
+}
+
+namespace {
+
+// 变长记录的布局：INT a, VARCHAR(200) b, INT c, VARCHAR(100) d
+constexpr int VAR_RECORD_SIZE = 4 + 200 + 4 + 100;
+const std::vector<RmVarField> VAR_FIELDS = {{4, 200}, {208, 100}};
+
+// 生成变长字段实际长度分别为len_b和len_d的记录，内容中可能含有'\0'，只有末尾的'\0'被去掉
+std::string make_var_record(int len_b, int len_d) {
+    std::string record(VAR_RECORD_SIZE, '\0');
+    rand_buf(4, &record[0]);
+    rand_buf(4, &record[204]);
+    rand_buf(len_b, &record[4]);
+    rand_buf(len_d, &record[208]);
+    if (len_b > 0) {
+        record[4 + len_b - 1] = 'b';
+    }
+    if (len_d > 0) {
+        record[208 + len_d - 1] = 'd';
+    }
+    return record;
+}
+
+}  // namespace
+
+/**
+ * @brief 测试slotted page：变长记录的插入、删除和更新(包括变长和变短)，重新打开文件后记录不变，
+ *        短记录每页能存放的条数远多于定长格式
+ */
+TEST(RecordManagerTest, SlottedPageTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "slotted.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, VAR_RECORD_SIZE, VAR_FIELDS);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->file_hdr_.is_slotted());
+    ASSERT_EQ(file_handle->file_hdr_.max_tuple_size, VAR_RECORD_SIZE + 4);
+
+    // 平均约30字节的短记录
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (int i = 0; i < 2000; i++) {
+        std::string record = make_var_record(rand() % 20, rand() % 10);
+        Rid rid = file_handle->insert_record(&record[0], context);
+        ASSERT_EQ(mock.count(rid), 0u);
+        mock[rid] = record;
+    }
+    int fixed_per_page = (PAGE_SIZE - 12) / VAR_RECORD_SIZE;
+    EXPECT_GT(mock.size() / (file_handle->file_hdr_.num_pages - 1), 5u * fixed_per_page);
+    check_equal(file_handle.get(), mock);
+
+    // 随机删除、插入和更新，更新后的记录在原来的页面中放不下时改为删除后插入
+    for (int round = 0; round < 5000; round++) {
+        auto it = mock.begin();
+        std::advance(it, rand() % mock.size());
+        Rid rid = it->first;
+        int op = rand() % 3;
+        std::string record = make_var_record(rand() % 201, rand() % 101);
+        if (op == 0) {
+            file_handle->delete_record(rid, context);
+            mock.erase(rid);
+        } else if (op == 1) {
+            Rid new_rid = file_handle->insert_record(&record[0], context);
+            ASSERT_EQ(mock.count(new_rid), 0u);
+            mock[new_rid] = record;
+        } else if (file_handle->can_update_in_place(rid, &record[0])) {
+            file_handle->update_record(rid, &record[0], context);
+            mock[rid] = record;
+        } else {
+            file_handle->delete_record(rid, context);
+            mock.erase(rid);
+            Rid new_rid = file_handle->insert_record(&record[0], context);
+            mock[new_rid] = record;
+        }
+    }
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+
+    // 有空闲空间的页面都在free space map中，重建后结果相同
+    int num_free = file_handle->fsm_.num_free_pages();
+    file_handle->rebuild_free_space();
+    EXPECT_EQ(file_handle->fsm_.num_free_pages(), num_free);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试slotted page中记录变长：页面的总空闲空间足够时整理页面后原地更新，slot号不变；
+ *        不够时不能原地更新。删除后空出的空间被其他记录占用时，不能再在原来的位置插入
+ */
+TEST(RecordManagerTest, SlottedPageCompactTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "slotted_compact.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    rm_manager->create_file(filename, VAR_RECORD_SIZE, VAR_FIELDS);
+    auto file_handle = rm_manager->open_file(filename);
+
+    // 用长度为60的元组填满第一个页面
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    std::vector<Rid> rids;
+    while (true) {
+        std::string record = make_var_record(40, 8);
+        Rid rid = file_handle->insert_record(&record[0], context);
+        if (rid.page_no != RM_FIRST_RECORD_PAGE) {
+            file_handle->delete_record(rid, context);
+            break;
+        }
+        rids.push_back(rid);
+        mock[rid] = record;
+    }
+    ASSERT_GT(rids.size(), 50u);
+
+    // 页面已满，最长的记录放不下
+    std::string longest = make_var_record(200, 100);
+    EXPECT_FALSE(file_handle->can_update_in_place(rids[0], &longest[0]));
+    EXPECT_THROW(file_handle->update_record(rids[0], &longest[0], context), InternalError);
+
+    // 删除中间的记录，空闲空间分散在页面各处，整理后可以原地容纳最长的记录
+    for (size_t i = 1; i < 12; i += 2) {
+        file_handle->delete_record(rids[i], context);
+        mock.erase(rids[i]);
+    }
+    ASSERT_TRUE(file_handle->can_update_in_place(rids[0], &longest[0]));
+    file_handle->update_record(rids[0], &longest[0], context);
+    mock[rids[0]] = longest;
+    check_equal(file_handle.get(), mock);
+
+    // 变短后保留容量，再变回原来的长度不需要新的空间
+    std::string shorter = make_var_record(1, 0);
+    file_handle->update_record(rids[0], &shorter[0], context);
+    mock[rids[0]] = shorter;
+    std::string restored = make_var_record(200, 100);
+    ASSERT_TRUE(file_handle->can_update_in_place(rids[0], &restored[0]));
+
+    // 删除一条记录后，它的空间被插入到其他空闲slot的记录占用，原来的位置不能再插入
+    Rid deleted = rids[20];
+    std::string deleted_record = mock.at(deleted);
+    file_handle->delete_record(deleted, context);
+    mock.erase(deleted);
+    EXPECT_TRUE(file_handle->can_insert_at(deleted, &deleted_record[0]));
+    for (size_t i = 1; i < 12; i += 2) {
+        std::string record = make_var_record(40, 8);
+        if (file_handle->can_insert_at(rids[i], &record[0])) {
+            file_handle->insert_record(rids[i], &record[0]);
+            mock[rids[i]] = record;
+        }
+    }
+    EXPECT_FALSE(file_handle->can_insert_at(deleted, &deleted_record[0]));
+    EXPECT_THROW(file_handle->insert_record(deleted, &deleted_record[0]), InternalError);
+    EXPECT_TRUE(file_handle->can_update_in_place(rids[0], &restored[0]));
+    file_handle->update_record(rids[0], &restored[0], context);
+    mock[rids[0]] = restored;
+    check_equal(file_handle.get(), mock);
+
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试PAX格式：记录按minipage分列存放，随机插入、删除和更新后记录不变，
+ *        每个字段在页面中的列视图与记录一致；超过RM_MAX_MINIPAGES的字段并入最后一个minipage
+ */
+TEST(RecordManagerTest, PaxPageTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "pax.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    // 字段布局：INT, CHAR(20), FLOAT, CHAR(3)
+    const int record_size = 4 + 20 + 4 + 3;
+    const std::vector<RmMinipage> minipages = {{0, 4}, {4, 20}, {24, 4}, {28, 3}};
+    EXPECT_THROW(rm_manager->create_file(filename, record_size, {}, {{0, 4}, {8, 23}}), InternalError);
+    EXPECT_THROW(rm_manager->create_file(filename, record_size, {}, {{0, 4}, {4, 20}}), InternalError);
+    // PAX格式中变长字段按定长存储
+    rm_manager->create_file(filename, record_size, {{4, 20}}, minipages);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->file_hdr_.is_pax());
+    ASSERT_FALSE(file_handle->file_hdr_.is_slotted());
+    ASSERT_EQ(file_handle->file_hdr_.num_minipages, 4);
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (int round = 0; round < 5000; round++) {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, &record[0]);
+        int op = mock.empty() ? 0 : rand() % 4;
+        if (op <= 1) {
+            Rid rid = file_handle->insert_record(&record[0], context);
+            ASSERT_EQ(mock.count(rid), 0u);
+            mock[rid] = record;
+            continue;
+        }
+        auto it = mock.begin();
+        std::advance(it, rand() % mock.size());
+        Rid rid = it->first;
+        if (op == 2) {
+            file_handle->delete_record(rid, context);
+            mock.erase(rid);
+        } else {
+            file_handle->update_record(rid, &record[0], context);
+            mock[rid] = record;
+        }
+    }
+    check_equal(file_handle.get(), mock);
+
+    // 每个字段的值都存放在所在minipage中slot对应的位置上
+    for (auto &entry : mock) {
+        RmPageHandle page_handle = file_handle->fetch_page_handle(entry.first.page_no);
+        for (auto &mp : minipages) {
+            // 字段中间的偏移也落在同一个minipage中
+            for (int field : {static_cast<int>(mp.offset), mp.offset + mp.len - 1}) {
+                size_t stride;
+                const char *col = page_handle.column(field, &stride);
+                ASSERT_EQ(stride, mp.len);
+                ASSERT_EQ(memcmp(col + entry.first.slot_no * stride, entry.second.data() + field,
+                                 mp.offset + mp.len - field), 0);
+            }
+        }
+        buffer_pool_manager->unpin_page(page_handle.page->get_page_id(), false);
+    }
+
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+
+    // 每个字节一个字段，超出的部分并入最后一个minipage
+    std::vector<RmMinipage> narrow;
+    for (int i = 0; i < 100; i++) {
+        narrow.push_back(RmMinipage{static_cast<uint16_t>(i), 1});
+    }
+    rm_manager->create_file(filename, 100, {}, narrow);
+    file_handle = rm_manager->open_file(filename);
+    ASSERT_EQ(file_handle->file_hdr_.num_minipages, RM_MAX_MINIPAGES);
+    EXPECT_EQ(file_handle->file_hdr_.minipages[RM_MAX_MINIPAGES - 1].len, 100 - (RM_MAX_MINIPAGES - 1));
+    mock.clear();
+    for (int i = 0; i < 500; i++) {
+        std::string record(100, '\0');
+        rand_buf(100, &record[0]);
+        mock[file_handle->insert_record(&record[0], context)] = record;
+    }
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief 测试压缩的PAX格式：缓冲池很小，页面不断被淘汰到压缩页缓存中再解码读回，随机插入、删除和更新后记录不变；
+ *        整数列使用frame-of-reference、字符串列使用字典，取值范围太大的整数列退回原样保存；
+ *        直接读取编码结果的扫描与记录一致，关闭文件后压缩页缓存被清空
+ */
+TEST(RecordManagerTest, PaxCompressionTest) {
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(16, disk_manager.get(), 1);
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "pax_compressed.txt";
+    if (disk_manager->is_file(filename)) {
+        disk_manager->destroy_file(filename);
+    }
+    // 字段布局：INT, CHAR(8), FLOAT, INT
+    const int record_size = 4 + 8 + 4 + 4;
+    EXPECT_THROW(rm_manager->create_file(filename, record_size, {}, {{0, 12, RM_ENCODING_FOR}, {12, 8}}),
+                 InternalError);
+    rm_manager->create_file(filename, record_size, {},
+                            {{0, 4, RM_ENCODING_FOR}, {4, 8, RM_ENCODING_DICT}, {12, 4}, {16, 4, RM_ENCODING_FOR}});
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_TRUE(file_handle->file_hdr_.is_compressed());
+
+    // a在[-50, 50)中，b只有5种取值，c和d是随机的字节
+    auto make_record = [&]() {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, &record[0]);
+        int a = rand() % 100 - 50;
+        memcpy(&record[0], &a, sizeof(a));
+        memset(&record[4], 0, 8);
+        snprintf(&record[4], 8, "v%d", rand() % 5);
+        return record;
+    };
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (int round = 0; round < 12000; round++) {
+        std::string record = make_record();
+        int op = mock.size() < 8000 ? 0 : rand() % 4;
+        if (op <= 1) {
+            Rid rid = file_handle->insert_record(&record[0], context);
+            ASSERT_EQ(mock.count(rid), 0u);
+            mock[rid] = record;
+            continue;
+        }
+        auto it = mock.begin();
+        std::advance(it, rand() % mock.size());
+        Rid rid = it->first;
+        if (op == 2) {
+            file_handle->delete_record(rid, context);
+            mock.erase(rid);
+        } else {
+            file_handle->update_record(rid, &record[0], context);
+            mock[rid] = record;
+        }
+    }
+    check_equal(file_handle.get(), mock);
+    ASSERT_GT(buffer_pool_manager->get_compressed_bytes(), 0u);
+
+    // 压缩页缓存中的页面：每个minipage的编码方式符合预期，记录与直接读取的一致
+    int compressed_pages = 0;
+    std::vector<char> buf(record_size);
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_handle->file_hdr_.num_pages; page_no++) {
+        auto data = buffer_pool_manager->get_compressed_page(PageId{file_handle->fd_, page_no});
+        if (data == nullptr) {
+            continue;
+        }
+        compressed_pages++;
+        EXPECT_LE(data->size(), PAGE_SIZE / 4 * 3);
+        RmCompressedPage page(&file_handle->file_hdr_, *data);
+        EXPECT_EQ(page.minipage(0).mode, RM_ENCODING_FOR);
+        EXPECT_EQ(page.minipage(1).mode, RM_ENCODING_DICT);
+        EXPECT_EQ(page.minipage(2).mode, RM_ENCODING_NONE);
+        EXPECT_EQ(page.minipage(3).mode, RM_ENCODING_NONE);
+        int num_records = 0;
+        for (int slot_no = page.next_record(-1); slot_no < page.num_slots(); slot_no = page.next_record(slot_no)) {
+            Rid rid{page_no, slot_no};
+            ASSERT_EQ(mock.count(rid), 1u);
+            EXPECT_EQ(memcmp(page.get_record(slot_no, buf.data()), mock[rid].data(), record_size), 0);
+            num_records++;
+        }
+        EXPECT_EQ(num_records, page.page_hdr()->num_records);
+    }
+    EXPECT_GT(compressed_pages, 0);
+
+    // 直接读取编码结果的扫描
+    size_t num_records = 0;
+    for (RmScan scan(file_handle.get(), RM_FIRST_RECORD_PAGE, -1, true); !scan.is_end(); scan.next()) {
+        ASSERT_EQ(mock.count(scan.rid()), 1u);
+        EXPECT_EQ(memcmp(scan.record(), mock[scan.rid()].data(), record_size), 0);
+        num_records++;
+    }
+    EXPECT_EQ(num_records, mock.size());
+
+    rm_manager->close_file(file_handle.get());
+    EXPECT_EQ(buffer_pool_manager->get_compressed_bytes(), 0u);
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
+
+/**
+ * @brief LSM表：随机增删改，穿插memtable写出和sorted run合并，重新打开后内容不变
+ */
+TEST(RecordManagerTest, LsmTableTest) {
+    srand((unsigned)time(nullptr));
+
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(64, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "lsm_table.txt";
+    if (disk_manager->is_file(filename)) {
+        rm_manager->destroy_file(filename);
+    }
+    const int record_size = 4 + rand() % 128;
+    rm_manager->create_lsm_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    ASSERT_NE(file_handle->lsm(), nullptr);
+    ASSERT_FALSE(file_handle->file_hdr_.is_contiguous());
+
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (int round = 0; round < 20000; round++) {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, &record[0]);
+        int op = mock.size() < 2000 ? 0 : rand() % 4;
+        if (op <= 1) {
+            Rid rid = file_handle->insert_record(&record[0], context);
+            ASSERT_EQ(mock.count(rid), 0u);
+            mock[rid] = record;
+        } else {
+            auto it = mock.begin();
+            std::advance(it, rand() % mock.size());
+            Rid rid = it->first;
+            if (op == 2) {
+                file_handle->delete_record(rid, context);
+                mock.erase(rid);
+                ASSERT_FALSE(file_handle->is_record(rid));
+            } else {
+                file_handle->update_record(rid, &record[0], context);
+                mock[rid] = record;
+            }
+        }
+        // 写出memtable，sorted run超过LSM_MAX_RUNS个之后由后台线程合并
+        if (round % 1500 == 1499) {
+            file_handle->lsm()->flush();
+        }
+        if (round % 7000 == 6999) {
+            file_handle->truncate();
+        }
+    }
+    check_equal(file_handle.get(), mock);
+
+    // 删除的行可以在原来的rid上重新插入(撤销删除)，存在的行不行
+    Rid deleted{-1, -1};
+    for (int page_no = RM_FIRST_RECORD_PAGE; page_no < file_handle->file_hdr_.num_pages && deleted.page_no < 0;
+         page_no++) {
+        for (int slot_no = 0; slot_no < file_handle->file_hdr_.num_records_per_page; slot_no++) {
+            Rid rid{page_no, slot_no};
+            if (mock.count(rid) == 0 && file_handle->lsm()->end_key() >
+                                            (uint64_t)(page_no - RM_FIRST_RECORD_PAGE) *
+                                                    file_handle->file_hdr_.num_records_per_page +
+                                                slot_no) {
+                deleted = rid;
+                break;
+            }
+        }
+    }
+    ASSERT_GE(deleted.page_no, 0);
+    EXPECT_TRUE(file_handle->can_insert_at(deleted, mock.begin()->second.data()));
+    EXPECT_FALSE(file_handle->can_insert_at(mock.begin()->first, mock.begin()->second.data()));
+
+    // 关闭时写出memtable，重新打开后从sorted run读取
+    rm_manager->close_file(file_handle.get());
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+    std::string record(record_size, '\0');
+    rand_buf(record_size, &record[0]);
+    Rid rid = file_handle->insert_record(&record[0], context);
+    EXPECT_EQ(mock.count(rid), 0u);
+    mock[rid] = record;
+    file_handle->truncate();
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+    EXPECT_FALSE(disk_manager->is_file(filename));
+    EXPECT_FALSE(disk_manager->is_file(RmLsmTree::manifest_name(filename)));
+}
+
+/**
+ * @brief 只读打开的数据文件映射到内存，扫描和读取记录的结果与经过缓冲池时相同，页面不进入缓冲池
+ */
+TEST(RecordManagerTest, ReadOnlyMappedTest) {
+    srand((unsigned)time(nullptr));
+
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(64, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    std::string filename = "mapped_table.txt";
+    if (disk_manager->is_file(filename)) {
+        rm_manager->destroy_file(filename);
+    }
+    const int record_size = 4 + rand() % 256;
+    rm_manager->create_file(filename, record_size);
+    auto file_handle = rm_manager->open_file(filename);
+    EXPECT_FALSE(buffer_pool_manager->is_mapped(file_handle->GetFd()));
+    std::unordered_map<Rid, std::string, rid_hash_t, rid_equal_t> mock;
+    for (int i = 0; i < 5000; i++) {
+        std::string record(record_size, '\0');
+        rand_buf(record_size, &record[0]);
+        Rid rid = file_handle->insert_record(&record[0], context);
+        mock[rid] = record;
+    }
+    for (int i = 0; i < 1000; i++) {
+        auto it = mock.begin();
+        std::advance(it, rand() % mock.size());
+        file_handle->delete_record(it->first, context);
+        mock.erase(it);
+    }
+    rm_manager->close_file(file_handle.get());
+
+    file_handle = rm_manager->open_file(filename, true);
+    int fd = file_handle->GetFd();
+    ASSERT_TRUE(buffer_pool_manager->is_mapped(fd));
+    check_equal(file_handle.get(), mock);
+    EXPECT_EQ(buffer_pool_manager->prefetch_pages(fd, RM_FIRST_RECORD_PAGE, 8), 0u);
+    for (auto &page_id : buffer_pool_manager->get_resident_pages()) {
+        EXPECT_NE(page_id.fd, fd);
+    }
+    // 映射的文件不能分配新页面
+    PageId page_id{fd, INVALID_PAGE_ID};
+    EXPECT_THROW(buffer_pool_manager->new_page(&page_id), InternalError);
+    rm_manager->close_file(file_handle.get());
+    EXPECT_FALSE(buffer_pool_manager->is_mapped(fd));
+
+    // 只读打开和关闭不修改文件，之后仍可以读写打开
+    file_handle = rm_manager->open_file(filename);
+    check_equal(file_handle.get(), mock);
+    rm_manager->close_file(file_handle.get());
+    rm_manager->destroy_file(filename);
+}
@@ -0,0 +1,85 @@
+#include "replacer/two_queue_replacer.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+/**
+ * @brief 简单测试TwoQueueReplacer的基本功能：只访问过一次的帧先于热帧被淘汰
+ */
+TEST(TwoQueueReplacerTest, SimpleTest) {
+    TwoQueueReplacer replacer(8);
+
+    // 帧1、2被访问两次，成为热页
+    for (frame_id_t fid : {1, 2}) {
+        replacer.record_access(fid, AccessType::Normal);
+        replacer.pin(fid);
+        replacer.unpin(fid);
+        replacer.record_access(fid, AccessType::Normal);
+        replacer.pin(fid);
+        replacer.unpin(fid);
+    }
+    // 帧3、4、5只被访问一次
+    for (frame_id_t fid : {3, 4, 5}) {
+        replacer.record_access(fid, AccessType::Normal);
+        replacer.pin(fid);
+        replacer.unpin(fid);
+    }
+    EXPECT_EQ(5, replacer.Size());
+
+    // 试用队列长度(3)超过目标长度(8/4=2)，先按FIFO顺序淘汰试用队列
+    int value;
+    replacer.victim(&value);
+    EXPECT_EQ(3, value);
+    // 试用队列回到目标长度以内，按LRU顺序淘汰热页
+    replacer.victim(&value);
+    EXPECT_EQ(1, value);
+    replacer.victim(&value);
+    EXPECT_EQ(2, value);
+    // 热队列已空
+    replacer.victim(&value);
+    EXPECT_EQ(4, value);
+
+    replacer.pin(5);
+    EXPECT_EQ(0, replacer.Size());
+    EXPECT_FALSE(replacer.victim(&value));
+}
+
+/**
+ * @brief 扫描抵抗测试：大量带AccessType::Scan提示的访问不会淘汰热页
+ */
+TEST(TwoQueueReplacerTest, ScanResistanceTest) {
+    const int num_frames = 100;
+    const int num_hot = 10;
+    TwoQueueReplacer replacer(num_frames);
+
+    for (frame_id_t fid = 0; fid < num_hot; fid++) {
+        for (int i = 0; i < 3; i++) {
+            replacer.record_access(fid, AccessType::Normal);
+            replacer.pin(fid);
+            replacer.unpin(fid);
+        }
+    }
+    // 扫描页被访问多次也不会晋升
+    for (frame_id_t fid = num_hot; fid < num_frames; fid++) {
+        for (int i = 0; i < 3; i++) {
+            replacer.record_access(fid, AccessType::Scan);
+            replacer.pin(fid);
+            replacer.unpin(fid);
+        }
+    }
+    EXPECT_EQ(num_frames, replacer.Size());
+
+    // 试用队列长度超过目标长度(num_frames/4)期间，被淘汰的都是扫描页
+    int value;
+    for (int i = num_hot; i < num_frames - num_frames / 4; i++) {
+        EXPECT_TRUE(replacer.victim(&value));
+        EXPECT_GE(value, num_hot);
+    }
+    // 之后才按LRU顺序淘汰热页
+    for (int i = 0; i < num_hot; i++) {
+        EXPECT_TRUE(replacer.victim(&value));
+        EXPECT_EQ(i, value);
+    }
+}
@@ -0,0 +1,182 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <map>
+
+#include "gtest/gtest.h"
+#include "system/sm_catalog.h"
+
+namespace {
+
+const std::string CATALOG_PATH = "catalog_test.meta";
+
+TabMeta MakeTable(int tab_id, int num_cols) {
+    TabMeta tab;
+    tab.name = "t" + std::to_string(tab_id);
+    tab.id = tab_id;
+    int offset = 0;
+    for (int i = 0; i < num_cols; i++) {
+        tab.cols.push_back(ColMeta{.tab_name = tab.name,
+                                   .name = "c" + std::to_string(i),
+                                   .type = TYPE_INT,
+                                   .len = 4,
+                                   .offset = offset,
+                                   .index = i == 0});
+        offset += 4;
+    }
+    tab.indexes.push_back(IndexMeta{tab.name, 4, 1, {tab.cols[0]}});
+    return tab;
+}
+
+std::string Encode(const TabMeta &tab) {
+    CatalogEncoder encoder;
+    tab.encode(encoder);
+    return encoder.buffer();
+}
+
+std::map<int, TabMeta> Reopen(Catalog *catalog, int *next_tab_id) {
+    std::vector<TabMeta> tables;
+    catalog->open(CATALOG_PATH, &tables, next_tab_id);
+    std::map<int, TabMeta> result;
+    for (auto &tab : tables) {
+        result.emplace(tab.id, tab);
+    }
+    return result;
+}
+
+void ExpectSameTable(const TabMeta &expected, const TabMeta &actual) {
+    EXPECT_EQ(actual.name, expected.name);
+    ASSERT_EQ(actual.cols.size(), expected.cols.size());
+    for (size_t i = 0; i < expected.cols.size(); i++) {
+        EXPECT_EQ(actual.cols[i].name, expected.cols[i].name);
+        EXPECT_EQ(actual.cols[i].offset, expected.cols[i].offset);
+        EXPECT_EQ(actual.cols[i].index, expected.cols[i].index);
+    }
+    ASSERT_EQ(actual.indexes.size(), expected.indexes.size());
+    EXPECT_EQ(actual.indexes[0].cols[0].name, expected.indexes[0].cols[0].name);
+}
+
+}  // namespace
+
+// 写入、修改和删除表之后重新打开，读出每张表的最新版本，文件头记录下一张表的编号
+TEST(CatalogTest, ReopenReadsLatestVersions) {
+    unlink(CATALOG_PATH.c_str());
+    Catalog::create(CATALOG_PATH);
+    Catalog catalog;
+    int next_tab_id = -1;
+    EXPECT_TRUE(Reopen(&catalog, &next_tab_id).empty());
+    EXPECT_EQ(next_tab_id, 0);
+
+    std::map<int, TabMeta> expected;
+    for (int id = 0; id < 50; id++) {
+        // 列数较多的表跨越多个页面
+        expected[id] = MakeTable(id, id % 10 == 0 ? 300 : 3);
+        catalog.set_next_tab_id(id + 1);
+        catalog.write_table(id, Encode(expected[id]));
+    }
+    for (int id = 0; id < 50; id += 3) {
+        expected[id] = MakeTable(id, 5);
+        catalog.write_table(id, Encode(expected[id]));
+    }
+    for (int id = 1; id < 50; id += 7) {
+        expected.erase(id);
+        catalog.remove_table(id);
+    }
+    catalog.close();
+
+    auto tables = Reopen(&catalog, &next_tab_id);
+    EXPECT_EQ(next_tab_id, 50);
+    ASSERT_EQ(tables.size(), expected.size());
+    for (auto &entry : expected) {
+        ASSERT_TRUE(tables.count(entry.first)) << entry.first;
+        ExpectSameTable(entry.second, tables.at(entry.first));
+    }
+    catalog.close();
+    unlink(CATALOG_PATH.c_str());
+}
+
+// 修改表时旧版本的页面被释放并被之后的写入复用，文件不会随修改次数增长
+TEST(CatalogTest, ReusesFreedPages) {
+    unlink(CATALOG_PATH.c_str());
+    Catalog::create(CATALOG_PATH);
+    Catalog catalog;
+    int next_tab_id;
+    Reopen(&catalog, &next_tab_id);
+    for (int id = 0; id < 10; id++) {
+        catalog.write_table(id, Encode(MakeTable(id, 3)));
+    }
+    page_id_t num_pages = catalog.get_num_pages();
+    for (int round = 0; round < 100; round++) {
+        catalog.write_table(round % 10, Encode(MakeTable(round % 10, 3)));
+    }
+    EXPECT_LE(catalog.get_num_pages(), num_pages + 1);
+
+    // 删除的表留下的空闲页面合并后可以容纳更大的表
+    for (int id = 0; id < 10; id++) {
+        catalog.remove_table(id);
+    }
+    num_pages = catalog.get_num_pages();
+    EXPECT_EQ(catalog.get_num_free_pages(), static_cast<size_t>(num_pages - 1));
+    TabMeta big = MakeTable(0, 200);
+    catalog.write_table(0, Encode(big));
+    EXPECT_EQ(catalog.get_num_pages(), num_pages);
+    catalog.close();
+
+    auto tables = Reopen(&catalog, &next_tab_id);
+    ASSERT_EQ(tables.size(), 1u);
+    ExpectSameTable(big, tables.at(0));
+    EXPECT_EQ(catalog.get_num_pages(), num_pages);
+    catalog.close();
+    unlink(CATALOG_PATH.c_str());
+}
+
+// 新版本写入后、旧版本释放前崩溃，打开时保留写入序号较大的版本；校验和不对的run被当作空闲页面
+TEST(CatalogTest, RecoversFromInterruptedWrite) {
+    unlink(CATALOG_PATH.c_str());
+    Catalog::create(CATALOG_PATH);
+    Catalog catalog;
+    int next_tab_id;
+    Reopen(&catalog, &next_tab_id);
+    catalog.write_table(0, Encode(MakeTable(0, 3)));    // 第1页
+    catalog.write_table(1, Encode(MakeTable(1, 3)));    // 第2页
+    catalog.close();
+    std::string stale(PAGE_SIZE, '\0');
+    FILE *file = fopen(CATALOG_PATH.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(fseek(file, PAGE_SIZE, SEEK_SET), 0);
+    ASSERT_EQ(fread(&stale[0], 1, PAGE_SIZE, file), static_cast<size_t>(PAGE_SIZE));
+    fclose(file);
+
+    TabMeta newer = MakeTable(0, 7);
+    Reopen(&catalog, &next_tab_id);
+    catalog.write_table(0, Encode(newer));               // 第3页，第1页被释放
+    catalog.close();
+
+    // 恢复第1页的旧版本，模拟释放旧版本之前崩溃；再在文件末尾追加一个编码被破坏的副本
+    file = fopen(CATALOG_PATH.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    ASSERT_EQ(fseek(file, PAGE_SIZE, SEEK_SET), 0);
+    ASSERT_EQ(fwrite(stale.data(), 1, PAGE_SIZE, file), static_cast<size_t>(PAGE_SIZE));
+    std::string corrupt = stale;
+    corrupt[48] ^= 1;
+    ASSERT_EQ(fseek(file, 0, SEEK_END), 0);
+    ASSERT_EQ(fwrite(corrupt.data(), 1, PAGE_SIZE, file), static_cast<size_t>(PAGE_SIZE));
+    fclose(file);
+
+    auto tables = Reopen(&catalog, &next_tab_id);
+    ASSERT_EQ(tables.size(), 2u);
+    ExpectSameTable(newer, tables.at(0));
+    ExpectSameTable(MakeTable(1, 3), tables.at(1));
+    // 过期的版本和损坏的run都成为空闲页面，之后的写入复用它们
+    EXPECT_EQ(catalog.get_num_pages(), 5);
+    EXPECT_EQ(catalog.get_num_free_pages(), 2u);
+    catalog.write_table(2, Encode(MakeTable(2, 3)));
+    EXPECT_EQ(catalog.get_num_pages(), 5);
+    catalog.close();
+
+    tables = Reopen(&catalog, &next_tab_id);
+    EXPECT_EQ(tables.size(), 3u);
+    ExpectSameTable(newer, tables.at(0));
+    catalog.close();
+    unlink(CATALOG_PATH.c_str());
+}
@@ -0,0 +1,297 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <set>
+
+#include "gtest/gtest.h"
+#include "record/rm.h"
+#include "system/sm_manager.h"
+#include "system/sm_partition.h"
+
+namespace {
+
+const std::string DB_NAME = "sm_manager_test_db";
+
+class SmManagerTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+        create_managers();
+        sm_manager_->create_db(DB_NAME);
+        ASSERT_EQ(chdir(".."), 0);
+        sm_manager_->open_db(DB_NAME);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    }
+
+    // 关闭数据库后用新的管理器重新打开，元数据从目录中读出
+    void reopen() {
+        sm_manager_->close_db();
+        ASSERT_EQ(chdir(".."), 0);
+        create_managers();
+        sm_manager_->open_db(DB_NAME);
+    }
+
+    void create_managers() {
+        sm_manager_.reset();
+        ix_manager_.reset();
+        rm_manager_.reset();
+        buffer_pool_manager_.reset();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+    }
+
+    // 句柄中的指针与按名称打开的文件一致
+    void expect_handle_matches(const std::string &tab_name) {
+        const TableHandle &handle = sm_manager_->get_table_handle(tab_name);
+        const TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+        EXPECT_EQ(handle.tab, &tab);
+        EXPECT_EQ(handle.fh, sm_manager_->fhs_.at(tab_name).get());
+        ASSERT_EQ(handle.indexes.size(), tab.indexes.size());
+        for (size_t i = 0; i < tab.indexes.size(); i++) {
+            EXPECT_EQ(handle.indexes[i].meta, &tab.indexes[i]);
+            auto ix_name = ix_manager_->get_index_name(tab_name, tab.indexes[i].cols);
+            EXPECT_EQ(handle.indexes[i].ih, sm_manager_->ihs_.at(ix_name).get());
+            EXPECT_EQ(&handle.get_index(tab.indexes[i].id), &handle.indexes[i]);
+        }
+    }
+
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+};
+
+}  // namespace
+
+// DDL之后表的句柄与打开的文件保持一致，索引编号在删除其他索引和重新打开数据库后不变
+TEST_F(SmManagerTest, TableHandlesFollowDdl) {
+    sm_manager_->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}, {"c", TYPE_INT, 4}}, nullptr);
+    sm_manager_->create_table("s", {{"a", TYPE_INT, 4}}, nullptr);
+    int t_id = sm_manager_->db_.get_table("t").id;
+    const TableHandle *handle = &sm_manager_->get_table_handle(t_id);
+    EXPECT_EQ(handle, &sm_manager_->get_table_handle("t"));
+    EXPECT_TRUE(handle->indexes.empty());
+
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    sm_manager_->create_index("t", {"b", "c"}, nullptr);
+    sm_manager_->create_index("t", {"c"}, nullptr);
+    expect_handle_matches("t");
+    int bc_id = sm_manager_->db_.get_table("t").get_index_meta({"b", "c"})->id;
+    int c_id = sm_manager_->db_.get_table("t").get_index_meta({"c"})->id;
+
+    // 删除索引后句柄原地更新，剩下的索引编号不变
+    sm_manager_->drop_index("t", std::vector<std::string>{"a"}, nullptr);
+    EXPECT_EQ(&sm_manager_->get_table_handle(t_id), handle);
+    expect_handle_matches("t");
+    EXPECT_EQ(handle->get_index(bc_id).meta->cols[0].name, "b");
+    EXPECT_EQ(handle->get_index(c_id).meta->cols[0].name, "c");
+    EXPECT_THROW(handle->get_index(-1), InternalError);
+
+    sm_manager_->rebuild_indexes("t");
+    expect_handle_matches("t");
+
+    sm_manager_->drop_table("s", nullptr);
+    EXPECT_THROW(sm_manager_->get_table_handle("s"), TableNotFoundError);
+
+    // 新建的索引不复用已经删除的编号
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    int a_id = sm_manager_->db_.get_table("t").get_index_meta({"a"})->id;
+    EXPECT_NE(a_id, bc_id);
+    EXPECT_NE(a_id, c_id);
+
+    reopen();
+    expect_handle_matches("t");
+    const TabMeta &tab = sm_manager_->db_.get_table("t");
+    EXPECT_EQ(tab.id, t_id);
+    EXPECT_EQ(tab.get_index_meta({"a"})->id, a_id);
+    EXPECT_EQ(tab.get_index_meta({"b", "c"})->id, bc_id);
+    EXPECT_EQ(tab.get_index_meta({"c"})->id, c_id);
+    EXPECT_FALSE(sm_manager_->db_.is_table("s"));
+    sm_manager_->create_table("r", {{"a", TYPE_INT, 4}}, nullptr);
+    EXPECT_GT(sm_manager_->db_.get_table("r").id, t_id + 1);
+}
+
+// 打开数据库时不打开任何表，表在第一次使用时打开，没有打开的表上的DDL在打开时生效
+TEST_F(SmManagerTest, TablesOpenOnFirstUse) {
+    sm_manager_->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}}, nullptr);
+    sm_manager_->create_table("s", {{"a", TYPE_INT, 4}}, nullptr);
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    sm_manager_->create_index("t", {"b"}, nullptr);
+
+    reopen();
+    EXPECT_TRUE(sm_manager_->fhs_.empty());
+    EXPECT_TRUE(sm_manager_->ihs_.empty());
+    EXPECT_TRUE(sm_manager_->get_open_tables().empty());
+
+    // 按索引文件名打开所属的表
+    auto ix_name = ix_manager_->get_index_name("t", std::vector<std::string>{"b"});
+    int fd = sm_manager_->open_file_by_name(ix_name);
+    EXPECT_EQ(fd, disk_manager_->find_file_fd(ix_name));
+    EXPECT_NE(fd, -1);
+    EXPECT_EQ(sm_manager_->get_open_tables().size(), 1u);
+    EXPECT_FALSE(sm_manager_->fhs_.count("s"));
+    expect_handle_matches("t");
+    EXPECT_EQ(sm_manager_->open_file_by_name("missing"), -1);
+
+    reopen();
+    sm_manager_->drop_index("t", std::vector<std::string>{"a"}, nullptr);
+    sm_manager_->create_index("s", {"a"}, nullptr);
+    EXPECT_FALSE(sm_manager_->fhs_.count("t"));
+    expect_handle_matches("s");
+    expect_handle_matches("t");
+    EXPECT_EQ(sm_manager_->get_table_handle("t").indexes.size(), 1u);
+}
+
+// VACUUM把末尾页面中的记录移动到前面的空闲空间并截掉空页面，记录和索引在整理和重新打开数据库后保持一致
+TEST_F(SmManagerTest, VacuumCompactsTable) {
+    sm_manager_->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_STRING, 28}}, nullptr);
+    RmFileHandle *fh = sm_manager_->get_table_handle("t").fh;
+    const int num_records = 5000;
+    std::vector<Rid> rids;
+    char buf[32] = {0};
+    for (int a = 0; a < num_records; a++) {
+        memcpy(buf, &a, sizeof(a));
+        rids.push_back(fh->insert_record(buf, nullptr));
+    }
+    sm_manager_->create_index("t", {"a"}, nullptr);
+    // 只保留每50条中的一条，它们分散在所有页面中
+    std::set<int> kept;
+    for (int a = 0; a < num_records; a++) {
+        if (a % 50 == 0) {
+            kept.insert(a);
+        } else {
+            fh->delete_record(rids[a], nullptr);
+        }
+    }
+    sm_manager_->rebuild_indexes("t");
+    int old_pages = fh->get_file_hdr().num_pages;
+
+    auto check = [&]() {
+        RmFileHandle *fh = sm_manager_->get_table_handle("t").fh;
+        std::set<int> found;
+        for (RmScan scan(fh); !scan.is_end(); scan.next()) {
+            found.insert(*reinterpret_cast<const int *>(scan.record()));
+        }
+        EXPECT_EQ(found, kept);
+        IxIndexHandle *ih = sm_manager_->get_table_handle("t").indexes[0].ih;
+        Transaction txn(0);
+        for (int a : kept) {
+            std::vector<Rid> result;
+            ASSERT_TRUE(ih->get_value(reinterpret_cast<const char *>(&a), &result, &txn));
+            ASSERT_EQ(result.size(), 1u);
+            EXPECT_EQ(*reinterpret_cast<const int *>(fh->get_record(result[0], nullptr)->data), a);
+        }
+    };
+
+    int released = sm_manager_->vacuum_table("t", nullptr);
+    EXPECT_GT(released, 0);
+    EXPECT_EQ(fh->get_file_hdr().num_pages, old_pages - released);
+    EXPECT_EQ(fh->get_file_hdr().num_pages, RM_FIRST_RECORD_PAGE + 1);
+    check();
+    // 已经整理过的表不再截掉页面
+    EXPECT_EQ(sm_manager_->vacuum_table("t", nullptr), 0);
+
+    reopen();
+    check();
+}
+
+// 分区作为隐藏的子表创建，记录按分区字段路由，条件剪掉不可能满足的分区；索引和删除级联到各个分区
+TEST_F(SmManagerTest, PartitionedTables) {
+    auto int_bytes = [](int v) { return std::string(reinterpret_cast<const char *>(&v), sizeof(v)); };
+    PartitionSpec range;
+    range.kind = PartitionKind::RANGE;
+    range.col_name = "a";
+    range.bounds = {int_bytes(10), int_bytes(20)};
+    range.partitions.assign(3, -1);
+    sm_manager_->create_table("r", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}}, nullptr, TableLayout::ROW, range);
+    PartitionSpec hash;
+    hash.kind = PartitionKind::HASH;
+    hash.col_name = "a";
+    hash.partitions.assign(4, -1);
+    sm_manager_->create_table("h", {{"a", TYPE_INT, 4}}, nullptr, TableLayout::ROW, hash);
+
+    // 分区数与上界个数不符、上界不递增时拒绝
+    PartitionSpec bad = range;
+    bad.bounds = {int_bytes(20), int_bytes(10)};
+    EXPECT_THROW(sm_manager_->create_table("x", {{"a", TYPE_INT, 4}}, nullptr, TableLayout::ROW, bad),
+                 InvalidPartitionError);
+    bad.bounds.pop_back();
+    EXPECT_THROW(sm_manager_->create_table("x", {{"a", TYPE_INT, 4}}, nullptr, TableLayout::ROW, bad),
+                 InvalidPartitionError);
+    EXPECT_FALSE(sm_manager_->db_.is_table("x"));
+
+    auto check = [&]() {
+        const TabMeta &r = sm_manager_->db_.get_table("r");
+        ASSERT_TRUE(r.is_partitioned());
+        ASSERT_EQ(r.partition.partitions.size(), 3u);
+        for (size_t i = 0; i < 3; i++) {
+            const TabMeta &child = sm_manager_->db_.get_table("r#p" + std::to_string(i));
+            EXPECT_EQ(child.id, r.partition.partitions[i]);
+            EXPECT_EQ(child.parent_id, r.id);
+            EXPECT_EQ(child.cols[0].tab_name, "r");
+            ASSERT_EQ(child.indexes.size(), r.indexes.size());
+            for (size_t j = 0; j < r.indexes.size(); j++) {
+                EXPECT_EQ(child.indexes[j].id, r.indexes[j].id);
+            }
+        }
+
+        // RANGE: (-inf,10) [10,20) [20,+inf)
+        for (auto [a, p] : std::vector<std::pair<int, int>>{{-5, 0}, {9, 0}, {10, 1}, {19, 1}, {20, 2}, {100, 2}}) {
+            EXPECT_EQ(partition_of(r, reinterpret_cast<const char *>(&a)), p);
+        }
+        auto cond = [](const std::string &tab, CompOp op, int v) {
+            Condition c;
+            c.lhs_col = {tab, "a"};
+            c.op = op;
+            c.is_rhs_val = true;
+            c.rhs_val.set_int(v);
+            c.rhs_val.init_raw(sizeof(int));
+            return c;
+        };
+        EXPECT_EQ(prune_partitions(r, {}), (std::vector<int>{0, 1, 2}));
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_EQ, 15)}), (std::vector<int>{1}));
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_LT, 10)}), (std::vector<int>{0}));
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_LE, 10)}), (std::vector<int>{0, 1}));
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_GE, 10), cond("r", OP_LT, 20)}), (std::vector<int>{1}));
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_GT, 20), cond("r", OP_LT, 5)}), std::vector<int>());
+        EXPECT_EQ(prune_partitions(r, {cond("r", OP_NE, 15)}), (std::vector<int>{0, 1, 2}));
+        // 剪枝后没有分区时仍扫描一个分区，结果为空
+        EXPECT_EQ(sm_manager_->get_partitions(r, {cond("r", OP_GT, 20), cond("r", OP_LT, 5)}).size(), 1u);
+
+        // HASH: 等值条件只剩一个分区，相同的值总在同一个分区
+        const TabMeta &h = sm_manager_->db_.get_table("h");
+        std::set<int> used;
+        for (int a = 0; a < 100; a++) {
+            int p = partition_of(h, reinterpret_cast<const char *>(&a));
+            ASSERT_GE(p, 0);
+            ASSERT_LT(p, 4);
+            used.insert(p);
+            EXPECT_EQ(prune_partitions(h, {cond("h", OP_EQ, a)}), std::vector<int>{p});
+        }
+        EXPECT_EQ(used.size(), 4u);
+        EXPECT_EQ(prune_partitions(h, {cond("h", OP_LT, 5)}).size(), 4u);
+    };
+
+    sm_manager_->create_index("r", {"b"}, nullptr);
+    sm_manager_->create_index("r", {"a"}, nullptr);
+    sm_manager_->drop_index("r", {"b"}, nullptr);
+    check();
+    reopen();
+    check();
+
+    sm_manager_->drop_table("r", nullptr);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_FALSE(sm_manager_->db_.is_table("r#p" + std::to_string(i)));
+    }
+    EXPECT_TRUE(sm_manager_->db_.is_table("h#p0"));
+}
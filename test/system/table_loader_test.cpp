@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "errors.h"
+#include "system/table_loader.h"
+
+// 表t(id INT, score FLOAT, name CHAR(8))，记录长度16
+static TabMeta MakeTable() {
+    TabMeta tab;
+    tab.name = "t";
+    tab.cols.push_back({"t", "id", TYPE_INT, 4, 0, false});
+    tab.cols.push_back({"t", "score", TYPE_FLOAT, 4, 4, false});
+    tab.cols.push_back({"t", "name", TYPE_STRING, 8, 8, false});
+    return tab;
+}
+
+static void CheckRecord(const char *record, int id, float score, const char *name) {
+    EXPECT_EQ(*reinterpret_cast<const int *>(record), id);
+    EXPECT_FLOAT_EQ(*reinterpret_cast<const float *>(record + 4), score);
+    char expected[8] = {};
+    memcpy(expected, name, strlen(name));
+    EXPECT_EQ(memcmp(record + 8, expected, 8), 0) << std::string(record + 8, 8);
+}
+
+/**
+ * @brief 按字段类型解析每一行，支持引号、空白、\r\n和空行
+ */
+TEST(TableLoaderTest, ParsesFields) {
+    TableLoader loader(MakeTable(), 16, 1);
+    std::string csv = "1,2.5,abc\r\n\n -7 , 0.25 ,\"x,\"\"y\"\"\"\n3,1e2,";
+    auto chunks = loader.parse(csv.data(), csv.size());
+    ASSERT_EQ(chunks.size(), 1);
+    ASSERT_EQ(chunks[0].size(), 3 * 16);
+    CheckRecord(chunks[0].data(), 1, 2.5, "abc");
+    CheckRecord(chunks[0].data() + 16, -7, 0.25, "x,\"y\"");
+    CheckRecord(chunks[0].data() + 32, 3, 100, "");
+}
+
+/**
+ * @brief 格式错误时报告出错的行号
+ */
+TEST(TableLoaderTest, ReportsLine) {
+    TableLoader loader(MakeTable(), 16, 1);
+    std::vector<std::pair<std::string, std::string>> cases = {
+        {"1,1,a\n2,x,b\n", "t:2: invalid float value 'x'"},
+        {"1,1,a\n\n2,1\n", "t:3: expected 3 fields, got 2"},
+        {"1,1,a,b\n", "t:1: expected 3 fields, got more"},
+        {"1,1,abcdefghi\n", "t:1: string too long"},
+        {"99999999999,1,a\n", "t:1: invalid int value"},
+        {"1,1,\"a\n", "t:1: unterminated quoted field"},
+    };
+    for (auto &[csv, msg] : cases) {
+        try {
+            loader.parse(csv.data(), csv.size());
+            ADD_FAILURE() << csv;
+        } catch (LoadDataError &e) {
+            EXPECT_NE(std::string(e.what()).find(msg), std::string::npos) << e.what();
+        }
+    }
+}
+
+/**
+ * @brief 大文件按行边界切分后并行解析，结果与文件中的顺序一致
+ */
+TEST(TableLoaderTest, ParallelLoadFile) {
+    const std::string file_name = "table_loader_test.csv";
+    const int num_rows = 200000;
+    {
+        std::ofstream out(file_name);
+        for (int i = 0; i < num_rows; i++) {
+            out << i << "," << i * 0.5 << ",n" << i % 1000 << "\n";
+        }
+    }
+    TableLoader loader(MakeTable(), 16, 4);
+    auto chunks = loader.load_file(file_name);
+    std::remove(file_name.c_str());
+    EXPECT_GT(chunks.size(), 1);
+    int next = 0;
+    for (auto &chunk : chunks) {
+        for (size_t offset = 0; offset < chunk.size(); offset += 16, next++) {
+            CheckRecord(chunk.data() + offset, next, next * 0.5f, ("n" + std::to_string(next % 1000)).c_str());
+        }
+    }
+    EXPECT_EQ(next, num_rows);
+
+    EXPECT_THROW(loader.load_file(file_name), FileNotFoundError);
+}
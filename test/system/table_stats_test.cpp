@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+
+#define private public
+#include "system/sm_stats.h"
+#undef private  // for use private variables in HyperLogLog
+
+// 由int值构建字段的统计信息，每个值代表scale条记录
+static ColumnStats BuildIntStats(std::vector<int> values, double scale = 1) {
+    ColumnStats stats;
+    for (auto &v : values) {
+        stats.hll.add(stats_hash(reinterpret_cast<const char *>(&v), TYPE_INT, sizeof(int)));
+    }
+    std::sort(values.begin(), values.end());
+    std::vector<const char *> sorted;
+    size_t distinct = 0;
+    for (size_t i = 0; i < values.size(); i++) {
+        sorted.push_back(reinterpret_cast<const char *>(&values[i]));
+        distinct += i == 0 || values[i] != values[i - 1];
+    }
+    stats.build(sorted, TYPE_INT, sizeof(int), static_cast<double>(distinct), scale);
+    return stats;
+}
+
+static double Less(const ColumnStats &stats, int v) {
+    return stats.less_fraction(reinterpret_cast<const char *>(&v), TYPE_INT, sizeof(int));
+}
+
+/**
+ * @brief HyperLogLog的估计误差在几个标准误差以内，重复加入的值不影响估计
+ */
+TEST(TableStatsTest, HyperLogLogEstimate) {
+    for (int n : {10, 1000, 100000}) {
+        HyperLogLog hll;
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < n; i++) {
+                hll.add(stats_hash(reinterpret_cast<const char *>(&i), TYPE_INT, sizeof(int)));
+            }
+        }
+        EXPECT_NEAR(hll.estimate(), n, n * 0.1 + 1) << n;
+    }
+}
+
+/**
+ * @brief 等深直方图估计范围条件的选择率，超出最小/最大值的常量选择率为0或1
+ */
+TEST(TableStatsTest, HistogramRangeFraction) {
+    std::vector<int> values;
+    for (int i = 0; i < 1000; i++) {
+        values.push_back(i);
+    }
+    ColumnStats stats = BuildIntStats(values);
+    EXPECT_EQ(stats.bounds.size(), STATS_HISTOGRAM_BUCKETS);
+    EXPECT_NEAR(stats.ndv, 1000, 100);
+    EXPECT_DOUBLE_EQ(Less(stats, -5), 0);
+    EXPECT_DOUBLE_EQ(Less(stats, 5000), 1);
+    EXPECT_NEAR(Less(stats, 250), 0.25, 0.02);
+    EXPECT_NEAR(Less(stats, 900), 0.9, 0.02);
+    int v = 2000;
+    EXPECT_DOUBLE_EQ(stats.eq_fraction(reinterpret_cast<const char *>(&v), TYPE_INT, sizeof(int)), 0);
+}
+
+/**
+ * @brief 重复值很多时上界相同的桶合并，NDV不按抽样比例放大
+ */
+TEST(TableStatsTest, SkewedValues) {
+    std::vector<int> values(900, 7);
+    for (int i = 0; i < 100; i++) {
+        values.push_back(100 + i);
+    }
+    ColumnStats stats = BuildIntStats(values, 10);
+    EXPECT_NEAR(stats.ndv, 101, 10);
+    EXPECT_EQ(stats.bounds.size(), 5u);
+    EXPECT_DOUBLE_EQ(stats.counts[0], 8750);
+    EXPECT_NEAR(Less(stats, 8), 0.9, 0.03);
+}
+
+/**
+ * @brief 插入和删除增量维护最小/最大值和直方图，统计信息写入后能完整读回
+ */
+TEST(TableStatsTest, IncrementalUpdateAndSerialize) {
+    std::vector<int> values;
+    for (int i = 0; i < 100; i++) {
+        values.push_back(i);
+    }
+    ColumnStats stats = BuildIntStats(values);
+    for (int v = 100; v < 200; v++) {
+        stats.add(reinterpret_cast<const char *>(&v), TYPE_INT, sizeof(int));
+    }
+    for (int v = 0; v < 50; v++) {
+        stats.remove(reinterpret_cast<const char *>(&v), TYPE_INT, sizeof(int));
+    }
+    EXPECT_EQ(*reinterpret_cast<const int *>(stats.max.data()), 199);
+    EXPECT_NEAR(stats.ndv, 200, 20);
+    EXPECT_NEAR(Less(stats, 100), 1.0 / 3, 0.05);
+
+    TableStats table;
+    table.row_count = 150;
+    table.cols.push_back(stats);
+    CatalogEncoder encoder;
+    table.encode(encoder);
+    CatalogDecoder decoder(encoder.buffer().data(), encoder.buffer().size());
+    TableStats loaded;
+    loaded.decode(decoder);
+    EXPECT_TRUE(decoder.at_end());
+    ASSERT_EQ(loaded.cols.size(), 1u);
+    EXPECT_EQ(loaded.row_count, 150);
+    EXPECT_EQ(loaded.cols[0].bounds, stats.bounds);
+    EXPECT_EQ(loaded.cols[0].min, stats.min);
+    EXPECT_EQ(loaded.cols[0].hll.regs_, stats.hll.regs_);
+    EXPECT_DOUBLE_EQ(loaded.cols[0].hll.estimate(), stats.hll.estimate());
+    EXPECT_NEAR(Less(loaded.cols[0], 100), Less(stats, 100), 1e-3);
+}
@@ -0,0 +1,221 @@
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "transaction/concurrency/lock_manager.h"
+#undef private  // for use private variables in LockManager
+
+// 共享锁之间相容；与其他事务的锁冲突时，比持有者年轻的申请者立即回滚
+TEST(LockManagerTest, SharedAndExclusive) {
+    LockManager lock_manager;
+    Transaction t1(1), t2(2);
+    Rid rid{1, 3};
+    EXPECT_TRUE(lock_manager.lock_shared_on_record(&t1, rid, 5));
+    EXPECT_TRUE(lock_manager.lock_shared_on_record(&t2, rid, 5));
+    EXPECT_EQ(t1.get_state(), TransactionState::GROWING);
+    EXPECT_THROW(lock_manager.lock_exclusive_on_record(&t2, rid, 5), TransactionAbortException);
+    // 另一条记录不受影响
+    EXPECT_TRUE(lock_manager.lock_exclusive_on_record(&t1, Rid{1, 4}, 5));
+    EXPECT_THROW(lock_manager.lock_shared_on_record(&t2, Rid{1, 4}, 5), TransactionAbortException);
+    EXPECT_EQ(t1.get_lock_set()->size(), 2u);
+    EXPECT_EQ(t2.get_lock_set()->size(), 1u);
+
+    // t2释放后t1可以升级为排他锁，释放锁后不能再加锁
+    EXPECT_TRUE(lock_manager.unlock(&t2, LockDataId(5, rid, LockDataType::RECORD)));
+    EXPECT_EQ(t2.get_state(), TransactionState::SHRINKING);
+    EXPECT_TRUE(lock_manager.lock_exclusive_on_record(&t1, rid, 5));
+    EXPECT_THROW(lock_manager.lock_shared_on_record(&t2, Rid{2, 0}, 5), TransactionAbortException);
+}
+
+// 表级意向锁的相容矩阵以及S与IX组合为SIX
+TEST(LockManagerTest, IntentionLocks) {
+    LockManager lock_manager;
+    Transaction t1(1), t2(2), t3(3);
+    EXPECT_TRUE(lock_manager.lock_IX_on_table(&t1, 7));
+    EXPECT_TRUE(lock_manager.lock_IS_on_table(&t2, 7));
+    EXPECT_TRUE(lock_manager.lock_IX_on_table(&t3, 7));
+    EXPECT_THROW(lock_manager.lock_shared_on_table(&t2, 7), TransactionAbortException);
+
+    LockManager lm;
+    Transaction a(1), b(2);
+    EXPECT_TRUE(lm.lock_shared_on_table(&a, 7));
+    EXPECT_TRUE(lm.lock_IX_on_table(&a, 7));
+    EXPECT_TRUE(lm.lock_IS_on_table(&b, 7));
+    EXPECT_THROW(lm.lock_IX_on_table(&b, 7), TransactionAbortException);
+    EXPECT_EQ(a.get_lock_set()->size(), 1u);
+    auto &bucket = lm.bucket_of(LockDataId(7, LockDataType::TABLE));
+    auto *queue = bucket.lock_table_.at(LockDataId(7, LockDataType::TABLE));
+    EXPECT_EQ(GroupLockModeStr[static_cast<int>(queue->group_lock_mode_)], "SIX");
+}
+
+// 比持有者老的申请者等待，持有者释放锁后被唤醒并获得锁
+TEST(LockManagerTest, OlderTransactionWaits) {
+    LockManager lock_manager;
+    Transaction old_txn(1), young_txn(2);
+    Rid rid{3, 1};
+    ASSERT_TRUE(lock_manager.lock_exclusive_on_record(&young_txn, rid, 2));
+    std::atomic<bool> granted{false};
+    std::thread waiter([&] {
+        lock_manager.lock_shared_on_record(&old_txn, rid, 2);
+        granted = true;
+    });
+    // 等待者进入等待后仍未获得锁
+    auto &bucket = lock_manager.bucket_of(LockDataId(2, rid, LockDataType::RECORD));
+    while (true) {
+        std::scoped_lock lock{bucket.latch_};
+        auto it = bucket.lock_table_.find(LockDataId(2, rid, LockDataType::RECORD));
+        if (it->second->num_waiting_ == 1) {
+            break;
+        }
+    }
+    EXPECT_FALSE(granted);
+    // 排在老事务之后的年轻事务与等待者冲突，立即回滚
+    Transaction younger(3);
+    EXPECT_THROW(lock_manager.lock_exclusive_on_record(&younger, rid, 2), TransactionAbortException);
+    lock_manager.unlock(&young_txn, LockDataId(2, rid, LockDataType::RECORD));
+    waiter.join();
+    EXPECT_TRUE(granted);
+    EXPECT_EQ(old_txn.get_lock_set()->size(), 1u);
+}
+
+// DETECTION策略下冲突的申请总是等待，两个事务互相等待时后台检测出死锁，回滚较年轻的事务
+TEST(LockManagerTest, DetectsDeadlock) {
+    LockManager lock_manager(DeadlockPolicy::DETECTION);
+    Transaction old_txn(1), young_txn(2);
+    Rid a{1, 0}, b{1, 1};
+    ASSERT_TRUE(lock_manager.lock_exclusive_on_record(&old_txn, a, 4));
+    ASSERT_TRUE(lock_manager.lock_exclusive_on_record(&young_txn, b, 4));
+    std::atomic<bool> young_aborted{false};
+    std::thread young([&] {
+        try {
+            lock_manager.lock_shared_on_record(&young_txn, a, 4);
+        } catch (TransactionAbortException &e) {
+            EXPECT_EQ(e.GetAbortReason(), AbortReason::DEADLOCK_PREVENTION);
+            young_aborted = true;
+        }
+        // 回滚时释放持有的锁，老事务得以继续
+        for (auto &id : *young_txn.get_lock_set()) {
+            lock_manager.unlock(&young_txn, id);
+        }
+    });
+    // 老事务与年轻事务的锁冲突也会等待，而不是像wait-die那样由年轻事务立即回滚
+    EXPECT_TRUE(lock_manager.lock_exclusive_on_record(&old_txn, b, 4));
+    young.join();
+    EXPECT_TRUE(young_aborted);
+    EXPECT_EQ(old_txn.get_lock_set()->size(), 2u);
+    EXPECT_EQ(lock_manager.detect_deadlocks(), 0u);
+}
+
+// 一张表上的行级锁超过LOCK_ESCALATION_THRESHOLD后升级为表级锁，并释放该表上的行级锁
+TEST(LockManagerTest, EscalatesRowLocks) {
+    LockManager lock_manager;
+    Transaction writer(1), reader(2), other(3);
+    const int num_rows = static_cast<int>(LOCK_ESCALATION_THRESHOLD) + 1;
+    ASSERT_TRUE(lock_manager.lock_IX_on_table(&writer, 9));
+    ASSERT_TRUE(lock_manager.lock_shared_on_record(&writer, Rid{0, 0}, 8));
+    for (int i = 0; i < num_rows; i++) {
+        ASSERT_TRUE(lock_manager.lock_exclusive_on_record(&writer, Rid{1 + i / 100, i % 100}, 9));
+    }
+    // 表9上只剩一个表级锁，其他表上的锁不受影响
+    EXPECT_EQ(writer.get_lock_set()->size(), 2u);
+    EXPECT_EQ(writer.get_lock_set()->count(LockDataId(9, LockDataType::TABLE)), 1u);
+    EXPECT_TRUE(writer.get_table_row_locks()[9].escalated);
+    EXPECT_EQ(writer.get_state(), TransactionState::GROWING);
+    // 之后的行级锁被表级锁覆盖，不再进入锁表
+    EXPECT_TRUE(lock_manager.lock_exclusive_on_record(&writer, Rid{1000, 0}, 9));
+    EXPECT_EQ(writer.get_lock_set()->size(), 2u);
+    size_t num_queues = 0;
+    for (auto &bucket : lock_manager.buckets_) {
+        num_queues += bucket.lock_table_.size();
+    }
+    EXPECT_EQ(num_queues, 2u);
+    // 其他事务无法再访问该表
+    EXPECT_THROW(lock_manager.lock_IS_on_table(&other, 9), TransactionAbortException);
+
+    // 只持有行级共享锁时升级为表级共享锁，其他事务仍然可以读
+    for (int i = 0; i < num_rows; i++) {
+        ASSERT_TRUE(lock_manager.lock_shared_on_record(&reader, Rid{1 + i / 100, i % 100}, 10));
+    }
+    EXPECT_EQ(reader.get_lock_set()->size(), 1u);
+    EXPECT_FALSE(reader.get_table_row_locks()[10].escalated_exclusive);
+    Transaction another_reader(4);
+    EXPECT_TRUE(lock_manager.lock_IS_on_table(&another_reader, 10));
+}
+
+// 加锁队列在没有事务持有锁后归还给桶内的对象池，之后的加锁复用这些队列
+TEST(LockManagerTest, QueuesAreReused) {
+    LockManager lock_manager;
+    for (int round = 0; round < 3; round++) {
+        Transaction txn(round);
+        for (int i = 0; i < 1000; i++) {
+            lock_manager.lock_exclusive_on_record(&txn, Rid{i / 100, i % 100}, 3);
+        }
+        for (auto &id : *txn.get_lock_set()) {
+            EXPECT_TRUE(lock_manager.unlock(&txn, id));
+        }
+    }
+    size_t pooled = 0;
+    for (auto &bucket : lock_manager.buckets_) {
+        EXPECT_TRUE(bucket.lock_table_.empty());
+        EXPECT_EQ(bucket.free_queues_.size(), bucket.queue_pool_.size());
+        pooled += bucket.queue_pool_.size();
+    }
+    EXPECT_EQ(pooled, 1000u);
+}
+
+// 多个线程的事务以随机顺序对一组共享的记录加排他锁，冲突时老事务等待、年轻事务回滚，不会死锁；
+// 同一时刻每条记录最多被一个事务持有
+TEST(LockManagerTest, ConcurrentTransactions) {
+    LockManager lock_manager;
+    const int num_threads = 8;
+    const int num_records = 16;
+    std::atomic<int> next_ts{0};
+    std::atomic<int> committed{0};
+    std::vector<std::atomic<int>> owners(num_records);
+    for (auto &owner : owners) {
+        owner = -1;
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            for (int round = 0; round < 200; round++) {
+                Transaction txn(t * 1000 + round);
+                txn.set_start_ts(next_ts++);
+                std::vector<int> held;
+                try {
+                    lock_manager.lock_IX_on_table(&txn, 1);
+                    for (int i = 0; i < 4; i++) {
+                        int r = rng() % num_records;
+                        lock_manager.lock_exclusive_on_record(&txn, Rid{1, r}, 1);
+                        int expected = -1;
+                        if (owners[r].compare_exchange_strong(expected, txn.get_transaction_id())) {
+                            held.push_back(r);
+                        } else {
+                            EXPECT_EQ(expected, txn.get_transaction_id());
+                        }
+                    }
+                    committed++;
+                } catch (TransactionAbortException &) {
+                }
+                for (int r : held) {
+                    owners[r] = -1;
+                }
+                for (auto &id : *txn.get_lock_set()) {
+                    lock_manager.unlock(&txn, id);
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_GT(committed.load(), 0);
+    for (auto &bucket : lock_manager.buckets_) {
+        EXPECT_TRUE(bucket.lock_table_.empty());
+    }
+}
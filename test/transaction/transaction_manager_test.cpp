@@ -0,0 +1,230 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "record/rm.h"
+#include "transaction/transaction_manager.h"
+
+// 结束并release()的事务从事务表中消失，事务对象被之后的begin()复用，复用的事务是全新的状态
+TEST(TransactionManagerTest, ReleaseRecyclesTransaction) {
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, nullptr);
+
+    Transaction *txn = txn_manager.begin(nullptr, nullptr);
+    txn_id_t txn_id = txn->get_transaction_id();
+    txn->set_txn_mode(true);
+    txn->set_prev_lsn(42);
+    EXPECT_TRUE(lock_manager.lock_IX_on_table(txn, 3));
+    EXPECT_EQ(txn_manager.get_transaction(txn_id), txn);
+    txn_manager.commit(txn, nullptr);
+    EXPECT_EQ(txn->get_state(), TransactionState::COMMITTED);
+    txn_manager.release(txn);
+    EXPECT_EQ(txn_manager.get_transaction(txn_id), nullptr);
+    EXPECT_EQ(txn_manager.get_num_txns(), 0u);
+
+    // 事务ID按分片数递增后落到同一分片，取到刚放回的对象
+    Transaction *reused = nullptr;
+    std::vector<Transaction *> others;
+    for (size_t i = 0; i < TXN_TABLE_SHARDS; i++) {
+        Transaction *next = txn_manager.begin(nullptr, nullptr);
+        if (next == txn) {
+            reused = next;
+        } else {
+            others.push_back(next);
+        }
+    }
+    ASSERT_EQ(reused, txn);
+    EXPECT_NE(reused->get_transaction_id(), txn_id);
+    EXPECT_EQ(reused->get_state(), TransactionState::DEFAULT);
+    EXPECT_FALSE(reused->get_txn_mode());
+    EXPECT_EQ(reused->get_prev_lsn(), INVALID_LSN);
+    EXPECT_TRUE(reused->get_lock_set()->empty());
+    EXPECT_EQ(txn_manager.get_transaction(reused->get_transaction_id()), reused);
+    for (auto *other : others) {
+        txn_manager.abort(other, nullptr);
+        txn_manager.release(other);
+    }
+    EXPECT_EQ(txn_manager.get_num_txns(), 1u);
+}
+
+// 调用者传入的事务只登记到事务表中，release()不会回收或释放它
+TEST(TransactionManagerTest, CallerOwnedTransaction) {
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, nullptr);
+    Transaction txn(1000);
+    EXPECT_EQ(txn_manager.begin(&txn, nullptr), &txn);
+    EXPECT_EQ(txn_manager.get_transaction(1000), &txn);
+    txn_manager.commit(&txn, nullptr);
+    txn_manager.release(&txn);
+    EXPECT_EQ(txn_manager.get_transaction(1000), nullptr);
+    EXPECT_NE(txn_manager.begin(nullptr, nullptr), &txn);
+}
+
+// 多个线程并发地开始、查找、提交和释放事务，事务ID互不相同，事务表最终为空
+TEST(TransactionManagerTest, ConcurrentBeginCommit) {
+    constexpr int num_threads = 8;
+    constexpr int txns_per_thread = 5000;
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, nullptr);
+
+    std::vector<std::vector<txn_id_t>> ids(num_threads);
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < txns_per_thread; i++) {
+                Transaction *txn = txn_manager.begin(nullptr, nullptr);
+                txn_id_t txn_id = txn->get_transaction_id();
+                if (txn_manager.get_transaction(txn_id) != txn || txn->get_state() != TransactionState::DEFAULT) {
+                    failures++;
+                }
+                ids[t].push_back(txn_id);
+                txn_manager.commit(txn, nullptr);
+                txn_manager.release(txn);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(txn_manager.get_num_txns(), 0u);
+    std::unordered_set<txn_id_t> distinct;
+    for (auto &thread_ids : ids) {
+        distinct.insert(thread_ids.begin(), thread_ids.end());
+    }
+    EXPECT_EQ(distinct.size(), static_cast<size_t>(num_threads * txns_per_thread));
+}
+
+namespace {
+
+const std::string DB_NAME = "transaction_manager_test_db";
+
+// 像DML执行器一样修改表t(a, b)：先登记undo记录和旧版本，再修改堆表和索引
+class TableWriter {
+   public:
+    TableWriter(SmManager *sm_manager, Transaction *txn) : sm_manager_(sm_manager), txn_(txn) {
+        tab_ = &sm_manager_->db_.get_table("t");
+        const TableHandle &handle = sm_manager_->get_table_handle("t");
+        fh_ = handle.fh;
+        ih_ = handle.indexes[0].ih;
+    }
+
+    Rid insert(int a, int b) {
+        int record[2] = {a, b};
+        VersionStore::Writer versions(nullptr, txn_, tab_->id, fh_->GetFd(), sizeof(record));
+        Rid rid = fh_->insert_record(reinterpret_cast<char *>(record), nullptr);
+        versions.insert(rid);
+        ih_->insert_entry(reinterpret_cast<char *>(&a), rid, txn_);
+        return rid;
+    }
+
+    void update(const Rid &rid, int a, int b) {
+        int record[2] = {a, b};
+        auto old_record = fh_->get_record(rid, nullptr);
+        VersionStore::Writer versions(nullptr, txn_, tab_->id, fh_->GetFd(), sizeof(record));
+        versions.update(rid, old_record->data, reinterpret_cast<char *>(record));
+        fh_->update_record(rid, reinterpret_cast<char *>(record), nullptr);
+        if (memcmp(old_record->data, &a, sizeof(a)) != 0) {
+            ih_->delete_entry(old_record->data, txn_);
+            ih_->insert_entry(reinterpret_cast<char *>(&a), rid, txn_);
+        }
+    }
+
+    void remove(const Rid &rid) {
+        auto old_record = fh_->get_record(rid, nullptr);
+        VersionStore::Writer versions(nullptr, txn_, tab_->id, fh_->GetFd(), old_record->size);
+        versions.remove(rid, old_record->data);
+        fh_->delete_record(rid, nullptr);
+        ih_->delete_entry(old_record->data, txn_);
+    }
+
+    RmFileHandle *file() { return fh_; }
+
+    IxIndexHandle *index() { return ih_; }
+
+   private:
+    SmManager *sm_manager_;
+    Transaction *txn_;
+    TabMeta *tab_;
+    RmFileHandle *fh_;
+    IxIndexHandle *ih_;
+};
+
+}  // namespace
+
+// 回滚按undo日志从后向前撤销插入、更新(包括索引key的变化)和删除，表和索引恢复到事务开始之前
+TEST(TransactionManagerTest, AbortRestoresTable) {
+    constexpr int num_rows = 300;
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager = std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(),
+                                                  ix_manager.get());
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+    sm_manager->create_db(DB_NAME);
+    ASSERT_EQ(chdir(".."), 0);
+    sm_manager->open_db(DB_NAME);
+    sm_manager->create_table("t", {{"a", TYPE_INT, 4}, {"b", TYPE_INT, 4}}, nullptr);
+    sm_manager->create_index("t", {"a"}, nullptr);
+
+    LockManager lock_manager;
+    TransactionManager txn_manager(&lock_manager, sm_manager.get());
+    std::vector<Rid> rids;
+    {
+        Transaction *txn = txn_manager.begin(nullptr, nullptr);
+        TableWriter writer(sm_manager.get(), txn);
+        for (int a = 0; a < num_rows; a++) {
+            rids.push_back(writer.insert(a, a));
+        }
+        txn_manager.commit(txn, nullptr);
+        EXPECT_TRUE(txn->get_undo_log().empty());
+        txn_manager.release(txn);
+    }
+
+    Transaction *txn = txn_manager.begin(nullptr, nullptr);
+    TableWriter writer(sm_manager.get(), txn);
+    for (int a = num_rows; a < num_rows + 100; a++) {
+        writer.insert(a, a);
+    }
+    for (int i = 0; i < 50; i++) {
+        writer.update(rids[i], i, -1);
+        writer.update(rids[i], i, -2);
+        writer.update(rids[50 + i], 10000 + i, 50 + i);
+        writer.remove(rids[100 + i]);
+    }
+    // 同一条记录先更新再删除
+    writer.update(rids[200], 200, -3);
+    writer.remove(rids[200]);
+    txn_manager.abort(txn, nullptr);
+    EXPECT_EQ(txn->get_state(), TransactionState::ABORTED);
+
+    std::vector<int> seen(num_rows, 0);
+    size_t count = 0;
+    for (RmScan scan(writer.file()); !scan.is_end(); scan.next()) {
+        int record[2];
+        memcpy(record, scan.record(), sizeof(record));
+        ASSERT_GE(record[0], 0);
+        ASSERT_LT(record[0], num_rows);
+        ASSERT_EQ(record[1], record[0]);
+        seen[record[0]]++;
+        count++;
+    }
+    EXPECT_EQ(count, static_cast<size_t>(num_rows));
+    Transaction reader(INVALID_TXN_ID);
+    for (int a : {0, 49, 50, 99, 100, 149, 200, num_rows - 1, num_rows, num_rows + 99, 10000, 10049}) {
+        std::vector<Rid> found;
+        EXPECT_EQ(writer.index()->get_value(reinterpret_cast<const char *>(&a), &found, &reader), a < num_rows) << a;
+    }
+    txn_manager.release(txn);
+
+    sm_manager->close_db();
+    ASSERT_EQ(system(("rm -rf " + DB_NAME).c_str()), 0);
+}
@@ -0,0 +1,116 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "transaction/version_store.h"
+
+namespace {
+
+constexpr int TABLE_ID = 1;
+constexpr int FD = 3;
+constexpr int RECORD_SIZE = 8;
+
+std::string value(const char *data) { return data == nullptr ? "" : std::string(data, strnlen(data, RECORD_SIZE)); }
+
+// 堆表中的一条记录
+struct HeapRecord {
+    char data[RECORD_SIZE] = {};
+
+    explicit HeapRecord(const std::string &s) { set(s); }
+
+    void set(const std::string &s) {
+        memset(data, 0, RECORD_SIZE);
+        memcpy(data, s.data(), s.size());
+    }
+};
+
+}  // namespace
+
+// 未提交的更新只对写入的事务可见，提交后只对之后开始的快照可见
+TEST(VersionStoreTest, UpdateVisibility) {
+    VersionStore store(false);
+    Transaction writer(1), old_reader(2);
+    Rid rid{1, 0};
+    HeapRecord heap("old");
+    store.open_snapshot(10);
+    VersionStore::Snapshot old_snapshot{old_reader.get_transaction_id(), 10};
+    {
+        VersionStore::Writer versions(&store, &writer, TABLE_ID, FD, RECORD_SIZE);
+        HeapRecord updated("new");
+        versions.update(rid, heap.data, updated.data);
+        heap.set("new");
+    }
+    VersionStore::Table *table = store.get_table(FD);
+    VersionStore::Snapshot own{writer.get_transaction_id(), 5};
+    EXPECT_EQ(value(table->resolve(old_snapshot, rid, heap.data)), "old");
+    EXPECT_EQ(value(table->resolve(own, rid, heap.data)), "new");
+
+    store.seal(&writer, 11);
+    VersionStore::Snapshot new_snapshot{3, 12};
+    EXPECT_EQ(value(table->resolve(old_snapshot, rid, heap.data)), "old");
+    EXPECT_EQ(value(table->resolve(new_snapshot, rid, heap.data)), "new");
+    // 没有版本链的记录直接读取堆表
+    EXPECT_EQ(value(table->resolve(old_snapshot, Rid{1, 1}, heap.data)), "new");
+}
+
+// 快照开始后插入的记录不可见，删除的记录仍然可见
+TEST(VersionStoreTest, InsertAndDelete) {
+    VersionStore store(false);
+    Transaction t1(1), t2(2);
+    HeapRecord deleted("gone");
+    HeapRecord inserted("fresh");
+    VersionStore::Snapshot snapshot{9, 10};
+    {
+        VersionStore::Writer versions(&store, &t1, TABLE_ID, FD, RECORD_SIZE);
+        versions.remove(Rid{2, 4}, deleted.data);
+        versions.insert(Rid{2, 5});
+    }
+    {
+        VersionStore::Writer versions(&store, &t2, TABLE_ID, FD, RECORD_SIZE);
+        versions.remove(Rid{5, 0}, deleted.data);
+    }
+    store.seal(&t1, 11);
+    VersionStore::Table *table = store.get_table(FD);
+    EXPECT_EQ(table->resolve(snapshot, Rid{2, 5}, inserted.data), nullptr);
+
+    std::vector<int> pages;
+    table->for_each_deleted(snapshot, 0, 5, [&](const Rid &rid, const char *data) {
+        EXPECT_EQ(value(data), "gone");
+        pages.push_back(rid.page_no);
+    });
+    EXPECT_EQ(pages, std::vector<int>{2});
+    // 对之后的快照，已提交的删除生效
+    VersionStore::Snapshot later{9, 12};
+    pages.clear();
+    table->for_each_deleted(later, 0, 10, [&](const Rid &rid, const char *) { pages.push_back(rid.page_no); });
+    EXPECT_EQ(pages, std::vector<int>{5});
+}
+
+// 所有快照都能看到提交后的记录时回收旧版本，尚未结束的事务的版本保留
+TEST(VersionStoreTest, GarbageCollection) {
+    VersionStore store(false);
+    Transaction t1(1), t2(2);
+    HeapRecord heap("v0");
+    HeapRecord updated("v1");
+    store.open_snapshot(10);
+    {
+        VersionStore::Writer versions(&store, &t1, TABLE_ID, FD, RECORD_SIZE);
+        versions.update(Rid{1, 0}, heap.data, updated.data);
+        versions.update(Rid{1, 1}, heap.data, updated.data);
+    }
+    store.seal(&t1, 11);
+    {
+        VersionStore::Writer versions(&store, &t2, TABLE_ID, FD, RECORD_SIZE);
+        versions.update(Rid{1, 1}, heap.data, updated.data);
+    }
+    // 读时间戳为10的快照仍然需要t1之前的版本
+    EXPECT_EQ(store.collect_garbage(), 0u);
+    store.close_snapshot(10);
+    // Rid{1, 0}的整条链被回收；Rid{1, 1}上t2的版本尚未提交，只回收t1的版本
+    EXPECT_EQ(store.collect_garbage(), 2u);
+    EXPECT_TRUE(store.has_versions(FD));
+    store.seal(&t2, 12);
+    EXPECT_EQ(store.collect_garbage(), 1u);
+    EXPECT_FALSE(store.has_versions(FD));
+}
@@ -1,5 +1,33 @@
 #include "lock_manager.h"
 
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+#include "common/metrics.h"
+#include "common/trace.h"
+
+std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
+
+LockManager::LockManager(DeadlockPolicy policy) : buckets_(LOCK_TABLE_BUCKETS), policy_(policy) {
+    if (policy_ == DeadlockPolicy::DETECTION) {
+        detector_ = std::thread(&LockManager::run_cycle_detection, this);
+    }
+}
+
+LockManager::~LockManager() {
+    {
+        std::scoped_lock lock{detector_latch_};
+        stop_detector_ = true;
+    }
+    detector_cv_.notify_all();
+    if (detector_.joinable()) {
+        detector_.join();
+    }
+}
+
 /**
  * @description: 申请行级共享锁
  * @return {bool} 加锁是否成功
@@ -8,8 +36,7 @@
  * @param {int} tab_fd
  */
 bool LockManager::lock_shared_on_record(Transaction* txn, const Rid& rid, int tab_fd) {
-    
-    return true;
+    return lock_record(txn, rid, tab_fd, LockMode::SHARED);
 }
 
 /**
@@ -20,8 +47,7 @@ bool LockManager::lock_shared_on_record(Transaction* txn, const Rid& rid, int ta
  * @param {int} tab_fd 记录所在的表的fd
  */
 bool LockManager::lock_exclusive_on_record(Transaction* txn, const Rid& rid, int tab_fd) {
-
-    return true;
+    return lock_record(txn, rid, tab_fd, LockMode::EXLUCSIVE);
 }
 
 /**
@@ -31,8 +57,7 @@ bool LockManager::lock_exclusive_on_record(Transaction* txn, const Rid& rid, int
  * @param {int} tab_fd 目标表的fd
  */
 bool LockManager::lock_shared_on_table(Transaction* txn, int tab_fd) {
-    
-    return true;
+    return lock(txn, LockDataId(tab_fd, LockDataType::TABLE), LockMode::SHARED);
 }
 
 /**
@@ -42,8 +67,7 @@ bool LockManager::lock_shared_on_table(Transaction* txn, int tab_fd) {
  * @param {int} tab_fd 目标表的fd
  */
 bool LockManager::lock_exclusive_on_table(Transaction* txn, int tab_fd) {
-    
-    return true;
+    return lock(txn, LockDataId(tab_fd, LockDataType::TABLE), LockMode::EXLUCSIVE);
 }
 
 /**
@@ -53,8 +77,7 @@ bool LockManager::lock_exclusive_on_table(Transaction* txn, int tab_fd) {
  * @param {int} tab_fd 目标表的fd
  */
 bool LockManager::lock_IS_on_table(Transaction* txn, int tab_fd) {
-    
-    return true;
+    return lock(txn, LockDataId(tab_fd, LockDataType::TABLE), LockMode::INTENTION_SHARED);
 }
 
 /**
@@ -64,8 +87,7 @@ bool LockManager::lock_IS_on_table(Transaction* txn, int tab_fd) {
  * @param {int} tab_fd 目标表的fd
  */
 bool LockManager::lock_IX_on_table(Transaction* txn, int tab_fd) {
-    
-    return true;
+    return lock(txn, LockDataId(tab_fd, LockDataType::TABLE), LockMode::INTENTION_EXCLUSIVE);
 }
 
 /**
@@ -75,6 +97,382 @@ bool LockManager::lock_IX_on_table(Transaction* txn, int tab_fd) {
  * @param {LockDataId} lock_data_id 要释放的锁ID
  */
 bool LockManager::unlock(Transaction* txn, LockDataId lock_data_id) {
-   
+    if (txn->get_state() == TransactionState::GROWING) {
+        txn->set_state(TransactionState::SHRINKING);
+    }
+    return release(txn, lock_data_id);
+}
+
+/**
+ * @description: 申请行级锁，事务在表上持有的行级锁超过LOCK_ESCALATION_THRESHOLD时升级为表级锁。
+ *               已经升级的表上被表级锁覆盖的行级锁不再申请
+ * @return {bool} 加锁是否成功
+ * @param {Transaction*} txn 要申请锁的事务对象指针
+ * @param {Rid&} rid 加锁的目标记录ID
+ * @param {int} tab_fd 记录所在的表的fd
+ * @param {LockMode} lock_mode SHARED或EXLUCSIVE
+ */
+bool LockManager::lock_record(Transaction* txn, const Rid& rid, int tab_fd, LockMode lock_mode) {
+    bool exclusive = lock_mode == LockMode::EXLUCSIVE;
+    Transaction::TableRowLocks& row_locks = txn->get_table_row_locks()[tab_fd];
+    if (row_locks.escalated && (row_locks.escalated_exclusive || !exclusive)) {
+        return true;
+    }
+    size_t num_held = txn->get_lock_set()->size();
+    lock(txn, LockDataId(tab_fd, rid, LockDataType::RECORD), lock_mode);
+    if (txn->get_lock_set()->size() > num_held) {
+        row_locks.num_locks++;
+    }
+    row_locks.exclusive |= exclusive;
+    if (row_locks.num_locks > LOCK_ESCALATION_THRESHOLD) {
+        escalate(txn, tab_fd, row_locks);
+    }
+    return true;
+}
+
+/**
+ * @description: 把事务在表上的行级锁升级为一个表级锁：持有过行级排他锁时申请表级排他锁，否则申请表级共享锁，
+ *               获得表级锁后释放该表上的所有行级锁。表级锁冲突时与普通的加锁申请一样等待或抛出异常，行级锁保持不变
+ * @param {Transaction*} txn 事务对象指针
+ * @param {int} tab_fd 表的fd
+ * @param {TableRowLocks&} row_locks 事务在该表上持有的行级锁
+ */
+void LockManager::escalate(Transaction* txn, int tab_fd, Transaction::TableRowLocks& row_locks) {
+    bool exclusive = row_locks.exclusive;
+    lock(txn, LockDataId(tab_fd, LockDataType::TABLE), exclusive ? LockMode::EXLUCSIVE : LockMode::SHARED);
+    auto lock_set = txn->get_lock_set();
+    for (auto it = lock_set->begin(); it != lock_set->end();) {
+        if (it->type_ == LockDataType::RECORD && it->fd_ == tab_fd) {
+            release(txn, *it);
+            it = lock_set->erase(it);
+        } else {
+            it++;
+        }
+    }
+    row_locks.num_locks = 0;
+    row_locks.escalated = true;
+    row_locks.escalated_exclusive = exclusive;
+}
+
+// 从加锁队列中移除事务的锁，不改变事务的状态
+bool LockManager::release(Transaction* txn, const LockDataId& lock_data_id) {
+    LockBucket& bucket = bucket_of(lock_data_id);
+    std::scoped_lock lock{bucket.latch_};
+    auto it = bucket.lock_table_.find(lock_data_id);
+    if (it == bucket.lock_table_.end()) {
+        return false;
+    }
+    LockRequestQueue* queue = it->second;
+    auto& requests = queue->request_queue_;
+    auto req = std::find_if(requests.begin(), requests.end(),
+                            [&](const LockRequest& r) { return r.txn_id_ == txn->get_transaction_id(); });
+    if (req == requests.end()) {
+        return false;
+    }
+    requests.erase(req);
+    queue_changed(queue);
+    release_if_unused(bucket, lock_data_id, queue);
+    return true;
+}
+
+/**
+ * @description: 在加锁对象上申请锁，事务已持有的锁不弱于申请的锁时直接返回，否则把已持有的锁升级为两者的组合。
+ *               与其他事务的锁冲突时按wait-die等待或抛出TransactionAbortException
+ * @return {bool} 加锁是否成功
+ * @param {Transaction*} txn 要申请锁的事务对象指针
+ * @param {LockDataId&} lock_data_id 加锁对象
+ * @param {LockMode} lock_mode 申请的锁类型
+ */
+bool LockManager::lock(Transaction* txn, const LockDataId& lock_data_id, LockMode lock_mode) {
+    txn_id_t txn_id = txn->get_transaction_id();
+    if (txn->get_state() == TransactionState::SHRINKING) {
+        EngineMetrics::get().lock_aborts.add();
+        throw TransactionAbortException(txn_id, AbortReason::LOCK_ON_SHIRINKING);
+    }
+    if (txn->get_state() == TransactionState::DEFAULT) {
+        txn->set_state(TransactionState::GROWING);
+    }
+
+    LockBucket& bucket = bucket_of(lock_data_id);
+    std::unique_lock<std::mutex> lock{bucket.latch_};
+    LockRequestQueue*& slot = bucket.lock_table_[lock_data_id];
+    if (slot == nullptr) {
+        if (bucket.free_queues_.empty()) {
+            slot = &bucket.queue_pool_.emplace_back();
+        } else {
+            slot = bucket.free_queues_.back();
+            bucket.free_queues_.pop_back();
+        }
+    }
+    // 等待期间其他对象可能被插入桶中，不再使用指向map元素的引用
+    LockRequestQueue* queue = slot;
+    auto& requests = queue->request_queue_;
+
+    GroupLockMode requested = to_group_mode(lock_mode);
+    auto own = std::find_if(requests.begin(), requests.end(),
+                            [&](const LockRequest& r) { return r.txn_id_ == txn_id; });
+    bool upgrade = own != requests.end();
+    if (upgrade) {
+        GroupLockMode held = to_group_mode(own->lock_mode_);
+        requested = combine(held, requested);
+        if (requested == held) {
+            return true;
+        }
+    } else {
+        own = requests.emplace(requests.end(), txn_id, txn->get_start_ts(), lock_mode);
+    }
+
+    // 新的申请排在队尾，需要与已持有的锁和排在前面的等待者都相容；升级只需与已持有的锁相容
+    bool die;
+    std::chrono::steady_clock::time_point wait_start;
+    bool waited = false;
+    std::optional<TraceSpan> wait_span;
+    while (must_wait(queue, &*own, requested, !upgrade, &die)) {
+        if (own->victim_ || (policy_ == DeadlockPolicy::WAIT_DIE && die)) {
+            own->wait_mode_ = GroupLockMode::NON_LOCK;
+            own->victim_ = false;
+            if (!upgrade) {
+                requests.erase(own);
+                queue_changed(queue);
+                release_if_unused(bucket, lock_data_id, queue);
+            }
+            if (waited) {
+                EngineMetrics::get().lock_wait_latency.observe(std::chrono::steady_clock::now() - wait_start);
+            }
+            EngineMetrics::get().lock_aborts.add();
+            throw TransactionAbortException(txn_id, AbortReason::DEADLOCK_PREVENTION);
+        }
+        if (!waited) {
+            waited = true;
+            wait_start = std::chrono::steady_clock::now();
+            EngineMetrics::get().lock_waits.add();
+            wait_span.emplace("lock.wait", "txn_id", txn_id);
+        }
+        own->wait_mode_ = requested;
+        queue->num_waiting_++;
+        queue->cv_.wait(lock);
+        queue->num_waiting_--;
+    }
+    if (waited) {
+        EngineMetrics::get().lock_wait_latency.observe(std::chrono::steady_clock::now() - wait_start);
+        wait_span.reset();
+    }
+    own->wait_mode_ = GroupLockMode::NON_LOCK;
+    own->victim_ = false;
+    own->lock_mode_ = to_lock_mode(requested);
+    if (!upgrade) {
+        own->granted_ = true;
+        txn->get_lock_set()->insert(lock_data_id);
+    }
+    queue_changed(queue);
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 判断申请self是否需要等待，以及按wait-die是否应当回滚
+ * @return {bool} self与冲突的锁或等待者冲突时返回true
+ * @param {LockRequestQueue*} queue 加锁队列
+ * @param {LockRequest*} self 申请，升级时为已持有的锁
+ * @param {GroupLockMode} requested 申请的锁类型
+ * @param {bool} check_waiting 是否也与排在self前面的等待者比较
+ * @param {bool*} die 冲突的事务中有比self更老的事务时为true
+ * @param {vector<txn_id_t>*} conflicts 不为空时输出所有冲突的事务
+ */
+bool LockManager::must_wait(const LockRequestQueue* queue, const LockRequest* self, GroupLockMode requested,
+                            bool check_waiting, bool* die, std::vector<txn_id_t>* conflicts) {
+    bool conflict = false;
+    bool ahead = true;
+    *die = false;
+    for (auto& req : queue->request_queue_) {
+        if (&req == self) {
+            ahead = false;
+            continue;
+        }
+        if (!req.granted_ && !(check_waiting && ahead)) {
+            continue;
+        }
+        if (compatible(to_group_mode(req.lock_mode_), requested)) {
+            continue;
+        }
+        conflict = true;
+        if (conflicts != nullptr) {
+            conflicts->push_back(req.txn_id_);
+        }
+        if (req.start_ts_ < self->start_ts_) {
+            *die = true;
+        }
+    }
+    return conflict;
+}
+
+/**
+ * @description: 检测一次死锁：锁住所有桶，由正在等待的申请及与它冲突的事务构造waits-for图，
+ *               每找到一个环就把环中开始时间戳最大(最年轻)的事务选为牺牲者并唤醒它，去掉它的出边后继续查找
+ * @return {size_t} 本次选出的牺牲者数
+ */
+size_t LockManager::detect_deadlocks() {
+    // 加锁操作只锁一个桶，这里按固定顺序锁住所有桶，不会与加锁操作死锁
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(buckets_.size());
+    for (auto& bucket : buckets_) {
+        locks.emplace_back(bucket.latch_);
+    }
+
+    // 一个事务同一时刻最多在一个加锁队列上等待
+    struct Waiter {
+        LockRequestQueue* queue;
+        LockRequest* request;
+    };
+    std::map<txn_id_t, std::vector<txn_id_t>> waits_for;    // 有序，使每次检测的结果确定
+    std::unordered_map<txn_id_t, Waiter> waiters;
+    std::unordered_map<txn_id_t, timestamp_t> start_ts;
+    for (auto& bucket : buckets_) {
+        for (auto& [id, queue] : bucket.lock_table_) {
+            for (auto& req : queue->request_queue_) {
+                start_ts[req.txn_id_] = req.start_ts_;
+                if (req.wait_mode_ == GroupLockMode::NON_LOCK || req.victim_) {
+                    continue;
+                }
+                bool die;
+                std::vector<txn_id_t>& edges = waits_for[req.txn_id_];
+                must_wait(queue, &req, req.wait_mode_, !req.granted_, &die, &edges);
+                waiters[req.txn_id_] = {queue, &req};
+            }
+        }
+    }
+
+    size_t num_victims = 0;
+    while (true) {
+        // 深度优先搜索查找一个环，state: 0未访问，1在当前路径上，2已完成
+        std::unordered_map<txn_id_t, int> state;
+        std::vector<txn_id_t> path;
+        std::vector<txn_id_t> cycle;
+        std::function<bool(txn_id_t)> visit = [&](txn_id_t txn) {
+            state[txn] = 1;
+            path.push_back(txn);
+            auto it = waits_for.find(txn);
+            if (it != waits_for.end()) {
+                for (txn_id_t next : it->second) {
+                    if (state[next] == 1) {
+                        cycle.assign(std::find(path.begin(), path.end(), next), path.end());
+                        return true;
+                    }
+                    if (state[next] == 0 && visit(next)) {
+                        return true;
+                    }
+                }
+            }
+            path.pop_back();
+            state[txn] = 2;
+            return false;
+        };
+        for (auto& [txn, edges] : waits_for) {
+            if (state[txn] == 0 && visit(txn)) {
+                break;
+            }
+        }
+        if (cycle.empty()) {
+            break;
+        }
+        txn_id_t victim = *std::max_element(cycle.begin(), cycle.end(),
+                                            [&](txn_id_t a, txn_id_t b) { return start_ts[a] < start_ts[b]; });
+        Waiter& waiter = waiters.at(victim);
+        waiter.request->victim_ = true;
+        waiter.queue->cv_.notify_all();
+        waits_for.erase(victim);
+        num_victims++;
+    }
+    return num_victims;
+}
+
+// 死锁检测线程，每隔cycle_detection_interval检测一次
+void LockManager::run_cycle_detection() {
+    std::unique_lock<std::mutex> lock{detector_latch_};
+    while (!stop_detector_) {
+        detector_cv_.wait_for(lock, cycle_detection_interval, [this] { return stop_detector_; });
+        lock.unlock();
+        detect_deadlocks();
+        lock.lock();
+    }
+}
+
+// 锁被授予、释放或撤销后重新计算队列的锁模式，并唤醒等待者重新检查
+void LockManager::queue_changed(LockRequestQueue* queue) {
+    GroupLockMode mode = GroupLockMode::NON_LOCK;
+    for (auto& req : queue->request_queue_) {
+        if (req.granted_) {
+            mode = combine(mode, to_group_mode(req.lock_mode_));
+        }
+    }
+    queue->group_lock_mode_ = mode;
+    if (queue->num_waiting_ > 0) {
+        queue->cv_.notify_all();
+    }
+}
+
+// 没有事务持有或等待该对象上的锁时，加锁队列归还给对象池
+void LockManager::release_if_unused(LockBucket& bucket, const LockDataId& lock_data_id, LockRequestQueue* queue) {
+    if (queue->request_queue_.empty()) {
+        bucket.lock_table_.erase(lock_data_id);
+        bucket.free_queues_.push_back(queue);
+    }
+}
+
+// 加锁对象所在的桶，Get()的低位在同一张表的相邻记录之间变化很小，先打散再取模
+LockManager::LockBucket& LockManager::bucket_of(const LockDataId& lock_data_id) {
+    uint64_t h = static_cast<uint64_t>(lock_data_id.Get()) * 0x9e3779b97f4a7c15ULL;
+    return buckets_[(h >> 32) % buckets_.size()];
+}
+
+LockManager::GroupLockMode LockManager::to_group_mode(LockMode lock_mode) {
+    switch (lock_mode) {
+        case LockMode::SHARED: return GroupLockMode::S;
+        case LockMode::EXLUCSIVE: return GroupLockMode::X;
+        case LockMode::INTENTION_SHARED: return GroupLockMode::IS;
+        case LockMode::INTENTION_EXCLUSIVE: return GroupLockMode::IX;
+        default: return GroupLockMode::SIX;
+    }
+}
+
+LockManager::LockMode LockManager::to_lock_mode(GroupLockMode group_mode) {
+    switch (group_mode) {
+        case GroupLockMode::S: return LockMode::SHARED;
+        case GroupLockMode::X: return LockMode::EXLUCSIVE;
+        case GroupLockMode::IS: return LockMode::INTENTION_SHARED;
+        case GroupLockMode::IX: return LockMode::INTENTION_EXCLUSIVE;
+        default: return LockMode::S_IX;
+    }
+}
+
+// 同时持有两种锁相当于持有的锁类型，例如S和IX组合为SIX
+LockManager::GroupLockMode LockManager::combine(GroupLockMode a, GroupLockMode b) {
+    if (a == b || b == GroupLockMode::NON_LOCK) {
+        return a;
+    }
+    if (a == GroupLockMode::NON_LOCK) {
+        return b;
+    }
+    if (a == GroupLockMode::X || b == GroupLockMode::X) {
+        return GroupLockMode::X;
+    }
+    if (a == GroupLockMode::IS) {
+        return b;
+    }
+    if (b == GroupLockMode::IS) {
+        return a;
+    }
+    // IX、S、SIX中两个不同的锁组合为SIX
+    return GroupLockMode::SIX;
+}
+
+// 多粒度锁的相容矩阵，held为其他事务持有的一个锁或几个锁的组合
+bool LockManager::compatible(GroupLockMode held, GroupLockMode requested) {
+    switch (held) {
+        case GroupLockMode::NON_LOCK: return true;
+        case GroupLockMode::IS: return requested != GroupLockMode::X;
+        case GroupLockMode::IX: return requested == GroupLockMode::IS || requested == GroupLockMode::IX;
+        case GroupLockMode::S: return requested == GroupLockMode::IS || requested == GroupLockMode::S;
+        case GroupLockMode::SIX: return requested == GroupLockMode::IS;
+        default: return false;
+    }
+}
@@ -1,11 +1,25 @@
 #pragma once
 
+#include <deque>
+#include <list>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
 #include "transaction/transaction.h"
 
 static const std::string GroupLockModeStr[10] = {"NON_LOCK", "IS", "IX", "S", "X", "SIX"};
 
+/*
+LockManager实现多粒度的两阶段锁，冲突的申请在加锁队列的条件变量上等待。等待中的申请按先后顺序排队，
+后来的申请也要与排在前面的申请相容，老事务不会被源源不断的年轻事务饿死；已持有锁的事务升级时只需与其他事务已持有的锁相容
+死锁的处理有两种策略(见DeadlockPolicy)：
+1. WAIT_DIE：申请者比所有冲突的事务都老(开始时间戳更小)才等待，否则立即回滚。等待只会由老事务等待年轻事务，不会形成环
+2. DETECTION：申请者总是等待，后台线程每隔cycle_detection_interval锁住所有桶，由等待者及其冲突的事务构造waits-for图，
+   在每个环中选择最年轻的事务作为牺牲者，唤醒它并使它的加锁申请抛出异常
+锁表按加锁对象的hash值分为LOCK_TABLE_BUCKETS个桶，每个桶有自己的latch和加锁队列，
+不同的加锁对象大多落在不同的桶中，加锁时只锁住一个桶。加锁队列从桶内的对象池中分配，队列为空时归还
+事务在一张表上的行级锁超过LOCK_ESCALATION_THRESHOLD时升级为一个表级锁(见escalate())，大批量的UPDATE/DELETE只占用有限的锁
+*/
 class LockManager {
     /* 加锁类型，包括共享锁、排他锁、意向共享锁、意向排他锁、SIX（意向排他锁+共享锁） */
     enum class LockMode { SHARED, EXLUCSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, S_IX };
@@ -16,26 +30,38 @@ class LockManager {
     /* 事务的加锁申请 */
     class LockRequest {
     public:
-        LockRequest(txn_id_t txn_id, LockMode lock_mode)
-            : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+        LockRequest(txn_id_t txn_id, timestamp_t start_ts, LockMode lock_mode)
+            : txn_id_(txn_id), start_ts_(start_ts), lock_mode_(lock_mode), granted_(false) {}
 
         txn_id_t txn_id_;   // 申请加锁的事务ID
+        timestamp_t start_ts_;  // 申请加锁的事务的开始时间戳，用于wait-die
         LockMode lock_mode_;    // 事务申请加锁的类型
         bool granted_;          // 该事务是否已经被赋予锁
+        GroupLockMode wait_mode_ = GroupLockMode::NON_LOCK;    // 正在等待的锁类型，升级时为升级后的类型，不在等待时为NON_LOCK
+        bool victim_ = false;   // 被死锁检测选为牺牲者，被唤醒后回滚
     };
 
     /* 数据项上的加锁队列 */
     class LockRequestQueue {
     public:
         std::list<LockRequest> request_queue_;  // 加锁队列
-        std::condition_variable cv_;            // 条件变量，用于唤醒正在等待加锁的申请，在no-wait策略下无需使用
+        std::condition_variable cv_;            // 条件变量，有锁被释放或降级时唤醒正在等待加锁的申请，与桶的latch配合使用
         GroupLockMode group_lock_mode_ = GroupLockMode::NON_LOCK;   // 加锁队列的锁模式
+        int num_waiting_ = 0;                   // 正在cv_上等待的事务数
+    };
+
+    /* 锁表的一个分区，按缓存行对齐，避免相邻桶的latch之间的伪共享 */
+    struct alignas(64) LockBucket {
+        std::mutex latch_;                                              // 保护本桶的所有成员，也是等待加锁时使用的锁
+        std::unordered_map<LockDataId, LockRequestQueue *> lock_table_; // 本桶中加锁对象的加锁队列
+        std::deque<LockRequestQueue> queue_pool_;                       // 本桶分配过的所有加锁队列，地址不变
+        std::vector<LockRequestQueue *> free_queues_;                   // 当前没有被使用的加锁队列
     };
 
 public:
-    LockManager() {}
+    explicit LockManager(DeadlockPolicy policy = DEADLOCK_POLICY);
 
-    ~LockManager() {}
+    ~LockManager();
 
     bool lock_shared_on_record(Transaction* txn, const Rid& rid, int tab_fd);
 
@@ -51,7 +77,42 @@ public:
 
     bool unlock(Transaction* txn, LockDataId lock_data_id);
 
+    size_t detect_deadlocks();
+
 private:
-    std::mutex latch_;      // 用于锁表的并发
-    std::unordered_map<LockDataId, LockRequestQueue> lock_table_;   // 全局锁表
+    bool lock(Transaction* txn, const LockDataId& lock_data_id, LockMode lock_mode);
+
+    bool lock_record(Transaction* txn, const Rid& rid, int tab_fd, LockMode lock_mode);
+
+    void escalate(Transaction* txn, int tab_fd, Transaction::TableRowLocks& row_locks);
+
+    bool release(Transaction* txn, const LockDataId& lock_data_id);
+
+    LockBucket& bucket_of(const LockDataId& lock_data_id);
+
+    static GroupLockMode to_group_mode(LockMode lock_mode);
+
+    static LockMode to_lock_mode(GroupLockMode group_mode);
+
+    static bool must_wait(const LockRequestQueue* queue, const LockRequest* self, GroupLockMode requested,
+                          bool check_waiting, bool* die, std::vector<txn_id_t>* conflicts = nullptr);
+
+    void run_cycle_detection();
+
+    static void queue_changed(LockRequestQueue* queue);
+
+    static void release_if_unused(LockBucket& bucket, const LockDataId& lock_data_id, LockRequestQueue* queue);
+
+    static GroupLockMode combine(GroupLockMode a, GroupLockMode b);
+
+    static bool compatible(GroupLockMode held, GroupLockMode requested);
+
+    std::vector<LockBucket> buckets_;   // 全局锁表，按加锁对象的hash值分区
+    DeadlockPolicy policy_;
+
+    // DETECTION策略下的死锁检测线程
+    std::thread detector_;
+    std::mutex detector_latch_;         // 用于stop_detector_和detector_cv_
+    std::condition_variable detector_cv_;
+    bool stop_detector_ = false;
 };
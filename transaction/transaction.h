@@ -5,24 +5,55 @@
 #include <string>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "txn_defs.h"
+#include "undo_log.h"
 
 class Transaction {
    public:
+    /* 事务在一张表上持有的行级锁，用于锁升级 */
+    struct TableRowLocks {
+        size_t num_locks = 0;       // 持有的行级锁数
+        bool exclusive = false;     // 是否持有过行级排他锁
+        bool escalated = false;     // 是否已经升级为表级锁
+        bool escalated_exclusive = false;   // 升级得到的表级锁是否为排他锁
+    };
+
     explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::SERIALIZABLE)
         : state_(TransactionState::DEFAULT), isolation_level_(isolation_level), txn_id_(txn_id) {
-        write_set_ = std::make_shared<std::deque<WriteRecord *>>();
         lock_set_ = std::make_shared<std::unordered_set<LockDataId>>();
         index_latch_page_set_ = std::make_shared<std::deque<Page *>>();
-        index_deleted_page_set_ = std::make_shared<std::deque<Page*>>();
+        index_deleted_page_set_ = std::make_shared<std::deque<page_id_t>>();
         prev_lsn_ = INVALID_LSN;
+        start_ts_ = txn_id;     // 由TransactionManager::begin()分配，未经begin()的事务以事务ID作为时间戳
         thread_id_ = std::this_thread::get_id();
     }
 
     ~Transaction() = default;
 
+    /**
+     * @description: 把已经结束的事务对象重置为一个新开始的事务，供TransactionManager复用事务对象，
+     *               各集合只清空内容，保留已分配的内存
+     * @param {txn_id_t} txn_id 新事务的ID
+     * @param {IsolationLevel} isolation_level 新事务的隔离级别
+     */
+    void reset(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::SERIALIZABLE) {
+        txn_mode_ = false;
+        state_ = TransactionState::DEFAULT;
+        isolation_level_ = isolation_level;
+        txn_id_ = txn_id;
+        start_ts_ = txn_id;
+        prev_lsn_ = INVALID_LSN;
+        thread_id_ = std::this_thread::get_id();
+        undo_log_.clear();
+        lock_set_->clear();
+        table_row_locks_.clear();
+        index_latch_page_set_->clear();
+        index_deleted_page_set_->clear();
+    }
+
     inline txn_id_t get_transaction_id() { return txn_id_; }
 
     inline std::thread::id get_thread_id() { return thread_id_; }
@@ -41,19 +72,20 @@ class Transaction {
     inline lsn_t get_prev_lsn() { return prev_lsn_; }
     inline void set_prev_lsn(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
-    inline std::shared_ptr<std::deque<WriteRecord *>> get_write_set() { return write_set_; }  
-    inline void append_write_record(WriteRecord* write_record) { write_set_->push_back(write_record); }
+    inline UndoLog &get_undo_log() { return undo_log_; }
 
-    inline std::shared_ptr<std::deque<Page*>> get_index_deleted_page_set() { return index_deleted_page_set_; }
-    inline void append_index_deleted_page(Page* page) { index_deleted_page_set_->push_back(page); }
+    inline std::shared_ptr<std::deque<page_id_t>> get_index_deleted_page_set() { return index_deleted_page_set_; }
+    inline void append_index_deleted_page(page_id_t page_no) { index_deleted_page_set_->push_back(page_no); }
 
     inline std::shared_ptr<std::deque<Page*>> get_index_latch_page_set() { return index_latch_page_set_; }
     inline void append_index_latch_page_set(Page* page) { index_latch_page_set_->push_back(page); }
 
     inline std::shared_ptr<std::unordered_set<LockDataId>> get_lock_set() { return lock_set_; }
 
+    inline std::unordered_map<int, TableRowLocks> &get_table_row_locks() { return table_row_locks_; }
+
    private:
-    bool txn_mode_;                   // 用于标识当前事务为显式事务还是单条SQL语句的隐式事务
+    bool txn_mode_ = false;           // 用于标识当前事务为显式事务还是单条SQL语句的隐式事务
     TransactionState state_;          // 事务状态
     IsolationLevel isolation_level_;  // 事务的隔离级别，默认隔离级别为可串行化
     std::thread::id thread_id_;       // 当前事务对应的线程id
@@ -61,8 +93,9 @@ class Transaction {
     txn_id_t txn_id_;                 // 事务的ID，唯一标识符
     timestamp_t start_ts_;            // 事务的开始时间戳
 
-    std::shared_ptr<std::deque<WriteRecord *>> write_set_;  // 事务包含的所有写操作
+    UndoLog undo_log_;                                          // 事务包含的所有写操作，用于回滚
     std::shared_ptr<std::unordered_set<LockDataId>> lock_set_;  // 事务申请的所有锁
+    std::unordered_map<int, TableRowLocks> table_row_locks_;    // 每张表(fd)上持有的行级锁
     std::shared_ptr<std::deque<Page*>> index_latch_page_set_;          // 维护事务执行过程中加锁的索引页面
-    std::shared_ptr<std::deque<Page*>> index_deleted_page_set_;    // 维护事务执行过程中删除的索引页面
+    std::shared_ptr<std::deque<page_id_t>> index_deleted_page_set_;    // 维护事务执行过程中删除的索引页面，释放锁之后放入空闲页链表
 };
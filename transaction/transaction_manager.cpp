@@ -1,8 +1,22 @@
 #include "transaction_manager.h"
+
+#include <algorithm>
+
 #include "record/rm_file_handle.h"
 #include "system/sm_manager.h"
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
+TransactionManager::~TransactionManager() {
+    for (auto &shard : shards_) {
+        for (auto &[txn_id, entry] : shard.txns) {
+            if (entry.pooled) {
+                delete entry.txn;
+            }
+        }
+        for (auto &node : shard.free_nodes) {
+            delete node.mapped().txn;
+        }
+    }
+}
 
 /**
  * @description: 事务的开始方法
@@ -16,13 +30,55 @@ Transaction * TransactionManager::begin(Transaction* txn, LogManager* log_manage
     // 2. 如果为空指针，创建新事务
     // 3. 把开始事务加入到全局事务表中
     // 4. 返回当前事务指针
-    if (!txn)
+    // 事务ID原子地分配，之后只锁新事务所在的分片；对象池中有空闲的事务对象时直接复用
+    bool pooled = txn == nullptr;
+    txn_id_t txn_id = pooled ? next_txn_id_.fetch_add(1) : txn->get_transaction_id();
+    TxnShard &shard = get_shard(txn_id);
+    {
+        std::scoped_lock lock{shard.latch};
+        if (!pooled) {
+            shard.txns[txn_id] = TxnEntry{txn, false};
+        } else if (!shard.free_nodes.empty()) {
+            TxnMap::node_type node = std::move(shard.free_nodes.back());
+            shard.free_nodes.pop_back();
+            node.key() = txn_id;
+            txn = node.mapped().txn;
+            txn->reset(txn_id, IsolationLevel::SERIALIZABLE);
+            shard.txns.insert(std::move(node));
+        } else {
+            txn = new Transaction(txn_id, IsolationLevel::SERIALIZABLE);
+            shard.txns.emplace(txn_id, TxnEntry{txn, true});
+        }
+    }
+    // 时间戳越小的事务越老，wait-die据此决定冲突时等待还是回滚；开始时间戳同时是事务读取的快照的读时间戳
     {
-        Transaction *txn = new Transaction(next_txn_id_, IsolationLevel::SERIALIZABLE);
-        next_txn_id_ += 1;
-        txn->set_state(TransactionState::DEFAULT);
+        std::scoped_lock lock{commit_latch_};
+        txn->set_start_ts(next_timestamp_++);
+        if (version_store_ != nullptr) {
+            version_store_->open_snapshot(txn->get_start_ts());
+        }
+    }
+    return txn;
+}
+
+/**
+ * @description: 把已经提交或回滚的事务移出事务表。由begin()创建的事务对象放回所在分片的对象池，供之后的begin()复用，
+ *               对象池已满时释放；调用者传给begin()的事务对象仍由调用者负责释放。release()之后不能再访问txn
+ * @param {Transaction*} txn 已经结束的事务
+ */
+void TransactionManager::release(Transaction* txn) {
+    txn_id_t txn_id = txn->get_transaction_id();
+    TxnShard &shard = get_shard(txn_id);
+    std::scoped_lock lock{shard.latch};
+    TxnMap::node_type node = shard.txns.extract(txn_id);
+    if (node.empty() || !node.mapped().pooled) {
+        return;
+    }
+    if (shard.free_nodes.size() < TXN_POOL_SHARD_CAPACITY) {
+        shard.free_nodes.push_back(std::move(node));
+    } else {
+        delete node.mapped().txn;
     }
-    txn_map[txn->get_transaction_id()] = txn; 
 }
 
 /**
@@ -37,14 +93,20 @@ void TransactionManager::commit(Transaction* txn, LogManager* log_manager) {
     // 3. 释放事务相关资源，eg.锁集
     // 4. 把事务日志刷入磁盘中
     // 5. 更新事务状态
-    auto wset = txn->get_write_set();
-    while (!wset->empty()) 
-        wset->pop_back();
+    // 写过日志的事务等待commit记录持久化，flusher线程把并发提交的事务合并到一次fsync中
+    if (log_manager != nullptr && enable_logging && txn->get_prev_lsn() != INVALID_LSN) {
+        CommitLogRecord commit_record(txn->get_transaction_id());
+        log_manager->wait_for_persist(log_manager->append_txn_log(txn, &commit_record));
+    }
+
+    end_snapshot(txn);
+    txn->get_undo_log().clear();
 
     auto lset = txn->get_lock_set();
     for (auto i = lset->begin(); i != lset->end(); i++) // 2
         lock_manager_->unlock(txn, *i);
     lset->clear();
+    txn->get_table_row_locks().clear();
 
     txn->set_state(TransactionState::COMMITTED); 
 }
@@ -61,23 +123,63 @@ void TransactionManager::abort(Transaction * txn, LogManager *log_manager) {
     // 3. 清空事务相关资源，eg.锁集
     // 4. 把事务日志刷入磁盘中
     // 5. 更新事务状态
-    auto wset = txn->get_write_set();
-    while (!wset->empty())
-    { // 1
-        Context *ctx = new Context(lock_manager_, log_manager, txn);
-        if (wset->back()->GetWriteType() == WType::INSERT_TUPLE)
-            sm_manager_->rollback_insert(wset->back()->GetTableName(), wset->back()->GetRid(), ctx);
-        else if (wset->back()->GetWriteType() == WType::DELETE_TUPLE)
-            sm_manager_->rollback_delete(wset->back()->GetTableName(), wset->back()->GetRecord(), ctx);
-        else if (wset->back()->GetWriteType() == WType::UPDATE_TUPLE)
-            sm_manager_->rollback_update(wset->back()->GetTableName(), wset->back()->GetRid(), wset->back()->GetRecord(), ctx);
-        wset->pop_back();
+    // 从后向前按undo日志恢复，回滚时的修改同样登记到undo日志的末尾，只用于结束时标记版本
+    UndoLog &undo_log = txn->get_undo_log();
+    Context ctx(lock_manager_, log_manager, txn);
+    ctx.version_store_ = version_store_;
+    undo_log.for_each_reverse(undo_log.end(), [&](const UndoRecord &undo) { // 1
+        if (undo.type == WType::INSERT_TUPLE)
+            sm_manager_->rollback_insert(undo, &ctx);
+        else if (undo.type == WType::DELETE_TUPLE)
+            sm_manager_->rollback_delete(undo, &ctx);
+        else if (undo.type == WType::UPDATE_TUPLE)
+            sm_manager_->rollback_update(undo, &ctx);
+    });
+
+    if (log_manager != nullptr && enable_logging && txn->get_prev_lsn() != INVALID_LSN) {
+        AbortLogRecord abort_record(txn->get_transaction_id());
+        log_manager->append_txn_log(txn, &abort_record);
     }
 
+    end_snapshot(txn);
+    txn->get_undo_log().clear();
+
     auto lset = txn->get_lock_set();
     for (auto i = lset->begin(); i != lset->end(); i++) 
         lock_manager_->unlock(txn, *i);
     lset->clear();
+    txn->get_table_row_locks().clear();
 
     txn->set_state(TransactionState::ABORTED); 
+}
+
+/**
+ * @description: 为事务写入的旧版本分配提交时间戳，并注销事务的快照。开启结果缓存时，
+ *               同时在事务修改过的表上记录结束的时间戳，使缓存的结果失效
+ * @param {Transaction*} txn 结束的事务
+ */
+void TransactionManager::end_snapshot(Transaction* txn) {
+    bool mark_tables = ENABLE_RESULT_CACHE && sm_manager_ != nullptr && !txn->get_undo_log().empty();
+    if (version_store_ == nullptr && !mark_tables) {
+        return;
+    }
+    std::vector<int> tables;
+    if (mark_tables) {
+        UndoLog &undo_log = txn->get_undo_log();
+        undo_log.for_each_reverse(undo_log.end(), [&](const UndoRecord &undo) {
+            if (std::find(tables.begin(), tables.end(), undo.table_id) == tables.end()) {
+                tables.push_back(undo.table_id);
+            }
+        });
+    }
+    std::scoped_lock lock{commit_latch_};
+    timestamp_t commit_ts = next_timestamp_++;
+    if (version_store_ != nullptr) {
+        version_store_->seal(txn, commit_ts);
+        version_store_->close_snapshot(txn->get_start_ts());
+    }
+    // 在分配时间戳的latch内标记，之后开始的事务读取表的版本时一定能看到本事务的修改
+    for (int table_id : tables) {
+        sm_manager_->mark_table_committed(table_id, commit_ts);
+    }
 }
\ No newline at end of file
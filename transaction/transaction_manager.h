@@ -1,11 +1,15 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "transaction.h"
 #include "recovery/log_manager.h"
 #include "concurrency/lock_manager.h"
+#include "version_store.h"
 #include "system/sm_manager.h"
 
 /* 系统采用的并发控制算法，当前题目中要求两阶段封锁并发控制算法 */
@@ -13,17 +17,27 @@ enum class ConcurrencyMode { TWO_PHASE_LOCKING = 0, BASIC_TO };
 
 class TransactionManager{
 public:
+    /**
+     * @param {VersionStore*} version_store 快照读使用的版本存储，为空时不维护快照
+     */
     explicit TransactionManager(LockManager *lock_manager, SmManager *sm_manager,
-                             ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING) {
+                             ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING,
+                             VersionStore *version_store = nullptr) {
         sm_manager_ = sm_manager;
         lock_manager_ = lock_manager;
         concurrency_mode_ = concurrency_mode;
+        version_store_ = version_store;
+        for (auto &shard : shards_) {
+            shard.free_nodes.reserve(TXN_POOL_SHARD_CAPACITY);
+        }
     }
     
-    ~TransactionManager() = default;
+    ~TransactionManager();
 
     Transaction* begin(Transaction* txn, LogManager* log_manager);
 
+    void release(Transaction* txn);
+
     void commit(Transaction* txn, LogManager* log_manager);
 
     void abort(Transaction* txn, LogManager* log_manager);
@@ -35,30 +49,68 @@ public:
     LockManager* get_lock_manager() { return lock_manager_; }
 
     /**
-     * @description: 获取事务ID为txn_id的事务对象
-     * @return {Transaction*} 事务对象的指针
+     * @description: 设置下一个分配的事务ID，重启时在开始接受连接之前由恢复设置
+     */
+    void set_next_txn_id(txn_id_t next_txn_id) { next_txn_id_ = next_txn_id; }
+
+    VersionStore* get_version_store() { return version_store_; }
+
+    /**
+     * @description: 获取事务ID为txn_id的事务对象，只锁事务ID所在的分片
+     * @return {Transaction*} 事务对象的指针，事务不存在或已经release()时返回空指针
      * @param {txn_id_t} txn_id 事务ID
      */    
     Transaction* get_transaction(txn_id_t txn_id) {
         if(txn_id == INVALID_TXN_ID) return nullptr;
-        
-        std::unique_lock<std::mutex> lock(latch_);
-        assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-        auto *res = TransactionManager::txn_map[txn_id];
-        lock.unlock();
-        assert(res != nullptr);
-        assert(res->get_thread_id() == std::this_thread::get_id());
-
-        return res;
+
+        TxnShard &shard = get_shard(txn_id);
+        std::scoped_lock lock{shard.latch};
+        auto iter = shard.txns.find(txn_id);
+        return iter == shard.txns.end() ? nullptr : iter->second.txn;
     }
 
-    static std::unordered_map<txn_id_t, Transaction *> txn_map;     // 全局事务表，存放事务ID与事务对象的映射关系
+    /**
+     * @description: 事务表中的事务个数，包括已经结束但还没有release()的事务
+     */
+    size_t get_num_txns() {
+        size_t num_txns = 0;
+        for (auto &shard : shards_) {
+            std::scoped_lock lock{shard.latch};
+            num_txns += shard.txns.size();
+        }
+        return num_txns;
+    }
 
 private:
+    /* 事务表中的一项，pooled表示事务对象由begin()创建、归事务管理器所有，release()后放回对象池 */
+    struct TxnEntry {
+        Transaction *txn;
+        bool pooled;
+    };
+    using TxnMap = std::unordered_map<txn_id_t, TxnEntry>;
+
+    /**
+     * 事务表的一个分片，事务按ID取模分散到各分片，每个分片有自己的锁，客户端线程并发地开始、查找和释放事务时
+     * 只在同一分片上竞争。分片按缓存行对齐，避免相邻分片的锁互相干扰。
+     * 结束的事务连同它在txns中的结点一起extract()到free_nodes，begin()时改写结点的键后重新插入，
+     * 复用事务对象和结点，每条语句的隐式事务不需要分配内存
+     */
+    struct alignas(64) TxnShard {
+        std::mutex latch;
+        TxnMap txns;                                // 事务ID到事务对象的映射
+        std::vector<TxnMap::node_type> free_nodes;  // 可复用的事务对象，最多TXN_POOL_SHARD_CAPACITY个
+    };
+
+    TxnShard &get_shard(txn_id_t txn_id) { return shards_[static_cast<uint32_t>(txn_id) % TXN_TABLE_SHARDS]; }
+
+    void end_snapshot(Transaction* txn);
+
     ConcurrencyMode concurrency_mode_;      // 事务使用的并发控制算法，目前只需要考虑2PL
     std::atomic<txn_id_t> next_txn_id_{0};  // 用于分发事务ID
     std::atomic<timestamp_t> next_timestamp_{0};    // 用于分发事务时间戳
-    std::mutex latch_;  // 用于txn_map的并发
+    std::array<TxnShard, TXN_TABLE_SHARDS> shards_; // 全局事务表，存放事务ID与事务对象的映射关系
+    std::mutex commit_latch_;   // 分配开始和结束时间戳并登记快照，见VersionStore
     SmManager *sm_manager_;
     LockManager *lock_manager_;
+    VersionStore *version_store_;
 };
\ No newline at end of file
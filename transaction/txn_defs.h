@@ -15,46 +15,6 @@ enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, S
 /* 事务写操作类型，包括插入、删除、更新三种操作 */
 enum class WType { INSERT_TUPLE = 0, DELETE_TUPLE, UPDATE_TUPLE};
 
-/**
- * @brief 事务的写操作记录，用于事务的回滚
- * INSERT
- * --------------------------------
- * | wtype | tab_name | tuple_rid |
- * --------------------------------
- * DELETE / UPDATE
- * ----------------------------------------------
- * | wtype | tab_name | tuple_rid | tuple_value |
- * ----------------------------------------------
- */
-class WriteRecord {
-   public:
-    WriteRecord() = default;
-
-    // constructor for insert operation
-    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid)
-        : wtype_(wtype), tab_name_(tab_name), rid_(rid) {}
-
-    // constructor for delete & update operation
-    WriteRecord(WType wtype, const std::string &tab_name, const Rid &rid, const RmRecord &record)
-        : wtype_(wtype), tab_name_(tab_name), rid_(rid), record_(record) {}
-
-    ~WriteRecord() = default;
-
-    inline RmRecord &GetRecord() { return record_; }
-
-    inline Rid &GetRid() { return rid_; }
-
-    inline WType &GetWriteType() { return wtype_; }
-
-    inline std::string &GetTableName() { return tab_name_; }
-
-   private:
-    WType wtype_;
-    std::string tab_name_;
-    Rid rid_;
-    RmRecord record_;
-};
-
 /* 多粒度锁，加锁对象的类型，包括记录和表 */
 enum class LockDataType { TABLE = 0, RECORD = 1 };
 
@@ -106,6 +66,11 @@ struct std::hash<LockDataId> {
     size_t operator()(const LockDataId &obj) const { return std::hash<int64_t>()(obj.Get()); }
 };
 
+/* 处理锁冲突的策略：WAIT_DIE按开始时间戳预防死锁；DETECTION总是等待，由后台线程检测死锁并回滚环中最年轻的事务 */
+enum class DeadlockPolicy { WAIT_DIE, DETECTION };
+
+static constexpr DeadlockPolicy DEADLOCK_POLICY = DeadlockPolicy::WAIT_DIE;
+
 /* 事务回滚原因 */
 enum class AbortReason { LOCK_ON_SHIRINKING = 0, UPGRADE_CONFLICT, DEADLOCK_PREVENTION };
 
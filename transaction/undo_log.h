@@ -0,0 +1,151 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "txn_defs.h"
+
+/* 事务的一条undo记录，之后紧跟修改前的字节 */
+struct UndoRecord {
+    WType type;
+    int table_id;
+    int fd;
+    Rid rid;
+    int offset;     // 修改前的字节在记录中的偏移
+    int len;        // 修改前的字节数：插入为0，删除为整条记录，更新为修改过的第一个字节到最后一个字节
+    std::atomic<timestamp_t> *commit_ts;    // 同一修改在VersionStore中的旧版本的提交时间戳，不维护版本时为nullptr
+
+    const char *before() const { return reinterpret_cast<const char *>(this + 1); }
+};
+
+/*
+UndoLog是事务的写集合，按修改的顺序追加(表, Rid, 修改前的字节)，回滚时从后向前恢复
+1. 记录顺序写入按UNDO_LOG_CHUNK_SIZE分配的内存块，每条记录末尾保存它的总长度，用于反向遍历。
+   更新只保存修改过的字节区间，不复制整条记录，也不为每条记录单独分配内存
+2. 事务结束后clear()只保留第一个内存块，对象池中复用的事务不需要重新分配
+3. 同一次修改在VersionStore中的旧版本由commit_ts指向，事务结束时VersionStore::seal()遍历undo日志标记提交时间戳，
+   不再单独维护每个事务的版本列表
+4. 只由事务所在的线程访问，不加锁。追加记录不会移动已有的记录，反向遍历的同时可以追加
+*/
+class UndoLog {
+   public:
+    /* 日志中的一个位置，遍历时只访问它之前的记录 */
+    struct Position {
+        size_t chunk = 0;
+        size_t offset = 0;
+    };
+
+    UndoLog() = default;
+
+    UndoLog(const UndoLog &) = delete;
+    UndoLog &operator=(const UndoLog &) = delete;
+
+    /**
+     * @description: 追加一条undo记录
+     * @return {UndoRecord*} 追加的记录
+     * @param {WType} type 写操作类型
+     * @param {int} table_id 表的编号
+     * @param {int} fd 表的数据文件
+     * @param {Rid&} rid 记录的位置
+     * @param {int} offset 修改前的字节在记录中的偏移
+     * @param {char*} before 修改前的字节，插入时为nullptr
+     * @param {int} len 修改前的字节数
+     */
+    UndoRecord *append(WType type, int table_id, int fd, const Rid &rid, int offset, const char *before, int len) {
+        size_t size = (sizeof(UndoRecord) + len + sizeof(uint32_t) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        char *dest = allocate(size);
+        auto *record = new (dest) UndoRecord{type, table_id, fd, rid, offset, len, nullptr};
+        if (len > 0) {
+            memcpy(dest + sizeof(UndoRecord), before, len);
+        }
+        uint32_t tail = static_cast<uint32_t>(size);
+        memcpy(dest + size - sizeof(uint32_t), &tail, sizeof(tail));
+        num_records_++;
+        return record;
+    }
+
+    bool empty() const { return num_records_ == 0; }
+
+    size_t size() const { return num_records_; }
+
+    Position end() const {
+        return chunks_.empty() ? Position{} : Position{chunks_.size() - 1, chunks_.back().used};
+    }
+
+    /**
+     * @description: 从end之前的最后一条记录开始，从后向前对每条记录调用f(record)
+     */
+    template <typename F>
+    void for_each_reverse(Position end, F &&f) const {
+        if (chunks_.empty()) {
+            return;
+        }
+        for (size_t chunk = end.chunk + 1; chunk-- > 0;) {
+            const char *data = chunks_[chunk].data.get();
+            size_t offset = chunk == end.chunk ? end.offset : chunks_[chunk].used;
+            while (offset > 0) {
+                uint32_t size;
+                memcpy(&size, data + offset - sizeof(size), sizeof(size));
+                offset -= size;
+                f(*reinterpret_cast<const UndoRecord *>(data + offset));
+            }
+        }
+    }
+
+    /**
+     * @description: 按写入顺序对每条记录调用f(record)
+     */
+    template <typename F>
+    void for_each(F &&f) const {
+        for (auto &chunk : chunks_) {
+            for (size_t offset = 0; offset < chunk.used;) {
+                auto *record = reinterpret_cast<const UndoRecord *>(chunk.data.get() + offset);
+                f(*record);
+                offset += (sizeof(UndoRecord) + record->len + sizeof(uint32_t) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+            }
+        }
+    }
+
+    /**
+     * @description: 清空日志，保留第一个标准大小的内存块供之后的事务使用
+     */
+    void clear() {
+        if (!chunks_.empty()) {
+            if (chunks_.front().capacity == UNDO_LOG_CHUNK_SIZE) {
+                chunks_.resize(1);
+                chunks_.front().used = 0;
+            } else {
+                chunks_.clear();
+            }
+        }
+        num_records_ = 0;
+    }
+
+   private:
+    static constexpr size_t ALIGNMENT = 8;
+
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        size_t used;
+    };
+
+    char *allocate(size_t size) {
+        if (chunks_.empty() || chunks_.back().capacity - chunks_.back().used < size) {
+            // 超过块大小的记录单独占用一块
+            size_t capacity = std::max(size, UNDO_LOG_CHUNK_SIZE);
+            chunks_.push_back(Chunk{std::make_unique<char[]>(capacity), capacity, 0});
+        }
+        Chunk &chunk = chunks_.back();
+        char *result = chunk.data.get() + chunk.used;
+        chunk.used += size;
+        return result;
+    }
+
+    std::vector<Chunk> chunks_;
+    size_t num_records_ = 0;
+};
@@ -0,0 +1,205 @@
+#include "version_store.h"
+
+#include <cstring>
+
+std::chrono::milliseconds version_gc_interval = std::chrono::milliseconds(100);
+
+bool VersionStore::Table::visible(const Version *version, const Snapshot &snapshot) {
+    if (version->txn_id == snapshot.txn_id) {
+        return true;
+    }
+    timestamp_t commit_ts = version->commit_ts.load(std::memory_order_acquire);
+    return commit_ts != INVALID_TIMESTAMP && commit_ts < snapshot.read_ts;
+}
+
+const char *VersionStore::Table::resolve(const Snapshot &snapshot, const Rid &rid, const char *heap_rec) const {
+    auto it = chains_.find(rid);
+    if (it == chains_.end()) {
+        return heap_rec;
+    }
+    const Version *newer = nullptr;
+    for (const Version *version = it->second.get(); version != nullptr; version = version->older.get()) {
+        if (visible(version, snapshot)) {
+            return newer == nullptr ? heap_rec : newer->before.get();
+        }
+        newer = version;
+    }
+    return newer->before.get();
+}
+
+bool VersionStore::Table::current(const Snapshot &snapshot, const Rid &rid) const {
+    auto it = chains_.find(rid);
+    return it == chains_.end() || visible(it->second.get(), snapshot);
+}
+
+VersionStore::Writer::Writer(VersionStore *store, Transaction *txn, int table_id, int fd, int record_size)
+    : store_(store), txn_(txn), table_id_(table_id), fd_(fd), record_size_(record_size) {
+    if (store_ == nullptr || txn_ == nullptr) {
+        return;
+    }
+    table_ = store_->get_table(fd);
+    lock_ = std::unique_lock<std::shared_mutex>(table_->latch());
+    table_->record_size_ = record_size;
+}
+
+void VersionStore::Writer::update(const Rid &rid, const char *before, const char *after) {
+    int first = 0;
+    while (first < record_size_ && before[first] == after[first]) {
+        first++;
+    }
+    if (first == record_size_) {
+        return;
+    }
+    int last = record_size_;
+    while (before[last - 1] == after[last - 1]) {
+        last--;
+    }
+    add(rid, WType::UPDATE_TUPLE, before, first, before + first, last - first);
+}
+
+void VersionStore::Writer::add(const Rid &rid, WType type, const char *before, int undo_offset,
+                               const char *undo_bytes, int undo_len) {
+    if (txn_ == nullptr) {
+        return;
+    }
+    UndoRecord *undo = txn_->get_undo_log().append(type, table_id_, fd_, rid, undo_offset, undo_bytes, undo_len);
+    if (table_ == nullptr) {
+        return;
+    }
+    auto version = std::make_unique<Version>();
+    version->txn_id = txn_->get_transaction_id();
+    version->type = type;
+    if (before != nullptr) {
+        version->before = std::make_unique<char[]>(record_size_);
+        memcpy(version->before.get(), before, record_size_);
+    }
+    undo->commit_ts = &version->commit_ts;
+    auto &head = table_->chains_[rid];
+    version->older = std::move(head);
+    head = std::move(version);
+}
+
+VersionStore::VersionStore(bool run_gc) {
+    if (run_gc) {
+        gc_thread_ = std::thread(&VersionStore::run_gc, this);
+    }
+}
+
+VersionStore::~VersionStore() {
+    {
+        std::scoped_lock lock{gc_latch_};
+        stop_gc_ = true;
+    }
+    gc_cv_.notify_all();
+    if (gc_thread_.joinable()) {
+        gc_thread_.join();
+    }
+}
+
+VersionStore::Table *VersionStore::get_table(int fd) {
+    std::scoped_lock lock{tables_latch_};
+    auto &table = tables_[fd];
+    if (table == nullptr) {
+        table = std::make_unique<Table>();
+    }
+    return table.get();
+}
+
+bool VersionStore::has_versions(int fd) {
+    Table *table = get_table(fd);
+    std::shared_lock<std::shared_mutex> lock(table->latch());
+    return !table->empty();
+}
+
+void VersionStore::open_snapshot(timestamp_t read_ts) {
+    std::scoped_lock lock{txns_latch_};
+    snapshots_.insert(read_ts);
+    last_ts_ = std::max(last_ts_, read_ts);
+}
+
+void VersionStore::close_snapshot(timestamp_t read_ts) {
+    std::scoped_lock lock{txns_latch_};
+    auto it = snapshots_.find(read_ts);
+    if (it != snapshots_.end()) {
+        snapshots_.erase(it);
+    }
+}
+
+void VersionStore::seal(Transaction *txn, timestamp_t commit_ts) {
+    {
+        std::scoped_lock lock{txns_latch_};
+        last_ts_ = std::max(last_ts_, commit_ts);
+    }
+    // 尚未标记的版本不会被回收，标记之后不再访问该版本
+    txn->get_undo_log().for_each([commit_ts](const UndoRecord &undo) {
+        if (undo.commit_ts != nullptr) {
+            undo.commit_ts->store(commit_ts, std::memory_order_release);
+        }
+    });
+}
+
+// 截断head开始的链，返回回收的版本数。被截断的部分中有尚未结束的事务的版本时不截断
+size_t VersionStore::truncate(std::unique_ptr<Version> &head, timestamp_t watermark) {
+    std::unique_ptr<Version> *link = &head;
+    while (*link != nullptr) {
+        timestamp_t commit_ts = (*link)->commit_ts.load(std::memory_order_acquire);
+        if (commit_ts != INVALID_TIMESTAMP && commit_ts < watermark) {
+            break;
+        }
+        link = &(*link)->older;
+    }
+    size_t count = 0;
+    for (const Version *version = link->get(); version != nullptr; version = version->older.get()) {
+        if (version->commit_ts.load(std::memory_order_acquire) == INVALID_TIMESTAMP) {
+            return 0;
+        }
+        count++;
+    }
+    link->reset();
+    return count;
+}
+
+size_t VersionStore::collect_garbage() {
+    timestamp_t watermark;
+    {
+        std::scoped_lock lock{txns_latch_};
+        watermark = snapshots_.empty() ? last_ts_ + 1 : *snapshots_.begin();
+    }
+    std::vector<Table *> tables;
+    {
+        std::scoped_lock lock{tables_latch_};
+        for (auto &entry : tables_) {
+            tables.push_back(entry.second.get());
+        }
+    }
+    size_t count = 0;
+    for (Table *table : tables) {
+        {
+            std::shared_lock<std::shared_mutex> lock(table->latch());
+            if (table->empty()) {
+                continue;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(table->latch());
+        for (auto it = table->chains_.begin(); it != table->chains_.end();) {
+            count += truncate(it->second, watermark);
+            if (it->second == nullptr) {
+                it = table->chains_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return count;
+}
+
+// 回收线程，每隔version_gc_interval回收一次
+void VersionStore::run_gc() {
+    std::unique_lock<std::mutex> lock{gc_latch_};
+    while (!stop_gc_) {
+        gc_cv_.wait_for(lock, version_gc_interval, [this] { return stop_gc_; });
+        lock.unlock();
+        collect_garbage();
+        lock.lock();
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "transaction.h"
+
+/*
+VersionStore保存记录的旧版本，SELECT读取事务开始时的快照，不加锁，也不会读到未提交的修改(MVCC)
+1. 每张表(fd)按Rid维护一条版本链，从新到旧，每个版本记录写入的事务、写操作类型、写之前的记录(before-image，插入时没有)
+   和事务结束时分配的提交时间戳。堆表中始终是最新的记录
+2. 读时间戳为S的快照沿链找到第一个对它可见的版本(提交时间戳小于S，或由快照所属的事务自己写入)，该版本之后的记录就是快照看到的记录：
+   第一个版本可见时为堆表中的记录，否则为前一个(更新的)版本的before-image；没有可见的版本时为最旧版本的before-image
+3. 写入者修改堆表并登记版本时持有表的排他latch，读者每读一批记录持有共享latch。latch只保护内存中的结构，不会等待其他事务结束
+4. 开始和结束事务都在TransactionManager的commit latch下分配时间戳，提交时间戳小于S的事务在S分配之前已经标记了它的所有版本。
+   回滚按undo日志恢复堆表，每次恢复像普通的修改一样登记一个版本，回滚的事务同样在结束时标记版本，
+   之后开始的快照看到恢复后的记录，正在进行的快照不受影响
+5. 后台线程每隔version_gc_interval回收旧版本：活跃快照的读时间戳都不小于watermark，链上第一个在watermark之前提交的版本对所有快照可见，
+   它和更旧的版本不再需要；它就是链上第一个版本时删除整条链
+*/
+class VersionStore {
+   public:
+    /* 快照：读时间戳之前提交的事务的修改，以及所属事务自己的修改 */
+    struct Snapshot {
+        txn_id_t txn_id;
+        timestamp_t read_ts;
+    };
+
+    /* 一条记录的一个旧版本 */
+    struct Version {
+        txn_id_t txn_id;                    // 写入该版本的事务
+        WType type;
+        std::atomic<timestamp_t> commit_ts{INVALID_TIMESTAMP};  // 事务结束时分配，之前为INVALID_TIMESTAMP
+        std::unique_ptr<char[]> before;     // 写之前的记录，插入时为空
+        std::unique_ptr<Version> older;     // 链上更旧的版本
+    };
+
+    struct RidLess {
+        bool operator()(const Rid &a, const Rid &b) const {
+            return a.page_no != b.page_no ? a.page_no < b.page_no : a.slot_no < b.slot_no;
+        }
+    };
+
+    /* 一张表的所有版本链，除latch()外的函数都要求调用者持有latch */
+    class Table {
+       public:
+        std::shared_mutex &latch() { return latch_; }
+
+        bool empty() const { return chains_.empty(); }
+
+        /**
+         * @description: 快照看到的rid处的记录
+         * @return {const char*} 记录的数据，快照中不存在该记录时为nullptr
+         * @param {Snapshot&} snapshot 读取的快照
+         * @param {Rid&} rid 记录的位置
+         * @param {char*} heap_rec 堆表中rid处的记录，rid处没有记录时为nullptr
+         */
+        const char *resolve(const Snapshot &snapshot, const Rid &rid, const char *heap_rec) const;
+
+        /**
+         * @description: 快照看到的rid处的记录是否就是堆表中的记录：rid没有版本链，或链上最新的版本对快照可见
+         */
+        bool current(const Snapshot &snapshot, const Rid &rid) const;
+
+        /**
+         * @description: 对快照看到的记录不是堆表中当前记录的每个rid调用f(rid, data)，data为快照看到的记录，
+         *               快照中不存在该记录(快照之后插入)时为nullptr
+         */
+        template <typename F>
+        void for_each_changed(const Snapshot &snapshot, F &&f) const {
+            for (auto &[rid, head] : chains_) {
+                if (!visible(head.get(), snapshot)) {
+                    f(rid, resolve(snapshot, rid, nullptr));
+                }
+            }
+        }
+
+        /**
+         * @description: 对[first_page, end_page)中已从堆表删除、但在快照中仍然存在的记录调用f(rid, data)
+         */
+        template <typename F>
+        void for_each_deleted(const Snapshot &snapshot, int first_page, int end_page, F &&f) const {
+            auto it = chains_.lower_bound(Rid{first_page, 0});
+            for (; it != chains_.end() && it->first.page_no < end_page; ++it) {
+                if (it->second->type != WType::DELETE_TUPLE) {
+                    continue;
+                }
+                const char *data = resolve(snapshot, it->first, nullptr);
+                if (data != nullptr) {
+                    f(it->first, data);
+                }
+            }
+        }
+
+       private:
+        friend class VersionStore;
+
+        static bool visible(const Version *version, const Snapshot &snapshot);
+
+        std::shared_mutex latch_;
+        std::map<Rid, std::unique_ptr<Version>, RidLess> chains_;
+        int record_size_ = 0;
+    };
+
+    /**
+     * 写入者修改一张表时在栈上构造，构造时锁住表的排他latch，析构时释放。每次修改登记到事务的undo日志中，
+     * store不为空时同时登记旧版本，undo记录指向旧版本的提交时间戳。txn为空时不登记
+     */
+    class Writer {
+       public:
+        Writer(VersionStore *store, Transaction *txn, int table_id, int fd, int record_size);
+
+        // 修改堆表之前登记，before和after为修改前后的记录，undo日志只保存修改过的字节
+        void update(const Rid &rid, const char *before, const char *after);
+
+        // 从堆表删除之前登记，before为被删除的记录
+        void remove(const Rid &rid, const char *before) { add(rid, WType::DELETE_TUPLE, before, 0, before, record_size_); }
+
+        // 插入堆表之后登记
+        void insert(const Rid &rid) { add(rid, WType::INSERT_TUPLE, nullptr, 0, nullptr, 0); }
+
+       private:
+        void add(const Rid &rid, WType type, const char *before, int undo_offset, const char *undo_bytes, int undo_len);
+
+        VersionStore *store_;
+        Transaction *txn_;
+        int table_id_;
+        int fd_;
+        int record_size_;
+        Table *table_ = nullptr;
+        std::unique_lock<std::shared_mutex> lock_;
+    };
+
+    /**
+     * @param {bool} run_gc 是否启动后台回收线程
+     */
+    explicit VersionStore(bool run_gc = true);
+
+    ~VersionStore();
+
+    /**
+     * @description: 获取fd对应的表的版本链，第一次访问时创建，之后地址不变
+     */
+    Table *get_table(int fd);
+
+    /**
+     * @description: 表上是否有尚未回收的旧版本
+     */
+    bool has_versions(int fd);
+
+    /**
+     * @description: 登记读时间戳为read_ts的快照，在回收时保留它可能读到的版本
+     */
+    void open_snapshot(timestamp_t read_ts);
+
+    void close_snapshot(timestamp_t read_ts);
+
+    /**
+     * @description: 事务结束时为它写入的所有版本标记提交时间戳，版本由事务的undo日志找到，
+     *               调用者保证与open_snapshot()互斥且时间戳递增
+     */
+    void seal(Transaction *txn, timestamp_t commit_ts);
+
+    /**
+     * @description: 回收所有快照都不再需要的旧版本
+     * @return {size_t} 回收的版本数
+     */
+    size_t collect_garbage();
+
+   private:
+    void run_gc();
+
+    static size_t truncate(std::unique_ptr<Version> &head, timestamp_t watermark);
+
+    std::mutex tables_latch_;           // 保护tables_
+    std::unordered_map<int, std::unique_ptr<Table>> tables_;
+
+    std::mutex txns_latch_;             // 保护以下成员
+    std::multiset<timestamp_t> snapshots_;  // 活跃快照的读时间戳
+    timestamp_t last_ts_ = INVALID_TIMESTAMP;   // 已分配的最大时间戳
+
+    // 后台回收线程
+    std::thread gc_thread_;
+    std::mutex gc_latch_;               // 用于stop_gc_和gc_cv_
+    std::condition_variable gc_cv_;
+    bool stop_gc_ = false;
+};
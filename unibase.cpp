@@ -1,20 +1,34 @@
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <readline/readline.h>
+#include <sys/epoll.h>
+#include <strings.h>
 #include <csetjmp>
 #include <csignal>
+#include <ctime>
 #include <unistd.h>
 #include <atomic>
+#include <thread>
 
 #include "errors.h"
 #include "optimizer/optimizer.h"
 #include "recovery/log_recovery.h"
+#include "storage/buffer_pool_warmer.h"
+#include "storage/page_flusher.h"
 #include "optimizer/plan.h"
 #include "optimizer/planner.h"
+#include "optimizer/plan_cache.h"
+#include "optimizer/result_cache.h"
 #include "portal.h"
 #include "analyze/analyze.h"
+#include "common/metrics.h"
+#include "common/trace.h"
+#include "common/thread_pool.h"
+#include "parser/stmt_splitter.h"
 
 #define SOCK_PORT 8765
-#define MAX_CONN_LIMIT 8
+#define LISTEN_BACKLOG SOMAXCONN
+#define MAX_EVENTS 256
 
 static bool should_exit = false;
 
@@ -24,16 +38,28 @@ auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_ma
 auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
 auto sm_manager = std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
 auto lock_manager = std::make_unique<LockManager>();
-auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
+auto version_store = std::make_unique<VersionStore>();
+auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get(),
+                                                        ConcurrencyMode::TWO_PHASE_LOCKING, version_store.get());
 auto ql_manager = std::make_unique<QlManager>(sm_manager.get(), txn_manager.get());
 auto log_manager = std::make_unique<LogManager>(disk_manager.get());
-auto recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get());
+auto recovery = std::make_unique<RecoveryManager>(disk_manager.get(), buffer_pool_manager.get(), sm_manager.get(),
+                                                  log_manager.get());
+auto page_flusher = std::make_unique<PageFlusher>(buffer_pool_manager.get());
+// 表在第一次使用时才打开，预热时打开上次缓冲池中有页面的表
+auto buffer_pool_warmer = std::make_unique<BufferPoolWarmer>(
+    buffer_pool_manager.get(), disk_manager.get(),
+    [](const std::string &file_name) { return sm_manager->open_file_by_name(file_name); });
 auto planner = std::make_unique<Planner>(sm_manager.get());
 auto optimizer = std::make_unique<Optimizer>(sm_manager.get(), planner.get());
 auto portal = std::make_unique<Portal>(sm_manager.get());
 auto analyze = std::make_unique<Analyze>(sm_manager.get());
-pthread_mutex_t *buffer_mutex;
-pthread_mutex_t *sockfd_mutex;
+auto plan_cache = std::make_unique<PlanCache>(sm_manager.get(), analyze.get(), optimizer.get());
+auto result_cache = ENABLE_RESULT_CACHE ? std::make_unique<ResultCache>(sm_manager.get()) : nullptr;
+// production模式下关闭ENABLE_RESULT_LOG，语句的输出不再写入output.txt
+auto result_log = ENABLE_RESULT_LOG ? std::make_unique<ResultLog>(RESULT_LOG_NAME) : nullptr;
+// 超过延迟阈值或被抽样的语句写入slow_query.log，与结果日志一样由后台线程写文件
+auto slow_query_log = ENABLE_SLOW_QUERY_LOG ? std::make_unique<ResultLog>(SLOW_QUERY_LOG_NAME) : nullptr;
 
 static jmp_buf jmpbuf;
 
@@ -55,137 +81,519 @@ void set_transaction(txn_id_t *txn_id, Context *context) {
     }
 }
 
-void *client_handler(void *sock_fd) {
-    int fd = *((int *)sock_fd);
-    pthread_mutex_unlock(sockfd_mutex);
-
-    int i_recvBytes;
-    // 接收客户端发送的请求
-    char data_recv[BUFFER_LENGTH];
-    // 需要返回给客户端的结果
-    char *data_send = new char[BUFFER_LENGTH];
-    // 需要返回给客户端的结果的长度
-    int offset = 0;
+// 一个客户端连接的会话状态。连接以EPOLLONESHOT注册到epoll中，同一时刻只有一个worker处理同一个会话，因此无需加锁
+struct Session {
+    int fd;
     // 记录客户端当前正在执行的事务ID
     txn_id_t txn_id = INVALID_TXN_ID;
+    // 每个连接独占一个可重入的scanner，语句解析无需在连接之间加锁
+    yyscan_t scanner;
+    // 本连接PREPARE的语句
+    PreparedStmts prepared_stmts;
+    // select的结果是否以二进制格式返回，通过SET result_format = {text | binary}选择
+    bool binary_result = false;
+    // 本连接每条语句的内存上限，通过SET query_memory_limit = {MB数 | default}设置，0表示不限制
+    size_t query_memory_limit = QUERY_MEMORY_LIMIT;
+    // 接收客户端发送的请求，保留上一次读取末尾不完整的语句
+    RequestBuffer request{BUFFER_LENGTH - 1};
+    // 需要返回给客户端的结果
+    char data_send[BUFFER_LENGTH];
+    // 已经生成但还没有发送的结果帧，一次请求中各条语句的结果合并后一起发送
+    std::string send_batch;
 
-    std::string output = "establish client connection, sockfd: " + std::to_string(fd) + "\n";
-    std::cout << output;
+    Session(int fd_) : fd(fd_) { yylex_init(&scanner); }
 
-    while (true) {
-        std::cout << "Waiting for request..." << std::endl;
-        memset(data_recv, 0, BUFFER_LENGTH);
+    ~Session() {
+        yylex_destroy(scanner);
+        close(fd);
+    }
+};
+
+/**
+ * @description: 设置连接的选项。result_format决定select的结果以文本表格还是二进制格式返回，
+ *               query_memory_limit设置每条语句的内存上限，单位为MB
+ * @param {Session*} session 当前连接
+ * @param {string&} name 选项名称
+ * @param {string&} value 选项的值
+ */
+void set_session_option(Session *session, const std::string &name, const std::string &value) {
+    if (strcasecmp(name.c_str(), "query_memory_limit") == 0) {
+        if (strcasecmp(value.c_str(), "default") == 0) {
+            session->query_memory_limit = QUERY_MEMORY_LIMIT;
+        } else if (!value.empty() && value.find_first_not_of("0123456789") == std::string::npos) {
+            session->query_memory_limit = std::stoull(value) * 1024 * 1024;
+        } else {
+            throw InvalidSettingError(name, value);
+        }
+        return;
+    }
+    if (strcasecmp(name.c_str(), "result_format") != 0) {
+        throw InvalidSettingError(name, value);
+    }
+    if (strcasecmp(value.c_str(), "text") == 0) {
+        session->binary_result = false;
+    } else if (strcasecmp(value.c_str(), "binary") == 0) {
+        session->binary_result = true;
+    } else {
+        throw InvalidSettingError(name, value);
+    }
+}
 
-        i_recvBytes = read(fd, data_recv, BUFFER_LENGTH);
+/**
+ * @description: 追加一帧结果：4字节网络字节序的长度，后接长度个字节的结果。
+ *               一条语句的结果由若干帧组成，以长度为0的帧结束
+ * @param {string&} frames 会话的发送缓冲或结果缓存保存的结果帧
+ * @param {char*} data 结果
+ * @param {size_t} len 结果的长度
+ */
+void append_frame(std::string &frames, const char *data, size_t len) {
+    uint32_t header = htonl(static_cast<uint32_t>(len));
+    frames.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (len > 0) {
+        frames.append(data, len);
+    }
+}
 
-        if (i_recvBytes == 0) {
-            std::cout << "Maybe the client has closed" << std::endl;
-            break;
+void append_frame(Session *session, const char *data, size_t len) { append_frame(session->send_batch, data, len); }
+
+/**
+ * @description: 把发送缓冲中的结果帧写给客户端。socket发送缓冲区满时阻塞，执行随之暂停
+ * @return {bool} 是否发送成功
+ * @param {Session*} session 当前连接
+ */
+bool flush_frames(Session *session) {
+    const char *data = session->send_batch.data();
+    size_t len = session->send_batch.size();
+    while (len > 0) {
+        ssize_t n = write(session->fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
         }
-        if (i_recvBytes == -1) {
-            std::cout << "Client read error!" << std::endl;
-            break;
+        data += n;
+        len -= n;
+    }
+    session->send_batch.clear();
+    return true;
+}
+
+/**
+ * @description: 语句的延迟达到SLOW_QUERY_THRESHOLD_MS或被抽样时写入慢查询日志，记录结束时间、延迟、
+ *               扫描的记录数、访问的页面、语句文本和计划。计划的描述与EXPLAIN相同，只在写入时生成
+ * @param {string&} sql 语句的文本
+ * @param {shared_ptr<Plan>&} plan 执行的计划，没有生成计划的语句为空
+ * @param {steady_clock::duration} elapsed 从解析开始到执行结束的时间
+ * @param {PageAccessCounter&} counts 语句执行期间访问的页面和记录
+ */
+void log_slow_query(const std::string &sql, const std::shared_ptr<Plan> &plan,
+                    std::chrono::steady_clock::duration elapsed, const PageAccessCounter &counts) {
+    static std::atomic<size_t> num_statements{0};
+    bool sampled = SLOW_QUERY_SAMPLE_EVERY > 0 &&
+                   num_statements.fetch_add(1, std::memory_order_relaxed) % SLOW_QUERY_SAMPLE_EVERY == 0;
+    if (!sampled && elapsed < std::chrono::milliseconds(SLOW_QUERY_THRESHOLD_MS)) {
+        return;
+    }
+    char time_str[32];
+    time_t now = time(nullptr);
+    struct tm tm {};
+    localtime_r(&now, &tm);
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm);
+    char buf[256];
+    snprintf(buf, sizeof(buf), "# Time: %s  Query_time: %.3f ms  Rows_examined: %llu  Pages: %llu  Page_hits: %llu%s\n",
+             time_str, std::chrono::duration<double, std::milli>(elapsed).count(),
+             static_cast<unsigned long long>(counts.rows), static_cast<unsigned long long>(counts.fetches),
+             static_cast<unsigned long long>(counts.hits), sampled ? "  Sampled: yes" : "");
+    std::string entry = buf;
+    entry += sql + "\n";
+    if (plan != nullptr) {
+        for (auto &line : ExplainStats(plan, false).format()) {
+            entry += "  " + line + "\n";
         }
-        
-        printf("i_recvBytes: %d \n ", i_recvBytes);
+    }
+    slow_query_log->append(std::move(entry));
+}
 
-        if (strcmp(data_recv, "exit") == 0) {
-            std::cout << "Client exit." << std::endl;
-            break;
+/**
+ * @description: 执行一条语句，结果帧追加到会话的发送缓冲中
+ * @param {Session*} session 当前连接
+ * @param {string&} sql 语句的文本
+ */
+void execute_statement(Session *session, const std::string &sql) {
+    int fd = session->fd;
+    char *data_send = session->data_send;
+    // 需要返回给客户端的结果的长度
+    int offset = 0;
+
+    if (ENABLE_REQUEST_TRACE) {
+        std::cout << "Read from client " << fd << ": " << sql << std::endl;
+    }
+
+    memset(data_send, '\0', BUFFER_LENGTH);
+    offset = 0;
+
+    // 开启事务，初始化系统所需的上下文信息（包括事务对象指针、锁管理器指针、日志管理器指针、存放结果的buffer、记录结果长度的变量）
+    // Context随每条语句创建，语句结束后释放，其中的语句级内存池一并回收
+    auto context_guard = std::make_unique<Context>(lock_manager.get(), log_manager.get(), nullptr, data_send, &offset);
+    Context *context = context_guard.get();
+    // 可以缓存的select同时把发送的结果帧记入cache_entry，结果太大时放弃
+    std::shared_ptr<CachedResult> cache_entry;
+    // 结果写满缓冲区或一批记录输出完时立即发送给客户端
+    context->send_result_ = [session, context, &cache_entry](const char *data, size_t len) {
+        append_frame(session, data, len);
+        if (cache_entry != nullptr) {
+            append_frame(cache_entry->frames, data, len);
+            if (cache_entry->frames.size() > RESULT_CACHE_MAX_ENTRY_BYTES) {
+                context->captured_log_ = nullptr;
+                cache_entry.reset();
+            }
         }
-        if (strcmp(data_recv, "crash") == 0) {
-            std::cout << "Server crash" << std::endl;
-            exit(1);
+        if (session->send_batch.size() >= BUFFER_LENGTH && !flush_frames(session)) {
+            throw UnixError();
         }
-
-        std::cout << "Read from client " << fd << ": " << data_recv << std::endl;
-
-        memset(data_send, '\0', BUFFER_LENGTH);
-        offset = 0;
-
-        // 开启事务，初始化系统所需的上下文信息（包括事务对象指针、锁管理器指针、日志管理器指针、存放结果的buffer、记录结果长度的变量）
-        Context *context = new Context(lock_manager.get(), log_manager.get(), nullptr, data_send, &offset);
-        set_transaction(&txn_id, context);
-
-        // 用于判断是否已经调用了yy_delete_buffer来删除buf
-        bool finish_analyze = false;
-        pthread_mutex_lock(buffer_mutex);
-        YY_BUFFER_STATE buf = yy_scan_string(data_recv);
-        if (yyparse() == 0) {
-            if (ast::parse_tree != nullptr) {
-                try {
-                    // analyze and rewrite
-                    std::shared_ptr<Query> query = analyze->do_analyze(ast::parse_tree);
-                    yy_delete_buffer(buf);
-                    finish_analyze = true;
-                    pthread_mutex_unlock(buffer_mutex);
-                    // 优化器
-                    std::shared_ptr<Plan> plan = optimizer->plan_query(query, context);
+    };
+    context->result_log_ = result_log.get();
+    context->binary_result_ = session->binary_result;
+    context->memory_.set_limit(session->query_memory_limit);
+    context->version_store_ = version_store.get();
+    set_transaction(&session->txn_id, context);
+
+    EngineMetrics &metrics = EngineMetrics::get();
+    metrics.statements.add();
+    // 只缓存自动提交的语句的结果，显式事务中的select需要加锁并看到本事务的修改
+    bool use_result_cache = result_cache != nullptr && !context->txn_->get_txn_mode();
+    uint64_t schema_version = sm_manager->schema_version_;
+    std::string cache_key;
+    std::shared_ptr<const CachedResult> cached;
+    // select按语句文本查找结果缓存，命中时不再解析、生成计划和执行
+    if (use_result_cache) {
+        cache_key = ResultCache::make_key(PlanCache::normalize(sql), {}, session->binary_result);
+        cached = result_cache->lookup(cache_key);
+    }
+    // 语法树由本连接持有，解析完成后即可释放scanner的缓冲区
+    std::shared_ptr<ast::TreeNode> parse_tree;
+    std::shared_ptr<Plan> plan;
+    bool executed = false;      // 计划执行完成，没有抛出异常
+    PageAccessCounter counts_before = PageAccessCounter::local();
+    auto parse_start = std::chrono::steady_clock::now();
+    int parse_result = 0;
+    if (cached == nullptr) {
+        YY_BUFFER_STATE buf = yy_scan_string(sql.c_str(), session->scanner);
+        parse_result = yyparse(session->scanner, parse_tree);
+        yy_delete_buffer(buf, session->scanner);
+        metrics.stmt_parse_latency.observe(std::chrono::steady_clock::now() - parse_start);
+    }
+    if (parse_result == 0) {
+        if (parse_tree != nullptr) {
+            try {
+                // analyze and rewrite
+                auto plan_start = std::chrono::steady_clock::now();
+                std::shared_ptr<Query> query = analyze->do_analyze(parse_tree);
+                auto analyze_time = std::chrono::steady_clock::now() - plan_start;
+                // 崩溃恢复的undo在后台进行，访问失败事务修改过的表的语句等待撤销完成，等待的时间不计入计划时间
+                recovery->wait_for_undo(query->tables);
+                plan_start = std::chrono::steady_clock::now();
+                // 优化器，PREPARE和EXECUTE使用计划缓存中的计划，不再重复分析和优化
+                if (auto x = std::dynamic_pointer_cast<ast::PrepareStmt>(parse_tree)) {
+                    if (session->prepared_stmts.count(x->name)) {
+                        throw PreparedStmtExistsError(x->name);
+                    }
+                    session->prepared_stmts[x->name] = plan_cache->prepare(PlanCache::prepare_key(sql), x->stmt, context);
+                } else if (auto x = std::dynamic_pointer_cast<ast::ExecuteStmt>(parse_tree)) {
+                    auto it = session->prepared_stmts.find(x->name);
+                    if (it == session->prepared_stmts.end()) {
+                        throw PreparedStmtNotFoundError(x->name);
+                    }
+                    // EXECUTE按PREPARE的语句和参数的值查找结果缓存
+                    if (use_result_cache) {
+                        cache_key = ResultCache::make_key(it->second->sql, query->values, session->binary_result);
+                        cached = result_cache->lookup(cache_key);
+                    }
+                    if (cached == nullptr) {
+                        plan = plan_cache->execute(it->second, query->values, context);
+                    }
+                } else if (auto x = std::dynamic_pointer_cast<ast::SetStmt>(parse_tree)) {
+                    set_session_option(session, x->name, x->value);
+                } else if (auto x = std::dynamic_pointer_cast<ast::DeallocateStmt>(parse_tree)) {
+                    if (session->prepared_stmts.erase(x->name) == 0) {
+                        throw PreparedStmtNotFoundError(x->name);
+                    }
+                } else {
+                    plan = optimizer->plan_query(query, context);
+                }
+                metrics.stmt_plan_latency.observe(analyze_time + (std::chrono::steady_clock::now() - plan_start));
+                if (plan != nullptr) {
+                    // select执行之前记录读取的表中数据的版本，同时记下发送的结果和结果日志
+                    if (use_result_cache) {
+                        auto entry = std::make_shared<CachedResult>();
+                        if (result_cache->prepare(plan, schema_version, entry.get())) {
+                            entry->key = std::move(cache_key);
+                            cache_entry = std::move(entry);
+                            context->captured_log_ = &cache_entry->log_text;
+                        }
+                    }
                     // portal
+                    ScopedLatency latency(metrics.stmt_execute_latency);
                     std::shared_ptr<PortalStmt> portalStmt = portal->start(plan, context);
-                    portal->run(portalStmt, ql_manager.get(), &txn_id, context);
+                    portal->run(portalStmt, ql_manager.get(), &session->txn_id, context);
                     portal->drop();
-                } catch (TransactionAbortException &e) {
-                    // 事务需要回滚，需要把abort信息返回给客户端并写入output.txt文件中
-                    std::string str = "abort\n";
-                    memcpy(data_send, str.c_str(), str.length());
-                    data_send[str.length()] = '\0';
-                    offset = str.length();
-
-                    // 回滚事务
-                    txn_manager->abort(context->txn_, log_manager.get());
+                    executed = true;
+                }
+            } catch (TransactionAbortException &e) {
+                // 事务需要回滚，需要把abort信息返回给客户端并写入output.txt文件中
+                std::string str = "abort\n";
+                memcpy(data_send, str.c_str(), str.length());
+                data_send[str.length()] = '\0';
+                offset = str.length();
+
+                // 回滚事务
+                txn_manager->abort(context->txn_, log_manager.get());
+                if (ENABLE_REQUEST_TRACE) {
                     std::cout << e.GetInfo() << std::endl;
+                }
 
-                    std::fstream outfile;
-                    outfile.open("output.txt", std::ios::out | std::ios::app);
-                    outfile << str;
-                    outfile.close();
-                } catch (UniBaseError &e) {
-                    // 遇到异常，需要打印failure到output.txt文件中，并发异常信息返回给客户端
+                if (context->result_log_ != nullptr) {
+                    context->result_log_->append(str);
+                }
+            } catch (UniBaseError &e) {
+                // 遇到异常，需要打印failure到output.txt文件中，并发异常信息返回给客户端
+                if (ENABLE_REQUEST_TRACE) {
                     std::cerr << e.what() << std::endl;
+                }
 
-                    memcpy(data_send, e.what(), e.get_msg_len());
-                    data_send[e.get_msg_len()] = '\n';
-                    data_send[e.get_msg_len() + 1] = '\0';
-                    offset = e.get_msg_len() + 1;
+                memcpy(data_send, e.what(), e.get_msg_len());
+                data_send[e.get_msg_len()] = '\n';
+                data_send[e.get_msg_len() + 1] = '\0';
+                offset = e.get_msg_len() + 1;
 
-                    // 将报错信息写入output.txt
-                    std::fstream outfile;
-                    outfile.open("output.txt",std::ios::out | std::ios::app);
-                    outfile << "failure\n";
-                    outfile.close();
+                // 将报错信息写入output.txt
+                if (context->result_log_ != nullptr) {
+                    context->result_log_->append("failure\n");
                 }
             }
         }
-        if(finish_analyze == false) {
-            yy_delete_buffer(buf);
-            pthread_mutex_unlock(buffer_mutex);
+    }
+    if (slow_query_log != nullptr) {
+        const PageAccessCounter &counts_after = PageAccessCounter::local();
+        PageAccessCounter counts{counts_after.fetches - counts_before.fetches, counts_after.hits - counts_before.hits,
+                                 counts_after.rows - counts_before.rows};
+        log_slow_query(sql, plan, std::chrono::steady_clock::now() - parse_start, counts);
+    }
+    if (cached != nullptr) {
+        // 缓存的结果帧已经以空帧结束
+        metrics.result_cache_hits.add();
+        session->send_batch += cached->frames;
+        if (context->result_log_ != nullptr) {
+            context->result_log_->append(cached->log_text);
+        }
+    } else {
+        // 追加剩余的结果，并以长度为0的帧结束本条语句的结果
+        if (offset > 0) {
+            append_frame(session, data_send, offset);
         }
-        // future TODO: 格式化 sql_handler.result, 传给客户端
-        // send result with fixed format, use protobuf in the future
-        if (write(fd, data_send, offset + 1) == -1) {
-            break;
+        append_frame(session, nullptr, 0);
+        context->captured_log_ = nullptr;
+        if (cache_entry != nullptr && executed) {
+            if (offset > 0) {
+                append_frame(cache_entry->frames, data_send, offset);
+            }
+            append_frame(cache_entry->frames, nullptr, 0);
+            result_cache->insert(std::move(cache_entry), context->txn_->get_start_ts());
+        }
+    }
+    // 如果是单挑语句，需要按照一个完整的事务来执行，所以执行完当前语句后，自动提交事务
+    Transaction *txn = context->txn_;
+    bool finished = txn->get_state() == TransactionState::COMMITTED || txn->get_state() == TransactionState::ABORTED;
+    if(txn->get_txn_mode() == false && !finished)
+    {
+        txn_manager->commit(txn, context->log_mgr_);
+        finished = true;
+    }
+    // 已经结束的事务放回事务管理器的对象池，下一条语句重新开始事务
+    if (finished) {
+        txn_manager->release(txn);
+        session->txn_id = INVALID_TXN_ID;
+    }
+}
+
+// 超过缓冲区的语句不执行，像执行失败的语句一样返回错误信息
+void reject_statement(Session *session, const UniBaseError &e) {
+    std::string msg = std::string(e.what()) + "\n";
+    append_frame(session, msg.data(), msg.size());
+    append_frame(session, nullptr, 0);
+    if (result_log != nullptr) {
+        result_log->append("failure\n");
+    }
+}
+
+/**
+ * @description: 读取会话上的一次请求，按顺序执行其中以分号分隔的所有语句，把各条语句的结果合并后返回给客户端。
+ *               最后一条不完整的语句留到之后的读取再执行，拆分规则见RequestBuffer
+ * @return {bool} 是否保持连接，客户端关闭连接或退出时返回false
+ * @param {Session*} session 已经可读的会话
+ */
+bool handle_request(Session *session) {
+    int fd = session->fd;
+    ssize_t i_recvBytes = read(fd, session->request.space(), session->request.space_left());
+
+    if (i_recvBytes == 0) {
+        if (ENABLE_REQUEST_TRACE) {
+            std::cout << "Maybe the client has closed" << std::endl;
+        }
+        return false;
+    }
+    if (i_recvBytes == -1) {
+        std::cout << "Client read error!" << std::endl;
+        return false;
+    }
+
+    if (ENABLE_REQUEST_TRACE) {
+        printf("i_recvBytes: %zd \n ", i_recvBytes);
+    }
+
+    std::vector<std::string> stmts;
+    bool too_long = session->request.consume(i_recvBytes, stmts);
+
+    for (auto &sql : stmts) {
+        if (sql == "exit") {
+            if (ENABLE_REQUEST_TRACE) {
+                std::cout << "Client exit." << std::endl;
+            }
+            flush_frames(session);
+            return false;
         }
-        // 如果是单挑语句，需要按照一个完整的事务来执行，所以执行完当前语句后，自动提交事务
-        if(context->txn_->get_txn_mode() == false)
-        {
-            txn_manager->commit(context->txn_, context->log_mgr_);
+        if (sql == "crash") {
+            std::cout << "Server crash" << std::endl;
+            exit(1);
         }
+        execute_statement(session, sql);
     }
+    if (too_long) {
+        reject_statement(session, StatementTooLongError(BUFFER_LENGTH - 1));
+    }
+    return flush_frames(session);
+}
 
+// 在worker中处理会话上的一条请求，之后重新等待该连接可读，连接关闭时释放会话
+void serve_session(int epfd, Session *session) {
+    if (handle_request(session)) {
+        struct epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = session;
+        if (epoll_ctl(epfd, EPOLL_CTL_MOD, session->fd, &ev) == 0) {
+            return;
+        }
+    }
     // Clear
-    std::cout << "Terminating current client_connection..." << std::endl;
-    close(fd);           // close a file descriptor.
-    pthread_exit(NULL);  // terminate calling thread!
+    if (ENABLE_REQUEST_TRACE) {
+        std::cout << "Terminating current client_connection..." << std::endl;
+    }
+    epoll_ctl(epfd, EPOLL_CTL_DEL, session->fd, nullptr);
+    // 客户端断开时回滚它尚未结束的显式事务，释放事务持有的锁
+    if (Transaction *txn = txn_manager->get_transaction(session->txn_id)) {
+        txn_manager->abort(txn, log_manager.get());
+        txn_manager->release(txn);
+    }
+    delete session;
 }
 
-void start_server() {
-    // init mutex
-    buffer_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
-    sockfd_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
-    pthread_mutex_init(buffer_mutex, nullptr);
-    pthread_mutex_init(sockfd_mutex, nullptr);
+// 接受监听socket上所有等待中的连接，为每个连接创建会话并注册到epoll中
+void accept_connections(int epfd, int sockfd_server) {
+    while (true) {
+        struct sockaddr_in s_addr_client {};
+        socklen_t client_length = sizeof(s_addr_client);
+        int sockfd = accept(sockfd_server, (struct sockaddr *)(&s_addr_client), &client_length);
+        if (sockfd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cout << "Accept error!" << std::endl;
+            }
+            return;
+        }
+
+        if (ENABLE_REQUEST_TRACE) {
+            std::cout << "establish client connection, sockfd: " + std::to_string(sockfd) + "\n";
+        }
+
+        Session *session = new Session(sockfd);
+        struct epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.ptr = session;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) == -1) {
+            std::cout << "Epoll add error!" << std::endl;
+            delete session;
+        }
+    }
+}
+
+// epoll事件的data.ptr指向它时来自指标端口的监听socket
+static int metrics_listener_tag;
+
+/**
+ * @description: 在METRICS_PORT上监听Prometheus的抓取请求，端口为0或监听失败时不提供指标端口
+ * @return {int} 非阻塞的监听socket，失败时返回-1
+ */
+int open_metrics_listener() {
+    if (METRICS_PORT == 0) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    int val = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(METRICS_PORT);
+    if (bind(fd, (struct sockaddr *)(&addr), sizeof(addr)) == -1 || listen(fd, LISTEN_BACKLOG) == -1) {
+        std::cout << "Fail to listen on the metrics port " << METRICS_PORT << ", metrics endpoint disabled" << std::endl;
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @description: 回应一次HTTP抓取，然后关闭连接。请求GET /trace时返回Chrome trace JSON格式的trace缓冲区，
+ *               ENABLE_TRACING为false时其中没有span；其他请求都返回Prometheus文本格式的全部指标
+ * @param {int} fd 已经接受的连接
+ */
+void serve_metrics(int fd) {
+    struct timeval timeout {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    char request[BUFFER_LENGTH];
+    ssize_t request_len = read(fd, request, sizeof(request));
+    if (request_len > 0) {
+        std::string_view request_line(request, request_len);
+        bool trace = request_line.rfind("GET /trace ", 0) == 0 || request_line.rfind("GET /trace?", 0) == 0;
+        std::string body = trace ? TraceLog::get().format_chrome_json() : EngineMetrics::get().format_prometheus();
+        std::string content_type = trace ? "application/json" : "text/plain; version=0.0.4";
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: " + content_type + "\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n" + body;
+        const char *data = response.data();
+        size_t len = response.size();
+        while (len > 0) {
+            ssize_t n = write(fd, data, len);
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            data += n;
+            len -= n;
+        }
+    }
+    close(fd);
+}
 
+void start_server() {
     int sockfd_server;
     int fd_temp;
     struct sockaddr_in s_addr_in {};
@@ -211,36 +619,82 @@ void start_server() {
         sleep(2);
     }
 
-    while ((fd_temp = listen(sockfd_server, MAX_CONN_LIMIT)) == -1) {
+    while ((fd_temp = listen(sockfd_server, LISTEN_BACKLOG)) == -1) {
         std::cout << "Fail to listen on the socket on the host, retry after 2s..." << std::endl;
         sleep(2);
     }
 
-    while (!should_exit) {
-        std::cout << "Waiting for new connection..." << std::endl;
-        pthread_t thread_id;
-        struct sockaddr_in s_addr_client {};
-        int client_length = sizeof(s_addr_client);
+    // 监听socket设为非阻塞，一次可读事件中接受所有已经完成握手的连接
+    fcntl(sockfd_server, F_SETFL, fcntl(sockfd_server, F_GETFL) | O_NONBLOCK);
+    int epfd = epoll_create1(0);
+    if (epfd == -1) {
+        throw UnixError();
+    }
+    struct epoll_event listen_ev {};
+    listen_ev.events = EPOLLIN;
+    listen_ev.data.ptr = nullptr;   // data.ptr为空的事件来自监听socket
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd_server, &listen_ev) == -1) {
+        throw UnixError();
+    }
+    int metrics_fd = open_metrics_listener();
+    if (metrics_fd != -1) {
+        struct epoll_event metrics_ev {};
+        metrics_ev.events = EPOLLIN;
+        metrics_ev.data.ptr = &metrics_listener_tag;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, metrics_fd, &metrics_ev) == -1) {
+            throw UnixError();
+        }
+    }
 
+    // worker线程屏蔽SIGINT，信号只由事件循环所在的线程处理，sigint_handler会longjmp回事件循环
+    sigset_t sigint_set, old_set;
+    sigemptyset(&sigint_set);
+    sigaddset(&sigint_set, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &sigint_set, &old_set);
+    size_t num_workers = SERVER_WORKER_THREADS > 0 ? SERVER_WORKER_THREADS
+                                                   : std::max(1u, std::thread::hardware_concurrency());
+    ThreadPool workers(num_workers, BUFFER_POOL_NUMA);
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+
+    // 事件循环只负责接受连接和等待请求到达，可读的连接交给worker执行语句
+    struct epoll_event events[MAX_EVENTS];
+    while (!should_exit) {
         if (setjmp(jmpbuf)) {
             std::cout << "Break from Server Listen Loop\n";
             break;
         }
 
-        // Block here. Until server accepts a new connection.
-        pthread_mutex_lock(sockfd_mutex);
-        int sockfd = accept(sockfd_server, (struct sockaddr *)(&s_addr_client), (socklen_t *)(&client_length));
-        if (sockfd == -1) {
-            std::cout << "Accept error!" << std::endl;
-            continue;  // ignore current socket ,continue while loop.
+        int num_events = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (num_events == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "Epoll wait error!" << std::endl;
+            break;
         }
-        
-        // 和客户端建立连接，并开启一个线程负责处理客户端请求
-        if (pthread_create(&thread_id, nullptr, &client_handler, (void *)(&sockfd)) != 0) {
-            std::cout << "Create thread fail!" << std::endl;
-            break;  // break while loop
+        for (int i = 0; i < num_events; i++) {
+            if (events[i].data.ptr == nullptr) {
+                accept_connections(epfd, sockfd_server);
+                continue;
+            }
+            if (events[i].data.ptr == &metrics_listener_tag) {
+                // 指标请求很少，每个连接直接交给worker回应后关闭，不注册到epoll中
+                int fd;
+                while ((fd = accept(metrics_fd, nullptr, nullptr)) != -1) {
+                    workers.submit([fd] { serve_metrics(fd); });
+                }
+                continue;
+            }
+            Session *session = static_cast<Session *>(events[i].data.ptr);
+            workers.submit([epfd, session] { serve_session(epfd, session); });
         }
+    }
 
+    // 等待正在执行的请求结束
+    workers.stop();
+    close(epfd);
+    if (metrics_fd != -1) {
+        close(metrics_fd);
     }
 
     // Clear
@@ -248,16 +702,31 @@ void start_server() {
     int ret = shutdown(sockfd_server, SHUT_WR);  // shut down the all or part of a full-duplex connection.
     if(ret == -1) { printf("%s\n", strerror(errno)); }
 //    assert(ret != -1);
+    page_flusher->stop();
+    buffer_pool_warmer->stop();
+    if (result_log != nullptr) {
+        result_log->stop();
+    }
+    if (slow_query_log != nullptr) {
+        slow_query_log->stop();
+    }
+    bool read_only = sm_manager->is_read_only();
     sm_manager->close_db();
+    // 所有页面和文件头都已写回，最后的检查点使重启时不需要重做和重建
+    if (!read_only) {
+        recovery->checkpoint();
+    }
     std::cout << " DB has been closed.\n";
     std::cout << "Server shuts down." << std::endl;
 }
 
 int main(int argc, char **argv) {
 
-    if (argc != 2) {
+    // --read-only把表的数据文件和索引文件映射到内存，只允许查询
+    bool read_only = argc == 3 && std::string(argv[2]) == "--read-only";
+    if (argc != 2 && !read_only) {
         // 需要指定数据库名称
-        std::cerr << "Usage: " << argv[0] << " <database>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <database> [--read-only]" << std::endl;
         exit(1);
     }
 
@@ -269,18 +738,60 @@ int main(int argc, char **argv) {
         // Database name is passed by args
         std::string db_name = argv[1];
 
-        if (!sm_manager->is_dir(db_name)) {
+        if (!read_only && !sm_manager->is_dir(db_name)) {
             // Database not found, create a new one
             sm_manager->create_db(db_name);
+            // create_db()结束时位于数据库目录中，回到上级目录后再由open_db()进入
+            if (chdir("..") < 0) {
+                throw UnixError();
+            }
         }
+        // LSM表把memtable写成sorted run之前先刷日志，恢复时打开的表也需要
+        rm_manager->set_log_flush_hook([] { log_manager->flush_log_to_disk(); });
         // Open database
-        sm_manager->open_db(db_name);
+        sm_manager->open_db(db_name, read_only);
 
-        // recovery database
+        // recovery database，undo在后台完成，之后即可接受连接
         recovery->analyze();
-        recovery->redo();
-        recovery->undo();
-        
+        txn_manager->set_next_txn_id(recovery->get_next_txn_id());
+        if (read_only) {
+            // 映射的文件不能修改，需要恢复的数据库先以读写方式启动一次
+            if (recovery->needs_recovery()) {
+                throw InternalError("database needs recovery, start it once without --read-only");
+            }
+        } else {
+            recovery->redo();
+            recovery->undo();
+
+            // 开启后台刷脏与检查点线程，写回页面前先刷日志，刷脏之后写入检查点并截断日志
+            page_flusher->set_log_flush_hook([] { log_manager->flush_log_to_disk(); });
+            // 每次检查点之后同时记录缓冲池中的页面，崩溃重启时也能预热
+            page_flusher->set_checkpoint_hook([] {
+                recovery->checkpoint();
+                if (ENABLE_BUFFER_POOL_WARMUP) {
+                    buffer_pool_warmer->dump(BUFFER_POOL_DUMP_NAME);
+                }
+            });
+            // 缓存的索引修改较多时在后台写入索引，检查点时全部写入
+            if (ENABLE_INDEX_CHANGE_BUFFER) {
+                page_flusher->set_merge_hook([](bool checkpoint) {
+                    sm_manager->merge_index_changes(checkpoint ? 1 : IX_CHANGE_BUFFER_BG_MERGE);
+                });
+            }
+            page_flusher->start();
+        }
+        // 在后台按上次记录的页面预热缓冲池，同时开始接受连接
+        if (ENABLE_BUFFER_POOL_WARMUP) {
+            buffer_pool_warmer->start(BUFFER_POOL_DUMP_NAME);
+        }
+        // 开启结果日志和慢查询日志的后台写线程，output.txt和slow_query.log位于数据库目录中
+        if (result_log != nullptr) {
+            result_log->start();
+        }
+        if (slow_query_log != nullptr) {
+            slow_query_log->start();
+        }
+
         // 开启服务端，开始接受客户端连接
         start_server();
     } catch (UniBaseError &e) {